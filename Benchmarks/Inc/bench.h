@@ -0,0 +1,83 @@
+/**
+ * @file bench.h
+ * @brief Host microbenchmark harness for the flight kernels
+ *
+ * @details A case is a setup function that builds fixed-seed inputs and a
+ *          body that executes the kernel a given number of times. The harness
+ *          picks the iteration count, repeats the body for a number of
+ *          samples and reports ns/op and, where the kernel allows user space
+ *          counters, retired instructions/op.
+ */
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef void (*BenchSetup)(uint64_t seed);
+typedef void (*BenchBody)(uint64_t iterations);
+
+typedef struct {
+    const char *name;
+    BenchSetup setup;
+    BenchBody body;
+} BenchCase;
+
+typedef struct {
+    const char *name;
+    uint64_t iterations;        // per sample
+    uint32_t samples;
+    double ns_per_op;           // median over samples
+    double ns_per_op_min;
+    double ns_per_op_max;
+    double instructions_per_op; // median over samples, NAN if unavailable
+} BenchResult;
+
+typedef struct {
+    uint64_t seed;
+    uint32_t samples;
+    double min_time_ms;         // per case, split over the samples
+} BenchOptions;
+
+extern const BenchCase bench_estimator_cases[];
+extern const size_t bench_estimator_case_count;
+extern const BenchCase bench_mainmcu_cases[];
+extern const size_t bench_mainmcu_case_count;
+
+int bench_counter_open(void);
+void bench_counter_close(void);
+void bench_run_case(const BenchCase *bench, const BenchOptions *opts, BenchResult *result);
+
+void bench_write_table(FILE *out, const BenchResult *results, size_t n);
+void bench_write_csv(FILE *out, const BenchResult *results, size_t n);
+void bench_write_json(FILE *out, const BenchResult *results, size_t n, const BenchOptions *opts);
+int bench_compare_baseline(FILE *out, const char *path, const BenchResult *results, size_t n, double tolerance);
+
+// Keeps the compiler from discarding work whose result is otherwise unused
+static inline void bench_do_not_optimize(const void *p) {
+    __asm__ volatile("" : : "g"(p) : "memory");
+}
+
+// Fixed-seed input generation, splitmix64
+typedef struct {
+    uint64_t state;
+} BenchRng;
+
+static inline void bench_rng_seed(BenchRng *rng, uint64_t seed, uint64_t stream) {
+    rng->state = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+}
+
+static inline uint64_t bench_rng_u64(BenchRng *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [lo, hi)
+static inline float bench_rng_range(BenchRng *rng, float lo, float hi) {
+    return lo + (hi - lo) * (float)((bench_rng_u64(rng) >> 40) * (1.0 / 16777216.0));
+}
+
+#endif /* __BENCH_H__ */
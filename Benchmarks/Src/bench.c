@@ -0,0 +1,300 @@
+/**
+ * @file bench.c
+ * @brief Timing, instruction counting and reporting for the host benchmarks
+ *
+ * @details Wall time comes from CLOCK_MONOTONIC. Retired user space
+ *          instructions come from a perf_event_open() hardware counter when
+ *          the kernel allows it (perf_event_paranoid, containers and VMs
+ *          without a PMU often do not), otherwise instructions/op is reported
+ *          as unavailable and only ns/op is compared against a baseline.
+ */
+
+#include <errno.h>
+#include <linux/perf_event.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "bench.h"
+
+#define BENCH_MAX_SAMPLES 1024
+#define BENCH_OVERHEAD_SAMPLES 15
+
+static int counter_fd = -1;
+static double counter_overhead = 0.0;
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double median(double *values, uint32_t n) {
+    qsort(values, n, sizeof(double), compare_double);
+    return n % 2 ? values[n / 2] : 0.5 * (values[n / 2 - 1] + values[n / 2]);
+}
+
+static void counter_start(void) {
+    if (counter_fd >= 0) {
+        ioctl(counter_fd, PERF_EVENT_IOC_RESET, 0);
+        ioctl(counter_fd, PERF_EVENT_IOC_ENABLE, 0);
+    }
+}
+
+static double counter_stop(void) {
+    uint64_t count;
+
+    if (counter_fd < 0) {
+        return NAN;
+    }
+    ioctl(counter_fd, PERF_EVENT_IOC_DISABLE, 0);
+    if (read(counter_fd, &count, sizeof(count)) != sizeof(count)) {
+        return NAN;
+    }
+    return (double)count;
+}
+
+/**
+ * @brief Opens the retired instruction counter for this process
+ * @return 1 if instructions/op will be reported, 0 if the counter is unavailable
+ */
+int bench_counter_open(void) {
+    struct perf_event_attr attr;
+
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+    attr.disabled = 1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    counter_fd = (int)syscall(SYS_perf_event_open, &attr, 0, -1, -1, PERF_FLAG_FD_CLOEXEC);
+    if (counter_fd < 0) {
+        fprintf(stderr, "instruction counter unavailable (%s), reporting ns/op only\n", strerror(errno));
+        return 0;
+    }
+
+    // Instructions spent reading the clock and toggling the counter itself
+    double overhead[BENCH_OVERHEAD_SAMPLES];
+    for (int i = 0; i < BENCH_OVERHEAD_SAMPLES; i++) {
+        counter_start();
+        now_ns();
+        now_ns();
+        overhead[i] = counter_stop();
+    }
+    counter_overhead = median(overhead, BENCH_OVERHEAD_SAMPLES);
+    if (isnan(counter_overhead)) {
+        bench_counter_close();
+        return 0;
+    }
+    return 1;
+}
+
+void bench_counter_close(void) {
+    if (counter_fd >= 0) {
+        close(counter_fd);
+        counter_fd = -1;
+    }
+}
+
+static double time_body(const BenchCase *bench, uint64_t iterations, double *instructions) {
+    counter_start();
+    double start = now_ns();
+    bench->body(iterations);
+    double end = now_ns();
+    double count = counter_stop();
+
+    if (instructions != NULL) {
+        *instructions = count - counter_overhead;
+    }
+    return end - start;
+}
+
+/**
+ * @brief Measures one case
+ * @details The iteration count is grown until one sample takes at least its
+ *          share of min_time_ms, which also warms caches and branch
+ *          predictors before the recorded samples.
+ */
+void bench_run_case(const BenchCase *bench, const BenchOptions *opts, BenchResult *result) {
+    uint32_t samples = opts->samples;
+    double target_ns = opts->min_time_ms * 1e6 / samples;
+    uint64_t iterations = 1;
+
+    if (samples > BENCH_MAX_SAMPLES) {
+        samples = BENCH_MAX_SAMPLES;
+    }
+
+    bench->setup(opts->seed);
+
+    for (;;) {
+        double elapsed = time_body(bench, iterations, NULL);
+        if (elapsed >= target_ns) {
+            break;
+        }
+
+        double scale = elapsed > 0.0 ? 1.2 * target_ns / elapsed : 100.0;
+        if (scale > 100.0) {
+            scale = 100.0;
+        }
+        if (scale < 2.0) {
+            scale = 2.0;
+        }
+        iterations = (uint64_t)(iterations * scale);
+    }
+
+    static double ns[BENCH_MAX_SAMPLES];
+    static double instructions[BENCH_MAX_SAMPLES];
+
+    for (uint32_t s = 0; s < samples; s++) {
+        double count;
+        ns[s] = time_body(bench, iterations, &count) / iterations;
+        instructions[s] = count / iterations;
+    }
+
+    result->name = bench->name;
+    result->iterations = iterations;
+    result->samples = samples;
+    result->instructions_per_op = median(instructions, samples);
+    result->ns_per_op = median(ns, samples);
+    result->ns_per_op_min = ns[0];
+    result->ns_per_op_max = ns[samples - 1];
+}
+
+void bench_write_table(FILE *out, const BenchResult *results, size_t n) {
+    fprintf(out, "%-28s %12s %12s %12s %12s %14s\n",
+            "benchmark", "iterations", "ns/op", "min", "max", "instr/op");
+
+    for (size_t i = 0; i < n; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(out, "%-28s %12llu %12.2f %12.2f %12.2f ",
+                r->name, (unsigned long long)r->iterations, r->ns_per_op, r->ns_per_op_min, r->ns_per_op_max);
+        if (isnan(r->instructions_per_op)) {
+            fprintf(out, "%14s\n", "n/a");
+        } else {
+            fprintf(out, "%14.1f\n", r->instructions_per_op);
+        }
+    }
+}
+
+void bench_write_csv(FILE *out, const BenchResult *results, size_t n) {
+    fprintf(out, "name,iterations,samples,ns_per_op,ns_per_op_min,ns_per_op_max,instructions_per_op\n");
+
+    for (size_t i = 0; i < n; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(out, "%s,%llu,%u,%.3f,%.3f,%.3f,",
+                r->name, (unsigned long long)r->iterations, r->samples,
+                r->ns_per_op, r->ns_per_op_min, r->ns_per_op_max);
+        if (!isnan(r->instructions_per_op)) {
+            fprintf(out, "%.1f", r->instructions_per_op);
+        }
+        fprintf(out, "\n");
+    }
+}
+
+void bench_write_json(FILE *out, const BenchResult *results, size_t n, const BenchOptions *opts) {
+    fprintf(out, "{\n  \"seed\": %llu,\n  \"samples\": %u,\n  \"min_time_ms\": %g,\n  \"benchmarks\": [\n",
+            (unsigned long long)opts->seed, opts->samples, opts->min_time_ms);
+
+    for (size_t i = 0; i < n; i++) {
+        const BenchResult *r = &results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"samples\": %u, "
+                     "\"ns_per_op\": %.3f, \"ns_per_op_min\": %.3f, \"ns_per_op_max\": %.3f, ",
+                r->name, (unsigned long long)r->iterations, r->samples,
+                r->ns_per_op, r->ns_per_op_min, r->ns_per_op_max);
+        if (isnan(r->instructions_per_op)) {
+            fprintf(out, "\"instructions_per_op\": null}");
+        } else {
+            fprintf(out, "\"instructions_per_op\": %.1f}", r->instructions_per_op);
+        }
+        fprintf(out, i + 1 < n ? ",\n" : "\n");
+    }
+    fprintf(out, "  ]\n}\n");
+}
+
+static double parse_field(char **cursor) {
+    char *field = strsep(cursor, ",\n");
+    if (field == NULL || *field == '\0') {
+        return NAN;
+    }
+    return strtod(field, NULL);
+}
+
+/**
+ * @brief Compares results against a CSV written earlier with --format csv
+ * @details Instructions/op is compared when both runs have it since it is
+ *          nearly noise free, otherwise the median ns/op is compared.
+ * @param tolerance Allowed relative increase, 0.05 for 5%
+ * @return Number of regressions, or -1 if the baseline could not be read
+ */
+int bench_compare_baseline(FILE *out, const char *path, const BenchResult *results, size_t n, double tolerance) {
+    FILE *in = fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        return -1;
+    }
+
+    char line[512];
+    int regressions = 0;
+    uint8_t *matched = calloc(n ? n : 1, 1);
+
+    fprintf(out, "%-28s %8s %14s %14s %9s\n", "benchmark", "metric", "baseline", "current", "change");
+
+    while (fgets(line, sizeof(line), in) != NULL) {
+        char *cursor = line;
+        char *name = strsep(&cursor, ",");
+        if (name == NULL || cursor == NULL || strcmp(name, "name") == 0) {
+            continue;
+        }
+
+        parse_field(&cursor);   // iterations
+        parse_field(&cursor);   // samples
+        double base_ns = parse_field(&cursor);
+        parse_field(&cursor);   // ns_per_op_min
+        parse_field(&cursor);   // ns_per_op_max
+        double base_instructions = parse_field(&cursor);
+
+        const BenchResult *r = NULL;
+        for (size_t i = 0; i < n; i++) {
+            if (strcmp(results[i].name, name) == 0) {
+                r = &results[i];
+                matched[i] = 1;
+                break;
+            }
+        }
+        if (r == NULL) {
+            continue;
+        }
+
+        int use_instructions = !isnan(base_instructions) && !isnan(r->instructions_per_op);
+        double base = use_instructions ? base_instructions : base_ns;
+        double current = use_instructions ? r->instructions_per_op : r->ns_per_op;
+        double change = base > 0.0 ? current / base - 1.0 : 0.0;
+        int regressed = change > tolerance;
+
+        regressions += regressed;
+        fprintf(out, "%-28s %8s %14.2f %14.2f %+8.1f%%%s\n", name, use_instructions ? "instr" : "ns",
+                base, current, 100.0 * change, regressed ? "  REGRESSION" : "");
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        if (!matched[i]) {
+            fprintf(out, "%-28s not in baseline\n", results[i].name);
+        }
+    }
+
+    free(matched);
+    fclose(in);
+    return regressions;
+}
@@ -0,0 +1,615 @@
+/**
+ * @file cases_estimator.c
+ * @brief Benchmarks of the state estimator kernels
+ *
+ * @details Inputs are a small ring of noisy pad readings near the launch
+ *          site drawn from the seed. The cases use their own filter instances
+ *          rather than the state machine's globals.
+ *
+ *          The flight cases restore the filter from a snapshot every
+ *          RESTORE_INTERVAL steps, so every run times the same stretch of
+ *          converging covariances rather than one that has settled.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "main.h"
+#include "gps.h"
+#include "trig.h"
+#include "imu_pipeline.h"
+#include "vibration_monitor.h"
+#include "event_detector.h"
+#include "fault_detector.h"
+#include "persist.h"
+#include "bench.h"
+
+#define SAMPLE_RING 256
+#define FRAME_RING 16
+#define RESTORE_INTERVAL 128
+
+#define LAUNCH_LAT 32.9903f
+#define LAUNCH_LON -106.9750f
+#define LAUNCH_ALT 1401.0f
+#define LAUNCH_PRESSURE 85591.0f     // Pa, ISA at LAUNCH_ALT
+
+// Field at the pad in the flat frame (up, north, west), Gauss, as in the SIL
+static const float32_t pad_field[3] = {-0.42f, 0.23f, 0.02f};
+
+#define UBX_NAV_HPPVT_LENGTH 68
+#define UBX_FRAME_LENGTH (UBX_NAV_HPPVT_LENGTH + 8)
+
+typedef struct {
+    float32_t accel[3];
+    float32_t gyro[3];
+    float32_t gps[3];
+    float32_t pressure;
+    float32_t mag[3];
+    GpsFix fix;
+    struct ublox_gnss_nav_hpposecef ecef;
+} PadSample;
+
+static PadSample samples[SAMPLE_RING];
+static GnssOrigin bench_origin;
+static uint8_t frames[FRAME_RING][UBX_FRAME_LENGTH];
+
+static Sensors bench_sensors;
+static ExtKalmanFilter bench_fekf;
+static ExtKalmanFilter fekf_snapshot;
+static float32_t fekf_state_snapshot[MAX_FLIGHT_DIM];
+static GroundExtKalmanFilter bench_gekf;
+static BiasCalibrator bench_cal;
+static MagCalibrator bench_mag_cal;
+static RocketAttitude bench_atd;
+static SerialData bench_serial;
+
+static void load_sample(Sensors *s, const PadSample *p) {
+    s->accel_x = p->accel[0];
+    s->accel_y = p->accel[1];
+    s->accel_z = p->accel[2];
+    s->gyro_x = p->gyro[0];
+    s->gyro_y = p->gyro[1];
+    s->gyro_z = p->gyro[2];
+    s->gps_x = p->gps[0];
+    s->gps_y = p->gps[1];
+    s->gps_z = p->gps[2];
+    s->gps_fix = p->fix;
+    s->pressure = p->pressure;
+    s->mag_x = p->mag[0];
+    s->mag_y = p->mag[1];
+    s->mag_z = p->mag[2];
+    s->mag_new = 1;
+}
+
+// The HPPOSECEF message a receiver would send for the same fix
+static void sample_to_hpposecef(PadSample *p) {
+    double lat = p->fix.lat * GNSS_DEG_E9_TO_RAD;
+    double lon = p->fix.lon * GNSS_DEG_E9_TO_RAD;
+    double h = p->fix.height * GNSS_E4_TO_M;
+    double N = GNSS_WGS84_A / sqrt(1.0 - GNSS_WGS84_E2 * sin(lat) * sin(lat));
+    int64_t x = llround((N + h) * cos(lat) * cos(lon) * 1e4);
+    int64_t y = llround((N + h) * cos(lat) * sin(lon) * 1e4);
+    int64_t z = llround((N * (1.0 - GNSS_WGS84_E2) + h) * sin(lat) * 1e4);
+
+    memset(&p->ecef, 0, sizeof(p->ecef));
+    p->ecef.ecefX = (int32_t)(x / 100);
+    p->ecef.ecefY = (int32_t)(y / 100);
+    p->ecef.ecefZ = (int32_t)(z / 100);
+    p->ecef.ecefXHp = (int8_t)(x % 100);
+    p->ecef.ecefYHp = (int8_t)(y % 100);
+    p->ecef.ecefZHp = (int8_t)(z % 100);
+}
+
+static void setup_samples(uint64_t seed) {
+    BenchRng rng;
+    BenchRng mag_rng;
+    bench_rng_seed(&rng, seed, 1);
+    bench_rng_seed(&mag_rng, seed, 2);
+
+    for (int i = 0; i < SAMPLE_RING; i++) {
+        PadSample *p = &samples[i];
+        p->accel[0] = 9.81f + bench_rng_range(&rng, -0.05f, 0.05f);
+        p->accel[1] = bench_rng_range(&rng, -0.05f, 0.05f);
+        p->accel[2] = bench_rng_range(&rng, -0.05f, 0.05f);
+        for (int k = 0; k < 3; k++) {
+            p->gyro[k] = bench_rng_range(&rng, -0.02f, 0.02f);
+        }
+        p->gps[0] = LAUNCH_LAT + bench_rng_range(&rng, -2e-5f, 2e-5f);
+        p->gps[1] = LAUNCH_LON + bench_rng_range(&rng, -2e-5f, 2e-5f);
+        p->gps[2] = LAUNCH_ALT + bench_rng_range(&rng, -2.0f, 2.0f);
+        p->pressure = roundf(LAUNCH_PRESSURE + bench_rng_range(&rng, -5.0f, 5.0f));
+        for (int k = 0; k < 3; k++) {
+            p->mag[k] = pad_field[k] + bench_rng_range(&mag_rng, -0.005f, 0.005f);
+        }
+        gnss_fix_from_degrees(&p->fix, p->gps[0], p->gps[1], p->gps[2]);
+        sample_to_hpposecef(p);
+    }
+
+    memset(&bench_sensors, 0, sizeof(bench_sensors));
+    bench_sensors.mag_scale_x = 1.0f;
+    bench_sensors.mag_scale_y = 1.0f;
+    bench_sensors.mag_scale_z = 1.0f;
+    load_sample(&bench_sensors, &samples[0]);
+}
+
+static void setup_flight_ekf(uint64_t seed) {
+    setup_samples(seed);
+    initialize_ekf(&bench_fekf, &huart3, &bench_sensors, 3);
+    initialize_rocket_attitude(&bench_atd, 1, 0, 0, 0);
+    bench_atd.time_step = 0.005f;
+
+    // Same origin handling as the ARMED state
+    GPS2Flat(&bench_sensors, &bench_fekf, 1);
+    GPS2Flat(&bench_sensors, &bench_fekf, 0);
+    memcpy(bench_fekf.launch_gps, bench_fekf.gps_flat, sizeof(bench_fekf.launch_gps));
+    Baro2Flat(&bench_sensors, &bench_fekf, 1);
+
+    // x_n is backed by storage outside the struct, so it is saved separately
+    fekf_snapshot = bench_fekf;
+    memcpy(fekf_state_snapshot, bench_fekf.x_n.pData, sizeof(float32_t) * bench_fekf.nx);
+}
+
+static void restore_flight_ekf(void) {
+    bench_fekf = fekf_snapshot;
+    memcpy(bench_fekf.x_n.pData, fekf_state_snapshot, sizeof(float32_t) * bench_fekf.nx);
+}
+
+static void bench_flight_ekf_step(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (i % RESTORE_INTERVAL == 0) {
+            restore_flight_ekf();
+        }
+        load_sample(&bench_sensors, &samples[i % SAMPLE_RING]);
+        update_ekf(&bench_fekf, &bench_atd, &bench_sensors);
+        run_ekf(&bench_fekf, &bench_atd, &bench_sensors, &huart3, 1);
+    }
+    bench_do_not_optimize(bench_fekf.x_n.pData);
+}
+
+// The stages of a flight EKF step that depend on the attitude: the
+// accelerometer compensation, the state transition and its Jacobian
+static void bench_flight_ekf_transition(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (i % RESTORE_INTERVAL == 0) {
+            restore_flight_ekf();
+        }
+        load_sample(&bench_sensors, &samples[i % SAMPLE_RING]);
+        update_ekf(&bench_fekf, &bench_atd, &bench_sensors);
+        state_transition_function(&bench_fekf, &bench_atd, &huart3);
+        state_transition_jacobian(&bench_fekf, &bench_atd, &huart3);
+    }
+    bench_do_not_optimize(bench_fekf.x_n.pData);
+}
+
+// The covariance half of a step: F P F' + Q and the GNSS position update
+static void bench_flight_ekf_covariance(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (i % RESTORE_INTERVAL == 0) {
+            restore_flight_ekf();
+        }
+        predict_covariance(&bench_fekf, &huart3);
+        observation_function(&bench_fekf, &huart3);
+        observation_jacobian(&bench_fekf, &huart3);
+        if (kalman_gain(&bench_fekf, &huart3) == ARM_MATH_SUCCESS) {
+            update_covariance(&bench_fekf, &huart3);
+        }
+    }
+    bench_do_not_optimize(bench_fekf.P_n.pData);
+}
+
+// The GNSS noise adaptation of one new fix, with a full window to average
+static void bench_noise_adapt_update(uint64_t iterations) {
+    float32_t hph[3] = {0.5f, 0.5f, 1.0f};
+    for (uint64_t i = 0; i < iterations; i++) {
+        const PadSample *p = &samples[i % SAMPLE_RING];
+        float32_t innovation[3] = {p->accel[1], p->accel[2], p->gyro[0]};
+        bench_fekf.gps[0] = (float32_t)i;
+        noise_adapt_update(&bench_fekf.noise, bench_fekf.gps, innovation, hph, bench_fekf.R.pData);
+    }
+    bench_do_not_optimize(bench_fekf.R.pData);
+}
+
+// The three scalar GNSS velocity updates of one solution, a slow drift on the pad
+static void bench_flight_ekf_gps_velocity(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (i % RESTORE_INTERVAL == 0) {
+            restore_flight_ekf();
+            bench_fekf.gps_vel_var = 0.01f;
+        }
+        const PadSample *p = &samples[i % SAMPLE_RING];
+        bench_fekf.gps_vel[0] = 0.01f * p->accel[1];
+        bench_fekf.gps_vel[1] = 0.01f * p->accel[2];
+        bench_fekf.gps_vel[2] = 0.1f * p->gyro[0];
+        bench_fekf.gps_vel_valid = 1;
+        gps_velocity_update_step(&bench_fekf, &bench_atd, &huart3);
+    }
+    bench_do_not_optimize(bench_fekf.x_n.pData);
+}
+
+static void setup_ground_bias_cal(uint64_t seed) {
+    setup_samples(seed);
+    initialize_ekf_ground(&bench_gekf, &huart3, &bench_sensors, 6);
+    bias_calibrator_init(&bench_cal);
+    memset(&bench_serial, 0, sizeof(bench_serial));
+}
+
+// One GROUND handler step as in handle_ground(), the sensor update of the
+// ground filter followed by the streaming bias calibration
+static void bench_ground_bias_cal_step(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        load_sample(&bench_sensors, &samples[i % SAMPLE_RING]);
+        // Keep calibrating rather than timing the converged early return
+        if (bench_cal.converged) {
+            bias_calibrator_init(&bench_cal);
+        }
+        update_ekf_ground(&bench_gekf, &bench_sensors);
+        run_ground(&bench_gekf, &bench_cal, &bench_sensors, &bench_serial, &huart3);
+    }
+    bench_do_not_optimize(bench_gekf.x_n.pData);
+}
+
+static void setup_attitude(uint64_t seed) {
+    setup_samples(seed);
+    initialize_rocket_attitude(&bench_atd, 1, 0, 0, 0);
+    bench_atd.time_step = 0.005f;
+    set_gyro(&bench_atd, samples[0].gyro);
+    gyro_to_rotation_quat(&bench_atd);
+}
+
+// One attitude cycle, the quaternion update followed by the shared frame
+static void bench_run_attitude_estimation(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        run_attitude_estimation(&bench_atd, samples[i % SAMPLE_RING].gyro);
+    }
+    bench_do_not_optimize(&bench_atd);
+}
+
+static void bench_gyro_to_rotation_quat(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        set_gyro(&bench_atd, samples[i % SAMPLE_RING].gyro);
+        gyro_to_rotation_quat(&bench_atd);
+    }
+    bench_do_not_optimize(&bench_atd);
+}
+
+static void bench_quat_update(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        quat_update(&bench_atd);
+    }
+    bench_do_not_optimize(&bench_atd);
+}
+
+static void setup_mag_calibrator(uint64_t seed) {
+    setup_samples(seed);
+    mag_calibrator_init(&bench_mag_cal);
+}
+
+// Pad readings never pass the rotation check, so every MAG_CAL_SOLVE_INTERVAL
+// readings the full fit runs and is rejected, as it would on the pad
+static void bench_mag_calibrator_update(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        load_sample(&bench_sensors, &samples[i % SAMPLE_RING]);
+        mag_calibrator_update(&bench_mag_cal, &bench_sensors);
+    }
+    bench_do_not_optimize(&bench_mag_cal);
+}
+
+static void setup_mag_heading(uint64_t seed) {
+    setup_attitude(seed);
+    for (int i = 0; i < 16; i++) {
+        load_sample(&bench_sensors, &samples[i]);
+        mag_heading_reference(&bench_atd, &bench_sensors);
+    }
+}
+
+static void bench_mag_heading_correction(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        load_sample(&bench_sensors, &samples[i % SAMPLE_RING]);
+        mag_heading_correction(&bench_atd, &bench_sensors);
+    }
+    bench_do_not_optimize(&bench_atd);
+}
+
+static void bench_gps2flat(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        load_sample(&bench_sensors, &samples[i % SAMPLE_RING]);
+        GPS2Flat(&bench_sensors, &bench_fekf, 0);
+    }
+    bench_do_not_optimize(bench_fekf.gps_flat);
+}
+
+static void bench_baro_altitude(uint64_t iterations) {
+    float32_t altitude;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        altitude = pressure2altitude(samples[i % SAMPLE_RING].pressure);
+        bench_do_not_optimize(&altitude);
+    }
+}
+
+static float32_t trig_args[SAMPLE_RING][2];
+
+static void setup_trig(uint64_t seed) {
+    BenchRng rng;
+
+    bench_rng_seed(&rng, seed, 3);
+    for (int i = 0; i < SAMPLE_RING; i++) {
+        trig_args[i][0] = bench_rng_range(&rng, -1.0f, 1.0f);
+        trig_args[i][1] = bench_rng_range(&rng, -1.0f, 1.0f);
+    }
+}
+
+// Angles up to pi, the half-angle of gyro_to_rotation_quat() is far smaller
+static void bench_trig_sincos(uint64_t iterations) {
+    float32_t sc[2];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        trig_sincos(3.0f * trig_args[i % SAMPLE_RING][0], &sc[0], &sc[1]);
+        bench_do_not_optimize(sc);
+    }
+}
+
+static void bench_trig_atan2(uint64_t iterations) {
+    float32_t angle;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        angle = trig_atan2(trig_args[i % SAMPLE_RING][0], trig_args[i % SAMPLE_RING][1]);
+        bench_do_not_optimize(&angle);
+    }
+}
+
+// The double precision calls the attitude code made before trig.h
+static void bench_libm_sincos(uint64_t iterations) {
+    float32_t sc[2];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        double angle = 3.0f * trig_args[i % SAMPLE_RING][0];
+        sc[0] = (float32_t)sin(angle);
+        sc[1] = (float32_t)cos(angle);
+        bench_do_not_optimize(sc);
+    }
+}
+
+static void bench_libm_atan2(uint64_t iterations) {
+    float32_t angle;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        angle = (float32_t)atan2((double)trig_args[i % SAMPLE_RING][0], (double)trig_args[i % SAMPLE_RING][1]);
+        bench_do_not_optimize(&angle);
+    }
+}
+
+static ImuPipeline bench_imu;
+static int16_t imu_raw[SAMPLE_RING][IMU_PIPELINE_CHANNELS];
+
+// Burst counts of a vehicle on the pad with some vibration, a few LSB to a few tens
+static void setup_imu_pipeline_filter(uint64_t seed, ImuFilterType filter) {
+    ImuPipelineConfig cfg;
+    BenchRng rng;
+
+    bench_rng_seed(&rng, seed, 4);
+    for (int i = 0; i < SAMPLE_RING; i++) {
+        for (int k = 0; k < 3; k++) {
+            imu_raw[i][k] = (int16_t)lroundf(bench_rng_range(&rng, -20.0f, 20.0f));
+            imu_raw[i][3 + k] = (int16_t)lroundf(bench_rng_range(&rng, -40.0f, 40.0f));
+        }
+        imu_raw[i][3] += 800;
+    }
+    imu_pipeline_default_config(&cfg);
+    cfg.filter = filter;
+    imu_pipeline_init(&bench_imu, &cfg);
+}
+
+static void setup_imu_pipeline(uint64_t seed) {
+    setup_imu_pipeline_filter(seed, IMU_FILTER_BIQUAD);
+}
+
+static void setup_imu_pipeline_fir(uint64_t seed) {
+    setup_imu_pipeline_filter(seed, IMU_FILTER_FIR);
+}
+
+// One op is one estimator input: IMU_PIPELINE_DECIMATION data ready pushes,
+// then filtering and integrating the block
+static void bench_imu_pipeline_block(uint64_t iterations) {
+    uint32_t k = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (int j = 0; j < IMU_PIPELINE_DECIMATION; j++) {
+            imu_pipeline_push(&bench_imu, imu_raw[k % SAMPLE_RING], k * 500);
+            k++;
+        }
+        imu_pipeline_process(&bench_imu);
+    }
+    bench_do_not_optimize(bench_imu.accel);
+}
+
+static VibrationMonitor bench_vibration;
+
+static void setup_vibration_monitor(uint64_t seed) {
+    int16_t block[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION];
+
+    setup_imu_pipeline(seed);
+    vibration_monitor_init(&bench_vibration, IMU_PIPELINE_SAMPLE_RATE);
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+            block[c][0] = imu_raw[i % SAMPLE_RING][c];
+        }
+        vibration_monitor_push(&bench_vibration, block, 1);
+    }
+}
+
+// One op is one step, the longest the main loop can be held up by the
+// monitor: a channel transform, or now and then reducing the spectra
+static void bench_vibration_monitor_step(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        if (!vibration_monitor_step(&bench_vibration)) {
+            bench_vibration.busy = 1;
+            bench_vibration.channel = 0;
+            vibration_monitor_step(&bench_vibration);
+        }
+    }
+    bench_do_not_optimize(bench_vibration.record);
+}
+
+static EventDetector bench_events;
+
+static void setup_event_detector(uint64_t seed) {
+    setup_imu_pipeline(seed);
+    event_detector_init(&bench_events, IMU_PIPELINE_SAMPLE_RATE);
+    event_detector_arm(&bench_events, 1);
+}
+
+// One op is what update_sensors() adds per raw block: the block of
+// IMU_PIPELINE_DECIMATION samples and a baro altitude, armed on the pad
+static void bench_event_detector_block(uint64_t iterations) {
+    int16_t block[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION];
+    uint32_t k = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (int j = 0; j < IMU_PIPELINE_DECIMATION; j++, k++) {
+            block[EVENT_AXIS_CHANNEL][j] = imu_raw[k % SAMPLE_RING][EVENT_AXIS_CHANNEL];
+        }
+        event_detector_push(&bench_events, block, IMU_PIPELINE_DECIMATION, k * 500);
+        event_detector_baro(&bench_events, 1401.0f + 0.01f * (float32_t)(k % 64), k * 500);
+    }
+    bench_do_not_optimize(&bench_events);
+}
+
+static FaultDetector bench_faults;
+
+static void setup_fault_detector(uint64_t seed) {
+    setup_imu_pipeline(seed);
+    fault_detector_init(&bench_faults, NULL);
+}
+
+// One op is one inference as fault_detector_step() runs it: the features of
+// an accelerometer window and both layers, what FAULT_COST_PRIOR stands for
+static void bench_fault_detector_infer(uint64_t iterations) {
+    float32_t window[FAULT_WINDOW + 1];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        for (int j = 0; j <= FAULT_WINDOW; j++) {
+            window[j] = (float32_t)imu_raw[(i * FAULT_HOP + j) % SAMPLE_RING][3];
+        }
+        fault_detector_features(&bench_faults.cfg[FAULT_ACCEL_X], window, bench_faults.input);
+        fault_detector_classify(&bench_faults, bench_faults.input);
+    }
+    bench_do_not_optimize(&bench_faults);
+}
+
+static WarmStartRecord bench_warm_start;
+
+static void setup_warm_start(uint64_t seed) {
+    setup_flight_ekf(seed);
+    persist_init();
+    memset(&bench_warm_start, 0, sizeof(bench_warm_start));
+    bench_warm_start.nx = bench_fekf.nx;
+    bench_warm_start.nz = bench_fekf.nz;
+    memcpy(bench_warm_start.x, bench_fekf.x_n.pData, bench_fekf.nx * sizeof(float32_t));
+    memcpy(bench_warm_start.P, bench_fekf.P_n.pData, bench_fekf.nx * bench_fekf.nx * sizeof(float32_t));
+    bench_warm_start.gnss_origin = bench_fekf.gnss_origin;
+}
+
+// One op is one snapshot, the CRC and the copy into backup SRAM the state
+// machine makes every PERSIST_WARM_PERIOD runs
+static void bench_warm_start_save(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        bench_warm_start.x[0] = (float32_t)i;
+        warm_start_save(&bench_warm_start);
+    }
+    bench_do_not_optimize(&bench_warm_start);
+}
+
+static void setup_gnss_origin(uint64_t seed) {
+    setup_samples(seed);
+    gnss_origin_set(&bench_origin, &samples[0].fix);
+}
+
+static void bench_gnss_fix_to_enu(uint64_t iterations) {
+    float32_t enu[3];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        gnss_origin_fix_to_enu(&bench_origin, &samples[i % SAMPLE_RING].fix, enu);
+        bench_do_not_optimize(enu);
+    }
+}
+
+static void bench_gnss_hpposecef_to_enu(uint64_t iterations) {
+    float32_t enu[3];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        gnss_origin_hpposecef_to_enu(&bench_origin, &samples[i % SAMPLE_RING].ecef, enu);
+        bench_do_not_optimize(enu);
+    }
+}
+
+static void setup_ubx_frames(uint64_t seed) {
+    BenchRng rng;
+    bench_rng_seed(&rng, seed, 2);
+
+    for (int f = 0; f < FRAME_RING; f++) {
+        uint8_t *frame = frames[f];
+
+        frame[0] = 0xb5;
+        frame[1] = 0x62;
+        frame[2] = 0x01;
+        frame[3] = 0x28;
+        frame[4] = UBX_NAV_HPPVT_LENGTH & 0xff;
+        frame[5] = UBX_NAV_HPPVT_LENGTH >> 8;
+        for (int i = 0; i < UBX_NAV_HPPVT_LENGTH; i++) {
+            frame[6 + i] = (uint8_t)bench_rng_u64(&rng);
+        }
+
+        uint8_t ck_a = 0, ck_b = 0;
+        for (int i = 2; i < 6 + UBX_NAV_HPPVT_LENGTH; i++) {
+            ck_a += frame[i];
+            ck_b += ck_a;
+        }
+        frame[6 + UBX_NAV_HPPVT_LENGTH] = ck_a;
+        frame[7 + UBX_NAV_HPPVT_LENGTH] = ck_b;
+    }
+}
+
+static void bench_ublox_protocol_decode(uint64_t iterations) {
+    uint8_t msg[256];
+    uint16_t msg_len = 0;
+    uint8_t *rem;
+    uint8_t cls = 0;
+    uint8_t id = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        ublox_protocol_decode(frames[i % FRAME_RING], UBX_FRAME_LENGTH, &cls, &id, msg, sizeof(msg), &msg_len, &rem);
+        bench_do_not_optimize(msg);
+    }
+}
+
+const BenchCase bench_estimator_cases[] = {
+    {"flight_ekf_step", setup_flight_ekf, bench_flight_ekf_step},
+    {"flight_ekf_transition", setup_flight_ekf, bench_flight_ekf_transition},
+    {"flight_ekf_gps_velocity", setup_flight_ekf, bench_flight_ekf_gps_velocity},
+    {"flight_ekf_covariance", setup_flight_ekf, bench_flight_ekf_covariance},
+    {"noise_adapt_update", setup_flight_ekf, bench_noise_adapt_update},
+    {"ground_bias_cal_step", setup_ground_bias_cal, bench_ground_bias_cal_step},
+    {"gyro_to_rotation_quat", setup_attitude, bench_gyro_to_rotation_quat},
+    {"quat_update", setup_attitude, bench_quat_update},
+    {"run_attitude_estimation", setup_attitude, bench_run_attitude_estimation},
+    {"mag_calibrator_update", setup_mag_calibrator, bench_mag_calibrator_update},
+    {"mag_heading_correction", setup_mag_heading, bench_mag_heading_correction},
+    {"gps2flat", setup_flight_ekf, bench_gps2flat},
+    {"baro_altitude", setup_samples, bench_baro_altitude},
+    {"trig_sincos", setup_trig, bench_trig_sincos},
+    {"trig_atan2", setup_trig, bench_trig_atan2},
+    {"libm_sincos", setup_trig, bench_libm_sincos},
+    {"libm_atan2", setup_trig, bench_libm_atan2},
+    {"imu_pipeline_block", setup_imu_pipeline, bench_imu_pipeline_block},
+    {"imu_pipeline_block_fir", setup_imu_pipeline_fir, bench_imu_pipeline_block},
+    {"vibration_monitor_step", setup_vibration_monitor, bench_vibration_monitor_step},
+    {"event_detector_block", setup_event_detector, bench_event_detector_block},
+    {"fault_detector_infer", setup_fault_detector, bench_fault_detector_infer},
+    {"warm_start_save", setup_warm_start, bench_warm_start_save},
+    {"gnss_fix_to_enu", setup_gnss_origin, bench_gnss_fix_to_enu},
+    {"gnss_hpposecef_to_enu", setup_gnss_origin, bench_gnss_hpposecef_to_enu},
+    {"ublox_protocol_decode", setup_ubx_frames, bench_ublox_protocol_decode},
+};
+
+const size_t bench_estimator_case_count = sizeof(bench_estimator_cases) / sizeof(bench_estimator_cases[0]);
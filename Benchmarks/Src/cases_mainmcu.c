@@ -0,0 +1,186 @@
+/**
+ * @file cases_mainmcu.c
+ * @brief Benchmarks of the MainMCU telemetry, logging and controls kernels
+ *
+ * @details verify_packet() and extract_packet() destuff in place, so those
+ *          cases copy a pristine packet into a scratch buffer on every
+ *          iteration and the copy is part of the reported cost.
+ */
+
+#include <string.h>
+
+#include "bench.h"
+#include "controls.h"
+#include "crc_hash.h"
+#include "packet_encode.h"
+#include "state_csv.h"
+
+#define PAYLOAD_RING 16
+#define STATE_RING 64
+#define PAYLOAD_SIZE ROCKETSTATEVECTOR_SIZE
+#define PACKET_SIZE (PAYLOAD_SIZE + 5)
+
+static uint8_t payloads[PAYLOAD_RING][PAYLOAD_SIZE];
+static uint8_t packets[PAYLOAD_RING][PACKET_SIZE];
+static uint8_t verified[PAYLOAD_RING][PACKET_SIZE];
+static RocketState states[STATE_RING];
+static float32_t control_states[STATE_RING][9];
+static float control_times[STATE_RING];
+static controller ctrl;
+
+static void setup_payloads(uint64_t seed) {
+    BenchRng rng;
+    bench_rng_seed(&rng, seed, 3);
+
+    for (int p = 0; p < PAYLOAD_RING; p++) {
+        for (int i = 0; i < PAYLOAD_SIZE; i++) {
+            uint64_t r = bench_rng_u64(&rng);
+            // Telemetry carries plenty of zero bytes, which is what COBS has to stuff
+            payloads[p][i] = (r & 0x7) == 0 ? 0 : (uint8_t)(r >> 8);
+        }
+        generate_packet(payloads[p], PAYLOAD_SIZE, packets[p], ROCKETSTATEVECTOR_MSG_ID);
+        memcpy(verified[p], packets[p], PACKET_SIZE);
+        verify_packet(verified[p], PACKET_SIZE);
+    }
+}
+
+static void bench_generate_packet(uint64_t iterations) {
+    uint8_t packet[PACKET_SIZE];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        generate_packet(payloads[i % PAYLOAD_RING], PAYLOAD_SIZE, packet, ROCKETSTATEVECTOR_MSG_ID);
+        bench_do_not_optimize(packet);
+    }
+}
+
+static void bench_verify_packet(uint64_t iterations) {
+    uint8_t packet[PACKET_SIZE];
+    bool ok = true;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        memcpy(packet, packets[i % PAYLOAD_RING], PACKET_SIZE);
+        ok &= verify_packet(packet, PACKET_SIZE);
+    }
+    bench_do_not_optimize(&ok);
+}
+
+static void bench_extract_packet(uint64_t iterations) {
+    uint8_t packet[PACKET_SIZE];
+    uint8_t payload[PAYLOAD_SIZE];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        memcpy(packet, verified[i % PAYLOAD_RING], PACKET_SIZE);
+        extract_packet(packet, PACKET_SIZE, payload);
+        bench_do_not_optimize(payload);
+    }
+}
+
+static void bench_calculate_crc8_hash(uint64_t iterations) {
+    uint8_t crc = 0;
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        crc ^= calculate_crc8_hash(payloads[i % PAYLOAD_RING], PAYLOAD_SIZE);
+    }
+    bench_do_not_optimize(&crc);
+}
+
+static void setup_states(uint64_t seed) {
+    BenchRng rng;
+    bench_rng_seed(&rng, seed, 4);
+
+    memset(states, 0, sizeof(states));
+    for (int s = 0; s < STATE_RING; s++) {
+        RocketState *st = &states[s];
+
+        st->launch_timestamp = 20000 + s;
+        st->state_vector.timestamp = 20000 + 100 * s;
+        st->state_vector.velocity_x = bench_rng_range(&rng, -300.0f, 300.0f);
+        st->state_vector.velocity_y = bench_rng_range(&rng, -20.0f, 20.0f);
+        st->state_vector.velocity_z = bench_rng_range(&rng, -20.0f, 20.0f);
+        st->state_vector.attitude_w = bench_rng_range(&rng, 0.9f, 1.0f);
+        st->state_vector.attitude_x = bench_rng_range(&rng, -0.1f, 0.1f);
+        st->state_vector.attitude_y = bench_rng_range(&rng, -0.1f, 0.1f);
+        st->state_vector.attitude_z = bench_rng_range(&rng, -0.1f, 0.1f);
+        st->state_vector.position_x = bench_rng_range(&rng, 0.0f, 4000.0f);
+        st->state_vector.position_y = bench_rng_range(&rng, -500.0f, 500.0f);
+        st->state_vector.position_z = bench_rng_range(&rng, -500.0f, 500.0f);
+        st->servo_deflection.timestamp = st->state_vector.timestamp;
+        st->servo_deflection.servo_deflection_1 = bench_rng_range(&rng, -15.0f, 15.0f);
+        st->servo_deflection.servo_deflection_2 = bench_rng_range(&rng, -15.0f, 15.0f);
+        st->servo_deflection.servo_deflection_3 = bench_rng_range(&rng, -15.0f, 15.0f);
+        st->servo_deflection.servo_deflection_4 = bench_rng_range(&rng, -15.0f, 15.0f);
+        st->rocket_state.timestamp = st->state_vector.timestamp;
+        st->rocket_state.rocket_state = 3;
+        st->sensor_data.timestamp = st->state_vector.timestamp;
+        st->sensor_data.accelerometer_x = bench_rng_range(&rng, -20.0f, 80.0f);
+        st->sensor_data.accelerometer_y = bench_rng_range(&rng, -2.0f, 2.0f);
+        st->sensor_data.accelerometer_z = bench_rng_range(&rng, -2.0f, 2.0f);
+        st->sensor_data.gyro_x = bench_rng_range(&rng, -1.0f, 1.0f);
+        st->sensor_data.gyro_y = bench_rng_range(&rng, -1.0f, 1.0f);
+        st->sensor_data.gyro_z = bench_rng_range(&rng, -1.0f, 1.0f);
+        st->sensor_data.gps_x = bench_rng_range(&rng, 32.98f, 33.0f);
+        st->sensor_data.gps_y = bench_rng_range(&rng, -106.98f, -106.97f);
+        st->sensor_data.gps_z = bench_rng_range(&rng, 1400.0f, 5500.0f);
+        st->analog_feedback_data.timestamp = st->state_vector.timestamp;
+        st->analog_feedback_data.current_fb_33 = 1200 + s;
+    }
+}
+
+static void bench_to_csv_line(uint64_t iterations) {
+    char line[2048];
+
+    for (uint64_t i = 0; i < iterations; i++) {
+        to_csv_line(&states[i % STATE_RING], line);
+        bench_do_not_optimize(line);
+    }
+}
+
+static void setup_controls(uint64_t seed) {
+    BenchRng rng;
+    bench_rng_seed(&rng, seed, 5);
+
+    for (int s = 0; s < STATE_RING; s++) {
+        control_times[s] = bench_rng_range(&rng, 1.0f, 12.0f);
+        control_states[s][0] = bench_rng_range(&rng, 50.0f, 300.0f);
+        control_states[s][1] = bench_rng_range(&rng, -10.0f, 10.0f);
+        control_states[s][2] = bench_rng_range(&rng, -10.0f, 10.0f);
+        for (int k = 3; k < 6; k++) {
+            control_states[s][k] = bench_rng_range(&rng, -0.5f, 0.5f);
+        }
+        for (int k = 6; k < 9; k++) {
+            control_states[s][k] = bench_rng_range(&rng, -0.05f, 0.05f);
+        }
+    }
+
+    initialize_controls(&ctrl);
+    run_controls(&ctrl, control_states[0], control_times[0]);
+}
+
+static void bench_lqr_gain_selector(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        ctrl.time_since_launch = control_times[i % STATE_RING];
+        memcpy(ctrl.x, control_states[i % STATE_RING], sizeof(ctrl.x));
+        LQR_gain_selector(&ctrl);
+    }
+    bench_do_not_optimize(ctrl.K);
+}
+
+static void bench_compute_controls(uint64_t iterations) {
+    for (uint64_t i = 0; i < iterations; i++) {
+        memcpy(ctrl.x, control_states[i % STATE_RING], sizeof(ctrl.x));
+        compute_controls(&ctrl);
+    }
+    bench_do_not_optimize(&ctrl);
+}
+
+const BenchCase bench_mainmcu_cases[] = {
+    {"generate_packet", setup_payloads, bench_generate_packet},
+    {"verify_packet", setup_payloads, bench_verify_packet},
+    {"extract_packet", setup_payloads, bench_extract_packet},
+    {"calculate_crc8_hash", setup_payloads, bench_calculate_crc8_hash},
+    {"to_csv_line", setup_states, bench_to_csv_line},
+    {"lqr_gain_selector", setup_controls, bench_lqr_gain_selector},
+    {"compute_controls", setup_controls, bench_compute_controls},
+};
+
+const size_t bench_mainmcu_case_count = sizeof(bench_mainmcu_cases) / sizeof(bench_mainmcu_cases[0]);
@@ -0,0 +1,172 @@
+/**
+ * @file main.c
+ * @brief Driver for the host microbenchmarks
+ *
+ * @details Runs every case, or those whose name contains --filter, and writes
+ *          a table, CSV or JSON. With --baseline the results are compared
+ *          against a CSV from an earlier run and the exit status is 2 if any
+ *          case got slower than --tolerance allows.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bench.h"
+
+typedef enum {
+    FORMAT_TABLE,
+    FORMAT_CSV,
+    FORMAT_JSON,
+} OutputFormat;
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --filter TEXT      only run cases whose name contains TEXT\n"
+            "  --list             list the cases and exit\n"
+            "  --seed N           input seed (default 1)\n"
+            "  --samples N        timed samples per case (default 15)\n"
+            "  --min-time MS      measuring time per case (default 300)\n"
+            "  --format FMT       table, csv or json (default table)\n"
+            "  --output FILE      write results to FILE (default stdout)\n"
+            "  --baseline FILE    compare against a CSV from --format csv\n"
+            "  --tolerance PCT    allowed slowdown against the baseline (default 5)\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    BenchOptions opts = {
+        .seed = 1,
+        .samples = 15,
+        .min_time_ms = 300.0,
+    };
+    OutputFormat format = FORMAT_TABLE;
+    const char *filter = NULL;
+    const char *output_path = NULL;
+    const char *baseline_path = NULL;
+    double tolerance = 5.0;
+    int list = 0;
+
+    static const struct option options[] = {
+        {"filter", required_argument, NULL, 'f'},
+        {"list", no_argument, NULL, 'l'},
+        {"seed", required_argument, NULL, 's'},
+        {"samples", required_argument, NULL, 'n'},
+        {"min-time", required_argument, NULL, 'm'},
+        {"format", required_argument, NULL, 'F'},
+        {"output", required_argument, NULL, 'o'},
+        {"baseline", required_argument, NULL, 'b'},
+        {"tolerance", required_argument, NULL, 't'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'f': filter = optarg; break;
+            case 'l': list = 1; break;
+            case 's': opts.seed = strtoull(optarg, NULL, 0); break;
+            case 'n': opts.samples = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'm': opts.min_time_ms = strtod(optarg, NULL); break;
+            case 'F':
+                if (strcmp(optarg, "table") == 0) {
+                    format = FORMAT_TABLE;
+                } else if (strcmp(optarg, "csv") == 0) {
+                    format = FORMAT_CSV;
+                } else if (strcmp(optarg, "json") == 0) {
+                    format = FORMAT_JSON;
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'o': output_path = optarg; break;
+            case 'b': baseline_path = optarg; break;
+            case 't': tolerance = strtod(optarg, NULL); break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (opts.samples < 1) {
+        opts.samples = 1;
+    }
+
+    const struct {
+        const BenchCase *cases;
+        size_t count;
+    } groups[] = {
+        {bench_estimator_cases, bench_estimator_case_count},
+        {bench_mainmcu_cases, bench_mainmcu_case_count},
+    };
+
+    size_t total = bench_estimator_case_count + bench_mainmcu_case_count;
+    BenchResult *results = calloc(total, sizeof(BenchResult));
+    size_t n = 0;
+
+    if (results == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    if (!list) {
+        bench_counter_open();
+    }
+
+    for (size_t g = 0; g < sizeof(groups) / sizeof(groups[0]); g++) {
+        for (size_t c = 0; c < groups[g].count; c++) {
+            const BenchCase *bench = &groups[g].cases[c];
+
+            if (filter != NULL && strstr(bench->name, filter) == NULL) {
+                continue;
+            }
+            if (list) {
+                printf("%s\n", bench->name);
+                continue;
+            }
+            bench_run_case(bench, &opts, &results[n++]);
+        }
+    }
+
+    bench_counter_close();
+    if (list) {
+        free(results);
+        return 0;
+    }
+
+    FILE *out = stdout;
+    if (output_path != NULL && strcmp(output_path, "-") != 0) {
+        out = fopen(output_path, "w");
+        if (out == NULL) {
+            perror(output_path);
+            return 1;
+        }
+    }
+
+    switch (format) {
+        case FORMAT_TABLE: bench_write_table(out, results, n); break;
+        case FORMAT_CSV: bench_write_csv(out, results, n); break;
+        case FORMAT_JSON: bench_write_json(out, results, n, &opts); break;
+    }
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    int status = 0;
+    if (baseline_path != NULL) {
+        int regressions = bench_compare_baseline(stderr, baseline_path, results, n, tolerance / 100.0);
+        if (regressions < 0) {
+            status = 1;
+        } else if (regressions > 0) {
+            fprintf(stderr, "%d regression(s) beyond %.1f%%\n", regressions, tolerance);
+            status = 2;
+        }
+    }
+
+    free(results);
+    return status;
+}
@@ -0,0 +1,62 @@
+/**
+ * @file ekf_expr.h
+ * @brief Scalar expression graph the EKF model generator works on
+ *
+ * @details Every expression is a node in one table. Nodes are hash consed:
+ *          building the same operation on the same operands twice returns
+ *          the same node, which is the common subexpression elimination.
+ *          The constructors fold constants and drop multiplications by 0 and
+ *          1 and additions of 0, so entries of a Jacobian or of a covariance
+ *          product that are structurally 0 or 1 come out as constants and
+ *          never reach the emitted code.
+ *
+ *          The two operands of a sum or a product are stored in a fixed
+ *          order, so a * b and b * a are one node; swapping them does not
+ *          change an IEEE result. Nothing is reassociated, so the emitted C
+ *          rounds exactly as a hand written evaluation of the same formulas
+ *          would.
+ */
+#ifndef __EKF_EXPR_H__
+#define __EKF_EXPR_H__
+
+#include <stdint.h>
+
+#define EXPR_MAX_NODES 65536
+#define EXPR_MAX_NAME 32
+
+typedef int32_t Expr;       // index into the node table
+
+typedef enum {
+    EXPR_CONST,
+    EXPR_SYMBOL,            // an input, emitted as its name
+    EXPR_ADD,
+    EXPR_SUB,
+    EXPR_MUL,
+    EXPR_DIV,
+    EXPR_NEG,
+} ExprOp;
+
+typedef struct {
+    uint8_t op;
+    Expr a, b;              // operands, b unused by EXPR_NEG
+    double value;           // EXPR_CONST
+    char name[EXPR_MAX_NAME];   // EXPR_SYMBOL
+} ExprNode;
+
+void expr_reset(void);
+const ExprNode *expr_node(Expr e);
+int32_t expr_count(void);
+
+Expr expr_const(double value);
+Expr expr_symbol(const char *fmt, ...) __attribute__((format(printf, 1, 2)));
+Expr expr_add(Expr a, Expr b);
+Expr expr_sub(Expr a, Expr b);
+Expr expr_mul(Expr a, Expr b);
+Expr expr_div(Expr a, Expr b);
+Expr expr_neg(Expr a);
+
+int expr_is_const(Expr e, double value);
+int expr_is_constant(Expr e);
+Expr expr_diff(Expr e, Expr wrt);
+
+#endif /* __EKF_EXPR_H__ */
@@ -0,0 +1,58 @@
+/**
+ * @file ekf_gen.h
+ * @brief Symbolic EKF models and the C kernels generated from them
+ *
+ * @details A model gives the state transition f(x, inputs) and the
+ *          measurement h(x) as expressions of the state symbols x[i] and of
+ *          named inputs. The generator differentiates them for the Jacobians
+ *          and builds, entry by entry, the covariance prediction F P F' + Q,
+ *          the gain K = P H' S^-1 through an LDL' factorization of
+ *          S = H P H' + R, and the Joseph form covariance update. Each kernel
+ *          is emitted as straight line C on fixed size row major arrays.
+ *
+ *          h must be linear, so that H is a matrix of constants and only the
+ *          state transition Jacobian F is read at run time.
+ */
+#ifndef __EKF_GEN_H__
+#define __EKF_GEN_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "ekf_expr.h"
+
+#define EKF_GEN_MAX_NX 8
+#define EKF_GEN_MAX_NZ 6
+#define EKF_GEN_MAX_INPUTS 4
+
+typedef struct {
+    const char *decl;           // C parameter, "float32_t dt"
+    const char *doc;            // its @param line without the tag, "dt Time step, s"
+} EkfInput;
+
+typedef struct {
+    const char *name;           // prefix of the kernels and files, "flight"
+    const char *brief;          // one sentence on the model for the file comment
+    int nx, nz;
+    int n_inputs;
+    EkfInput inputs[EKF_GEN_MAX_INPUTS];    // taken by f and F after x
+    Expr x[EKF_GEN_MAX_NX];     // state symbols
+    Expr f[EKF_GEN_MAX_NX];     // state transition
+    Expr h[EKF_GEN_MAX_NZ];     // measurement
+    uint8_t q_diagonal;         // only the diagonal of Q is read
+    uint8_t r_diagonal;         // only the diagonal of R is read
+} EkfModel;
+
+typedef struct {
+    const char *kernel;
+    int32_t mul, add, div;      // operations in the emitted code
+    int32_t temps;
+} EkfKernelStats;
+
+#define EKF_GEN_KERNELS 8
+
+void ekf_model_flight(EkfModel *m);
+void ekf_model_ground(EkfModel *m);
+int ekf_gen_write(const EkfModel *m, FILE *source, FILE *header, EkfKernelStats *stats);
+
+#endif /* __EKF_GEN_H__ */
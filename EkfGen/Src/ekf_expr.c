@@ -0,0 +1,232 @@
+/**
+ * @file ekf_expr.c
+ * @brief Scalar expression graph the EKF model generator works on
+ *
+ * @details The table is a fixed array with an open addressing index over it.
+ *          A model that outgrows EXPR_MAX_NODES stops the generator rather
+ *          than emitting a partial kernel.
+ */
+
+#include <stdarg.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ekf_expr.h"
+
+#define EXPR_INDEX_SIZE (2 * EXPR_MAX_NODES)    // power of two, at most half full
+
+static ExprNode nodes[EXPR_MAX_NODES];
+static int32_t node_count;
+static Expr node_index[EXPR_INDEX_SIZE];        // -1 for an empty slot
+
+static uint32_t expr_hash(const ExprNode *n) {
+    uint64_t bits;
+    uint32_t h = 2166136261u;
+
+    memcpy(&bits, &n->value, sizeof(bits));
+    uint32_t words[5] = {n->op, (uint32_t)n->a, (uint32_t)n->b, (uint32_t)bits, (uint32_t)(bits >> 32)};
+    for (int i = 0; i < 5; i++) {
+        h = (h ^ words[i]) * 16777619u;
+    }
+    for (const char *c = n->name; *c; c++) {
+        h = (h ^ (uint8_t)*c) * 16777619u;
+    }
+    return h;
+}
+
+static int expr_same(const ExprNode *x, const ExprNode *y) {
+    return x->op == y->op && x->a == y->a && x->b == y->b && memcmp(&x->value, &y->value, sizeof(double)) == 0 &&
+           strcmp(x->name, y->name) == 0;
+}
+
+// The node equal to n, added if there is none
+static Expr expr_intern(const ExprNode *n) {
+    uint32_t slot = expr_hash(n) & (EXPR_INDEX_SIZE - 1);
+
+    while (node_index[slot] >= 0) {
+        if (expr_same(&nodes[node_index[slot]], n)) {
+            return node_index[slot];
+        }
+        slot = (slot + 1) & (EXPR_INDEX_SIZE - 1);
+    }
+    if (node_count == EXPR_MAX_NODES) {
+        fprintf(stderr, "ekfgen: model needs more than %d expression nodes\n", EXPR_MAX_NODES);
+        exit(1);
+    }
+    nodes[node_count] = *n;
+    node_index[slot] = node_count;
+    return node_count++;
+}
+
+static Expr expr_make(ExprOp op, Expr a, Expr b) {
+    ExprNode n;
+
+    // a + b and a * b round the same either way round, so one order serves both
+    if ((op == EXPR_ADD || op == EXPR_MUL) && a > b) {
+        Expr swap = a;
+        a = b;
+        b = swap;
+    }
+    memset(&n, 0, sizeof(n));
+    n.op = op;
+    n.a = a;
+    n.b = b;
+    return expr_intern(&n);
+}
+
+/**
+ * @brief Empties the table, every Expr taken before is invalid afterwards
+ */
+void expr_reset(void) {
+    node_count = 0;
+    memset(node_index, 0xff, sizeof(node_index));
+}
+
+const ExprNode *expr_node(Expr e) {
+    return &nodes[e];
+}
+
+int32_t expr_count(void) {
+    return node_count;
+}
+
+Expr expr_const(double value) {
+    ExprNode n;
+
+    memset(&n, 0, sizeof(n));
+    n.op = EXPR_CONST;
+    n.value = value == 0.0 ? 0.0 : value;   // no -0
+    return expr_intern(&n);
+}
+
+/**
+ * @brief An input of a kernel
+ * @param fmt printf format of the C expression that reads it, "x[3]" or "dt"
+ * @return The same node for the same name
+ */
+Expr expr_symbol(const char *fmt, ...) {
+    ExprNode n;
+    va_list args;
+
+    memset(&n, 0, sizeof(n));
+    n.op = EXPR_SYMBOL;
+    va_start(args, fmt);
+    vsnprintf(n.name, sizeof(n.name), fmt, args);
+    va_end(args);
+    return expr_intern(&n);
+}
+
+int expr_is_const(Expr e, double value) {
+    return nodes[e].op == EXPR_CONST && nodes[e].value == value;
+}
+
+int expr_is_constant(Expr e) {
+    return nodes[e].op == EXPR_CONST;
+}
+
+Expr expr_add(Expr a, Expr b) {
+    if (expr_is_constant(a) && expr_is_constant(b)) {
+        return expr_const(nodes[a].value + nodes[b].value);
+    }
+    if (expr_is_const(a, 0.0)) {
+        return b;
+    }
+    if (expr_is_const(b, 0.0)) {
+        return a;
+    }
+    if (nodes[b].op == EXPR_NEG) {
+        return expr_sub(a, nodes[b].a);
+    }
+    return expr_make(EXPR_ADD, a, b);
+}
+
+Expr expr_sub(Expr a, Expr b) {
+    if (expr_is_constant(a) && expr_is_constant(b)) {
+        return expr_const(nodes[a].value - nodes[b].value);
+    }
+    if (expr_is_const(b, 0.0)) {
+        return a;
+    }
+    if (expr_is_const(a, 0.0)) {
+        return expr_neg(b);
+    }
+    if (a == b) {
+        return expr_const(0.0);
+    }
+    if (nodes[b].op == EXPR_NEG) {
+        return expr_add(a, nodes[b].a);
+    }
+    return expr_make(EXPR_SUB, a, b);
+}
+
+Expr expr_mul(Expr a, Expr b) {
+    if (expr_is_constant(a) && expr_is_constant(b)) {
+        return expr_const(nodes[a].value * nodes[b].value);
+    }
+    if (expr_is_const(a, 0.0) || expr_is_const(b, 0.0)) {
+        return expr_const(0.0);
+    }
+    if (expr_is_const(a, 1.0)) {
+        return b;
+    }
+    if (expr_is_const(b, 1.0)) {
+        return a;
+    }
+    if (expr_is_const(a, -1.0)) {
+        return expr_neg(b);
+    }
+    if (expr_is_const(b, -1.0)) {
+        return expr_neg(a);
+    }
+    return expr_make(EXPR_MUL, a, b);
+}
+
+Expr expr_div(Expr a, Expr b) {
+    if (expr_is_constant(a) && expr_is_constant(b) && nodes[b].value != 0.0) {
+        return expr_const(nodes[a].value / nodes[b].value);
+    }
+    if (expr_is_const(a, 0.0)) {
+        return expr_const(0.0);
+    }
+    if (expr_is_const(b, 1.0)) {
+        return a;
+    }
+    return expr_make(EXPR_DIV, a, b);
+}
+
+Expr expr_neg(Expr a) {
+    if (expr_is_constant(a)) {
+        return expr_const(-nodes[a].value);
+    }
+    if (nodes[a].op == EXPR_NEG) {
+        return nodes[a].a;
+    }
+    return expr_make(EXPR_NEG, a, 0);
+}
+
+/**
+ * @brief Partial derivative of an expression
+ * @param e Expression
+ * @param wrt Symbol to differentiate by
+ * @return The derivative, simplified by the constructors
+ */
+Expr expr_diff(Expr e, Expr wrt) {
+    const ExprNode *n = &nodes[e];
+    Expr a = n->a, b = n->b;
+
+    switch (n->op) {
+        case EXPR_CONST: return expr_const(0.0);
+        case EXPR_SYMBOL: return expr_const(e == wrt ? 1.0 : 0.0);
+        case EXPR_ADD: return expr_add(expr_diff(a, wrt), expr_diff(b, wrt));
+        case EXPR_SUB: return expr_sub(expr_diff(a, wrt), expr_diff(b, wrt));
+        case EXPR_NEG: return expr_neg(expr_diff(a, wrt));
+        case EXPR_MUL:
+            return expr_add(expr_mul(expr_diff(a, wrt), b), expr_mul(a, expr_diff(b, wrt)));
+        case EXPR_DIV: {
+            Expr num = expr_sub(expr_mul(expr_diff(a, wrt), b), expr_mul(a, expr_diff(b, wrt)));
+            return expr_div(num, expr_mul(b, b));
+        }
+        default: return expr_const(0.0);
+    }
+}
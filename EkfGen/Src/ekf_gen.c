@@ -0,0 +1,725 @@
+/**
+ * @file ekf_gen.c
+ * @brief Builds the kernels of an EKF model and emits them as C
+ *
+ * @details A kernel is a list of outputs, each an expression and the array
+ *          entries it is stored to. Emission walks the expressions from the
+ *          outputs: a node used more than once becomes a const temporary,
+ *          declared once its operands are, and a node used once is written
+ *          inline where it is used. Every output is a temporary as well and
+ *          the stores come last, so a kernel may write over its inputs.
+ *
+ *          A guard is a temporary that must be positive. Its check follows its
+ *          declaration, so nothing is divided by it and nothing is stored
+ *          when it fails.
+ */
+
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ekf_gen.h"
+
+#define KERNEL_MAX_OUTPUTS (EKF_GEN_MAX_NX * EKF_GEN_MAX_NX)
+#define KERNEL_MAX_TARGET 48
+#define KERNEL_MAX_LINE 65536
+#define DOC_WIDTH 80
+
+typedef struct {
+    Expr expr;
+    char target[KERNEL_MAX_TARGET];     // "f[0]" or "P_out[1] = P_out[7]"
+} KernelOutput;
+
+typedef struct {
+    KernelOutput out[KERNEL_MAX_OUTPUTS];
+    int n_out;
+    Expr guard[EKF_GEN_MAX_NZ];
+    int n_guard;
+} Kernel;
+
+// Per node state of the kernel being emitted
+static int32_t uses[EXPR_MAX_NODES];
+static int32_t temp_id[EXPR_MAX_NODES];
+static uint8_t reached[EXPR_MAX_NODES];
+static uint8_t is_temp[EXPR_MAX_NODES];
+static uint8_t declared[EXPR_MAX_NODES];
+static uint8_t guarded[EXPR_MAX_NODES];
+static int32_t temp_count;
+
+static char line[KERNEL_MAX_LINE];
+static size_t line_len;
+
+static void line_add(const char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    int n = vsnprintf(line + line_len, sizeof(line) - line_len, fmt, args);
+    va_end(args);
+    if (n < 0 || line_len + n >= sizeof(line)) {
+        fprintf(stderr, "ekfgen: expression longer than %d characters\n", KERNEL_MAX_LINE);
+        exit(1);
+    }
+    line_len += n;
+}
+
+static void kernel_output(Kernel *k, Expr e, const char *fmt, ...) {
+    va_list args;
+
+    if (k->n_out == KERNEL_MAX_OUTPUTS) {
+        fprintf(stderr, "ekfgen: more than %d outputs in a kernel\n", KERNEL_MAX_OUTPUTS);
+        exit(1);
+    }
+    k->out[k->n_out].expr = e;
+    va_start(args, fmt);
+    vsnprintf(k->out[k->n_out].target, KERNEL_MAX_TARGET, fmt, args);
+    va_end(args);
+    k->n_out++;
+}
+
+// Symmetric entry i, j of an n by n array, read from its upper triangle
+static Expr sym_entry(const char *array, int n, int i, int j) {
+    return i <= j ? expr_symbol("%s[%d]", array, i * n + j) : expr_symbol("%s[%d]", array, j * n + i);
+}
+
+static int is_leaf(Expr e) {
+    uint8_t op = expr_node(e)->op;
+    return op == EXPR_CONST || op == EXPR_SYMBOL;
+}
+
+static void count_uses(Expr e) {
+    const ExprNode *n = expr_node(e);
+
+    if (reached[e]) {
+        return;
+    }
+    reached[e] = 1;
+    if (is_leaf(e)) {
+        return;
+    }
+    uses[n->a]++;
+    count_uses(n->a);
+    if (n->op != EXPR_NEG) {
+        uses[n->b]++;
+        count_uses(n->b);
+    }
+}
+
+static int op_precedence(Expr e) {
+    const ExprNode *n = expr_node(e);
+
+    switch (n->op) {
+        case EXPR_CONST: return n->value < 0.0 ? 3 : 4;
+        case EXPR_SYMBOL: return 4;
+        case EXPR_ADD:
+        case EXPR_SUB: return 1;
+        case EXPR_MUL:
+        case EXPR_DIV: return 2;
+        default: return 3;
+    }
+}
+
+static void print_const(double value) {
+    char s[40];
+
+    snprintf(s, sizeof(s), "%.9g", value);
+    line_add("%s%sf", s, strpbrk(s, ".e") ? "" : ".0");
+}
+
+// Writes e into line, parenthesized so that C evaluates it in the same order
+static void print_expr(Expr e, int parent, int right, int top) {
+    const ExprNode *n = expr_node(e);
+
+    if (!top && is_temp[e]) {
+        line_add("t%d", temp_id[e]);
+        return;
+    }
+    int own = op_precedence(e);
+    int paren = own < parent || (right && own == parent && own < 4);
+    if (paren) {
+        line_add("(");
+    }
+    switch (n->op) {
+        case EXPR_CONST: print_const(n->value); break;
+        case EXPR_SYMBOL: line_add("%s", n->name); break;
+        case EXPR_NEG:
+            line_add("-");
+            print_expr(n->a, own, 1, 0);
+            break;
+        default: {
+            const char *op = n->op == EXPR_ADD ? " + " : n->op == EXPR_SUB ? " - " : n->op == EXPR_MUL ? " * " : " / ";
+            print_expr(n->a, own, 0, 0);
+            line_add("%s", op);
+            print_expr(n->b, own, 1, 0);
+            break;
+        }
+    }
+    if (paren) {
+        line_add(")");
+    }
+}
+
+// Declares the temporaries e depends on, then e itself if it is one
+static void declare(FILE *out, Expr e, const char *fail) {
+    const ExprNode *n = expr_node(e);
+
+    if (declared[e]) {
+        return;
+    }
+    declared[e] = 1;
+    if (!is_leaf(e)) {
+        declare(out, n->a, fail);
+        if (n->op != EXPR_NEG) {
+            declare(out, n->b, fail);
+        }
+    }
+    if (!is_temp[e]) {
+        return;
+    }
+    temp_id[e] = temp_count++;
+    line_len = 0;
+    print_expr(e, 0, 0, 1);
+    fprintf(out, "    const float32_t t%d = %s;\n", temp_id[e], line);
+    if (guarded[e]) {
+        fprintf(out, "    if (!(t%d > 0.0f)) {\n        return %s;\n    }\n", temp_id[e], fail);
+    }
+}
+
+/**
+ * @brief Emits the body of a kernel into a temporary file
+ * @param k Outputs and guards
+ * @param fail Status a failed guard returns, NULL for a void kernel
+ * @param stats Receives the operation counts, for the comment above the body
+ * @return The body, rewound
+ */
+static FILE *kernel_body(const Kernel *k, const char *fail, EkfKernelStats *stats) {
+    int32_t count = expr_count();
+    FILE *out = tmpfile();
+
+    if (out == NULL) {
+        perror("ekfgen");
+        exit(1);
+    }
+    memset(uses, 0, sizeof(uses[0]) * count);
+    memset(reached, 0, count);
+    memset(is_temp, 0, count);
+    memset(declared, 0, count);
+    memset(guarded, 0, count);
+    for (int i = 0; i < k->n_out; i++) {
+        count_uses(k->out[i].expr);
+    }
+    for (int i = 0; i < k->n_guard; i++) {
+        count_uses(k->guard[i]);
+    }
+
+    stats->mul = stats->add = stats->div = 0;
+    for (Expr e = 0; e < count; e++) {
+        if (!reached[e] || is_leaf(e)) {
+            continue;
+        }
+        is_temp[e] = uses[e] >= 2;
+        switch (expr_node(e)->op) {
+            case EXPR_ADD:
+            case EXPR_SUB: stats->add++; break;
+            case EXPR_MUL: stats->mul++; break;
+            case EXPR_DIV: stats->div++; break;
+            default: break;
+        }
+    }
+    for (int i = 0; i < k->n_out; i++) {
+        is_temp[k->out[i].expr] |= !expr_is_constant(k->out[i].expr);
+    }
+    for (int i = 0; i < k->n_guard; i++) {
+        is_temp[k->guard[i]] = 1;
+        guarded[k->guard[i]] = 1;
+    }
+
+    temp_count = 0;
+    for (int i = 0; i < k->n_guard; i++) {
+        declare(out, k->guard[i], fail);
+    }
+    for (int i = 0; i < k->n_out; i++) {
+        declare(out, k->out[i].expr, fail);
+    }
+    for (int i = 0; i < k->n_out; i++) {
+        line_len = 0;
+        print_expr(k->out[i].expr, 0, 0, 0);
+        fprintf(out, "    %s = %s;\n", k->out[i].target, line);
+    }
+    if (fail) {
+        fprintf(out, "    return ARM_MATH_SUCCESS;\n");
+    }
+    stats->temps = temp_count;
+    rewind(out);
+    return out;
+}
+
+// Closes the comment, then the signature and the body
+static void kernel_finish(FILE *src, FILE *hdr, FILE *body, const char *fmt, ...) {
+    char signature[512];
+    va_list args;
+
+    va_start(args, fmt);
+    vsnprintf(signature, sizeof(signature), fmt, args);
+    va_end(args);
+    fprintf(hdr, "%s;\n", signature);
+    fprintf(src, " */\n%s {\n", signature);
+    for (int c; (c = fgetc(body)) != EOF;) {
+        fputc(c, src);
+    }
+    fclose(body);
+    fprintf(src, "}\n\n");
+}
+
+// Writes text as comment lines after prefix, wrapped at DOC_WIDTH
+static void doc_wrap(FILE *out, const char *prefix, const char *indent, const char *text) {
+    int start = (int)strlen(prefix);
+    int col = fprintf(out, "%s", prefix);
+
+    while (*text) {
+        int len = (int)strcspn(text, " ");
+        if (col > start && col + 1 + len > DOC_WIDTH) {
+            fprintf(out, "\n");
+            start = (int)strlen(indent);
+            col = fprintf(out, "%s", indent);
+        } else if (col > start) {
+            col += fprintf(out, " ");
+        }
+        col += fprintf(out, "%.*s", len, text);
+        text += len;
+        text += strspn(text, " ");
+    }
+    fprintf(out, "\n");
+}
+
+static void doc_line(FILE *out, const char *prefix, const char *indent, const char *fmt, va_list args) {
+    char text[1024];
+
+    vsnprintf(text, sizeof(text), fmt, args);
+    doc_wrap(out, prefix, indent, text);
+}
+
+static void doc_brief(FILE *out, const char *fmt, ...) {
+    va_list args;
+
+    fprintf(out, "/**\n");
+    va_start(args, fmt);
+    doc_line(out, " * @brief ", " *        ", fmt, args);
+    va_end(args);
+}
+
+static void doc_param(FILE *out, const char *fmt, ...) {
+    va_list args;
+
+    va_start(args, fmt);
+    doc_line(out, " * @param ", " *        ", fmt, args);
+    va_end(args);
+}
+
+static void doc_tag(FILE *out, const char *tag, const char *fmt, ...) {
+    char prefix[32];
+    va_list args;
+
+    snprintf(prefix, sizeof(prefix), " * @%s ", tag);
+    va_start(args, fmt);
+    doc_line(out, prefix, strcmp(tag, "details") == 0 ? " *          " : " *         ", fmt, args);
+    va_end(args);
+}
+
+static void doc_inputs(FILE *out, const EkfModel *m) {
+    for (int i = 0; i < m->n_inputs; i++) {
+        doc_param(out, "%s", m->inputs[i].doc);
+    }
+}
+
+// The model's inputs as parameters, each followed by a comma
+static const char *input_decls(const EkfModel *m) {
+    static char decls[256];
+
+    decls[0] = 0;
+    for (int i = 0; i < m->n_inputs; i++) {
+        strcat(decls, m->inputs[i].decl);
+        strcat(decls, ", ");
+    }
+    return decls;
+}
+
+static const char *ops_text(const EkfKernelStats *s) {
+    static char text[128];
+    int n = snprintf(text, sizeof(text), "%d multiplications, %d additions", s->mul, s->add);
+
+    if (s->div) {
+        snprintf(text + n, sizeof(text) - n, " and %d divisions", s->div);
+    }
+    return text;
+}
+
+static const char *noise_text(uint8_t diagonal) {
+    return diagonal ? "only the diagonal is read" : "only the upper triangle is read";
+}
+
+// Jacobian of the measurement, which must be constant
+static int measurement_jacobian(const EkfModel *m, double H[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NX]) {
+    for (int i = 0; i < m->nz; i++) {
+        for (int j = 0; j < m->nx; j++) {
+            Expr d = expr_diff(m->h[i], m->x[j]);
+            if (!expr_is_constant(d)) {
+                fprintf(stderr, "ekfgen: %s measurement %d is not linear in x[%d]\n", m->name, i, j);
+                return -1;
+            }
+            H[i][j] = expr_node(d)->value;
+        }
+    }
+    return 0;
+}
+
+static Expr noise_entry(const char *array, int n, uint8_t diagonal, int i, int j) {
+    if (diagonal) {
+        return i == j ? expr_symbol("%s[%d]", array, i * n + i) : expr_const(0.0);
+    }
+    return sym_entry(array, n, i, j);
+}
+
+// U = P H' and S = H U + R, whose lower triangle mirrors the upper one
+static void innovation_covariance(const EkfModel *m, double H[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NX],
+                                  Expr U[EKF_GEN_MAX_NX][EKF_GEN_MAX_NZ], Expr S[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NZ]) {
+    for (int i = 0; i < m->nx; i++) {
+        for (int c = 0; c < m->nz; c++) {
+            Expr sum = expr_const(0.0);
+            for (int k = 0; k < m->nx; k++) {
+                sum = expr_add(sum, expr_mul(sym_entry("P", m->nx, i, k), expr_const(H[c][k])));
+            }
+            U[i][c] = sum;
+        }
+    }
+    for (int a = 0; a < m->nz; a++) {
+        for (int b = a; b < m->nz; b++) {
+            Expr sum = expr_const(0.0);
+            for (int k = 0; k < m->nx; k++) {
+                sum = expr_add(sum, expr_mul(expr_const(H[a][k]), U[k][b]));
+            }
+            S[a][b] = S[b][a] = expr_add(sum, noise_entry("R", m->nz, m->r_diagonal, a, b));
+        }
+    }
+}
+
+static void gen_transition(FILE *src, FILE *hdr, const EkfModel *m, EkfKernelStats *stats) {
+    Kernel *k = calloc(1, sizeof(Kernel));
+
+    for (int i = 0; i < m->nx; i++) {
+        kernel_output(k, m->f[i], "f[%d]", i);
+    }
+    FILE *body = kernel_body(k, NULL, stats);
+    doc_brief(src, "State transition, f = f(x)");
+    doc_param(src, "x State");
+    doc_inputs(src, m);
+    doc_param(src, "f Receives the predicted state, may be x");
+    doc_tag(src, "details", "%s.", ops_text(stats));
+    kernel_finish(src, hdr, body, "void %s_ekf_model_f(const float32_t *x, %sfloat32_t *f)", m->name, input_decls(m));
+    free(k);
+}
+
+static void gen_transition_jacobian(FILE *src, FILE *hdr, const EkfModel *m, EkfKernelStats *stats) {
+    Kernel *k = calloc(1, sizeof(Kernel));
+
+    for (int i = 0; i < m->nx; i++) {
+        for (int j = 0; j < m->nx; j++) {
+            kernel_output(k, expr_diff(m->f[i], m->x[j]), "F[%d]", i * m->nx + j);
+        }
+    }
+    FILE *body = kernel_body(k, NULL, stats);
+    doc_brief(src, "Jacobian of the state transition by the state");
+    doc_inputs(src, m);
+    doc_param(src, "F Receives all %d entries, those that are structurally 0 or 1 as constants", m->nx * m->nx);
+    doc_tag(src, "details", "%s.", ops_text(stats));
+    kernel_finish(src, hdr, body, "void %s_ekf_model_F(%sfloat32_t *F)", m->name, input_decls(m));
+    free(k);
+}
+
+static void gen_predict_covariance(FILE *src, FILE *hdr, const EkfModel *m, EkfKernelStats *stats) {
+    Kernel *k = calloc(1, sizeof(Kernel));
+    Expr F[EKF_GEN_MAX_NX][EKF_GEN_MAX_NX], FP[EKF_GEN_MAX_NX][EKF_GEN_MAX_NX];
+    const int n = m->nx;
+
+    // Only the entries of F that are not structurally constant are read
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            Expr d = expr_diff(m->f[i], m->x[j]);
+            F[i][j] = expr_is_constant(d) ? d : expr_symbol("F[%d]", i * n + j);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            Expr sum = expr_const(0.0);
+            for (int l = 0; l < n; l++) {
+                sum = expr_add(sum, expr_mul(F[i][l], sym_entry("P", n, l, j)));
+            }
+            FP[i][j] = sum;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = i; j < n; j++) {
+            Expr sum = expr_const(0.0);
+            for (int l = 0; l < n; l++) {
+                sum = expr_add(sum, expr_mul(FP[i][l], F[j][l]));
+            }
+            sum = expr_add(sum, noise_entry("Q", n, m->q_diagonal, i, j));
+            if (i == j) {
+                kernel_output(k, sum, "P_out[%d]", i * n + j);
+            } else {
+                kernel_output(k, sum, "P_out[%d] = P_out[%d]", i * n + j, j * n + i);
+            }
+        }
+    }
+    FILE *body = kernel_body(k, NULL, stats);
+    doc_brief(src, "Covariance prediction, P_out = F P F' + Q");
+    doc_param(src, "F State transition Jacobian, only the entries that are not constant are read");
+    doc_param(src, "Q Process noise, %s", noise_text(m->q_diagonal));
+    doc_param(src, "P Covariance");
+    doc_param(src, "P_out Receives the predicted covariance, may be P");
+    doc_tag(src, "details", "%s, where the dense products take %d and %d.", ops_text(stats), 2 * n * n * n,
+            2 * n * n * (n - 1) + n * n);
+    kernel_finish(src, hdr, body,
+                  "void %s_ekf_model_predict_covariance(const float32_t *F, const float32_t *Q, const float32_t *P, "
+                  "float32_t *P_out)",
+                  m->name);
+    free(k);
+}
+
+static void gen_observation(FILE *src, FILE *hdr, const EkfModel *m, double H[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NX],
+                            EkfKernelStats stats[2]) {
+    Kernel *k = calloc(1, sizeof(Kernel));
+
+    for (int i = 0; i < m->nz; i++) {
+        kernel_output(k, m->h[i], "h[%d]", i);
+    }
+    FILE *body = kernel_body(k, NULL, &stats[0]);
+    doc_brief(src, "Measurement predicted from the state, h = h(x)");
+    doc_param(src, "x State");
+    doc_param(src, "h Receives the %d measurements", m->nz);
+    kernel_finish(src, hdr, body, "void %s_ekf_model_h(const float32_t *x, float32_t *h)", m->name);
+
+    memset(k, 0, sizeof(*k));
+    for (int i = 0; i < m->nz; i++) {
+        for (int j = 0; j < m->nx; j++) {
+            kernel_output(k, expr_const(H[i][j]), "H[%d]", i * m->nx + j);
+        }
+    }
+    body = kernel_body(k, NULL, &stats[1]);
+    doc_brief(src, "Jacobian of the measurement by the state, constant");
+    doc_param(src, "H Receives all %d entries", m->nz * m->nx);
+    kernel_finish(src, hdr, body, "void %s_ekf_model_H(float32_t *H)", m->name);
+    free(k);
+}
+
+static void gen_gain(FILE *src, FILE *hdr, const EkfModel *m, double H[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NX],
+                     EkfKernelStats *stats) {
+    Kernel *k = calloc(1, sizeof(Kernel));
+    Expr U[EKF_GEN_MAX_NX][EKF_GEN_MAX_NZ], S[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NZ];
+    Expr L[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NZ], E[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NZ], M[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NZ];
+    Expr D_inv[EKF_GEN_MAX_NZ], S_inv[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NZ];
+    const int nz = m->nz;
+
+    innovation_covariance(m, H, U, S);
+
+    // S = L D L' with E = L D, each pivot checked before it is divided by
+    for (int j = 0; j < nz; j++) {
+        Expr d = S[j][j];
+        for (int c = 0; c < j; c++) {
+            d = expr_sub(d, expr_mul(E[j][c], L[j][c]));
+        }
+        k->guard[k->n_guard++] = d;
+        D_inv[j] = expr_div(expr_const(1.0), d);
+        for (int i = j + 1; i < nz; i++) {
+            Expr e = S[i][j];
+            for (int c = 0; c < j; c++) {
+                e = expr_sub(e, expr_mul(E[i][c], L[j][c]));
+            }
+            E[i][j] = e;
+            L[i][j] = expr_mul(e, D_inv[j]);
+        }
+    }
+    // S^-1 = M' D^-1 M with M = L^-1, unit lower triangular
+    for (int i = 0; i < nz; i++) {
+        M[i][i] = expr_const(1.0);
+        for (int j = i - 1; j >= 0; j--) {
+            Expr sum = L[i][j];
+            for (int c = j + 1; c < i; c++) {
+                sum = expr_add(sum, expr_mul(L[i][c], M[c][j]));
+            }
+            M[i][j] = expr_neg(sum);
+        }
+    }
+    for (int a = 0; a < nz; a++) {
+        for (int b = a; b < nz; b++) {
+            Expr sum = expr_const(0.0);
+            for (int c = b; c < nz; c++) {
+                sum = expr_add(sum, expr_mul(expr_mul(M[c][a], D_inv[c]), M[c][b]));
+            }
+            S_inv[a][b] = S_inv[b][a] = sum;
+        }
+    }
+    for (int i = 0; i < m->nx; i++) {
+        for (int b = 0; b < nz; b++) {
+            Expr sum = expr_const(0.0);
+            for (int c = 0; c < nz; c++) {
+                sum = expr_add(sum, expr_mul(U[i][c], S_inv[c][b]));
+            }
+            kernel_output(k, sum, "K[%d]", i * nz + b);
+        }
+    }
+    for (int a = 0; a < nz; a++) {
+        for (int b = a; b < nz; b++) {
+            if (a == b) {
+                kernel_output(k, S_inv[a][b], "S_inv[%d]", a * nz + b);
+            } else {
+                kernel_output(k, S_inv[a][b], "S_inv[%d] = S_inv[%d]", a * nz + b, b * nz + a);
+            }
+        }
+    }
+    FILE *body = kernel_body(k, "ARM_MATH_SINGULAR", stats);
+    doc_brief(src, "Kalman gain, K = P H' S^-1 with S = H P H' + R");
+    doc_param(src, "P Covariance");
+    doc_param(src, "R Measurement noise, %s", noise_text(m->r_diagonal));
+    doc_param(src, "K Receives the %d by %d gain", m->nx, nz);
+    doc_param(src, "S_inv Receives S^-1, for the normalized innovation squared");
+    doc_tag(src, "return", "ARM_MATH_SINGULAR if a pivot of S = L D L' is not positive, K and S_inv are then left as "
+                           "they were");
+    doc_tag(src, "details", "S^-1 is taken from the factors as M' D^-1 M with M = L^-1. %s.", ops_text(stats));
+    kernel_finish(src, hdr, body,
+                  "arm_status %s_ekf_model_gain(const float32_t *P, const float32_t *R, float32_t *K, "
+                  "float32_t *S_inv)",
+                  m->name);
+    free(k);
+}
+
+static void gen_update_state(FILE *src, FILE *hdr, const EkfModel *m, EkfKernelStats *stats) {
+    Kernel *k = calloc(1, sizeof(Kernel));
+
+    for (int i = 0; i < m->nx; i++) {
+        Expr sum = expr_const(0.0);
+        for (int c = 0; c < m->nz; c++) {
+            sum = expr_add(sum, expr_mul(expr_symbol("K[%d]", i * m->nz + c), expr_symbol("innovation[%d]", c)));
+        }
+        kernel_output(k, expr_add(m->x[i], sum), "x_out[%d]", i);
+    }
+    FILE *body = kernel_body(k, NULL, stats);
+    doc_brief(src, "State update, x_out = x + K innovation");
+    doc_param(src, "x State");
+    doc_param(src, "K Gain from %s_ekf_model_gain()", m->name);
+    doc_param(src, "innovation Measurement less h(x)");
+    doc_param(src, "x_out Receives the updated state, may be x");
+    kernel_finish(src, hdr, body,
+                  "void %s_ekf_model_update_state(const float32_t *x, const float32_t *K, const float32_t *innovation, "
+                  "float32_t *x_out)",
+                  m->name);
+    free(k);
+}
+
+static void gen_update_covariance(FILE *src, FILE *hdr, const EkfModel *m, double H[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NX],
+                                  EkfKernelStats *stats) {
+    Kernel *k = calloc(1, sizeof(Kernel));
+    Expr U[EKF_GEN_MAX_NX][EKF_GEN_MAX_NZ], S[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NZ], KS[EKF_GEN_MAX_NX][EKF_GEN_MAX_NZ];
+    const int n = m->nx, nz = m->nz;
+
+    innovation_covariance(m, H, U, S);
+    for (int i = 0; i < n; i++) {
+        for (int b = 0; b < nz; b++) {
+            Expr sum = expr_const(0.0);
+            for (int c = 0; c < nz; c++) {
+                sum = expr_add(sum, expr_mul(expr_symbol("K[%d]", i * nz + c), S[c][b]));
+            }
+            KS[i][b] = sum;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = i; j < n; j++) {
+            Expr KU = expr_const(0.0), UK = expr_const(0.0), KSK = expr_const(0.0);
+            for (int c = 0; c < nz; c++) {
+                Expr Ki = expr_symbol("K[%d]", i * nz + c), Kj = expr_symbol("K[%d]", j * nz + c);
+                KU = expr_add(KU, expr_mul(Ki, U[j][c]));
+                UK = expr_add(UK, expr_mul(U[i][c], Kj));
+                KSK = expr_add(KSK, expr_mul(KS[i][c], Kj));
+            }
+            Expr value = expr_add(expr_sub(expr_sub(sym_entry("P", n, i, j), KU), UK), KSK);
+            if (i == j) {
+                kernel_output(k, value, "P_out[%d]", i * n + j);
+            } else {
+                kernel_output(k, value, "P_out[%d] = P_out[%d]", i * n + j, j * n + i);
+            }
+        }
+    }
+    FILE *body = kernel_body(k, NULL, stats);
+    doc_brief(src, "Joseph form covariance update, P_out = (I - K H) P (I - K H)' + K R K'");
+    doc_param(src, "P Covariance the gain was formed with");
+    doc_param(src, "K Gain from %s_ekf_model_gain()", m->name);
+    doc_param(src, "R Measurement noise, %s", noise_text(m->r_diagonal));
+    doc_param(src, "P_out Receives the updated covariance, may be P");
+    doc_tag(src, "details",
+            "Expanded as P - K U' - U K' + K S K' with U = P H' and S = H U + R, so the result is symmetric by "
+            "construction. %s.",
+            ops_text(stats));
+    kernel_finish(src, hdr, body,
+                  "void %s_ekf_model_update_covariance(const float32_t *P, const float32_t *K, const float32_t *R, "
+                  "float32_t *P_out)",
+                  m->name);
+    free(k);
+}
+
+static void gen_banner(FILE *out, const EkfModel *m, const char *ext) {
+    char text[512];
+
+    fprintf(out, "/**\n * @file %s_ekf_model.%s\n", m->name, ext);
+    fprintf(out, " * @brief Unrolled kernels of the %s EKF model, generated by EkfGen\n *\n", m->name);
+    snprintf(text, sizeof(text),
+             "Do not edit, run make -C EkfGen export instead. %s Matrices are row major, covariances are read from "
+             "their upper triangle and written whole.",
+             m->brief);
+    doc_wrap(out, " * @details ", " *          ", text);
+    fprintf(out, " */\n");
+}
+
+/**
+ * @brief Generates every kernel of a model
+ * @param m Model
+ * @param source Receives <name>_ekf_model.c
+ * @param header Receives <name>_ekf_model.h
+ * @param stats Receives the counts of the EKF_GEN_KERNELS kernels
+ * @return 0, or -1 if the measurement is not linear
+ */
+int ekf_gen_write(const EkfModel *m, FILE *source, FILE *header, EkfKernelStats *stats) {
+    static const char *kernels[EKF_GEN_KERNELS] = {"f", "F", "predict_covariance", "h", "H",
+                                                   "gain", "update_state", "update_covariance"};
+    double H[EKF_GEN_MAX_NZ][EKF_GEN_MAX_NX];
+    char guard[64];
+
+    if (measurement_jacobian(m, H) != 0) {
+        return -1;
+    }
+    for (int i = 0; i < EKF_GEN_KERNELS; i++) {
+        memset(&stats[i], 0, sizeof(stats[i]));
+        stats[i].kernel = kernels[i];
+    }
+
+    snprintf(guard, sizeof(guard), "__%s_EKF_MODEL_H__", m->name);
+    for (char *c = guard; *c; c++) {
+        *c = (char)(*c >= 'a' && *c <= 'z' ? *c - 'a' + 'A' : *c);
+    }
+    gen_banner(header, m, "h");
+    fprintf(header, "#ifndef %s\n#define %s\n\n#include \"arm_math.h\"\n\n", guard, guard);
+    fprintf(header, "#define %.*s_NX %d\n", (int)strlen(guard) - 6, guard + 2, m->nx);
+    fprintf(header, "#define %.*s_NZ %d\n\n", (int)strlen(guard) - 6, guard + 2, m->nz);
+
+    gen_banner(source, m, "c");
+    fprintf(source, "\n#include \"%s_ekf_model.h\"\n\n", m->name);
+
+    gen_transition(source, header, m, &stats[0]);
+    gen_transition_jacobian(source, header, m, &stats[1]);
+    gen_predict_covariance(source, header, m, &stats[2]);
+    gen_observation(source, header, m, H, &stats[3]);
+    gen_gain(source, header, m, H, &stats[5]);
+    gen_update_state(source, header, m, &stats[6]);
+    gen_update_covariance(source, header, m, H, &stats[7]);
+
+    fprintf(header, "\n#endif /* %s */\n", guard);
+    return 0;
+}
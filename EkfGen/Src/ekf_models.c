@@ -0,0 +1,83 @@
+/**
+ * @file ekf_models.c
+ * @brief The flight and ground EKF models
+ *
+ * @details Each formula is written in the order flight_ekf.c evaluated it by
+ *          hand, so the generated f rounds the same way.
+ */
+
+#include <string.h>
+
+#include "ekf_gen.h"
+
+static void model_states(EkfModel *m) {
+    for (int i = 0; i < m->nx; i++) {
+        m->x[i] = expr_symbol("x[%d]", i);
+    }
+}
+
+/**
+ * @brief Flight EKF, x = [x, vx, y, vy, z, vz, baro bias]
+ * @param m Receives the model
+ * @details Positions are in the flat frame and velocities in the body frame.
+ *          The positions integrate the velocity turned into the flat frame by
+ *          the attitude's dcm_t, the velocities the compensated body
+ *          acceleration, and the baro bias is a random walk. GNSS measures
+ *          the three positions.
+ */
+void ekf_model_flight(EkfModel *m) {
+    Expr dcm_t[3][3], accel[3];
+
+    memset(m, 0, sizeof(*m));
+    m->name = "flight";
+    m->brief = "Flight EKF, x = [x, vx, y, vy, z, vz, baro bias] with the velocities in the body frame, "
+               "measured by the GNSS position.";
+    m->nx = 7;
+    m->nz = 3;
+    m->n_inputs = 3;
+    m->inputs[0] = (EkfInput){"const float32_t (*dcm_t)[3]", "dcm_t Body to flat frame rotation, RocketAttitude.frame.dcm_t"};
+    m->inputs[1] = (EkfInput){"const float32_t *accel", "accel Body acceleration without gravity, m/s^2"};
+    m->inputs[2] = (EkfInput){"float32_t dt", "dt Time step, s"};
+    m->q_diagonal = 1;
+    m->r_diagonal = 1;
+
+    model_states(m);
+    Expr dt = expr_symbol("dt");
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            dcm_t[i][j] = expr_symbol("dcm_t[%d][%d]", i, j);
+        }
+        accel[i] = expr_symbol("accel[%d]", i);
+    }
+
+    for (int i = 0; i < 3; i++) {
+        Expr vel_flat = expr_add(expr_add(expr_mul(dcm_t[i][0], m->x[1]), expr_mul(dcm_t[i][1], m->x[3])),
+                                 expr_mul(dcm_t[i][2], m->x[5]));
+        m->f[2 * i] = expr_add(expr_mul(vel_flat, dt), m->x[2 * i]);
+        m->f[2 * i + 1] = expr_add(expr_mul(accel[i], dt), m->x[2 * i + 1]);
+        m->h[i] = m->x[2 * i];
+    }
+    m->f[6] = m->x[6];
+}
+
+/**
+ * @brief Ground EKF, x = [x, vx, y, vy, z, vz]
+ * @param m Receives the model
+ * @details The state is held, and all six states are measured directly, as
+ *          the six measurement setup of initialize_ekf_ground().
+ */
+void ekf_model_ground(EkfModel *m) {
+    memset(m, 0, sizeof(*m));
+    m->name = "ground";
+    m->brief = "Ground EKF, x = [x, vx, y, vy, z, vz] held between updates and measured directly.";
+    m->nx = 6;
+    m->nz = 6;
+    m->q_diagonal = 1;
+    m->r_diagonal = 1;
+
+    model_states(m);
+    for (int i = 0; i < m->nx; i++) {
+        m->f[i] = m->x[i];
+        m->h[i] = m->x[i];
+    }
+}
@@ -0,0 +1,131 @@
+/**
+ * @file ekfgen.c
+ * @brief Generates the unrolled kernels of the flight and ground EKF models
+ *
+ * @details Prints the operations of every kernel and, given the firmware's
+ *          source and include directories, writes <model>_ekf_model.c and
+ *          <model>_ekf_model.h into them. Each file is written in full before
+ *          it replaces the one in place, so a failed run leaves the firmware
+ *          as it was.
+ */
+
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "ekf_gen.h"
+
+typedef void (*ModelBuilder)(EkfModel *m);
+
+static const struct {
+    const char *name;
+    ModelBuilder build;
+} models[] = {
+    {"flight", ekf_model_flight},
+    {"ground", ekf_model_ground},
+};
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --model NAME       flight or ground (default both)\n"
+            "  --source DIR       write <model>_ekf_model.c to DIR\n"
+            "  --header DIR       write <model>_ekf_model.h to DIR\n",
+            prog);
+}
+
+// Replaces path with the contents of tmp
+static int commit_file(FILE *tmp, const char *path) {
+    char staged[1024];
+
+    snprintf(staged, sizeof(staged), "%s.tmp", path);
+    FILE *out = fopen(staged, "w");
+    if (out == NULL) {
+        perror(staged);
+        return 0;
+    }
+    rewind(tmp);
+    for (int c; (c = fgetc(tmp)) != EOF;) {
+        fputc(c, out);
+    }
+    if (fclose(out) != 0 || rename(staged, path) != 0) {
+        perror(path);
+        return 0;
+    }
+    return 1;
+}
+
+static int generate(ModelBuilder build, const char *source_dir, const char *header_dir) {
+    EkfKernelStats stats[EKF_GEN_KERNELS];
+    EkfModel model;
+    FILE *source = tmpfile(), *header = tmpfile();
+    int ok = source != NULL && header != NULL;
+
+    expr_reset();
+    build(&model);
+    ok = ok && ekf_gen_write(&model, source, header, stats) == 0;
+    if (ok) {
+        printf("%s model, %d states, %d measurements, %d expression nodes\n", model.name, model.nx, model.nz,
+               expr_count());
+        printf("  %-20s %6s %6s %6s %6s\n", "kernel", "mul", "add", "div", "temps");
+        for (int i = 0; i < EKF_GEN_KERNELS; i++) {
+            printf("  %-20s %6d %6d %6d %6d\n", stats[i].kernel, stats[i].mul, stats[i].add, stats[i].div,
+                   stats[i].temps);
+        }
+    }
+    if (ok && source_dir != NULL && header_dir != NULL) {
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s_ekf_model.c", source_dir, model.name);
+        ok = commit_file(source, path);
+        snprintf(path, sizeof(path), "%s/%s_ekf_model.h", header_dir, model.name);
+        ok = ok && commit_file(header, path);
+    }
+    if (source != NULL) {
+        fclose(source);
+    }
+    if (header != NULL) {
+        fclose(header);
+    }
+    return ok;
+}
+
+int main(int argc, char **argv) {
+    const char *model = NULL, *source_dir = NULL, *header_dir = NULL;
+
+    static const struct option long_opts[] = {
+        {"model", required_argument, NULL, 'm'},
+        {"source", required_argument, NULL, 's'},
+        {"header", required_argument, NULL, 'i'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "m:s:i:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 'm': model = optarg; break;
+            case 's': source_dir = optarg; break;
+            case 'i': header_dir = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if ((source_dir == NULL) != (header_dir == NULL)) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    int found = 0, ok = 1;
+    for (size_t i = 0; i < sizeof(models) / sizeof(models[0]); i++) {
+        if (model == NULL || strcmp(model, models[i].name) == 0) {
+            found = 1;
+            ok = generate(models[i].build, source_dir, header_dir) && ok;
+        }
+    }
+    if (!found) {
+        fprintf(stderr, "unknown model %s\n", model);
+        return 1;
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,59 @@
+/**
+ * @file fault_data.h
+ * @brief Synthetic sensor windows and the integer reference of the fault model
+ *
+ * @details Each window is FAULT_WINDOW + 1 samples of one sensor in the units
+ *          fault_detector_push() takes: raw ADIS16500 counts, Pa, or m of GNSS
+ *          height. A healthy window is noise plus a pad level, a climb or a
+ *          vibration, some with a genuine step. A fault replaces the end of
+ *          the window with a held value (stuck), pins it at the end of the
+ *          range (saturated), or throws one or two samples far off (spike).
+ *          The GNSS height has no range to saturate at.
+ *
+ *          fault_quant_forward() is the fixed point arithmetic of
+ *          arm_fully_connected_q7() and arm_relu_q7() written out plainly,
+ *          for the trainer to score the model it exports and for the bench to
+ *          check the kernels against.
+ */
+#ifndef __FAULT_DATA_H__
+#define __FAULT_DATA_H__
+
+#include <stdint.h>
+
+#include "fault_detector.h"
+
+typedef enum {
+    FAULT_KIND_GYRO,
+    FAULT_KIND_ACCEL,
+    FAULT_KIND_BARO,
+    FAULT_KIND_GNSS,
+    FAULT_KINDS
+} FaultKind;
+
+typedef struct {
+    uint64_t state;
+} FaultRng;
+
+// Quantized two layer model as fault_model.h holds it
+typedef struct {
+    q7_t w1[FAULT_HIDDEN * FAULT_INPUTS];
+    q7_t b1[FAULT_HIDDEN];
+    q7_t w2[FAULT_CLASSES * FAULT_HIDDEN];
+    q7_t b2[FAULT_CLASSES];
+    uint16_t b1_shift;
+    uint16_t out1_shift;
+    uint16_t b2_shift;
+    uint16_t out2_shift;
+} FaultQuantModel;
+
+void fault_rng_seed(FaultRng *rng, uint64_t seed, uint64_t stream);
+double fault_rng_uniform(FaultRng *rng);
+double fault_rng_normal(FaultRng *rng);
+
+uint8_t fault_kind_channel(uint8_t kind);
+uint8_t fault_kind_has_class(uint8_t kind, uint8_t cls);
+void fault_window(FaultRng *rng, uint8_t kind, uint8_t cls, float32_t *window);
+void fault_quant_forward(const FaultQuantModel *model, const q7_t *input, q7_t *logits);
+uint8_t fault_argmax(const q7_t *logits);
+
+#endif /* __FAULT_DATA_H__ */
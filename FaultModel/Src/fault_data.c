@@ -0,0 +1,230 @@
+/**
+ * @file fault_data.c
+ * @brief Synthetic sensor windows and the integer reference of the fault model
+ *
+ * @details Amplitudes are drawn in units of the channel's difference step, so
+ *          the same shapes serve every sensor, and scaled to its units at the
+ *          end. The ADIS16500 and the MS5607 are rounded to their resolution,
+ *          1 count and 1 Pa, so a held value really gives zero differences
+ *          and a healthy quiet one rarely does.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "fault_data.h"
+
+#define FAULT_MAX_DRIFT 0.3         // steps per sample on the pad
+#define FAULT_SPIKE_MIN 25.0        // steps, and FAULT_SPIKE_OVER times the largest healthy difference
+#define FAULT_SPIKE_OVER 3.0
+
+typedef struct {
+    double noise_min, noise_max;    // steps, 1 sigma
+    double slope;                   // steps per sample, largest climb or turn
+    double vibration;               // steps, largest amplitude
+    double level_min, level_max;    // of the range, healthy levels
+    uint8_t quantize;               // rounded to whole units
+} FaultKindModel;
+
+static const FaultKindModel fault_kinds[FAULT_KINDS] = {
+    [FAULT_KIND_GYRO] = {0.8, 6.0, 30.0, 200.0, -0.6, 0.6, 1},
+    [FAULT_KIND_ACCEL] = {0.8, 8.0, 30.0, 200.0, -0.6, 0.6, 1},
+    [FAULT_KIND_BARO] = {0.5, 3.0, 40.0, 5.0, -0.7, 0.7, 1},
+    [FAULT_KIND_GNSS] = {0.3, 3.0, 400.0, 0.0, 0.0, 0.0, 0},
+};
+
+static uint64_t fault_splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+void fault_rng_seed(FaultRng *rng, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    rng->state = fault_splitmix64(&x);
+}
+
+// Uniform in [0, 1)
+double fault_rng_uniform(FaultRng *rng) {
+    return (fault_splitmix64(&rng->state) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Standard normal, Box-Muller
+double fault_rng_normal(FaultRng *rng) {
+    double u1 = 1.0 - fault_rng_uniform(rng);
+    double u2 = fault_rng_uniform(rng);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+static double fault_rng_range(FaultRng *rng, double lo, double hi) {
+    return lo + (hi - lo) * fault_rng_uniform(rng);
+}
+
+/**
+ * @brief FaultChannel whose scales a kind of window is drawn for
+ * @param kind FaultKind
+ * @return The first channel of that sensor
+ */
+uint8_t fault_kind_channel(uint8_t kind) {
+    switch (kind) {
+        case FAULT_KIND_GYRO: return FAULT_GYRO_X;
+        case FAULT_KIND_ACCEL: return FAULT_ACCEL_X;
+        case FAULT_KIND_BARO: return FAULT_BARO;
+        default: return FAULT_GNSS;
+    }
+}
+
+/**
+ * @brief Whether a sensor can show a class
+ * @param kind FaultKind
+ * @param cls FaultClass
+ * @return 0 for saturating the GNSS height, which has no range, 1 otherwise
+ */
+uint8_t fault_kind_has_class(uint8_t kind, uint8_t cls) {
+    return !(kind == FAULT_KIND_GNSS && cls == FAULT_SATURATED);
+}
+
+/**
+ * @brief Draws one window
+ * @param rng Random stream
+ * @param kind FaultKind
+ * @param cls FaultClass it must show, one fault_kind_has_class() allows
+ * @param window Receives FAULT_WINDOW + 1 samples, oldest first, in the units
+ *        of fault_kind_channel()
+ */
+void fault_window(FaultRng *rng, uint8_t kind, uint8_t cls, float32_t *window) {
+    const FaultKindModel *km = &fault_kinds[kind];
+    FaultChannelConfig scales[FAULT_CHANNELS];
+    double x[FAULT_WINDOW + 1];
+
+    fault_detector_default_config(scales);
+    const FaultChannelConfig *cfg = &scales[fault_kind_channel(kind)];
+
+    // Healthy signal in steps about the level, pad, climb or vibration
+    double noise = fault_rng_range(rng, km->noise_min, km->noise_max);
+    double regime = fault_rng_uniform(rng);
+    double slope = 0.0, curve = 0.0, amplitude = 0.0, freq = 0.0, phase = 0.0;
+    if (regime < 0.4) {
+        slope = fault_rng_range(rng, -FAULT_MAX_DRIFT, FAULT_MAX_DRIFT);
+    } else {
+        slope = fault_rng_range(rng, -km->slope, km->slope);
+        curve = fault_rng_range(rng, -0.05, 0.05) * km->slope;
+        if (fault_rng_uniform(rng) < 0.6) {
+            amplitude = km->vibration * pow(fault_rng_uniform(rng), 2.0);
+            freq = fault_rng_range(rng, 0.02, 0.5);
+            phase = fault_rng_range(rng, 0.0, 2.0 * M_PI);
+        }
+    }
+    for (int i = 0; i <= FAULT_WINDOW; i++) {
+        x[i] = slope * i + curve * i * i / FAULT_WINDOW + amplitude * sin(2.0 * M_PI * freq * i + phase) +
+               noise * fault_rng_normal(rng);
+    }
+    // A genuine step that stays, a kick or an ignition, now and then
+    if (cls == FAULT_OK && fault_rng_uniform(rng) < 0.15) {
+        int at = 1 + (int)(fault_rng_uniform(rng) * FAULT_WINDOW);
+        double step = fault_rng_range(rng, 20.0, 300.0) * (fault_rng_uniform(rng) < 0.5 ? -1.0 : 1.0);
+        for (int i = at; i <= FAULT_WINDOW; i++) {
+            x[i] += step;
+        }
+    }
+
+    // Into the channel's units about a level inside the range
+    double level = cfg->mid;
+    if (cfg->half_range > 0.0f) {
+        level += cfg->half_range * fault_rng_range(rng, km->level_min, km->level_max);
+    } else {
+        level += fault_rng_range(rng, -100.0, 5000.0);
+    }
+    double units[FAULT_WINDOW + 1];
+    for (int i = 0; i <= FAULT_WINDOW; i++) {
+        units[i] = level + x[i] * cfg->step;
+    }
+
+    int onset = (int)(fault_rng_uniform(rng) * (FAULT_WINDOW / 2));
+    switch (cls) {
+        case FAULT_STUCK:
+            for (int i = onset + 1; i <= FAULT_WINDOW; i++) {
+                units[i] = units[onset];
+            }
+            break;
+        case FAULT_SATURATED: {
+            double sign = fault_rng_uniform(rng) < 0.5 ? -1.0 : 1.0;
+            double rail = cfg->mid + sign * cfg->half_range * fault_rng_range(rng, 1.0, 1.02);
+            for (int i = onset; i <= FAULT_WINDOW; i++) {
+                units[i] = rail;
+            }
+            break;
+        }
+        case FAULT_SPIKE: {
+            double largest = 0.0;
+            for (int i = 0; i < FAULT_WINDOW; i++) {
+                largest = fmax(largest, fabs(x[i + 1] - x[i]));
+            }
+            int count = fault_rng_uniform(rng) < 0.7 ? 1 : 2;
+            for (int k = 0; k < count; k++) {
+                int at = 1 + (int)(fault_rng_uniform(rng) * (FAULT_WINDOW - 1));
+                double size = fmax(FAULT_SPIKE_MIN, FAULT_SPIKE_OVER * largest) * fault_rng_range(rng, 1.0, 4.0);
+                units[at] += size * cfg->step * (fault_rng_uniform(rng) < 0.5 ? -1.0 : 1.0);
+            }
+            break;
+        }
+        default:
+            break;
+    }
+
+    for (int i = 0; i <= FAULT_WINDOW; i++) {
+        double v = km->quantize ? round(units[i]) : units[i];
+        if (kind == FAULT_KIND_GYRO || kind == FAULT_KIND_ACCEL) {
+            v = fmax(INT16_MIN, fmin(INT16_MAX, v));
+        }
+        window[i] = (float32_t)v;
+    }
+}
+
+/**
+ * @brief Runs the model with plain integer arithmetic
+ * @param model Weights, biases and shifts
+ * @param input FAULT_INPUTS values
+ * @param logits Receives FAULT_CLASSES values
+ * @details Bias shifted left, rounding half of the output shift added, the
+ *          products summed in 32 bits, shifted right and saturated, as the
+ *          CMSIS-NN q7 fully connected layer without ARM_NN_TRUNCATE.
+ */
+void fault_quant_forward(const FaultQuantModel *model, const q7_t *input, q7_t *logits) {
+    q7_t hidden[FAULT_HIDDEN];
+
+    for (int i = 0; i < FAULT_HIDDEN; i++) {
+        int32_t acc = ((int32_t)model->b1[i] << model->b1_shift) + ((1 << model->out1_shift) >> 1);
+        for (int j = 0; j < FAULT_INPUTS; j++) {
+            acc += input[j] * model->w1[i * FAULT_INPUTS + j];
+        }
+        acc >>= model->out1_shift;
+        acc = acc > 127 ? 127 : acc < -128 ? -128 : acc;
+        hidden[i] = (q7_t)(acc < 0 ? 0 : acc);
+    }
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        int32_t acc = ((int32_t)model->b2[i] << model->b2_shift) + ((1 << model->out2_shift) >> 1);
+        for (int j = 0; j < FAULT_HIDDEN; j++) {
+            acc += hidden[j] * model->w2[i * FAULT_HIDDEN + j];
+        }
+        acc >>= model->out2_shift;
+        logits[i] = (q7_t)(acc > 127 ? 127 : acc < -128 ? -128 : acc);
+    }
+}
+
+/**
+ * @brief Class of a set of logits, as fault_detector_classify() picks it
+ * @param logits FAULT_CLASSES values
+ * @return Index of the largest, the first of equal ones
+ */
+uint8_t fault_argmax(const q7_t *logits) {
+    uint8_t best = 0;
+
+    for (uint8_t c = 1; c < FAULT_CLASSES; c++) {
+        if (logits[c] > logits[best]) {
+            best = c;
+        }
+    }
+    return best;
+}
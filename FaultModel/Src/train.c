@@ -0,0 +1,537 @@
+/**
+ * @file train.c
+ * @brief Trains the sensor fault model and exports it as fault_model.h
+ *
+ * @details Draws synthetic windows of every sensor and class, turns them into
+ *          network inputs with the firmware's own fault_detector_features(),
+ *          and trains the two layer network in double with Adam on the
+ *          softmax cross entropy. The inputs are the q7 features over 128, so
+ *          the trained network already sees what the int8 one will. The
+ *          ReLU is clipped where the q7 hidden layer saturates and the weights
+ *          are kept in the range of fixed q7 scales. After the first epochs
+ *          the forward pass runs on the rounded weights and hidden values, the
+ *          gradients going straight through the rounding to the double
+ *          weights, so the network learns around what q7 cannot resolve.
+ *
+ *          Every weight and bias is then rounded to q7 with a power of two
+ *          scale of its own per layer, the logits with the scale that fits all
+ *          but the most confident ones on the training set, and the shifts of
+ *          arm_fully_connected_q7() follow from those. The quantized model is
+ *          scored on held out windows with fault_quant_forward(), which must
+ *          agree bit for bit with the CMSIS-NN kernels the host estimator
+ *          library builds, before anything is written.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "fault_data.h"
+
+#define TRAIN_BATCH 64
+#define TRAIN_RATE 3e-3
+#define TRAIN_BETA1 0.9
+#define TRAIN_BETA2 0.999
+#define TRAIN_EPS 1e-8
+#define TRAIN_DECAY 0.95            // learning rate per epoch
+#define TRAIN_W1_FRAC 4             // fractional bits of the q7 weights, their range +-8
+#define TRAIN_W2_FRAC 4
+#define TRAIN_HIDDEN_FRAC 5         // fractional bits of the q7 hidden layer, its range 0 to 4
+#define TRAIN_HIDDEN_CLIP (127.0 / (1 << TRAIN_HIDDEN_FRAC))
+#define TRAIN_LOGIT_QUANTILE 0.99    // of |logit| the q7 output scale fits, the rest saturate
+#define TRAIN_FLOAT_SHARE 3         // 1 / share of the epochs before training through the rounding
+
+typedef struct {
+    double w1[FAULT_HIDDEN][FAULT_INPUTS];
+    double b1[FAULT_HIDDEN];
+    double w2[FAULT_CLASSES][FAULT_HIDDEN];
+    double b2[FAULT_CLASSES];
+} Net;
+
+#define NET_PARAMS (sizeof(Net) / sizeof(double))
+
+typedef struct {
+    q7_t (*input)[FAULT_INPUTS];
+    uint8_t *label;
+    uint8_t *kind;
+    uint32_t count;
+} Dataset;
+
+static const char *class_names[FAULT_CLASSES] = {"ok", "stuck", "saturated", "spike"};
+static const char *kind_names[FAULT_KINDS] = {"gyro", "accel", "baro", "gnss"};
+
+// Windows of every kind and every class it can show, in equal numbers
+static int dataset_build(Dataset *set, uint32_t count, uint64_t seed, uint64_t stream) {
+    FaultChannelConfig cfg[FAULT_CHANNELS];
+    FaultRng rng;
+    float32_t window[FAULT_WINDOW + 1];
+
+    set->input = malloc(count * sizeof(*set->input));
+    set->label = malloc(count);
+    set->kind = malloc(count);
+    set->count = count;
+    if (set->input == NULL || set->label == NULL || set->kind == NULL) {
+        return 0;
+    }
+    fault_detector_default_config(cfg);
+    fault_rng_seed(&rng, seed, stream);
+    for (uint32_t n = 0; n < count; n++) {
+        uint8_t kind = (uint8_t)(n % FAULT_KINDS);
+        uint8_t cls;
+        do {
+            cls = (uint8_t)(fault_rng_uniform(&rng) * FAULT_CLASSES);
+        } while (!fault_kind_has_class(kind, cls));
+        fault_window(&rng, kind, cls, window);
+        fault_detector_features(&cfg[fault_kind_channel(kind)], window, set->input[n]);
+        set->label[n] = cls;
+        set->kind[n] = kind;
+    }
+    return 1;
+}
+
+static void dataset_free(Dataset *set) {
+    free(set->input);
+    free(set->label);
+    free(set->kind);
+}
+
+static double net_relu(double h) {
+    return fmin(fmax(h, 0.0), TRAIN_HIDDEN_CLIP);
+}
+
+// Forward pass, hidden before the ReLU, rounded to its q7 scale if rounded is set
+static void net_forward(const Net *net, const q7_t *input, int rounded, double *hidden, double *logits) {
+    for (int i = 0; i < FAULT_HIDDEN; i++) {
+        double acc = net->b1[i];
+        for (int j = 0; j < FAULT_INPUTS; j++) {
+            acc += net->w1[i][j] * input[j] / 128.0;
+        }
+        hidden[i] = rounded ? ldexp(floor(ldexp(acc, TRAIN_HIDDEN_FRAC) + 0.5), -TRAIN_HIDDEN_FRAC) : acc;
+    }
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        double acc = net->b2[i];
+        for (int j = 0; j < FAULT_HIDDEN; j++) {
+            acc += net->w2[i][j] * net_relu(hidden[j]);
+        }
+        logits[i] = acc;
+    }
+}
+
+/**
+ * @brief Adds the cross entropy gradient of one sample to grad
+ * @param net Network the forward pass runs on, the rounded one if rounded is set
+ * @return Loss of the sample
+ */
+static double net_backward(const Net *net, const q7_t *input, int rounded, uint8_t label, Net *grad) {
+    double hidden[FAULT_HIDDEN], logits[FAULT_CLASSES], p[FAULT_CLASSES];
+
+    net_forward(net, input, rounded, hidden, logits);
+    double top = logits[0];
+    for (int i = 1; i < FAULT_CLASSES; i++) {
+        top = fmax(top, logits[i]);
+    }
+    double sum = 0.0;
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        p[i] = exp(logits[i] - top);
+        sum += p[i];
+    }
+    double dh[FAULT_HIDDEN] = {0};
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        double d = p[i] / sum - (i == label);
+        grad->b2[i] += d;
+        for (int j = 0; j < FAULT_HIDDEN; j++) {
+            grad->w2[i][j] += d * net_relu(hidden[j]);
+            dh[j] += d * net->w2[i][j];
+        }
+    }
+    for (int i = 0; i < FAULT_HIDDEN; i++) {
+        if (hidden[i] <= 0.0 || hidden[i] >= TRAIN_HIDDEN_CLIP) {
+            continue;
+        }
+        grad->b1[i] += dh[i];
+        for (int j = 0; j < FAULT_INPUTS; j++) {
+            grad->w1[i][j] += dh[i] * input[j] / 128.0;
+        }
+    }
+    return -log(p[label] / sum);
+}
+
+static void net_init(Net *net, FaultRng *rng) {
+    memset(net, 0, sizeof(Net));
+    for (int i = 0; i < FAULT_HIDDEN; i++) {
+        for (int j = 0; j < FAULT_INPUTS; j++) {
+            net->w1[i][j] = fault_rng_normal(rng) * sqrt(2.0 / FAULT_INPUTS);
+        }
+    }
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        for (int j = 0; j < FAULT_HIDDEN; j++) {
+            net->w2[i][j] = fault_rng_normal(rng) * sqrt(2.0 / FAULT_HIDDEN);
+        }
+    }
+}
+
+// Keeps the weights inside the range of their q7 scale
+static void net_clip(Net *net) {
+    double w1_max = 127.0 / (1 << TRAIN_W1_FRAC), w2_max = 127.0 / (1 << TRAIN_W2_FRAC);
+
+    for (int i = 0; i < FAULT_HIDDEN; i++) {
+        for (int j = 0; j < FAULT_INPUTS; j++) {
+            net->w1[i][j] = fmax(-w1_max, fmin(w1_max, net->w1[i][j]));
+        }
+    }
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        for (int j = 0; j < FAULT_HIDDEN; j++) {
+            net->w2[i][j] = fmax(-w2_max, fmin(w2_max, net->w2[i][j]));
+        }
+    }
+}
+
+// Largest n with max_abs * 2^n within q7, the fractional bits of a q7 scale
+static int frac_bits(double max_abs) {
+    if (max_abs <= 0.0) {
+        return 7;
+    }
+    return (int)floor(log2(127.0 / max_abs));
+}
+
+static q7_t to_q7(double x, int frac) {
+    return (q7_t)fmax(-128.0, fmin(127.0, round(ldexp(x, frac))));
+}
+
+// Fractional bits of q7 biases added to an accumulator with acc_frac of them
+static int bias_frac(const double *b, int n, int acc_frac) {
+    double b_max = 0.0;
+
+    for (int i = 0; i < n; i++) {
+        b_max = fmax(b_max, fabs(b[i]));
+    }
+    return frac_bits(b_max) < acc_frac ? frac_bits(b_max) : acc_frac;
+}
+
+// The network with every weight and bias rounded as net_quantize() rounds them
+static void net_round(const Net *net, Net *q) {
+    int fb1 = bias_frac(net->b1, FAULT_HIDDEN, 7 + TRAIN_W1_FRAC);
+    int fb2 = bias_frac(net->b2, FAULT_CLASSES, TRAIN_HIDDEN_FRAC + TRAIN_W2_FRAC);
+
+    for (int i = 0; i < FAULT_HIDDEN; i++) {
+        q->b1[i] = ldexp(to_q7(net->b1[i], fb1), -fb1);
+        for (int j = 0; j < FAULT_INPUTS; j++) {
+            q->w1[i][j] = ldexp(to_q7(net->w1[i][j], TRAIN_W1_FRAC), -TRAIN_W1_FRAC);
+        }
+    }
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        q->b2[i] = ldexp(to_q7(net->b2[i], fb2), -fb2);
+        for (int j = 0; j < FAULT_HIDDEN; j++) {
+            q->w2[i][j] = ldexp(to_q7(net->w2[i][j], TRAIN_W2_FRAC), -TRAIN_W2_FRAC);
+        }
+    }
+}
+
+static void net_train(Net *net, const Dataset *set, int epochs, FaultRng *rng) {
+    static Net grad, m, v, q;
+    uint32_t *order = malloc(set->count * sizeof(uint32_t));
+    double rate = TRAIN_RATE;
+    uint64_t t = 0;
+
+    memset(&m, 0, sizeof(Net));
+    memset(&v, 0, sizeof(Net));
+    for (uint32_t n = 0; n < set->count; n++) {
+        order[n] = n;
+    }
+    for (int epoch = 0; epoch < epochs; epoch++) {
+        for (uint32_t n = set->count - 1; n > 0; n--) {
+            uint32_t k = (uint32_t)(fault_rng_uniform(rng) * (n + 1));
+            uint32_t tmp = order[n];
+            order[n] = order[k];
+            order[k] = tmp;
+        }
+        int rounded = epoch >= epochs / TRAIN_FLOAT_SHARE;
+        double loss = 0.0;
+        for (uint32_t start = 0; start < set->count; start += TRAIN_BATCH) {
+            uint32_t end = start + TRAIN_BATCH < set->count ? start + TRAIN_BATCH : set->count;
+            memset(&grad, 0, sizeof(Net));
+            if (rounded) {
+                net_round(net, &q);
+            }
+            for (uint32_t n = start; n < end; n++) {
+                loss += net_backward(rounded ? &q : net, set->input[order[n]], rounded, set->label[order[n]], &grad);
+            }
+            t++;
+            double *p = (double *)net, *g = (double *)&grad, *pm = (double *)&m, *pv = (double *)&v;
+            double c1 = 1.0 - pow(TRAIN_BETA1, (double)t), c2 = 1.0 - pow(TRAIN_BETA2, (double)t);
+            for (size_t i = 0; i < NET_PARAMS; i++) {
+                double gi = g[i] / (end - start);
+                pm[i] = TRAIN_BETA1 * pm[i] + (1.0 - TRAIN_BETA1) * gi;
+                pv[i] = TRAIN_BETA2 * pv[i] + (1.0 - TRAIN_BETA2) * gi * gi;
+                p[i] -= rate * (pm[i] / c1) / (sqrt(pv[i] / c2) + TRAIN_EPS);
+            }
+            net_clip(net);
+        }
+        rate *= TRAIN_DECAY;
+        fprintf(stderr, "epoch %2d: loss %.4f\n", epoch + 1, loss / set->count);
+    }
+    free(order);
+}
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief Rounds the network to q7 with power of two scales per layer
+ * @return 0 if a shift would come out negative or out of memory
+ */
+static int net_quantize(const Net *net, const Dataset *set, FaultQuantModel *model) {
+    static Net q;
+    double *out = malloc(set->count * FAULT_CLASSES * sizeof(double));
+
+    if (out == NULL) {
+        return 0;
+    }
+    net_round(net, &q);
+    for (uint32_t n = 0; n < set->count; n++) {
+        double hidden[FAULT_HIDDEN];
+        net_forward(&q, set->input[n], 1, hidden, &out[n * FAULT_CLASSES]);
+        for (int i = 0; i < FAULT_CLASSES; i++) {
+            out[n * FAULT_CLASSES + i] = fabs(out[n * FAULT_CLASSES + i]);
+        }
+    }
+    qsort(out, set->count * FAULT_CLASSES, sizeof(double), compare_double);
+    double out_max = out[(size_t)(TRAIN_LOGIT_QUANTILE * (set->count * FAULT_CLASSES - 1))];
+    free(out);
+
+    // Input q7 over 128, 7 fractional bits
+    int fw1 = TRAIN_W1_FRAC, fh = TRAIN_HIDDEN_FRAC;
+    int acc1 = 7 + fw1;
+    int fb1 = bias_frac(net->b1, FAULT_HIDDEN, acc1);
+    int fw2 = TRAIN_W2_FRAC, fo = frac_bits(out_max);
+    int acc2 = fh + fw2;
+    int fb2 = bias_frac(net->b2, FAULT_CLASSES, acc2);
+    if (acc1 - fh < 0 || acc2 - fo < 0 || acc1 - fb1 < 0 || acc2 - fb2 < 0) {
+        return 0;
+    }
+    model->b1_shift = (uint16_t)(acc1 - fb1);
+    model->out1_shift = (uint16_t)(acc1 - fh);
+    model->b2_shift = (uint16_t)(acc2 - fb2);
+    model->out2_shift = (uint16_t)(acc2 - fo);
+
+    for (int i = 0; i < FAULT_HIDDEN; i++) {
+        model->b1[i] = to_q7(net->b1[i], fb1);
+        for (int j = 0; j < FAULT_INPUTS; j++) {
+            model->w1[i * FAULT_INPUTS + j] = to_q7(net->w1[i][j], fw1);
+        }
+    }
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        model->b2[i] = to_q7(net->b2[i], fb2);
+        for (int j = 0; j < FAULT_HIDDEN; j++) {
+            model->w2[i * FAULT_HIDDEN + j] = to_q7(net->w2[i][j], fw2);
+        }
+    }
+    return 1;
+}
+
+// The model through the CMSIS-NN kernels, as fault_detector_classify() runs it
+static void cmsis_forward(const FaultQuantModel *model, const q7_t *input, q7_t *logits) {
+    q7_t hidden[FAULT_HIDDEN];
+    q15_t buffer[FAULT_BUFFER];
+
+    arm_fully_connected_q7(input, model->w1, FAULT_INPUTS, FAULT_HIDDEN, model->b1_shift, model->out1_shift, model->b1,
+                           hidden, buffer);
+    arm_relu_q7(hidden, FAULT_HIDDEN);
+    arm_fully_connected_q7(hidden, model->w2, FAULT_HIDDEN, FAULT_CLASSES, model->b2_shift, model->out2_shift,
+                           model->b2, logits, buffer);
+}
+
+typedef struct {
+    uint32_t confusion[FAULT_CLASSES][FAULT_CLASSES];   // true, predicted
+    uint32_t kind_right[FAULT_KINDS];
+    uint32_t kind_total[FAULT_KINDS];
+    uint32_t mismatches;                                // reference against the kernels
+} Score;
+
+static double score_accuracy(const Score *s) {
+    uint32_t right = 0, total = 0;
+
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        for (int j = 0; j < FAULT_CLASSES; j++) {
+            total += s->confusion[i][j];
+            right += i == j ? s->confusion[i][j] : 0;
+        }
+    }
+    return total ? (double)right / total : 0.0;
+}
+
+static void score(const Net *net, const FaultQuantModel *model, const Dataset *set, Score *flt, Score *q7) {
+    memset(flt, 0, sizeof(Score));
+    memset(q7, 0, sizeof(Score));
+    for (uint32_t n = 0; n < set->count; n++) {
+        double hidden[FAULT_HIDDEN], logits[FAULT_CLASSES];
+        q7_t ref[FAULT_CLASSES], kernel[FAULT_CLASSES];
+        uint8_t label = set->label[n], kind = set->kind[n];
+
+        net_forward(net, set->input[n], 0, hidden, logits);
+        uint8_t best = 0;
+        for (uint8_t c = 1; c < FAULT_CLASSES; c++) {
+            best = logits[c] > logits[best] ? c : best;
+        }
+        flt->confusion[label][best]++;
+        flt->kind_right[kind] += best == label;
+        flt->kind_total[kind]++;
+
+        fault_quant_forward(model, set->input[n], ref);
+        cmsis_forward(model, set->input[n], kernel);
+        q7->mismatches += memcmp(ref, kernel, sizeof(ref)) != 0;
+        best = fault_argmax(ref);
+        q7->confusion[label][best]++;
+        q7->kind_right[kind] += best == label;
+        q7->kind_total[kind]++;
+    }
+}
+
+static void score_print(FILE *out, const char *name, const Score *s) {
+    fprintf(out, "%s accuracy %.4f\n", name, score_accuracy(s));
+    fprintf(out, "  %-10s", "true\\pred");
+    for (int j = 0; j < FAULT_CLASSES; j++) {
+        fprintf(out, " %9s", class_names[j]);
+    }
+    fprintf(out, "\n");
+    for (int i = 0; i < FAULT_CLASSES; i++) {
+        fprintf(out, "  %-10s", class_names[i]);
+        for (int j = 0; j < FAULT_CLASSES; j++) {
+            fprintf(out, " %9u", s->confusion[i][j]);
+        }
+        fprintf(out, "\n");
+    }
+    for (int k = 0; k < FAULT_KINDS; k++) {
+        fprintf(out, "  %-6s %.4f\n", kind_names[k], (double)s->kind_right[k] / s->kind_total[k]);
+    }
+}
+
+static void write_array(FILE *out, const char *name, const q7_t *data, int count, int per_line) {
+    fprintf(out, "#define %s { \\\n", name);
+    for (int i = 0; i < count; i += per_line) {
+        fprintf(out, "   ");
+        for (int j = i; j < i + per_line && j < count; j++) {
+            fprintf(out, " %d,", data[j]);
+        }
+        fprintf(out, " \\\n");
+    }
+    fprintf(out, "}\n");
+}
+
+static int write_header(const char *path, const FaultQuantModel *model, uint64_t seed, uint32_t samples, int epochs,
+                        const Score *q7, uint32_t test) {
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        return 0;
+    }
+    fprintf(out, "/**\n"
+                 " * @file fault_model.h\n"
+                 " * @brief Quantized weights of the sensor fault model, generated by FaultModel\n"
+                 " *\n"
+                 " * @details Do not edit, run make -C FaultModel export instead. Trained\n"
+                 " *          with seed %llu on %u synthetic windows for %d epochs,\n"
+                 " *          %.1f%% right on %u held out windows after quantization.\n"
+                 " *          Weights are row major, one row of inputs per output.\n"
+                 " */\n"
+                 "#ifndef __FAULT_MODEL_H__\n"
+                 "#define __FAULT_MODEL_H__\n\n",
+            (unsigned long long)seed, samples, epochs, 100.0 * score_accuracy(q7), test);
+    fprintf(out, "#define FAULT_MODEL_B1_SHIFT %u\n", model->b1_shift);
+    fprintf(out, "#define FAULT_MODEL_OUT1_SHIFT %u\n", model->out1_shift);
+    fprintf(out, "#define FAULT_MODEL_B2_SHIFT %u\n", model->b2_shift);
+    fprintf(out, "#define FAULT_MODEL_OUT2_SHIFT %u\n\n", model->out2_shift);
+    write_array(out, "FAULT_MODEL_W1", model->w1, FAULT_HIDDEN * FAULT_INPUTS, FAULT_INPUTS);
+    fprintf(out, "\n");
+    write_array(out, "FAULT_MODEL_B1", model->b1, FAULT_HIDDEN, FAULT_HIDDEN);
+    fprintf(out, "\n");
+    write_array(out, "FAULT_MODEL_W2", model->w2, FAULT_CLASSES * FAULT_HIDDEN, FAULT_HIDDEN);
+    fprintf(out, "\n");
+    write_array(out, "FAULT_MODEL_B2", model->b2, FAULT_CLASSES, FAULT_CLASSES);
+    fprintf(out, "\n#endif /* __FAULT_MODEL_H__ */\n");
+    fclose(out);
+    return 1;
+}
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --seed N           training seed (default 1)\n"
+            "  --samples N        training windows (default 100000)\n"
+            "  --test N           held out windows (default 20000)\n"
+            "  --epochs N         passes over the training windows (default 30)\n"
+            "  --output FILE      write the quantized model as a C header to FILE\n",
+            prog);
+}
+
+int main(int argc, char **argv) {
+    uint64_t seed = 1;
+    uint32_t samples = 100000, test = 20000;
+    int epochs = 30;
+    const char *output = NULL;
+
+    static const struct option long_opts[] = {
+        {"seed", required_argument, NULL, 's'},
+        {"samples", required_argument, NULL, 'n'},
+        {"test", required_argument, NULL, 't'},
+        {"epochs", required_argument, NULL, 'e'},
+        {"output", required_argument, NULL, 'o'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+    int opt;
+    while ((opt = getopt_long(argc, argv, "s:n:t:e:o:h", long_opts, NULL)) != -1) {
+        switch (opt) {
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'n': samples = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 't': test = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'e': epochs = atoi(optarg); break;
+            case 'o': output = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (samples < FAULT_KINDS || test < FAULT_KINDS || epochs < 1) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    Dataset train, held_out;
+    if (!dataset_build(&train, samples, seed, 1) || !dataset_build(&held_out, test, seed, 2)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    static Net net;
+    FaultRng rng;
+    fault_rng_seed(&rng, seed, 3);
+    net_init(&net, &rng);
+    net_train(&net, &train, epochs, &rng);
+
+    FaultQuantModel model;
+    if (!net_quantize(&net, &train, &model)) {
+        fprintf(stderr, "the network does not fit q7 with non-negative shifts\n");
+        return 1;
+    }
+
+    Score flt, q7;
+    score(&net, &model, &held_out, &flt, &q7);
+    score_print(stdout, "double", &flt);
+    score_print(stdout, "q7", &q7);
+    printf("shifts: bias %u out %u, bias %u out %u\n", model.b1_shift, model.out1_shift, model.b2_shift,
+           model.out2_shift);
+    printf("reference against CMSIS-NN: %u of %u windows differ\n", q7.mismatches, held_out.count);
+
+    int ok = q7.mismatches == 0;
+    if (ok && output != NULL) {
+        ok = write_header(output, &model, seed, samples, epochs, &q7, test);
+    }
+    dataset_free(&train);
+    dataset_free(&held_out);
+    return ok ? 0 : 1;
+}
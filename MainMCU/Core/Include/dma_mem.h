@@ -0,0 +1,31 @@
+#ifndef DMA_MEM_H
+#define DMA_MEM_H
+
+#include "stddef.h"
+#include "stdint.h"
+
+#include "port_config.h"
+
+#define DMA_POOL_SIZE   (8 * 1024)
+#define DMA_ALIGNMENT   32
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+/* RAM_D2 is marked non-cacheable by the MPU and holds every DMA buffer */
+#define DMA_NONCACHEABLE_BASE   0x30000000UL
+#define DMA_NONCACHEABLE_SIZE   (32 * 1024)
+
+#define DMA_BUFFER __attribute__((section(".dma_buffer"), aligned(DMA_ALIGNMENT)))
+#else
+/* No data cache on this part, any RAM buffer is DMA-safe */
+#define DMA_BUFFER __attribute__((aligned(DMA_ALIGNMENT)))
+#endif
+
+void dma_mem_init(void);
+
+void *dma_alloc(size_t size);
+size_t dma_pool_free(void);
+
+void dma_clean(const void *addr, size_t size);
+void dma_invalidate(void *addr, size_t size);
+
+#endif
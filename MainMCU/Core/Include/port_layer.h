@@ -9,9 +9,11 @@
 #include "task.h"
 
 #include "port_config.h"
+#include "dma_mem.h"
 
 #include "periph_io.h"
 #include "state_est_rx.h"
+#include "state_event.h"
 #include "state_tx.h"
 #include "state_flash.h"
 #include "telemetry.h"
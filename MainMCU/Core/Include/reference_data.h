@@ -82,6 +82,6 @@ const ReferenceState ref_state_data[] = {
     { 6.0, { 87.377200, 0, 0, 0, 0, 0, 0, 0, 0 } },
 };
 
-const int num_ref_state_entries = 14;
+const int num_ref_state_entries = sizeof(ref_state_data) / sizeof(ref_state_data[0]);
 
 #endif // REFERENCE_DATA_H
\ No newline at end of file
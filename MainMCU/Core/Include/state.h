@@ -4,6 +4,41 @@
 #include "stdint.h"
 #include "protocol.h"
 
+/**
+ * Flight EKF health from the state estimation frame, kept out of the generated radio protocol.
+ * Received with the state vector, so it shares its timestamp.
+ */
+struct RocketEkfHealth {
+    float nis_avg;
+    float cov_trace;
+    uint16_t gnss_accepted;
+    uint16_t gnss_rejected;
+    uint8_t flags;
+    uint8_t gnss_r_scale;       /* largest adapted GNSS noise over its nominal value, 1/8 steps */
+    uint16_t sensor_faults;     /* two bits per sensor channel, 0 ok, 1 stuck, 2 saturated, 3 spiking */
+};
+
+/**
+ * Calibrated magnetometer field in the body frame, Gauss, kept out of the generated radio protocol
+ */
+struct RocketMagData {
+    float mag_x;
+    float mag_y;
+    float mag_z;
+};
+
+/**
+ * Summary of the latest raw IMU vibration spectrum, kept out of the generated radio protocol.
+ * Powers are mean squares in dB re 1 (m/s^2)^2 or (rad/s)^2, -128 when there is none.
+ */
+struct RocketVibration {
+    uint8_t source;         /* 0 accelerometer, 1 gyro in bit 0, spectra completed in bits 1-7 */
+    uint8_t segments;       /* averaged, 0 before the first spectrum */
+    int8_t band_db[4];      /* 10-50, 50-150, 150-400 and 400 Hz up */
+    uint8_t peak_freq[3];   /* 4 Hz steps, largest peak first */
+    int8_t peak_db[3];
+};
+
 typedef struct {
     struct RocketStateVector state_vector;
     struct RocketServoDeflection servo_deflection;
@@ -11,8 +46,14 @@ typedef struct {
     struct RocketGroundEKF ground_ekf;
     struct RocketSensorData sensor_data;
     struct RocketAnalogFeedbackData analog_feedback_data;
+    struct RocketEkfHealth ekf_health;
+    struct RocketMagData mag_data;
+    struct RocketVibration vibration;
     uint64_t launch_timestamp;
 } RocketState;
 
+/* write_to_flash() stores each state in one 256 byte page */
+_Static_assert(sizeof(RocketState) <= 256, "RocketState must fit a flash page");
+
 
 #endif
\ No newline at end of file
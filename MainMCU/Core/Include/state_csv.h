@@ -0,0 +1,17 @@
+#ifndef STATE_CSV_H
+#define STATE_CSV_H
+
+#include <stddef.h>
+
+#include "state.h"
+
+/**
+ * Formats one logged state as a CSV line for the SD card dump
+ *
+ * @param rocket_state  the state to format
+ * @param line          destination buffer, must hold the longest possible line
+ * @return              the number of characters written, including the trailing newline
+ */
+size_t to_csv_line(RocketState *rocket_state, char *line);
+
+#endif
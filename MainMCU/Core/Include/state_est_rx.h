@@ -3,7 +3,8 @@
 
 #include "stdint.h"
 
-#define STATE_ESTIMATION_BYTES 118
+#define STATE_ESTIMATION_BYTES 158
+#define STATE_EVENT_POLL_MS 10
 
 void state_est_rx_task(void *args);
 
@@ -0,0 +1,38 @@
+#ifndef STATE_EVENT_H
+#define STATE_EVENT_H
+
+#include "stdint.h"
+#include "stddef.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+/* Flight event frames from the StateEstimation MCU, as EVENT_FRAME_SYNC and EVENT_FRAME_BYTES in its data_handling.h */
+#define STATE_EVENT_SYNC 0xE5
+#define STATE_EVENT_FRAME_BYTES 16
+
+/* Sent to the state_est_rx task when an event comes in */
+#define STATE_EVENT_NOTIFICATION_BIT 0x02
+
+typedef enum {
+    STATE_EVENT_NONE,
+    STATE_EVENT_LAUNCH,
+    STATE_EVENT_BURNOUT,
+    STATE_EVENT_APOGEE,
+    STATE_EVENT_COUNT
+} StateEventId;
+
+typedef struct {
+    uint8_t id;             /* StateEventId */
+    uint8_t seq;
+    uint32_t time_us;       /* StateEstimation timeline */
+    int32_t age_us;         /* from the event to the frame being sent, negative for an apogee still ahead */
+    float value;            /* m/s^2 axial force for launch and burnout, m apogee height above the launch */
+    TickType_t tick;        /* when it happened, in ticks here */
+} StateEvent;
+
+int state_event_decode(const uint8_t *data, size_t size, StateEvent *event);
+size_t state_event_from_isr(const uint8_t *data, size_t size, BaseType_t *higher_priority_task_woken);
+int state_event_take(StateEvent *event);
+
+#endif
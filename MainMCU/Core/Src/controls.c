@@ -46,8 +46,9 @@ void LQR_gain_selector(controller *ctrl){
                 break;
             }  
         }
+        //No gains tabulated for this second, do not actuate
         for (int i = 0; i < 36; i++) {
-            ctrl->K[i] = lqr_data[best_index].gains[i];
+            ctrl->K[i] = best_index == -1 ? 0.0 : lqr_data[best_index].gains[i];
         }
     }
 }
@@ -62,7 +63,7 @@ void reference_selector(controller *ctrl){
     int t = (int)round(ctrl->time_since_launch);
     float base_x0[9] = { 0, 0, 0, 0, 0, 0, 0, 0, 0 };
 
-    if (t > 13) {
+    if (t < 0 || t >= num_ref_state_entries) {
         for (int i = 0; i < 9; i++) {
             ctrl->x0[i] = base_x0[i];
         }
@@ -211,24 +212,20 @@ void sideforce_to_vane_angle(controller *ctrl){ //TODO: UPDATE BASED ON ACTUAL S
 
     float max_sideforce = 0.05*ctrl->current_thrust; //max sideforce per vane
 
-    float yaw_force_per_vane = ctrl->forces[0]/2.0;
-    float roll_force_per_vane = ctrl->forces[1]/2.0;
+    float roll_force_per_vane = ctrl->forces[0]/2.0; //forces = [F_roll, F_yaw]
+    float yaw_force_per_vane = ctrl->forces[1]/2.0;
 
-    float yaw_vane_angle; //degrees
-    float roll_vane_angle; //degrees
+    float yaw_vane_angle = 0.0; //degrees
+    float roll_vane_angle = 0.0; //degrees
 
-    //Find vane angle for yaw
-    if (yaw_force_per_vane >= max_sideforce){
-        yaw_vane_angle = 30.0; //degrees
-    } else {
+    if (max_sideforce > 0.0) { //No thrust, no control authority
+        //Find vane angle for yaw, 30 degrees is the maximum deflection either way
         yaw_vane_angle = (yaw_force_per_vane/max_sideforce)*30.0;
-    }
+        yaw_vane_angle = fmaxf(-30.0, fminf(30.0, yaw_vane_angle));
 
-    //Find vane angle to roll
-    if (roll_force_per_vane >= max_sideforce){
-        roll_vane_angle = 30.0; //degrees - 30 degrees is the maximum deflection
-    } else {
+        //Find vane angle to roll
         roll_vane_angle = (roll_force_per_vane/max_sideforce)*30.0;
+        roll_vane_angle = fmaxf(-30.0, fminf(30.0, roll_vane_angle));
     }
 
     ctrl->vane_deflections[0] = roll_vane_angle;
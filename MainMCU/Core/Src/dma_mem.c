@@ -0,0 +1,115 @@
+#include "dma_mem.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+DMA_BUFFER static uint8_t dma_pool[DMA_POOL_SIZE];
+static size_t dma_pool_head = 0;
+
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+static int dma_is_noncacheable(const void *addr, size_t size) {
+    uint32_t start = (uint32_t) addr;
+    return start >= DMA_NONCACHEABLE_BASE && start + size <= DMA_NONCACHEABLE_BASE + DMA_NONCACHEABLE_SIZE;
+}
+#endif
+
+/**
+ * Configure the MPU and enable the instruction and data caches.
+ * RAM_D2 is mapped as normal, shareable, non-cacheable memory so DMA buffers
+ * placed there with DMA_BUFFER or dma_alloc never need cache maintenance.
+ * Must be called before HAL_Init and before any DMA transfer is started.
+ * Does nothing on parts without a cache.
+ */
+void dma_mem_init(void) {
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    MPU_Region_InitTypeDef mpu_region = {0};
+
+    HAL_MPU_Disable();
+
+    mpu_region.Enable = MPU_REGION_ENABLE;
+    mpu_region.Number = MPU_REGION_NUMBER0;
+    mpu_region.BaseAddress = DMA_NONCACHEABLE_BASE;
+    mpu_region.Size = MPU_REGION_SIZE_32KB;
+    mpu_region.SubRegionDisable = 0x00;
+    mpu_region.TypeExtField = MPU_TEX_LEVEL1;
+    mpu_region.AccessPermission = MPU_REGION_FULL_ACCESS;
+    mpu_region.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+    mpu_region.IsShareable = MPU_ACCESS_SHAREABLE;
+    mpu_region.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+    mpu_region.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&mpu_region);
+
+    HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+
+    __HAL_RCC_D2SRAM1_CLK_ENABLE();
+    __HAL_RCC_D2SRAM2_CLK_ENABLE();
+
+    SCB_EnableICache();
+    SCB_EnableDCache();
+#endif
+}
+
+/**
+ * Allocate a DMA-safe buffer from the static pool. Allocations are never
+ * freed, so this should only be used while setting up tasks and channels.
+ * @param size The number of bytes needed
+ * @return A DMA_ALIGNMENT aligned buffer, or NULL if the pool is exhausted
+ */
+void *dma_alloc(size_t size) {
+    size_t rounded = (size + DMA_ALIGNMENT - 1) & ~((size_t) DMA_ALIGNMENT - 1);
+    void *buffer = NULL;
+
+    taskENTER_CRITICAL();
+    if (size != 0 && rounded <= DMA_POOL_SIZE - dma_pool_head) {
+        buffer = &dma_pool[dma_pool_head];
+        dma_pool_head += rounded;
+    }
+    taskEXIT_CRITICAL();
+
+    return buffer;
+}
+
+/**
+ * Get the number of bytes still available to dma_alloc
+ * @return The number of free bytes in the pool
+ */
+size_t dma_pool_free(void) {
+    return DMA_POOL_SIZE - dma_pool_head;
+}
+
+/**
+ * Write back any dirty cache lines covering a buffer before DMA reads it.
+ * Safe to call on any buffer; it is a no-op for non-cacheable memory.
+ * @param addr The start of the buffer
+ * @param size The length of the buffer in bytes
+ */
+void dma_clean(const void *addr, size_t size) {
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    if (size == 0 || dma_is_noncacheable(addr, size) || !(SCB->CCR & SCB_CCR_DC_Msk)) {
+        return;
+    }
+
+    uint32_t start = (uint32_t) addr & ~(DMA_ALIGNMENT - 1U);
+    uint32_t end = ((uint32_t) addr + size + DMA_ALIGNMENT - 1U) & ~(DMA_ALIGNMENT - 1U);
+    SCB_CleanDCache_by_Addr((uint32_t *) start, (int32_t) (end - start));
+#endif
+}
+
+/**
+ * Discard the cache lines covering a buffer after DMA has written it.
+ * Cacheable buffers passed here must be DMA_ALIGNMENT aligned and padded,
+ * otherwise data sharing the first or last cache line is lost.
+ * @param addr The start of the buffer
+ * @param size The length of the buffer in bytes
+ */
+void dma_invalidate(void *addr, size_t size) {
+#if defined(__DCACHE_PRESENT) && (__DCACHE_PRESENT == 1U)
+    if (size == 0 || dma_is_noncacheable(addr, size) || !(SCB->CCR & SCB_CCR_DC_Msk)) {
+        return;
+    }
+
+    uint32_t start = (uint32_t) addr & ~(DMA_ALIGNMENT - 1U);
+    uint32_t end = ((uint32_t) addr + size + DMA_ALIGNMENT - 1U) & ~(DMA_ALIGNMENT - 1U);
+    SCB_InvalidateDCache_by_Addr((void *) start, (int32_t) (end - start));
+#endif
+}
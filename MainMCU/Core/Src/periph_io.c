@@ -24,7 +24,7 @@ int flash_load_operation(struct w25q_device w25q, IOOperation *operation, uint8_
 int flash_save_operation(struct w25q_device w25q, IOOperation *operation, uint8_t *data_buffer, size_t *bytes_saved, size_t *w25q_write_ptr, uint8_t w25q_initialized);
 int flash_reset_operation(struct w25q_device w25q, IOOperation *operation, size_t *w25q_write_ptr, uint8_t w25q_initialized);
 
-#ifndef MCU_H725ZGT6
+#ifndef USE_W25Q
 uint8_t _fake_flash_chip[15000];
 uint8_t *fake_flash_chip = _fake_flash_chip;
 #endif
@@ -253,7 +253,7 @@ void periph_io_task(void *args) {
         HAL_UART_Transmit(&debug_uart, (uint8_t *) "SD card not mounted\r\n", 21, HAL_MAX_DELAY);
     }
 
-#ifdef MCU_H725ZGT6
+#ifdef USE_W25Q
     if (w25q_init(&w25q) == W25Q_ERR_OK && w25q_erase_sector(&w25q, 0) == W25Q_ERR_OK) {
         w25q_initialized = 1;
         HAL_UART_Transmit(&debug_uart, (uint8_t *) "W25Q initialized\r\n", 18, HAL_MAX_DELAY);
@@ -284,7 +284,7 @@ void periph_io_task(void *args) {
             sd_mounted = 1;
         }
 
-#ifdef MCU_H725ZGT6
+#ifdef USE_W25Q
         if (!w25q_initialized && w25q_init(&w25q) == W25Q_ERR_OK) {
             w25q_initialized = 1;
         }
@@ -338,7 +338,7 @@ int flash_load_operation(struct w25q_device w25q, IOOperation *operation, uint8_
 
     IOChannel *channel = operation->channel;
 
-#ifdef MCU_H725ZGT6
+#ifdef USE_W25Q
     if (w25q_read_raw(&w25q, data_buffer, operation->n_bytes, operation->offset + W25Q_WRITE_START) != W25Q_ERR_OK) {
         return 0;
     }
@@ -372,7 +372,7 @@ int flash_save_operation(struct w25q_device w25q, IOOperation *operation, uint8_
 
     xStreamBufferReceive(channel->sb_handle, data_buffer, available, 0);
 
-#ifdef MCU_H725ZGT6
+#ifdef USE_W25Q
     if (w25q_write_raw(&w25q, data_buffer, available, *w25q_write_ptr) != W25Q_ERR_OK) {
         return 0;
     }
@@ -57,8 +57,8 @@ MessageBufferHandle_t g_periph_io_mb_handle;
 uint8_t periph_io_mb_storage[IO_MB_SIZE + 2];
 StaticMessageBuffer_t periph_io_mb_buff;
 
-uint8_t telemetry_uart_rx_buf[MAX_PACKET_SIZE_TELEMETRY];
-uint8_t state_uart_rx_buf[MAX_PACKET_SIZE_STATE];
+DMA_BUFFER uint8_t telemetry_uart_rx_buf[MAX_PACKET_SIZE_TELEMETRY];
+DMA_BUFFER uint8_t state_uart_rx_buf[MAX_PACKET_SIZE_STATE];
 
 uint16_t adc1_conv_ptr = 0;
 uint16_t adc2_conv_ptr = 0;
@@ -153,10 +153,16 @@ void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t size) {
     BaseType_t xHigherPriorityTaskWoken = pdFALSE;
 
     if (huart->Instance == telemetry_uart.Instance) {
+        dma_invalidate(telemetry_uart_rx_buf, size);
         xStreamBufferSendFromISR(g_telemetry_rx_sb_handle, telemetry_uart_rx_buf, size, &xHigherPriorityTaskWoken);
         HAL_UARTEx_ReceiveToIdle_IT(&telemetry_uart, telemetry_uart_rx_buf, MAX_PACKET_SIZE_TELEMETRY);
     } else if (huart->Instance == state_uart.Instance) {
-        xStreamBufferSendFromISR(g_state_rx_sb_handle, state_uart_rx_buf, size, &xHigherPriorityTaskWoken);
+        dma_invalidate(state_uart_rx_buf, size);
+        /* A flight event frame is acted on here, ahead of the state frames queued for the task */
+        size_t taken = state_event_from_isr(state_uart_rx_buf, size, &xHigherPriorityTaskWoken);
+        if (size > taken) {
+            xStreamBufferSendFromISR(g_state_rx_sb_handle, state_uart_rx_buf + taken, size - taken, &xHigherPriorityTaskWoken);
+        }
         HAL_UARTEx_ReceiveToIdle_IT(&state_uart, state_uart_rx_buf, MAX_PACKET_SIZE_STATE);
     }
 
@@ -0,0 +1,90 @@
+#include <inttypes.h>
+#include <stdio.h>
+
+#include "state_csv.h"
+
+size_t to_csv_line(RocketState *rocket_state, char *line) {
+    size_t len = 0;
+    
+    len += sprintf(line + len, "%" PRIu32 ",", (uint32_t) rocket_state->launch_timestamp);
+
+    len += sprintf(line + len, "%" PRIu32 ",", (uint32_t) (rocket_state->state_vector.timestamp));
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.velocity_x);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.velocity_y);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.velocity_z);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_w);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_x);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_y);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_z);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.position_x);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.position_y);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.position_z);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.world_x);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.world_y);
+    len += sprintf(line + len, "%f,", rocket_state->state_vector.world_z);
+
+    len += sprintf(line + len, "%" PRIu32 ",", (uint32_t) (rocket_state->servo_deflection.timestamp));
+    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_1);
+    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_2);
+    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_3);
+    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_4);
+
+    len += sprintf(line + len, "%" PRIu32 ",", (uint32_t) (rocket_state->rocket_state.timestamp));
+    len += sprintf(line + len, "%d,", rocket_state->rocket_state.rocket_state);
+    len += sprintf(line + len, "%d,", rocket_state->rocket_state.firing_channel_1);
+    len += sprintf(line + len, "%d,", rocket_state->rocket_state.firing_channel_2);
+    len += sprintf(line + len, "%d,", rocket_state->rocket_state.firing_channel_3);
+
+    len += sprintf(line + len, "%" PRIu32 ",", (uint32_t) (rocket_state->ground_ekf.timestamp));
+    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d1);
+    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d2);
+    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d3);
+    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d4);
+    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d5);
+    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d6);
+
+    len += sprintf(line + len, "%" PRIu32 ",", (uint32_t) (rocket_state->sensor_data.timestamp));
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.accelerometer_x);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.accelerometer_y);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.accelerometer_z);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gyro_x);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gyro_y);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gyro_z);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gps_x);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gps_y);
+    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gps_z);
+
+    len += sprintf(line + len, "%" PRIu32 ",", (uint32_t) (rocket_state->analog_feedback_data.timestamp));
+    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.current_fb_33);
+    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.pyro_0_cont);
+    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.pyro_1_cont);
+    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.pyro_2_cont);
+    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.pyro_channel_deploy);
+
+    len += sprintf(line + len, "%f,", rocket_state->ekf_health.nis_avg);
+    len += sprintf(line + len, "%f,", rocket_state->ekf_health.cov_trace);
+    len += sprintf(line + len, "%u,", rocket_state->ekf_health.gnss_accepted);
+    len += sprintf(line + len, "%u,", rocket_state->ekf_health.gnss_rejected);
+    len += sprintf(line + len, "%u,", rocket_state->ekf_health.flags);
+    len += sprintf(line + len, "%u,", rocket_state->ekf_health.sensor_faults);
+    len += sprintf(line + len, "%.3f,", rocket_state->ekf_health.gnss_r_scale / 8.0f);
+
+    len += sprintf(line + len, "%f,", rocket_state->mag_data.mag_x);
+    len += sprintf(line + len, "%f,", rocket_state->mag_data.mag_y);
+    len += sprintf(line + len, "%f,", rocket_state->mag_data.mag_z);
+
+    len += sprintf(line + len, "%u,", rocket_state->vibration.source & 1);
+    len += sprintf(line + len, "%u,", rocket_state->vibration.source >> 1);
+    len += sprintf(line + len, "%u,", rocket_state->vibration.segments);
+    for (int i = 0; i < 4; i++) {
+        len += sprintf(line + len, "%d,", rocket_state->vibration.band_db[i]);
+    }
+    for (int i = 0; i < 3; i++) {
+        len += sprintf(line + len, "%u,", rocket_state->vibration.peak_freq[i] * 4);
+        len += sprintf(line + len, i < 2 ? "%d," : "%d", rocket_state->vibration.peak_db[i]);
+    }
+    
+    line[len++] = '\n';
+
+    return len;
+}
@@ -10,10 +10,36 @@
 #include "globals.h"
 
 #include "run_controls.h"
+#include "state_event.h"
+
+/**
+ * Applies the flight events received since the last call to g_current_state
+ * @param launched Set on a launch, so the launched state in the next frame does not start the controls again
+ * @param drogue_parachute_deploy Set on apogee, when channel 1 is fired
+ */
+static void apply_state_events(uint8_t *launched, uint8_t *drogue_parachute_deploy) {
+    StateEvent event;
+
+    while (state_event_take(&event)) {
+        if (xSemaphoreTake(g_state_mutex_handle, portMAX_DELAY) == pdTRUE) {
+            if (event.id == STATE_EVENT_LAUNCH && *launched == 0) {
+                *launched = 1;
+                g_current_state.launch_timestamp = event.tick;
+            } else if (event.id == STATE_EVENT_APOGEE && *drogue_parachute_deploy == 0) {
+                *drogue_parachute_deploy = 1;
+                g_current_state.rocket_state.firing_channel_1 = 1;
+            }
+            xSemaphoreGive(g_state_mutex_handle);
+        }
+    }
+}
 
 /**
  * Task to receive new states and put them into the g_current_state global variable
  * @param args Unused
+ *
+ * Flight events arrive out of band, see state_event_from_isr(), and are applied within STATE_EVENT_POLL_MS however
+ * far the next state frame is.
  */
 void state_est_rx_task(void *args) {
     uint8_t _state_rx_buff[STATE_ESTIMATION_BYTES];
@@ -34,8 +60,9 @@ void state_est_rx_task(void *args) {
         /* Loop until we've received the full next state */
         
         while (bytes_read < STATE_ESTIMATION_BYTES) {
-            size_t read = xStreamBufferReceive(g_state_rx_sb_handle, state_rx_buff + bytes_read, STATE_ESTIMATION_BYTES - bytes_read, portMAX_DELAY);
+            size_t read = xStreamBufferReceive(g_state_rx_sb_handle, state_rx_buff + bytes_read, STATE_ESTIMATION_BYTES - bytes_read, pdMS_TO_TICKS(STATE_EVENT_POLL_MS));
             bytes_read += read;
+            apply_state_events(&launched, &drogue_parachute_deploy);
         }
         
 
@@ -44,7 +71,7 @@ void state_est_rx_task(void *args) {
         if (xSemaphoreTake(g_state_mutex_handle, portMAX_DELAY) == pdTRUE) {
             /* TODO: Do something here */
 
-            uint8_t *serial_buffer = state_rx_buff + 37;
+            uint8_t *serial_buffer = state_rx_buff + 49;
             uint8_t *sensors_buffer = state_rx_buff;
 
             int offset = 1;
@@ -65,6 +92,12 @@ void state_est_rx_task(void *args) {
             memcpy(&g_current_state.sensor_data.gps_y, sensors_buffer + offset, 4);
             offset += 4;
             memcpy(&g_current_state.sensor_data.gps_z, sensors_buffer + offset, 4);
+            offset += 4;
+            memcpy(&g_current_state.mag_data.mag_x, sensors_buffer + offset, 4);
+            offset += 4;
+            memcpy(&g_current_state.mag_data.mag_y, sensors_buffer + offset, 4);
+            offset += 4;
+            memcpy(&g_current_state.mag_data.mag_z, sensors_buffer + offset, 4);
             
             offset = 0;
 
@@ -108,6 +141,25 @@ void state_est_rx_task(void *args) {
             offset += 4;
             memcpy(&g_current_state.ground_ekf.pn_matrix_d6, serial_buffer + offset, 4);
             offset += 4;
+            /* Skip the time since launch */
+            offset += 4;
+            memcpy(&g_current_state.ekf_health.nis_avg, serial_buffer + offset, 4);
+            offset += 4;
+            memcpy(&g_current_state.ekf_health.cov_trace, serial_buffer + offset, 4);
+            offset += 4;
+            memcpy(&g_current_state.ekf_health.gnss_accepted, serial_buffer + offset, 2);
+            offset += 2;
+            memcpy(&g_current_state.ekf_health.gnss_rejected, serial_buffer + offset, 2);
+            offset += 2;
+            memcpy(&g_current_state.ekf_health.flags, serial_buffer + offset, 1);
+            offset += 1;
+            /* Accelerometer and gyro spectra come on alternate frames */
+            memcpy(&g_current_state.vibration, serial_buffer + offset, sizeof(struct RocketVibration));
+            offset += sizeof(struct RocketVibration);
+            memcpy(&g_current_state.ekf_health.sensor_faults, serial_buffer + offset, 2);
+            offset += 2;
+            memcpy(&g_current_state.ekf_health.gnss_r_scale, serial_buffer + offset, 1);
+            offset += 1;
 
             g_current_state.analog_feedback_data.timestamp = xTaskGetTickCount();
             g_current_state.ground_ekf.timestamp = xTaskGetTickCount();
@@ -150,6 +202,8 @@ void state_est_rx_task(void *args) {
             xSemaphoreGive(g_state_mutex_handle);
         }
 
-        vTaskDelay(100);
+        /* An event frame cuts the wait short */
+        xTaskNotifyWait(0, STATE_EVENT_NOTIFICATION_BIT, NULL, 100);
+        apply_state_events(&launched, &drogue_parachute_deploy);
     }
 }
\ No newline at end of file
@@ -0,0 +1,91 @@
+#include "state_event.h"
+
+#include "string.h"
+
+#include "crc_hash.h"
+#include "globals.h"
+#include "run_controls.h"
+
+/* Latest event of each kind, written by the UART interrupt and taken by the state_est_rx task */
+static StateEvent events[STATE_EVENT_COUNT];
+static volatile uint8_t events_pending;
+
+/**
+ * Decodes a flight event frame
+ * @param data Received bytes, the frame must start at the first
+ * @param size Number of bytes
+ * @param event Filled in if the frame is valid, tick is left alone
+ * @return 1 if data starts with a whole event frame with a valid CRC, 0 otherwise
+ */
+int state_event_decode(const uint8_t *data, size_t size, StateEvent *event) {
+    if (size < STATE_EVENT_FRAME_BYTES || data[0] != STATE_EVENT_SYNC) {
+        return 0;
+    }
+    if (!verify_crc8_hash(data, STATE_EVENT_FRAME_BYTES) || data[1] == STATE_EVENT_NONE || data[1] >= STATE_EVENT_COUNT) {
+        return 0;
+    }
+
+    event->id = data[1];
+    event->seq = data[2];
+    memcpy(&event->time_us, data + 3, 4);
+    memcpy(&event->age_us, data + 7, 4);
+    memcpy(&event->value, data + 11, 4);
+    return 1;
+}
+
+/**
+ * Acts on a flight event frame as soon as it is received
+ * @param data Bytes from one idle event on the state UART
+ * @param size Number of bytes
+ * @param higher_priority_task_woken Passed to the FromISR calls
+ * @return Bytes taken up by the frame, 0 if data does not start with one and all of it belongs to the state stream
+ *
+ * A launch starts the controls straight from here. Every event is kept for state_est_rx_task(), which is woken to
+ * apply it to g_current_state under the mutex.
+ */
+size_t state_event_from_isr(const uint8_t *data, size_t size, BaseType_t *higher_priority_task_woken) {
+    StateEvent event;
+
+    if (!state_event_decode(data, size, &event)) {
+        return 0;
+    }
+
+    TickType_t now = xTaskGetTickCountFromISR();
+    if (event.age_us >= 0) {
+        event.tick = now - pdMS_TO_TICKS((uint32_t) event.age_us / 1000);
+    } else {
+        event.tick = now + pdMS_TO_TICKS((uint32_t) -event.age_us / 1000);
+    }
+
+    events[event.id] = event;
+    events_pending |= 1 << event.id;
+
+    if (event.id == STATE_EVENT_LAUNCH) {
+        xTaskNotifyFromISR(g_run_controls_task_handle, BEGIN_CONTROLS_NOTIFICATION_BIT, eSetBits, higher_priority_task_woken);
+    }
+    xTaskNotifyFromISR(g_state_est_rx_task_handle, STATE_EVENT_NOTIFICATION_BIT, eSetBits, higher_priority_task_woken);
+
+    return STATE_EVENT_FRAME_BYTES;
+}
+
+/**
+ * Takes the next event not yet taken
+ * @param event Receives it
+ * @return 1 if there was one, 0 otherwise
+ */
+int state_event_take(StateEvent *event) {
+    int taken = 0;
+
+    taskENTER_CRITICAL();
+    for (uint8_t id = STATE_EVENT_LAUNCH; id < STATE_EVENT_COUNT; id++) {
+        if (events_pending & (1 << id)) {
+            *event = events[id];
+            events_pending &= ~(1 << id);
+            taken = 1;
+            break;
+        }
+    }
+    taskEXIT_CRITICAL();
+
+    return taken;
+}
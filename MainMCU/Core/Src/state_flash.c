@@ -1,11 +1,11 @@
 #include "state_flash.h"
+#include "state_csv.h"
 
 int flash_test(void);
 int sd_test(void);
 
 void write_to_flash(IOChannel *flash_write_channel, RocketState *rocket_state);
 void flash_sd_card(IOChannel *flash_read_channel, IOChannel *sd_write_channel, size_t n_states);
-size_t to_csv_line(RocketState *rocket_state, char *line);
 
 void state_flash_task(void *args) {
     if (flash_test()) {
@@ -280,66 +280,3 @@ void flash_sd_card(IOChannel *flash_read_channel, IOChannel *sd_write_channel, s
 
     HAL_UART_Transmit(&debug_uart, (uint8_t *) "Wrote to SD card\r\n", 18, HAL_MAX_DELAY);
 }
-
-size_t to_csv_line(RocketState *rocket_state, char *line) {
-    size_t len = 0;
-    
-    len += sprintf(line + len, "%lu,", (uint32_t) rocket_state->launch_timestamp);
-
-    len += sprintf(line + len, "%lu,", (uint32_t) (rocket_state->state_vector.timestamp));
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.velocity_x);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.velocity_y);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.velocity_z);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_w);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_x);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_y);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.attitude_z);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.position_x);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.position_y);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.position_z);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.world_x);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.world_y);
-    len += sprintf(line + len, "%f,", rocket_state->state_vector.world_z);
-
-    len += sprintf(line + len, "%lu,", (uint32_t) (rocket_state->servo_deflection.timestamp));
-    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_1);
-    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_2);
-    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_3);
-    len += sprintf(line + len, "%f,", rocket_state->servo_deflection.servo_deflection_4);
-
-    len += sprintf(line + len, "%lu,", (uint32_t) (rocket_state->rocket_state.timestamp));
-    len += sprintf(line + len, "%d,", rocket_state->rocket_state.rocket_state);
-    len += sprintf(line + len, "%d,", rocket_state->rocket_state.firing_channel_1);
-    len += sprintf(line + len, "%d,", rocket_state->rocket_state.firing_channel_2);
-    len += sprintf(line + len, "%d,", rocket_state->rocket_state.firing_channel_3);
-
-    len += sprintf(line + len, "%lu,", (uint32_t) (rocket_state->ground_ekf.timestamp));
-    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d1);
-    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d2);
-    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d3);
-    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d4);
-    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d5);
-    len += sprintf(line + len, "%f,", rocket_state->ground_ekf.pn_matrix_d6);
-
-    len += sprintf(line + len, "%lu,", (uint32_t) (rocket_state->sensor_data.timestamp));
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.accelerometer_x);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.accelerometer_y);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.accelerometer_z);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gyro_x);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gyro_y);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gyro_z);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gps_x);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gps_y);
-    len += sprintf(line + len, "%f,", rocket_state->sensor_data.gps_z);
-
-    len += sprintf(line + len, "%lu,", (uint32_t) (rocket_state->analog_feedback_data.timestamp));
-    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.current_fb_33);
-    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.pyro_0_cont);
-    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.pyro_1_cont);
-    len += sprintf(line + len, "%d,", rocket_state->analog_feedback_data.pyro_2_cont);
-    len += sprintf(line + len, "%d", rocket_state->analog_feedback_data.pyro_channel_deploy);
-    
-    line[len++] = '\n';
-
-    return len;
-}
\ No newline at end of file
@@ -0,0 +1,25 @@
+#ifndef ARM_MATH_H
+#define ARM_MATH_H
+
+/*
+ * CMSIS-DSP cannot be built for the host. The shared sources only use its
+ * scalar types, which are provided here with the same definitions.
+ */
+
+#include <float.h>
+#include <math.h>
+#include <stdint.h>
+#include <string.h>
+
+typedef int8_t q7_t;
+typedef int16_t q15_t;
+typedef int32_t q31_t;
+typedef int64_t q63_t;
+typedef float float32_t;
+typedef double float64_t;
+
+#ifndef PI
+#define PI 3.14159265358979f
+#endif
+
+#endif
@@ -0,0 +1,152 @@
+#ifndef HOST_HAL_H
+#define HOST_HAL_H
+
+/*
+ * Minimal stand-in for the STM32 HAL used by MainMCU/Core on the Linux host.
+ * Only the handles and calls the shared sources use are provided. UARTs are
+ * backed by file descriptors (pty, fifo, file or stdout), ADCs return
+ * synthetic readings, and GPIO writes are ignored.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U,
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+/* GPIO */
+typedef struct {
+    uint32_t odr;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET,
+} GPIO_PinState;
+
+extern GPIO_TypeDef host_gpio_ports[8];
+
+#define GPIOA (&host_gpio_ports[0])
+#define GPIOB (&host_gpio_ports[1])
+#define GPIOC (&host_gpio_ports[2])
+#define GPIOD (&host_gpio_ports[3])
+#define GPIOE (&host_gpio_ports[4])
+#define GPIOF (&host_gpio_ports[5])
+#define GPIOG (&host_gpio_ports[6])
+#define GPIOH (&host_gpio_ports[7])
+
+#define GPIO_PIN_0  ((uint16_t) 0x0001)
+#define GPIO_PIN_1  ((uint16_t) 0x0002)
+#define GPIO_PIN_2  ((uint16_t) 0x0004)
+#define GPIO_PIN_3  ((uint16_t) 0x0008)
+#define GPIO_PIN_4  ((uint16_t) 0x0010)
+#define GPIO_PIN_5  ((uint16_t) 0x0020)
+#define GPIO_PIN_6  ((uint16_t) 0x0040)
+#define GPIO_PIN_7  ((uint16_t) 0x0080)
+#define GPIO_PIN_8  ((uint16_t) 0x0100)
+#define GPIO_PIN_9  ((uint16_t) 0x0200)
+#define GPIO_PIN_10 ((uint16_t) 0x0400)
+#define GPIO_PIN_11 ((uint16_t) 0x0800)
+#define GPIO_PIN_12 ((uint16_t) 0x1000)
+#define GPIO_PIN_13 ((uint16_t) 0x2000)
+#define GPIO_PIN_14 ((uint16_t) 0x4000)
+#define GPIO_PIN_15 ((uint16_t) 0x8000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+
+/* UART */
+typedef struct {
+    const char *name;
+} USART_TypeDef;
+
+extern USART_TypeDef host_usart_instances[6];
+
+#define USART1 (&host_usart_instances[0])
+#define USART2 (&host_usart_instances[1])
+#define USART3 (&host_usart_instances[2])
+#define UART4  (&host_usart_instances[3])
+#define UART5  (&host_usart_instances[4])
+#define USART6 (&host_usart_instances[5])
+
+typedef struct {
+    uint32_t BaudRate;
+} UART_InitTypeDef;
+
+typedef struct __UART_HandleTypeDef {
+    USART_TypeDef *Instance;
+    UART_InitTypeDef Init;
+
+    /* Host backing */
+    int fd_rx;
+    int fd_tx;
+
+    /* Receive-to-idle state shared between the RX thread and the "ISR" */
+    uint8_t *rx_buf;
+    uint16_t rx_size;
+    uint16_t rx_count;
+    volatile int rx_armed;
+    volatile int rx_event;
+
+    /* Statistics */
+    volatile uint64_t tx_bytes;
+    volatile uint64_t tx_dropped;
+    volatile uint64_t rx_bytes;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t size);
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+
+/* SPI, only referenced through globals.h */
+typedef struct {
+    void *Instance;
+} SPI_HandleTypeDef;
+
+/* ADC */
+typedef struct {
+    const char *name;
+} ADC_TypeDef;
+
+extern ADC_TypeDef host_adc_instances[3];
+
+#define ADC1 (&host_adc_instances[0])
+#define ADC2 (&host_adc_instances[1])
+#define ADC3 (&host_adc_instances[2])
+
+typedef struct {
+    ADC_TypeDef *Instance;
+
+    /* Host backing */
+    uint32_t n_conversions;
+    uint32_t value;
+    volatile uint32_t pending;
+} ADC_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc);
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc);
+void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc);
+
+/* System */
+HAL_StatusTypeDef HAL_Init(void);
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+
+/* Host configuration */
+int host_uart_open(UART_HandleTypeDef *huart, USART_TypeDef *instance, uint32_t baud, const char *spec);
+void host_adc_register(ADC_HandleTypeDef *hadc, ADC_TypeDef *instance, uint32_t n_conversions);
+void host_hal_start(void);
+void host_hal_print_stats(FILE *out);
+
+#endif
@@ -0,0 +1,15 @@
+#ifndef MAIN_H
+#define MAIN_H
+
+#include "host_hal.h"
+
+#include <string.h>
+
+void Error_Handler(void);
+
+#define FLASH_CS_Pin GPIO_PIN_6
+#define FLASH_CS_GPIO_Port GPIOG
+#define SD_CS_Pin GPIO_PIN_10
+#define SD_CS_GPIO_Port GPIOG
+
+#endif
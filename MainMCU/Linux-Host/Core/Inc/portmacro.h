@@ -0,0 +1,103 @@
+#ifndef PORTMACRO_H
+#define PORTMACRO_H
+
+/*
+ * FreeRTOS port for running the MainMCU firmware as a Linux process.
+ *
+ * Every task is backed by a pthread and exactly one of them is allowed to run
+ * at a time. The tick and simulated peripheral interrupts are delivered as
+ * SIGALRM to the thread of the running task, and "disabling interrupts" blocks
+ * that signal, so critical sections behave like they do on the Cortex-M port.
+ */
+
+#include <limits.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Type definitions */
+#define portCHAR            char
+#define portFLOAT           float
+#define portDOUBLE          double
+#define portLONG            long
+#define portSHORT           short
+#define portSTACK_TYPE      unsigned long
+#define portBASE_TYPE       long
+#define portPOINTER_SIZE_TYPE uintptr_t
+
+typedef portSTACK_TYPE StackType_t;
+typedef long BaseType_t;
+typedef unsigned long UBaseType_t;
+
+#if (configTICK_TYPE_WIDTH_IN_BITS == TICK_TYPE_WIDTH_16_BITS)
+typedef uint16_t TickType_t;
+#define portMAX_DELAY (TickType_t) 0xffff
+#elif (configTICK_TYPE_WIDTH_IN_BITS == TICK_TYPE_WIDTH_32_BITS)
+typedef uint32_t TickType_t;
+#define portMAX_DELAY (TickType_t) 0xffffffffUL
+/* 32-bit tick type on a 64-bit host, so reads are atomic */
+#define portTICK_TYPE_IS_ATOMIC 1
+#else
+#error configTICK_TYPE_WIDTH_IN_BITS set to unsupported tick type width.
+#endif
+
+/* Architecture specifics */
+#define portSTACK_GROWTH                (-1)
+#define portHAS_STACK_OVERFLOW_CHECKING 1
+#define portTICK_PERIOD_MS              ((TickType_t) 1000 / configTICK_RATE_HZ)
+#define portTICK_USECS                  (1000000UL / configTICK_RATE_HZ)
+#define portBYTE_ALIGNMENT              8
+#define portNOP()                       __asm volatile("nop")
+#define portMEMORY_BARRIER()            __sync_synchronize()
+
+/* Scheduler utilities */
+extern void vPortYield(void);
+extern void vPortYieldFromISR(void);
+
+#define portYIELD()                         vPortYield()
+#define portEND_SWITCHING_ISR(xSwitchRequired) \
+    do {                                       \
+        if (xSwitchRequired) {                 \
+            vPortYieldFromISR();               \
+        }                                      \
+    } while (0)
+#define portYIELD_FROM_ISR(x)               portEND_SWITCHING_ISR(x)
+
+/* Critical section management */
+extern void vPortDisableInterrupts(void);
+extern void vPortEnableInterrupts(void);
+extern UBaseType_t xPortSetInterruptMask(void);
+extern void vPortClearInterruptMask(UBaseType_t uxMask);
+extern void vPortEnterCritical(void);
+extern void vPortExitCritical(void);
+
+#define portSET_INTERRUPT_MASK_FROM_ISR()       xPortSetInterruptMask()
+#define portCLEAR_INTERRUPT_MASK_FROM_ISR(x)    vPortClearInterruptMask(x)
+#define portDISABLE_INTERRUPTS()                vPortDisableInterrupts()
+#define portENABLE_INTERRUPTS()                 vPortEnableInterrupts()
+#define portENTER_CRITICAL()                    vPortEnterCritical()
+#define portEXIT_CRITICAL()                     vPortExitCritical()
+
+/* Task deletion */
+extern void vPortThreadDying(void *pxTaskToDelete, volatile BaseType_t *pxPendYield);
+extern void vPortCancelThread(void *pxTaskToDelete);
+
+#define portPRE_TASK_DELETE_HOOK(pvTaskToDelete, pxPendYield) vPortThreadDying((pvTaskToDelete), (pxPendYield))
+#define portCLEAN_UP_TCB(pxTCB)                               vPortCancelThread(pxTCB)
+
+/* Task function macros */
+#define portTASK_FUNCTION_PROTO(vFunction, pvParameters) void vFunction(void *pvParameters)
+#define portTASK_FUNCTION(vFunction, pvParameters)       void vFunction(void *pvParameters)
+
+/* Simulated peripheral interrupts, see port.c */
+extern void vPortGenerateSimulatedInterrupt(void);
+extern void vPortSetTickScale(uint32_t ulScale);
+extern void vHostServiceInterrupts(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
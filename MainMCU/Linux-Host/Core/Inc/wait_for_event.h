@@ -0,0 +1,13 @@
+#ifndef WAIT_FOR_EVENT_H
+#define WAIT_FOR_EVENT_H
+
+#include <stdbool.h>
+
+struct event;
+
+struct event *event_create(void);
+void event_delete(struct event *ev);
+bool event_wait(struct event *ev);
+void event_signal(struct event *ev);
+
+#endif
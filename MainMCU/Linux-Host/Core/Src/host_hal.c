@@ -0,0 +1,416 @@
+/*
+ * HAL emulation for the Linux host build.
+ *
+ * Each UART with a readable backing gets a receiver thread that plays the role
+ * of the peripheral: it waits for the firmware to arm a receive-to-idle
+ * transfer, reads whatever is available (an idle line on a real UART), paces
+ * it to the configured baud rate in simulated time and raises an interrupt.
+ * ADC conversions complete on the next interrupt. Interrupts are serviced by
+ * vHostServiceInterrupts() from the port's signal handler, so the firmware's
+ * HAL callbacks run exactly where they would on the MCU.
+ */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <pthread.h>
+#include <pty.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "main.h"
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#define HOST_MAX_UARTS 6
+#define HOST_MAX_ADCS  3
+
+/* Bits on the wire per byte with 8N1 framing */
+#define UART_BITS_PER_BYTE 10U
+
+GPIO_TypeDef host_gpio_ports[8];
+
+USART_TypeDef host_usart_instances[6] = {
+    {"USART1"}, {"USART2"}, {"USART3"}, {"UART4"}, {"UART5"}, {"USART6"},
+};
+
+ADC_TypeDef host_adc_instances[3] = {
+    {"ADC1"}, {"ADC2"}, {"ADC3"},
+};
+
+static UART_HandleTypeDef *uarts[HOST_MAX_UARTS];
+static size_t n_uarts = 0;
+static pthread_t uart_rx_threads[HOST_MAX_UARTS];
+
+static ADC_HandleTypeDef *adcs[HOST_MAX_ADCS];
+static size_t n_adcs = 0;
+
+static uint64_t host_ms_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000U + (uint64_t) ts.tv_nsec / 1000000U;
+}
+
+/* rand() is not safe to call from the signal handler servicing interrupts */
+static uint32_t adc_noise(void) {
+    static uint32_t state = 0x12345678U;
+
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+
+    return state & 0xFFFU;
+}
+
+static int scheduler_running(void) {
+    return xTaskGetSchedulerState() != taskSCHEDULER_NOT_STARTED;
+}
+
+/**
+ * Opens the host backing for a UART
+ * @param huart The handle to initialize
+ * @param instance The peripheral the firmware compares against in callbacks
+ * @param baud Baud rate used to pace received bytes in simulated time
+ * @param spec "null", "stdout", "pty", "in:PATH" (replay a capture),
+ *             "out:PATH" (record transmitted bytes) or "dev:PATH" (read/write
+ *             an existing fifo or tty)
+ * @return 1 if successful, 0 otherwise
+ */
+int host_uart_open(UART_HandleTypeDef *huart, USART_TypeDef *instance, uint32_t baud, const char *spec) {
+    if (huart == NULL || spec == NULL || n_uarts >= HOST_MAX_UARTS) {
+        return 0;
+    }
+
+    memset(huart, 0, sizeof(*huart));
+    huart->Instance = instance;
+    huart->Init.BaudRate = baud;
+    huart->fd_rx = -1;
+    huart->fd_tx = -1;
+
+    if (strcmp(spec, "null") == 0) {
+        /* Transmitted bytes are counted and dropped, nothing is ever received */
+    } else if (strcmp(spec, "stdout") == 0) {
+        huart->fd_tx = STDOUT_FILENO;
+    } else if (strcmp(spec, "pty") == 0) {
+        int master, slave;
+        char name[64];
+        struct termios tio;
+
+        if (openpty(&master, &slave, name, NULL, NULL) != 0) {
+            return 0;
+        }
+
+        /* Binary packets must pass through untouched */
+        tcgetattr(slave, &tio);
+        cfmakeraw(&tio);
+        tcsetattr(slave, TCSANOW, &tio);
+
+        huart->fd_rx = master;
+        huart->fd_tx = master;
+        fprintf(stderr, "%s: %s\n", instance->name, name);
+    } else if (strncmp(spec, "in:", 3) == 0) {
+        huart->fd_rx = open(spec + 3, O_RDONLY);
+        if (huart->fd_rx < 0) return 0;
+    } else if (strncmp(spec, "out:", 4) == 0) {
+        huart->fd_tx = open(spec + 4, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (huart->fd_tx < 0) return 0;
+    } else if (strncmp(spec, "dev:", 4) == 0) {
+        huart->fd_rx = open(spec + 4, O_RDWR | O_NOCTTY);
+        if (huart->fd_rx < 0) return 0;
+        huart->fd_tx = huart->fd_rx;
+    } else {
+        return 0;
+    }
+
+    /* A UART never stalls the CPU; bytes nobody drains are lost on the wire */
+    if (huart->fd_tx >= 0 && huart->fd_tx != STDOUT_FILENO) {
+        fcntl(huart->fd_tx, F_SETFL, fcntl(huart->fd_tx, F_GETFL) | O_NONBLOCK);
+    }
+
+    uarts[n_uarts++] = huart;
+
+    return 1;
+}
+
+/**
+ * Registers an ADC so conversions started by the firmware complete
+ * @param hadc The handle to initialize
+ * @param instance The peripheral the firmware compares against in callbacks
+ * @param n_conversions Conversions per HAL_ADC_Start_IT, one callback each
+ */
+void host_adc_register(ADC_HandleTypeDef *hadc, ADC_TypeDef *instance, uint32_t n_conversions) {
+    if (hadc == NULL || n_adcs >= HOST_MAX_ADCS) {
+        return;
+    }
+
+    memset(hadc, 0, sizeof(*hadc));
+    hadc->Instance = instance;
+    hadc->n_conversions = n_conversions;
+
+    adcs[n_adcs++] = hadc;
+}
+
+/**
+ * Number of bytes the wire could have carried since the scheduler started
+ */
+static uint64_t uart_rx_allowance(UART_HandleTypeDef *huart) {
+    uint64_t ticks = xTaskGetTickCount();
+
+    return (uint64_t) huart->Init.BaudRate / UART_BITS_PER_BYTE * ticks / configTICK_RATE_HZ;
+}
+
+static void *uart_rx_thread(void *arg) {
+    UART_HandleTypeDef *huart = arg;
+    uint8_t chunk[512];
+
+    for (;;) {
+        if (!scheduler_running() || !__atomic_load_n(&huart->rx_armed, __ATOMIC_ACQUIRE)) {
+            usleep(100);
+            continue;
+        }
+
+        uint64_t allowance = uart_rx_allowance(huart) - huart->rx_bytes;
+        size_t want = huart->rx_size;
+
+        if (want > sizeof(chunk)) want = sizeof(chunk);
+        if (want > allowance) want = (size_t) allowance;
+
+        if (want == 0) {
+            usleep(100);
+            continue;
+        }
+
+        struct pollfd pfd = {.fd = huart->fd_rx, .events = POLLIN};
+
+        if (poll(&pfd, 1, 10) <= 0) {
+            continue;
+        }
+
+        ssize_t n = read(huart->fd_rx, chunk, want);
+
+        if (n == 0 || (n < 0 && errno != EINTR && errno != EAGAIN)) {
+            /* End of a replay file, or the other side of the pty went away */
+            if (n == 0 && !isatty(huart->fd_rx)) {
+                return NULL;
+            }
+            usleep(1000);
+            continue;
+        }
+
+        if (n < 0) {
+            continue;
+        }
+
+        memcpy(huart->rx_buf, chunk, (size_t) n);
+        huart->rx_count = (uint16_t) n;
+        huart->rx_bytes += (uint64_t) n;
+
+        __atomic_store_n(&huart->rx_armed, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&huart->rx_event, 1, __ATOMIC_RELEASE);
+
+        vPortGenerateSimulatedInterrupt();
+    }
+
+    return NULL;
+}
+
+/**
+ * Starts the receiver threads. Call after port_init() so the transfers the
+ * firmware arms there are already in place.
+ */
+void host_hal_start(void) {
+    for (size_t i = 0; i < n_uarts; i++) {
+        if (uarts[i]->fd_rx < 0) {
+            continue;
+        }
+
+        if (pthread_create(&uart_rx_threads[i], NULL, uart_rx_thread, uarts[i]) != 0) {
+            fprintf(stderr, "failed to start %s receiver\n", uarts[i]->Instance->name);
+        }
+    }
+}
+
+void host_hal_print_stats(FILE *out) {
+    for (size_t i = 0; i < n_uarts; i++) {
+        fprintf(out, "%-6s tx %10llu B  dropped %10llu B  rx %10llu B\n",
+                uarts[i]->Instance->name,
+                (unsigned long long) uarts[i]->tx_bytes,
+                (unsigned long long) uarts[i]->tx_dropped,
+                (unsigned long long) uarts[i]->rx_bytes);
+    }
+}
+
+/**
+ * Runs the callbacks for every interrupt latched since the last call.
+ * Called by the port with interrupts masked, like an NVIC handler.
+ */
+void vHostServiceInterrupts(void) {
+    int serviced;
+
+    do {
+        serviced = 0;
+
+        for (size_t i = 0; i < n_uarts; i++) {
+            if (__atomic_exchange_n(&uarts[i]->rx_event, 0, __ATOMIC_ACQ_REL)) {
+                HAL_UARTEx_RxEventCallback(uarts[i], uarts[i]->rx_count);
+                serviced = 1;
+            }
+        }
+
+        /* A completed conversion may start the next ADC in the chain */
+        for (size_t i = 0; i < n_adcs; i++) {
+            uint32_t n = __atomic_exchange_n(&adcs[i]->pending, 0, __ATOMIC_ACQ_REL);
+
+            for (uint32_t j = 0; j < n; j++) {
+                adcs[i]->value = adc_noise();
+                HAL_ADC_ConvCpltCallback(adcs[i]);
+                serviced = 1;
+            }
+        }
+    } while (serviced);
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) {
+        port->odr |= pin;
+    } else {
+        port->odr &= ~(uint32_t) pin;
+    }
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout) {
+    (void) timeout;
+
+    if (huart == NULL || data == NULL || size == 0) {
+        return HAL_ERROR;
+    }
+
+    size_t written = 0;
+
+    while (huart->fd_tx >= 0 && written < size) {
+        ssize_t n = write(huart->fd_tx, data + written, size - written);
+
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            break;
+        }
+
+        written += (size_t) n;
+    }
+
+    __atomic_fetch_add(&huart->tx_bytes, size, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&huart->tx_dropped, huart->fd_tx >= 0 ? size - written : 0, __ATOMIC_RELAXED);
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_IT(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size) {
+    return HAL_UART_Transmit(huart, data, size, 0);
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size) {
+    return HAL_UART_Transmit(huart, data, size, 0);
+}
+
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout) {
+    if (huart == NULL || huart->fd_rx < 0) {
+        return HAL_TIMEOUT;
+    }
+
+    uint16_t received = 0;
+    uint32_t start = HAL_GetTick();
+
+    while (received < size) {
+        struct pollfd pfd = {.fd = huart->fd_rx, .events = POLLIN};
+
+        if (poll(&pfd, 1, 1) > 0) {
+            ssize_t n = read(huart->fd_rx, data + received, size - received);
+            if (n > 0) received += (uint16_t) n;
+        }
+
+        if (timeout != HAL_MAX_DELAY && HAL_GetTick() - start >= timeout) {
+            return HAL_TIMEOUT;
+        }
+    }
+
+    huart->rx_bytes += received;
+
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UARTEx_ReceiveToIdle_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size) {
+    if (huart == NULL || data == NULL || size == 0) {
+        return HAL_ERROR;
+    }
+
+    if (__atomic_load_n(&huart->rx_armed, __ATOMIC_ACQUIRE)) {
+        return HAL_BUSY;
+    }
+
+    huart->rx_buf = data;
+    huart->rx_size = size;
+    __atomic_store_n(&huart->rx_armed, 1, __ATOMIC_RELEASE);
+
+    return HAL_OK;
+}
+
+__attribute__((weak)) void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t size) {
+    (void) huart;
+    (void) size;
+}
+
+__attribute__((weak)) void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+    (void) huart;
+}
+
+HAL_StatusTypeDef HAL_ADC_Start_IT(ADC_HandleTypeDef *hadc) {
+    if (hadc == NULL) {
+        return HAL_ERROR;
+    }
+
+    __atomic_fetch_add(&hadc->pending, hadc->n_conversions, __ATOMIC_ACQ_REL);
+    vPortGenerateSimulatedInterrupt();
+
+    return HAL_OK;
+}
+
+uint32_t HAL_ADC_GetValue(ADC_HandleTypeDef *hadc) {
+    return hadc->value;
+}
+
+__attribute__((weak)) void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef *hadc) {
+    (void) hadc;
+}
+
+HAL_StatusTypeDef HAL_Init(void) {
+    return HAL_OK;
+}
+
+/**
+ * Milliseconds of simulated time, so timeouts scale with the tick rate
+ */
+uint32_t HAL_GetTick(void) {
+    static uint64_t boot_ms = 0;
+
+    if (scheduler_running()) {
+        return (uint32_t) (xTaskGetTickCount() * portTICK_PERIOD_MS);
+    }
+
+    if (boot_ms == 0) {
+        boot_ms = host_ms_now();
+    }
+
+    return (uint32_t) (host_ms_now() - boot_ms);
+}
+
+void HAL_Delay(uint32_t ms) {
+    if (scheduler_running()) {
+        vTaskDelay(pdMS_TO_TICKS(ms));
+    } else {
+        usleep(ms * 1000U);
+    }
+}
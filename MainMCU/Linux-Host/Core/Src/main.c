@@ -0,0 +1,172 @@
+/*
+ * Entry point of the Linux host build.
+ *
+ * Stands in for the board main.c: opens the host backings for the peripherals
+ * the firmware expects, then runs port_init()/port_start() unchanged. A
+ * monitor thread prints throughput statistics and ends the run.
+ */
+
+#include <getopt.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "main.h"
+#include "port_layer.h"
+#include "ff.h"
+
+ADC_HandleTypeDef hadc2;
+ADC_HandleTypeDef hadc3;
+
+SPI_HandleTypeDef hspi1;
+
+UART_HandleTypeDef huart4;
+UART_HandleTypeDef huart5;
+UART_HandleTypeDef huart2;
+
+extern const char *host_flash_path;
+
+void command_idle_to_ground();
+
+static uint32_t run_duration_s = 0;
+static uint32_t stats_period_s = 0;
+
+static TaskHandle_t host_arm_task_handle;
+static StackType_t host_arm_task_stack[configMINIMAL_STACK_SIZE];
+static StaticTask_t host_arm_task_buff;
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --telemetry SPEC   telemetry UART (default pty)\n"
+            "  --state SPEC       state estimation UART (default pty)\n"
+            "  --debug SPEC       debug UART (default stdout)\n"
+            "  --flash FILE       W25Q backing file (default flash.bin)\n"
+            "  --sd DIR           SD card root directory (default sd)\n"
+            "  --speed N          run N times faster than real time, 0 = as fast as possible\n"
+            "  --duration SEC     stop after SEC seconds of simulated time\n"
+            "  --stats SEC        print statistics every SEC seconds of simulated time\n"
+            "  --arm              issue the idle-to-ground command at startup\n"
+            "UART SPEC: null, stdout, pty, in:PATH, out:PATH, dev:PATH\n",
+            argv0);
+}
+
+/**
+ * Sends the idle-to-ground command once the scheduler is running, so a run can
+ * exercise the flash and state tasks without a ground station attached
+ */
+static void host_arm_task(void *args) {
+    vTaskDelay(pdMS_TO_TICKS(100));
+    command_idle_to_ground();
+    vTaskSuspend(NULL);
+}
+
+static void *monitor_thread(void *args) {
+    uint32_t next_stats = stats_period_s;
+
+    for (;;) {
+        usleep(1000);
+
+        uint32_t now_s = xTaskGetTickCount() / configTICK_RATE_HZ;
+
+        if (stats_period_s != 0 && now_s >= next_stats) {
+            fprintf(stderr, "--- t = %u s\n", now_s);
+            host_hal_print_stats(stderr);
+            next_stats += stats_period_s;
+        }
+
+        if (run_duration_s != 0 && now_s >= run_duration_s) {
+            fprintf(stderr, "--- finished after %u s\n", now_s);
+            host_hal_print_stats(stderr);
+            exit(0);
+        }
+    }
+
+    return NULL;
+}
+
+void vApplicationIdleHook(void) {
+    /* Give the host CPU back instead of spinning between ticks */
+    usleep(50);
+}
+
+void Error_Handler(void) {
+    fprintf(stderr, "Error_Handler\n");
+    abort();
+}
+
+int main(int argc, char **argv) {
+    const char *telemetry_spec = "pty";
+    const char *state_spec = "pty";
+    const char *debug_spec = "stdout";
+    uint32_t speed = 1;
+    int arm = 0;
+
+    static const struct option options[] = {
+        {"telemetry", required_argument, NULL, 't'},
+        {"state", required_argument, NULL, 's'},
+        {"debug", required_argument, NULL, 'd'},
+        {"flash", required_argument, NULL, 'f'},
+        {"sd", required_argument, NULL, 'c'},
+        {"speed", required_argument, NULL, 'x'},
+        {"duration", required_argument, NULL, 'D'},
+        {"stats", required_argument, NULL, 'S'},
+        {"arm", no_argument, NULL, 'a'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 't': telemetry_spec = optarg; break;
+            case 's': state_spec = optarg; break;
+            case 'd': debug_spec = optarg; break;
+            case 'f': host_flash_path = optarg; break;
+            case 'c': host_sd_root = optarg; break;
+            case 'x': speed = (uint32_t) strtoul(optarg, NULL, 0); break;
+            case 'D': run_duration_s = (uint32_t) strtoul(optarg, NULL, 0); break;
+            case 'S': stats_period_s = (uint32_t) strtoul(optarg, NULL, 0); break;
+            case 'a': arm = 1; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    HAL_Init();
+
+    if (!host_uart_open(&huart4, UART4, 57600, telemetry_spec) ||
+        !host_uart_open(&huart5, UART5, 115200, state_spec) ||
+        !host_uart_open(&huart2, USART2, 115200, debug_spec)) {
+        fprintf(stderr, "failed to open UART backing\n");
+        return 1;
+    }
+
+    host_adc_register(&hadc2, ADC2, ADC2_N_CHANNELS);
+    host_adc_register(&hadc3, ADC3, ADC3_N_CHANNELS);
+
+    vPortSetTickScale(speed);
+
+    if (port_init()) {
+        HAL_UART_Transmit(&debug_uart, (uint8_t *) "Port initialized\r\n", 18, HAL_MAX_DELAY);
+    } else {
+        HAL_UART_Transmit(&debug_uart, (uint8_t *) "Port not initialized\r\n", 22, HAL_MAX_DELAY);
+        return 1;
+    }
+
+    if (arm) {
+        host_arm_task_handle = xTaskCreateStatic(host_arm_task, "host_arm_task", configMINIMAL_STACK_SIZE, NULL, tskIDLE_PRIORITY, host_arm_task_stack, &host_arm_task_buff);
+    }
+
+    /* Threads created from here on inherit the mask set up by the port */
+    host_hal_start();
+
+    pthread_t monitor;
+    pthread_create(&monitor, NULL, monitor_thread, NULL);
+
+    port_start();
+
+    return 0;
+}
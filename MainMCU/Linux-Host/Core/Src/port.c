@@ -0,0 +1,402 @@
+/*
+ * FreeRTOS port for the Linux host build of the MainMCU firmware.
+ *
+ * Modelled on the upstream FreeRTOS POSIX/GCC port:
+ *  - each task runs on its own pthread, parked on an event when not running;
+ *  - a tick thread sends SIGALRM to the thread of the running task, and the
+ *    signal handler plays the role of the SysTick/PendSV handlers;
+ *  - peripheral emulation threads in host_hal.c latch pending interrupts and
+ *    call vPortGenerateSimulatedInterrupt(), which reuses the same signal so
+ *    peripheral callbacks run in "interrupt" context on the running task.
+ *
+ * Blocking SIGALRM is the equivalent of raising BASEPRI, so critical sections,
+ * FromISR APIs and portYIELD_FROM_ISR keep their Cortex-M semantics.
+ */
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "FreeRTOS.h"
+#include "task.h"
+
+#include "wait_for_event.h"
+
+#define SIG_RESUME SIGUSR1
+
+typedef struct THREAD {
+    pthread_t pthread;
+    TaskFunction_t pxCode;
+    void *pvParams;
+    BaseType_t xDying;
+    struct event *ev;
+} Thread_t;
+
+static pthread_once_t hSigSetupThread = PTHREAD_ONCE_INIT;
+static sigset_t xAllSignals;
+static sigset_t xSchedulerOriginalSignalMask;
+static pthread_t hMainThread = (pthread_t) NULL;
+static volatile UBaseType_t uxCriticalNesting;
+static BaseType_t xSchedulerEnd = pdFALSE;
+static pthread_t hTimerTickThread;
+static volatile BaseType_t xTimerTickThreadShouldRun;
+
+/* Set while the signal handler runs so yields from callbacks are deferred */
+static volatile BaseType_t xInsideInterrupt = pdFALSE;
+static volatile BaseType_t xSwitchRequired = pdFALSE;
+
+/* Ticks raised by the tick thread that the handler has not consumed yet */
+static uint32_t ulPendingTicks = 0;
+
+/* Host microseconds slept per tick; scaled down to run faster than real time */
+static volatile uint32_t ulTickSleepUs = portTICK_USECS;
+
+static void prvSetupSignalsAndSchedulerPolicy(void);
+static void prvSetupTimerInterrupt(void);
+static void *prvWaitForStart(void *pvParams);
+static void prvSwitchThread(Thread_t *xThreadToResume, Thread_t *xThreadToSuspend);
+static void prvSuspendSelf(Thread_t *thread);
+static void prvResumeThread(Thread_t *xThreadId);
+static void vPortSystemTickHandler(int sig);
+static void vPortStartFirstTask(void);
+
+static void prvFatalError(const char *pcCall, int iErrno) {
+    fprintf(stderr, "%s: %s\n", pcCall, strerror(iErrno));
+    abort();
+}
+
+static inline Thread_t *prvGetThreadFromTask(TaskHandle_t xTask) {
+    StackType_t *pxTopOfStack = *(StackType_t **) xTask;
+
+    return (Thread_t *) (pxTopOfStack + 1);
+}
+
+/* Weak so a build without simulated peripherals still links */
+__attribute__((weak)) void vHostServiceInterrupts(void) {
+}
+
+StackType_t *pxPortInitialiseStack(StackType_t *pxTopOfStack,
+                                   StackType_t *pxEndOfStack,
+                                   TaskFunction_t pxCode,
+                                   void *pvParameters) {
+    Thread_t *thread;
+    pthread_attr_t xThreadAttributes;
+    size_t ulStackSize;
+    int iRet;
+
+    (void) pthread_once(&hSigSetupThread, prvSetupSignalsAndSchedulerPolicy);
+
+    /* The task stack is not used for execution; it only holds the thread record */
+    thread = (Thread_t *) (pxTopOfStack + 1) - 1;
+    pxTopOfStack = (StackType_t *) thread - 1;
+
+    ulStackSize = (size_t) (pxTopOfStack + 1 - pxEndOfStack) * sizeof(*pxTopOfStack);
+    configASSERT(ulStackSize > sizeof(Thread_t));
+    (void) ulStackSize;
+
+    thread->pxCode = pxCode;
+    thread->pvParams = pvParameters;
+    thread->xDying = pdFALSE;
+    thread->ev = event_create();
+
+    pthread_attr_init(&xThreadAttributes);
+
+    vPortEnterCritical();
+
+    iRet = pthread_create(&thread->pthread, &xThreadAttributes, prvWaitForStart, thread);
+
+    if (iRet != 0) {
+        prvFatalError("pthread_create", iRet);
+    }
+
+    vPortExitCritical();
+
+    return pxTopOfStack;
+}
+
+void vPortStartFirstTask(void) {
+    Thread_t *pxFirstThread = prvGetThreadFromTask(xTaskGetCurrentTaskHandle());
+
+    prvResumeThread(pxFirstThread);
+}
+
+BaseType_t xPortStartScheduler(void) {
+    int iSignal;
+    sigset_t xSignals;
+
+    hMainThread = pthread_self();
+
+    prvSetupTimerInterrupt();
+
+    /* The main thread only waits for vPortEndScheduler from here on */
+    sigemptyset(&xSignals);
+    sigaddset(&xSignals, SIG_RESUME);
+    (void) pthread_sigmask(SIG_BLOCK, &xSignals, NULL);
+
+    vPortStartFirstTask();
+
+    while (xSchedulerEnd != pdTRUE) {
+        sigwait(&xSignals, &iSignal);
+    }
+
+    xTimerTickThreadShouldRun = pdFALSE;
+    pthread_join(hTimerTickThread, NULL);
+
+    (void) pthread_sigmask(SIG_SETMASK, &xSchedulerOriginalSignalMask, NULL);
+
+    return 0;
+}
+
+void vPortEndScheduler(void) {
+    xSchedulerEnd = pdTRUE;
+    (void) pthread_kill(hMainThread, SIG_RESUME);
+}
+
+void vPortEnterCritical(void) {
+    if (uxCriticalNesting == 0) {
+        vPortDisableInterrupts();
+    }
+
+    uxCriticalNesting++;
+}
+
+void vPortExitCritical(void) {
+    uxCriticalNesting--;
+
+    if (uxCriticalNesting == 0) {
+        vPortEnableInterrupts();
+    }
+}
+
+void vPortYieldFromISR(void) {
+    Thread_t *xThreadToSuspend;
+    Thread_t *xThreadToResume;
+
+    /* Callbacks run inside the signal handler; switch once it has finished */
+    if (xInsideInterrupt == pdTRUE) {
+        xSwitchRequired = pdTRUE;
+        return;
+    }
+
+    xThreadToSuspend = prvGetThreadFromTask(xTaskGetCurrentTaskHandle());
+
+    vTaskSwitchContext();
+
+    xThreadToResume = prvGetThreadFromTask(xTaskGetCurrentTaskHandle());
+
+    prvSwitchThread(xThreadToResume, xThreadToSuspend);
+}
+
+void vPortYield(void) {
+    vPortEnterCritical();
+
+    vPortYieldFromISR();
+
+    vPortExitCritical();
+}
+
+void vPortDisableInterrupts(void) {
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return;
+    }
+
+    (void) pthread_sigmask(SIG_BLOCK, &xAllSignals, NULL);
+}
+
+void vPortEnableInterrupts(void) {
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        return;
+    }
+
+    (void) pthread_sigmask(SIG_UNBLOCK, &xAllSignals, NULL);
+}
+
+UBaseType_t xPortSetInterruptMask(void) {
+    /* Interrupts are always disabled inside the signal handler */
+    return (UBaseType_t) 0;
+}
+
+void vPortClearInterruptMask(UBaseType_t uxMask) {
+    (void) uxMask;
+}
+
+void vPortSetTickScale(uint32_t ulScale) {
+    ulTickSleepUs = (ulScale == 0) ? 0 : portTICK_USECS / ulScale;
+}
+
+void vPortGenerateSimulatedInterrupt(void) {
+    TaskHandle_t xCurrent;
+
+    if (xTaskGetSchedulerState() == taskSCHEDULER_NOT_STARTED) {
+        /* Serviced on the first tick once the scheduler is running */
+        return;
+    }
+
+    xCurrent = xTaskGetCurrentTaskHandle();
+
+    if (xCurrent != NULL) {
+        (void) pthread_kill(prvGetThreadFromTask(xCurrent)->pthread, SIGALRM);
+    }
+}
+
+static void *prvTimerTickHandler(void *arg) {
+    (void) arg;
+
+    while (xTimerTickThreadShouldRun) {
+        __atomic_fetch_add(&ulPendingTicks, 1, __ATOMIC_RELAXED);
+
+        vPortGenerateSimulatedInterrupt();
+
+        if (ulTickSleepUs > 0) {
+            usleep(ulTickSleepUs);
+        } else {
+            sched_yield();
+        }
+    }
+
+    return NULL;
+}
+
+static void prvSetupTimerInterrupt(void) {
+    xTimerTickThreadShouldRun = pdTRUE;
+
+    int iRet = pthread_create(&hTimerTickThread, NULL, prvTimerTickHandler, NULL);
+
+    if (iRet != 0) {
+        prvFatalError("pthread_create", iRet);
+    }
+}
+
+static void vPortSystemTickHandler(int sig) {
+    Thread_t *pxThreadToSuspend;
+    Thread_t *pxThreadToResume;
+
+    (void) sig;
+
+    /* Signals are blocked in this handler */
+    uxCriticalNesting++;
+
+    pxThreadToSuspend = prvGetThreadFromTask(xTaskGetCurrentTaskHandle());
+
+    xInsideInterrupt = pdTRUE;
+
+    /* The same signal carries ticks and peripheral interrupts */
+    uint32_t ulTicks = __atomic_exchange_n(&ulPendingTicks, 0, __ATOMIC_RELAXED);
+
+    while (ulTicks-- > 0) {
+        if (xTaskIncrementTick() != pdFALSE) {
+            xSwitchRequired = pdTRUE;
+        }
+    }
+
+    vHostServiceInterrupts();
+
+    xInsideInterrupt = pdFALSE;
+
+    if (xSwitchRequired == pdTRUE) {
+        xSwitchRequired = pdFALSE;
+
+        vTaskSwitchContext();
+
+        pxThreadToResume = prvGetThreadFromTask(xTaskGetCurrentTaskHandle());
+
+        prvSwitchThread(pxThreadToResume, pxThreadToSuspend);
+    }
+
+    uxCriticalNesting--;
+}
+
+void vPortThreadDying(void *pxTaskToDelete, volatile BaseType_t *pxPendYield) {
+    Thread_t *pxThread = prvGetThreadFromTask(pxTaskToDelete);
+
+    (void) pxPendYield;
+
+    pxThread->xDying = pdTRUE;
+}
+
+void vPortCancelThread(void *pxTaskToDelete) {
+    Thread_t *pxThreadToCancel = prvGetThreadFromTask(pxTaskToDelete);
+
+    /* The thread has already been suspended so it can be safely cancelled */
+    pthread_cancel(pxThreadToCancel->pthread);
+    event_signal(pxThreadToCancel->ev);
+    pthread_join(pxThreadToCancel->pthread, NULL);
+    event_delete(pxThreadToCancel->ev);
+}
+
+static void *prvWaitForStart(void *pvParams) {
+    Thread_t *pxThread = pvParams;
+
+    prvSuspendSelf(pxThread);
+
+    /* Resumed for the first time, unblock all signals */
+    uxCriticalNesting = 0;
+    vPortEnableInterrupts();
+
+    pxThread->pxCode(pxThread->pvParams);
+
+    /* Tasks must never return */
+    configASSERT(pdFALSE);
+
+    return NULL;
+}
+
+static void prvSwitchThread(Thread_t *pxThreadToResume, Thread_t *pxThreadToSuspend) {
+    BaseType_t uxSavedCriticalNesting;
+
+    if (pxThreadToSuspend != pxThreadToResume) {
+        /* The nesting count belongs to the running task, not the port */
+        uxSavedCriticalNesting = uxCriticalNesting;
+
+        prvResumeThread(pxThreadToResume);
+
+        if (pxThreadToSuspend->xDying == pdTRUE) {
+            pthread_exit(NULL);
+        }
+
+        prvSuspendSelf(pxThreadToSuspend);
+
+        uxCriticalNesting = uxSavedCriticalNesting;
+    }
+}
+
+static void prvSuspendSelf(Thread_t *thread) {
+    (void) event_wait(thread->ev);
+}
+
+static void prvResumeThread(Thread_t *xThreadId) {
+    if (pthread_self() != xThreadId->pthread) {
+        event_signal(xThreadId->ev);
+    }
+}
+
+static void prvSetupSignalsAndSchedulerPolicy(void) {
+    struct sigaction sigtick;
+    int iRet;
+
+    hMainThread = pthread_self();
+
+    sigfillset(&xAllSignals);
+
+    /* Leave SIGINT deliverable so the process can always be stopped */
+    sigdelset(&xAllSignals, SIGINT);
+
+    /* New threads inherit this mask; it is lifted when each task first runs */
+    (void) pthread_sigmask(SIG_SETMASK, &xAllSignals, &xSchedulerOriginalSignalMask);
+
+    memset(&sigtick, 0, sizeof(sigtick));
+    sigtick.sa_flags = 0;
+    sigtick.sa_handler = vPortSystemTickHandler;
+    sigfillset(&sigtick.sa_mask);
+
+    iRet = sigaction(SIGALRM, &sigtick, NULL);
+
+    if (iRet == -1) {
+        prvFatalError("sigaction", errno);
+    }
+}
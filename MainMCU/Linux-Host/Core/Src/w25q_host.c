@@ -0,0 +1,193 @@
+#include "w25q.h"
+#include "port_config.h"
+#include "globals.h"
+
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+
+/*
+ * File-backed W25Q for the Linux host build. Overrides the weak low-level
+ * calls in w25q.c the same way w25q_impl.c does for the OCTOSPI part, and
+ * keeps NOR semantics: programming can only clear bits, erasing sets them,
+ * and a page program wraps at the end of the page.
+ */
+
+#define W25Q_HOST_SIZE ((uint32_t)W25Q_SECTOR_COUNT * W25Q_MEM_SECTOR_SIZE * 1024U)
+
+const char *host_flash_path = "flash.bin";
+
+static int flash_fd = -1;
+static uint8_t status_regs[3] = {0x00, 0x02, 0x00};
+
+static enum w25q_err flash_open(void) {
+  if (flash_fd >= 0) {
+    return W25Q_ERR_OK;
+  }
+
+  flash_fd = open(host_flash_path, O_RDWR | O_CREAT, 0644);
+  if (flash_fd < 0) {
+    return W25Q_ERR_SPI;
+  }
+
+  /* A blank part reads back as all ones */
+  off_t size = lseek(flash_fd, 0, SEEK_END);
+  if (size < (off_t)W25Q_HOST_SIZE) {
+    uint8_t blank[4096];
+    memset(blank, 0xFF, sizeof(blank));
+
+    while (size < (off_t)W25Q_HOST_SIZE) {
+      if (pwrite(flash_fd, blank, sizeof(blank), size) != sizeof(blank)) {
+        return W25Q_ERR_SPI;
+      }
+      size += sizeof(blank);
+    }
+  }
+
+  return W25Q_ERR_OK;
+}
+
+static enum w25q_err flash_fill(uint32_t addr, uint32_t len) {
+  uint8_t blank[4096];
+  memset(blank, 0xFF, sizeof(blank));
+
+  while (len > 0) {
+    uint32_t n = len > sizeof(blank) ? sizeof(blank) : len;
+    if (pwrite(flash_fd, blank, n, addr) != (ssize_t)n) {
+      return W25Q_ERR_SPI;
+    }
+    addr += n;
+    len -= n;
+  }
+
+  return W25Q_ERR_OK;
+}
+
+void w25q_delay(uint32_t ms) { vTaskDelay(pdMS_TO_TICKS(ms)); }
+
+enum w25q_err w25q_read_id(struct w25q_device *device, uint8_t *buf) {
+  enum w25q_err err = flash_open();
+  if (err != W25Q_ERR_OK) {
+    return err;
+  }
+
+  *buf = 0x15;
+  return W25Q_ERR_OK;
+}
+
+enum w25q_err w25q_write_enable(struct w25q_device *device, bool enable) {
+  if (enable) {
+    status_regs[0] |= 0x02;
+  } else {
+    status_regs[0] &= ~0x02;
+  }
+  return W25Q_ERR_OK;
+}
+
+enum w25q_err w25q_enter_4_byte_mode(struct w25q_device *device, bool enable) {
+  if (enable) {
+    status_regs[2] |= 0x01;
+  } else {
+    status_regs[2] &= ~0x01;
+  }
+  return W25Q_ERR_OK;
+}
+
+enum w25q_err w25q_read_status_reg(struct w25q_device *device,
+                                   uint8_t *reg_data, uint8_t reg_num) {
+  if (reg_num < 1 || reg_num > 3) {
+    return W25Q_ERR_PARAM;
+  }
+
+  *reg_data = status_regs[reg_num - 1];
+  return W25Q_ERR_OK;
+}
+
+enum w25q_err w25q_write_status_reg(struct w25q_device *device,
+                                    uint8_t reg_data, uint8_t reg_num) {
+  if (reg_num < 1 || reg_num > 3) {
+    return W25Q_ERR_PARAM;
+  }
+
+  status_regs[reg_num - 1] = reg_data;
+  return W25Q_ERR_OK;
+}
+
+enum w25q_err w25q_read_raw(struct w25q_device *device, uint8_t *buf,
+                            uint32_t len, uint32_t addr) {
+  if (flash_fd < 0 || addr + len > W25Q_HOST_SIZE) {
+    return W25Q_ERR_PARAM;
+  }
+
+  if (pread(flash_fd, buf, len, addr) != (ssize_t)len) {
+    return W25Q_ERR_SPI;
+  }
+
+  return W25Q_ERR_OK;
+}
+
+enum w25q_err w25q_write_raw(struct w25q_device *device, uint8_t *buf,
+                             uint32_t len, uint32_t addr) {
+  if (flash_fd < 0 || len == 0 || len > W25Q_MEM_PAGE_SIZE ||
+      addr >= W25Q_HOST_SIZE) {
+    return W25Q_ERR_PARAM;
+  }
+
+  uint32_t page = addr & ~(W25Q_MEM_PAGE_SIZE - 1U);
+  uint8_t contents[W25Q_MEM_PAGE_SIZE];
+
+  if (pread(flash_fd, contents, sizeof(contents), page) != sizeof(contents)) {
+    return W25Q_ERR_SPI;
+  }
+
+  for (uint32_t i = 0; i < len; i++) {
+    contents[(addr - page + i) % W25Q_MEM_PAGE_SIZE] &= buf[i];
+  }
+
+  if (pwrite(flash_fd, contents, sizeof(contents), page) != sizeof(contents)) {
+    return W25Q_ERR_SPI;
+  }
+
+  status_regs[0] &= ~0x02;
+  return W25Q_ERR_OK;
+}
+
+enum w25q_err w25q_erase_sector(struct w25q_device *device,
+                                uint32_t sector_addr) {
+  if (flash_fd < 0 || sector_addr >= W25Q_SECTOR_COUNT) {
+    return W25Q_ERR_PARAM;
+  }
+
+  status_regs[0] &= ~0x02;
+  return flash_fill(sector_addr * W25Q_MEM_SECTOR_SIZE * 1024U,
+                    W25Q_MEM_SECTOR_SIZE * 1024U);
+}
+
+enum w25q_err w25q_erase_block(struct w25q_device *device, uint32_t block_addr,
+                               uint8_t size) {
+  if ((size != 32) && (size != 64)) {
+    return W25Q_ERR_PARAM;
+  }
+
+  if (flash_fd < 0 || (size == 64 && block_addr >= W25Q_BLOCK_COUNT) ||
+      (size == 32 && block_addr >= W25Q_BLOCK_COUNT * 2)) {
+    return W25Q_ERR_PARAM;
+  }
+
+  status_regs[0] &= ~0x02;
+  return flash_fill(block_addr * size * 1024U, size * 1024U);
+}
+
+enum w25q_err w25q_erase_chip(struct w25q_device *device) {
+  if (flash_fd < 0) {
+    return W25Q_ERR_PARAM;
+  }
+
+  status_regs[0] &= ~0x02;
+  return flash_fill(0, W25Q_HOST_SIZE);
+}
+
+enum w25q_err w25q_reset(struct w25q_device *device) {
+  status_regs[0] = 0x00;
+  return W25Q_ERR_OK;
+}
@@ -0,0 +1,67 @@
+#ifndef FF_H
+#define FF_H
+
+/*
+ * FatFs API subset for the Linux host build. The calls used by periph_io.c
+ * map onto plain files below the directory given with --sd, so recorded
+ * channels can be inspected directly after a run.
+ */
+
+#include <stdint.h>
+
+typedef unsigned int UINT;
+typedef uint8_t BYTE;
+typedef char TCHAR;
+typedef uint64_t FSIZE_t;
+
+typedef enum {
+    FR_OK = 0,
+    FR_DISK_ERR,
+    FR_INT_ERR,
+    FR_NOT_READY,
+    FR_NO_FILE,
+    FR_NO_PATH,
+    FR_INVALID_NAME,
+    FR_DENIED,
+    FR_EXIST,
+    FR_INVALID_OBJECT,
+    FR_WRITE_PROTECTED,
+    FR_INVALID_DRIVE,
+    FR_NOT_ENABLED,
+    FR_NO_FILESYSTEM,
+    FR_MKFS_ABORTED,
+    FR_TIMEOUT,
+    FR_LOCKED,
+    FR_NOT_ENOUGH_CORE,
+    FR_TOO_MANY_OPEN_FILES,
+    FR_INVALID_PARAMETER,
+} FRESULT;
+
+#define FA_READ          0x01
+#define FA_WRITE         0x02
+#define FA_OPEN_EXISTING 0x00
+#define FA_CREATE_NEW    0x04
+#define FA_CREATE_ALWAYS 0x08
+#define FA_OPEN_ALWAYS   0x10
+#define FA_OPEN_APPEND   0x30
+
+typedef struct {
+    int mounted;
+} FATFS;
+
+typedef struct {
+    int fd;
+} FIL;
+
+/* Directory standing in for the card root, set before the scheduler starts */
+extern const char *host_sd_root;
+
+FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt);
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode);
+FRESULT f_close(FIL *fp);
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br);
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw);
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs);
+FRESULT f_unlink(const TCHAR *path);
+
+#endif
@@ -0,0 +1,172 @@
+#include "ff.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const char *host_sd_root = "sd";
+
+static FRESULT errno_to_fresult(int err) {
+    switch (err) {
+        case ENOENT:
+            return FR_NO_FILE;
+        case ENOTDIR:
+            return FR_NO_PATH;
+        case EACCES:
+        case EPERM:
+            return FR_DENIED;
+        case EEXIST:
+            return FR_EXIST;
+        case EROFS:
+            return FR_WRITE_PROTECTED;
+        case EMFILE:
+        case ENFILE:
+            return FR_TOO_MANY_OPEN_FILES;
+        default:
+            return FR_DISK_ERR;
+    }
+}
+
+static void host_path(char *out, size_t size, const TCHAR *path) {
+    while (*path == '/') {
+        path++;
+    }
+
+    snprintf(out, size, "%s/%s", host_sd_root, path);
+}
+
+/**
+ * "Mounts" the card by making sure the root directory exists
+ * @return FR_OK if the directory is usable, FR_NOT_READY otherwise
+ */
+FRESULT f_mount(FATFS *fs, const TCHAR *path, BYTE opt) {
+    struct stat st;
+
+    (void) path;
+    (void) opt;
+
+    if (host_sd_root == NULL) {
+        return FR_NOT_READY;
+    }
+
+    if (stat(host_sd_root, &st) != 0 && mkdir(host_sd_root, 0755) != 0) {
+        return FR_NOT_READY;
+    }
+
+    if (fs != NULL) {
+        fs->mounted = 1;
+    }
+
+    return FR_OK;
+}
+
+FRESULT f_open(FIL *fp, const TCHAR *path, BYTE mode) {
+    char full[PATH_MAX];
+    int flags;
+
+    if (fp == NULL || path == NULL) {
+        return FR_INVALID_OBJECT;
+    }
+
+    host_path(full, sizeof(full), path);
+
+    if ((mode & (FA_READ | FA_WRITE)) == (FA_READ | FA_WRITE)) {
+        flags = O_RDWR;
+    } else if (mode & FA_WRITE) {
+        flags = O_WRONLY;
+    } else {
+        flags = O_RDONLY;
+    }
+
+    if ((mode & FA_OPEN_APPEND) == FA_OPEN_APPEND) {
+        flags |= O_CREAT | O_APPEND;
+    } else if (mode & FA_CREATE_ALWAYS) {
+        flags |= O_CREAT | O_TRUNC;
+    } else if (mode & FA_CREATE_NEW) {
+        flags |= O_CREAT | O_EXCL;
+    } else if (mode & FA_OPEN_ALWAYS) {
+        flags |= O_CREAT;
+    }
+
+    fp->fd = open(full, flags, 0644);
+
+    if (fp->fd < 0) {
+        return errno_to_fresult(errno);
+    }
+
+    return FR_OK;
+}
+
+FRESULT f_close(FIL *fp) {
+    if (fp == NULL || fp->fd < 0) {
+        return FR_INVALID_OBJECT;
+    }
+
+    int ret = close(fp->fd);
+    fp->fd = -1;
+
+    return ret == 0 ? FR_OK : FR_DISK_ERR;
+}
+
+FRESULT f_read(FIL *fp, void *buff, UINT btr, UINT *br) {
+    *br = 0;
+
+    if (fp == NULL || fp->fd < 0) {
+        return FR_INVALID_OBJECT;
+    }
+
+    ssize_t n;
+
+    do {
+        n = read(fp->fd, buff, btr);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        return FR_DISK_ERR;
+    }
+
+    *br = (UINT) n;
+
+    return FR_OK;
+}
+
+FRESULT f_write(FIL *fp, const void *buff, UINT btw, UINT *bw) {
+    *bw = 0;
+
+    if (fp == NULL || fp->fd < 0) {
+        return FR_INVALID_OBJECT;
+    }
+
+    ssize_t n;
+
+    do {
+        n = write(fp->fd, buff, btw);
+    } while (n < 0 && errno == EINTR);
+
+    if (n < 0) {
+        return FR_DISK_ERR;
+    }
+
+    *bw = (UINT) n;
+
+    return FR_OK;
+}
+
+FRESULT f_lseek(FIL *fp, FSIZE_t ofs) {
+    if (fp == NULL || fp->fd < 0) {
+        return FR_INVALID_OBJECT;
+    }
+
+    return lseek(fp->fd, (off_t) ofs, SEEK_SET) < 0 ? FR_DISK_ERR : FR_OK;
+}
+
+FRESULT f_unlink(const TCHAR *path) {
+    char full[PATH_MAX];
+
+    host_path(full, sizeof(full), path);
+
+    return unlink(full) == 0 ? FR_OK : errno_to_fresult(errno);
+}
@@ -6,6 +6,7 @@
 
 /* Change these to the values for your board */
 #define MCU_H725ZGT6
+#define USE_W25Q
 
 #define SD_CS_GPIO_PORT     GPIOG
 #define SD_CS_PIN           GPIO_PIN_10
@@ -82,7 +82,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  dma_mem_init();
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
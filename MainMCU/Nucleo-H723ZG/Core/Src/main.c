@@ -101,7 +101,7 @@ int main(void)
 {
 
   /* USER CODE BEGIN 1 */
-
+  dma_mem_init();
   /* USER CODE END 1 */
 
   /* MCU Configuration--------------------------------------------------------*/
@@ -0,0 +1,79 @@
+/**
+ * @file consistency.h
+ * @brief NEES and NIS consistency of the flight EKF over Monte Carlo runs
+ *
+ * @details Each run flies the SIL's 6-DOF model from the pad past apogee and
+ *          runs the estimator's state machine on it, from the pad
+ *          calibration through the flight phases. Once launch is detected,
+ *          every CONSISTENCY_EPOCH_MS after liftoff it records the normalized
+ *          estimation error squared of each position and velocity state,
+ *          e_i^2 / P_ii, and of the six together, e' P^-1 e, against the true
+ *          position and body velocity. The baro bias has no truth and is not
+ *          graded. The normalized innovation squared is taken for every GNSS
+ *          position update, one per fix, and for every baro update.
+ *
+ *          Averaged over N runs, a consistent filter's NEES of n states is
+ *          chi-square with N n degrees of freedom divided by N, so each epoch
+ *          has a two-sided CONSISTENCY_CONFIDENCE interval for the average. A
+ *          metric passes if its average lies inside for at least
+ *          CONSISTENCY_MIN_INSIDE of the epochs.
+ *
+ *          The flight code keeps its state in globals, so a run must have a
+ *          process of its own; the pool forks one per run.
+ */
+#ifndef __CONSISTENCY_H__
+#define __CONSISTENCY_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+#define CONSISTENCY_EPOCH_MS 100
+#define CONSISTENCY_MAX_EPOCHS 600      // 60 s after liftoff
+#define CONSISTENCY_RUNS 100            // default number of runs
+#define CONSISTENCY_CONFIDENCE 0.95     // two-sided, of each epoch's interval
+#define CONSISTENCY_MIN_INSIDE 0.90     // share of epochs a metric must be inside
+
+// Graded metrics, in report order
+typedef enum {
+    CONSISTENCY_NEES_X,
+    CONSISTENCY_NEES_VX,
+    CONSISTENCY_NEES_Y,
+    CONSISTENCY_NEES_VY,
+    CONSISTENCY_NEES_Z,
+    CONSISTENCY_NEES_VZ,
+    CONSISTENCY_NEES,               // the six states together
+    CONSISTENCY_NIS_GNSS,
+    CONSISTENCY_NIS_BARO,
+    CONSISTENCY_METRICS
+} ConsistencyMetric;
+
+// Sums of one epoch of one run
+typedef struct {
+    double sum[CONSISTENCY_METRICS];    // of the NEES or NIS samples
+    uint32_t dof[CONSISTENCY_METRICS];  // degrees of freedom summed, 0 if no sample
+} ConsistencyEpoch;
+
+typedef struct {
+    ConsistencyEpoch epochs[CONSISTENCY_MAX_EPOCHS];
+    uint32_t n_epochs;          // up to the end of the run
+} ConsistencyRun;
+
+// One metric over all runs
+typedef struct {
+    uint32_t epochs;            // with a sample in at least one run
+    uint32_t inside;            // of those, with the average inside its interval
+    uint32_t above;             // above the interval, the filter claims too small a covariance
+    double mean;                // over all samples, per degree of freedom
+} ConsistencyStat;
+
+extern const char *const consistency_metric_names[CONSISTENCY_METRICS];
+
+int consistency_run(const SimConfig *cfg, uint32_t run_index, ConsistencyRun *run);
+double consistency_chi2_quantile(double dof, double p);
+int consistency_report(FILE *out, const ConsistencyRun *runs, const uint8_t *valid, uint32_t n,
+                       ConsistencyStat stats[CONSISTENCY_METRICS]);
+void consistency_write_csv(FILE *out, const ConsistencyRun *runs, const uint8_t *valid, uint32_t n);
+
+#endif /* __CONSISTENCY_H__ */
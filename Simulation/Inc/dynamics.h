@@ -0,0 +1,54 @@
+/**
+ * @file dynamics.h
+ * @brief 6-DOF rigid body model of the jet vanes rocket
+ */
+#ifndef __DYNAMICS_H__
+#define __DYNAMICS_H__
+
+#include "sim.h"
+#include "sim_rng.h"
+
+#define DYN_THRUST_POINTS 15
+
+// Integrated state, in the flat frame unless noted
+typedef struct {
+    double r[3];        // position, m
+    double v[3];        // velocity, m/s
+    double q[4];        // body to flat rotation, scalar first
+    double w[3];        // body rates, rad/s
+} DynState;
+
+// Vehicle with this run's dispersions applied
+typedef struct {
+    SimVehicle nominal;
+    double thrust_curve[DYN_THRUST_POINTS];     // N at 1 s steps
+    double total_impulse;                       // of the nominal curve, N s
+    double thrust_scale;
+    double burn_time_scale;
+    double mass_wet;
+    double mass_prop;
+    double cd;
+    double cn_alpha;
+    double vane_gain;
+    double misalign[2];                         // body y and z components
+    double wind[3];                             // flat frame, m/s
+    double ignition_time;                       // s
+
+    double vane[4];                             // actual deflections, deg
+    int launched;
+    double liftoff_time;
+
+    // Outputs of the last derivative evaluation at the start of a step
+    double specific_force[3];                   // body frame, m/s^2
+    double thrust;                              // N
+    double dynamic_pressure;                    // Pa
+} DynModel;
+
+void dyn_init(DynModel *model, DynState *state, const SimConfig *cfg,
+              const double thrust_curve[DYN_THRUST_POINTS], SimRng *rng);
+void dyn_step(DynModel *model, DynState *state, double t, double dt, const float vane_cmd[4]);
+double dyn_thrust(const DynModel *model, double t);
+void dyn_rotate_to_body(const double q[4], const double v_flat[3], double v_body[3]);
+void dyn_rotate_to_flat(const double q[4], const double v_body[3], double v_flat[3]);
+
+#endif /* __DYNAMICS_H__ */
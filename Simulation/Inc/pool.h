@@ -0,0 +1,25 @@
+/**
+ * @file pool.h
+ * @brief Work-stealing pool of worker processes
+ */
+#ifndef __POOL_H__
+#define __POOL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Runs job index in a freshly forked child, returns 0 on success
+typedef int (*PoolJob)(uint32_t index, void *ctx);
+
+typedef struct {
+    uint64_t executed;
+    uint64_t stolen;        // jobs taken from other workers
+    uint64_t steals;        // successful steal operations
+    uint64_t failed;
+} PoolWorkerStats;
+
+void *pool_shared_alloc(size_t size);
+void pool_shared_free(void *ptr, size_t size);
+int pool_run(uint32_t n_jobs, unsigned n_workers, PoolJob job, void *ctx, PoolWorkerStats *stats);
+
+#endif /* __POOL_H__ */
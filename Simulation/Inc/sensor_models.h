@@ -0,0 +1,35 @@
+/**
+ * @file sensor_models.h
+ * @brief Synthetic ADIS16500, MS5607, LIS3MDL and u-blox streams
+ */
+#ifndef __SENSOR_MODELS_H__
+#define __SENSOR_MODELS_H__
+
+#include "dynamics.h"
+#include "replay.h"
+
+typedef struct {
+    SimRng rng;
+    const SimConfig *cfg;
+    double accel_bias[3];       // ADIS frame, m/s^2
+    double gyro_bias[3];        // ADIS frame, deg/s
+    double mag_hard_iron[3];    // body frame, gauss
+    uint32_t itow;              // GNSS time of week, ms
+} SimSensors;
+
+// Raw readings, for traces
+typedef struct {
+    int16_t accel_raw[3];
+    int16_t gyro_raw[3];
+    double pressure;            // Pa
+    double temperature;         // deg C
+    double mag[3];              // gauss
+} SimRawReadings;
+
+void sensor_models_init(SimSensors *sens, const SimConfig *cfg, SimRng *rng);
+void sensor_models_imu(SimSensors *sens, const DynModel *model, const DynState *state,
+                       ReplaySample *sample, SimRawReadings *raw);
+int sensor_models_gps(SimSensors *sens, const DynState *state, uint32_t t_ms, ReplaySample *sample);
+void sensor_models_baro_mag(SimSensors *sens, const DynState *state, SimRawReadings *raw);
+
+#endif /* __SENSOR_MODELS_H__ */
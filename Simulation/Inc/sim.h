@@ -0,0 +1,108 @@
+/**
+ * @file sim.h
+ * @brief Software-in-the-loop simulator for the jet vanes GNC chain
+ *
+ * @details A 6-DOF rigid body model of the rocket drives synthetic ADIS16500,
+ *          MS5607, LIS3MDL and u-blox streams into the unmodified state
+ *          estimator, whose SerialData output is fed to the unmodified MainMCU
+ *          controls the way state_est_rx.c and run_controls.c do on target.
+ *
+ *          Frames follow the estimator: the flat frame is x up, y north,
+ *          z west with its origin at the pad, and body x points out the nose.
+ */
+#ifndef __SIM_H__
+#define __SIM_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+// Nominal vehicle and environment
+typedef struct {
+    double mass_wet;            // kg
+    double mass_prop;           // kg
+    double ixx_wet, ixx_dry;    // roll inertia, kg m^2
+    double iyy_wet, iyy_dry;    // pitch/yaw inertia, kg m^2
+    double ref_area;            // m^2
+    double ref_length;          // m, used for damping
+    double cd;                  // axial drag coefficient
+    double cn_alpha;            // normal force slope, 1/rad
+    double static_margin;       // m, CP aft of CG
+    double pitch_damping;       // Cmq-like damping coefficient
+    double roll_damping;
+    double roll_arm;            // m, vane to rocket axis
+    double vane_arm;            // m, vanes aft of CG
+    double servo_tau;           // s, first order servo lag
+    double rail_length;         // m
+    double launch_lat, launch_lon, launch_alt;  // deg, deg, m
+    double mag_ned[3];          // local field, gauss
+} SimVehicle;
+
+// One-sigma dispersions, all applied as Gaussian unless noted
+typedef struct {
+    double thrust_scale;        // fraction
+    double burn_time_scale;     // fraction
+    double mass;                // fraction
+    double cd;                  // fraction
+    double cn_alpha;            // fraction
+    double vane_gain;           // fraction
+    double thrust_misalign;     // deg
+    double rail_tilt;           // deg, random azimuth
+    double wind_max;            // m/s, uniform speed and heading
+    double accel_bias;          // m/s^2
+    double gyro_bias;           // deg/s
+    double accel_noise;         // m/s^2 per sample
+    double gyro_noise;          // deg/s per sample
+    double gps_noise_h;         // m
+    double gps_noise_v;         // m
+    double baro_noise;          // Pa
+    double mag_noise;           // gauss
+    double mag_hard_iron;       // gauss
+} SimDispersion;
+
+typedef enum {
+    SIM_FEEDBACK_ESTIMATOR,     // controls see the estimator output, as on target
+    SIM_FEEDBACK_TRUTH          // controls see the true state, the default
+} SimFeedback;
+
+typedef struct {
+    SimVehicle vehicle;
+    SimDispersion dispersion;
+    SimFeedback feedback;
+    uint64_t seed;
+    double dt;                  // s, dynamics step
+    uint32_t estimator_period_ms;
+    uint32_t controls_period_ms;
+    uint32_t gps_period_ms;
+    double go_time;             // s, 'GO' sent to the estimator
+    double ignition_time;       // s
+    double coast_after_apogee;  // s
+    double max_time;            // s
+} SimConfig;
+
+// Metrics of one run, NAN where the run never got there
+typedef struct {
+    double apogee;              // m above the pad
+    double apogee_time;         // s after ignition
+    double apogee_drift;        // m, horizontal distance from the pad
+    double max_speed;           // m/s
+    double max_q;               // Pa
+    double max_tilt;            // deg from vertical while under thrust
+    double max_rate;            // deg/s
+    double burnout_roll_rate;   // deg/s
+    double max_vane;            // deg, actual deflection behind the servo limit and lag
+    double vane_saturation;     // % of controls cycles with a vane at the limit
+    double launch_detect_delay; // s from liftoff to estimator FASTASCENT
+    double est_pos_error;       // m at apogee
+    double est_vel_error;       // m/s at apogee, body frame
+    double est_final_state;     // RocketState at the end of the run
+    double runtime_ms;          // wall clock of the run
+} SimResult;
+
+#define SIM_RESULT_FIELDS (sizeof(SimResult) / sizeof(double))
+
+extern const char *const sim_result_names[SIM_RESULT_FIELDS];
+
+void sim_default_config(SimConfig *cfg);
+int sim_run(const SimConfig *cfg, uint32_t run_index, SimResult *result, FILE *trace);
+
+#endif /* __SIM_H__ */
@@ -0,0 +1,55 @@
+/**
+ * @file sim_rng.h
+ * @brief Seedable random numbers for the simulator
+ *
+ * @details Every run derives its own stream from the base seed and the run
+ *          index, so results do not depend on which worker executed a run or
+ *          in which order.
+ */
+#ifndef __SIM_RNG_H__
+#define __SIM_RNG_H__
+
+#include <math.h>
+#include <stdint.h>
+
+typedef struct {
+    uint64_t state;
+} SimRng;
+
+static inline uint64_t sim_splitmix64(uint64_t *x) {
+    uint64_t z = (*x += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+static inline void sim_rng_seed(SimRng *rng, uint64_t seed, uint64_t stream) {
+    uint64_t x = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+    rng->state = sim_splitmix64(&x);
+    if (rng->state == 0) {
+        rng->state = 1;
+    }
+}
+
+static inline uint64_t sim_rng_u64(SimRng *rng) {
+    uint64_t x = rng->state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    rng->state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+// Uniform in [0, 1)
+static inline double sim_rng_uniform(SimRng *rng) {
+    return (sim_rng_u64(rng) >> 11) * (1.0 / 9007199254740992.0);
+}
+
+// Standard normal, Box-Muller
+static inline double sim_rng_normal(SimRng *rng) {
+    double u1 = 1.0 - sim_rng_uniform(rng);
+    double u2 = sim_rng_uniform(rng);
+    return sqrt(-2.0 * log(u1)) * cos(2.0 * M_PI * u2);
+}
+
+#endif /* __SIM_RNG_H__ */
@@ -0,0 +1,28 @@
+/**
+ * @file stats.h
+ * @brief Dispersion statistics over Monte Carlo results
+ */
+#ifndef __STATS_H__
+#define __STATS_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "sim.h"
+
+typedef struct {
+    uint32_t count;     // runs where the metric is defined
+    double mean;
+    double std;
+    double min;
+    double p05;
+    double p50;
+    double p95;
+    double max;
+} SimStat;
+
+void sim_stats_compute(const SimResult *results, const uint8_t *valid, uint32_t n, SimStat stats[SIM_RESULT_FIELDS]);
+void sim_stats_print(FILE *out, const SimStat stats[SIM_RESULT_FIELDS]);
+void sim_results_write_csv(FILE *out, const SimResult *results, const uint8_t *valid, uint32_t n);
+
+#endif /* __STATS_H__ */
@@ -0,0 +1,383 @@
+/**
+ * @file consistency.c
+ * @brief NEES and NIS consistency of the flight EKF over Monte Carlo runs
+ *
+ * @details The estimator runs through state_machine_run() as in sim_run(),
+ *          with 'GO' typed at go_time, so the pad calibration, the flight EKF
+ *          setup, launch detection and the flight phases are those of the
+ *          flight code. The metrics are taken once the state machine has left
+ *          ARMED. The controls see the true state, as in sim_run() by default,
+ *          and a run uses the same streams as sim_run() with its index, so it
+ *          flies the same trajectory.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "main.h"
+#include "controls.h"
+#include "consistency.h"
+#include "dynamics.h"
+#include "sensor_models.h"
+
+#define CONSISTENCY_NEES_STATES 6   // x, vx, y, vy, z, vz; the baro bias has no truth
+
+const char *const consistency_metric_names[CONSISTENCY_METRICS] = {
+    "nees_x",
+    "nees_vx",
+    "nees_y",
+    "nees_vy",
+    "nees_z",
+    "nees_vz",
+    "nees",
+    "nis_gnss",
+    "nis_baro",
+};
+
+/**
+ * @brief Normalized estimation error squared of the position and velocity states
+ * @param e Error of x, vx, y, vy, z and vz
+ * @param P Flight EKF covariance, MAX_FLIGHT_DIM x MAX_FLIGHT_DIM row major
+ * @return e' P^-1 e over the six states, NAN if their block is not positive definite
+ */
+static double nees(const double *e, const float32_t *P) {
+    const int n = CONSISTENCY_NEES_STATES;
+    double L[CONSISTENCY_NEES_STATES][CONSISTENCY_NEES_STATES];
+    double y[CONSISTENCY_NEES_STATES];
+    double sum = 0.0;
+
+    // P = L L', then |L^-1 e|^2
+    for (int j = 0; j < n; j++) {
+        double d = P[j * MAX_FLIGHT_DIM + j];
+        for (int k = 0; k < j; k++) {
+            d -= L[j][k] * L[j][k];
+        }
+        if (!(d > 0.0)) {
+            return NAN;
+        }
+        L[j][j] = sqrt(d);
+        for (int i = j + 1; i < n; i++) {
+            double v = P[i * MAX_FLIGHT_DIM + j];
+            for (int k = 0; k < j; k++) {
+                v -= L[i][k] * L[j][k];
+            }
+            L[i][j] = v / L[j][j];
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        double v = e[i];
+        for (int k = 0; k < i; k++) {
+            v -= L[i][k] * y[k];
+        }
+        y[i] = v / L[i][i];
+        sum += y[i] * y[i];
+    }
+    return sum;
+}
+
+static void epoch_add(ConsistencyEpoch *epoch, ConsistencyMetric metric, double value, uint32_t dof) {
+    if (isfinite(value)) {
+        epoch->sum[metric] += value;
+        epoch->dof[metric] += dof;
+    }
+}
+
+// Only the last cycle of an epoch is kept for the NEES
+static void epoch_set(ConsistencyEpoch *epoch, ConsistencyMetric metric, double value, uint32_t dof) {
+    epoch->sum[metric] = 0.0;
+    epoch->dof[metric] = 0;
+    epoch_add(epoch, metric, value, dof);
+}
+
+/**
+ * @brief Flies one dispersed run and records the NEES and NIS of the flight EKF
+ * @param cfg Simulation configuration
+ * @param run_index Selects the dispersion and noise streams, as in sim_run()
+ * @param run Receives the sums of each epoch after liftoff
+ * @return 1 on completion
+ * @details Must run at most once per process, like sim_run().
+ */
+int consistency_run(const SimConfig *cfg, uint32_t run_index, ConsistencyRun *run) {
+    SimRng dyn_rng, sens_rng;
+    sim_rng_seed(&dyn_rng, cfg->seed, 2ULL * run_index);
+    sim_rng_seed(&sens_rng, cfg->seed, 2ULL * run_index + 1);
+
+    controller ctrl;
+    initialize_controls(&ctrl);
+
+    double curve[DYN_THRUST_POINTS];
+    for (int i = 0; i < DYN_THRUST_POINTS; i++) {
+        curve[i] = ctrl.thrust_curve[i];
+    }
+
+    DynModel model;
+    DynState st;
+    dyn_init(&model, &st, cfg, curve, &dyn_rng);
+
+    SimSensors sens;
+    sensor_models_init(&sens, cfg, &sens_rng);
+
+    ReplaySample sample;
+    SimRawReadings raw;
+    memset(&sample, 0, sizeof(sample));
+    memset(&raw, 0, sizeof(raw));
+    sensor_models_imu(&sens, &model, &st, &sample, &raw);
+    sensor_models_gps(&sens, &st, 0, &sample);
+
+    replay_sample = &sample;
+    host_hal_set_tick(0);
+    sensors_init(&sensors);
+    state_machine_init();
+
+    memset(run, 0, sizeof(*run));
+
+    const double est_period = cfg->estimator_period_ms / 1000.0;
+    const double ctrl_period = cfg->controls_period_ms / 1000.0;
+    const double gps_period = cfg->gps_period_ms / 1000.0;
+    double next_est = 0.0;
+    double next_gps = gps_period;
+    double next_ctrl = 0.0;
+    double ctrl_start = -1.0;
+    double apogee_time = -1.0;
+    int go_sent = 0;
+    float vane_cmd[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const double eps = 1e-9;
+
+    for (uint64_t step = 0;; step++) {
+        double t = step * cfg->dt;
+
+        if (t + eps >= next_est) {
+            uint32_t t_ms = (uint32_t)llround(t * 1000.0);
+            next_est += est_period;
+
+            sample.t_ms = t_ms;
+            sensor_models_imu(&sens, &model, &st, &sample, &raw);
+            sensor_models_baro_mag(&sens, &st, &raw);
+            sample.pressure = (float32_t)llround(raw.pressure);
+            for (int i = 0; i < 3; i++) {
+                sample.mag[i] = (float32_t)raw.mag[i];
+            }
+            sample.mag_valid = 1;
+            if (t + eps >= next_gps) {
+                sensor_models_gps(&sens, &st, t_ms, &sample);
+                next_gps += gps_period;
+            }
+            host_hal_set_tick(t_ms);
+            if (!go_sent && t + eps >= cfg->go_time) {
+                host_uart_inject(&huart3, (const uint8_t *)"GO", 2);
+                go_sent = 1;
+            }
+
+            // A flight state fuses each new fix once and every baro reading
+            uint32_t gnss_updates = fekf.health.accepted + fekf.health.rejected;
+            uint32_t baro_updates = fekf.baro_health.accepted + fekf.baro_health.rejected;
+
+            state_machine_run();
+
+            if (model.launched && rocket_state > ARMED) {
+                uint32_t epoch = (uint32_t)((t - model.liftoff_time) * 1000.0 / CONSISTENCY_EPOCH_MS);
+                if (epoch < CONSISTENCY_MAX_EPOCHS) {
+                    ConsistencyEpoch *e = &run->epochs[epoch];
+                    const float32_t *x = fekf.x_n.pData;
+                    const float32_t *P = fekf.P_n.pData;
+                    double v_body[3], err[CONSISTENCY_NEES_STATES];
+
+                    dyn_rotate_to_body(st.q, st.v, v_body);
+                    for (int i = 0; i < 3; i++) {
+                        err[2 * i] = x[2 * i] - st.r[i];
+                        err[2 * i + 1] = x[2 * i + 1] - v_body[i];
+                    }
+                    for (int i = 0; i < CONSISTENCY_NEES_STATES; i++) {
+                        epoch_set(e, CONSISTENCY_NEES_X + i, err[i] * err[i] / P[i * MAX_FLIGHT_DIM + i], 1);
+                    }
+                    epoch_set(e, CONSISTENCY_NEES, nees(err, P), CONSISTENCY_NEES_STATES);
+                    if (fekf.health.accepted + fekf.health.rejected != gnss_updates) {
+                        epoch_add(e, CONSISTENCY_NIS_GNSS, fekf.health.nis, fekf.nz);
+                    }
+                    if (fekf.baro_health.accepted + fekf.baro_health.rejected != baro_updates) {
+                        epoch_add(e, CONSISTENCY_NIS_BARO, fekf.baro_health.nis, 1);
+                    }
+                    run->n_epochs = epoch + 1;
+                }
+            }
+        }
+
+        if (ctrl_start < 0.0 && model.launched) {
+            ctrl_start = t;
+            next_ctrl = t;
+        }
+        if (ctrl_start >= 0.0 && t + eps >= next_ctrl) {
+            float state[9];
+            double v_body[3];
+            next_ctrl += ctrl_period;
+
+            // The true state in the convention of the gains, as controls_state() in sim_run.c
+            dyn_rotate_to_body(st.q, st.v, v_body);
+            for (int i = 0; i < 3; i++) {
+                state[i] = v_body[i];
+                state[i + 3] = st.w[i];
+                state[i + 6] = st.q[i + 1];
+            }
+            run_controls(&ctrl, state, (float)(t - ctrl_start));
+            for (int i = 0; i < 4; i++) {
+                vane_cmd[i] = isfinite(ctrl.vane_deflections[i]) ? ctrl.vane_deflections[i] : 0.0f;
+            }
+        }
+
+        dyn_step(&model, &st, t, cfg->dt, vane_cmd);
+
+        if (model.launched) {
+            if (apogee_time < 0.0 && st.v[0] < 0.0) {
+                apogee_time = t;
+            }
+            if (apogee_time >= 0.0 && t > apogee_time + cfg->coast_after_apogee) {
+                break;
+            }
+            if (st.r[0] < -1.0) {
+                break;
+            }
+        }
+        if (t >= cfg->max_time) {
+            break;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Quantile of the chi-square distribution
+ * @param dof Degrees of freedom
+ * @param p Probability, in (0, 1)
+ * @return x with P(X <= x) = p, by the Wilson-Hilferty cube root normal
+ *         approximation, within a fraction of a percent from a few degrees
+ *         of freedom up
+ */
+double consistency_chi2_quantile(double dof, double p) {
+    // Standard normal quantile by bisection of erfc, p is never near 0 or 1 here
+    double lo = -10.0, hi = 10.0;
+    for (int i = 0; i < 64; i++) {
+        double mid = 0.5 * (lo + hi);
+        if (0.5 * erfc(-mid / M_SQRT2) < p) {
+            lo = mid;
+        } else {
+            hi = mid;
+        }
+    }
+    double z = 0.5 * (lo + hi);
+    double c = 2.0 / (9.0 * dof);
+    double r = 1.0 - c + z * sqrt(c);
+    return r > 0.0 ? dof * r * r * r : 0.0;
+}
+
+/**
+ * @brief Averages one metric of one epoch over the runs
+ * @return Sum over degrees of freedom, NAN if no run has a sample, with the
+ *         interval of the average in lo and hi
+ */
+static double epoch_average(const ConsistencyRun *runs, const uint8_t *valid, uint32_t n, uint32_t epoch,
+                            ConsistencyMetric metric, double *lo, double *hi) {
+    double sum = 0.0;
+    double dof = 0.0;
+
+    for (uint32_t r = 0; r < n; r++) {
+        if (valid[r] && epoch < runs[r].n_epochs) {
+            sum += runs[r].epochs[epoch].sum[metric];
+            dof += runs[r].epochs[epoch].dof[metric];
+        }
+    }
+    if (dof == 0.0) {
+        *lo = *hi = NAN;
+        return NAN;
+    }
+    *lo = consistency_chi2_quantile(dof, 0.5 * (1.0 - CONSISTENCY_CONFIDENCE)) / dof;
+    *hi = consistency_chi2_quantile(dof, 0.5 * (1.0 + CONSISTENCY_CONFIDENCE)) / dof;
+    return sum / dof;
+}
+
+/**
+ * @brief Grades every metric against its per-epoch intervals and prints the report
+ * @param out Destination of the report
+ * @param runs Results of every run
+ * @param valid Nonzero for the runs that completed
+ * @param n Number of runs
+ * @param stats Receives the grade of each metric
+ * @return 0 if every metric passed, 1 otherwise
+ */
+int consistency_report(FILE *out, const ConsistencyRun *runs, const uint8_t *valid, uint32_t n,
+                       ConsistencyStat stats[CONSISTENCY_METRICS]) {
+    uint32_t n_epochs = 0;
+    uint32_t n_valid = 0;
+    int passed = 1;
+
+    for (uint32_t r = 0; r < n; r++) {
+        if (valid[r]) {
+            n_valid++;
+            n_epochs = runs[r].n_epochs > n_epochs ? runs[r].n_epochs : n_epochs;
+        }
+    }
+
+    fprintf(out, "%-12s %8s %8s %8s %10s  %s\n", "metric", "epochs", "inside", "above", "mean/dof", "result");
+    for (int m = 0; m < CONSISTENCY_METRICS; m++) {
+        ConsistencyStat *s = &stats[m];
+        double sum = 0.0, dof = 0.0;
+
+        memset(s, 0, sizeof(*s));
+        for (uint32_t k = 0; k < n_epochs; k++) {
+            double lo, hi;
+            double avg = epoch_average(runs, valid, n, k, m, &lo, &hi);
+            if (isnan(avg)) {
+                continue;
+            }
+            s->epochs++;
+            s->inside += avg >= lo && avg <= hi;
+            s->above += avg > hi;
+        }
+        for (uint32_t r = 0; r < n; r++) {
+            for (uint32_t k = 0; valid[r] && k < runs[r].n_epochs; k++) {
+                sum += runs[r].epochs[k].sum[m];
+                dof += runs[r].epochs[k].dof[m];
+            }
+        }
+        s->mean = dof > 0.0 ? sum / dof : NAN;
+
+        int ok = s->epochs > 0 && s->inside >= CONSISTENCY_MIN_INSIDE * s->epochs;
+        passed &= ok;
+        fprintf(out, "%-12s %8u %7.1f%% %7.1f%% %10.4g  %s\n", consistency_metric_names[m], s->epochs,
+                s->epochs > 0 ? 100.0 * s->inside / s->epochs : 0.0,
+                s->epochs > 0 ? 100.0 * s->above / s->epochs : 0.0, s->mean, ok ? "ok" : "FAILED");
+    }
+    fprintf(out, "%u runs, %.0f%% interval per %d ms epoch, a metric needs %.0f%% of its epochs inside: %s\n",
+            n_valid, 100.0 * CONSISTENCY_CONFIDENCE, CONSISTENCY_EPOCH_MS, 100.0 * CONSISTENCY_MIN_INSIDE,
+            passed ? "PASSED" : "FAILED");
+    return passed ? 0 : 1;
+}
+
+/**
+ * @brief Writes one CSV row per epoch with each metric's average and interval
+ */
+void consistency_write_csv(FILE *out, const ConsistencyRun *runs, const uint8_t *valid, uint32_t n) {
+    uint32_t n_epochs = 0;
+
+    for (uint32_t r = 0; r < n; r++) {
+        if (valid[r] && runs[r].n_epochs > n_epochs) {
+            n_epochs = runs[r].n_epochs;
+        }
+    }
+
+    fprintf(out, "t_s");
+    for (int m = 0; m < CONSISTENCY_METRICS; m++) {
+        fprintf(out, ",%s,%s_lo,%s_hi", consistency_metric_names[m], consistency_metric_names[m],
+                consistency_metric_names[m]);
+    }
+    fprintf(out, "\n");
+
+    for (uint32_t k = 0; k < n_epochs; k++) {
+        fprintf(out, "%.3f", (k + 1) * CONSISTENCY_EPOCH_MS / 1000.0);
+        for (int m = 0; m < CONSISTENCY_METRICS; m++) {
+            double lo, hi;
+            double avg = epoch_average(runs, valid, n, k, m, &lo, &hi);
+            fprintf(out, ",%.6g,%.6g,%.6g", avg, lo, hi);
+        }
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,333 @@
+/**
+ * @file dynamics.c
+ * @brief 6-DOF rigid body model of the jet vanes rocket
+ *
+ * @details Thrust follows the controller's thrust curve scaled by the run's
+ *          dispersions, with propellant mass and inertia depleting in
+ *          proportion to delivered impulse. Aerodynamics are an axial drag
+ *          term, a linear normal force acting at the centre of pressure and
+ *          rate damping in an exponential atmosphere. Each jet vane produces
+ *          a side force of 5% of thrust at 30 degrees, the inverse of the
+ *          model in sideforce_to_vane_angle(), behind a first order servo.
+ *          The rocket sits on the pad until thrust exceeds weight and is held
+ *          to the rail direction until it has travelled the rail length.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "dynamics.h"
+
+#define GRAVITY         9.81
+#define VANE_MAX_DEG    30.0
+#define VANE_FORCE_FRAC 0.05
+#define DEG2RAD         (M_PI / 180.0)
+
+#define STATE_SIZE 13
+
+/**
+ * @brief Builds the body to flat rotation matrix of a unit quaternion
+ */
+static void quat_to_dcm(const double q[4], double m[3][3]) {
+    double w = q[0], x = q[1], y = q[2], z = q[3];
+
+    m[0][0] = 1 - 2 * (y * y + z * z);
+    m[0][1] = 2 * (x * y - w * z);
+    m[0][2] = 2 * (x * z + w * y);
+    m[1][0] = 2 * (x * y + w * z);
+    m[1][1] = 1 - 2 * (x * x + z * z);
+    m[1][2] = 2 * (y * z - w * x);
+    m[2][0] = 2 * (x * z - w * y);
+    m[2][1] = 2 * (y * z + w * x);
+    m[2][2] = 1 - 2 * (x * x + y * y);
+}
+
+void dyn_rotate_to_flat(const double q[4], const double v_body[3], double v_flat[3]) {
+    double m[3][3];
+    quat_to_dcm(q, m);
+    for (int i = 0; i < 3; i++) {
+        v_flat[i] = m[i][0] * v_body[0] + m[i][1] * v_body[1] + m[i][2] * v_body[2];
+    }
+}
+
+void dyn_rotate_to_body(const double q[4], const double v_flat[3], double v_body[3]) {
+    double m[3][3];
+    quat_to_dcm(q, m);
+    for (int i = 0; i < 3; i++) {
+        v_body[i] = m[0][i] * v_flat[0] + m[1][i] * v_flat[1] + m[2][i] * v_flat[2];
+    }
+}
+
+/**
+ * @brief Impulse delivered by the nominal curve after tau seconds
+ */
+static double curve_impulse(const double curve[DYN_THRUST_POINTS], double tau) {
+    double impulse = 0.0;
+
+    if (tau <= 0.0) {
+        return 0.0;
+    }
+
+    for (int k = 0; k < DYN_THRUST_POINTS - 1; k++) {
+        double f = tau - k;
+        if (f >= 1.0) {
+            impulse += 0.5 * (curve[k] + curve[k + 1]);
+        } else {
+            impulse += curve[k] * f + 0.5 * (curve[k + 1] - curve[k]) * f * f;
+            break;
+        }
+    }
+    return impulse;
+}
+
+/**
+ * @brief Thrust at simulation time t
+ * @param model Vehicle model
+ * @param t Simulation time in seconds
+ * @return Thrust in newtons, zero before ignition and after burnout
+ */
+double dyn_thrust(const DynModel *model, double t) {
+    double tau = (t - model->ignition_time) / model->burn_time_scale;
+
+    if (tau < 0.0 || tau >= DYN_THRUST_POINTS - 1) {
+        return 0.0;
+    }
+
+    int k = (int)tau;
+    double f = tau - k;
+    return model->thrust_scale * (model->thrust_curve[k] + (model->thrust_curve[k + 1] - model->thrust_curve[k]) * f);
+}
+
+/**
+ * @brief Fraction of the propellant burnt at simulation time t
+ */
+static double prop_fraction(const DynModel *model, double t) {
+    double tau = (t - model->ignition_time) / model->burn_time_scale;
+    return curve_impulse(model->thrust_curve, tau) / model->total_impulse;
+}
+
+/**
+ * @brief Samples this run's dispersions and places the rocket on the pad
+ * @param model Model to initialize
+ * @param state Receives the pad state
+ * @param cfg Simulation configuration
+ * @param thrust_curve Nominal thrust at 1 s steps from ignition
+ * @param rng Stream of the run
+ */
+void dyn_init(DynModel *model, DynState *state, const SimConfig *cfg,
+              const double thrust_curve[DYN_THRUST_POINTS], SimRng *rng) {
+    const SimVehicle *veh = &cfg->vehicle;
+    const SimDispersion *d = &cfg->dispersion;
+
+    memset(model, 0, sizeof(*model));
+    memset(state, 0, sizeof(*state));
+
+    model->nominal = *veh;
+    memcpy(model->thrust_curve, thrust_curve, sizeof(model->thrust_curve));
+    model->total_impulse = curve_impulse(thrust_curve, DYN_THRUST_POINTS);
+
+    model->thrust_scale = 1.0 + d->thrust_scale * sim_rng_normal(rng);
+    model->burn_time_scale = 1.0 + d->burn_time_scale * sim_rng_normal(rng);
+    double mass_scale = 1.0 + d->mass * sim_rng_normal(rng);
+    model->mass_wet = veh->mass_wet * mass_scale;
+    model->mass_prop = veh->mass_prop * model->thrust_scale * model->burn_time_scale;
+    model->cd = veh->cd * (1.0 + d->cd * sim_rng_normal(rng));
+    model->cn_alpha = veh->cn_alpha * (1.0 + d->cn_alpha * sim_rng_normal(rng));
+    model->vane_gain = 1.0 + d->vane_gain * sim_rng_normal(rng);
+    model->misalign[0] = d->thrust_misalign * DEG2RAD * sim_rng_normal(rng);
+    model->misalign[1] = d->thrust_misalign * DEG2RAD * sim_rng_normal(rng);
+
+    double wind_speed = d->wind_max * sim_rng_uniform(rng);
+    double wind_heading = 2.0 * M_PI * sim_rng_uniform(rng);
+    model->wind[0] = 0.0;
+    model->wind[1] = wind_speed * cos(wind_heading);
+    model->wind[2] = wind_speed * sin(wind_heading);
+
+    model->ignition_time = cfg->ignition_time;
+
+    // Tilt the rail about a random horizontal axis
+    double tilt = fabs(d->rail_tilt * DEG2RAD * sim_rng_normal(rng));
+    double azimuth = 2.0 * M_PI * sim_rng_uniform(rng);
+    state->q[0] = cos(tilt / 2);
+    state->q[1] = 0.0;
+    state->q[2] = sin(tilt / 2) * cos(azimuth);
+    state->q[3] = sin(tilt / 2) * sin(azimuth);
+
+    double g_flat[3] = {GRAVITY, 0.0, 0.0};
+    dyn_rotate_to_body(state->q, g_flat, model->specific_force);
+}
+
+/**
+ * @brief Computes the state derivative
+ * @param model Vehicle model
+ * @param t Simulation time
+ * @param y State as [r, v, q, w]
+ * @param dy Receives the derivative
+ * @param constrained Non-zero while on the rail
+ */
+static void derivative(DynModel *model, double t, const double y[STATE_SIZE], double dy[STATE_SIZE], int constrained) {
+    const SimVehicle *veh = &model->nominal;
+    const double *v = &y[3];
+    const double *q = &y[6];
+    const double *w = &y[10];
+
+    double frac = prop_fraction(model, t);
+    double mass = model->mass_wet - model->mass_prop * frac;
+    double mass_ratio = model->mass_wet / veh->mass_wet;
+    double ixx = mass_ratio * (veh->ixx_wet + (veh->ixx_dry - veh->ixx_wet) * frac);
+    double iyy = mass_ratio * (veh->iyy_wet + (veh->iyy_dry - veh->iyy_wet) * frac);
+
+    double thrust = dyn_thrust(model, t);
+    double force[3] = {thrust, thrust * model->misalign[0], thrust * model->misalign[1]};
+    double moment[3] = {0.0, 0.0, 0.0};
+
+    // Thrust misalignment acts at the nozzle, taken at the vanes
+    moment[1] += veh->vane_arm * force[2];
+    moment[2] -= veh->vane_arm * force[1];
+
+    // Aerodynamics on the air-relative velocity
+    double v_rel_flat[3] = {v[0] - model->wind[0], v[1] - model->wind[1], v[2] - model->wind[2]};
+    double v_rel[3];
+    dyn_rotate_to_body(q, v_rel_flat, v_rel);
+    double speed = sqrt(v_rel[0] * v_rel[0] + v_rel[1] * v_rel[1] + v_rel[2] * v_rel[2]);
+    double rho = 1.225 * exp(-(veh->launch_alt + y[0]) / 8500.0);
+    double qbar = 0.5 * rho * speed * speed;
+
+    if (speed > 1.0) {
+        double fx = -qbar * veh->ref_area * model->cd * v_rel[0] / speed;
+        double fy = -qbar * veh->ref_area * model->cn_alpha * v_rel[1] / speed;
+        double fz = -qbar * veh->ref_area * model->cn_alpha * v_rel[2] / speed;
+        force[0] += fx;
+        force[1] += fy;
+        force[2] += fz;
+        moment[1] += veh->static_margin * fz;
+        moment[2] -= veh->static_margin * fy;
+
+        double damping = 0.25 * rho * speed * veh->ref_area * veh->ref_length * veh->ref_length;
+        moment[0] -= damping * veh->roll_damping * w[0];
+        moment[1] -= damping * veh->pitch_damping * w[1];
+        moment[2] -= damping * veh->pitch_damping * w[2];
+    }
+
+    // Jet vanes in the layout of controls.h, 0 and 1 roll, 2 and 3 deflect
+    // in opposite senses for a side force along body y, i.e. about the yaw
+    // (body z) axis. Positive deflections oppose the moment passed to
+    // moment_to_sideforce(), which is K (x - x0) without the LQR minus sign.
+    double vane_force[4];
+    for (int i = 0; i < 4; i++) {
+        vane_force[i] = model->vane_gain * (model->vane[i] / VANE_MAX_DEG) * VANE_FORCE_FRAC * thrust;
+    }
+    double side = vane_force[2] - vane_force[3];
+    force[1] += side;
+    moment[0] -= (vane_force[0] + vane_force[1]) * veh->roll_arm;
+    moment[2] -= veh->vane_arm * side;
+
+    double accel_body[3] = {force[0] / mass, force[1] / mass, force[2] / mass};
+    double accel[3];
+    dyn_rotate_to_flat(q, accel_body, accel);
+    accel[0] -= GRAVITY;
+
+    dy[0] = v[0];
+    dy[1] = v[1];
+    dy[2] = v[2];
+
+    if (constrained) {
+        // Only the component along the rail, never backwards into the pad
+        double rail[3], rail_body[3] = {1.0, 0.0, 0.0};
+        dyn_rotate_to_flat(q, rail_body, rail);
+        double a_rail = accel[0] * rail[0] + accel[1] * rail[1] + accel[2] * rail[2];
+        if (a_rail < 0.0 && (v[0] * rail[0] + v[1] * rail[1] + v[2] * rail[2]) <= 0.0) {
+            a_rail = 0.0;
+        }
+        for (int i = 0; i < 3; i++) {
+            accel[i] = a_rail * rail[i];
+        }
+        memset(&dy[6], 0, 7 * sizeof(double));
+    } else {
+        dy[6] = -0.5 * (q[1] * w[0] + q[2] * w[1] + q[3] * w[2]);
+        dy[7] = 0.5 * (q[0] * w[0] + q[2] * w[2] - q[3] * w[1]);
+        dy[8] = 0.5 * (q[0] * w[1] + q[3] * w[0] - q[1] * w[2]);
+        dy[9] = 0.5 * (q[0] * w[2] + q[1] * w[1] - q[2] * w[0]);
+
+        // Euler's equations with Iyy == Izz
+        dy[10] = moment[0] / ixx;
+        dy[11] = (moment[1] - (ixx - iyy) * w[2] * w[0]) / iyy;
+        dy[12] = (moment[2] - (iyy - ixx) * w[0] * w[1]) / iyy;
+    }
+
+    dy[3] = accel[0];
+    dy[4] = accel[1];
+    dy[5] = accel[2];
+
+    // What an accelerometer at the CG measures
+    double sf_flat[3] = {accel[0] + GRAVITY, accel[1], accel[2]};
+    dyn_rotate_to_body(q, sf_flat, model->specific_force);
+    model->thrust = thrust;
+    model->dynamic_pressure = qbar;
+}
+
+/**
+ * @brief Advances the model by one RK4 step
+ * @param model Vehicle model, its servo state and outputs are updated
+ * @param state State to advance
+ * @param t Simulation time at the start of the step
+ * @param dt Step in seconds
+ * @param vane_cmd Commanded vane deflections in degrees
+ */
+void dyn_step(DynModel *model, DynState *state, double t, double dt, const float vane_cmd[4]) {
+    double alpha = 1.0 - exp(-dt / model->nominal.servo_tau);
+    for (int i = 0; i < 4; i++) {
+        double cmd = fmax(-VANE_MAX_DEG, fmin(VANE_MAX_DEG, vane_cmd[i]));
+        model->vane[i] += (cmd - model->vane[i]) * alpha;
+    }
+
+    double y[STATE_SIZE], k1[STATE_SIZE], k2[STATE_SIZE], k3[STATE_SIZE], k4[STATE_SIZE], tmp[STATE_SIZE];
+    memcpy(&y[0], state->r, sizeof(state->r));
+    memcpy(&y[3], state->v, sizeof(state->v));
+    memcpy(&y[6], state->q, sizeof(state->q));
+    memcpy(&y[10], state->w, sizeof(state->w));
+
+    if (!model->launched) {
+        double up_body[3], up_flat[3] = {1.0, 0.0, 0.0};
+        dyn_rotate_to_body(state->q, up_flat, up_body);
+        double weight = model->mass_wet * GRAVITY * up_body[0];
+        if (dyn_thrust(model, t) <= weight) {
+            // Still on the pad, the pad reaction cancels thrust and gravity
+            double g_flat[3] = {GRAVITY, 0.0, 0.0};
+            dyn_rotate_to_body(state->q, g_flat, model->specific_force);
+            model->thrust = dyn_thrust(model, t);
+            model->dynamic_pressure = 0.0;
+            return;
+        }
+        model->launched = 1;
+        model->liftoff_time = t;
+    }
+
+    double travelled = sqrt(y[0] * y[0] + y[1] * y[1] + y[2] * y[2]);
+    int constrained = travelled < model->nominal.rail_length;
+
+    // Evaluate k1 last so the sensed outputs describe the start of the step
+    DynModel scratch = *model;
+    derivative(&scratch, t, y, k1, constrained);
+    for (int i = 0; i < STATE_SIZE; i++) tmp[i] = y[i] + 0.5 * dt * k1[i];
+    derivative(&scratch, t + 0.5 * dt, tmp, k2, constrained);
+    for (int i = 0; i < STATE_SIZE; i++) tmp[i] = y[i] + 0.5 * dt * k2[i];
+    derivative(&scratch, t + 0.5 * dt, tmp, k3, constrained);
+    for (int i = 0; i < STATE_SIZE; i++) tmp[i] = y[i] + dt * k3[i];
+    derivative(&scratch, t + dt, tmp, k4, constrained);
+    derivative(model, t, y, k1, constrained);
+
+    for (int i = 0; i < STATE_SIZE; i++) {
+        y[i] += dt / 6.0 * (k1[i] + 2.0 * k2[i] + 2.0 * k3[i] + k4[i]);
+    }
+
+    double norm = sqrt(y[6] * y[6] + y[7] * y[7] + y[8] * y[8] + y[9] * y[9]);
+    for (int i = 6; i < 10; i++) {
+        y[i] /= norm;
+    }
+
+    memcpy(state->r, &y[0], sizeof(state->r));
+    memcpy(state->v, &y[3], sizeof(state->v));
+    memcpy(state->q, &y[6], sizeof(state->q));
+    memcpy(state->w, &y[10], sizeof(state->w));
+}
@@ -0,0 +1,314 @@
+/**
+ * @file main.c
+ * @brief Monte Carlo driver for the software-in-the-loop simulator
+ *
+ * @details Runs the requested number of dispersed flights on a work-stealing
+ *          pool and prints per-metric dispersion statistics. A single run can
+ *          instead be traced step by step with --trace, and --check runs the
+ *          nominal flight as a sanity check of the closed loop. --consistency
+ *          grades the NEES and NIS of the flight EKF over the runs instead.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sim.h"
+#include "consistency.h"
+#include "pool.h"
+#include "stats.h"
+
+// Limits of the nominal sanity check, deg and deg/s. The nominal flight is
+// straight up without wind, so the controls should see a zero state.
+#define CHECK_MAX_TILT 0.5
+#define CHECK_MAX_RATE 0.5
+#define CHECK_MAX_VANE 0.5
+
+typedef struct {
+    const SimConfig *cfg;
+    SimResult *results;
+    uint8_t *valid;
+} MonteCarlo;
+
+static int monte_carlo_job(uint32_t index, void *ctx) {
+    MonteCarlo *mc = ctx;
+
+    if (!sim_run(mc->cfg, index, &mc->results[index], NULL)) {
+        return 1;
+    }
+    mc->valid[index] = 1;
+    return 0;
+}
+
+/**
+ * @brief Flies the nominal trajectory on true feedback and checks that the
+ *        controls stay quiet
+ * @param cfg Configuration, dispersions are disabled here
+ * @return 0 if the tilt, rate and vane deflection stay within limits
+ */
+static int nominal_check(SimConfig *cfg) {
+    SimResult result;
+
+    memset(&cfg->dispersion, 0, sizeof(cfg->dispersion));
+    cfg->feedback = SIM_FEEDBACK_TRUTH;
+    sim_run(cfg, 0, &result, NULL);
+
+    int ok = result.max_tilt <= CHECK_MAX_TILT && result.max_rate <= CHECK_MAX_RATE &&
+             result.max_vane <= CHECK_MAX_VANE;
+
+    printf("nominal: max_tilt %.3g deg, max_rate %.3g deg/s, max_vane %.3g deg, apogee %.0f m: %s\n",
+           result.max_tilt, result.max_rate, result.max_vane, result.apogee, ok ? "ok" : "FAILED");
+    return ok ? 0 : 1;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  --runs N           number of dispersed runs (default 1000)\n"
+            "  --jobs N           worker processes (default one per core)\n"
+            "  --seed N           base seed (default 1)\n"
+            "  --feedback MODE    controls input, estimator or truth (default truth)\n"
+            "  --nominal          disable all dispersions and noise\n"
+            "  --check            fly the nominal trajectory and check the controls stay at zero\n"
+            "  --consistency      grade the NEES and NIS of the flight EKF (default 100 runs)\n"
+            "  --wind MS          maximum wind speed (default 8)\n"
+            "  --ignition SEC     ignition time after power up (default 20)\n"
+            "  --csv FILE         write per-run results\n"
+            "  --trace RUN        simulate only RUN and write a per-step CSV trace\n"
+            "  --trace-file FILE  destination of --trace (default stdout)\n",
+            argv0);
+}
+
+static FILE *open_output(const char *path) {
+    if (strcmp(path, "-") == 0) {
+        return stdout;
+    }
+
+    FILE *out = fopen(path, "w");
+    if (out == NULL) {
+        perror(path);
+        exit(1);
+    }
+    return out;
+}
+
+typedef struct {
+    const SimConfig *cfg;
+    ConsistencyRun *runs;
+    uint8_t *valid;
+} Consistency;
+
+static int consistency_job(uint32_t index, void *ctx) {
+    Consistency *cc = ctx;
+
+    if (!consistency_run(cc->cfg, index, &cc->runs[index])) {
+        return 1;
+    }
+    cc->valid[index] = 1;
+    return 0;
+}
+
+/**
+ * @brief Runs the consistency harness on the pool and prints its report
+ * @param cfg Simulation configuration
+ * @param runs Number of dispersed runs
+ * @param jobs Worker processes
+ * @param csv_path If not NULL, receives the per-epoch averages and intervals
+ * @return 0 if every metric passed
+ */
+static int consistency_check(const SimConfig *cfg, uint32_t runs, long jobs, const char *csv_path) {
+    Consistency cc = {
+        .cfg = cfg,
+        .runs = pool_shared_alloc(runs * sizeof(ConsistencyRun)),
+        .valid = pool_shared_alloc(runs),
+    };
+    PoolWorkerStats *worker_stats = calloc(jobs, sizeof(PoolWorkerStats));
+
+    if (cc.runs == NULL || cc.valid == NULL || worker_stats == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    int failed = pool_run(runs, (unsigned)jobs, consistency_job, &cc, worker_stats);
+    if (failed < 0) {
+        fprintf(stderr, "failed to start the worker pool\n");
+        return 1;
+    }
+    if (failed > 0) {
+        fprintf(stderr, "%d of %u runs failed\n", failed, runs);
+    }
+
+    ConsistencyStat stats[CONSISTENCY_METRICS];
+    int status = consistency_report(stdout, cc.runs, cc.valid, runs, stats);
+
+    if (csv_path != NULL) {
+        FILE *csv = open_output(csv_path);
+        consistency_write_csv(csv, cc.runs, cc.valid, runs);
+        if (csv != stdout) {
+            fclose(csv);
+        }
+    }
+
+    free(worker_stats);
+    pool_shared_free(cc.runs, runs * sizeof(ConsistencyRun));
+    pool_shared_free(cc.valid, runs);
+    return status || failed != 0;
+}
+
+int main(int argc, char **argv) {
+    SimConfig cfg;
+    uint32_t runs = 0;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    const char *csv_path = NULL;
+    const char *trace_path = "-";
+    long trace_run = -1;
+    int check = 0;
+    int consistency = 0;
+
+    sim_default_config(&cfg);
+
+    static const struct option options[] = {
+        {"runs", required_argument, NULL, 'r'},
+        {"jobs", required_argument, NULL, 'j'},
+        {"seed", required_argument, NULL, 's'},
+        {"feedback", required_argument, NULL, 'f'},
+        {"nominal", no_argument, NULL, 'n'},
+        {"check", no_argument, NULL, 'k'},
+        {"consistency", no_argument, NULL, 'C'},
+        {"wind", required_argument, NULL, 'w'},
+        {"ignition", required_argument, NULL, 'i'},
+        {"csv", required_argument, NULL, 'c'},
+        {"trace", required_argument, NULL, 't'},
+        {"trace-file", required_argument, NULL, 'T'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'r': runs = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'j': jobs = strtol(optarg, NULL, 0); break;
+            case 's': cfg.seed = strtoull(optarg, NULL, 0); break;
+            case 'f':
+                if (strcmp(optarg, "truth") == 0) {
+                    cfg.feedback = SIM_FEEDBACK_TRUTH;
+                } else if (strcmp(optarg, "estimator") == 0) {
+                    cfg.feedback = SIM_FEEDBACK_ESTIMATOR;
+                } else {
+                    usage(argv[0]);
+                    return 1;
+                }
+                break;
+            case 'n': memset(&cfg.dispersion, 0, sizeof(cfg.dispersion)); break;
+            case 'k': check = 1; break;
+            case 'C': consistency = 1; break;
+            case 'w': cfg.dispersion.wind_max = strtod(optarg, NULL); break;
+            case 'i': cfg.ignition_time = strtod(optarg, NULL); break;
+            case 'c': csv_path = optarg; break;
+            case 't': trace_run = strtol(optarg, NULL, 0); break;
+            case 'T': trace_path = optarg; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (check) {
+        return nominal_check(&cfg);
+    }
+
+    if (trace_run >= 0) {
+        SimResult result;
+        FILE *trace = open_output(trace_path);
+        sim_run(&cfg, (uint32_t)trace_run, &result, trace);
+        if (trace != stdout) {
+            fclose(trace);
+        }
+
+        SimStat stats[SIM_RESULT_FIELDS];
+        uint8_t valid = 1;
+        sim_stats_compute(&result, &valid, 1, stats);
+        sim_stats_print(stderr, stats);
+        return 0;
+    }
+
+    if (jobs < 1) {
+        jobs = 1;
+    }
+    if (runs == 0) {
+        runs = consistency ? CONSISTENCY_RUNS : 1000;
+    }
+    if (consistency) {
+        return consistency_check(&cfg, runs, jobs, csv_path);
+    }
+
+    MonteCarlo mc = {
+        .cfg = &cfg,
+        .results = pool_shared_alloc(runs * sizeof(SimResult)),
+        .valid = pool_shared_alloc(runs),
+    };
+    PoolWorkerStats *worker_stats = calloc(jobs, sizeof(PoolWorkerStats));
+
+    if (mc.results == NULL || mc.valid == NULL || worker_stats == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    int failed = pool_run(runs, (unsigned)jobs, monte_carlo_job, &mc, worker_stats);
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    if (failed < 0) {
+        fprintf(stderr, "failed to start the worker pool\n");
+        return 1;
+    }
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    uint64_t steals = 0, stolen = 0;
+    for (long w = 0; w < jobs; w++) {
+        steals += worker_stats[w].steals;
+        stolen += worker_stats[w].stolen;
+    }
+
+    fprintf(stderr, "%u runs on %ld workers in %.2f s (%.1f runs/s), %d failed, %llu steals moved %llu runs\n",
+            runs, jobs, elapsed, elapsed > 0 ? runs / elapsed : 0.0, failed,
+            (unsigned long long)steals, (unsigned long long)stolen);
+
+    SimStat stats[SIM_RESULT_FIELDS];
+    sim_stats_compute(mc.results, mc.valid, runs, stats);
+    sim_stats_print(stdout, stats);
+
+    if (csv_path != NULL) {
+        FILE *csv = open_output(csv_path);
+        sim_results_write_csv(csv, mc.results, mc.valid, runs);
+        if (csv != stdout) {
+            fclose(csv);
+        }
+    }
+
+    int status = failed == 0 ? 0 : 1;
+
+    // The metrics of a run whose controls never started say nothing about them
+    int launched = 0;
+    for (uint32_t i = 0; i < runs; i++) {
+        if (mc.valid[i] && !isnan(mc.results[i].launch_detect_delay)) {
+            launched = 1;
+            break;
+        }
+    }
+    if (cfg.feedback == SIM_FEEDBACK_ESTIMATOR && !launched) {
+        fprintf(stderr, "error: the estimator reached FASTASCENT in none of the runs, the controls never started\n");
+        status = 1;
+    }
+
+    free(worker_stats);
+    pool_shared_free(mc.results, runs * sizeof(SimResult));
+    pool_shared_free(mc.valid, runs);
+    return status;
+}
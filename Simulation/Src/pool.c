@@ -0,0 +1,209 @@
+/**
+ * @file pool.c
+ * @brief Work-stealing pool of worker processes
+ *
+ * @details Jobs are the indices [0, n_jobs), dealt out as one contiguous range
+ *          per worker. A range lives in a single 64-bit word in shared memory
+ *          holding head and tail, so the owner pops from the head and thieves
+ *          take half of the remaining range from the tail, both with a CAS.
+ *          A thief only steals while its own range is empty and then
+ *          publishes the stolen range as its own. Indices are never handed
+ *          out twice, so a range word cannot return to an earlier value and
+ *          there is no ABA hazard.
+ *
+ *          Workers are processes rather than threads and every job runs in a
+ *          child forked from the worker, because the flight code keeps its
+ *          state in globals and function statics. Results are returned
+ *          through memory from pool_shared_alloc().
+ */
+
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "pool.h"
+
+typedef struct {
+    _Atomic uint64_t range;         // head in the high half, tail in the low half
+    PoolWorkerStats stats;
+} __attribute__((aligned(64))) PoolDeque;
+
+static inline uint64_t range_pack(uint32_t head, uint32_t tail) {
+    return ((uint64_t)head << 32) | tail;
+}
+
+static inline uint32_t range_head(uint64_t range) {
+    return (uint32_t)(range >> 32);
+}
+
+static inline uint32_t range_tail(uint64_t range) {
+    return (uint32_t)range;
+}
+
+/**
+ * @brief Allocates memory shared with forked workers and their children
+ * @param size Bytes to allocate, zero filled
+ * @return Mapping, or NULL on failure
+ */
+void *pool_shared_alloc(size_t size) {
+    void *ptr = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    return ptr == MAP_FAILED ? NULL : ptr;
+}
+
+void pool_shared_free(void *ptr, size_t size) {
+    if (ptr != NULL) {
+        munmap(ptr, size);
+    }
+}
+
+/**
+ * @brief Takes the next index from the worker's own range
+ * @return 1 with *index set, 0 if the range is empty
+ */
+static int pop_own(PoolDeque *self, uint32_t *index) {
+    uint64_t range = atomic_load(&self->range);
+
+    while (range_head(range) < range_tail(range)) {
+        uint64_t next = range_pack(range_head(range) + 1, range_tail(range));
+        if (atomic_compare_exchange_weak(&self->range, &range, next)) {
+            *index = range_head(range);
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Moves half of another worker's remaining range into our own
+ * @return 1 if anything was stolen, 0 if every other range is empty
+ */
+static int steal(PoolDeque *deques, unsigned n_workers, unsigned self_id, uint64_t *rng) {
+    *rng ^= *rng << 13;
+    *rng ^= *rng >> 7;
+    *rng ^= *rng << 17;
+    unsigned start = (unsigned)(*rng % n_workers);
+
+    for (unsigned i = 0; i < n_workers; i++) {
+        unsigned victim = (start + i) % n_workers;
+        if (victim == self_id) {
+            continue;
+        }
+
+        uint64_t range = atomic_load(&deques[victim].range);
+        while (range_head(range) < range_tail(range)) {
+            uint32_t head = range_head(range);
+            uint32_t tail = range_tail(range);
+            uint32_t take = (tail - head + 1) / 2;
+
+            if (atomic_compare_exchange_weak(&deques[victim].range, &range, range_pack(head, tail - take))) {
+                atomic_store(&deques[self_id].range, range_pack(tail - take, tail));
+                deques[self_id].stats.stolen += take;
+                deques[self_id].stats.steals++;
+                return 1;
+            }
+        }
+    }
+    return 0;
+}
+
+/**
+ * @brief Runs one job in a child process
+ * @return 0 if the child exited cleanly with status 0
+ */
+static int run_isolated(PoolJob job, void *ctx, uint32_t index) {
+    pid_t pid = fork();
+
+    if (pid < 0) {
+        perror("fork");
+        return -1;
+    }
+    if (pid == 0) {
+        _exit(job(index, ctx) == 0 ? 0 : 1);
+    }
+
+    int status;
+    if (waitpid(pid, &status, 0) < 0) {
+        return -1;
+    }
+    return WIFEXITED(status) && WEXITSTATUS(status) == 0 ? 0 : -1;
+}
+
+static void worker_main(PoolDeque *deques, unsigned n_workers, unsigned self_id, PoolJob job, void *ctx) {
+    uint64_t rng = 0x9E3779B97F4A7C15ULL * (self_id + 1);
+    uint32_t index;
+
+    for (;;) {
+        if (pop_own(&deques[self_id], &index)) {
+            if (run_isolated(job, ctx, index) != 0) {
+                deques[self_id].stats.failed++;
+            }
+            deques[self_id].stats.executed++;
+        } else if (!steal(deques, n_workers, self_id, &rng)) {
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Runs every job once across n_workers processes
+ * @param n_jobs Number of job indices
+ * @param n_workers Number of worker processes
+ * @param job Job body, executed in a forked child
+ * @param ctx Passed to every job
+ * @param stats Receives per-worker statistics, n_workers entries, may be NULL
+ * @return Number of failed jobs, or -1 if the pool could not start
+ */
+int pool_run(uint32_t n_jobs, unsigned n_workers, PoolJob job, void *ctx, PoolWorkerStats *stats) {
+    if (n_workers == 0) {
+        n_workers = 1;
+    }
+
+    size_t size = n_workers * sizeof(PoolDeque);
+    PoolDeque *deques = pool_shared_alloc(size);
+    if (deques == NULL) {
+        return -1;
+    }
+
+    for (unsigned w = 0; w < n_workers; w++) {
+        uint32_t head = (uint32_t)((uint64_t)n_jobs * w / n_workers);
+        uint32_t tail = (uint32_t)((uint64_t)n_jobs * (w + 1) / n_workers);
+        atomic_init(&deques[w].range, range_pack(head, tail));
+    }
+
+    fflush(NULL);
+
+    unsigned started = 0;
+    for (; started < n_workers; started++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            worker_main(deques, n_workers, started, job, ctx);
+            _exit(0);
+        }
+    }
+
+    // Workers that failed to start leave their ranges to be stolen
+    if (started == 0) {
+        worker_main(deques, n_workers, 0, job, ctx);
+    }
+    while (wait(NULL) > 0) {
+    }
+
+    int failed = 0;
+    for (unsigned w = 0; w < n_workers; w++) {
+        failed += (int)deques[w].stats.failed;
+        if (stats != NULL) {
+            stats[w] = deques[w].stats;
+        }
+    }
+
+    pool_shared_free(deques, size);
+    return failed;
+}
@@ -0,0 +1,231 @@
+/**
+ * @file sensor_models.c
+ * @brief Synthetic ADIS16500, MS5607, LIS3MDL and u-blox streams
+ *
+ * @details The ADIS16500 is mounted with x and y reversed relative to the
+ *          body; readings are biased, noisy and quantized to the 16-bit
+ *          output registers, then scaled and remounted as update_sensors()
+ *          does with the IMU pipeline output. One register sample stands for
+ *          a whole pipeline block, the SIL has no vibration to filter.
+ *          GNSS fixes are encoded as UBX-NAV-HPPVT frames and decoded with
+ *          the flight u-blox parser. The barometer reaches the estimator as
+ *          whole Pa, like MS5607GetPressurePa(), and the magnetometer field
+ *          in Gauss with the LIS3MDL axes on the body axes.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "sensor_models.h"
+#include "gps.h"
+
+#define ADIS_ACCEL_LSB  0.01225     // m/s^2
+#define ADIS_GYRO_LSB   0.1         // deg/s
+#define RAD2DEG         (180.0 / M_PI)
+
+#define WGS84_A_M       6378137.0
+#define WGS84_E2        0.00669437999014
+
+#define UBX_HPPVT_BODY_LENGTH 68
+
+void sensor_models_init(SimSensors *sens, const SimConfig *cfg, SimRng *rng) {
+    const SimDispersion *d = &cfg->dispersion;
+
+    memset(sens, 0, sizeof(*sens));
+    sens->cfg = cfg;
+
+    for (int i = 0; i < 3; i++) {
+        sens->accel_bias[i] = d->accel_bias * sim_rng_normal(rng);
+        sens->gyro_bias[i] = d->gyro_bias * sim_rng_normal(rng);
+        sens->mag_hard_iron[i] = d->mag_hard_iron * sim_rng_normal(rng);
+    }
+    sens->rng = *rng;
+}
+
+static int16_t quantize(double value, double lsb) {
+    double counts = round(value / lsb);
+    if (counts > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (counts < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)counts;
+}
+
+/**
+ * @brief Produces one ADIS16500 reading in the form update_sensors() stores
+ * @param sens Sensor state
+ * @param model Vehicle model, provides the specific force
+ * @param state True state, provides the body rates
+ * @param sample Receives accel and gyro, and the registers for the event detector
+ * @param raw Receives the register values, may be NULL
+ */
+void sensor_models_imu(SimSensors *sens, const DynModel *model, const DynState *state,
+                       ReplaySample *sample, SimRawReadings *raw) {
+    const SimDispersion *d = &sens->cfg->dispersion;
+    const double mount[3] = {-1.0, -1.0, 1.0};
+    int16_t accel_raw[3], gyro_raw[3];
+
+    for (int i = 0; i < 3; i++) {
+        double accel = mount[i] * model->specific_force[i] + sens->accel_bias[i] + d->accel_noise * sim_rng_normal(&sens->rng);
+        double gyro = mount[i] * state->w[i] * RAD2DEG + sens->gyro_bias[i] + d->gyro_noise * sim_rng_normal(&sens->rng);
+        accel_raw[i] = quantize(accel, ADIS_ACCEL_LSB);
+        gyro_raw[i] = quantize(gyro, ADIS_GYRO_LSB);
+    }
+
+    // Same arithmetic as adis_accel_scale/adis_gyro_scale and update_sensors
+    sample->accel[0] = -1.0 * ((float)accel_raw[0] * 0.01225f);
+    sample->accel[1] = -1.0 * ((float)accel_raw[1] * 0.01225f);
+    sample->accel[2] = (float)accel_raw[2] * 0.01225f;
+    sample->gyro[0] = -1.0 * ((float)gyro_raw[0] * 0.1f) * PI / 180;
+    sample->gyro[1] = -1.0 * ((float)gyro_raw[1] * 0.1f) * PI / 180;
+    sample->gyro[2] = ((float)gyro_raw[2] * 0.1f) * PI / 180;
+
+    // The registers as the burst orders them, for the event detector
+    for (int i = 0; i < 3; i++) {
+        sample->imu_raw[i] = gyro_raw[i];
+        sample->imu_raw[i + 3] = accel_raw[i];
+    }
+    sample->imu_raw_valid = 1;
+
+    if (raw != NULL) {
+        memcpy(raw->accel_raw, accel_raw, sizeof(accel_raw));
+        memcpy(raw->gyro_raw, gyro_raw, sizeof(gyro_raw));
+    }
+}
+
+static void put_u32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+/**
+ * @brief Splits a value into the UBX standard and high precision parts
+ * @param value Value in units of the high precision field
+ * @param scale High precision units per standard unit
+ * @param hp Receives the high precision remainder
+ * @return Standard precision part
+ */
+static int32_t split_hp(double value, int64_t scale, int8_t *hp) {
+    int64_t total = llround(value);
+    *hp = (int8_t)(total % scale);
+    return (int32_t)(total / scale);
+}
+
+/**
+ * @brief Encodes a UBX-NAV-HPPVT frame for the true position plus noise
+ * @return Frame length in bytes
+ */
+static uint16_t encode_hppvt(SimSensors *sens, const DynState *state, uint8_t *frame) {
+    const SimVehicle *veh = &sens->cfg->vehicle;
+    const SimDispersion *d = &sens->cfg->dispersion;
+    uint8_t *body = &frame[6];
+
+    double north = state->r[1] + d->gps_noise_h * sim_rng_normal(&sens->rng);
+    double east = -state->r[2] + d->gps_noise_h * sim_rng_normal(&sens->rng);
+    double up = state->r[0] + d->gps_noise_v * sim_rng_normal(&sens->rng);
+
+    double lat0 = veh->launch_lat / RAD2DEG;
+    double s = sin(lat0);
+    double w = 1.0 - WGS84_E2 * s * s;
+    double r_meridian = WGS84_A_M * (1.0 - WGS84_E2) / (w * sqrt(w));
+    double r_normal = WGS84_A_M / sqrt(w);
+
+    double lat = veh->launch_lat + north / r_meridian * RAD2DEG;
+    double lon = veh->launch_lon + east / (r_normal * cos(lat0)) * RAD2DEG;
+    double height = veh->launch_alt + up;
+
+    int8_t lat_hp, lon_hp, height_hp;
+    int32_t lat_std = split_hp(lat * 1e9, 100, &lat_hp);
+    int32_t lon_std = split_hp(lon * 1e9, 100, &lon_hp);
+    int32_t height_std = split_hp(height * 1e4, 10, &height_hp);
+
+    memset(body, 0, UBX_HPPVT_BODY_LENGTH);
+    put_u32(&body[0], sens->itow);
+    body[20] = 3;       // 3D fix
+    body[21] = 0x01;    // gnssFixOK
+    body[23] = 12;      // numSV
+    put_u32(&body[24], (uint32_t)lon_std);
+    put_u32(&body[28], (uint32_t)lat_std);
+    put_u32(&body[32], (uint32_t)height_std);
+    put_u32(&body[36], (uint32_t)height_std);
+    body[40] = (uint8_t)lon_hp;
+    body[41] = (uint8_t)lat_hp;
+    body[42] = (uint8_t)height_hp;
+    body[43] = (uint8_t)height_hp;
+
+    frame[0] = 0xb5;
+    frame[1] = 0x62;
+    frame[2] = 0x01;
+    frame[3] = 0x28;
+    frame[4] = UBX_HPPVT_BODY_LENGTH & 0xff;
+    frame[5] = UBX_HPPVT_BODY_LENGTH >> 8;
+
+    uint8_t ck_a = 0, ck_b = 0;
+    for (int i = 2; i < 6 + UBX_HPPVT_BODY_LENGTH; i++) {
+        ck_a += frame[i];
+        ck_b += ck_a;
+    }
+    frame[6 + UBX_HPPVT_BODY_LENGTH] = ck_a;
+    frame[7 + UBX_HPPVT_BODY_LENGTH] = ck_b;
+    return 8 + UBX_HPPVT_BODY_LENGTH;
+}
+
+/**
+ * @brief Produces a GNSS fix and runs it through the flight UBX decoder
+ * @param sens Sensor state
+ * @param state True state
+ * @param t_ms Time of the fix
+ * @param sample Receives lat, lon and height as update_sensors() stores them
+ * @return 1 if the decoder accepted the frame
+ */
+int sensor_models_gps(SimSensors *sens, const DynState *state, uint32_t t_ms, ReplaySample *sample) {
+    uint8_t frame[8 + UBX_HPPVT_BODY_LENGTH];
+    uint8_t msg[256];
+    uint16_t msg_len = 0;
+    uint8_t *rem;
+    uint8_t cls = 0;
+    uint8_t id = 0;
+
+    sens->itow = t_ms;
+    uint16_t len = encode_hppvt(sens, state, frame);
+    ublox_protocol_decode(frame, len, &cls, &id, msg, sizeof(msg), &msg_len, &rem);
+
+    if (cls != 0x01 || id != 0x28) {
+        return 0;
+    }
+
+    struct ublox_gnss_nav_hppvt hppvt_data;
+    ublox_gnss_dec_ubx_nav_hppvt(msg, msg_len, &hppvt_data);
+    sample->gps[0] = hppvt_data.lat * 1e-7 + hppvt_data.latHp * 1e-9;
+    sample->gps[1] = hppvt_data.lon * 1e-7 + hppvt_data.lonHp * 1e-9;
+    sample->gps[2] = hppvt_data.height * 1e-3 + hppvt_data.heightHp * 1e-4;
+    return 1;
+}
+
+/**
+ * @brief Produces MS5607 and LIS3MDL readings for the true state
+ * @param sens Sensor state
+ * @param state True state
+ * @param raw Receives pressure, temperature and field
+ */
+void sensor_models_baro_mag(SimSensors *sens, const DynState *state, SimRawReadings *raw) {
+    const SimVehicle *veh = &sens->cfg->vehicle;
+    const SimDispersion *d = &sens->cfg->dispersion;
+
+    // ISA troposphere
+    double h = veh->launch_alt + state->r[0];
+    double temp_k = 288.15 - 0.0065 * h;
+    raw->pressure = 101325.0 * pow(temp_k / 288.15, 5.25588) + d->baro_noise * sim_rng_normal(&sens->rng);
+    raw->temperature = temp_k - 273.15;
+
+    // North-east-down field into the flat frame, then into the body
+    double field_flat[3] = {-veh->mag_ned[2], veh->mag_ned[0], -veh->mag_ned[1]};
+    dyn_rotate_to_body(state->q, field_flat, raw->mag);
+    for (int i = 0; i < 3; i++) {
+        raw->mag[i] += sens->mag_hard_iron[i] + d->mag_noise * sim_rng_normal(&sens->rng);
+    }
+}
@@ -0,0 +1,380 @@
+/**
+ * @file sim_run.c
+ * @brief One closed-loop run of the GNC chain
+ *
+ * @details The estimator is stepped every estimator_period_ms through the
+ *          same entry point as the flight main loop, and 'GO' is typed on its
+ *          debug UART at go_time. The controls follow run_controls_task():
+ *          they start once the estimator reports a state of ARMED or later,
+ *          as state_est_rx.c does, and then run every controls_period_ms on
+ *          the state vector assembled the same way from SerialData and the
+ *          compensated gyro. With SIM_FEEDBACK_TRUTH, the default, they start
+ *          at liftoff and see the true state instead. The host update_sensors()
+ *          runs the EKF steps of the TIM6 and TIM7 interrupts, so the state
+ *          machine flies the whole sequence as on the target.
+ *
+ *          The estimator keeps its state in globals and function statics, so
+ *          this must run at most once per process; the pool forks per run.
+ */
+
+#include <math.h>
+#include <string.h>
+#include <time.h>
+
+#include "main.h"
+#include "controls.h"
+#include "sim.h"
+#include "dynamics.h"
+#include "sensor_models.h"
+
+#define RAD2DEG (180.0 / M_PI)
+
+const char *const sim_result_names[SIM_RESULT_FIELDS] = {
+    "apogee_m",
+    "apogee_time_s",
+    "apogee_drift_m",
+    "max_speed_mps",
+    "max_q_pa",
+    "max_tilt_deg",
+    "max_rate_dps",
+    "burnout_roll_rate_dps",
+    "max_vane_deg",
+    "vane_saturation_pct",
+    "launch_detect_delay_s",
+    "est_pos_error_m",
+    "est_vel_error_mps",
+    "est_final_state",
+    "runtime_ms",
+};
+
+/**
+ * @brief Fills a configuration with the nominal vehicle and dispersions
+ * @param cfg Configuration to fill
+ */
+void sim_default_config(SimConfig *cfg) {
+    memset(cfg, 0, sizeof(*cfg));
+
+    SimVehicle *veh = &cfg->vehicle;
+    veh->mass_wet = 40.0;
+    veh->mass_prop = 6.9;
+    veh->ixx_wet = 0.15;
+    veh->ixx_dry = 0.12;
+    veh->iyy_wet = 30.0;
+    veh->iyy_dry = 26.0;
+    veh->ref_area = 0.0201;
+    veh->ref_length = 3.0;
+    veh->cd = 0.45;
+    veh->cn_alpha = 10.0;
+    veh->static_margin = 0.3;
+    veh->pitch_damping = 5.0;
+    veh->roll_damping = 0.5;
+    veh->roll_arm = 0.1;
+    veh->vane_arm = 0.967;
+    veh->servo_tau = 0.02;
+    veh->rail_length = 6.0;
+    veh->launch_lat = 33.7756;
+    veh->launch_lon = -84.3963;
+    veh->launch_alt = 300.0;
+    veh->mag_ned[0] = 0.23;
+    veh->mag_ned[1] = -0.02;
+    veh->mag_ned[2] = 0.42;
+
+    SimDispersion *d = &cfg->dispersion;
+    d->thrust_scale = 0.03;
+    d->burn_time_scale = 0.02;
+    d->mass = 0.02;
+    d->cd = 0.10;
+    d->cn_alpha = 0.10;
+    d->vane_gain = 0.10;
+    d->thrust_misalign = 0.1;
+    d->rail_tilt = 1.0;
+    d->wind_max = 8.0;
+    d->accel_bias = 0.05;
+    d->gyro_bias = 0.2;
+    d->accel_noise = 0.02;
+    d->gyro_noise = 0.05;
+    d->gps_noise_h = 1.5;
+    d->gps_noise_v = 3.0;
+    d->baro_noise = 3.0;
+    d->mag_noise = 0.003;
+    d->mag_hard_iron = 0.05;
+
+    cfg->feedback = SIM_FEEDBACK_TRUTH;
+    cfg->seed = 1;
+    cfg->dt = 0.001;
+    cfg->estimator_period_ms = 5;
+    cfg->controls_period_ms = 50;
+    cfg->gps_period_ms = 100;
+    cfg->go_time = 1.0;
+    cfg->ignition_time = 20.0;
+    cfg->coast_after_apogee = 5.0;
+    cfg->max_time = 120.0;
+}
+
+/**
+ * @brief Assembles the controls state vector
+ * @details With SIM_FEEDBACK_TRUTH the state is in the convention the gains
+ *          were designed for, body velocity, body rates and the vector part
+ *          of the body to flat quaternion [u, v, w, p, q, r, q1, q2, q3],
+ *          which is zero apart from u on a nominal vertical flight. Otherwise it is
+ *          assembled the way run_controls_task() does on the target.
+ */
+static void controls_state(const SimConfig *cfg, const DynState *st, float state[9]) {
+    float vel[3], gyro[3], att[3];
+
+    if (cfg->feedback == SIM_FEEDBACK_TRUTH) {
+        double v_body[3];
+        dyn_rotate_to_body(st->q, st->v, v_body);
+        for (int i = 0; i < 3; i++) {
+            state[i] = v_body[i];
+            state[i + 3] = st->w[i];
+            state[i + 6] = st->q[i + 1];
+        }
+        return;
+    }
+
+    vel[0] = serial_data.vel_x;
+    vel[1] = serial_data.vel_y;
+    vel[2] = serial_data.vel_z;
+    gyro[0] = sensors.gyro_x - sensors.gyro_bias_x;
+    gyro[1] = sensors.gyro_y - sensors.gyro_bias_y;
+    gyro[2] = sensors.gyro_z - sensors.gyro_bias_z;
+    att[0] = serial_data.q1;
+    att[1] = serial_data.q2;
+    att[2] = serial_data.q3;
+
+    state[0] = vel[1];
+    state[1] = vel[0];
+    state[2] = vel[2];
+    state[3] = gyro[1];
+    state[4] = gyro[0];
+    state[5] = gyro[2];
+    state[6] = att[1];
+    state[7] = att[0];
+    state[8] = att[2];
+}
+
+static void trace_header(FILE *trace) {
+    fprintf(trace, "t,x,y,z,vx,vy,vz,q0,q1,q2,q3,wx,wy,wz,thrust,vane0,vane1,vane2,vane3,"
+                   "accel_x,accel_y,accel_z,gyro_x,gyro_y,gyro_z,lat,lon,height,"
+                   "pressure,temperature,mag_x,mag_y,mag_z,"
+                   "rocket_state,serial_state,est_x,est_y,est_z,est_vx,est_vy,est_vz,"
+                   "est_q0,est_q1,est_q2,est_q3\n");
+}
+
+static void trace_row(FILE *trace, double t, const DynModel *model, const DynState *st,
+                      const ReplaySample *sample, const SimRawReadings *raw) {
+    fprintf(trace, "%.3f,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.6f,%.6f,%.6f,%.6f,%.5f,%.5f,%.5f,%.1f,"
+                   "%.3f,%.3f,%.3f,%.3f,%.5f,%.5f,%.5f,%.6f,%.6f,%.6f,%.9f,%.9f,%.4f,"
+                   "%.1f,%.2f,%.4f,%.4f,%.4f,%u,%u,%.4f,%.4f,%.4f,%.4f,%.4f,%.4f,%.6f,%.6f,%.6f,%.6f\n",
+            t, st->r[0], st->r[1], st->r[2], st->v[0], st->v[1], st->v[2],
+            st->q[0], st->q[1], st->q[2], st->q[3], st->w[0], st->w[1], st->w[2], model->thrust,
+            model->vane[0], model->vane[1], model->vane[2], model->vane[3],
+            sample->accel[0], sample->accel[1], sample->accel[2],
+            sample->gyro[0], sample->gyro[1], sample->gyro[2],
+            sample->gps[0], sample->gps[1], sample->gps[2],
+            raw->pressure, raw->temperature, raw->mag[0], raw->mag[1], raw->mag[2],
+            rocket_state, serial_data.state,
+            serial_data.pos_x, serial_data.pos_y, serial_data.pos_z,
+            serial_data.vel_x, serial_data.vel_y, serial_data.vel_z,
+            serial_data.q0, serial_data.q1, serial_data.q2, serial_data.q3);
+}
+
+/**
+ * @brief Runs one dispersed flight from the pad to past apogee
+ * @param cfg Simulation configuration
+ * @param run_index Selects the dispersion and noise streams
+ * @param result Receives the run's metrics
+ * @param trace If not NULL, receives a CSV row per estimator step
+ * @return 1 on completion
+ */
+int sim_run(const SimConfig *cfg, uint32_t run_index, SimResult *result, FILE *trace) {
+    struct timespec wall_start, wall_end;
+    clock_gettime(CLOCK_MONOTONIC, &wall_start);
+
+    SimRng dyn_rng, sens_rng;
+    sim_rng_seed(&dyn_rng, cfg->seed, 2ULL * run_index);
+    sim_rng_seed(&sens_rng, cfg->seed, 2ULL * run_index + 1);
+
+    controller ctrl;
+    initialize_controls(&ctrl);
+
+    double curve[DYN_THRUST_POINTS];
+    for (int i = 0; i < DYN_THRUST_POINTS; i++) {
+        curve[i] = ctrl.thrust_curve[i];
+    }
+
+    DynModel model;
+    DynState st;
+    dyn_init(&model, &st, cfg, curve, &dyn_rng);
+
+    SimSensors sens;
+    sensor_models_init(&sens, cfg, &sens_rng);
+
+    ReplaySample sample;
+    SimRawReadings raw;
+    memset(&sample, 0, sizeof(sample));
+    memset(&raw, 0, sizeof(raw));
+    sensor_models_imu(&sens, &model, &st, &sample, &raw);
+    sensor_models_gps(&sens, &st, 0, &sample);
+
+    replay_sample = &sample;
+    host_hal_set_tick(0);
+    sensors_init(&sensors);
+    state_machine_init();
+
+    for (size_t i = 0; i < SIM_RESULT_FIELDS; i++) {
+        ((double *)result)[i] = NAN;
+    }
+    result->max_speed = 0.0;
+    result->max_q = 0.0;
+    result->max_tilt = 0.0;
+    result->max_rate = 0.0;
+    result->max_vane = 0.0;
+    result->vane_saturation = 0.0;
+
+    if (trace != NULL) {
+        trace_header(trace);
+    }
+
+    const double est_period = cfg->estimator_period_ms / 1000.0;
+    const double ctrl_period = cfg->controls_period_ms / 1000.0;
+    const double gps_period = cfg->gps_period_ms / 1000.0;
+    double next_est = 0.0;
+    double next_gps = gps_period;
+    double next_ctrl = 0.0;
+    double ctrl_start = -1.0;
+    uint32_t ctrl_cycles = 0;
+    uint32_t ctrl_saturated = 0;
+    int go_sent = 0;
+    int burnout_seen = 0;
+    float vane_cmd[4] = {0.0f, 0.0f, 0.0f, 0.0f};
+    const double eps = 1e-9;
+
+    for (uint64_t step = 0;; step++) {
+        double t = step * cfg->dt;
+
+        if (t + eps >= next_est) {
+            uint32_t t_ms = (uint32_t)llround(t * 1000.0);
+            next_est += est_period;
+
+            sample.t_ms = t_ms;
+            sensor_models_imu(&sens, &model, &st, &sample, &raw);
+            sensor_models_baro_mag(&sens, &st, &raw);
+            sample.pressure = (float32_t)llround(raw.pressure);  // MS5607GetPressurePa() is whole Pa
+            for (int i = 0; i < 3; i++) {
+                sample.mag[i] = (float32_t)raw.mag[i];
+            }
+            sample.mag_valid = 1;
+            if (t + eps >= next_gps) {
+                sensor_models_gps(&sens, &st, t_ms, &sample);
+                next_gps += gps_period;
+            }
+
+            host_hal_set_tick(t_ms);
+            if (!go_sent && t + eps >= cfg->go_time) {
+                host_uart_inject(&huart3, (const uint8_t *)"GO", 2);
+                go_sent = 1;
+            }
+            state_machine_run();
+
+            if (model.launched && isnan(result->launch_detect_delay) && rocket_state >= FASTASCENT) {
+                result->launch_detect_delay = t - model.liftoff_time;
+            }
+
+            if (ctrl_start < 0.0) {
+                int start = cfg->feedback == SIM_FEEDBACK_TRUTH ? model.launched : serial_data.state >= ARMED;
+                if (start) {
+                    ctrl_start = t;
+                    next_ctrl = t;
+                }
+            }
+
+            if (trace != NULL) {
+                trace_row(trace, t, &model, &st, &sample, &raw);
+            }
+        }
+
+        if (ctrl_start >= 0.0 && t + eps >= next_ctrl) {
+            float state[9];
+            next_ctrl += ctrl_period;
+
+            controls_state(cfg, &st, state);
+            run_controls(&ctrl, state, (float)(t - ctrl_start));
+
+            int saturated = 0;
+            for (int i = 0; i < 4; i++) {
+                vane_cmd[i] = ctrl.vane_deflections[i];
+                if (!isfinite(vane_cmd[i])) {
+                    vane_cmd[i] = 0.0f;
+                }
+                saturated |= fabs(vane_cmd[i]) >= 30.0;
+            }
+            ctrl_cycles++;
+            ctrl_saturated += saturated;
+        }
+
+        dyn_step(&model, &st, t, cfg->dt, vane_cmd);
+
+        if (model.launched) {
+            double speed = sqrt(st.v[0] * st.v[0] + st.v[1] * st.v[1] + st.v[2] * st.v[2]);
+            double rate = sqrt(st.w[0] * st.w[0] + st.w[1] * st.w[1] + st.w[2] * st.w[2]) * RAD2DEG;
+            result->max_speed = fmax(result->max_speed, speed);
+            result->max_q = fmax(result->max_q, model.dynamic_pressure);
+            result->max_rate = fmax(result->max_rate, rate);
+            for (int i = 0; i < 4; i++) {
+                result->max_vane = fmax(result->max_vane, fabs(model.vane[i]));
+            }
+
+            if (model.thrust > 0.0) {
+                double nose[3], nose_body[3] = {1.0, 0.0, 0.0};
+                dyn_rotate_to_flat(st.q, nose_body, nose);
+                result->max_tilt = fmax(result->max_tilt, acos(fmax(-1.0, fmin(1.0, nose[0]))) * RAD2DEG);
+            } else if (!burnout_seen) {
+                burnout_seen = 1;
+                result->burnout_roll_rate = st.w[0] * RAD2DEG;
+            }
+
+            if (isnan(result->apogee) && st.v[0] < 0.0) {
+                result->apogee = st.r[0];
+                result->apogee_time = t - model.ignition_time;
+                result->apogee_drift = sqrt(st.r[1] * st.r[1] + st.r[2] * st.r[2]);
+
+                if (rocket_state >= FASTASCENT) {
+                    double est_r[3] = {serial_data.pos_x, serial_data.pos_y, serial_data.pos_z};
+                    double est_v[3] = {serial_data.vel_x, serial_data.vel_y, serial_data.vel_z};
+                    double v_body[3];
+                    double dr = 0.0, dv = 0.0;
+                    // The flight EKF keeps the velocity in the body frame
+                    dyn_rotate_to_body(st.q, st.v, v_body);
+                    for (int i = 0; i < 3; i++) {
+                        dr += (est_r[i] - st.r[i]) * (est_r[i] - st.r[i]);
+                        dv += (est_v[i] - v_body[i]) * (est_v[i] - v_body[i]);
+                    }
+                    result->est_pos_error = sqrt(dr);
+                    result->est_vel_error = sqrt(dv);
+                }
+            }
+
+            if (!isnan(result->apogee) && t > model.ignition_time + result->apogee_time + cfg->coast_after_apogee) {
+                break;
+            }
+            if (st.r[0] < -1.0) {
+                break;
+            }
+        }
+
+        if (t >= cfg->max_time) {
+            break;
+        }
+    }
+
+    if (ctrl_cycles > 0) {
+        result->vane_saturation = 100.0 * ctrl_saturated / ctrl_cycles;
+    }
+    result->est_final_state = rocket_state;
+
+    clock_gettime(CLOCK_MONOTONIC, &wall_end);
+    result->runtime_ms = (wall_end.tv_sec - wall_start.tv_sec) * 1e3 + (wall_end.tv_nsec - wall_start.tv_nsec) * 1e-6;
+    return 1;
+}
@@ -0,0 +1,107 @@
+/**
+ * @file stats.c
+ * @brief Dispersion statistics over Monte Carlo results
+ *
+ * @details Metrics that a run never reached are NAN and are left out of that
+ *          metric's statistics, so the count column shows how many runs got
+ *          there. Percentiles use linear interpolation between order
+ *          statistics.
+ */
+
+#include <math.h>
+#include <stdlib.h>
+
+#include "stats.h"
+
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a;
+    double y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+static double percentile(const double *sorted, uint32_t n, double p) {
+    double pos = p * (n - 1);
+    uint32_t lo = (uint32_t)pos;
+    uint32_t hi = lo + 1 < n ? lo + 1 : lo;
+    return sorted[lo] + (sorted[hi] - sorted[lo]) * (pos - lo);
+}
+
+/**
+ * @brief Computes per-metric statistics
+ * @param results Run results
+ * @param valid Non-zero for runs that completed
+ * @param n Number of runs
+ * @param stats Receives one entry per SimResult field
+ */
+void sim_stats_compute(const SimResult *results, const uint8_t *valid, uint32_t n, SimStat stats[SIM_RESULT_FIELDS]) {
+    double *values = malloc((n ? n : 1) * sizeof(double));
+
+    for (size_t f = 0; f < SIM_RESULT_FIELDS; f++) {
+        SimStat *s = &stats[f];
+        uint32_t count = 0;
+        double mean = 0.0, m2 = 0.0;
+
+        for (uint32_t i = 0; i < n; i++) {
+            double x = ((const double *)&results[i])[f];
+            if (!valid[i] || isnan(x)) {
+                continue;
+            }
+            values[count++] = x;
+
+            // Welford
+            double delta = x - mean;
+            mean += delta / count;
+            m2 += delta * (x - mean);
+        }
+
+        s->count = count;
+        if (count == 0) {
+            s->mean = s->std = s->min = s->p05 = s->p50 = s->p95 = s->max = NAN;
+            continue;
+        }
+
+        qsort(values, count, sizeof(double), compare_double);
+        s->mean = mean;
+        s->std = count > 1 ? sqrt(m2 / (count - 1)) : 0.0;
+        s->min = values[0];
+        s->p05 = percentile(values, count, 0.05);
+        s->p50 = percentile(values, count, 0.50);
+        s->p95 = percentile(values, count, 0.95);
+        s->max = values[count - 1];
+    }
+
+    free(values);
+}
+
+void sim_stats_print(FILE *out, const SimStat stats[SIM_RESULT_FIELDS]) {
+    fprintf(out, "%-24s %6s %12s %12s %12s %12s %12s %12s %12s\n",
+            "metric", "n", "mean", "std", "min", "p5", "p50", "p95", "max");
+
+    for (size_t f = 0; f < SIM_RESULT_FIELDS; f++) {
+        const SimStat *s = &stats[f];
+        fprintf(out, "%-24s %6u %12.4g %12.4g %12.4g %12.4g %12.4g %12.4g %12.4g\n",
+                sim_result_names[f], s->count, s->mean, s->std, s->min, s->p05, s->p50, s->p95, s->max);
+    }
+}
+
+/**
+ * @brief Writes one CSV row per run, failed runs are skipped
+ */
+void sim_results_write_csv(FILE *out, const SimResult *results, const uint8_t *valid, uint32_t n) {
+    fprintf(out, "run");
+    for (size_t f = 0; f < SIM_RESULT_FIELDS; f++) {
+        fprintf(out, ",%s", sim_result_names[f]);
+    }
+    fprintf(out, "\n");
+
+    for (uint32_t i = 0; i < n; i++) {
+        if (!valid[i]) {
+            continue;
+        }
+        fprintf(out, "%u", i);
+        for (size_t f = 0; f < SIM_RESULT_FIELDS; f++) {
+            fprintf(out, ",%.6g", ((const double *)&results[i])[f]);
+        }
+        fprintf(out, "\n");
+    }
+}
@@ -0,0 +1,80 @@
+/**
+ * @file smoother.h
+ * @brief Offline Rauch-Tung-Striebel smoother of the flight EKF model
+ *
+ * @details A recording is split into segments at gaps in its time stamps.
+ *          Each segment is filtered forward with the generated flight EKF
+ *          kernels, the same model the target runs, and every filtered state
+ *          and covariance is kept with the transition that leaves it. The
+ *          backward pass then runs in double. The gain comes from a Cholesky
+ *          solve rather than an inverse of the predicted covariance, and the
+ *          smoothed covariance is formed as a sum of positive semidefinite
+ *          terms, so it stays symmetric and positive semidefinite.
+ *
+ *          smoother_run_segment() only calls reentrant estimator code and
+ *          keeps its state in the segment, so segments can be run on
+ *          separate threads.
+ */
+#ifndef __SMOOTHER_H__
+#define __SMOOTHER_H__
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "arm_math.h"
+#include "replay.h"
+#include "flight_ekf_model.h"
+
+#define SMOOTHER_NX FLIGHT_EKF_MODEL_NX
+#define SMOOTHER_NZ FLIGHT_EKF_MODEL_NZ
+#define SMOOTHER_TRI (SMOOTHER_NX * (SMOOTHER_NX + 1) / 2)
+
+#define SMOOTHER_PAD_MS 2000        // default time at rest the biases, origin and baro reference are averaged over
+#define SMOOTHER_GAP_MS 500         // default gap in the time stamps that starts a new segment
+#define SMOOTHER_CYCLE_S 0.005f     // s, estimator cycle the flight EKF's Q is given per
+
+// Noise and initial state of the forward pass, the flight EKF's by default
+typedef struct {
+    float32_t x0[SMOOTHER_NX];
+    float32_t P0[SMOOTHER_NX * SMOOTHER_NX];
+    float32_t Q[SMOOTHER_NX * SMOOTHER_NX];     // per SMOOTHER_CYCLE_S, only the diagonal is used
+    float32_t R[SMOOTHER_NZ * SMOOTHER_NZ];     // GNSS position
+    float32_t c[3];                             // m, IMU to centre of mass in the body frame
+    float32_t gnss_gate;                        // largest NIS of a GNSS fix that is fused
+    float32_t baro_gate;                        // largest NIS of a baro reading that is fused
+    uint32_t pad_ms;
+} SmootherModel;
+
+// One stretch of a recording with no gap in its time stamps
+typedef struct {
+    const ReplaySample *samples;
+    size_t count;
+    uint32_t flight;            // index of the recording
+    uint32_t index;             // of the segment in its recording
+} SmootherSegment;
+
+// Smoothed state after one sample, in the flight EKF's frame and units
+typedef struct {
+    uint32_t t_ms;
+    float32_t x[SMOOTHER_NX];
+    float32_t sigma[SMOOTHER_NX];       // square root of the diagonal of the smoothed covariance
+    float32_t filtered[SMOOTHER_NX];    // forward pass alone, for comparison
+    float32_t filtered_sigma[SMOOTHER_NX];
+} SmootherPoint;
+
+typedef struct {
+    SmootherPoint *points;      // malloc'd, one per sample from the end of the pad, NULL on failure
+    size_t count;
+    uint32_t gnss_fused, gnss_rejected;
+    uint32_t baro_fused, baro_rejected;
+    uint32_t not_pos_def;       // predicted covariances the backward pass could not factor
+    const char *error;          // why the segment was not smoothed, NULL on success
+} SmootherResult;
+
+void smoother_model_default(SmootherModel *model);
+size_t smoother_split(const ReplaySample *samples, size_t count, uint32_t flight, uint32_t gap_ms,
+                      SmootherSegment *segments, size_t max_segments);
+void smoother_run_segment(const SmootherModel *model, const SmootherSegment *segment, SmootherResult *result);
+void smoother_result_free(SmootherResult *result);
+
+#endif /* __SMOOTHER_H__ */
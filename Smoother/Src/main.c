@@ -0,0 +1,554 @@
+/**
+ * @file main.c
+ * @brief Offline smoother of recorded flights
+ *
+ * @details Loads one or more recordings in the replay format, splits them
+ *          into segments at gaps in the time stamps and smooths the segments
+ *          on a pool of threads. The smoothed trajectory with its standard
+ *          deviations is a reference to grade the real-time filter against.
+ *          --check smooths synthetic flights with known truth instead.
+ *
+ *          Threads rather than the simulator's processes are enough here,
+ *          smoother_run_segment() calls only reentrant estimator code.
+ *          Segments are handed out longest first from one atomic counter and
+ *          the output is written in recording and segment order, so it does
+ *          not depend on the number of threads.
+ */
+
+#include <getopt.h>
+#include <math.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "smoother.h"
+#include "sim_rng.h"
+
+// Synthetic flights of --check, straight up: a pad at rest, a constant
+// thrust boost and a coast without drag, sampled at the estimator rate. The
+// GNSS noise is the model's R, the check is of the smoother and not of the
+// tuning.
+#define CHECK_RECORDINGS 4
+#define CHECK_SEED 1
+#define CHECK_STEP_MS 5
+#define CHECK_GNSS_MS 100
+#define CHECK_BARO_MS 20
+#define CHECK_PAD_S 3.0
+#define CHECK_BOOST_S 3.0
+#define CHECK_COAST_S 10.0
+#define CHECK_BOOST_ACCEL 60.0      // m/s^2 without gravity
+#define CHECK_GRAVITY 9.81
+#define CHECK_LAT 35.0              // deg, launch site
+#define CHECK_LON -117.0
+#define CHECK_HEIGHT 700.0          // m
+#define CHECK_EARTH_RADIUS 6371000.0
+#define CHECK_ACCEL_NOISE 0.05      // m/s^2, 1 sigma per sample
+#define CHECK_ACCEL_BIAS 0.05       // m/s^2, 1 sigma per recording
+#define CHECK_GYRO_NOISE 0.002      // rad/s
+#define CHECK_GYRO_BIAS 0.005       // rad/s
+#define CHECK_BARO_NOISE 3.0        // Pa
+#define CHECK_MIN_COVERAGE 0.95     // of errors within 3 sigma
+#define CHECK_SIGMA_TOL 1e-3        // relative, smoothed over filtered sigma
+
+typedef struct {
+    const SmootherModel *model;
+    const SmootherSegment *segments;
+    SmootherResult *results;
+    const size_t *order;        // segment indices, longest first
+    size_t count;
+    atomic_size_t next;
+} SmoothJobs;
+
+typedef struct {
+    size_t count;
+    size_t index;
+} SegmentLength;
+
+static const char *state_names[SMOOTHER_NX] = {"x", "vx", "y", "vy", "z", "vz", "baro_bias"};
+
+static void *smooth_worker(void *arg) {
+    SmoothJobs *jobs = arg;
+    size_t i;
+
+    while ((i = atomic_fetch_add(&jobs->next, 1)) < jobs->count) {
+        size_t s = jobs->order[i];
+        smoother_run_segment(jobs->model, &jobs->segments[s], &jobs->results[s]);
+    }
+    return NULL;
+}
+
+static int longest_first(const void *a, const void *b) {
+    const SegmentLength *la = a, *lb = b;
+    if (la->count != lb->count) {
+        return la->count < lb->count ? 1 : -1;
+    }
+    return la->index < lb->index ? -1 : la->index > lb->index;
+}
+
+/**
+ * @brief Smooths every segment on a pool of threads
+ * @param model Noise and initial state
+ * @param segments Segments to smooth
+ * @param n Number of segments
+ * @param results Receives one result per segment, in the order of segments
+ * @param threads Threads to start, at least 1
+ * @return 0 on success, -1 if the pool could not be set up
+ */
+static int smooth_all(const SmootherModel *model, const SmootherSegment *segments, size_t n,
+                      SmootherResult *results, long threads) {
+    SegmentLength *lengths = malloc(n * sizeof(*lengths));
+    size_t *order = malloc(n * sizeof(*order));
+    pthread_t *tids = calloc(threads, sizeof(*tids));
+    SmoothJobs jobs = {.model = model, .segments = segments, .results = results, .order = order, .count = n};
+    long started = 0;
+
+    if ((n > 0 && (lengths == NULL || order == NULL)) || tids == NULL) {
+        free(lengths);
+        free(order);
+        free(tids);
+        return -1;
+    }
+    for (size_t i = 0; i < n; i++) {
+        lengths[i] = (SegmentLength){.count = segments[i].count, .index = i};
+    }
+    qsort(lengths, n, sizeof(*lengths), longest_first);
+    for (size_t i = 0; i < n; i++) {
+        order[i] = lengths[i].index;
+    }
+    atomic_init(&jobs.next, 0);
+
+    // The calling thread works too, so a failed pthread_create only costs speed
+    while (started < threads - 1 && pthread_create(&tids[started], NULL, smooth_worker, &jobs) == 0) {
+        started++;
+    }
+    smooth_worker(&jobs);
+    for (long t = 0; t < started; t++) {
+        pthread_join(tids[t], NULL);
+    }
+
+    free(lengths);
+    free(order);
+    free(tids);
+    return 0;
+}
+
+static void write_csv(FILE *out, const SmootherSegment *segments, const SmootherResult *results, size_t n,
+                      int filtered) {
+    fprintf(out, "flight,segment,t_ms");
+    for (int i = 0; i < SMOOTHER_NX; i++) {
+        fprintf(out, ",%s", state_names[i]);
+    }
+    for (int i = 0; i < SMOOTHER_NX; i++) {
+        fprintf(out, ",sd_%s", state_names[i]);
+    }
+    if (filtered) {
+        for (int i = 0; i < SMOOTHER_NX; i++) {
+            fprintf(out, ",filtered_%s", state_names[i]);
+        }
+        for (int i = 0; i < SMOOTHER_NX; i++) {
+            fprintf(out, ",filtered_sd_%s", state_names[i]);
+        }
+    }
+    fprintf(out, "\n");
+
+    for (size_t s = 0; s < n; s++) {
+        for (size_t k = 0; k < results[s].count; k++) {
+            const SmootherPoint *p = &results[s].points[k];
+
+            fprintf(out, "%u,%u,%u", segments[s].flight, segments[s].index, p->t_ms);
+            for (int i = 0; i < SMOOTHER_NX; i++) {
+                fprintf(out, ",%.4f", p->x[i]);
+            }
+            for (int i = 0; i < SMOOTHER_NX; i++) {
+                fprintf(out, ",%.4f", p->sigma[i]);
+            }
+            if (filtered) {
+                for (int i = 0; i < SMOOTHER_NX; i++) {
+                    fprintf(out, ",%.4f", p->filtered[i]);
+                }
+                for (int i = 0; i < SMOOTHER_NX; i++) {
+                    fprintf(out, ",%.4f", p->filtered_sigma[i]);
+                }
+            }
+            fprintf(out, "\n");
+        }
+    }
+}
+
+static double summary_mean_sigma(const SmootherResult *result, int state) {
+    double sum = 0.0;
+    for (size_t k = 0; k < result->count; k++) {
+        sum += result->points[k].sigma[state];
+    }
+    return result->count > 0 ? sum / result->count : NAN;
+}
+
+static void print_summary(FILE *out, const SmootherSegment *segments, const SmootherResult *results, size_t n) {
+    for (size_t s = 0; s < n; s++) {
+        const SmootherResult *r = &results[s];
+
+        if (r->error != NULL) {
+            fprintf(out, "flight %u segment %u: %zu samples, not smoothed: %s\n", segments[s].flight,
+                    segments[s].index, segments[s].count, r->error);
+            continue;
+        }
+        fprintf(out, "flight %u segment %u: %zu points, gnss %u fused %u rejected, baro %u fused %u rejected, "
+                     "mean sd x %.2f m, vx %.2f m/s%s\n",
+                segments[s].flight, segments[s].index, r->count, r->gnss_fused, r->gnss_rejected, r->baro_fused,
+                r->baro_rejected, summary_mean_sigma(r, 0), summary_mean_sigma(r, 1),
+                r->not_pos_def > 0 ? ", predicted covariance not positive definite" : "");
+    }
+}
+
+// Synthetic recording with its truth, the up position and speed per sample
+typedef struct {
+    ReplaySample *samples;
+    double *up;
+    double *speed;
+    size_t count;
+} CheckRecording;
+
+static double check_pressure(double height) {
+    return 101325.0 * pow(1.0 - height / 44330.0, 1.0 / 0.1903);
+}
+
+/**
+ * @brief Appends one synthetic flight to a recording
+ * @param model GNSS noise
+ * @param rec Recording, with room for the flight
+ * @param rng Noise stream of the recording
+ * @param t0_ms Time stamp of the first sample
+ * @param accel_bias Accelerometer bias, body frame
+ * @param gyro_bias Gyro bias, body frame
+ */
+static void check_flight(const SmootherModel *model, CheckRecording *rec, SimRng *rng, uint32_t t0_ms, const double *accel_bias,
+                         const double *gyro_bias) {
+    const double dt = CHECK_STEP_MS * 1e-3;
+    const size_t steps = (size_t)((CHECK_PAD_S + CHECK_BOOST_S + CHECK_COAST_S) / dt);
+    const double lat = CHECK_LAT * M_PI / 180.0;
+    double up = 0.0, speed = 0.0;
+    double gps[3] = {0.0, 0.0, 0.0};
+    double gnss_sigma[SMOOTHER_NZ];
+
+    // [up, north, west] like the GNSS measurement
+    for (int i = 0; i < SMOOTHER_NZ; i++) {
+        gnss_sigma[i] = sqrt(model->R[i * (SMOOTHER_NZ + 1)]);
+    }
+    float32_t pressure = 0.0f;
+
+    for (size_t k = 0; k < steps; k++) {
+        double t = k * dt;
+        double accel = t < CHECK_PAD_S ? 0.0 : t < CHECK_PAD_S + CHECK_BOOST_S ? CHECK_BOOST_ACCEL : -CHECK_GRAVITY;
+        ReplaySample *s = &rec->samples[rec->count];
+
+        if (k > 0) {
+            up += speed * dt + 0.5 * accel * dt * dt;
+            speed += accel * dt;
+        }
+        memset(s, 0, sizeof(*s));
+        s->t_ms = t0_ms + (uint32_t)(k * CHECK_STEP_MS);
+        // Specific force along the body x axis, which points up
+        s->accel[0] = (float32_t)(accel + CHECK_GRAVITY + accel_bias[0] + CHECK_ACCEL_NOISE * sim_rng_normal(rng));
+        for (int i = 1; i < 3; i++) {
+            s->accel[i] = (float32_t)(accel_bias[i] + CHECK_ACCEL_NOISE * sim_rng_normal(rng));
+        }
+        for (int i = 0; i < 3; i++) {
+            s->gyro[i] = (float32_t)(gyro_bias[i] + CHECK_GYRO_NOISE * sim_rng_normal(rng));
+        }
+        if (k % (CHECK_GNSS_MS / CHECK_STEP_MS) == 0) {
+            double north = gnss_sigma[1] * sim_rng_normal(rng);
+            double west = gnss_sigma[2] * sim_rng_normal(rng);
+
+            gps[0] = CHECK_LAT + north / CHECK_EARTH_RADIUS * 180.0 / M_PI;
+            gps[1] = CHECK_LON - west / (CHECK_EARTH_RADIUS * cos(lat)) * 180.0 / M_PI;
+            gps[2] = CHECK_HEIGHT + up + gnss_sigma[0] * sim_rng_normal(rng);
+        }
+        if (k % (CHECK_BARO_MS / CHECK_STEP_MS) == 0) {
+            pressure = (float32_t)(check_pressure(CHECK_HEIGHT + up) + CHECK_BARO_NOISE * sim_rng_normal(rng));
+        }
+        memcpy(s->gps, gps, sizeof(gps));
+        s->pressure = pressure;
+        rec->up[rec->count] = up;
+        rec->speed[rec->count] = speed;
+        rec->count++;
+    }
+}
+
+/**
+ * @brief Builds the synthetic recordings, the first with two flights
+ * @param model GNSS noise
+ * @param recs Receives CHECK_RECORDINGS recordings
+ * @return 1 on success, 0 if out of memory
+ */
+static int check_recordings(const SmootherModel *model, CheckRecording *recs) {
+    const size_t per_flight = (size_t)((CHECK_PAD_S + CHECK_BOOST_S + CHECK_COAST_S) * 1000.0 / CHECK_STEP_MS);
+
+    for (uint32_t r = 0; r < CHECK_RECORDINGS; r++) {
+        uint32_t flights = r == 0 ? 2 : 1;
+        CheckRecording *rec = &recs[r];
+        SimRng rng;
+        double accel_bias[3], gyro_bias[3];
+
+        rec->count = 0;
+        rec->samples = malloc(flights * per_flight * sizeof(*rec->samples));
+        rec->up = malloc(flights * per_flight * sizeof(*rec->up));
+        rec->speed = malloc(flights * per_flight * sizeof(*rec->speed));
+        if (rec->samples == NULL || rec->up == NULL || rec->speed == NULL) {
+            return 0;
+        }
+        sim_rng_seed(&rng, CHECK_SEED, r);
+        for (int i = 0; i < 3; i++) {
+            accel_bias[i] = CHECK_ACCEL_BIAS * sim_rng_normal(&rng);
+            gyro_bias[i] = CHECK_GYRO_BIAS * sim_rng_normal(&rng);
+        }
+        for (uint32_t f = 0; f < flights; f++) {
+            // A minute between flights, well past any gap
+            check_flight(model, rec, &rng, 1000 + f * (uint32_t)(per_flight * CHECK_STEP_MS + 60000), accel_bias, gyro_bias);
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Smooths synthetic flights and checks the result against the truth
+ * @param model Noise and initial state
+ * @param threads Threads of the pool
+ * @return 0 if every check passed
+ * @details The smoothed position must beat the filtered one, the errors of
+ *          the position and vertical speed must fall within 3 sigma at least
+ *          CHECK_MIN_COVERAGE of the time, no smoothed sigma may exceed the
+ *          filtered one, and one thread must give the same output as
+ *          threads.
+ */
+static int smoother_check(const SmootherModel *model, long threads) {
+    CheckRecording recs[CHECK_RECORDINGS];
+    SmootherSegment segments[CHECK_RECORDINGS * 2];
+    SmootherResult results[CHECK_RECORDINGS * 2];
+    SmootherResult serial[CHECK_RECORDINGS * 2];
+    size_t n = 0;
+    int ok = 1;
+
+    memset(recs, 0, sizeof(recs));
+    if (!check_recordings(model, recs)) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (uint32_t r = 0; r < CHECK_RECORDINGS; r++) {
+        n += smoother_split(recs[r].samples, recs[r].count, r, SMOOTHER_GAP_MS, &segments[n],
+                            CHECK_RECORDINGS * 2 - n);
+    }
+    if (n != CHECK_RECORDINGS + 1) {
+        printf("split: %zu segments, expected %d: FAILED\n", n, CHECK_RECORDINGS + 1);
+        return 1;
+    }
+    if (smooth_all(model, segments, n, results, threads) != 0 || smooth_all(model, segments, n, serial, 1) != 0) {
+        fprintf(stderr, "failed to start the thread pool\n");
+        return 1;
+    }
+
+    double err2_smoothed = 0.0, err2_filtered = 0.0, sigma_excess = 0.0;
+    size_t inside = 0, checked = 0, points = 0;
+    int identical = 1;
+
+    for (size_t s = 0; s < n; s++) {
+        const SmootherResult *r = &results[s];
+        const CheckRecording *rec = &recs[segments[s].flight];
+        size_t first = (size_t)(segments[s].samples - rec->samples);
+
+        if (r->error != NULL || r->not_pos_def > 0) {
+            printf("segment %zu: %s: FAILED\n", s, r->error != NULL ? r->error : "not positive definite");
+            ok = 0;
+            continue;
+        }
+        identical &= serial[s].count == r->count &&
+                     memcmp(serial[s].points, r->points, r->count * sizeof(*r->points)) == 0;
+
+        // Points start at the last pad sample
+        size_t offset = first + (segments[s].count - r->count);
+        for (size_t k = 0; k < r->count; k++) {
+            const SmootherPoint *p = &r->points[k];
+            const double truth[SMOOTHER_NX] = {rec->up[offset + k], rec->speed[offset + k], 0.0, 0.0, 0.0, 0.0, 0.0};
+            static const int positions[] = {0, 2, 4};
+            static const int graded[] = {0, 1, 2, 4};
+
+            for (size_t g = 0; g < sizeof(positions) / sizeof(positions[0]); g++) {
+                int i = positions[g];
+                err2_smoothed += (p->x[i] - truth[i]) * (p->x[i] - truth[i]);
+                err2_filtered += (p->filtered[i] - truth[i]) * (p->filtered[i] - truth[i]);
+            }
+            for (size_t g = 0; g < sizeof(graded) / sizeof(graded[0]); g++) {
+                int i = graded[g];
+                inside += fabs(p->x[i] - truth[i]) <= 3.0 * p->sigma[i];
+                checked++;
+            }
+            for (int i = 0; i < SMOOTHER_NX; i++) {
+                double excess = (p->sigma[i] - p->filtered_sigma[i]) / p->filtered_sigma[i];
+                sigma_excess = excess > sigma_excess ? excess : sigma_excess;
+            }
+            points++;
+        }
+    }
+
+    double rms_smoothed = sqrt(err2_smoothed / (3.0 * points));
+    double rms_filtered = sqrt(err2_filtered / (3.0 * points));
+    double coverage = checked > 0 ? (double)inside / checked : 0.0;
+
+    print_summary(stdout, segments, results, n);
+    printf("position rms: smoothed %.3f m, filtered %.3f m: %s\n", rms_smoothed, rms_filtered,
+           rms_smoothed < rms_filtered ? "ok" : "FAILED");
+    printf("3 sigma coverage: %.4f, limit %.2f: %s\n", coverage, CHECK_MIN_COVERAGE,
+           coverage >= CHECK_MIN_COVERAGE ? "ok" : "FAILED");
+    printf("smoothed sigma over filtered: %+.2e, limit %.0e: %s\n", sigma_excess, CHECK_SIGMA_TOL,
+           sigma_excess <= CHECK_SIGMA_TOL ? "ok" : "FAILED");
+    printf("1 thread against %ld: %s\n", threads, identical ? "identical" : "FAILED");
+    ok &= rms_smoothed < rms_filtered && coverage >= CHECK_MIN_COVERAGE && sigma_excess <= CHECK_SIGMA_TOL &&
+          identical;
+
+    for (size_t s = 0; s < n; s++) {
+        smoother_result_free(&results[s]);
+        smoother_result_free(&serial[s]);
+    }
+    for (uint32_t r = 0; r < CHECK_RECORDINGS; r++) {
+        free(recs[r].samples);
+        free(recs[r].up);
+        free(recs[r].speed);
+    }
+    return ok ? 0 : 1;
+}
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options] RECORDING...\n"
+            "  --jobs N     threads (default one per core)\n"
+            "  --pad MS     time at rest at the start of each segment (default %d)\n"
+            "  --gap MS     gap in the time stamps that starts a new segment (default %d)\n"
+            "  --out FILE   smoothed trajectory CSV (default stdout)\n"
+            "  --filtered   also write the forward pass and its standard deviations\n"
+            "  --check      smooth synthetic flights and check them against the truth\n"
+            "\n"
+            "Recordings are replay CSVs, t_ms,ax,ay,az,gx,gy,gz,lat,lon,alt[,pressure[,mx,my,mz]].\n"
+            "A per-segment summary goes to stderr. Fails if no segment could be smoothed.\n",
+            argv0, SMOOTHER_PAD_MS, SMOOTHER_GAP_MS);
+}
+
+int main(int argc, char **argv) {
+    SmootherModel model;
+    long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+    uint32_t gap_ms = SMOOTHER_GAP_MS;
+    const char *out_path = "-";
+    int filtered = 0;
+    int check = 0;
+
+    smoother_model_default(&model);
+
+    static const struct option options[] = {
+        {"jobs", required_argument, NULL, 'j'},
+        {"pad", required_argument, NULL, 'p'},
+        {"gap", required_argument, NULL, 'g'},
+        {"out", required_argument, NULL, 'o'},
+        {"filtered", no_argument, NULL, 'f'},
+        {"check", no_argument, NULL, 'k'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'j': jobs = strtol(optarg, NULL, 0); break;
+            case 'p': model.pad_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'g': gap_ms = (uint32_t)strtoul(optarg, NULL, 0); break;
+            case 'o': out_path = optarg; break;
+            case 'f': filtered = 1; break;
+            case 'k': check = 1; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+    if (jobs < 1) {
+        jobs = 1;
+    }
+
+    if (check) {
+        return smoother_check(&model, jobs);
+    }
+    if (optind >= argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    size_t n_flights = argc - optind;
+    ReplaySample **samples = calloc(n_flights, sizeof(*samples));
+    size_t *counts = calloc(n_flights, sizeof(*counts));
+    SmootherSegment *segments = NULL;
+    size_t n = 0;
+
+    if (samples == NULL || counts == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    for (size_t f = 0; f < n_flights; f++) {
+        if (!replay_load_csv(argv[optind + f], &samples[f], &counts[f])) {
+            fprintf(stderr, "%s: could not load the recording\n", argv[optind + f]);
+            return 1;
+        }
+        size_t added = smoother_split(samples[f], counts[f], (uint32_t)f, gap_ms, NULL, 0);
+        SmootherSegment *grown = realloc(segments, (n + added) * sizeof(*segments));
+        if (added > 0 && grown == NULL) {
+            fprintf(stderr, "out of memory\n");
+            return 1;
+        }
+        segments = grown;
+        n += smoother_split(samples[f], counts[f], (uint32_t)f, gap_ms, &segments[n], added);
+    }
+
+    SmootherResult *results = calloc(n > 0 ? n : 1, sizeof(*results));
+    if (results == NULL) {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    if (smooth_all(&model, segments, n, results, jobs) != 0) {
+        fprintf(stderr, "failed to start the thread pool\n");
+        return 1;
+    }
+    clock_gettime(CLOCK_MONOTONIC, &end);
+
+    FILE *out = strcmp(out_path, "-") == 0 ? stdout : fopen(out_path, "w");
+    if (out == NULL) {
+        perror(out_path);
+        return 1;
+    }
+    write_csv(out, segments, results, n, filtered);
+    if (out != stdout) {
+        fclose(out);
+    }
+
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+    size_t smoothed = 0;
+
+    print_summary(stderr, segments, results, n);
+    fprintf(stderr, "%zu segments of %zu recordings on %ld threads in %.2f s\n", n, n_flights, jobs, elapsed);
+    for (size_t s = 0; s < n; s++) {
+        smoothed += results[s].error == NULL;
+        smoother_result_free(&results[s]);
+    }
+    for (size_t f = 0; f < n_flights; f++) {
+        free(samples[f]);
+    }
+    free(samples);
+    free(counts);
+    free(segments);
+    free(results);
+
+    // A short segment, a reset on the pad say, is reported but not an error
+    return smoothed > 0 ? 0 : 1;
+}
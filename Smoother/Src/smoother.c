@@ -0,0 +1,492 @@
+/**
+ * @file smoother.c
+ * @brief Offline Rauch-Tung-Striebel smoother of the flight EKF model
+ */
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "smoother.h"
+#include "flight_ekf.h"
+#include "uart.h"
+
+// Forward pass at one sample, with the transition that led to it
+typedef struct {
+    uint32_t t_ms;
+    float32_t x_f[SMOOTHER_NX];         // filtered
+    float32_t P_f[SMOOTHER_TRI];        // filtered, upper triangle by rows
+    float32_t x_p[SMOOTHER_NX];         // predicted from the previous record
+    float32_t dcm_t[3][3];              // body to flat rotation of the prediction
+    float32_t dt;                       // s, 0 for the first record
+} ForwardRecord;
+
+static inline size_t tri_index(size_t i, size_t j) {
+    if (i > j) {
+        size_t t = i;
+        i = j;
+        j = t;
+    }
+    return i * SMOOTHER_NX - i * (i - 1) / 2 + (j - i);
+}
+
+static void tri_pack(const float32_t *P, float32_t *tri) {
+    for (size_t i = 0; i < SMOOTHER_NX; i++) {
+        for (size_t j = i; j < SMOOTHER_NX; j++) {
+            tri[tri_index(i, j)] = P[i * SMOOTHER_NX + j];
+        }
+    }
+}
+
+/**
+ * @brief Takes the flight EKF's initial state, noise, gates and lever arm
+ * @param model Receives the model
+ * @details Reads them from a filter set up by initialize_ekf(), which binds
+ *          the flight code's globals, so call it before starting threads.
+ */
+void smoother_model_default(SmootherModel *model) {
+    ExtKalmanFilter ekf;
+    Sensors sensors;
+
+    memset(&sensors, 0, sizeof(sensors));
+    initialize_ekf(&ekf, &huart3, &sensors, SMOOTHER_NZ);
+
+    memcpy(model->x0, ekf.x_n.pData, sizeof(model->x0));
+    memcpy(model->P0, ekf.P_n.pData, sizeof(model->P0));
+    memcpy(model->Q, ekf.Q_data, sizeof(model->Q));
+    memcpy(model->R, ekf.R_data, sizeof(model->R));
+    memcpy(model->c, ekf.c, sizeof(model->c));
+    model->gnss_gate = ekf.nis_gate;
+    model->baro_gate = ekf.baro_gate;
+    model->pad_ms = SMOOTHER_PAD_MS;
+}
+
+/**
+ * @brief Splits a recording at gaps in its time stamps
+ * @param samples Recording in time order
+ * @param count Number of samples
+ * @param flight Index of the recording, copied into each segment
+ * @param gap_ms A step longer than this starts a new segment
+ * @param segments Receives the segments, pointing into samples
+ * @param max_segments Room in segments
+ * @return Number of segments, which may be more than max_segments if they
+ *         did not all fit
+ */
+size_t smoother_split(const ReplaySample *samples, size_t count, uint32_t flight, uint32_t gap_ms,
+                      SmootherSegment *segments, size_t max_segments) {
+    size_t n = 0;
+    size_t start = 0;
+
+    for (size_t i = 1; i <= count; i++) {
+        if (i < count && samples[i].t_ms - samples[i - 1].t_ms <= gap_ms) {
+            continue;
+        }
+        if (n < max_segments) {
+            segments[n] = (SmootherSegment){
+                .samples = &samples[start],
+                .count = i - start,
+                .flight = flight,
+                .index = (uint32_t)n,
+            };
+        }
+        n++;
+        start = i;
+    }
+    return n;
+}
+
+/**
+ * @brief Body acceleration without gravity at the centre of mass
+ * @param model Lever arm
+ * @param sample Accelerometer reading
+ * @param accel_bias Pad average taken as the bias
+ * @param w Gyro rate without its bias, rad/s
+ * @param gravity_body Gravity in the body frame, RocketAttitude.frame
+ * @param a Receives the acceleration, m/s^2
+ * @details The IMU sees w x (w x r) more than the centre of mass, with
+ *          r = -c, which is (w w' - |w|^2 I) r. No angular acceleration.
+ */
+static void body_acceleration(const SmootherModel *model, const ReplaySample *sample, const float32_t *accel_bias,
+                              const float32_t *w, const float32_t *gravity_body, float32_t *a) {
+    float32_t w2 = w[0] * w[0] + w[1] * w[1] + w[2] * w[2];
+    float32_t wc = w[0] * model->c[0] + w[1] * model->c[1] + w[2] * model->c[2];
+
+    for (int i = 0; i < 3; i++) {
+        a[i] = sample->accel[i] - accel_bias[i] + w[i] * wc - w2 * model->c[i] + gravity_body[i];
+    }
+}
+
+/**
+ * @brief Filters a segment forward and keeps every record
+ * @param model Noise and initial state
+ * @param segment Samples to filter
+ * @param pad Samples the biases and references are averaged over
+ * @param records Receives segment->count - pad + 1 records
+ * @param result Receives the update counts
+ */
+static void forward_pass(const SmootherModel *model, const SmootherSegment *segment, size_t pad,
+                         ForwardRecord *records, SmootherResult *result) {
+    const ReplaySample *s = segment->samples;
+    float32_t accel_bias[3] = {0.0f, 0.0f, 0.0f};
+    float32_t gyro_bias[3] = {0.0f, 0.0f, 0.0f};
+    float32_t launch[3] = {0.0f, 0.0f, 0.0f};
+    float32_t baro_ref = 0.0f;
+    size_t baro_count = 0;
+    GnssOrigin origin;
+    GpsFix fix;
+    RocketAttitude atd;
+    ExtKalmanFilter baro;       // only the fields baro_update_step() reads
+    EkfHealth gnss_health;
+    float32_t x[SMOOTHER_NX];
+    float32_t P[SMOOTHER_NX * SMOOTHER_NX];
+    float32_t Q[SMOOTHER_NX * SMOOTHER_NX];
+
+    memset(&fix, 0, sizeof(fix));
+    memset(&origin, 0, sizeof(origin));
+    initialize_rocket_attitude(&atd, 1.0f, 0.0f, 0.0f, 0.0f);
+
+    // At rest on the pad the accelerometer reads -g in the body frame, the
+    // gyro reads its bias and the GNSS and barometer read the launch point
+    gnss_fix_from_degrees(&fix, s[0].gps[0], s[0].gps[1], s[0].gps[2]);
+    gnss_origin_set(&origin, &fix);
+    for (size_t k = 0; k < pad; k++) {
+        float32_t enu[3];
+
+        gnss_fix_from_degrees(&fix, s[k].gps[0], s[k].gps[1], s[k].gps[2]);
+        gnss_origin_fix_to_enu(&origin, &fix, enu);
+        launch[0] += enu[2];
+        launch[1] += enu[1];
+        launch[2] -= enu[0];
+        for (int i = 0; i < 3; i++) {
+            accel_bias[i] += s[k].accel[i];
+            gyro_bias[i] += s[k].gyro[i];
+        }
+        if (s[k].pressure > 0.0f) {
+            baro_ref += baro_altitude(s[k].pressure, NULL);
+            baro_count++;
+        }
+    }
+    for (int i = 0; i < 3; i++) {
+        launch[i] /= (float32_t)pad;
+        accel_bias[i] = accel_bias[i] / (float32_t)pad + atd.frame.gravity_body[i];
+        gyro_bias[i] /= (float32_t)pad;
+    }
+    if (baro_count > 0) {
+        baro_ref /= (float32_t)baro_count;
+    }
+
+    memcpy(x, model->x0, sizeof(x));
+    memcpy(P, model->P0, sizeof(P));
+    memset(Q, 0, sizeof(Q));
+
+    memset(&baro, 0, sizeof(baro));
+    baro.nx = SMOOTHER_NX;
+    arm_mat_init_f32(&baro.x_n, SMOOTHER_NX, 1, x);
+    arm_mat_init_f32(&baro.P_n, SMOOTHER_NX, SMOOTHER_NX, P);
+    baro.baro_gate = model->baro_gate;
+    ekf_health_init(&baro.health);
+    ekf_health_init(&baro.baro_health);
+    ekf_health_init(&gnss_health);
+
+    records[0].t_ms = s[pad - 1].t_ms;
+    memcpy(records[0].x_f, x, sizeof(x));
+    memcpy(records[0].x_p, x, sizeof(x));
+    tri_pack(P, records[0].P_f);
+    memcpy(records[0].dcm_t, atd.frame.dcm_t, sizeof(records[0].dcm_t));
+    records[0].dt = 0.0f;
+
+    for (size_t k = pad; k < segment->count; k++) {
+        const ReplaySample *sample = &s[k];
+        ForwardRecord *record = &records[k - pad + 1];
+        float32_t dt = (float32_t)(sample->t_ms - s[k - 1].t_ms) * 1e-3f;
+        float32_t w[3], a[3], F[SMOOTHER_NX * SMOOTHER_NX];
+
+        for (int i = 0; i < 3; i++) {
+            w[i] = sample->gyro[i] - gyro_bias[i];
+        }
+        atd.time_step = dt;
+        run_attitude_estimation(&atd, w);
+        body_acceleration(model, sample, accel_bias, w, atd.frame.gravity_body, a);
+
+        // Q is a noise density, scaled by the actual step
+        for (int i = 0; i < SMOOTHER_NX; i++) {
+            Q[i * (SMOOTHER_NX + 1)] = model->Q[i * (SMOOTHER_NX + 1)] * dt / SMOOTHER_CYCLE_S;
+        }
+        flight_ekf_model_F(atd.frame.dcm_t, a, dt, F);
+        flight_ekf_model_f(x, atd.frame.dcm_t, a, dt, x);
+        flight_ekf_model_predict_covariance(F, Q, P, P);
+        memcpy(record->x_p, x, sizeof(x));
+
+        // Each fix and each reading is fused once, not for as long as it is held
+        if (memcmp(sample->gps, s[k - 1].gps, sizeof(sample->gps)) != 0) {
+            float32_t enu[3], z[SMOOTHER_NZ], h[SMOOTHER_NZ], innovation[SMOOTHER_NZ];
+            float32_t K[SMOOTHER_NX * SMOOTHER_NZ], S_inv[SMOOTHER_NZ * SMOOTHER_NZ];
+
+            gnss_fix_from_degrees(&fix, sample->gps[0], sample->gps[1], sample->gps[2]);
+            gnss_origin_fix_to_enu(&origin, &fix, enu);
+            z[0] = enu[2] - launch[0];
+            z[1] = enu[1] - launch[1];
+            z[2] = -enu[0] - launch[2];
+            flight_ekf_model_h(x, h);
+            if (flight_ekf_model_gain(P, model->R, K, S_inv) == ARM_MATH_SUCCESS) {
+                for (int i = 0; i < SMOOTHER_NZ; i++) {
+                    innovation[i] = z[i] - h[i];
+                }
+                if (ekf_health_gate(&gnss_health, ekf_nis(innovation, S_inv, SMOOTHER_NZ), model->gnss_gate)) {
+                    flight_ekf_model_update_state(x, K, innovation, x);
+                    flight_ekf_model_update_covariance(P, K, model->R, P);
+                    result->gnss_fused++;
+                } else {
+                    result->gnss_rejected++;
+                }
+            } else {
+                result->gnss_rejected++;
+            }
+        }
+        if (baro_count > 0 && sample->pressure > 0.0f && sample->pressure != s[k - 1].pressure) {
+            baro.barometer = baro_altitude(sample->pressure, &baro.baro_slope) - baro_ref;
+            baro.baro_valid = 1;
+            baro.baro_health.accepted = 0;
+            baro.baro_health.rejected = 0;
+            baro_update_step(&baro, &huart3);
+            result->baro_fused += baro.baro_health.accepted;
+            result->baro_rejected += baro.baro_health.rejected;
+        }
+
+        record->t_ms = sample->t_ms;
+        record->dt = dt;
+        memcpy(record->x_f, x, sizeof(x));
+        tri_pack(P, record->P_f);
+        memcpy(record->dcm_t, atd.frame.dcm_t, sizeof(record->dcm_t));
+    }
+}
+
+/**
+ * @brief Cholesky factor of a symmetric positive definite matrix, in place
+ * @param A Matrix, its lower triangle receives L with A = L L'
+ * @return 1 on success, 0 if A is not positive definite
+ */
+static int cholesky(double A[SMOOTHER_NX][SMOOTHER_NX]) {
+    for (int j = 0; j < SMOOTHER_NX; j++) {
+        double d = A[j][j];
+        for (int k = 0; k < j; k++) {
+            d -= A[j][k] * A[j][k];
+        }
+        if (!(d > 0.0)) {
+            return 0;
+        }
+        A[j][j] = sqrt(d);
+        for (int i = j + 1; i < SMOOTHER_NX; i++) {
+            double v = A[i][j];
+            for (int k = 0; k < j; k++) {
+                v -= A[i][k] * A[j][k];
+            }
+            A[i][j] = v / A[j][j];
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief One backward step, from the smoothed record k + 1 to record k
+ * @param model Process noise
+ * @param cur Forward record k
+ * @param next Forward record k + 1, with the transition from k
+ * @param x_s Smoothed state of k + 1, receives that of k
+ * @param P_s Smoothed covariance of k + 1, receives that of k
+ * @return 1 on success, 0 if the predicted covariance is not positive
+ *         definite, in which case record k is taken as filtered
+ * @details With A = F Pf and Pp = A F' + Q = L L', the gain G = Pf F' Pp^-1
+ *          is the transpose of the solution of Pp Y = A by two triangular
+ *          solves. The covariance is formed as
+ *          (I - G F) Pf (I - G F)' + G Q G' + G Ps' G', which equals
+ *          Pf + G (Ps' - Pp) G' but is a sum of positive semidefinite terms
+ *          and does not lose that to rounding.
+ */
+static int backward_step(const SmootherModel *model, const ForwardRecord *cur, const ForwardRecord *next,
+                         double x_s[SMOOTHER_NX], double P_s[SMOOTHER_NX][SMOOTHER_NX]) {
+    const int n = SMOOTHER_NX;
+    float32_t F32[SMOOTHER_NX * SMOOTHER_NX];
+    const float32_t no_accel[3] = {0.0f, 0.0f, 0.0f};
+    double F[SMOOTHER_NX][SMOOTHER_NX], Pf[SMOOTHER_NX][SMOOTHER_NX], Q[SMOOTHER_NX];
+    double A[SMOOTHER_NX][SMOOTHER_NX], L[SMOOTHER_NX][SMOOTHER_NX], G[SMOOTHER_NX][SMOOTHER_NX];
+    double M[SMOOTHER_NX][SMOOTHER_NX], T[SMOOTHER_NX][SMOOTHER_NX], P[SMOOTHER_NX][SMOOTHER_NX];
+
+    // The Jacobian of this model does not depend on the acceleration
+    flight_ekf_model_F(next->dcm_t, no_accel, next->dt, F32);
+    for (int i = 0; i < n; i++) {
+        Q[i] = (double)model->Q[i * (n + 1)] * next->dt / SMOOTHER_CYCLE_S;
+        for (int j = 0; j < n; j++) {
+            F[i][j] = F32[i * n + j];
+            Pf[i][j] = cur->P_f[tri_index(i, j)];
+        }
+    }
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double v = 0.0;
+            for (int k = 0; k < n; k++) {
+                v += F[i][k] * Pf[k][j];
+            }
+            A[i][j] = v;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double v = i == j ? Q[i] : 0.0;
+            for (int k = 0; k < n; k++) {
+                v += A[i][k] * F[j][k];
+            }
+            L[i][j] = L[j][i] = v;
+        }
+    }
+    if (!cholesky(L)) {
+        for (int i = 0; i < n; i++) {
+            x_s[i] = cur->x_f[i];
+            for (int j = 0; j < n; j++) {
+                P_s[i][j] = Pf[i][j];
+            }
+        }
+        return 0;
+    }
+
+    // L L' Y = A column by column, G = Y'
+    for (int c = 0; c < n; c++) {
+        double y[SMOOTHER_NX];
+        for (int i = 0; i < n; i++) {
+            double v = A[i][c];
+            for (int k = 0; k < i; k++) {
+                v -= L[i][k] * y[k];
+            }
+            y[i] = v / L[i][i];
+        }
+        for (int i = n - 1; i >= 0; i--) {
+            double v = y[i];
+            for (int k = i + 1; k < n; k++) {
+                v -= L[k][i] * y[k];
+            }
+            y[i] = v / L[i][i];
+        }
+        for (int i = 0; i < n; i++) {
+            G[c][i] = y[i];
+        }
+    }
+
+    double dx[SMOOTHER_NX];
+    for (int i = 0; i < n; i++) {
+        dx[i] = x_s[i] - next->x_p[i];
+    }
+    for (int i = 0; i < n; i++) {
+        double v = cur->x_f[i];
+        for (int k = 0; k < n; k++) {
+            v += G[i][k] * dx[k];
+        }
+        x_s[i] = v;
+    }
+
+    // M = I - G F, then P = M Pf M' + G (Q + Ps') G'
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double v = i == j ? 1.0 : 0.0;
+            for (int k = 0; k < n; k++) {
+                v -= G[i][k] * F[k][j];
+            }
+            M[i][j] = v;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double v = 0.0, w = 0.0;
+            for (int k = 0; k < n; k++) {
+                v += M[i][k] * Pf[k][j];
+                w += G[i][k] * (P_s[k][j] + (k == j ? Q[k] : 0.0));
+            }
+            A[i][j] = v;
+            T[i][j] = w;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            double v = 0.0;
+            for (int k = 0; k < n; k++) {
+                v += A[i][k] * M[j][k] + T[i][k] * G[j][k];
+            }
+            P[i][j] = v;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j <= i; j++) {
+            P_s[i][j] = P_s[j][i] = P[i][j];
+        }
+    }
+    return 1;
+}
+
+static void point_from(SmootherPoint *point, const ForwardRecord *record, const double *x_s,
+                       double P_s[SMOOTHER_NX][SMOOTHER_NX]) {
+    point->t_ms = record->t_ms;
+    for (int i = 0; i < SMOOTHER_NX; i++) {
+        point->x[i] = (float32_t)x_s[i];
+        point->sigma[i] = (float32_t)sqrt(fmax(P_s[i][i], 0.0));
+        point->filtered[i] = record->x_f[i];
+        point->filtered_sigma[i] = sqrtf(fmaxf(record->P_f[tri_index(i, i)], 0.0f));
+    }
+}
+
+/**
+ * @brief Filters and smooths one segment
+ * @param model Noise and initial state, smoother_model_default()
+ * @param segment Samples, starting with model->pad_ms at rest
+ * @param result Receives the smoothed points from the last pad sample on,
+ *        free with smoother_result_free()
+ * @details Reentrant, the state lives on the stack and in result.
+ */
+void smoother_run_segment(const SmootherModel *model, const SmootherSegment *segment, SmootherResult *result) {
+    const ReplaySample *s = segment->samples;
+    size_t pad = 0;
+
+    memset(result, 0, sizeof(*result));
+    while (pad < segment->count && s[pad].t_ms - s[0].t_ms < model->pad_ms) {
+        pad++;
+    }
+    if (pad == 0 || pad >= segment->count) {
+        result->error = "shorter than the pad";
+        return;
+    }
+
+    size_t n = segment->count - pad + 1;
+    ForwardRecord *records = malloc(n * sizeof(*records));
+    result->points = malloc(n * sizeof(*result->points));
+    if (records == NULL || result->points == NULL) {
+        free(records);
+        smoother_result_free(result);
+        result->error = "out of memory";
+        return;
+    }
+    result->count = n;
+
+    forward_pass(model, segment, pad, records, result);
+
+    double x_s[SMOOTHER_NX];
+    double P_s[SMOOTHER_NX][SMOOTHER_NX];
+    for (int i = 0; i < SMOOTHER_NX; i++) {
+        x_s[i] = records[n - 1].x_f[i];
+        for (int j = 0; j < SMOOTHER_NX; j++) {
+            P_s[i][j] = records[n - 1].P_f[tri_index(i, j)];
+        }
+    }
+    point_from(&result->points[n - 1], &records[n - 1], x_s, P_s);
+    for (size_t k = n - 1; k-- > 0;) {
+        if (!backward_step(model, &records[k], &records[k + 1], x_s, P_s)) {
+            result->not_pos_def++;
+        }
+        point_from(&result->points[k], &records[k], x_s, P_s);
+    }
+    free(records);
+}
+
+void smoother_result_free(SmootherResult *result) {
+    free(result->points);
+    result->points = NULL;
+    result->count = 0;
+}
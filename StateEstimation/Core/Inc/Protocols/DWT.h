@@ -11,6 +11,7 @@
 // Initialize DWT
 void DWT_Init(void);
 uint32_t DWT_GetMicros(void);
+uint32_t DWT_GetCycles(void);
 void delay_us(uint32_t microseconds);
 float32_t DWT_TicksToSeconds(uint32_t ticks);
 
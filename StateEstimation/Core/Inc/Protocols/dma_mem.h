@@ -0,0 +1,32 @@
+/**
+ * @file dma_mem.h
+ * @brief Cache, MPU and DMA buffer management
+ */
+#ifndef __DMA_MEM_H__
+#define __DMA_MEM_H__
+
+#include "stm32h7xx_hal.h"
+#include <stddef.h>
+#include <stdint.h>
+
+/* RAM_D2 is marked non-cacheable by the MPU and holds every DMA buffer */
+#define DMA_NONCACHEABLE_BASE   0x30000000UL
+#define DMA_NONCACHEABLE_SIZE   (32U * 1024U)
+
+/* Pool handed out by dma_alloc, carved from the same region */
+#define DMA_POOL_SIZE           (8U * 1024U)
+#define DMA_ALIGNMENT           32U
+
+/* Place a static buffer in the non-cacheable DMA region */
+#define DMA_BUFFER __attribute__((section(".buffer"), aligned(DMA_ALIGNMENT)))
+
+void MPU_Config(void);
+void cache_init(void);
+
+void *dma_alloc(size_t size);
+size_t dma_pool_free(void);
+
+void dma_clean(const void *addr, size_t size);
+void dma_invalidate(void *addr, size_t size);
+
+#endif /* __DMA_MEM_H__ */
@@ -14,5 +14,7 @@ void MX_SPI6_Init(void);
 extern SPI_HandleTypeDef hspi2;
 extern SPI_HandleTypeDef hspi4;
 extern SPI_HandleTypeDef hspi6;
+extern DMA_HandleTypeDef hdma_spi4_rx;
+extern DMA_HandleTypeDef hdma_spi4_tx;
 
 #endif /* __SPI_H__ */
\ No newline at end of file
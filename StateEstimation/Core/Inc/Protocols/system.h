@@ -10,11 +10,13 @@
 void SystemClock_Config(void);
 void Error_Handler(void);
 void MX_DMA_Init(void);
+void MX_TIM2_Init(void);
 void MX_TIM6_Init(void);
 void MX_TIM7_Init(void);
 void MX_GPIO_Init(void);
 
 // Timer handles (used by other modules)
+extern TIM_HandleTypeDef htim2;
 extern TIM_HandleTypeDef htim6;
 extern TIM_HandleTypeDef htim7;
 
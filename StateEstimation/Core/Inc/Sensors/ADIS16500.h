@@ -76,6 +76,9 @@ typedef enum {
     ADIS_FLSHCNT_HIGH = 0x7E
 } ADIS_RegAddr;
 
+#define ADIS_BURST_CMD 0x6800
+#define ADIS_BURST_FRAMES 11    // command, then DIAG_STAT to CHECKSUM
+
 typedef struct {
     uint16_t diag_stat;
     uint16_t data_cntr;
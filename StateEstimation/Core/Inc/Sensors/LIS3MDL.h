@@ -30,7 +30,7 @@
 #define LIS3MDL_REG_CTRL4               0x23
 #define LIS3MDL_REG_CTRL5               0x24
 
-#define LIS3MDL_REG_REG                 0x27
+#define LIS3MDL_REG_STATUS              0x27
 #define LIS3MDL_REG_OUT_X_L             0x28
 #define LIS3MDL_REG_OUT_X_H             0x29
 #define LIS3MDL_REG_OUT_Y_L             0x2A
@@ -127,8 +127,17 @@
 #define LIS3MDL_BLOCK_UPDATE_EN         0b01000000
 #define LIS3MDL_BLOCK_UPDATE_DIS        0b00000000
 
+/* LIS3MDL STATUS_REG Map */
+#define LIS3MDL_STATUS_ZYXDA            0b00001000
+#define LIS3MDL_STATUS_ZYXOR            0b10000000
+
 /* LIS3MSL DEFINES */
 
+// SPI4 carries 16-bit frames for the ADIS16500, a register burst is sent two
+// bytes to a frame, high byte first. STATUS plus the six output bytes and the
+// command byte fill four frames exactly.
+#define LIS3MDL_DMA_FRAMES              4
+
 enum lis3mdl_err {
     LIS3MDL_ERR_OK,
     LIS3MDL_ERR_GENERAL,
@@ -144,6 +153,12 @@ struct lis3mdl_device {
     SPI_HandleTypeDef *spi_handle;
     GPIO_TypeDef *cs_pin;
     uint16_t cs_pin_port;
+    uint16_t *dma_tx;           // LIS3MDL_DMA_FRAMES, in the non-cacheable DMA region
+    uint16_t *dma_rx;
+    volatile uint8_t dma_busy;  // burst in flight, the bus is not free
+    volatile uint8_t dma_done;  // dma_rx holds a burst not yet looked at
+    uint32_t dma_start_ms;      // HAL_GetTick() when the burst was started
+    uint32_t last_sample_ms;    // HAL_GetTick() of the burst that returned the last new field
 };
 
 enum lis3mdl_err lis3mdl_initialize(struct lis3mdl_device *device);
@@ -154,6 +169,11 @@ enum lis3mdl_err lis3mdl_read_temp(struct lis3mdl_device *device, double *temp);
 
 enum lis3mdl_err lis3mdl_read_mag(struct lis3mdl_device *device, double *mag_reading);
 
+enum lis3mdl_err lis3mdl_start_read_mag_dma(struct lis3mdl_device *device);
+void lis3mdl_dma_complete(struct lis3mdl_device *device);
+void lis3mdl_dma_abort(struct lis3mdl_device *device);
+uint8_t lis3mdl_get_mag_dma(struct lis3mdl_device *device, float *mag_reading);
+
 enum lis3mdl_err lis3mdl_write_register(struct lis3mdl_device *device, uint8_t reg, uint8_t data);
 enum lis3mdl_err lis3mdl_read_register(struct lis3mdl_device *device, uint8_t reg, uint8_t *data);
 enum lis3mdl_err lis3mdl_write_multiple_registers(struct lis3mdl_device *device, uint8_t start_reg, uint8_t bytes, uint8_t *data);
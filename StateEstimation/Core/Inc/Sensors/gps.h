@@ -13,6 +13,9 @@
 
 #define UBLOX_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES 64
 
+// version, layers, transaction or position, reserved
+#define UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES 4
+
 #define UBLOX_GNSS_CFG_VAL_KEY_GROUP_ID_ALL 0xFFF
 
 #define UBLOX_GNSS_CFG_VAL_KEY_ITEM_ID_ALL 0xFFFF
@@ -21,7 +24,27 @@
 #define UBLOX_GNSS_DEC_UBX_NAV_COV_BODY_LENGTH     64
 #define UBLOX_GNSS_DEC_UBX_NAV_POSECEF_BODY_LENGTH 20
 #define UBLOX_GNSS_DEC_UBX_NAV_POSLLH_BODY_LENGTH  28
+#define UBLOX_GNSS_DEC_UBX_NAV_VELNED_BODY_LENGTH  36
 #define UBLOX_GNSS_DEC_UBX_NAV_PVT_BODY_LENGTH 92
+#define UBLOX_GNSS_DEC_UBX_ACK_BODY_LENGTH 2
+
+// Configuration keys used here, from the u-blox M9 and F9 interface descriptions
+#define UBLOX_GNSS_CFG_NAVSPG_FIXMODE 0x20110011
+#define UBLOX_GNSS_CFG_NAVSPG_DYNMODEL 0x20110021
+#define UBLOX_GNSS_CFG_RATE_MEAS 0x30210001
+#define UBLOX_GNSS_CFG_RATE_NAV 0x30210002
+#define UBLOX_GNSS_CFG_UART1_BAUDRATE 0x40520001
+#define UBLOX_GNSS_CFG_UART1_ENABLED 0x10520005
+#define UBLOX_GNSS_CFG_UART1INPROT_UBX 0x10730001
+#define UBLOX_GNSS_CFG_UART1OUTPROT_UBX 0x10740001
+#define UBLOX_GNSS_CFG_UART1OUTPROT_NMEA 0x10740002
+#define UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_PVT_UART1 0x20910007
+#define UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_POSECEF_UART1 0x20910025
+#define UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_POSLLH_UART1 0x2091002a
+#define UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_HPPOSECEF_UART1 0x2091002f
+#define UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_TIMEUTC_UART1 0x2091005c
+#define UBLOX_GNSS_CFG_TP_TP1_ENA 0x10050007
+#define UBLOX_GNSS_CFG_TP_TIMEGRID_TP1 0x2005000c
 
 #define UBLOX_GNSS_CFG_VAL_KEY_GET_ITEM_ID(key_id)                             \
   (((uint32_t)(key_id)) & 0xFFFF)
@@ -39,6 +62,7 @@
 
 enum ublox_gnss_err {
   UBLOX_GNSS_ERR_OK,
+  UBLOX_GNSS_ERR_BUSY,
 };
 
 enum ublox_gnss_transport_type {
@@ -85,6 +109,12 @@ struct ublox_gnss_cfg_val {
   uint64_t value;
 };
 
+struct ublox_gnss_ack {
+  uint8_t cls_id;
+  uint8_t msg_id;
+  bool ack;
+};
+
 struct ublox_gnss_nav_timeutc {
   uint32_t itow;
   uint32_t t_acc;
@@ -298,6 +328,28 @@ void ublox_gnss_cfg_val_set_list(
     uint16_t number_of_values, enum ublox_gnss_cfg_val_transaction transaction,
     uint32_t layers);
 
+uint16_t ublox_gnss_cfg_val_set_encode(
+    const struct ublox_gnss_cfg_val *list, uint16_t number_of_values,
+    enum ublox_gnss_cfg_val_transaction transaction, uint32_t layers,
+    uint8_t *buf, uint16_t buf_length_bytes);
+
+uint16_t ublox_gnss_cfg_val_get_encode(const struct ublox_gnss_cfg_val *list,
+                                       uint16_t number_of_values,
+                                       enum ublox_gnss_cfg_val_layer layer,
+                                       uint16_t position, uint8_t *buf,
+                                       uint16_t buf_length_bytes);
+
+uint16_t ublox_gnss_dec_ubx_cfg_valget(const uint8_t *msg,
+                                       uint16_t msg_length_bytes,
+                                       struct ublox_gnss_cfg_val *list,
+                                       uint16_t max_values);
+
+uint64_t ublox_gnss_cfg_val_mask(uint32_t key_id, uint64_t value);
+
+bool ublox_gnss_dec_ubx_ack(uint8_t class, uint8_t id, const uint8_t *msg,
+                            uint16_t msg_length_bytes,
+                            struct ublox_gnss_ack *ack);
+
 void ublox_gnss_cfg_val_set(struct ublox_gnss_device *device, uint32_t key_id,
                             uint64_t value,
                             enum ublox_gnss_cfg_val_transaction transaction,
@@ -315,6 +367,9 @@ void ublox_gnss_dec_ubx_nav_posecef(uint8_t *msg, uint16_t msg_length_bytes,
 void ublox_gnss_dec_ubx_nav_posllh(uint8_t *msg, uint16_t msg_length_bytes,
                                    struct ublox_gnss_nav_posllh *nav_posllh);
 
+void ublox_gnss_dec_ubx_nav_velned(uint8_t *msg, uint16_t msg_length_bytes,
+                                   struct ublox_gnss_nav_velned *nav_velned);
+
 void ublox_gnss_dec_ubx_nav_pvt(uint8_t *msg, uint16_t msg_length_bytes,
                                 struct ublox_gnss_nav_pvt *nav_pvt);
 
@@ -4,27 +4,67 @@
 #include "stm32h7xx_hal.h"
 #include "ADIS16500.h"
 #include "gps.h"
+#include "ublox_config.h"
 #include "MS5607.h"
 #include "LIS3MDL.h"
 #include "ring_buffer.h"
+#include "imu_pipeline.h"
+#include "vibration_monitor.h"
+#include "time_sync.h"
+#include "event_detector.h"
+#include "fault_detector.h"
 
 #include "spi.h"
 #include "uart.h"
 #include "i2c.h"
 #include "system.h"
 #include "DWT.h"
+#include "dma_mem.h"
+
+#define ADIS_DR_PIN GPIO_PIN_9     // PE9, ADIS16500 DIO2 data ready, rising edge
+#define IMU_STALE_MS 20            // run a cycle without a new IMU block after this long
+#define GPS_PPS_PIN GPIO_PIN_15    // PA15, TIM2_CH1, the receiver's TIMEPULSE, rising edge
+#define GPS_VALID_TIME 0x02        // NAV-PVT valid, validTime
 
 extern struct ADIS_Device imu_device;
+extern ImuPipeline imu_pipeline;
+extern VibrationMonitor vibration_monitor;
+extern EventDetector event_detector;
+extern FaultDetector fault_detector;
 extern struct lis3mdl_device mag_device;
 extern MS5607StateTypeDef ms5607_state;
 
 extern struct ublox_gnss_device gps;
-__attribute__((section(".buffer"))) extern uint8_t uart4_rx_dma_buffer[1024];
+extern uint8_t uart4_rx_dma_buffer[1024];
 extern uint16_t uart4_rx_dma_buffer_size;
 extern struct ring_buffer uart4_rx_rb;
 extern struct ring_buffer usart3_rx_rb;
 extern uint8_t uart4_rx_rb_data[512];
-extern struct ublox_gnss_cfg_val cfg[10];
+extern UbloxConfig gps_config;
+extern TimeSync time_sync;
+extern volatile uint32_t uart4_rx_time_us;
+
+// Where GpsFix.time_us came from
+typedef enum {
+  GPS_TIME_NONE,      // no time stamp, the host builds
+  GPS_TIME_ARRIVAL,   // when the solution came in over UART4, late by the receiver's latency
+  GPS_TIME_PPS,       // its time of week mapped through the time pulse
+} GpsTimeSource;
+
+// GNSS position in the receiver's integer units, exact for HPPVT
+typedef struct {
+  int64_t lat;      // 1e-9 deg
+  int64_t lon;      // 1e-9 deg
+  int64_t height;   // 0.1 mm above the ellipsoid
+  uint8_t valid;    // 3D fix flagged gnssFixOK, 0 until the first such fix
+  uint8_t time_source;  // GpsTimeSource of time_us
+  uint32_t tow;     // ms, GPS time of week of the solution
+  uint32_t time_us; // local timeline, when the solution is valid
+  uint8_t pos_new;  // lat, lon and height are from a valid solution GPS2Flat() has not taken yet
+  float32_t vel_ned[3]; // m/s, north east down
+  float32_t vel_acc;    // m/s, 1 sigma speed accuracy the receiver reports
+  uint8_t vel_new;      // vel_ned is from a valid solution GPS2Flat() has not taken yet
+} GpsFix;
 
 // Sensor readings
 typedef struct {
@@ -47,11 +87,28 @@ typedef struct {
   float32_t gps_offset_x; 
   float32_t gps_offset_y;
   float32_t gps_offset_z;
+  GpsFix gps_fix;
+  float32_t pressure;     // Pa, MS5607, 0 until the first reading
+  float32_t mag_x;        // Gauss, LIS3MDL in the body frame, uncalibrated
+  float32_t mag_y;
+  float32_t mag_z;
+  float32_t mag_offset_x; // Gauss, hard iron, from mag_calibrator_apply()
+  float32_t mag_offset_y;
+  float32_t mag_offset_z;
+  float32_t mag_scale_x;  // soft iron, 1 until calibrated
+  float32_t mag_scale_y;
+  float32_t mag_scale_z;
+  uint8_t mag_new;        // mag_x..z were updated this cycle
+  uint8_t imu_new;        // accel and gyro are a new block from the IMU pipeline
+  uint32_t imu_time_us;   // local timeline, last ADIS16500 sample of the block
+  uint32_t mag_time_us;   // local timeline, start of the magnetometer read
+  uint32_t baro_time_us;  // local timeline, when the pressure was read
 } Sensors;
 
 
 void protocol_init(void);
-void update_sensors(Sensors *sensors, UART_HandleTypeDef *huart);
+uint32_t sensor_time_us(void);
+uint8_t update_sensors(Sensors *sensors, UART_HandleTypeDef *huart);
 void sensors_init(Sensors *sensors);
 
 
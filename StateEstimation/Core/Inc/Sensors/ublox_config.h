@@ -0,0 +1,78 @@
+/**
+ * @file ublox_config.h
+ * @brief Non-blocking u-blox configuration, acknowledged and read back key by key
+ *
+ * @details The profile is a list of configuration keys and values for the RAM
+ *          layer. It goes out UBLOX_CONFIG_BATCH keys at a time, each batch as
+ *          a transaction of its own:
+ *
+ *          SET     one CFG-VALSET with the batch, waiting for the ACK-ACK
+ *                  that names CFG-VALSET
+ *          VERIFY  one CFG-VALGET of the same keys, waiting for the response,
+ *                  whose values must equal the profile's
+ *
+ *          A NAK, a wrong value or no answer within UBLOX_CONFIG_TIMEOUT_MS
+ *          sends the batch again, from SET after a wrong value and from the
+ *          step that failed otherwise. A batch that is still not through after
+ *          UBLOX_CONFIG_SENDS frames is given up and counted, and the next one
+ *          is started, so one key the receiver does not know leaves the rest
+ *          of the profile in place. The engine finishes in UBLOX_CONFIG_DONE
+ *          if every batch was verified and UBLOX_CONFIG_FAILED otherwise.
+ *
+ *          Nothing here waits. ublox_config_poll() sends what is due and
+ *          notices timeouts, ublox_config_handle() takes the frames the
+ *          receiver sends back, both from update_sensors(), and a frame that
+ *          cannot be queued because the UART is still sending is tried again
+ *          on the next poll. Keep the batches within the receiver's 64 keys
+ *          and the profile in memory for as long as the engine runs.
+ */
+#ifndef __UBLOX_CONFIG_H__
+#define __UBLOX_CONFIG_H__
+
+#include "gps.h"
+#include <stdint.h>
+
+#define UBLOX_CONFIG_BATCH 8                // keys per CFG-VALSET and CFG-VALGET
+#define UBLOX_CONFIG_TIMEOUT_MS 500         // for the ACK or the CFG-VALGET response
+#define UBLOX_CONFIG_SENDS 8                // frames per batch before it is given up
+
+// CFG-VALSET of a full batch of keys with 8 byte values
+#define UBLOX_CONFIG_TX_BYTES                                                           \
+    (UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES + UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES + \
+     UBLOX_CONFIG_BATCH * 12)
+
+typedef enum {
+    UBLOX_CONFIG_IDLE,
+    UBLOX_CONFIG_SET,           // CFG-VALSET of the batch, waiting for the ACK
+    UBLOX_CONFIG_VERIFY,        // CFG-VALGET of the batch, waiting for the values
+    UBLOX_CONFIG_DONE,          // every batch verified
+    UBLOX_CONFIG_FAILED,        // finished with at least one batch given up
+} UbloxConfigState;
+
+typedef struct {
+    struct ublox_gnss_device *device;
+    const struct ublox_gnss_cfg_val *profile;
+    uint16_t count;             // keys in the profile
+    uint16_t first;             // first key of the batch in flight
+    uint16_t batch;             // keys in it
+
+    UbloxConfigState state;
+    uint8_t pending;            // the frame of the state still has to be sent
+    uint8_t sends;              // frames sent for the batch
+    uint32_t sent_ms;           // HAL_GetTick() when the last one went out
+    uint8_t tx[UBLOX_CONFIG_TX_BYTES];  // frame being sent
+
+    uint16_t acks;
+    uint16_t naks;
+    uint16_t timeouts;
+    uint16_t mismatches;        // CFG-VALGET responses with a wrong value
+    uint16_t failed;            // batches given up
+} UbloxConfig;
+
+void ublox_config_start(UbloxConfig *cfg, struct ublox_gnss_device *device,
+                        const struct ublox_gnss_cfg_val *profile, uint16_t count);
+void ublox_config_poll(UbloxConfig *cfg, uint32_t now);
+uint8_t ublox_config_handle(UbloxConfig *cfg, uint8_t cls, uint8_t id, const uint8_t *msg, uint16_t len);
+uint8_t ublox_config_finished(const UbloxConfig *cfg);
+
+#endif /* __UBLOX_CONFIG_H__ */
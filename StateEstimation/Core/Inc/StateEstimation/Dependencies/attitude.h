@@ -17,6 +17,24 @@
 #include <math.h>
 #include "arm_math.h"
 
+#define ATTITUDE_MAG_GAIN 0.2f          // 1/s, heading error decays with a 5 s time constant
+#define ATTITUDE_MAG_REF_WEIGHT 0.0625f // pad field average over about 16 samples
+#define ATTITUDE_MAG_MAX_ERROR 0.2f     // relative field strength error taken as a disturbance
+#define ATTITUDE_MAG_MIN_HORIZONTAL 0.1f // horizontal share of the field needed for a heading
+#define ATTITUDE_GRAVITY 9.81f
+#define ATTITUDE_SERIES_MAX_HALF_ANGLE 0.18f // rad, series remainder under float epsilon, 4100 deg/s at 200 Hz
+#define ATTITUDE_RENORM_PERIOD 16       // quaternion updates between renormalizations
+
+/**
+ * Quantities derived from q_current that the attitude code and the flight EKF share, rebuilt by
+ * attitude_update_frame() every time q_current changes so no stage forms the rotation matrix itself
+ */
+typedef struct {
+    float32_t dcm[3][3];            // R(q_current), takes body vectors to flat ones
+    float32_t dcm_t[3][3];          // its transpose, what the flight EKF rotates body velocities with
+    float32_t gravity_body[3];      // m/s^2, -ATTITUDE_GRAVITY times the first column of dcm, added to the accelerometer by update_ekf()
+} AttitudeFrame;
+
 typedef struct { 
     /*Assumes q_current is knownf rom ground calibration*/
     float32_t q_current_s; 
@@ -35,9 +53,19 @@ typedef struct {
 
     float32_t time_step;
 
-    float32_t phi;
+    float32_t phi;              // only current after quat_to_euler_angs()
     float32_t theta;
     float32_t psi;
+    uint8_t euler_stale;        // q_current changed since phi, theta and psi were computed
+
+    uint8_t renorm_count;       // quaternion updates since the last renormalization
+
+    float32_t mag_ref[3];       // Gauss, calibrated pad field in the flat frame
+    float32_t mag_ref_norm;
+    uint8_t mag_ref_valid;
+    float32_t mag_heading_error; // rad, sine of the last heading error, 0 if the reading was not used
+
+    AttitudeFrame frame;
 } RocketAttitude;
 
 void initialize_rocket_attitude(RocketAttitude *rocket_atd, float32_t qs, float32_t qx, float32_t qy, float32_t qz);
@@ -45,7 +73,10 @@ void set_gyro(RocketAttitude *rocket_atd, float32_t* readings);
 void gyro_to_rotation_quat(RocketAttitude *rocket_atd);
 void quat_update(RocketAttitude *rocket_atd);
 void quat_to_euler_angs(RocketAttitude *rocket_atd);
+void attitude_update_frame(RocketAttitude *rocket_atd);
 void run_attitude_estimation(RocketAttitude *rocket_atd, float32_t* w);
+void attitude_mag_reference(RocketAttitude *rocket_atd, const float32_t *mag);
+uint8_t attitude_mag_correction(RocketAttitude *rocket_atd, const float32_t *mag);
 
 
 #endif
\ No newline at end of file
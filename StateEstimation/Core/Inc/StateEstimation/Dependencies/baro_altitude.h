@@ -0,0 +1,25 @@
+/**
+ * @file baro_altitude.h
+ * @brief Pressure to altitude conversion without pow()
+ *
+ * @details Evaluates the ISA troposphere formula the estimator has always
+ *          used, h = 44330 (1 - (p / 101325)^0.1903), from a table of cubic
+ *          segments: an index, a subtraction and three multiply-adds per
+ *          conversion. The segments are the Hermite interpolants of the
+ *          formula on 2.5 kPa steps from BARO_ALT_MIN_PA to BARO_ALT_MAX_PA,
+ *          about 11.8 km down to -700 m, and stay within BARO_ALT_MAX_ERROR
+ *          of it there. Outside that range the end segments are extrapolated
+ *          and the bound no longer holds.
+ */
+#ifndef __BARO_ALTITUDE_H__
+#define __BARO_ALTITUDE_H__
+
+#include "arm_math.h"
+
+#define BARO_ALT_MIN_PA 20000.0f
+#define BARO_ALT_MAX_PA 110000.0f
+#define BARO_ALT_MAX_ERROR 0.015f   // m, checked by baro_altitude_test.c
+
+float32_t baro_altitude(float32_t pressure, float32_t *slope);
+
+#endif /* __BARO_ALTITUDE_H__ */
@@ -0,0 +1,58 @@
+/**
+ * @file bias_calibration.h
+ * @brief Streaming accelerometer and gyro bias calibration on the pad
+ *
+ * @details Replaces the ground EKF. Every channel keeps a Welford running mean
+ *          and variance, so each sample costs O(1) and no matrices are
+ *          involved. Every BIAS_CAL_BLOCK samples the block mean is closed
+ *          and compared with the previous one, which accumulates the Allan
+ *          variance at that averaging time. For white noise B * AVAR(B)
+ *          equals the sample variance. Correlated noise or drift makes it
+ *          larger, so the larger of the two is used for the uncertainty of
+ *          the mean. A ratio far above one means the vehicle was moved, and
+ *          calibration starts over.
+ */
+#ifndef __BIAS_CALIBRATION_H__
+#define __BIAS_CALIBRATION_H__
+
+#include "arm_math.h"
+#include "sensors.h"
+#include <stdint.h>
+
+#define BIAS_CAL_CHANNELS 6         // accel x, y, z, gyro x, y, z
+
+#define BIAS_CAL_BLOCK 32           // samples per Allan checkpoint
+#define BIAS_CAL_MIN_BLOCKS 3       // at least two block differences before converging
+#define BIAS_CAL_Z 3.0f             // confidence bound in standard errors
+#define BIAS_CAL_ACCEL_BOUND 0.01f  // m/s^2, bound on the accelerometer bias error
+#define BIAS_CAL_GYRO_BOUND 0.0005f // rad/s, bound on the gyro bias error
+#define BIAS_CAL_MAX_ALLAN_RATIO 16.0f
+
+// One ADIS16500 LSB squared over 12, keeps quantized constant readings from
+// looking noise free
+#define BIAS_CAL_ACCEL_VAR_FLOOR (0.01225f * 0.01225f / 12.0f)
+#define BIAS_CAL_GYRO_VAR_FLOOR (0.0017453f * 0.0017453f / 12.0f)
+
+typedef struct {
+    uint32_t n;
+    float32_t mean[BIAS_CAL_CHANNELS];
+    float32_t m2[BIAS_CAL_CHANNELS];
+
+    uint32_t block_n;
+    uint32_t blocks;
+    float32_t block_sum[BIAS_CAL_CHANNELS];
+    float32_t prev_block_mean[BIAS_CAL_CHANNELS];
+    float32_t allan_sum[BIAS_CAL_CHANNELS];     // sum of squared block mean differences
+
+    float32_t mean_var[BIAS_CAL_CHANNELS];      // variance of each mean, updated per block
+    uint32_t restarts;
+    uint8_t converged;
+} BiasCalibrator;
+
+void bias_calibrator_init(BiasCalibrator *cal);
+uint8_t bias_calibrator_update(BiasCalibrator *cal, const Sensors *sensors);
+void bias_calibrator_biases(const BiasCalibrator *cal, float32_t *bias);
+void bias_calibrator_apply(const BiasCalibrator *cal, Sensors *sensors);
+uint8_t bias_calibrator_agrees(const BiasCalibrator *cal, const float32_t *bias, const float32_t *mean_var);
+
+#endif /* __BIAS_CALIBRATION_H__ */
@@ -12,11 +12,22 @@
 #define DATA_HANDLING_H
 
 #include "sensors.h"
+#include "dma_mem.h"
 #include "stm32h7xx_hal.h"
 #include "arm_math.h"
+#include "ekf_health.h"
+#include "vibration_monitor.h"
+#include "event_detector.h"
 #include <string.h>
 #include <stdio.h>
 
+#define EVENT_LINE_PORT GPIOE
+#define EVENT_LINE_PIN GPIO_PIN_10  // PE10 to the MainMCU, high from a flight event until its frame is out
+#define EVENT_LINE_MS 10            // shortest pulse on the line
+#define EVENT_FRAME_SYNC 0xE5       // a state frame starts with the sensors start byte, 0
+#define EVENT_FRAME_BYTES 16
+#define LINK_GAP_US 200             // line idle between frames, so the MainMCU gets each one from its own idle event
+
 // Data packet to send to Main MCU
 typedef struct {
   uint8_t state; // current state machine state
@@ -40,6 +51,10 @@ typedef struct {
   float32_t P_5;
   float32_t P_6;
   float32_t t;
+  EkfHealth health; // flight EKF, sent as nis_avg, cov_trace, accepted, rejected, flags
+  VibrationRecord vibration; // accelerometer and gyro spectra on alternate frames
+  uint16_t sensor_faults; // fault_detector_mask(), a FaultClass per sensor channel
+  uint8_t gnss_r_scale; // noise_adapt_r_scale(), largest GNSS noise over nominal in 1/8 steps
 } SerialData;
 
 
@@ -49,6 +64,10 @@ typedef struct {
 
 void log_data(SerialData* serial_data, Sensors* sensors, UART_HandleTypeDef* huart);
 
+void signal_event(const FlightEvent* event);
+
+void event_link_poll(UART_HandleTypeDef* huart);
+
 void update_biases(Sensors* sensors);
 
 #endif
\ No newline at end of file
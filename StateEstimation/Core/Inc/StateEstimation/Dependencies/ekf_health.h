@@ -0,0 +1,44 @@
+/**
+ * @file ekf_health.h
+ * @brief Innovation gating and health monitor for the flight EKF
+ *
+ * @details The normalized innovation squared, NIS = y' S^-1 y, reuses the
+ *          inverse innovation covariance that the Kalman gain already needs.
+ *          For a consistent filter it is chi-square distributed with as many
+ *          degrees of freedom as the measurement, so an update past the gate
+ *          is treated as an outlier (GNSS multipath, a bad fix) and skipped.
+ *          The health checks look at the state and the diagonal of P and its
+ *          2x2 blocks only, O(n) per step instead of scanning whole matrices.
+ */
+#ifndef __EKF_HEALTH_H__
+#define __EKF_HEALTH_H__
+
+#include "arm_math.h"
+#include <stdint.h>
+
+#define EKF_NIS_AVG_WEIGHT 0.0625f      // rolling NIS average over about 16 updates
+#define EKF_MAX_CONSECUTIVE_REJECTS 50  // then accept, the filter rather than the sensor may be off
+
+// Latched in EkfHealth.flags until ekf_health_init()
+#define EKF_HEALTH_NON_FINITE 0x01      // NaN or Inf in x or the diagonal of P
+#define EKF_HEALTH_NOT_POS_DEF 0x02     // a variance or 2x2 minor of P is not positive
+#define EKF_HEALTH_S_SINGULAR 0x04      // innovation covariance could not be inverted
+#define EKF_HEALTH_GATE_FORCED 0x08     // accepted after EKF_MAX_CONSECUTIVE_REJECTS rejections
+
+typedef struct {
+    float32_t nis;              // last update
+    float32_t nis_avg;          // exponential average over accepted and rejected updates
+    float32_t cov_trace;        // trace of P after the last step
+    uint16_t accepted;          // updates applied, saturating
+    uint16_t rejected;          // updates outside the gate, saturating
+    uint8_t consecutive_rejects;
+    uint8_t flags;              // EKF_HEALTH_* bits
+} EkfHealth;
+
+void ekf_health_init(EkfHealth *health);
+float32_t ekf_chi2_gate(uint16_t dof);
+float32_t ekf_nis(const float32_t *innovation, const float32_t *S_inv, uint16_t nz);
+uint8_t ekf_health_gate(EkfHealth *health, float32_t nis, float32_t gate);
+void ekf_health_check(EkfHealth *health, const float32_t *x, const float32_t *P, uint16_t nx);
+
+#endif /* __EKF_HEALTH_H__ */
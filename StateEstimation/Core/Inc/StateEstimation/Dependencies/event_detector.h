@@ -0,0 +1,135 @@
+/**
+ * @file event_detector.h
+ * @brief Launch, burnout and apogee detection on the raw IMU and barometer samples
+ *
+ * @details The state machine runs at the IMU pipeline output rate and learns
+ *          of a phase change one filtered, decimated block late. This
+ *          detector looks at the raw samples instead: update_sensors() hands
+ *          it every block at the ADIS16500 rate, before the anti-alias filter,
+ *          and every new pressure reading as an altitude.
+ *
+ *          The axial specific force is the long axis accelerometer channel,
+ *          through a one-pole low-pass at EVENT_ACCEL_CUTOFF. Until launch its
+ *          pad value is tracked slowly, which gives the sign of the axis and
+ *          the 1 g it reads at rest. The jerk is its difference over
+ *          EVENT_JERK_SPAN samples.
+ *
+ *          LAUNCH   armed, the force EVENT_LAUNCH_ACCEL above the pad value
+ *                   for EVENT_LAUNCH_SAMPLES samples. The time is taken back
+ *                   to where the jerk first went over EVENT_LAUNCH_JERK, the
+ *                   motor lighting, if that was within EVENT_ONSET_WINDOW_US
+ *                   of the threshold crossing.
+ *          BURNOUT  at least EVENT_MIN_BURN_US after launch, the force below
+ *                   EVENT_BURNOUT_ACCEL for EVENT_BURNOUT_SAMPLES samples, or
+ *                   for EVENT_BURNOUT_FAST_SAMPLES when the jerk went below
+ *                   -EVENT_BURNOUT_JERK as it crossed, a sharp cut-off. The
+ *                   time is the crossing.
+ *          APOGEE   an alpha-beta filter on the baro altitude, coasting under
+ *                   gravity once the motor is out, predicts the time to
+ *                   apogee as v / g. The event is raised once that is within
+ *                   EVENT_APOGEE_LEAD_S for EVENT_APOGEE_SAMPLES readings in
+ *                   a row, EVENT_APOGEE_LOCKOUT_US after burnout, or after
+ *                   EVENT_MAX_BURN_US if no burnout was seen, so the pressure
+ *                   spikes through the transonic region are ignored. The time
+ *                   is the predicted apogee, which may lie ahead.
+ *
+ *          Each event is raised once per flight and queued with its time on
+ *          the sensor_time_us() timeline and the time it was detected, for
+ *          event_detector_pop(). The detector does nothing but detect: the
+ *          caller signals the events and moves the state machine.
+ */
+#ifndef __EVENT_DETECTOR_H__
+#define __EVENT_DETECTOR_H__
+
+#include "arm_math.h"
+#include "imu_pipeline.h"
+#include <stdint.h>
+
+#define EVENT_AXIS_CHANNEL 3                // ADIS16500 x accel, the long axis, sensors->accel_x
+#define EVENT_GRAVITY 9.80665f
+#define EVENT_ACCEL_CUTOFF 50.0f            // Hz, one-pole on the axial force
+#define EVENT_PAD_TAU 2.0f                  // s, of the pad value before launch
+#define EVENT_JERK_SPAN 20                  // samples, 10 ms at 2 kHz
+
+#define EVENT_LAUNCH_ACCEL (2.0f * EVENT_GRAVITY)   // m/s^2 above the pad value
+#define EVENT_LAUNCH_SAMPLES 40                     // 20 ms at 2 kHz
+#define EVENT_LAUNCH_JERK 500.0f                    // m/s^3
+#define EVENT_ONSET_WINDOW_US 100000
+
+#define EVENT_MIN_BURN_US 200000
+#define EVENT_MAX_BURN_US 10000000
+#define EVENT_BURNOUT_ACCEL (0.5f * EVENT_GRAVITY)  // m/s^2 axial force, coasting reads the drag only
+#define EVENT_BURNOUT_SAMPLES 100                   // 50 ms at 2 kHz
+#define EVENT_BURNOUT_FAST_SAMPLES 20
+#define EVENT_BURNOUT_JERK 500.0f                   // m/s^3
+
+#define EVENT_BARO_ALPHA 0.1f               // alpha-beta gains per reading
+#define EVENT_BARO_BETA 0.005f
+#define EVENT_APOGEE_LEAD_S 0.1f            // raise this far ahead, covers the filter lag
+#define EVENT_APOGEE_SAMPLES 3
+#define EVENT_APOGEE_LOCKOUT_US 1000000
+#define EVENT_APOGEE_MIN_GAIN 10.0f         // m above the launch altitude
+
+#define EVENT_QUEUE 4
+
+typedef enum {
+    EVENT_NONE,
+    EVENT_LAUNCH,
+    EVENT_BURNOUT,
+    EVENT_APOGEE,
+} FlightEventId;
+
+typedef struct {
+    uint8_t id;                 // FlightEventId
+    uint32_t time_us;           // sensor_time_us() timeline, when it happened
+    uint32_t detect_us;         // when it was detected
+    float32_t value;            // m/s^2 axial force for launch and burnout, m apogee height above the launch
+} FlightEvent;
+
+typedef struct {
+    float32_t dt;               // s, one IMU sample
+    float32_t accel_gain;       // one-pole coefficient at EVENT_ACCEL_CUTOFF
+    float32_t pad_gain;         // one-pole coefficient at EVENT_PAD_TAU
+
+    // IMU, per raw sample
+    float32_t pad;              // m/s^2, axial channel at rest, signed
+    uint8_t pad_valid;
+    float32_t accel;            // m/s^2, filtered axial specific force, positive up
+    float32_t history[EVENT_JERK_SPAN];     // filtered force, oldest at head
+    uint8_t head;
+    uint8_t filled;
+    float32_t jerk;             // m/s^3
+    uint32_t onset_us;          // where the jerk last crossed the threshold
+    uint8_t onset_valid;
+    uint16_t run;               // samples in a row past the threshold
+    uint32_t run_us;            // first of them
+    uint8_t run_fast;           // burnout run started with a sharp drop
+
+    // Barometer, per reading
+    float32_t alt;              // m, alpha-beta altitude
+    float32_t vel;              // m/s, alpha-beta climb rate
+    uint32_t baro_us;
+    uint8_t baro_valid;
+    float32_t launch_alt;       // m, alt at launch
+    uint8_t apogee_run;
+
+    uint8_t armed;
+    uint8_t raised;             // bit per FlightEventId raised
+    uint32_t launch_us;
+    uint32_t burnout_us;
+    uint32_t last_us;           // latest sample seen
+
+    FlightEvent queue[EVENT_QUEUE];
+    uint8_t queue_head;
+    uint8_t queue_count;
+    uint16_t dropped;           // events lost to a full queue
+} EventDetector;
+
+void event_detector_init(EventDetector *det, float32_t sample_rate);
+void event_detector_arm(EventDetector *det, uint8_t armed);
+void event_detector_push(EventDetector *det, const int16_t block[][IMU_PIPELINE_MAX_DECIMATION], uint16_t n,
+                         uint32_t time_us);
+void event_detector_baro(EventDetector *det, float32_t altitude, uint32_t time_us);
+uint8_t event_detector_pop(EventDetector *det, FlightEvent *event);
+
+#endif /* __EVENT_DETECTOR_H__ */
@@ -0,0 +1,131 @@
+/**
+ * @file fault_detector.h
+ * @brief Stuck, saturated and spiking sensor detection with a quantized CMSIS-NN model
+ *
+ * @details Up to now a failing sensor only shows once it produces a NaN. This
+ *          detector keeps the last FAULT_WINDOW + 1 samples of each ADIS16500
+ *          axis at the raw 2 kHz rate, of the MS5607 pressure and of the GNSS
+ *          height, and classifies each channel's window with one small int8
+ *          network shared by all channels:
+ *
+ *          - FAULT_WINDOW first differences in FaultChannelConfig.step units,
+ *            log companded to q7 by FAULT_DIFF_GAIN and sorted. The log keeps
+ *            a 1 step difference of a quiet sensor apart from none at all and
+ *            still fits a vibrating one. Sorting makes a spike, one large pair
+ *            of opposite sign, look the same wherever it falls in the window.
+ *            A stuck sensor has none.
+ *          - FAULT_LEVELS samples of the level, every other one, as q7 of the
+ *            sensor's range. A saturated sensor sits at +-127 with no
+ *            differences. The GNSS height has no range and leaves them 0.
+ *
+ *          Two fully connected layers, arm_fully_connected_q7() with
+ *          arm_relu_q7() between them, turn the FAULT_INPUTS into
+ *          FAULT_CLASSES logits and the largest wins. The weights and shifts
+ *          in fault_model.h are generated by the FaultModel trainer on
+ *          synthetic windows, see its README section.
+ *
+ *          A channel is reported stuck or saturated after FAULT_CONFIRM such
+ *          windows in a row, and spiking once FAULT_SPIKE_FLAG spike windows
+ *          have come without FAULT_SPIKE_DECAY clean ones in between to take
+ *          them back off. Windows overlap by half, so every spike is inside
+ *          one. It goes back to OK after FAULT_CLEAR clean windows in a row.
+ *
+ *          Inference only runs in spare time: state_machine_run() calls
+ *          fault_detector_step() on the main loop passes with no IMU block,
+ *          with a budget in CPU cycles. An inference is only started if the
+ *          longest one measured so far still fits, so the budget is never
+ *          overrun by more than an interrupt taken meanwhile. Windows that
+ *          come due faster than the spare time allows are not queued: the
+ *          next inference of the channel takes its latest window, and the
+ *          samples it skipped are counted.
+ */
+#ifndef __FAULT_DETECTOR_H__
+#define __FAULT_DETECTOR_H__
+
+#include "arm_math.h"
+#include "arm_nnfunctions.h"
+#include "imu_pipeline.h"
+#include <stdint.h>
+
+#define FAULT_WINDOW 16                     // differences per inference, 8 ms of the ADIS16500
+#define FAULT_LEVELS (FAULT_WINDOW / 2)
+#define FAULT_INPUTS (FAULT_WINDOW + FAULT_LEVELS)
+#define FAULT_HIDDEN 16
+#define FAULT_CLASSES 4
+#define FAULT_BUFFER (FAULT_INPUTS > FAULT_HIDDEN ? FAULT_INPUTS : FAULT_HIDDEN)
+#define FAULT_HOP (FAULT_WINDOW / 2)        // new samples between inferences of a channel
+#define FAULT_DIFF_GAIN (127.0f / 8.318f)   // q7 per e-fold of a difference, 127 at 4096 steps
+
+#define FAULT_CONFIRM 4                     // stuck or saturated windows in a row
+#define FAULT_CLEAR 8                       // clean windows in a row to report OK again
+#define FAULT_SPIKE_FLAG 4                  // spike windows, a spike is seen by up to two
+#define FAULT_SPIKE_DECAY 64                // clean windows that take one back off
+
+#define FAULT_PASS_BUDGET 20000             // cycles per spare main loop pass, 89 us at 224 MHz
+#define FAULT_COST_PRIOR 10000              // cycles assumed for an inference before one is measured
+
+typedef enum {
+    FAULT_OK,
+    FAULT_STUCK,
+    FAULT_SATURATED,
+    FAULT_SPIKE,
+} FaultClass;
+
+// Gyro and accel in the ImuPipeline channel order, then the MS5607 and the GNSS
+typedef enum {
+    FAULT_GYRO_X,
+    FAULT_GYRO_Y,
+    FAULT_GYRO_Z,
+    FAULT_ACCEL_X,
+    FAULT_ACCEL_Y,
+    FAULT_ACCEL_Z,
+    FAULT_BARO,
+    FAULT_GNSS,
+    FAULT_CHANNELS
+} FaultChannel;
+
+typedef struct {
+    float32_t step;             // sensor units per count of a difference input
+    float32_t mid;              // middle of the sensor's range
+    float32_t half_range;       // of the range, 0 if it has none and the levels stay 0
+} FaultChannelConfig;
+
+typedef struct {
+    float32_t ring[FAULT_WINDOW + 1];   // latest samples, head is the oldest
+    uint8_t head;
+    uint8_t filled;
+    uint16_t fresh;             // samples since the last inference
+    uint8_t run;                // windows in a row of run_class
+    uint8_t run_class;
+    uint8_t spikes;             // spike windows not yet decayed
+    uint8_t clean;              // clean windows towards the next decay
+    uint8_t state;              // FaultClass reported
+} FaultChannelState;
+
+typedef struct {
+    FaultChannelConfig cfg[FAULT_CHANNELS];
+    FaultChannelState ch[FAULT_CHANNELS];
+    uint32_t (*cycles)(void);   // CPU cycle counter, NULL for no budget
+    uint32_t cost;              // cycles, longest inference measured
+    uint8_t next;               // channel the round robin looks at first
+
+    q7_t input[FAULT_INPUTS];
+    q7_t hidden[FAULT_HIDDEN];
+    q7_t logits[FAULT_CLASSES];
+    q15_t buffer[FAULT_BUFFER]; // arm_fully_connected_q7() scratch, the widest layer input
+
+    uint32_t inferences;
+    uint32_t deferred;          // passes that ran out of budget with windows due
+    uint32_t skipped;           // samples whose differences were never classified
+} FaultDetector;
+
+void fault_detector_default_config(FaultChannelConfig *cfg);
+void fault_detector_init(FaultDetector *det, uint32_t (*cycles)(void));
+void fault_detector_push(FaultDetector *det, uint8_t channel, float32_t value);
+void fault_detector_push_imu(FaultDetector *det, const int16_t block[][IMU_PIPELINE_MAX_DECIMATION], uint16_t n);
+void fault_detector_features(const FaultChannelConfig *cfg, const float32_t *window, q7_t *input);
+uint8_t fault_detector_classify(FaultDetector *det, const q7_t *input);
+uint8_t fault_detector_step(FaultDetector *det, uint32_t budget);
+uint16_t fault_detector_mask(const FaultDetector *det);
+
+#endif /* __FAULT_DETECTOR_H__ */
@@ -0,0 +1,52 @@
+/**
+ * @file fault_model.h
+ * @brief Quantized weights of the sensor fault model, generated by FaultModel
+ *
+ * @details Do not edit, run make -C FaultModel export instead. Trained
+ *          with seed 1 on 100000 synthetic windows for 30 epochs,
+ *          99.8% right on 20000 held out windows after quantization.
+ *          Weights are row major, one row of inputs per output.
+ */
+#ifndef __FAULT_MODEL_H__
+#define __FAULT_MODEL_H__
+
+#define FAULT_MODEL_B1_SHIFT 6
+#define FAULT_MODEL_OUT1_SHIFT 6
+#define FAULT_MODEL_B2_SHIFT 4
+#define FAULT_MODEL_OUT2_SHIFT 8
+
+#define FAULT_MODEL_W1 { \
+    11, 0, 0, -2, -3, -11, 0, 2, -11, -1, -3, -5, -6, -21, -14, 37, -4, -5, 4, 3, -1, 9, 2, 12, \
+    -17, -18, -10, 2, 14, 23, 17, 127, 83, -3, -82, -122, -122, -67, -32, 4, -10, -1, -3, -1, 0, 5, 0, 10, \
+    4, 6, 6, 11, 0, -12, -10, -5, -9, -10, -12, -9, -1, -10, -13, -7, -9, -1, 7, 17, 20, 20, 17, 16, \
+    -4, -1, -1, -4, -8, -4, -1, -68, -36, -9, 4, 10, -5, -3, 4, -3, 4, -1, -6, 6, 1, -4, 3, -6, \
+    -20, -19, -1, -8, -1, 0, 6, 8, 12, 7, -3, -3, 3, -10, -5, 33, -5, -1, -5, -4, -5, 10, 7, 0, \
+    3, 12, 50, 70, 58, 28, -28, -67, -119, -8, -21, -28, 17, 37, 18, 11, -1, -3, -1, 1, -4, 5, 6, -1, \
+    -19, -2, 6, -26, -13, -7, -2, 2, 20, 3, 13, 11, -8, -22, -20, 20, 2, 3, -2, 0, 2, -5, -6, 6, \
+    67, -12, -18, -9, 3, 0, 4, 0, 1, -1, -2, -1, 0, -2, -5, 55, -20, -20, -4, 9, 8, 10, 6, 13, \
+    1, 9, 8, 5, 11, 8, 4, -9, -16, -10, -2, 2, 6, 1, 9, 58, -1, -2, -6, -7, 3, 3, 6, 4, \
+    -7, -4, -12, 5, 10, 1, -1, -14, -4, -9, -8, -4, -10, -3, -9, -15, 17, 4, -9, -27, -24, -12, -22, -15, \
+    -10, 0, -7, -23, -11, 15, 25, 38, 82, 3, -2, 28, -10, -9, -23, 10, -4, -6, -1, 0, 4, 7, 5, -2, \
+    -13, -2, -2, 3, 13, 7, -1, -3, -5, 3, 1, 0, 17, 34, 18, -63, 3, 2, -7, 4, 1, -4, 0, 2, \
+    1, 1, 0, 2, -2, -1, 0, -127, -119, -110, -78, -30, -5, 3, 0, -1, -1, 0, 0, 3, 4, -3, -2, -1, \
+    9, -35, -88, -44, -7, 3, -1, 46, 30, 1, -29, -44, -23, 5, -3, -23, 7, 8, 2, -4, -7, -3, -5, 2, \
+    4, -7, -26, -40, -37, -25, -1, 1, 4, -7, 0, 5, -18, -12, -14, -16, 1, -3, 1, -6, 1, 8, 1, 0, \
+    19, -3, -4, -3, 7, 8, 6, -1, -20, -13, -18, -25, -20, 3, 12, 1, -19, -12, 10, 23, 21, 21, 17, 12, \
+}
+
+#define FAULT_MODEL_B1 { \
+    56, 34, -67, -1, -36, 19, 1, -5, -8, -79, 7, 17, 0, -22, 39, -33, \
+}
+
+#define FAULT_MODEL_W2 { \
+    1, -52, -15, 23, -46, -33, -3, 90, -61, -13, 30, 64, 21, -29, 27, -10, \
+    7, 104, -22, -122, -32, 74, -41, -21, 17, -26, -79, 33, -127, 120, -43, -5, \
+    -60, 12, 94, -41, 48, -28, -11, 31, 23, 121, -54, -10, -100, 57, -69, 70, \
+    11, -34, 3, 4, 34, -16, 20, -125, 30, -10, 14, -79, 17, -32, 2, -19, \
+}
+
+#define FAULT_MODEL_B2 { \
+    31, 20, -104, -28, \
+}
+
+#endif /* __FAULT_MODEL_H__ */
@@ -20,10 +20,30 @@
 #include <stdbool.h>
 #include <stdio.h>
 #include "state_est_helpers.h"
+#include "gnss_origin.h"
+#include "ekf_health.h"
+#include "baro_altitude.h"
+#include "noise_adapt.h"
 
-#define MAX_EKF_DIM 6
+#define MAX_FLIGHT_DIM 7
 #define MAX_FLIGHT_MEAS 3
 
+// The barometer measures x + b, with b the bias of the last state
+#define FLIGHT_BARO_BIAS 6
+
+// Baro noise model: sensor and port noise, plus a static port error that
+// grows with dynamic pressure and dominates near Mach 1
+#define BARO_NOISE_PA 3.0f              // 1 sigma, MS5607 at the highest OSR plus turbulence
+#define BARO_STATIC_COEF 0.02f          // pressure error as a fraction of the dynamic pressure
+#define BARO_AIR_DENSITY 1.0f           // kg/m^3, ISA density about 1.4 km up, the launch site
+#define BARO_REF_WEIGHT 0.0625f         // pad reference averaged over about 16 readings
+#define GPS_MAX_AGE 1.0f                // s, an older or time stamped fix is fused as it is
+
+// GNSS measurements run_ekf() fuses, ExtKalmanFilter.gps_fuse
+#define FLIGHT_GPS_POSITION 0x01
+#define FLIGHT_GPS_VELOCITY 0x02
+#define GPS_VEL_MIN_SIGMA 0.05f         // m/s, floor under the receiver's speed accuracy
+
 
 typedef struct {
     uint16_t nx, nu, nz;
@@ -33,23 +53,23 @@ typedef struct {
     arm_matrix_instance_f32 x_prev, x_n, x_next, P_prev, P_n, P_next, f, h, z;
     arm_matrix_instance_f32 temp1, temp2;
 
-    float32_t dfdx_data[MAX_EKF_DIM * MAX_EKF_DIM];
-    //float32_t G_data[MAX_EKF_DIM * MAX_EKF_DIM];
-    float32_t Q_data[MAX_EKF_DIM * MAX_EKF_DIM];
+    float32_t dfdx_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    //float32_t G_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t Q_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
     float32_t R_data[MAX_FLIGHT_MEAS * MAX_FLIGHT_MEAS];
-    float32_t dhdx_data[MAX_FLIGHT_MEAS * MAX_EKF_DIM];
-    float32_t K_n_data[MAX_EKF_DIM * MAX_FLIGHT_MEAS];
-    //float32_t x_prev_data[MAX_EKF_DIM];
-    float32_t x_n_data[MAX_EKF_DIM];
-    //float32_t x_next_data[MAX_EKF_DIM];
-    //float32_t P_prev_data[MAX_EKF_DIM * MAX_EKF_DIM];
-    float32_t P_n_data[MAX_EKF_DIM * MAX_EKF_DIM];
-    //float32_t P_next_data[MAX_EKF_DIM * MAX_EKF_DIM];
-    float32_t f_data[MAX_EKF_DIM];
+    float32_t dhdx_data[MAX_FLIGHT_MEAS * MAX_FLIGHT_DIM];
+    float32_t K_n_data[MAX_FLIGHT_DIM * MAX_FLIGHT_MEAS];
+    //float32_t x_prev_data[MAX_FLIGHT_DIM];
+    float32_t x_n_data[MAX_FLIGHT_DIM];
+    //float32_t x_next_data[MAX_FLIGHT_DIM];
+    //float32_t P_prev_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t P_n_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    //float32_t P_next_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t f_data[MAX_FLIGHT_DIM];
     float32_t h_data[MAX_FLIGHT_MEAS];
     float32_t z_data[MAX_FLIGHT_MEAS];
-    float32_t temp1_data[MAX_EKF_DIM * MAX_EKF_DIM];
-    float32_t temp2_data[MAX_EKF_DIM * MAX_EKF_DIM];
+    float32_t temp1_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t temp2_data[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
 
     float32_t c[3];
 
@@ -61,12 +81,37 @@ typedef struct {
     float32_t magneto[3];
     float32_t gps_flat[3];
     float32_t launch_gps[3];
+    GnssOrigin gnss_origin;
+    float32_t gps_enu[3];       // last valid fix, east north up about gnss_origin
+    uint32_t gps_time_us;       // local time that fix is valid for, GpsFix.time_us
+    uint8_t gps_timed;          // gps_time_us is known
+    float32_t gps_age;          // s, the GNSS measurement was moved forward by this, 0 if not at all
+    uint8_t gps_pos_valid;      // gps_flat holds a fix that was not fused yet
+    uint8_t gps_fuse;           // FLIGHT_GPS_* bits, both by default
+    float32_t gps_vel[3];       // m/s, [up, north, -east] like gps_flat, last velocity from a fix
+    float32_t gps_vel_var;      // (m/s)^2, noise variance of each axis, from the speed accuracy
+    float32_t gps_vel_age;      // s, from the solution to the state, 0 if not known
+    uint8_t gps_vel_valid;      // gps_vel holds a velocity that was not fused yet
     float32_t launch_accel[3]; 
     float32_t launch_gyro[3];
-    float32_t barometer;
+    float32_t barometer;        // m above baro_ref, last reading
+    float32_t baro_var;         // m^2, noise variance of the last reading
+    float32_t baro_slope;       // m/Pa, dh/dp at the last reading
+    float32_t baro_ref;         // m, ISA altitude of the pad
+    uint8_t baro_ref_valid;
+    uint8_t baro_valid;         // barometer holds a reading that was not fused yet
+
+    float32_t nis_gate;         // largest GNSS NIS accepted, ekf_chi2_gate(nz) by default
+    EkfHealth health;
+    float32_t baro_gate;        // largest baro NIS accepted, ekf_chi2_gate(1) by default
+    EkfHealth baro_health;      // gating of the baro updates; x and P are checked in health
+    float32_t vel_gate;         // largest NIS of one velocity axis accepted, ekf_chi2_gate(1) by default
+    EkfHealth vel_health;       // gating of the GNSS velocity updates, one per axis
+    NoiseAdapter noise;         // R of the GNSS position update and Q, in Q_data and R_data
 } ExtKalmanFilter;
 
 void GPS2Flat(Sensors *sensors, ExtKalmanFilter *ekf, uint8_t ground);
+void Baro2Flat(Sensors *sensors, ExtKalmanFilter *ekf, uint8_t ground);
 void initialize_ekf(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart, Sensors *sensors, uint16_t nz);
 void print_matrix(const char* name, arm_matrix_instance_f32* mat, UART_HandleTypeDef *huart);
 void observation_function(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart);
@@ -84,5 +129,7 @@ void run_ekf(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors *sensors,
 void update_ekf(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors* sensors);
 void predict_step(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, UART_HandleTypeDef *huart);
 void update_step(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart);
+void baro_update_step(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart);
+void gps_velocity_update_step(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, UART_HandleTypeDef *huart);
 
 #endif
\ No newline at end of file
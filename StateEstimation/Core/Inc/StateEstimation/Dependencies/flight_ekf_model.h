@@ -0,0 +1,27 @@
+/**
+ * @file flight_ekf_model.h
+ * @brief Unrolled kernels of the flight EKF model, generated by EkfGen
+ *
+ * @details Do not edit, run make -C EkfGen export instead. Flight EKF, x = [x,
+ *          vx, y, vy, z, vz, baro bias] with the velocities in the body frame,
+ *          measured by the GNSS position. Matrices are row major, covariances
+ *          are read from their upper triangle and written whole.
+ */
+#ifndef __FLIGHT_EKF_MODEL_H__
+#define __FLIGHT_EKF_MODEL_H__
+
+#include "arm_math.h"
+
+#define FLIGHT_EKF_MODEL_NX 7
+#define FLIGHT_EKF_MODEL_NZ 3
+
+void flight_ekf_model_f(const float32_t *x, const float32_t (*dcm_t)[3], const float32_t *accel, float32_t dt, float32_t *f);
+void flight_ekf_model_F(const float32_t (*dcm_t)[3], const float32_t *accel, float32_t dt, float32_t *F);
+void flight_ekf_model_predict_covariance(const float32_t *F, const float32_t *Q, const float32_t *P, float32_t *P_out);
+void flight_ekf_model_h(const float32_t *x, float32_t *h);
+void flight_ekf_model_H(float32_t *H);
+arm_status flight_ekf_model_gain(const float32_t *P, const float32_t *R, float32_t *K, float32_t *S_inv);
+void flight_ekf_model_update_state(const float32_t *x, const float32_t *K, const float32_t *innovation, float32_t *x_out);
+void flight_ekf_model_update_covariance(const float32_t *P, const float32_t *K, const float32_t *R, float32_t *P_out);
+
+#endif /* __FLIGHT_EKF_MODEL_H__ */
@@ -47,7 +47,7 @@ float32_t P_init_ground[6*6] = {
 };
 float32_t x_init_ground[6] = {0.0};
 float32_t f_f32_ground[6] = {0.0};
-float32_t h_f32_ground[3] = {0.0};
+float32_t h_f32_ground[6] = {0.0};
 
 float32_t Q_f32_ground[6 * 6] = {
     0.01, 0,   0,   0,   0,   0,
@@ -70,21 +70,8 @@ float32_t P_f[6*6] = {
 };
 float32_t G_f32[3*3] = {0.0};   
 
-float32_t HPHtR_f32_ground[6 * 6];
+// S^-1 of the last update, left by kalman_gain_ground()
 float32_t HPHtRi_f32_ground[6 * 6];
-
-float32_t PHt_f32_ground[6 * 6];
-float32_t HP_f32_ground[6 * 6];
-float32_t Ht_f32_ground[6 * 6];
-
-float32_t HPHt_f32_ground[6 * 6];
-
-arm_matrix_instance_f32 HP_ground;
-arm_matrix_instance_f32 Ht_ground;
-arm_matrix_instance_f32 HPHt_ground;
-arm_matrix_instance_f32 HPHtR_ground;
 arm_matrix_instance_f32 HPHtRi_ground;
-arm_matrix_instance_f32 PHt_ground;
-arm_matrix_instance_f32 K_new_ground;
 
 #endif
\ No newline at end of file
@@ -0,0 +1,68 @@
+/**
+ * @file gnss_origin.h
+ * @brief Cached local tangent frame for converting GNSS fixes to ENU
+ *
+ * @details The origin is fixed once at arming, so the trigonometry of its
+ *          latitude and longitude, its ECEF position and the ECEF to ENU
+ *          rotation are computed once in double and cached. Offsets from the
+ *          origin are formed in the receiver's integer units, which is exact,
+ *          and only the small offset is converted to float. A fix then costs
+ *          a handful of float multiply-adds:
+ *
+ *          - HPPOSECEF: integer ECEF offset rotated by the cached matrix.
+ *          - HPPVT/PVT: second-order series of the geodetic to ENU map about
+ *            the origin. The truncation error grows as d^3 / R^2, about 2e-5 m
+ *            at 1 km and 0.03 m at 10 km from the origin.
+ */
+#ifndef __GNSS_ORIGIN_H__
+#define __GNSS_ORIGIN_H__
+
+#include "arm_math.h"
+#include "gps.h"
+#include "sensors.h"
+#include <stdint.h>
+
+#define GNSS_WGS84_A 6378137.0
+#define GNSS_WGS84_E2 6.69437999014e-3
+
+#define GNSS_PI 3.14159265358979323846           // PI from arm_math.h is only float
+#define GNSS_DEG_E9_TO_RAD (GNSS_PI / 180.0 * 1e-9) // 1e-9 deg to rad
+#define GNSS_E4_TO_M 1e-4                           // 0.1 mm to m
+
+#define GNSS_FIX_TYPE_3D 3                          // fixType of a 3D fix
+#define GNSS_FIX_TYPE_GNSS_DR 4                     // fixType of GNSS plus dead reckoning
+#define GNSS_FLAGS_FIX_OK 0x01                      // gnssFixOK in the PVT flags
+
+typedef struct {
+    // Origin in the receiver's integer units
+    int64_t lat;                // 1e-9 deg
+    int64_t lon;                // 1e-9 deg
+    int64_t height;             // 0.1 mm
+    int64_t ecef[3];            // 0.1 mm
+
+    // Rows are the east, north and up unit vectors in ECEF
+    float32_t rot[3][3];
+
+    // Second-order geodetic series about the origin, see gnss_origin_set()
+    float32_t e_lam;            // (N + h) cos(lat)
+    float32_t e_lam_phi;        // -(M + h) sin(lat)
+    float32_t e_lam_h;          // cos(lat)
+    float32_t n_phi;            // M + h
+    float32_t n_phi_phi;        // dM/dlat / 2
+    float32_t n_lam_lam;        // (N + h) cos(lat) sin(lat) / 2
+    float32_t u_phi_phi;        // -(M + h) / 2
+    float32_t u_lam_lam;        // -(N + h) cos(lat)^2 / 2
+
+    uint8_t valid;
+} GnssOrigin;
+
+void gnss_fix_from_hppvt(GpsFix *fix, const struct ublox_gnss_nav_hppvt *hppvt);
+void gnss_fix_from_pvt(GpsFix *fix, const struct ublox_gnss_nav_pvt *pvt);
+void gnss_fix_from_velned(GpsFix *fix, const struct ublox_gnss_nav_velned *velned);
+void gnss_fix_from_degrees(GpsFix *fix, double lat, double lon, double height);
+
+uint8_t gnss_origin_set(GnssOrigin *origin, const GpsFix *fix);
+void gnss_origin_fix_to_enu(const GnssOrigin *origin, const GpsFix *fix, float32_t enu[3]);
+void gnss_origin_hpposecef_to_enu(const GnssOrigin *origin, const struct ublox_gnss_nav_hpposecef *ecef, float32_t enu[3]);
+
+#endif /* __GNSS_ORIGIN_H__ */
@@ -0,0 +1,27 @@
+/**
+ * @file ground_ekf_model.h
+ * @brief Unrolled kernels of the ground EKF model, generated by EkfGen
+ *
+ * @details Do not edit, run make -C EkfGen export instead. Ground EKF, x = [x,
+ *          vx, y, vy, z, vz] held between updates and measured directly.
+ *          Matrices are row major, covariances are read from their upper
+ *          triangle and written whole.
+ */
+#ifndef __GROUND_EKF_MODEL_H__
+#define __GROUND_EKF_MODEL_H__
+
+#include "arm_math.h"
+
+#define GROUND_EKF_MODEL_NX 6
+#define GROUND_EKF_MODEL_NZ 6
+
+void ground_ekf_model_f(const float32_t *x, float32_t *f);
+void ground_ekf_model_F(float32_t *F);
+void ground_ekf_model_predict_covariance(const float32_t *F, const float32_t *Q, const float32_t *P, float32_t *P_out);
+void ground_ekf_model_h(const float32_t *x, float32_t *h);
+void ground_ekf_model_H(float32_t *H);
+arm_status ground_ekf_model_gain(const float32_t *P, const float32_t *R, float32_t *K, float32_t *S_inv);
+void ground_ekf_model_update_state(const float32_t *x, const float32_t *K, const float32_t *innovation, float32_t *x_out);
+void ground_ekf_model_update_covariance(const float32_t *P, const float32_t *K, const float32_t *R, float32_t *P_out);
+
+#endif /* __GROUND_EKF_MODEL_H__ */
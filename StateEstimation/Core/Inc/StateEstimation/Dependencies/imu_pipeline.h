@@ -0,0 +1,133 @@
+/**
+ * @file imu_pipeline.h
+ * @brief ADIS16500 acquisition at the full output rate, anti-alias filtering and decimation to the estimator rate
+ *
+ * @details The ADIS16500 data ready interrupt pushes every burst read into a
+ *          block of IMU_PIPELINE_DECIMATION samples with imu_pipeline_push().
+ *          Once a block is complete the main loop collects it with
+ *          imu_pipeline_process(), which runs each of the six channels
+ *          through the low-pass filter and integrates the filtered samples
+ *          into one angular rate and one specific force for the estimator:
+ *
+ *            rotation   phi = beta + 1/2 sum beta_{i-1} x alpha_i
+ *            velocity   dv  = upsilon + sum (beta_{i-1} + alpha_i / 2) x nu_i - beta x upsilon
+ *
+ *          where alpha_i and nu_i are the increments of sample i, beta and
+ *          upsilon their running sums, and dv is in the body frame at the end
+ *          of the block. The cross products are the coning and sculling
+ *          corrections that averaging the rates alone would miss when the
+ *          vehicle vibrates about two axes at once. The outputs are phi and
+ *          dv over the block length, in the units update_sensors() stores.
+ *
+ *          The integration is itself a moving average with nulls at
+ *          multiples of the output rate, the filter in front of it takes out
+ *          what lies between them, such as motor vibration folding down onto
+ *          a few Hz. IMU_FILTER_BIQUAD is a Butterworth low-pass of order
+ *          2 x IMU_PIPELINE_BIQUAD_STAGES, a few ms of delay at the default
+ *          cutoff. IMU_FILTER_FIR is a Hamming windowed sinc, linear phase
+ *          with (taps - 1) / 2 samples of delay, only worth it when the
+ *          estimator can wait for it. Both are designed for unity gain at
+ *          0 Hz, exactly so after rounding to q1.15.
+ *
+ *          IMU_FILTER_BACKEND picks where the filter runs:
+ *
+ *          IMU_FILTER_BACKEND_CMSIS  the CMSIS-DSP biquad and FIR in float.
+ *          IMU_FILTER_BACKEND_FMAC   the STM32H7 FMAC on the raw 16-bit
+ *                                    counts in q1.15, one channel and biquad
+ *                                    section at a time with its history
+ *                                    preloaded, saturating instead of
+ *                                    wrapping. The coefficients stay in the
+ *                                    unit from imu_pipeline_init() on. The
+ *                                    output keeps the resolution of the ADIS
+ *                                    output registers.
+ *
+ *          The target build defaults to the FMAC, builds without STM32H723xx,
+ *          such as the host library, to CMSIS-DSP. Define IMU_FILTER_BACKEND
+ *          on the compiler command line to override either.
+ *
+ *          A block completed before the previous one was collected is dropped
+ *          and counted in overruns, the filter then restarts from the history
+ *          it had.
+ */
+#ifndef __IMU_PIPELINE_H__
+#define __IMU_PIPELINE_H__
+
+#include "arm_math.h"
+#include <stdint.h>
+
+#define IMU_FILTER_BACKEND_CMSIS 0
+#define IMU_FILTER_BACKEND_FMAC 1
+
+#ifndef IMU_FILTER_BACKEND
+#if defined(STM32H723xx)
+#define IMU_FILTER_BACKEND IMU_FILTER_BACKEND_FMAC
+#else
+#define IMU_FILTER_BACKEND IMU_FILTER_BACKEND_CMSIS
+#endif
+#endif
+
+#define IMU_PIPELINE_CHANNELS 6             // x, y, z gyro then x, y, z accel, as in the burst
+#define IMU_PIPELINE_SAMPLE_RATE 2000.0f    // Hz, ADIS16500 with DEC_RATE = 0
+#define IMU_PIPELINE_DECIMATION 10          // 200 Hz to the estimator
+#define IMU_PIPELINE_CUTOFF 80.0f           // Hz
+#define IMU_PIPELINE_FIR_TAPS 32
+#define IMU_PIPELINE_MAX_DECIMATION 16
+#define IMU_PIPELINE_MAX_FIR_TAPS 64
+#define IMU_PIPELINE_BIQUAD_STAGES 2
+#define IMU_PIPELINE_GYRO_LSB (0.1f * PI / 180.0f)  // rad/s, as adis_gyro_scale()
+#define IMU_PIPELINE_ACCEL_LSB 0.01225f             // as adis_accel_scale()
+
+typedef enum {
+    IMU_FILTER_NONE,
+    IMU_FILTER_BIQUAD,
+    IMU_FILTER_FIR
+} ImuFilterType;
+
+typedef struct {
+    ImuFilterType filter;
+    float32_t sample_rate;  // Hz
+    float32_t cutoff;       // Hz, -3 dB for the biquads, -6 dB for the FIR
+    uint16_t decimation;    // samples per output, up to IMU_PIPELINE_MAX_DECIMATION
+    uint16_t fir_taps;      // up to IMU_PIPELINE_MAX_FIR_TAPS
+} ImuPipelineConfig;
+
+typedef struct {
+    ImuPipelineConfig cfg;
+    float32_t dt;           // s, one input sample
+
+    // Written by imu_pipeline_push(), channel major
+    int16_t block[2][IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION];
+    volatile uint16_t fill;         // samples in block[write]
+    volatile uint8_t write;
+    volatile uint8_t ready;         // block[write ^ 1] is complete and not collected
+    uint32_t block_time[2];         // us, caller's time stamp of the last sample of each block
+
+#if IMU_FILTER_BACKEND == IMU_FILTER_BACKEND_FMAC
+    int16_t biquad_q15[IMU_PIPELINE_BIQUAD_STAGES][5];  // b0, b1, b2, a1, a2 over 2
+    int16_t fir_q15[IMU_PIPELINE_MAX_FIR_TAPS];
+    int16_t biquad_history[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_BIQUAD_STAGES + 1][2];  // input, then each section's output, oldest first
+    int16_t fir_history[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_FIR_TAPS - 1];
+#else
+    float32_t biquad_coeffs[5 * IMU_PIPELINE_BIQUAD_STAGES];  // b0, b1, b2, a1, a2 per section, CMSIS signs
+    float32_t fir_coeffs[IMU_PIPELINE_MAX_FIR_TAPS];
+    arm_biquad_cascade_df2T_instance_f32 biquad[IMU_PIPELINE_CHANNELS];
+    float32_t biquad_state[IMU_PIPELINE_CHANNELS][2 * IMU_PIPELINE_BIQUAD_STAGES];
+    arm_fir_instance_f32 fir[IMU_PIPELINE_CHANNELS];
+    float32_t fir_state[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_FIR_TAPS + IMU_PIPELINE_MAX_DECIMATION - 1];
+#endif
+
+    // Latest output
+    float32_t gyro[3];      // rad/s, ADIS axes
+    float32_t accel[3];     // ADIS axes, as adis_accel_scale()
+    uint32_t time_us;       // block_time of the block they came from
+    uint32_t samples;       // pushed
+    uint32_t outputs;       // collected
+    uint32_t overruns;      // blocks dropped
+} ImuPipeline;
+
+void imu_pipeline_default_config(ImuPipelineConfig *cfg);
+uint8_t imu_pipeline_init(ImuPipeline *pipe, const ImuPipelineConfig *cfg);
+void imu_pipeline_push(ImuPipeline *pipe, const int16_t *sample, uint32_t time_us);
+uint8_t imu_pipeline_process(ImuPipeline *pipe);
+
+#endif /* __IMU_PIPELINE_H__ */
@@ -0,0 +1,68 @@
+/**
+ * @file magnetometer.h
+ * @brief Online LIS3MDL hard and soft iron calibration and heading aiding
+ *
+ * @details The pad readings are fitted with an axis-aligned ellipsoid
+ *
+ *            (x - cx)^2 + b (y - cy)^2 + c (z - cz)^2 = G
+ *
+ *          written as the linear least squares problem
+ *
+ *            x^2 = -b y^2 - c z^2 + d x + e y + f z + g
+ *
+ *          so a reading only adds to a 6 x 6 normal matrix and the cost and
+ *          memory stay constant however long the vehicle waits on the pad.
+ *          The centre is the hard iron offset and the radii give one scale
+ *          per axis that maps the ellipsoid onto a sphere. Cross-axis soft
+ *          iron is not modelled, the handling a vehicle sees before launch
+ *          does not cover enough of the sphere to resolve it.
+ *
+ *          A fit is only taken once every axis has swung through
+ *          MAG_CAL_MIN_SPAN of its radius, as it does while the vehicle is
+ *          loaded and the rail raised. Until then the readings are used as
+ *          they are: the heading reference is measured through the same
+ *          offset on the pad, so the error only grows with the turn away
+ *          from the pad attitude.
+ *
+ *          mag_heading_reference() and mag_heading_correction() pass the
+ *          calibrated field of each new reading to the complementary heading
+ *          correction in attitude.c.
+ */
+#ifndef __MAGNETOMETER_H__
+#define __MAGNETOMETER_H__
+
+#include "arm_math.h"
+#include "sensors.h"
+#include "attitude.h"
+#include <stdint.h>
+
+#define MAG_CAL_PARAMS 6            // b, c, d, e, f, g
+#define MAG_CAL_SOLVE_INTERVAL 64   // readings between fits
+#define MAG_CAL_MIN_SAMPLES 256
+#define MAG_CAL_MIN_SPAN 1.0f       // range of the readings on each axis, in radii of that axis
+#define MAG_CAL_MAX_RESIDUAL 0.05f  // RMS of the fit relative to G, about 2.5% of the radius
+#define MAG_CAL_MAX_AXIS_RATIO 1.5f // largest over smallest radius
+
+typedef struct {
+    uint32_t n;
+    double ata[MAG_CAL_PARAMS][MAG_CAL_PARAMS];    // sum of phi phi', upper triangle
+    double atb[MAG_CAL_PARAMS];                    // sum of phi x^2
+    double btb;                                    // sum of x^4, for the residual
+    float32_t min[3];
+    float32_t max[3];
+
+    float32_t offset[3];        // Gauss, hard iron of the last accepted fit
+    float32_t scale[3];         // soft iron of the last accepted fit
+    float32_t radius;           // Gauss, field strength after calibration
+    float32_t residual;         // of the last fit, accepted or not
+    uint8_t converged;
+} MagCalibrator;
+
+void mag_calibrator_init(MagCalibrator *cal);
+uint8_t mag_calibrator_update(MagCalibrator *cal, const Sensors *sensors);
+void mag_calibrator_apply(const MagCalibrator *cal, Sensors *sensors);
+void mag_calibrated(const Sensors *sensors, float32_t *mag);
+void mag_heading_reference(RocketAttitude *rocket_atd, const Sensors *sensors);
+void mag_heading_correction(RocketAttitude *rocket_atd, const Sensors *sensors);
+
+#endif /* __MAGNETOMETER_H__ */
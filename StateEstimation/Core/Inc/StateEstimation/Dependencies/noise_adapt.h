@@ -0,0 +1,62 @@
+/**
+ * @file noise_adapt.h
+ * @brief Innovation based noise adaptation for the flight EKF
+ *
+ * @details The GNSS noise R is estimated per axis by covariance matching.
+ *          For a consistent filter E[y^2] = (H P H')_ii + R_ii, so the mean of
+ *          y^2 - (H P H')_ii over the last NOISE_ADAPT_WINDOW fixes estimates
+ *          R_ii. Each estimate is clamped to NOISE_ADAPT_R_MIN to
+ *          NOISE_ADAPT_R_MAX times the nominal value and R follows it with
+ *          the forgetting factor NOISE_ADAPT_FORGET. Only innovations that pass
+ *          the gate are used, not those it is forced to take, so outliers do
+ *          not inflate R. run_ekf() fuses each fix once, so the window holds
+ *          independent samples, and a measurement passed in again is not
+ *          sampled twice. The cost is O(NOISE_ADAPT_WINDOW * nz) per fix and
+ *          nothing otherwise.
+ *
+ *          Q is not estimated. Its diagonal is the nominal one scaled by a
+ *          table per flight phase, written when the phase changes.
+ */
+#ifndef __NOISE_ADAPT_H__
+#define __NOISE_ADAPT_H__
+
+#include "arm_math.h"
+#include <stdint.h>
+
+#define NOISE_ADAPT_MAX_DIM 7
+#define NOISE_ADAPT_MAX_MEAS 3
+#define NOISE_ADAPT_WINDOW 16           // fixes, 1.6 s at 10 Hz
+#define NOISE_ADAPT_MIN_SAMPLES 8       // before R is first moved
+#define NOISE_ADAPT_FORGET 0.125f       // weight of each new window estimate
+#define NOISE_ADAPT_R_MIN 0.25f         // bounds of R over its nominal value
+#define NOISE_ADAPT_R_MAX 16.0f
+#define NOISE_ADAPT_SCALE_LSB 8.0f      // steps per unit of noise_adapt_r_scale()
+
+typedef enum {
+    NOISE_PHASE_PAD,
+    NOISE_PHASE_BOOST,
+    NOISE_PHASE_COAST,
+    NOISE_PHASE_DESCENT,
+    NOISE_PHASES
+} NoisePhase;
+
+typedef struct {
+    float32_t q_nominal[NOISE_ADAPT_MAX_DIM];   // diagonal of Q as initialized
+    float32_t r_nominal[NOISE_ADAPT_MAX_MEAS];  // diagonal of R as initialized
+    float32_t r[NOISE_ADAPT_MAX_MEAS];          // adapted diagonal of R
+    float32_t samples[NOISE_ADAPT_WINDOW][NOISE_ADAPT_MAX_MEAS];    // y^2 - (H P H')_ii
+    float32_t last_z[NOISE_ADAPT_MAX_MEAS];     // measurement of the last sample
+    uint16_t nx, nz;
+    uint8_t head;
+    uint8_t count;
+    uint8_t phase;              // NoisePhase Q is scaled for
+    uint8_t enabled;            // adapt R, on by default; Q follows the phase either way
+} NoiseAdapter;
+
+void noise_adapt_init(NoiseAdapter *na, const float32_t *Q, uint16_t nx, const float32_t *R, uint16_t nz);
+void noise_adapt_phase(NoiseAdapter *na, uint8_t phase, const float32_t (*scale)[NOISE_ADAPT_MAX_DIM], float32_t *Q);
+uint8_t noise_adapt_update(NoiseAdapter *na, const float32_t *z, const float32_t *innovation, const float32_t *hph,
+                           float32_t *R);
+uint8_t noise_adapt_r_scale(const NoiseAdapter *na);
+
+#endif /* __NOISE_ADAPT_H__ */
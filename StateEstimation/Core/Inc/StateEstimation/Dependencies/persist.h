@@ -0,0 +1,147 @@
+/**
+ * @file persist.h
+ * @brief Calibration kept in flash and estimator snapshots kept in backup SRAM across resets
+ *
+ * @details CalibrationRecord holds what the pad produces: the IMU biases, the
+ *          magnetometer calibration and the GNSS origin of the pad. The
+ *          records are appended to the last flash sector, one
+ *          PERSIST_CAL_RECORD_SIZE slot each, and only when the sector is
+ *          full is it erased, so the 1 to 2 s sector erase that stalls the
+ *          single flash bank happens once in PERSIST_CAL_SLOTS saves and
+ *          never in flight. The newest record whose magic, version, size and
+ *          CRC-32 all check out is the one loaded, a record cut short by a
+ *          reset while programming fails the CRC and the one before it is
+ *          used instead.
+ *
+ *          WarmStartRecord holds the flight EKF state and covariance, the
+ *          attitude, the state machine phase and the times it runs on. It is
+ *          written to one of two slots in the 4 KB backup SRAM in turn, so a
+ *          reset while writing leaves the previous snapshot intact. Backup
+ *          SRAM keeps its contents through a brown-out, watchdog or pin
+ *          reset, not through a power cycle unless VBAT is fitted, and
+ *          persist_init() discards the snapshots after a power-on reset
+ *          either way so that a new flight never resumes an old one.
+ *
+ *          PERSIST_BACKEND picks the storage:
+ *
+ *          PERSIST_BACKEND_STM32  flash sector 3 at 0x08060000, left out of
+ *                                 the FLASH region of the linker script, and
+ *                                 backup SRAM at 0x38800000. The reset cause
+ *                                 comes from RCC->RSR.
+ *          PERSIST_BACKEND_RAM    static arrays with the same erase and
+ *                                 program rules. Every persist_init() is a
+ *                                 power-on reset of a new board that wipes
+ *                                 both, unless persist_host_reset() asked for
+ *                                 a warm reset first.
+ *
+ *          The target build defaults to PERSIST_BACKEND_STM32, builds without
+ *          STM32H723xx, such as the host library, to PERSIST_BACKEND_RAM.
+ *          Define PERSIST_BACKEND on the compiler command line to override
+ *          either.
+ */
+#ifndef __PERSIST_H__
+#define __PERSIST_H__
+
+#include "arm_math.h"
+#include "gnss_origin.h"
+#include <stdint.h>
+
+#define PERSIST_BACKEND_STM32 0
+#define PERSIST_BACKEND_RAM 1
+
+#ifndef PERSIST_BACKEND
+#if defined(STM32H723xx)
+#define PERSIST_BACKEND PERSIST_BACKEND_STM32
+#else
+#define PERSIST_BACKEND PERSIST_BACKEND_RAM
+#endif
+#endif
+
+#define PERSIST_CAL_MAGIC 0x4C414347u         // "GCAL"
+#define PERSIST_CAL_VERSION 2
+#define PERSIST_CAL_RECORD_SIZE 128           // four 256-bit flash words
+#define PERSIST_CAL_SECTOR_SIZE 0x20000u      // 128 KB, sector 3 of the STM32H723VE
+#define PERSIST_CAL_SLOTS (PERSIST_CAL_SECTOR_SIZE / PERSIST_CAL_RECORD_SIZE)
+
+#define PERSIST_WARM_MAGIC 0x4D524157u        // "WARM"
+#define PERSIST_WARM_VERSION 2
+#define PERSIST_WARM_DIM 7                    // MAX_FLIGHT_DIM, checked in persist.c
+#define PERSIST_WARM_SLOTS 2
+#define PERSIST_WARM_PERIOD 20                // estimator cycles between snapshots, 10 Hz at 200 Hz
+
+#define PERSIST_CAL_BIASES 0x01               // CalibrationRecord.flags
+#define PERSIST_CAL_MAG 0x02
+#define PERSIST_CAL_ORIGIN 0x04
+
+// PERSIST_CAL_RECORD_SIZE bytes, the CRC covers all that comes before it
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                  // sizeof(CalibrationRecord)
+    uint32_t sequence;              // one more than the record before it
+    uint32_t flags;                 // PERSIST_CAL_ bits of the parts that are valid
+
+    float32_t accel_bias[3];        // as Sensors.accel_bias_*, pad gravity removed
+    float32_t gyro_bias[3];         // rad/s
+    float32_t bias_var[6];          // variance of each bias, BiasCalibrator.mean_var
+    float32_t mag_offset[3];        // Gauss, hard iron
+    float32_t mag_scale[3];         // soft iron
+
+    int64_t origin_lat;             // 1e-9 deg, GnssOrigin of the pad
+    int64_t origin_lon;             // 1e-9 deg
+    int64_t origin_height;          // 0.1 mm
+
+    uint8_t reserved[12];
+    uint32_t crc;
+} CalibrationRecord;
+
+// Everything needed to carry on the flight EKF and attitude after a reset
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t size;                  // sizeof(WarmStartRecord)
+    uint32_t sequence;
+
+    uint16_t state;                 // RocketState at the snapshot
+    uint8_t launched;               // the launch time stamp was taken
+    uint8_t first_iter;
+    uint16_t nx;
+    uint16_t nz;
+    uint32_t since_launch;          // ms from the launch to the snapshot
+    float32_t since_fast_ascent;    // s from the start of fast ascent to the snapshot
+
+    float32_t x[PERSIST_WARM_DIM];
+    float32_t P[PERSIST_WARM_DIM * PERSIST_WARM_DIM];
+    float32_t launch_gps[3];
+    GnssOrigin gnss_origin;
+    float32_t baro_ref;
+    uint8_t baro_ref_valid;
+
+    uint8_t mag_ref_valid;
+    float32_t q[4];                 // s, x, y, z
+    float32_t mag_ref[3];
+    float32_t mag_ref_norm;
+
+    float32_t accel_bias[3];
+    float32_t gyro_bias[3];
+    float32_t mag_offset[3];
+    float32_t mag_scale[3];
+
+    uint32_t crc;
+} WarmStartRecord;
+
+uint32_t persist_crc32(const void *data, uint32_t size);
+uint8_t persist_init(void);
+
+uint8_t calibration_store_load(CalibrationRecord *record);
+uint8_t calibration_store_save(CalibrationRecord *record);
+
+uint8_t warm_start_load(WarmStartRecord *record);
+void warm_start_save(WarmStartRecord *record);
+void warm_start_clear(void);
+
+#if PERSIST_BACKEND == PERSIST_BACKEND_RAM
+void persist_host_reset(uint8_t warm);
+#endif
+
+#endif /* __PERSIST_H__ */
@@ -0,0 +1,65 @@
+/**
+ * @file time_sync.h
+ * @brief Mapping between the local microsecond timeline and GPS time, disciplined by the receiver's time pulse
+ *
+ * @details Every sensor sample is stamped on one local timeline, a free
+ *          running microsecond counter. The receiver's time pulse marks each
+ *          whole GPS second on it: the edge is captured by a timer in
+ *          hardware and handed to time_sync_pps(), and the next navigation
+ *          solution to arrive, whose time of week is known, tells which
+ *          second it was. The edge is matched to the whole second nearest its
+ *          time of week plus the time from the solution's arrival back to the
+ *          edge plus TIME_SYNC_LATENCY_MS, which holds as long as the
+ *          solutions arrive within half a second of that latency.
+ *
+ *          The mapping runs through the last edge matched. Its slope, the rate
+ *          error of the local clock, is averaged over the edges with weight
+ *          TIME_SYNC_DRIFT_GAIN, so a 1 us capture resolution becomes a
+ *          fraction of a ppm and a second of extrapolation stays within a
+ *          microsecond or so. An edge that lands more than
+ *          TIME_SYNC_MAX_RESIDUAL_US from where the mapping puts it is
+ *          dropped, and TIME_SYNC_MAX_REJECTS of them in a row, or no edge for
+ *          TIME_SYNC_HOLDOVER_MS, start the mapping over.
+ *
+ *          Times of week are kept in ms and wrap at the end of the week,
+ *          local times wrap at 2^32 us, about 71 minutes. Only differences
+ *          are ever taken, so neither wrap matters over a flight.
+ */
+#ifndef __TIME_SYNC_H__
+#define __TIME_SYNC_H__
+
+#include "arm_math.h"
+#include <stdint.h>
+
+#define TIME_SYNC_WEEK_MS 604800000u
+#define TIME_SYNC_LATENCY_MS 50             // typical solution latency, used only to match edges
+#define TIME_SYNC_LOCK_EDGES 3              // matched edges before the mapping is used
+#define TIME_SYNC_DRIFT_GAIN 0.25f
+#define TIME_SYNC_MAX_DRIFT 200e-6f         // beyond any crystal, the edge is taken as false
+#define TIME_SYNC_MAX_RESIDUAL_US 100
+#define TIME_SYNC_MAX_REJECTS 3
+#define TIME_SYNC_HOLDOVER_MS 10000         // after this long without an edge the mapping is dropped
+
+typedef struct {
+    uint32_t ref_local;         // us, last edge matched
+    uint32_t ref_tow;           // ms, its GPS time of week, a whole second
+    float32_t drift;            // local clock rate error, (local - GPS) / GPS
+    uint8_t edges;              // matched in a row, up to TIME_SYNC_LOCK_EDGES
+    uint8_t rejects;            // dropped in a row
+
+    uint32_t pps_local;         // us, edge captured and not yet matched
+    uint8_t pps_pending;
+
+    float32_t residual;         // us, of the last edge against the mapping
+    uint32_t matched;
+    uint32_t rejected;
+} TimeSync;
+
+void time_sync_init(TimeSync *ts);
+void time_sync_pps(TimeSync *ts, uint32_t local_us);
+void time_sync_solution(TimeSync *ts, uint32_t tow_ms, uint32_t arrival_us);
+uint8_t time_sync_locked(const TimeSync *ts);
+uint8_t time_sync_to_local(const TimeSync *ts, uint32_t tow_ms, uint32_t *local_us);
+uint8_t time_sync_to_tow(const TimeSync *ts, uint32_t local_us, uint32_t *tow_ms);
+
+#endif /* __TIME_SYNC_H__ */
@@ -0,0 +1,73 @@
+/**
+ * @file trig.h
+ * @brief Trigonometry for the estimator with a build time choice of backend
+ *
+ * @details TRIG_BACKEND picks how the functions below are evaluated:
+ *
+ *          TRIG_BACKEND_LIBM    double precision libm, rounded to float. The
+ *                               reference the others are checked against.
+ *          TRIG_BACKEND_POLY    range reduction and minimax polynomials in
+ *                               float, no libm and no tables. Worst case on
+ *                               the ranges below: sine and cosine within
+ *                               TRIG_POLY_SINCOS_MAX_ERROR, atan2 and asin
+ *                               within TRIG_POLY_ATAN_MAX_ERROR.
+ *          TRIG_BACKEND_CORDIC  the STM32H7 CORDIC coprocessor in q1.31 with
+ *                               TRIG_CORDIC_CYCLES x 4 iterations, about
+ *                               2^-19 of full scale: sine and cosine within
+ *                               TRIG_CORDIC_SINCOS_MAX_ERROR, phases within
+ *                               TRIG_CORDIC_ATAN_MAX_ERROR rad. Each result
+ *                               takes six CORDIC clock cycles plus the bus
+ *                               transfers, with no libm call.
+ *
+ *          The bounds hold for sine and cosine of |angle| up to 1000 rad and
+ *          for any finite atan2 arguments. trig_test.c checks the POLY
+ *          bounds against double libm. The CORDIC ones are twice the 2^-19
+ *          the reference manual gives for the configured precision, times pi
+ *          for phases, and can only be checked on the target.
+ *
+ *          The target build defaults to the CORDIC, builds without
+ *          STM32H723xx, such as the host library, to the polynomials. Define
+ *          TRIG_BACKEND on the compiler command line to override either.
+ *
+ *          The _batch functions configure the unit once and stream the
+ *          arguments in zero-overhead mode, where reading a result stalls the
+ *          bus until it is ready. HAL_CORDIC_Calculate_DMA() runs the same
+ *          configuration from interleaved q1.31 buffers, worth it only for
+ *          arrays much longer than the few angles the estimator needs a cycle.
+ */
+#ifndef __TRIG_H__
+#define __TRIG_H__
+
+#include "arm_math.h"
+#include <stdint.h>
+
+#define TRIG_BACKEND_LIBM 0
+#define TRIG_BACKEND_POLY 1
+#define TRIG_BACKEND_CORDIC 2
+
+#ifndef TRIG_BACKEND
+#if defined(STM32H723xx)
+#define TRIG_BACKEND TRIG_BACKEND_CORDIC
+#else
+#define TRIG_BACKEND TRIG_BACKEND_POLY
+#endif
+#endif
+
+#define TRIG_POLY_SINCOS_MAX_ERROR 2e-7f    // absolute, |angle| <= 1000 rad
+#define TRIG_POLY_ATAN_MAX_ERROR 4e-7f      // rad
+#define TRIG_CORDIC_CYCLES 6                // PRECISION field, 24 iterations
+#define TRIG_CORDIC_SINCOS_MAX_ERROR 4e-6f  // absolute
+#define TRIG_CORDIC_ATAN_MAX_ERROR 1.2e-5f  // rad
+
+void trig_init(void);
+void trig_sincos(float32_t angle, float32_t *s, float32_t *c);
+float32_t trig_atan2(float32_t y, float32_t x);
+float32_t trig_asin(float32_t x);
+void trig_sincos_batch(const float32_t *angle, float32_t *s, float32_t *c, uint32_t n);
+void trig_atan2_batch(const float32_t *y, const float32_t *x, float32_t *angle, uint32_t n);
+
+// Always built, so trig_test.c can check them whatever the backend
+void trig_poly_sincos(float32_t angle, float32_t *s, float32_t *c);
+float32_t trig_poly_atan2(float32_t y, float32_t x);
+
+#endif /* __TRIG_H__ */
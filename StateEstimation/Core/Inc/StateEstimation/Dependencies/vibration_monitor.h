@@ -0,0 +1,94 @@
+/**
+ * @file vibration_monitor.h
+ * @brief Welch spectra of the raw ADIS16500 samples, summarised for the state frame
+ *
+ * @details update_sensors() hands every IMU pipeline block to
+ *          vibration_monitor_push() before it is filtered, so the spectra show
+ *          what the anti-alias filter is up against. Every VIBRATION_HOP
+ *          samples the last VIBRATION_FFT_SIZE of each channel are copied out
+ *          as one segment, 50% overlap. vibration_monitor_step() then removes
+ *          the mean, applies a Hann window and runs arm_rfft_fast_f32() on one
+ *          channel per call, summing |X|^2 into an accelerometer and a gyro
+ *          spectrum over the three axes. After VIBRATION_SEGMENTS segments
+ *          the averaged spectra are reduced to VibrationRecord: the mean
+ *          square in each of the VIBRATION_BANDS bands and the
+ *          VIBRATION_PEAKS largest local maxima, their frequency interpolated
+ *          between bins for the Hann window and their mean square summed over
+ *          the main lobe.
+ *
+ *          The work is split so that no call takes longer than one FFT of one
+ *          channel. state_machine_run() makes the call only on a main loop pass
+ *          with no IMU block waiting, the time it would otherwise spend
+ *          polling, so the estimator never waits for more than one step. A
+ *          segment due while the previous one is still being transformed is
+ *          dropped and counted.
+ *
+ *          Powers are in dB re 1 (m/s^2)^2 for the accelerometer and re 1
+ *          (rad/s)^2 for the gyro, in the units update_sensors() stores. The
+ *          FFT tables are only built for VIBRATION_FFT_SIZE, see the
+ *          ARM_TABLE_ defines in the Makefiles.
+ */
+#ifndef __VIBRATION_MONITOR_H__
+#define __VIBRATION_MONITOR_H__
+
+#include "arm_math.h"
+#include "imu_pipeline.h"
+#include <stdint.h>
+
+#define VIBRATION_FFT_SIZE 256              // 128 ms at 2 kHz, 7.8 Hz bins
+#define VIBRATION_BINS (VIBRATION_FFT_SIZE / 2 + 1)
+#define VIBRATION_HOP (VIBRATION_FFT_SIZE / 2)
+#define VIBRATION_SEGMENTS 8                // per spectrum, 0.58 s at 2 kHz
+#define VIBRATION_PEAKS 3
+#define VIBRATION_BANDS 4                   // edges in vibration_monitor.c
+#define VIBRATION_FREQ_STEP 4.0f            // Hz per count of VibrationRecord.peak_freq
+#define VIBRATION_DB_NONE INT8_MIN          // no peak, or no spectrum yet
+
+typedef enum {
+    VIBRATION_ACCEL,
+    VIBRATION_GYRO,
+    VIBRATION_SOURCES
+} VibrationSource;
+
+// 12 bytes, sent as is at the end of the state frame, one source per frame
+typedef struct {
+    uint8_t source;                         // VibrationSource in bit 0, spectra completed in bits 1-7
+    uint8_t segments;                       // averaged, 0 before the first spectrum
+    int8_t band_db[VIBRATION_BANDS];        // mean square in each band
+    uint8_t peak_freq[VIBRATION_PEAKS];     // VIBRATION_FREQ_STEP Hz, largest peak first
+    int8_t peak_db[VIBRATION_PEAKS];        // mean square of each peak
+} VibrationRecord;
+
+typedef struct {
+    arm_rfft_fast_instance_f32 fft;
+    float32_t sample_rate;      // Hz
+    float32_t window[VIBRATION_FFT_SIZE];
+    float32_t window_power;     // sum of the squared window
+
+    // Last VIBRATION_FFT_SIZE raw counts of each channel, head is the oldest
+    int16_t history[IMU_PIPELINE_CHANNELS][VIBRATION_FFT_SIZE];
+    uint16_t head;
+    uint16_t filled;            // up to VIBRATION_FFT_SIZE
+    uint16_t since_segment;     // samples since the last segment was taken
+
+    int16_t segment[IMU_PIPELINE_CHANNELS][VIBRATION_FFT_SIZE];  // oldest first
+    uint8_t busy;               // segment is being transformed
+    uint8_t channel;            // next channel of segment to transform
+    uint8_t finish;             // spectra are complete and not yet reduced
+    uint8_t segments;           // summed into power
+    float32_t buffer[VIBRATION_FFT_SIZE];
+    float32_t spectrum[VIBRATION_FFT_SIZE];
+    float32_t power[VIBRATION_SOURCES][VIBRATION_BINS];  // sum of |X|^2 in physical units
+
+    VibrationRecord record[VIBRATION_SOURCES];
+    uint8_t next_source;        // record vibration_monitor_next_record() returns next
+    uint32_t spectra;           // completed
+    uint32_t dropped;           // segments skipped while busy
+} VibrationMonitor;
+
+void vibration_monitor_init(VibrationMonitor *mon, float32_t sample_rate);
+void vibration_monitor_push(VibrationMonitor *mon, const int16_t block[][IMU_PIPELINE_MAX_DECIMATION], uint16_t n);
+uint8_t vibration_monitor_step(VibrationMonitor *mon);
+void vibration_monitor_next_record(VibrationMonitor *mon, VibrationRecord *record);
+
+#endif /* __VIBRATION_MONITOR_H__ */
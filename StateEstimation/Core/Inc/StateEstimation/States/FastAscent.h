@@ -18,6 +18,7 @@
 
 #include "flight_ekf.h"
 #include "attitude.h"
+#include "magnetometer.h"
 #include "stm32h7xx_hal.h"
 
 void run_fast_ascent(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors *sensors, SerialData *serial_data, UART_HandleTypeDef *huart);
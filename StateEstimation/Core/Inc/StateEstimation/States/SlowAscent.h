@@ -19,6 +19,7 @@
 
 #include "flight_ekf.h"
 #include "attitude.h"
+#include "magnetometer.h"
 #include "data_handling.h"
 
 
@@ -47,6 +47,8 @@ extern "C" {
 extern SerialData serial_data;
 extern Sensors sensors;
 extern GroundExtKalmanFilter gekf;
+extern BiasCalibrator bias_cal;
+extern MagCalibrator mag_cal;
 extern ExtKalmanFilter fekf;
 extern RocketAttitude rocket_atd;
 extern uint8_t signal_received[2];
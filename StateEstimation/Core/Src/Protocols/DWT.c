@@ -58,6 +58,16 @@ uint32_t DWT_GetMicros(void) {
     return DWT->CYCCNT / cpu_freq_mhz;
 }
 
+/**
+ * @brief Gets the raw cycle count
+ * @return DWT cycle counter, wraps every 2^32 cycles
+ * @details For measuring short stretches of code, the difference of two
+ *          readings is right across a wrap.
+ */
+uint32_t DWT_GetCycles(void) {
+    return DWT->CYCCNT;
+}
+
 /**
  * @brief Converts DWT ticks to seconds
  * @param ticks Number of DWT cycle counter ticks to convert
@@ -0,0 +1,145 @@
+/**
+ * @file dma_mem.c
+ * @brief Cache, MPU and DMA buffer management
+ * @author Kanav Chugh
+ *
+ * @details The Cortex-M7 caches are enabled for all code and data. RAM_D2 is
+ *          configured by the MPU as normal, shareable, non-cacheable memory and
+ *          every buffer touched by a DMA stream lives there, either through the
+ *          DMA_BUFFER attribute or through dma_alloc(). Buffers that cannot be
+ *          moved out of cacheable memory must be cleaned before a transmit and
+ *          invalidated after a receive with dma_clean() / dma_invalidate().
+ *          The backup SRAM is non-cacheable too, so a warm start snapshot is
+ *          in the SRAM itself and not in a dirty cache line when a reset comes.
+ *
+ * @note .data and .bss are linked into DTCM, which is never cached and is not
+ *       reachable by DMA1/DMA2, so DMA buffers must not be ordinary globals.
+ */
+
+#include "dma_mem.h"
+
+/**
+ * @brief Backing storage for dma_alloc, placed in the non-cacheable region
+ */
+DMA_BUFFER static uint8_t dma_pool[DMA_POOL_SIZE];
+
+/**
+ * @brief Offset of the next free byte in dma_pool
+ */
+static size_t dma_pool_head = 0;
+
+/**
+ * @brief Returns non-zero if the range lies inside the non-cacheable region
+ */
+static int dma_is_noncacheable(const void *addr, size_t size) {
+    uint32_t start = (uint32_t)addr;
+    return start >= DMA_NONCACHEABLE_BASE &&
+           start + size <= DMA_NONCACHEABLE_BASE + DMA_NONCACHEABLE_SIZE;
+}
+
+/**
+ * @brief Configures the MPU so RAM_D2 and the backup SRAM bypass the data cache
+ * @details Region 0 covers the whole 32 KB of RAM_D2 as normal memory with
+ *          TEX=1, C=0, B=0 (non-cacheable) and shareable. Region 1 covers the
+ *          4 KB backup SRAM the same way, not shareable as no DMA reaches it.
+ *          The default memory map stays active for privileged accesses
+ *          everywhere else.
+ * @note Must be called before cache_init() and before any DMA is started
+ */
+void MPU_Config(void) {
+    MPU_Region_InitTypeDef MPU_InitStruct = {0};
+
+    HAL_MPU_Disable();
+
+    MPU_InitStruct.Enable = MPU_REGION_ENABLE;
+    MPU_InitStruct.Number = MPU_REGION_NUMBER0;
+    MPU_InitStruct.BaseAddress = DMA_NONCACHEABLE_BASE;
+    MPU_InitStruct.Size = MPU_REGION_SIZE_32KB;
+    MPU_InitStruct.SubRegionDisable = 0x00;
+    MPU_InitStruct.TypeExtField = MPU_TEX_LEVEL1;
+    MPU_InitStruct.AccessPermission = MPU_REGION_FULL_ACCESS;
+    MPU_InitStruct.DisableExec = MPU_INSTRUCTION_ACCESS_DISABLE;
+    MPU_InitStruct.IsShareable = MPU_ACCESS_SHAREABLE;
+    MPU_InitStruct.IsCacheable = MPU_ACCESS_NOT_CACHEABLE;
+    MPU_InitStruct.IsBufferable = MPU_ACCESS_NOT_BUFFERABLE;
+    HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+    MPU_InitStruct.Number = MPU_REGION_NUMBER1;
+    MPU_InitStruct.BaseAddress = D3_BKPSRAM_BASE;
+    MPU_InitStruct.Size = MPU_REGION_SIZE_4KB;
+    MPU_InitStruct.IsShareable = MPU_ACCESS_NOT_SHAREABLE;
+    HAL_MPU_ConfigRegion(&MPU_InitStruct);
+
+    HAL_MPU_Enable(MPU_PRIVILEGED_DEFAULT);
+}
+
+/**
+ * @brief Enables the instruction and data caches
+ * @details Also enables the D2 SRAM clocks so the DMA region is accessible
+ */
+void cache_init(void) {
+    __HAL_RCC_D2SRAM1_CLK_ENABLE();
+    __HAL_RCC_D2SRAM2_CLK_ENABLE();
+
+    SCB_EnableICache();
+    SCB_EnableDCache();
+}
+
+/**
+ * @brief Allocates a DMA-safe buffer from the non-cacheable pool
+ * @param size Number of bytes requested
+ * @return Pointer aligned to DMA_ALIGNMENT, or NULL if the pool is exhausted
+ * @note Allocations are permanent; call only during initialization
+ */
+void *dma_alloc(size_t size) {
+    size_t rounded = (size + DMA_ALIGNMENT - 1U) & ~(size_t)(DMA_ALIGNMENT - 1U);
+
+    if (size == 0 || rounded > DMA_POOL_SIZE - dma_pool_head) {
+        return NULL;
+    }
+
+    void *buffer = &dma_pool[dma_pool_head];
+    dma_pool_head += rounded;
+    return buffer;
+}
+
+/**
+ * @brief Returns the number of bytes still available to dma_alloc
+ */
+size_t dma_pool_free(void) {
+    return DMA_POOL_SIZE - dma_pool_head;
+}
+
+/**
+ * @brief Writes dirty cache lines covering a buffer back to memory
+ * @param addr Start of the buffer about to be read by DMA
+ * @param size Length of the buffer in bytes
+ * @details No-op for buffers in the non-cacheable region or when the data
+ *          cache is disabled, so it is safe to call before every transmit.
+ */
+void dma_clean(const void *addr, size_t size) {
+    if (size == 0 || dma_is_noncacheable(addr, size) || !(SCB->CCR & SCB_CCR_DC_Msk)) {
+        return;
+    }
+
+    uint32_t start = (uint32_t)addr & ~(DMA_ALIGNMENT - 1U);
+    uint32_t end = ((uint32_t)addr + size + DMA_ALIGNMENT - 1U) & ~(DMA_ALIGNMENT - 1U);
+    SCB_CleanDCache_by_Addr((uint32_t *)start, (int32_t)(end - start));
+}
+
+/**
+ * @brief Discards cache lines covering a buffer so the CPU sees DMA data
+ * @param addr Start of the buffer just written by DMA
+ * @param size Length of the buffer in bytes
+ * @warning Cacheable receive buffers must be DMA_ALIGNMENT aligned and padded,
+ *          otherwise neighbouring data sharing a cache line is discarded too.
+ */
+void dma_invalidate(void *addr, size_t size) {
+    if (size == 0 || dma_is_noncacheable(addr, size) || !(SCB->CCR & SCB_CCR_DC_Msk)) {
+        return;
+    }
+
+    uint32_t start = (uint32_t)addr & ~(DMA_ALIGNMENT - 1U);
+    uint32_t end = ((uint32_t)addr + size + DMA_ALIGNMENT - 1U) & ~(DMA_ALIGNMENT - 1U);
+    SCB_InvalidateDCache_by_Addr((void *)start, (int32_t)(end - start));
+}
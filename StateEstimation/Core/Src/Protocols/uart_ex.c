@@ -12,6 +12,8 @@ void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
     int len;
     
     if (huart->Instance == UART4) {
+        uart4_rx_time_us = sensor_time_us();
+        dma_invalidate(uart4_rx_dma_buffer, Size);
         len = sprintf(debug, "UART Interrupt: Size=%d, Data: ", Size);
         
         for(int i = 0; i < Size && i < 8; i++) {
@@ -89,6 +91,7 @@ void print_rocket_attitude(RocketAttitude *rocket_atd, UART_HandleTypeDef *huart
              rocket_atd->q_current_z);
     HAL_UART_Transmit(huart, (uint8_t*)buf, strlen(buf), HAL_MAX_DELAY);
     
+    quat_to_euler_angs(rocket_atd);
     snprintf(buf, sizeof(buf), "Euler (phi,theta,psi): %.2f, %.2f, %.2f\r\n",
              rocket_atd->phi, 
              rocket_atd->theta,
@@ -120,18 +120,19 @@ float32_t adis_temp_scale(int16_t raw_data) {
  * @param device Pointer to the ADIS IMU device instance
  * @param burst_data Array to store burst data (should be at least 10 words long)
  * @return Checksum verification status (1 if valid, 0 if invalid)
+ * @note The bus runs 16-bit frames: the command goes out in the first frame and
+ *       DIAG_STAT through CHECKSUM come back in the next ten
  */
 uint8_t adis_burst_read(struct ADIS_Device *device, uint16_t *burst_data) {
-    uint8_t buf[20];
+    uint16_t tx[ADIS_BURST_FRAMES] = {ADIS_BURST_CMD};
+    uint16_t rx[ADIS_BURST_FRAMES];
     HAL_GPIO_WritePin((GPIO_TypeDef*)device->cs_pin, (uint16_t)device->cs_pin_port, GPIO_PIN_RESET);
-    uint8_t addr[2] = {0x68, 0x00}; 
-    HAL_SPI_Transmit((SPI_HandleTypeDef*)device->spi_handle, addr, 2, HAL_MAX_DELAY);
-    HAL_SPI_Receive((SPI_HandleTypeDef*)device->spi_handle, buf, 20, HAL_MAX_DELAY);
-    HAL_GPIO_WritePin((GPIO_TypeDef*)device->cs_pin, (uint16_t)device->cs_pin_port, GPIO_PIN_SET);  
+    HAL_SPI_TransmitReceive((SPI_HandleTypeDef*)device->spi_handle, (uint8_t *)tx, (uint8_t *)rx, ADIS_BURST_FRAMES, HAL_MAX_DELAY);
+    HAL_GPIO_WritePin((GPIO_TypeDef*)device->cs_pin, (uint16_t)device->cs_pin_port, GPIO_PIN_SET);
     for(int i = 0; i < 10; i++) {
-        burst_data[i] = (buf[i*2] << 8) | buf[i*2 + 1];
+        burst_data[i] = rx[i + 1];
     }
-    int16_t calc_checksum = 0;
+    uint16_t calc_checksum = 0;
     for(int i = 0; i < 9; i++) {
         calc_checksum += (burst_data[i] & 0xFF);
         calc_checksum += ((burst_data[i] >> 8) & 0xFF);
@@ -1,5 +1,20 @@
 #include "LIS3MDL.h"
 
+/* Byte of a register burst at position index, sent as 16-bit frames high byte first */
+static uint8_t lis3mdl_frame_byte(const uint16_t *frames, uint8_t index) {
+    return index % 2 ? frames[index / 2] & 0xFF : frames[index / 2] >> 8;
+}
+
+/* Shortest sensible poll interval in ms for the configured output data rate */
+static uint32_t lis3mdl_period_ms(struct lis3mdl_device *device) {
+    static const uint16_t do_period_ms[8] = {1600, 800, 400, 200, 100, 50, 25, 12};
+    static const uint8_t fast_period_ms[4] = {1, 1, 3, 6};
+
+    if (device->data_rate & 0b00000010) {
+        return fast_period_ms[(device->data_rate >> 5) & 0x3];
+    }
+    return do_period_ms[(device->data_rate >> 2) & 0x7];
+}
 
 /**
  * @brief initializes LIS3MDL magnetometer
@@ -16,6 +31,11 @@ enum lis3mdl_err lis3mdl_initialize(struct lis3mdl_device *device) {
     lis3mdl_write_register(device, LIS3MDL_REG_CTRL2, ctrl_reg_2);
     uint8_t ctrl_reg_4 = device->z_axis_mode | device->endianness;
     lis3mdl_write_register(device, LIS3MDL_REG_CTRL4, ctrl_reg_4);
+    // Keeps the high and low bytes of an axis from two different conversions
+    lis3mdl_write_register(device, LIS3MDL_REG_CTRL5, LIS3MDL_BLOCK_UPDATE_EN);
+    device->dma_busy = 0;
+    device->dma_done = 0;
+    device->last_sample_ms = HAL_GetTick();
     return LIS3MDL_ERR_OK;
 }
 
@@ -33,8 +53,8 @@ enum lis3mdl_err lis3mdl_read_mag(struct lis3mdl_device *device, double *mag_rea
     double sensitivity = 0;
     lis3mdl_read_multiple_registers(device, LIS3MDL_REG_OUT_X_L, 6, mag_read_buf);
     int16_t x_reading = (mag_read_buf[1] << 8) | mag_read_buf[0]; 
-    int16_t y_reading = (mag_read_buf[3] << 8) | mag_read_buf[1]; 
-    int16_t z_reading = (mag_read_buf[5] << 8) | mag_read_buf[2]; 
+    int16_t y_reading = (mag_read_buf[3] << 8) | mag_read_buf[2]; 
+    int16_t z_reading = (mag_read_buf[5] << 8) | mag_read_buf[4]; 
     lis3mdl_sensitivity_get(device, &sensitivity);
     mag_reading[0] = (double) x_reading / sensitivity;
     mag_reading[1] = (double) y_reading / sensitivity;
@@ -42,6 +62,84 @@ enum lis3mdl_err lis3mdl_read_mag(struct lis3mdl_device *device, double *mag_rea
     return LIS3MDL_ERR_OK;
 }
 
+/**
+ * @brief start a non-blocking read of the magnetic field
+ * This function starts a DMA burst of STATUS and the six output registers if a new sample can be due at the configured
+ * output data rate, and does nothing otherwise. Chip select stays low until lis3mdl_dma_complete().
+ * @param device: Pointer to lis3mdl structure, dma_tx and dma_rx must point to LIS3MDL_DMA_FRAMES frames each
+ * @returns LIS3MDL_ERR_GENERAL if the SPI HAL refused the transfer
+ * @warning The bus is shared with the ADIS16500, do not start a blocking transfer on it while dma_busy is set
+*/
+
+enum lis3mdl_err lis3mdl_start_read_mag_dma(struct lis3mdl_device *device) {
+    uint32_t now = HAL_GetTick();
+    if (device->dma_busy || device->dma_done || now - device->last_sample_ms < lis3mdl_period_ms(device)) {
+        return LIS3MDL_ERR_OK;
+    }
+    device->dma_tx[0] = (uint16_t)((0xC0 | LIS3MDL_REG_STATUS) << 8);
+    for (int i = 1; i < LIS3MDL_DMA_FRAMES; i++) {
+        device->dma_tx[i] = 0x0000;
+    }
+    device->dma_start_ms = now;
+    device->dma_busy = 1;
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_RESET);
+    if (HAL_SPI_TransmitReceive_DMA(device->spi_handle, (uint8_t *)device->dma_tx, (uint8_t *)device->dma_rx,
+                                    LIS3MDL_DMA_FRAMES) != HAL_OK) {
+        lis3mdl_dma_abort(device);
+        return LIS3MDL_ERR_GENERAL;
+    }
+    return LIS3MDL_ERR_OK;
+}
+
+/**
+ * @brief end a DMA burst, call from HAL_SPI_TxRxCpltCallback
+ * @param device: Pointer to lis3mdl structure
+*/
+
+void lis3mdl_dma_complete(struct lis3mdl_device *device) {
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_SET);
+    device->dma_done = 1;
+    device->dma_busy = 0;
+}
+
+/**
+ * @brief drop a DMA burst that failed, call from HAL_SPI_ErrorCallback
+ * @param device: Pointer to lis3mdl structure
+*/
+
+void lis3mdl_dma_abort(struct lis3mdl_device *device) {
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_SET);
+    device->dma_done = 0;
+    device->dma_busy = 0;
+}
+
+/**
+ * @brief collect the field from a finished DMA burst
+ * This function converts the field of the last burst into Gauss if the burst saw a new conversion. A burst that came
+ * back before the next conversion was ready is discarded and the next call to lis3mdl_start_read_mag_dma() retries.
+ * @param device: Pointer to lis3mdl structure
+ * @param mag_reading: pointer to 3-element float array to store magnetic field reading in Gauss
+ * @returns 1 if mag_reading holds a new field, 0 if it was left unchanged
+*/
+
+uint8_t lis3mdl_get_mag_dma(struct lis3mdl_device *device, float *mag_reading) {
+    double sensitivity = 0;
+    if (!device->dma_done) {
+        return 0;
+    }
+    device->dma_done = 0;
+    if (!(lis3mdl_frame_byte(device->dma_rx, 1) & LIS3MDL_STATUS_ZYXDA)) {
+        return 0;
+    }
+    lis3mdl_sensitivity_get(device, &sensitivity);
+    for (int i = 0; i < 3; i++) {
+        int16_t reading = (lis3mdl_frame_byte(device->dma_rx, 3 + 2 * i) << 8) | lis3mdl_frame_byte(device->dma_rx, 2 + 2 * i);
+        mag_reading[i] = (float)(reading / sensitivity);
+    }
+    device->last_sample_ms = device->dma_start_ms;
+    return 1;
+}
+
 /**
  * @brief read temperature from LIS3MDL device
  * This function reads temperature sensor on LIS3MDL device and converts it double precision in degrees C
@@ -115,10 +213,10 @@ enum lis3mdl_err lis3mdl_sensitivity_get(struct lis3mdl_device *device, double *
 */
 
 enum lis3mdl_err lis3mdl_write_register(struct lis3mdl_device *device, uint8_t reg, uint8_t data) {
-    uint8_t transmit_buf[2] = {reg, data};
-    HAL_GPIO_WritePin((GPIO_TypeDef *)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_RESET);
-    HAL_SPI_Transmit((SPI_HandleTypeDef *)device->spi_handle, transmit_buf, 2, HAL_MAX_DELAY);
-    HAL_GPIO_WritePin((GPIO_TypeDef *)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_SET);
+    uint16_t transmit_frame = (uint16_t)((reg << 8) | data);
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(device->spi_handle, (uint8_t *)&transmit_frame, 1, HAL_MAX_DELAY);
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_SET);
     return LIS3MDL_ERR_OK;
 }
 
@@ -131,12 +229,12 @@ enum lis3mdl_err lis3mdl_write_register(struct lis3mdl_device *device, uint8_t r
  * @param data pointer to buffer to store read byte
 */
 enum lis3mdl_err lis3mdl_read_register(struct lis3mdl_device *device, uint8_t reg, uint8_t *data) {
-    uint8_t transmit_buf[2] = {0x80 | reg, 0x00};
-    uint8_t receive_buf[2];
-    HAL_GPIO_WritePin((GPIO_TypeDef*)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_RESET);
-    HAL_SPI_TransmitReceive((SPI_HandleTypeDef *)device->spi_handle, transmit_buf, receive_buf, 2, HAL_MAX_DELAY);
-    HAL_GPIO_WritePin((GPIO_TypeDef *)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_SET);
-    *data = receive_buf[1];
+    uint16_t transmit_frame = (uint16_t)((0x80 | reg) << 8);
+    uint16_t receive_frame;
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_RESET);
+    HAL_SPI_TransmitReceive(device->spi_handle, (uint8_t *)&transmit_frame, (uint8_t *)&receive_frame, 1, HAL_MAX_DELAY);
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_SET);
+    *data = receive_frame & 0xFF;
     return LIS3MDL_ERR_OK;
 }
 
@@ -149,17 +247,22 @@ enum lis3mdl_err lis3mdl_read_register(struct lis3mdl_device *device, uint8_t re
  * @param start_reg first register to write to  
  * @param bytes number of bytes to write 
  * @param data pointer to buffer with data to write 
+ * @returns LIS3MDL_ERR_GENERAL for an even number of bytes, which does not fill whole 16-bit frames
  * @warning no error checking is performed. Make sure to allocate appropriate buffer sizes for all inputs. 
 **/
 enum lis3mdl_err lis3mdl_write_multiple_registers(struct lis3mdl_device *device, uint8_t start_reg, uint8_t bytes, uint8_t *data) {
-    uint8_t transmit_buf[bytes + 1];
-    for (int i = 1; i <= bytes; i ++) {
-        transmit_buf[i] = data[i - 1];
+    if (bytes % 2 == 0) {
+        return LIS3MDL_ERR_GENERAL;
+    }
+    uint8_t frames = (bytes + 1) / 2;
+    uint16_t transmit_frames[frames];
+    transmit_frames[0] = (uint16_t)(((0x40 | start_reg) << 8) | data[0]);
+    for (int i = 1; i < frames; i++) {
+        transmit_frames[i] = (uint16_t)((data[2 * i - 1] << 8) | data[2 * i]);
     }
-    transmit_buf[0] = 0x40 | start_reg;
-    HAL_GPIO_WritePin((GPIO_TypeDef *)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_RESET);
-    HAL_SPI_Transmit((SPI_HandleTypeDef *)device->spi_handle, transmit_buf, bytes + 1, HAL_MAX_DELAY);
-    HAL_GPIO_WritePin((GPIO_TypeDef *)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_SET);
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_RESET);
+    HAL_SPI_Transmit(device->spi_handle, (uint8_t *)transmit_frames, frames, HAL_MAX_DELAY);
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_SET);
     return LIS3MDL_ERR_OK;
 }
 
@@ -172,23 +275,25 @@ enum lis3mdl_err lis3mdl_write_multiple_registers(struct lis3mdl_device *device,
  * @param start_reg first register to read
  * @param bytes number of consecutive registers to read
  * @param data pointer to buffer to store read bytes
+ * @note An even number of bytes is rounded up to whole 16-bit frames, so one more register is read and dropped.
  * @warning no error checking is performed. Make sure to allocate appropriate buffer sizes for all inputs. 
 */
 
 
 enum lis3mdl_err lis3mdl_read_multiple_registers(struct lis3mdl_device *device, uint8_t start_reg, uint8_t bytes, uint8_t *data) {
     // TODO: error handling
-    uint8_t transmit_buf[bytes + 1];
-    uint8_t receive_buf[bytes + 1];
-    for (int i = 1; i <= bytes; i++) {
-        transmit_buf[i] = 0x00;
+    uint8_t frames = (bytes + 2) / 2;
+    uint16_t transmit_frames[frames];
+    uint16_t receive_frames[frames];
+    for (int i = 1; i < frames; i++) {
+        transmit_frames[i] = 0x0000;
     }
-    transmit_buf[0] = 0xC0 | start_reg;
-    HAL_GPIO_WritePin((GPIO_TypeDef *)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_RESET);
-    HAL_SPI_TransmitReceive((SPI_HandleTypeDef *)device->spi_handle, transmit_buf, receive_buf, bytes + 1, HAL_MAX_DELAY);
-    HAL_GPIO_WritePin((GPIO_TypeDef *)device->cs_pin_port, (uint16_t)device->cs_pin, GPIO_PIN_SET);
+    transmit_frames[0] = (uint16_t)((0xC0 | start_reg) << 8);
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_RESET);
+    HAL_SPI_TransmitReceive(device->spi_handle, (uint8_t *)transmit_frames, (uint8_t *)receive_frames, frames, HAL_MAX_DELAY);
+    HAL_GPIO_WritePin(device->cs_pin, device->cs_pin_port, GPIO_PIN_SET);
     for (int i = 0; i < bytes; i++) {
-        data[i] = receive_buf[i + 1];
+        data[i] = lis3mdl_frame_byte(receive_frames, i + 1);
     }
     return LIS3MDL_ERR_OK;
 }
\ No newline at end of file
@@ -256,16 +256,41 @@ void ublox_gnss_cfg_val_set(struct ublox_gnss_device *device, uint32_t key_id,
                             enum ublox_gnss_cfg_val_transaction transaction,
                             uint32_t layers) {}
 
-void ublox_gnss_cfg_val_set_list(
-    struct ublox_gnss_device *device, struct ublox_gnss_cfg_val *list,
-    uint16_t number_of_values, enum ublox_gnss_cfg_val_transaction transaction,
-    uint32_t layers) {
-  uint16_t msg_length_bytes = 4 + (number_of_values << 2);
+static void cfg_val_put(uint8_t *buf, uint64_t value, uint16_t bytes) {
+  for (uint16_t i = 0; i < bytes; i++) {
+    buf[i] = (uint8_t)(value >> (8 * i));
+  }
+}
 
-  for (uint16_t i = 0; i < number_of_values; i++) {
+static uint16_t cfg_val_msg_length_bytes(const struct ublox_gnss_cfg_val *list,
+                                         uint16_t number_of_values,
+                                         bool with_values) {
+  uint16_t msg_length_bytes = UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES +
+                              (number_of_values << 2);
+
+  for (uint16_t i = 0; with_values && i < number_of_values; i++) {
     msg_length_bytes += cfg_val_key_get_storage_size_bytes(
         UBLOX_GNSS_CFG_VAL_KEY_GET_SIZE((list + i)->key_id));
   }
+  return msg_length_bytes;
+}
+
+/*
+ * Writes a whole UBX-CFG-VALSET frame to buf and returns its length, 0 if it
+ * does not fit in buf_length_bytes.
+ */
+uint16_t ublox_gnss_cfg_val_set_encode(
+    const struct ublox_gnss_cfg_val *list, uint16_t number_of_values,
+    enum ublox_gnss_cfg_val_transaction transaction, uint32_t layers,
+    uint8_t *buf, uint16_t buf_length_bytes) {
+  uint16_t msg_length_bytes =
+      cfg_val_msg_length_bytes(list, number_of_values, true);
+
+  if (number_of_values > UBLOX_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES ||
+      msg_length_bytes + UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES >
+          buf_length_bytes) {
+    return 0;
+  }
 
   uint8_t msg[msg_length_bytes];
 
@@ -274,45 +299,157 @@ void ublox_gnss_cfg_val_set_list(
   *(msg + 2) = (uint8_t)transaction;
   *(msg + 3) = 0;
 
-  uint8_t *tmp = msg + 4;
+  uint8_t *tmp = msg + UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES;
   uint16_t storage_size_bytes;
 
   for (uint16_t i = 0; i < number_of_values; i++) {
-    // *((uint32_t *) tmp) = ublox_protocol_u32_encode(list->key_id);
-    *((uint32_t *)tmp) = (list->key_id);
+    cfg_val_put(tmp, list->key_id, sizeof(list->key_id));
     tmp += sizeof(list->key_id);
     storage_size_bytes = cfg_val_key_get_storage_size_bytes(
         UBLOX_GNSS_CFG_VAL_KEY_GET_SIZE(list->key_id));
-
-    switch (storage_size_bytes) {
-    case 1:
-      *(uint8_t *)tmp = *((const uint8_t *)&(list->value));
-      break;
-    case 2:
-      *(uint16_t *)tmp =
-          ublox_protocol_u16_encode(*(const uint16_t *)&(list->value));
-      break;
-    case 4:
-      *(uint32_t *)tmp =
-          ublox_protocol_u32_encode(*(const uint32_t *)&(list->value));
-      break;
-    case 8:
-      *(uint64_t *)tmp =
-          ublox_protocol_u64_encode(*(const uint64_t *)&(list->value));
-      break;
-    default:
-      break;
-    }
-
+    cfg_val_put(tmp, list->value, storage_size_bytes);
     tmp += storage_size_bytes;
     list++;
   }
 
+  ublox_protocol_encode(0x06, 0x8a, msg, msg_length_bytes, buf);
+  return msg_length_bytes + UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+}
+
+void ublox_gnss_cfg_val_set_list(
+    struct ublox_gnss_device *device, struct ublox_gnss_cfg_val *list,
+    uint16_t number_of_values, enum ublox_gnss_cfg_val_transaction transaction,
+    uint32_t layers) {
   uint16_t ublox_msg_length_bytes =
-      msg_length_bytes + UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+      cfg_val_msg_length_bytes(list, number_of_values, true) +
+      UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
   uint8_t tx[ublox_msg_length_bytes];
-  ublox_protocol_encode(0x06, 0x8a, msg, msg_length_bytes, tx);
-  ublox_gnss_send_msg(device, tx, ublox_msg_length_bytes);
+
+  if (ublox_gnss_cfg_val_set_encode(list, number_of_values, transaction,
+                                    layers, tx, ublox_msg_length_bytes)) {
+    ublox_gnss_send_msg(device, tx, ublox_msg_length_bytes);
+  }
+}
+
+/*
+ * Writes a UBX-CFG-VALGET poll of the keys in list to buf, the values are
+ * not used. Returns the frame length, 0 if it does not fit.
+ */
+uint16_t ublox_gnss_cfg_val_get_encode(const struct ublox_gnss_cfg_val *list,
+                                       uint16_t number_of_values,
+                                       enum ublox_gnss_cfg_val_layer layer,
+                                       uint16_t position, uint8_t *buf,
+                                       uint16_t buf_length_bytes) {
+  uint16_t msg_length_bytes =
+      cfg_val_msg_length_bytes(list, number_of_values, false);
+
+  if (number_of_values > UBLOX_GNSS_CFG_VAL_MSG_MAX_NUM_VALUES ||
+      msg_length_bytes + UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES >
+          buf_length_bytes) {
+    return 0;
+  }
+
+  uint8_t msg[msg_length_bytes];
+
+  // The poll takes a single layer as an index, not as a bit mask
+  switch (layer) {
+  case UBLOX_GNSS_CFG_VAL_LAYER_BBRAM:
+    *(msg + 1) = 1;
+    break;
+  case UBLOX_GNSS_CFG_VAL_LAYER_FLASH:
+    *(msg + 1) = 2;
+    break;
+  case UBLOX_GNSS_CFG_VAL_LAYER_DEFAULT:
+    *(msg + 1) = 7;
+    break;
+  default:
+    *(msg + 1) = 0;
+    break;
+  }
+  *(msg) = 0x00;
+  cfg_val_put(msg + 2, position, 2);
+
+  for (uint16_t i = 0; i < number_of_values; i++) {
+    cfg_val_put(msg + UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES + 4 * i,
+                list[i].key_id, sizeof(list[i].key_id));
+  }
+
+  ublox_protocol_encode(0x06, 0x8b, msg, msg_length_bytes, buf);
+  return msg_length_bytes + UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+}
+
+/*
+ * Decodes the key and value pairs of a UBX-CFG-VALGET response into list.
+ * Returns the number decoded, which stops at max_values or at a key whose
+ * size is unknown or whose value runs past the message.
+ */
+uint16_t ublox_gnss_dec_ubx_cfg_valget(const uint8_t *msg,
+                                       uint16_t msg_length_bytes,
+                                       struct ublox_gnss_cfg_val *list,
+                                       uint16_t max_values) {
+  uint16_t count = 0;
+  uint16_t i = UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES;
+
+  if (msg_length_bytes < UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES ||
+      *msg != 0x01) {
+    return 0;
+  }
+
+  while (count < max_values && i + 4 <= msg_length_bytes) {
+    uint32_t key_id = ublox_protocol_u32_decode(msg + i);
+    uint16_t storage_size_bytes = cfg_val_key_get_storage_size_bytes(
+        UBLOX_GNSS_CFG_VAL_KEY_GET_SIZE(key_id));
+
+    if (storage_size_bytes == 0 ||
+        i + 4 + storage_size_bytes > msg_length_bytes) {
+      break;
+    }
+
+    uint64_t value = 0;
+    for (uint16_t b = 0; b < storage_size_bytes; b++) {
+      value |= (uint64_t)msg[i + 4 + b] << (8 * b);
+    }
+    list[count].key_id = key_id;
+    list[count].value = value;
+    count++;
+    i += 4 + storage_size_bytes;
+  }
+  return count;
+}
+
+/*
+ * Decodes a UBX-ACK-ACK or UBX-ACK-NAK given its class and id. Returns false
+ * for any other message.
+ */
+bool ublox_gnss_dec_ubx_ack(uint8_t class, uint8_t id, const uint8_t *msg,
+                            uint16_t msg_length_bytes,
+                            struct ublox_gnss_ack *ack) {
+  if (class != 0x05 || id > 0x01 ||
+      msg_length_bytes != UBLOX_GNSS_DEC_UBX_ACK_BODY_LENGTH) {
+    return false;
+  }
+  ack->cls_id = msg[0];
+  ack->msg_id = msg[1];
+  ack->ack = id == 0x01;
+  return true;
+}
+
+/*
+ * Value of a key as CFG-VALGET reports it, only as many bytes as the key
+ * holds.
+ */
+uint64_t ublox_gnss_cfg_val_mask(uint32_t key_id, uint64_t value) {
+  uint16_t storage_size_bytes = cfg_val_key_get_storage_size_bytes(
+      UBLOX_GNSS_CFG_VAL_KEY_GET_SIZE(key_id));
+
+  if (UBLOX_GNSS_CFG_VAL_KEY_GET_SIZE(key_id) ==
+      UBLOX_GNSS_CFG_VAL_KEY_SIZE_ONE_BIT) {
+    return value & 0x01;
+  }
+  if (storage_size_bytes >= 8) {
+    return value;
+  }
+  return value & ((UINT64_C(1) << (8 * storage_size_bytes)) - 1);
 }
 
 void ublox_gnss_dec_ubx_nav_timeutc(
@@ -471,6 +608,27 @@ void ublox_gnss_dec_ubx_nav_posllh(uint8_t *msg, uint16_t msg_length_bytes,
   memcpy(nav_posllh, &tmp, sizeof(tmp));
 }
 
+void ublox_gnss_dec_ubx_nav_velned(uint8_t *msg, uint16_t msg_length_bytes,
+                                   struct ublox_gnss_nav_velned *nav_velned) {
+  if (msg_length_bytes != UBLOX_GNSS_DEC_UBX_NAV_VELNED_BODY_LENGTH) {
+    return;
+  }
+
+  struct ublox_gnss_nav_velned tmp;
+
+  tmp.itow = ublox_protocol_u32_decode(msg);
+  tmp.vel_n = (int32_t)ublox_protocol_u32_decode(msg + 4);
+  tmp.vel_e = (int32_t)ublox_protocol_u32_decode(msg + 8);
+  tmp.vel_d = (int32_t)ublox_protocol_u32_decode(msg + 12);
+  tmp.speed = ublox_protocol_u32_decode(msg + 16);
+  tmp.g_speed = ublox_protocol_u32_decode(msg + 20);
+  tmp.heading = (int32_t)ublox_protocol_u32_decode(msg + 24);
+  tmp.s_acc = ublox_protocol_u32_decode(msg + 28);
+  tmp.c_acc = ublox_protocol_u32_decode(msg + 32);
+
+  memcpy(nav_velned, &tmp, sizeof(tmp));
+}
+
 void ublox_gnss_dec_ubx_nav_hppvt(uint8_t *msg, uint16_t msg_length_bytes,
                                  struct ublox_gnss_nav_hppvt *nav_hppvt) {
     if (msg_length_bytes != UBLOX_GNSS_DEC_UBX_NAV_HPPVT_BODY_LENGTH) {
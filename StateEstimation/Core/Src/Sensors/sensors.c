@@ -1,5 +1,6 @@
 #include "sensors.h"
 #include "gen_constants.h"
+#include "baro_altitude.h"
 
 I2C_HandleTypeDef hi2c4;
 
@@ -7,6 +8,7 @@ SPI_HandleTypeDef hspi2;
 SPI_HandleTypeDef hspi4;
 SPI_HandleTypeDef hspi6;
 
+TIM_HandleTypeDef htim2;
 TIM_HandleTypeDef htim6;
 TIM_HandleTypeDef htim7;
 
@@ -14,74 +16,277 @@ UART_HandleTypeDef huart4;
 UART_HandleTypeDef huart2;
 UART_HandleTypeDef huart3;
 DMA_HandleTypeDef hdma_usart3_rx;
+DMA_HandleTypeDef hdma_spi4_rx;
+DMA_HandleTypeDef hdma_spi4_tx;
 
 PCD_HandleTypeDef hpcd_USB_OTG_HS;
 
 struct ADIS_Device imu_device;
+ImuPipeline imu_pipeline;
+VibrationMonitor vibration_monitor;
+EventDetector event_detector;
+FaultDetector fault_detector;
+uint32_t imu_burst_errors;
+static volatile uint8_t imu_read_pending;
 struct lis3mdl_device mag_device;
+DMA_BUFFER static uint16_t mag_dma_tx[LIS3MDL_DMA_FRAMES];
+DMA_BUFFER static uint16_t mag_dma_rx[LIS3MDL_DMA_FRAMES];
 MS5607StateTypeDef ms5607_state;
 
 struct ublox_gnss_device gps;
-__attribute__((section(".buffer"))) uint8_t uart4_rx_dma_buffer[1024];
+DMA_BUFFER uint8_t uart4_rx_dma_buffer[1024];
 uint16_t uart4_rx_dma_buffer_size;
 struct ring_buffer uart4_rx_rb;
 struct ring_buffer usart3_rx_rb;
 uint8_t uart4_rx_rb_data[512];
-struct ublox_gnss_cfg_val cfg[10];
+UbloxConfig gps_config;
+TimeSync time_sync;
+volatile uint32_t uart4_rx_time_us;
+static uint8_t gps_tx[256];
 
+// RAM layer only, the receiver starts from its own defaults at every power up
+static const struct ublox_gnss_cfg_val gps_profile[] = {
+    {UBLOX_GNSS_CFG_UART1_ENABLED, 1},
+    {UBLOX_GNSS_CFG_UART1INPROT_UBX, 1},
+    {UBLOX_GNSS_CFG_UART1OUTPROT_UBX, 1},
+    {UBLOX_GNSS_CFG_UART1OUTPROT_NMEA, 0},     // nothing on the line that is not decoded
+    {UBLOX_GNSS_CFG_UART1_BAUDRATE, 38400},    // as MX_UART4_Init(), 10 Hz PVT and HPPOSECEF use a third
+    {UBLOX_GNSS_CFG_NAVSPG_FIXMODE, 2},        // 3D only
+    {UBLOX_GNSS_CFG_NAVSPG_DYNMODEL, 8},       // airborne with < 4g acceleration
+    {UBLOX_GNSS_CFG_RATE_MEAS, 100},           // ms, 10 Hz
+    {UBLOX_GNSS_CFG_RATE_NAV, 1},              // a solution every measurement
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_PVT_UART1, 1},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_HPPOSECEF_UART1, 1},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_POSECEF_UART1, 0},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_POSLLH_UART1, 0},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_TIMEUTC_UART1, 0},
+    {UBLOX_GNSS_CFG_TP_TP1_ENA, 1},            // time pulse on PA15, a rising edge every GPS second
+    {UBLOX_GNSS_CFG_TP_TIMEGRID_TP1, 1},       // GPS, not UTC
+};
 
 /**
- * @brief Updates sensor readings from all onboard sensors
- * @param sensors Pointer to Sensors structure to store updated readings
- * @param huart UART handle for debug output
+ * @brief Queues a frame for the GNSS receiver
+ * @param device Receiver, its UART handle is used
+ * @param buffer Whole UBX frame, copied
+ * @param size Frame length
+ * @return UBLOX_GNSS_ERR_BUSY while the previous frame is still going out, or
+ *         if the frame is too long, UBLOX_GNSS_ERR_OK once it is queued
+ * @details Replaces the no-op in gps.c. The frame is sent by interrupt, so
+ *          this returns at once.
  */
-void update_sensors(Sensors *sensors, UART_HandleTypeDef *huart) {
-    float32_t accel_readings[3];
-    float32_t gyro_readings[3];
-    //double mag_readings[3];
-    adis_read_accel(&imu_device, accel_readings);
-    sensors->accel_x = -1.0 * accel_readings[0];
-    sensors->accel_y = -1.0 * accel_readings[1];
-    sensors->accel_z = accel_readings[2];
-    adis_read_gyro(&imu_device, gyro_readings);
-    sensors->gyro_x = -1.0 * gyro_readings[0] * PI / 180;
-    sensors->gyro_y = -1.0 * gyro_readings[1] * PI / 180;
-    sensors->gyro_z = gyro_readings[2] * PI / 180;
-    MS5607Update();
-    uint32_t bytes_to_read = ring_buffer_get_full(&uart4_rx_rb);
-    if (bytes_to_read) {
-        uint8_t tmp[bytes_to_read];
-        uint8_t *tmp2 = tmp;
-        size_t bytes_read = ring_buffer_read(&uart4_rx_rb, tmp, bytes_to_read);
+enum ublox_gnss_err ublox_gnss_send_msg(struct ublox_gnss_device *device, const uint8_t *buffer, uint16_t size) {
+    UART_HandleTypeDef *huart = device->transport_handle.uart;
+
+    if (size > sizeof(gps_tx) || huart->gState != HAL_UART_STATE_READY) {
+        return UBLOX_GNSS_ERR_BUSY;
+    }
+    memcpy(gps_tx, buffer, size);
+    return HAL_UART_Transmit_IT(huart, gps_tx, size) == HAL_OK ? UBLOX_GNSS_ERR_OK : UBLOX_GNSS_ERR_BUSY;
+}
+
+/**
+ * @brief Local time of the microsecond timeline every sample is stamped on
+ * @return TIM2 count, wraps about every 71 minutes
+ */
+uint32_t sensor_time_us(void) {
+    return htim2.Instance->CNT;
+}
+
+/**
+ * @brief Puts a navigation solution on the local timeline
+ * @param fix Solution, receives its time of week and local time
+ * @param tow GPS time of week of the solution, ms
+ * @param time_valid The receiver flagged the time of week valid
+ * @param arrival_us Local time the solution came in
+ * @details A valid time of week also matches the last time pulse edge. Once
+ *          the time pulse mapping is locked the solution is stamped with the
+ *          time it is valid for, before that with its arrival.
+ */
+static void gps_stamp(GpsFix *fix, uint32_t tow, uint8_t time_valid, uint32_t arrival_us) {
+    fix->tow = tow;
+    fix->time_us = arrival_us;
+    fix->time_source = GPS_TIME_ARRIVAL;
+    if (!time_valid) {
+        return;
+    }
+    time_sync_solution(&time_sync, tow, arrival_us);
+    if (time_sync_to_local(&time_sync, tow, &fix->time_us)) {
+        fix->time_source = GPS_TIME_PPS;
+    }
+}
+
+/**
+ * @brief Decodes every UBX frame in a chunk from the GNSS receiver
+ * @param sensors Receives the position
+ * @param buf Bytes from the UART4 ring buffer
+ * @param len Number of bytes
+ * @param arrival_us Local time the chunk came in
+ * @details A chunk is what came in before the line went idle, usually one
+ *          navigation epoch of several frames. Acknowledgements and
+ *          configuration read backs go to the configuration engine.
+ */
+static void gps_parse(Sensors *sensors, uint8_t *buf, uint16_t len, uint32_t arrival_us) {
+    uint8_t *next = buf;
+    uint8_t *end = buf + len;
+
+    while (next < end) {
         uint8_t msg[256];
-        uint16_t msg_len;  // Changed from len to msg_len
+        uint16_t msg_len = UINT16_MAX;
         uint8_t *rem;
         uint8_t cls;
         uint8_t id;
-        ublox_protocol_decode(tmp2, bytes_read, &cls, &id, msg, sizeof(msg), &msg_len, &rem);
-        if (cls == 0x01) { 
-            switch (id) {
-                case 0x13: { 
-                    struct ublox_gnss_nav_hpposecef ecef_data;
-                    ublox_gnss_dec_ubx_nav_hpposecef(msg, msg_len, &ecef_data);
-                    sensors->gps_offset_x = ecef_data.ecefX * 0.1 + ecef_data.ecefXHp * 0.0001;
-                    sensors->gps_offset_y = ecef_data.ecefY * 0.1 + ecef_data.ecefYHp * 0.0001;
-                    sensors->gps_offset_z = ecef_data.ecefZ * 0.1 + ecef_data.ecefZHp * 0.0001;
+        ublox_protocol_decode(next, (uint16_t)(end - next), &cls, &id, msg, sizeof(msg), &msg_len, &rem);
+        next = rem;
+        // No complete frame left
+        if (msg_len == UINT16_MAX) {
+            break;
+        }
+        if (ublox_config_handle(&gps_config, cls, id, msg, msg_len) || cls != 0x01) {
+            continue;
+        }
+        switch (id) {
+            case 0x07: {
+                struct ublox_gnss_nav_pvt pvt_data;
+                if (msg_len != UBLOX_GNSS_DEC_UBX_NAV_PVT_BODY_LENGTH) {
+                    break;
+                }
+                ublox_gnss_dec_ubx_nav_pvt(msg, msg_len, &pvt_data);
+                sensors->gps_x = pvt_data.lat * 1e-7;
+                sensors->gps_y = pvt_data.lon * 1e-7;
+                sensors->gps_z = pvt_data.height * 1e-3;
+                gnss_fix_from_pvt(&sensors->gps_fix, &pvt_data);
+                gps_stamp(&sensors->gps_fix, pvt_data.itow, pvt_data.valid & GPS_VALID_TIME, arrival_us);
+                break;
+            }
+            case 0x12: {
+                // Only when the receiver is set up to send it, NAV-PVT already has the velocity
+                struct ublox_gnss_nav_velned velned_data;
+                if (msg_len != UBLOX_GNSS_DEC_UBX_NAV_VELNED_BODY_LENGTH) {
+                    break;
+                }
+                ublox_gnss_dec_ubx_nav_velned(msg, msg_len, &velned_data);
+                gnss_fix_from_velned(&sensors->gps_fix, &velned_data);
+                break;
+            }
+            case 0x13: {
+                struct ublox_gnss_nav_hpposecef ecef_data;
+                if (msg_len != UBLOX_GNSS_DEC_UBX_NAV_HPPOSECEF_BODY_LENGTH) {
                     break;
                 }
-                case 0x28: {
-                    struct ublox_gnss_nav_hppvt hppvt_data;
-                    ublox_gnss_dec_ubx_nav_hppvt(msg, msg_len, &hppvt_data);
-                    sensors->gps_x = hppvt_data.lat * 1e-7 + hppvt_data.latHp * 1e-9;
-                    sensors->gps_y = hppvt_data.lon * 1e-7 + hppvt_data.lonHp * 1e-9;
-                    sensors->gps_z = hppvt_data.height * 1e-3 + hppvt_data.heightHp * 1e-4;
+                ublox_gnss_dec_ubx_nav_hpposecef(msg, msg_len, &ecef_data);
+                sensors->gps_offset_x = ecef_data.ecefX * 0.1 + ecef_data.ecefXHp * 0.0001;
+                sensors->gps_offset_y = ecef_data.ecefY * 0.1 + ecef_data.ecefYHp * 0.0001;
+                sensors->gps_offset_z = ecef_data.ecefZ * 0.1 + ecef_data.ecefZHp * 0.0001;
+                break;
+            }
+            case 0x28: {
+                struct ublox_gnss_nav_hppvt hppvt_data;
+                if (msg_len != UBLOX_GNSS_DEC_UBX_NAV_HPPVT_BODY_LENGTH) {
                     break;
                 }
+                ublox_gnss_dec_ubx_nav_hppvt(msg, msg_len, &hppvt_data);
+                sensors->gps_x = hppvt_data.lat * 1e-7 + hppvt_data.latHp * 1e-9;
+                sensors->gps_y = hppvt_data.lon * 1e-7 + hppvt_data.lonHp * 1e-9;
+                sensors->gps_z = hppvt_data.height * 1e-3 + hppvt_data.heightHp * 1e-4;
+                gnss_fix_from_hppvt(&sensors->gps_fix, &hppvt_data);
+                gps_stamp(&sensors->gps_fix, hppvt_data.itow, hppvt_data.valid & GPS_VALID_TIME, arrival_us);
+                break;
             }
         }
     }
 }
 
+
+/**
+ * @brief Updates sensor readings from all onboard sensors
+ * @param sensors Pointer to Sensors structure to store updated readings
+ * @param huart UART handle for debug output
+ * @return 1 if the estimator should run this cycle: the IMU pipeline had a new
+ *         block, or none has come for IMU_STALE_MS
+ * @details The ADIS16500 is read at its full output rate by the data ready
+ *          interrupt and filtered and decimated a block at a time here, so a
+ *          cycle runs at the pipeline output rate however fast the main loop
+ *          spins, and the other sensors are only read then. The magnetometer
+ *          is read by a DMA burst started at the end of the previous cycle and
+ *          collected here. The LIS3MDL axes are taken as the body axes, as the
+ *          SIL models it. The raw block also goes to the vibration monitor and
+ *          the event detector, and each new pressure reading to the latter.
+ *          The fault detector gets the raw block, every pressure reading and
+ *          the height of every new GNSS solution, it classifies them later in
+ *          the spare main loop passes.
+ *          Each reading is stamped on the sensor_time_us() timeline, and the
+ *          GNSS solutions with the time they are valid for once the time
+ *          pulse is tracked.
+ */
+uint8_t update_sensors(Sensors *sensors, UART_HandleTypeDef *huart) {
+    static uint32_t last_cycle_ms;
+    static uint32_t mag_start_us;
+    static uint32_t last_tow;
+    float32_t mag_readings[3];
+
+    // The block stays put while ready is set, the interrupt drops new ones until it is collected
+    if (imu_pipeline.ready) {
+        uint8_t done = imu_pipeline.write ^ 1;
+        vibration_monitor_push(&vibration_monitor, imu_pipeline.block[done], imu_pipeline.cfg.decimation);
+        event_detector_push(&event_detector, imu_pipeline.block[done], imu_pipeline.cfg.decimation,
+                            imu_pipeline.block_time[done]);
+        fault_detector_push_imu(&fault_detector, imu_pipeline.block[done], imu_pipeline.cfg.decimation);
+    }
+    sensors->imu_new = imu_pipeline_process(&imu_pipeline);
+    if (!sensors->imu_new && HAL_GetTick() - last_cycle_ms < IMU_STALE_MS) {
+        return 0;
+    }
+    last_cycle_ms = HAL_GetTick();
+    if (sensors->imu_new) {
+        sensors->imu_time_us = imu_pipeline.time_us;
+        sensors->accel_x = -1.0 * imu_pipeline.accel[0];
+        sensors->accel_y = -1.0 * imu_pipeline.accel[1];
+        sensors->accel_z = imu_pipeline.accel[2];
+        sensors->gyro_x = -1.0 * imu_pipeline.gyro[0];
+        sensors->gyro_y = -1.0 * imu_pipeline.gyro[1];
+        sensors->gyro_z = imu_pipeline.gyro[2];
+    }
+    // Four frames, a few microseconds, started a whole cycle ago
+    while (mag_device.dma_busy) {
+    }
+    sensors->mag_new = lis3mdl_get_mag_dma(&mag_device, mag_readings);
+    if (sensors->mag_new) {
+        sensors->mag_time_us = mag_start_us;
+        sensors->mag_x = mag_readings[0];
+        sensors->mag_y = mag_readings[1];
+        sensors->mag_z = mag_readings[2];
+    }
+    mag_start_us = sensor_time_us();
+    lis3mdl_start_read_mag_dma(&mag_device);
+    sensors->baro_time_us = sensor_time_us();
+    MS5607Update();
+    sensors->pressure = (float32_t)MS5607GetPressurePa();
+    if (sensors->pressure > 0.0f) {
+        event_detector_baro(&event_detector, baro_altitude(sensors->pressure, NULL), sensors->baro_time_us);
+        fault_detector_push(&fault_detector, FAULT_BARO, sensors->pressure);
+    }
+    uint32_t bytes_to_read = ring_buffer_get_full(&uart4_rx_rb);
+    if (bytes_to_read) {
+        uint8_t tmp[bytes_to_read];
+        size_t bytes_read = ring_buffer_read(&uart4_rx_rb, tmp, bytes_to_read);
+        gps_parse(sensors, tmp, bytes_read, uart4_rx_time_us);
+    }
+    if (sensors->gps_fix.tow != last_tow) {
+        last_tow = sensors->gps_fix.tow;
+        fault_detector_push(&fault_detector, FAULT_GNSS, sensors->gps_z);
+    }
+    UbloxConfigState gps_state = gps_config.state;
+    ublox_config_poll(&gps_config, HAL_GetTick());
+    if (gps_config.state != gps_state && ublox_config_finished(&gps_config)) {
+        char debug[80];
+        int len = sprintf(debug, "GNSS config %s: %u acks, %u naks, %u timeouts\r\n",
+                          gps_config.state == UBLOX_CONFIG_DONE ? "done" : "FAILED", gps_config.acks,
+                          gps_config.naks, gps_config.timeouts);
+        HAL_UART_Transmit(huart, (uint8_t *)debug, len, HAL_MAX_DELAY);
+    }
+    return 1;
+}
+
 /**
  * @brief Initializes all onboard sensors and communication interfaces
  * @param sensors Pointer to Sensors structure to initialize
@@ -95,8 +300,10 @@ void sensors_init(Sensors *sensors) {
   mag_device.spi_handle = &hspi4;  
   mag_device.cs_pin_port = GPIO_PIN_5; 
   mag_device.cs_pin = GPIOC;  
+  mag_device.dma_tx = mag_dma_tx;
+  mag_device.dma_rx = mag_dma_rx;
   mag_device.temp_enable = LIS3MDL_TEMP_EN;
-  //mag_device.data_rate = LIS3MDL_ODR_40HZ;
+  mag_device.data_rate = LIS3MDL_UHP_155Hz;
   mag_device.self_test = LIS3MDL_SELF_TEST_DIS;
   mag_device.full_scale = LIS3MDL_FS_4Gauss;
   mag_device.z_axis_mode = LIS3MDL_Z_UHP;
@@ -109,41 +316,96 @@ void sensors_init(Sensors *sensors) {
   //gps.transport_type = UBLOX_GNSS_TRANSPORT_SPI;
   gps.transport_handle.uart = &huart4;
   //gps.transport_handle.spi = &hspi4;
-  cfg[0].key_id = 0x10520005; 
-  cfg[0].value = 0x01;
-
-  cfg[1].key_id = 0x10740001; 
-  cfg[1].value = 0x01; 
-
-  //3D only
-  cfg[2].key_id = 0x20110011;
-  cfg[2].value = 0x02;
+  HAL_UARTEx_ReceiveToIdle_IT(&huart4, uart4_rx_dma_buffer, sizeof(uart4_rx_dma_buffer));
+  ring_buffer_init(&uart4_rx_rb, uart4_rx_rb_data, sizeof(uart4_rx_rb_data));
+  ublox_config_start(&gps_config, &gps, gps_profile, sizeof(gps_profile) / sizeof(gps_profile[0]));
+  time_sync_init(&time_sync);
+  HAL_TIM_IC_Start_IT(&htim2, TIM_CHANNEL_1);
+  memset(sensors, 0, sizeof(Sensors));
+  sensors->mag_scale_x = 1.0f;
+  sensors->mag_scale_y = 1.0f;
+  sensors->mag_scale_z = 1.0f;
 
-  //UART
-  cfg[3].key_id = 0x20910025;
-  cfg[3].value = 0x00;
+  ImuPipelineConfig imu_cfg;
+  imu_pipeline_default_config(&imu_cfg);
+  imu_pipeline_init(&imu_pipeline, &imu_cfg);
+  vibration_monitor_init(&vibration_monitor, imu_cfg.sample_rate);
+  event_detector_init(&event_detector, imu_cfg.sample_rate);
+  fault_detector_init(&fault_detector, DWT_GetCycles);
+  HAL_NVIC_EnableIRQ(EXTI9_5_IRQn);
+}
 
-  //Airborn with < 4g acceleration
-  cfg[4].key_id = 0x20110021;
-  cfg[4].value = 0x08;
+/**
+ * @brief Reads one ADIS16500 burst into the IMU pipeline
+ * @details Left to the end of the magnetometer burst if that holds the bus,
+ *          a few microseconds late against a 500 us sample period.
+ */
+static void imu_sample(void) {
+  uint16_t burst[10];
+  uint32_t sample_us = sensor_time_us();
 
-  //TimeUTC UART enabled
-  cfg[5].key_id = 0x2091005C;
-  cfg[5].value = 0x01;
+  if (mag_device.dma_busy) {
+    imu_read_pending = 1;
+    return;
+  }
+  imu_read_pending = 0;
+  if (adis_burst_read(&imu_device, burst)) {
+    imu_pipeline_push(&imu_pipeline, (const int16_t *)&burst[1], sample_us);
+  } else {
+    imu_burst_errors++;
+  }
+}
 
-  cfg[6].key_id = 0x20910007;
-  cfg[6].value = 0x01;
+/**
+ * @brief EXTI callback
+ * @param GPIO_Pin Pin that raised the interrupt
+ * @details Samples the IMU on every ADIS16500 data ready edge
+ */
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  if (GPIO_Pin == ADIS_DR_PIN) {
+    imu_sample();
+  }
+}
 
-  cfg[7].key_id = 0x2091002a;
-  cfg[7].value = 0x00;
+/**
+ * @brief Timer input capture callback
+ * @param htim Timer handle
+ * @details Hands the GNSS time pulse edge captured by TIM2 to the time sync
+ */
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim) {
+  if (htim->Instance == TIM2 && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1) {
+    time_sync_pps(&time_sync, HAL_TIM_ReadCapturedValue(htim, TIM_CHANNEL_1));
+  }
+}
 
-  cfg[8].key_id = 0x40520001;
-  cfg[8].value = 38400;  
+/**
+ * @brief SPI DMA transfer complete callback
+ * @param hspi SPI handle
+ * @details Ends the magnetometer burst started by update_sensors() and takes
+ *          the IMU sample it held off
+ */
+void HAL_SPI_TxRxCpltCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi == mag_device.spi_handle && mag_device.dma_busy) {
+    lis3mdl_dma_complete(&mag_device);
+    if (imu_read_pending) {
+      imu_sample();
+    }
+  }
+}
 
-  ublox_gnss_cfg_val_set_list(&gps, cfg, 10, 0, 1);
-  HAL_UARTEx_ReceiveToIdle_IT(&huart4, uart4_rx_dma_buffer, sizeof(uart4_rx_dma_buffer));
-  ring_buffer_init(&uart4_rx_rb, uart4_rx_rb_data, sizeof(uart4_rx_rb_data));
-  memset(sensors, 0, sizeof(Sensors));
+/**
+ * @brief SPI error callback
+ * @param hspi SPI handle
+ * @details Releases the bus after a failed magnetometer burst and takes the
+ *          IMU sample it held off
+ */
+void HAL_SPI_ErrorCallback(SPI_HandleTypeDef *hspi) {
+  if (hspi == mag_device.spi_handle && mag_device.dma_busy) {
+    lis3mdl_dma_abort(&mag_device);
+    if (imu_read_pending) {
+      imu_sample();
+    }
+  }
 }
 
 
@@ -152,6 +414,8 @@ void sensors_init(Sensors *sensors) {
  * @details Initializes system clock, DMA, I2C, SPI, UART, USB, timers, and GPIO
  */
 void protocol_init(void) {
+  MPU_Config();
+  cache_init();
   HAL_Init();
   SystemClock_Config();
   DWT_Init();
@@ -164,6 +428,7 @@ void protocol_init(void) {
   MX_USB_OTG_HS_PCD_Init();
   MX_USART3_UART_Init();
   MX_UART4_Init();
+  MX_TIM2_Init();
   MX_TIM6_Init();
   MX_TIM7_Init();
   MX_GPIO_Init();
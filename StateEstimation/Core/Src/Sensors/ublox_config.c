@@ -0,0 +1,179 @@
+/**
+ * @file ublox_config.c
+ * @brief Non-blocking u-blox configuration, acknowledged and read back key by key
+ *
+ * @details Frames that arrive for a step the engine has already left, the
+ *          ACK of a CFG-VALSET that was sent twice or the response to a
+ *          CFG-VALGET that timed out, are taken and dropped. A CFG-VALGET
+ *          response only counts for the batch in flight if it holds the same
+ *          keys in the same order.
+ */
+
+#include <string.h>
+
+#include "ublox_config.h"
+
+#define UBLOX_CLASS_ACK 0x05
+#define UBLOX_CLASS_CFG 0x06
+#define UBLOX_ID_CFG_VALSET 0x8a
+#define UBLOX_ID_CFG_VALGET 0x8b
+
+// Starts the batch at first, or finishes if there is none left
+static void ublox_config_next(UbloxConfig *cfg, uint16_t first) {
+    cfg->first = first;
+    cfg->sends = 0;
+    if (first >= cfg->count) {
+        cfg->batch = 0;
+        cfg->pending = 0;
+        cfg->state = cfg->failed ? UBLOX_CONFIG_FAILED : UBLOX_CONFIG_DONE;
+        return;
+    }
+    cfg->batch = cfg->count - first < UBLOX_CONFIG_BATCH ? cfg->count - first : UBLOX_CONFIG_BATCH;
+    cfg->state = UBLOX_CONFIG_SET;
+    cfg->pending = 1;
+}
+
+// Sends the batch again from state, or gives it up once it has used its frames
+static void ublox_config_retry(UbloxConfig *cfg, UbloxConfigState state) {
+    if (cfg->sends >= UBLOX_CONFIG_SENDS) {
+        cfg->failed++;
+        ublox_config_next(cfg, cfg->first + cfg->batch);
+        return;
+    }
+    cfg->state = state;
+    cfg->pending = 1;
+}
+
+static uint8_t ublox_config_send(UbloxConfig *cfg) {
+    const struct ublox_gnss_cfg_val *batch = &cfg->profile[cfg->first];
+    uint16_t len;
+
+    if (cfg->state == UBLOX_CONFIG_SET) {
+        len = ublox_gnss_cfg_val_set_encode(batch, cfg->batch, UBLOX_GNSS_CFG_VAL_TRANSACTION_NONE,
+                                            UBLOX_GNSS_CFG_VAL_LAYER_RAM, cfg->tx, sizeof(cfg->tx));
+    } else {
+        len = ublox_gnss_cfg_val_get_encode(batch, cfg->batch, UBLOX_GNSS_CFG_VAL_LAYER_RAM, 0, cfg->tx,
+                                            sizeof(cfg->tx));
+    }
+    return ublox_gnss_send_msg(cfg->device, cfg->tx, len) == UBLOX_GNSS_ERR_OK;
+}
+
+/**
+ * @brief Starts bringing the receiver to a profile
+ * @param cfg Engine to start, any earlier run is abandoned
+ * @param device Receiver, handed to ublox_gnss_send_msg()
+ * @param profile Keys and values for the RAM layer, kept by reference
+ * @param count Number of keys
+ * @details The first frame goes out on the next ublox_config_poll().
+ */
+void ublox_config_start(UbloxConfig *cfg, struct ublox_gnss_device *device,
+                        const struct ublox_gnss_cfg_val *profile, uint16_t count) {
+    memset(cfg, 0, sizeof(UbloxConfig));
+    cfg->device = device;
+    cfg->profile = profile;
+    cfg->count = count;
+    ublox_config_next(cfg, 0);
+}
+
+/**
+ * @brief Sends the frame that is due and notices a missing answer
+ * @param cfg Engine to advance
+ * @param now Milliseconds, HAL_GetTick()
+ * @details Call every cycle. Does nothing once the engine has finished.
+ */
+void ublox_config_poll(UbloxConfig *cfg, uint32_t now) {
+    if (cfg->state != UBLOX_CONFIG_SET && cfg->state != UBLOX_CONFIG_VERIFY) {
+        return;
+    }
+    if (cfg->pending) {
+        // A busy UART leaves it pending for the next poll
+        if (ublox_config_send(cfg)) {
+            cfg->pending = 0;
+            cfg->sends++;
+            cfg->sent_ms = now;
+        }
+        return;
+    }
+    if (now - cfg->sent_ms >= UBLOX_CONFIG_TIMEOUT_MS) {
+        cfg->timeouts++;
+        ublox_config_retry(cfg, cfg->state);
+    }
+}
+
+// Compares a CFG-VALGET response with the batch, 0 if it is not for the batch at all
+static uint8_t ublox_config_verify(UbloxConfig *cfg, const uint8_t *msg, uint16_t len, uint8_t *match) {
+    struct ublox_gnss_cfg_val values[UBLOX_CONFIG_BATCH];
+    const struct ublox_gnss_cfg_val *batch = &cfg->profile[cfg->first];
+
+    if (ublox_gnss_dec_ubx_cfg_valget(msg, len, values, UBLOX_CONFIG_BATCH) != cfg->batch) {
+        return 0;
+    }
+    *match = 1;
+    for (uint16_t i = 0; i < cfg->batch; i++) {
+        if (values[i].key_id != batch[i].key_id) {
+            return 0;
+        }
+        if (values[i].value != ublox_gnss_cfg_val_mask(batch[i].key_id, batch[i].value)) {
+            *match = 0;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Takes a frame from the receiver
+ * @param cfg Engine the frame may be for
+ * @param cls UBX class
+ * @param id UBX id
+ * @param msg Payload
+ * @param len Payload length
+ * @return 1 if the frame is an ACK, NAK or CFG-VALGET response, which are
+ *         for the engine whatever its state, 0 for any other frame
+ */
+uint8_t ublox_config_handle(UbloxConfig *cfg, uint8_t cls, uint8_t id, const uint8_t *msg, uint16_t len) {
+    struct ublox_gnss_ack ack;
+
+    if (ublox_gnss_dec_ubx_ack(cls, id, msg, len, &ack)) {
+        if (ack.cls_id != UBLOX_CLASS_CFG || cfg->pending) {
+            return 1;
+        }
+        if (cfg->state == UBLOX_CONFIG_SET && ack.msg_id == UBLOX_ID_CFG_VALSET) {
+            if (ack.ack) {
+                cfg->acks++;
+                cfg->state = UBLOX_CONFIG_VERIFY;
+                cfg->pending = 1;
+            } else {
+                cfg->naks++;
+                ublox_config_retry(cfg, UBLOX_CONFIG_SET);
+            }
+        } else if (cfg->state == UBLOX_CONFIG_VERIFY && ack.msg_id == UBLOX_ID_CFG_VALGET && !ack.ack) {
+            // The receiver does not know one of the keys
+            cfg->naks++;
+            ublox_config_retry(cfg, UBLOX_CONFIG_VERIFY);
+        }
+        return 1;
+    }
+
+    if (cls != UBLOX_CLASS_CFG || id != UBLOX_ID_CFG_VALGET) {
+        return 0;
+    }
+    uint8_t match;
+    if (cfg->state == UBLOX_CONFIG_VERIFY && !cfg->pending && ublox_config_verify(cfg, msg, len, &match)) {
+        if (match) {
+            ublox_config_next(cfg, cfg->first + cfg->batch);
+        } else {
+            cfg->mismatches++;
+            ublox_config_retry(cfg, UBLOX_CONFIG_SET);
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Whether the engine has stopped sending
+ * @param cfg Engine to check
+ * @return 1 in UBLOX_CONFIG_DONE or UBLOX_CONFIG_FAILED
+ */
+uint8_t ublox_config_finished(const UbloxConfig *cfg) {
+    return cfg->state == UBLOX_CONFIG_DONE || cfg->state == UBLOX_CONFIG_FAILED;
+}
@@ -10,6 +10,7 @@
 */
 
 #include "attitude.h"
+#include "trig.h"
 
 void initialize_rocket_attitude(RocketAttitude *rocket_atd, float32_t qs, float32_t qx, float32_t qy, float32_t qz){
     rocket_atd->q_current_s = qs;
@@ -23,6 +24,14 @@ void initialize_rocket_attitude(RocketAttitude *rocket_atd, float32_t qs, float3
     rocket_atd->gyro_x = 0.0;
     rocket_atd->gyro_y = 0.0;
     rocket_atd->gyro_z = 0.0;
+    rocket_atd->mag_ref[0] = 0.0;
+    rocket_atd->mag_ref[1] = 0.0;
+    rocket_atd->mag_ref[2] = 0.0;
+    rocket_atd->mag_ref_norm = 0.0;
+    rocket_atd->mag_ref_valid = 0;
+    rocket_atd->mag_heading_error = 0.0;
+    rocket_atd->renorm_count = 0;
+    attitude_update_frame(rocket_atd);
 }
 /**
  * @brief Set the value of the gyro measurement that the attitude update system is using
@@ -44,38 +53,34 @@ void set_gyro(RocketAttitude *rocket_atd, float32_t* readings) {
  * and converts them to an instantaneous rotation quaternion that may be later used to update the attitude of the rocket.
  * The instantaneous rotation quaternion is four elements, q_delt_{s, x, y, z} and is stored in the attitude estimation struct.
  * @param rocket_atd (struct that attitude estimation system is built out of)
- * @note If all gyro measurements are zero, which is technically a possible outcome while in flight, this would result in this
- * function failing due to division by zero. As a result, if all gyro measurements are zero, 0.01 is added to make the norm of 
- * the vector w = [wx, wy, wz] a nonzero value. 
+ * @details With h = w * dt / 2 and a = |h|, the increment is [cos(a), h sin(a) / a]. Both are even in a, so they are
+ * evaluated from a^2 by their Taylor series to the a^4 term, with no square root, division or trigonometric function.
+ * The series alternate with shrinking terms, so the error is under the first term left out, a^6 / 720, which stays
+ * under float epsilon up to ATTITUDE_SERIES_MAX_HALF_ANGLE, above the ADIS16500 range at the estimator rate. Larger
+ * increments go through trig_sincos(). A zero rate gives the identity exactly.
 */
 void gyro_to_rotation_quat(RocketAttitude *rocket_atd){ 
-    float32_t omega[] = {rocket_atd->gyro_x, rocket_atd->gyro_y, rocket_atd->gyro_z}; //Create a vector omega = [wx, wy, wz]
-    float32_t norm = sqrt(omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2]); //Calculate the norm of this vector
-
-    omega[0] = norm == 0 ? omega[0] + 0.01 : omega[0];
-    omega[1] = norm == 0 ? omega[1] + 0.01 : omega[1];
-    omega[2] = norm == 0 ? omega[2] + 0.01 : omega[2];
-
-    norm = sqrt(omega[0]*omega[0] + omega[1]*omega[1] + omega[2]*omega[2]); //Re-calculate the norm
-    /*
-    if (norm == 0){
-        omega[0] += 0.01;
-        omega[1] += 0.01;
-        omega[2] += 0.01;
-    }
-    */
-
-    float32_t axis[] = {omega[0], omega[1], omega[2]}; //Find the axis of instantaneous rotation based off of  gyro measurements.
-    axis[0] /= norm;
-    axis[1] /= norm;
-    axis[2] /= norm;
+    float32_t half_step = 0.5f * rocket_atd->time_step;
+    float32_t hx = half_step * rocket_atd->gyro_x;
+    float32_t hy = half_step * rocket_atd->gyro_y;
+    float32_t hz = half_step * rocket_atd->gyro_z;
+    float32_t a2 = hx * hx + hy * hy + hz * hz; //Square of the half-angle rotated through this step
 
-    float32_t angle = rocket_atd->time_step * norm; //Find the angle that the rocket rotates about the axis of instantaneous rotation.
+    float32_t half_cos, half_sinc;
+    if (a2 <= ATTITUDE_SERIES_MAX_HALF_ANGLE * ATTITUDE_SERIES_MAX_HALF_ANGLE) {
+        half_cos = 1.0f - a2 * (0.5f - a2 * (1.0f / 24.0f));
+        half_sinc = 1.0f - a2 * ((1.0f / 6.0f) - a2 * (1.0f / 120.0f));
+    } else {
+        float32_t a = sqrtf(a2);
+        float32_t half_sin;
+        trig_sincos(a, &half_sin, &half_cos);
+        half_sinc = half_sin / a;
+    }
 
-    rocket_atd->q_delt_s = cos(angle / 2.0f); //Definition of quaternion elements... simply forming the instantaneous rotation quat from axis-angle representation
-    rocket_atd->q_delt_x = axis[0] * sin(angle/2.0f);
-    rocket_atd->q_delt_y = axis[1] * sin(angle/2.0f);
-    rocket_atd->q_delt_z = axis[2] * sin(angle/2.0f);
+    rocket_atd->q_delt_s = half_cos; //Axis-angle quaternion, the axis times the sine is h times sin(a) / a
+    rocket_atd->q_delt_x = hx * half_sinc;
+    rocket_atd->q_delt_y = hy * half_sinc;
+    rocket_atd->q_delt_z = hz * half_sinc;
 
 }
 
@@ -85,6 +90,8 @@ void gyro_to_rotation_quat(RocketAttitude *rocket_atd){
  * represents the rotation from the North East Down (NED) frame to the rocket's body frame.
  * 
  * @param rocket_atd (struct that attitude estimation system is built out of)
+ * @note The result is renormalized every ATTITUDE_RENORM_PERIOD updates, in between its norm is off 1 by a few float
+ * epsilon at most.
 */
 void quat_update(RocketAttitude *rocket_atd){
 
@@ -107,11 +114,19 @@ void quat_update(RocketAttitude *rocket_atd){
                     + rocket_atd->q_current_z * rocket_atd->q_delt_s
                     + rocket_atd->q_current_x * rocket_atd->q_delt_y
                     - rocket_atd->q_current_y * rocket_atd->q_delt_x;
-    float32_t norm = sqrt(q_new_s * q_new_s + q_new_x * q_new_x + q_new_y * q_new_y + q_new_z * q_new_z);
-    rocket_atd->q_current_s = q_new_s / norm; //Update the values in the attitude estimation struct to reflect the new attitude quaternion.
-    rocket_atd->q_current_x = q_new_x / norm;
-    rocket_atd->q_current_y = q_new_y / norm;
-    rocket_atd->q_current_z = q_new_z / norm;
+    // q_delt is a unit quaternion to float rounding, so the norm only drifts by rounding and is restored periodically
+    if (++rocket_atd->renorm_count >= ATTITUDE_RENORM_PERIOD) {
+        float32_t inv_norm = 1.0f / sqrtf(q_new_s * q_new_s + q_new_x * q_new_x + q_new_y * q_new_y + q_new_z * q_new_z);
+        q_new_s *= inv_norm;
+        q_new_x *= inv_norm;
+        q_new_y *= inv_norm;
+        q_new_z *= inv_norm;
+        rocket_atd->renorm_count = 0;
+    }
+    rocket_atd->q_current_s = q_new_s; //Update the values in the attitude estimation struct to reflect the new attitude quaternion.
+    rocket_atd->q_current_x = q_new_x;
+    rocket_atd->q_current_y = q_new_y;
+    rocket_atd->q_current_z = q_new_z;
 
 }
 /**
@@ -119,28 +134,33 @@ void quat_update(RocketAttitude *rocket_atd){
  * @param rocket_atd (rocket attitude struct)
  * @return None
  * @note This is not strictly necessary as our present control algorithm uses quaternion attitude representation. However, it may be helpful
- * if controls need to be based off of Euler angles or for debugging. 
+ * if controls need to be based off of Euler angles or for debugging. The direction cosines are read from rocket_atd->frame, so
+ * attitude_update_frame() must have run since q_current last changed. Nothing in the cycle reads phi, theta and psi, so they
+ * are only computed here, on request, and only if q_current changed since the last call. Call it before reading them.
 */
 void quat_to_euler_angs(RocketAttitude *rocket_atd){
 
-    float32_t qs = rocket_atd->q_current_s;
-    float32_t qx = rocket_atd->q_current_x;
-    float32_t qy = rocket_atd->q_current_y;
-    float32_t qz = rocket_atd->q_current_z;
+    if (!rocket_atd->euler_stale) {
+        return;
+    }
+    const AttitudeFrame *frame = &rocket_atd->frame;
+
+    float32_t C11 = frame->dcm_t[0][0];
+    float32_t C12 = frame->dcm_t[0][1];
+    float32_t C13 = frame->dcm_t[0][2];
+    float32_t C23 = frame->dcm_t[1][2];
+    float32_t C33 = frame->dcm_t[2][2];
 
-    float32_t C11 = qs*qs + qx*qx - qy*qy - qz*qz;
-    float32_t C12 = 2.0*(qx*qy+qz*qs);
-    float32_t C13 = 2.0*(qx*qz-qy*qs);
-    //float32_tC21 = 2.0*(qx*qy-qz*qs); 
-    //float32_tC22 = qs*qs - qx*qx + qy*qy - qz*qz;
-    float32_t C23 = 2.0*(qy*qz + qx*qs);
-    //float32_tC31 = 2.0*(qx*qz + qy*qs);
-    //float32_tC32 = 2.0*(qy*qz - qx*qs);
-    float32_t C33 = qs*qs - qx*qx - qy*qy + qz*qz;
+    // theta = -asin(C13) as the arctangent of C13 over its cosine, so all three go through the unit in one batch
+    float32_t y[3] = {C23, C13, C12};
+    float32_t x[3] = {C33, sqrtf(fmaxf(0.0f, (1.0f - C13) * (1.0f + C13))), C11};
+    float32_t angles[3];
+    trig_atan2_batch(y, x, angles, 3);
 
-    rocket_atd->phi = (float) atan2((double)C23, (double)C33);
-    rocket_atd->theta = -(float) asin((double)C13);
-    rocket_atd->psi = (float) atan2((double)C12, (double)C11);
+    rocket_atd->phi = angles[0];
+    rocket_atd->theta = -angles[1];
+    rocket_atd->psi = angles[2];
+    rocket_atd->euler_stale = 0;
 
 }
 
@@ -154,5 +174,137 @@ void run_attitude_estimation(RocketAttitude *rocket_atd, float32_t *w){
     set_gyro(rocket_atd, w);
     gyro_to_rotation_quat(rocket_atd);
     quat_update(rocket_atd);
-    quat_to_euler_angs(rocket_atd); //Not necessary to include right now but if not too slow then may still be included
-}
\ No newline at end of file
+    attitude_update_frame(rocket_atd);
+}
+
+/**
+ * @brief Rebuilds the direction cosines and gravity in the body frame from q_current
+ * @param rocket_atd (rocket attitude struct), receives frame, and the euler angles are marked stale
+ * @note Called once per cycle after quat_update(), and again only if a magnetometer correction turned q_current. The flight
+ * EKF stages read rocket_atd->frame rather than the quaternion.
+ */
+void attitude_update_frame(RocketAttitude *rocket_atd) {
+    AttitudeFrame *frame = &rocket_atd->frame;
+    float32_t qs = rocket_atd->q_current_s;
+    float32_t qx = rocket_atd->q_current_x;
+    float32_t qy = rocket_atd->q_current_y;
+    float32_t qz = rocket_atd->q_current_z;
+
+    // The ten distinct products, doubled once
+    float32_t ss = 2.0f * qs * qs;
+    float32_t xx = 2.0f * qx * qx;
+    float32_t yy = 2.0f * qy * qy;
+    float32_t zz = 2.0f * qz * qz;
+    float32_t xy = 2.0f * qx * qy;
+    float32_t xz = 2.0f * qx * qz;
+    float32_t yz = 2.0f * qy * qz;
+    float32_t sx = 2.0f * qs * qx;
+    float32_t sy = 2.0f * qs * qy;
+    float32_t sz = 2.0f * qs * qz;
+
+    frame->dcm[0][0] = ss + xx - 1.0f;
+    frame->dcm[0][1] = xy - sz;
+    frame->dcm[0][2] = xz + sy;
+    frame->dcm[1][0] = xy + sz;
+    frame->dcm[1][1] = ss + yy - 1.0f;
+    frame->dcm[1][2] = yz - sx;
+    frame->dcm[2][0] = xz - sy;
+    frame->dcm[2][1] = yz + sx;
+    frame->dcm[2][2] = ss + zz - 1.0f;
+
+    for (int i = 0; i < 3; i++) {
+        for (int j = 0; j < 3; j++) {
+            frame->dcm_t[j][i] = frame->dcm[i][j];
+        }
+        frame->gravity_body[i] = -ATTITUDE_GRAVITY * frame->dcm[i][0];
+    }
+
+    rocket_atd->euler_stale = 1;
+}
+
+/**
+ * @brief Rotates a body frame vector into the flat frame with the current attitude
+ * @param rocket_atd (rocket attitude struct)
+ * @param body Vector in the body frame
+ * @param flat Receives the vector in the flat frame
+ * @note quat_update() composes the body rate rotation on the right, so q_current takes body vectors to flat ones
+ */
+static void attitude_body_to_flat(const RocketAttitude *rocket_atd, const float32_t *body, float32_t *flat) {
+    const float32_t (*dcm)[3] = rocket_atd->frame.dcm;
+
+    for (int i = 0; i < 3; i++) {
+        flat[i] = dcm[i][0] * body[0] + dcm[i][1] * body[1] + dcm[i][2] * body[2];
+    }
+}
+
+/**
+ * @brief Averages the magnetic field on the pad into the heading reference
+ * @param rocket_atd (rocket attitude struct), receives mag_ref
+ * @param mag Calibrated field in the body frame, Gauss
+ * @note Call while the vehicle sits on the pad and the attitude is the one the flight starts from, every new reading.
+ */
+void attitude_mag_reference(RocketAttitude *rocket_atd, const float32_t *mag) {
+    float32_t flat[3];
+
+    attitude_body_to_flat(rocket_atd, mag, flat);
+    for (int i = 0; i < 3; i++) {
+        rocket_atd->mag_ref[i] = rocket_atd->mag_ref_valid ? rocket_atd->mag_ref[i] + ATTITUDE_MAG_REF_WEIGHT * (flat[i] - rocket_atd->mag_ref[i]) : flat[i];
+    }
+    rocket_atd->mag_ref_norm = sqrtf(rocket_atd->mag_ref[0] * rocket_atd->mag_ref[0] + rocket_atd->mag_ref[1] * rocket_atd->mag_ref[1] + rocket_atd->mag_ref[2] * rocket_atd->mag_ref[2]);
+    rocket_atd->mag_ref_valid = 1;
+}
+
+/**
+ * @brief Complementary heading correction from the magnetometer
+ * @param rocket_atd (rocket attitude struct)
+ * @param mag Calibrated field in the body frame, Gauss
+ * @return 1 if the reading was used
+ * @details The reading is rotated into the flat frame and its horizontal part, across the flat x (up) axis, is compared
+ * with the pad reference. The sine of the angle between them is fed back as a small rotation about the up axis,
+ * ATTITUDE_MAG_GAIN per second, composed on the left of q_current. Tilt is left to the gyros, and a reading whose
+ * strength is off the reference by more than ATTITUDE_MAG_MAX_ERROR is taken as a disturbance and ignored. The small
+ * rotation is applied as its first order quaternion and renormalized, so no trigonometric functions are evaluated.
+ */
+uint8_t attitude_mag_correction(RocketAttitude *rocket_atd, const float32_t *mag) {
+    float32_t flat[3];
+
+    rocket_atd->mag_heading_error = 0.0;
+    if (!rocket_atd->mag_ref_valid) {
+        return 0;
+    }
+
+    float32_t norm = sqrtf(mag[0] * mag[0] + mag[1] * mag[1] + mag[2] * mag[2]);
+    if (fabsf(norm - rocket_atd->mag_ref_norm) > ATTITUDE_MAG_MAX_ERROR * rocket_atd->mag_ref_norm) {
+        return 0;
+    }
+
+    attitude_body_to_flat(rocket_atd, mag, flat);
+    const float32_t *ref = rocket_atd->mag_ref;
+    float32_t horizontal = sqrtf((flat[1] * flat[1] + flat[2] * flat[2]) * (ref[1] * ref[1] + ref[2] * ref[2]));
+    float32_t min_horizontal = ATTITUDE_MAG_MIN_HORIZONTAL * rocket_atd->mag_ref_norm;
+    if (horizontal < min_horizontal * min_horizontal) {
+        return 0;
+    }
+
+    // Up component of flat x ref over both horizontal lengths, positive when a right handed turn about up brings the
+    // reading onto the reference
+    float32_t error = (flat[1] * ref[2] - flat[2] * ref[1]) / horizontal;
+    float32_t half_angle = 0.5f * ATTITUDE_MAG_GAIN * rocket_atd->time_step * error;
+
+    float32_t qs = rocket_atd->q_current_s;
+    float32_t qx = rocket_atd->q_current_x;
+    float32_t qy = rocket_atd->q_current_y;
+    float32_t qz = rocket_atd->q_current_z;
+    float32_t q_new_s = qs - half_angle * qx;
+    float32_t q_new_x = qx + half_angle * qs;
+    float32_t q_new_y = qy - half_angle * qz;
+    float32_t q_new_z = qz + half_angle * qy;
+    float32_t q_norm = sqrtf(q_new_s * q_new_s + q_new_x * q_new_x + q_new_y * q_new_y + q_new_z * q_new_z);
+    rocket_atd->q_current_s = q_new_s / q_norm;
+    rocket_atd->q_current_x = q_new_x / q_norm;
+    rocket_atd->q_current_y = q_new_y / q_norm;
+    rocket_atd->q_current_z = q_new_z / q_norm;
+    rocket_atd->mag_heading_error = error;
+    attitude_update_frame(rocket_atd);
+    return 1;
+}
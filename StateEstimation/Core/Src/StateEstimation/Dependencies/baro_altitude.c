@@ -0,0 +1,82 @@
+/**
+ * @file baro_altitude.c
+ * @brief Pressure to altitude conversion without pow()
+ *
+ * @details Segment i covers p = BARO_ALT_MIN_PA + (i + t) BARO_ALT_STEP_PA
+ *          for t in [0, 1) and holds c0 + c1 t + c2 t^2 + c3 t^3, the cubic
+ *          matching the ISA altitude and its derivative at both ends. The
+ *          coefficients were evaluated in double and rounded to float; the
+ *          interpolation error is largest on the lowest pressure segment,
+ *          about 0.013 m, and below 1 mm above 70 kPa.
+ */
+
+#include "baro_altitude.h"
+
+#define BARO_ALT_STEP_PA 2500.0f
+#define BARO_ALT_SEGMENTS 36
+
+static const float32_t segments[BARO_ALT_SEGMENTS][4] = {
+    {11776.6367f, -774.363159f, 38.9710655f, -2.50137544f},  // 20000 Pa
+    {11038.7432f, -703.92511f, 31.5239658f, -1.82867062f},  // 22500 Pa
+    {10364.5127f, -646.36322f, 26.0722027f, -1.37967181f},  // 25000 Pa
+    {9742.84277f, -598.357849f, 21.954792f, -1.06805336f},  // 27500 Pa
+    {9165.37109f, -557.652405f, 18.764822f, -0.844719231f},  // 30000 Pa
+    {8625.63867f, -522.656921f, 16.2403088f, -0.68029207f},  // 32500 Pa
+    {8118.54199f, -492.217163f, 14.2061768f, -0.556433797f},  // 35000 Pa
+    {7639.97461f, -465.474121f, 12.5417118f, -0.461280525f},  // 37500 Pa
+    {7186.58105f, -441.774536f, 11.1614122f, -0.386917651f},  // 40000 Pa
+    {6755.58105f, -420.612457f, 10.0033045f, -0.327922881f},  // 42500 Pa
+    {6344.64404f, -401.58963f, 9.02154446f, -0.280493885f},  // 45000 Pa
+    {5951.79541f, -384.388031f, 8.18161106f, -0.241908759f},  // 47500 Pa
+    {5575.34717f, -368.750519f, 7.45709324f, -0.210183159f},  // 50000 Pa
+    {5213.84326f, -354.466888f, 6.82749987f, -0.183846444f},  // 52500 Pa
+    {4866.02002f, -341.363434f, 6.27672434f, -0.161792547f},  // 55000 Pa
+    {4530.77197f, -329.295349f, 5.79196358f, -0.143178314f},  // 57500 Pa
+    {4207.125f, -318.140961f, 5.36293125f, -0.127353191f},  // 60000 Pa
+    {3894.21973f, -307.79715f, 4.98128462f, -0.113809608f},  // 62500 Pa
+    {3591.29004f, -298.176025f, 4.64019728f, -0.10214749f},  // 65000 Pa
+    {3297.6521f, -289.202057f, 4.33404016f, -0.0920485035f},  // 67500 Pa
+    {3012.69214f, -280.81012f, 4.0581336f, -0.0832571611f},  // 70000 Pa
+    {2735.85669f, -272.943634f, 3.80856442f, -0.0755667537f},  // 72500 Pa
+    {2466.64624f, -265.553223f, 3.58203578f, -0.0688087717f},  // 75000 Pa
+    {2204.6062f, -258.595551f, 3.37575603f, -0.0628449097f},  // 77500 Pa
+    {1949.32349f, -252.032593f, 3.18734717f, -0.0575608872f},  // 80000 Pa
+    {1700.42078f, -245.830566f, 3.01477289f, -0.0528617203f},  // 82500 Pa
+    {1457.55212f, -239.95961f, 2.85628176f, -0.0486679934f},  // 85000 Pa
+    {1220.40002f, -234.393051f, 2.71035957f, -0.0449129641f},  // 87500 Pa
+    {988.672485f, -229.107071f, 2.57569218f, -0.0415402465f},  // 90000 Pa
+    {762.099548f, -224.080307f, 2.45113397f, -0.0385019854f},  // 92500 Pa
+    {540.431885f, -219.293549f, 2.33568311f, -0.0357573666f},  // 95000 Pa
+    {323.438232f, -214.729446f, 2.22845936f, -0.0332714505f},  // 97500 Pa
+    {110.903984f, -210.372345f, 2.1286881f, -0.0310142003f},  // 100000 Pa
+    {-97.370697f, -206.208023f, 2.03568363f, -0.0289596859f},  // 102500 Pa
+    {-301.571991f, -202.223526f, 1.94883859f, -0.0270854514f},  // 105000 Pa
+    {-501.873749f, -198.407104f, 1.8676126f, -0.0253719743f},  // 107500 Pa
+};
+
+/**
+ * @brief Converts a barometer reading to altitude
+ * @param pressure Static pressure in Pa, as from MS5607GetPressurePa()
+ * @param slope Receives dh/dp in m/Pa if not NULL, for converting pressure
+ *        noise to altitude noise
+ * @return ISA altitude in m above the 101325 Pa level
+ */
+float32_t baro_altitude(float32_t pressure, float32_t *slope) {
+    float32_t u = (pressure - BARO_ALT_MIN_PA) * (1.0f / BARO_ALT_STEP_PA);
+    int32_t i = (int32_t)u;
+
+    // Also keeps a NaN or negative reading inside the table
+    if (!(u >= 0.0f)) {
+        i = 0;
+    } else if (i >= BARO_ALT_SEGMENTS) {
+        i = BARO_ALT_SEGMENTS - 1;
+    }
+
+    const float32_t *c = segments[i];
+    float32_t t = u - (float32_t)i;
+
+    if (slope != NULL) {
+        *slope = (c[1] + t * (2.0f * c[2] + t * 3.0f * c[3])) * (1.0f / BARO_ALT_STEP_PA);
+    }
+    return c[0] + t * (c[1] + t * (c[2] + t * c[3]));
+}
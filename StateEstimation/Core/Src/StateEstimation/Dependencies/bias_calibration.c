@@ -0,0 +1,200 @@
+/**
+ * @file bias_calibration.c
+ * @brief Streaming accelerometer and gyro bias calibration on the pad
+ *
+ * @details The estimates are the plain means of the raw readings. They are
+ *          handed to the flight code less the reading of an upright vehicle
+ *          at rest, as the ground EKF's -9.81 offset on x did, and with the
+ *          sign update_ekf() applies. The convergence test runs once per
+ *          block, so a sample costs a Welford step and one addition per
+ *          channel.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "attitude.h"
+#include "bias_calibration.h"
+
+static const float32_t bias_cal_bound[BIAS_CAL_CHANNELS] = {
+    BIAS_CAL_ACCEL_BOUND, BIAS_CAL_ACCEL_BOUND, BIAS_CAL_ACCEL_BOUND,
+    BIAS_CAL_GYRO_BOUND, BIAS_CAL_GYRO_BOUND, BIAS_CAL_GYRO_BOUND,
+};
+
+static const float32_t bias_cal_var_floor[BIAS_CAL_CHANNELS] = {
+    BIAS_CAL_ACCEL_VAR_FLOOR, BIAS_CAL_ACCEL_VAR_FLOOR, BIAS_CAL_ACCEL_VAR_FLOOR,
+    BIAS_CAL_GYRO_VAR_FLOOR, BIAS_CAL_GYRO_VAR_FLOOR, BIAS_CAL_GYRO_VAR_FLOOR,
+};
+
+// Readings of an upright vehicle at rest, the attitude the flight EKF starts
+// from: the specific force is gravity, up the x axis
+static const float32_t bias_cal_pad_reading[BIAS_CAL_CHANNELS] = {
+    ATTITUDE_GRAVITY, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f,
+};
+
+// update_ekf() and the packet add the x accelerometer bias, subtract the rest
+static const float32_t bias_cal_sign[BIAS_CAL_CHANNELS] = {
+    -1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f,
+};
+
+static void bias_calibrator_restart(BiasCalibrator *cal) {
+    uint32_t restarts = cal->restarts;
+
+    memset(cal, 0, sizeof(*cal));
+    cal->restarts = restarts;
+    // Same starting uncertainty the ground EKF reported from P_init_ground
+    for (int i = 0; i < BIAS_CAL_CHANNELS; i++) {
+        cal->mean_var[i] = 1.0f;
+    }
+}
+
+/**
+ * @brief Resets the calibrator, call on entering GROUND
+ * @param cal Calibrator state
+ */
+void bias_calibrator_init(BiasCalibrator *cal) {
+    cal->restarts = 0;
+    bias_calibrator_restart(cal);
+}
+
+/**
+ * @brief Closes an Allan block and re-evaluates the confidence bounds
+ * @param cal Calibrator state
+ * @return 1 if every channel is within its bound
+ */
+static uint8_t bias_calibrator_checkpoint(BiasCalibrator *cal) {
+    uint8_t converged = cal->blocks + 1 >= BIAS_CAL_MIN_BLOCKS;
+    uint8_t moved = 0;
+
+    for (int i = 0; i < BIAS_CAL_CHANNELS; i++) {
+        float32_t block_mean = cal->block_sum[i] / BIAS_CAL_BLOCK;
+        if (cal->blocks > 0) {
+            float32_t d = block_mean - cal->prev_block_mean[i];
+            cal->allan_sum[i] += d * d;
+        }
+        cal->prev_block_mean[i] = block_mean;
+        cal->block_sum[i] = 0.0f;
+
+        float32_t var = cal->m2[i] / (cal->n - 1);
+        if (var < bias_cal_var_floor[i]) {
+            var = bias_cal_var_floor[i];
+        }
+
+        float32_t effective_var = var;
+        if (cal->blocks > 0) {
+            float32_t allan_var = cal->allan_sum[i] / (2.0f * cal->blocks);
+            float32_t white_equivalent = BIAS_CAL_BLOCK * allan_var;
+            if (white_equivalent > BIAS_CAL_MAX_ALLAN_RATIO * var) {
+                moved = 1;
+            }
+            if (white_equivalent > effective_var) {
+                effective_var = white_equivalent;
+            }
+        }
+
+        cal->mean_var[i] = effective_var / cal->n;
+        if (BIAS_CAL_Z * BIAS_CAL_Z * cal->mean_var[i] > bias_cal_bound[i] * bias_cal_bound[i]) {
+            converged = 0;
+        }
+    }
+
+    cal->blocks++;
+    cal->block_n = 0;
+
+    if (moved) {
+        cal->restarts++;
+        bias_calibrator_restart(cal);
+        return 0;
+    }
+    return converged;
+}
+
+/**
+ * @brief Adds one IMU sample
+ * @param cal Calibrator state
+ * @param sensors Latest readings, with the biases still zero
+ * @return 1 once the bias estimates are within their confidence bounds
+ */
+uint8_t bias_calibrator_update(BiasCalibrator *cal, const Sensors *sensors) {
+    const float32_t x[BIAS_CAL_CHANNELS] = {
+        sensors->accel_x, sensors->accel_y, sensors->accel_z,
+        sensors->gyro_x, sensors->gyro_y, sensors->gyro_z,
+    };
+
+    if (cal->converged) {
+        return 1;
+    }
+
+    cal->n++;
+    for (int i = 0; i < BIAS_CAL_CHANNELS; i++) {
+        float32_t delta = x[i] - cal->mean[i];
+        cal->mean[i] += delta / cal->n;
+        cal->m2[i] += delta * (x[i] - cal->mean[i]);
+        cal->block_sum[i] += x[i];
+    }
+
+    if (++cal->block_n == BIAS_CAL_BLOCK) {
+        cal->converged = bias_calibrator_checkpoint(cal);
+    }
+    return cal->converged;
+}
+
+/**
+ * @brief Converts the estimates to the biases the flight code expects
+ * @param cal Calibrator state
+ * @param bias Receives accel x, y, z and gyro x, y, z, so that update_ekf()
+ *             gives zero specific force and rate on the pad
+ */
+void bias_calibrator_biases(const BiasCalibrator *cal, float32_t *bias) {
+    for (int i = 0; i < BIAS_CAL_CHANNELS; i++) {
+        bias[i] = bias_cal_sign[i] * (cal->mean[i] - bias_cal_pad_reading[i]);
+    }
+}
+
+/**
+ * @brief Stores the estimates where the flight code expects them
+ * @param cal Converged calibrator
+ * @param sensors Receives accel_bias_* and gyro_bias_*
+ */
+void bias_calibrator_apply(const BiasCalibrator *cal, Sensors *sensors) {
+    float32_t bias[BIAS_CAL_CHANNELS];
+
+    bias_calibrator_biases(cal, bias);
+    sensors->accel_bias_x = bias[0];
+    sensors->accel_bias_y = bias[1];
+    sensors->accel_bias_z = bias[2];
+    sensors->gyro_bias_x = bias[3];
+    sensors->gyro_bias_y = bias[4];
+    sensors->gyro_bias_z = bias[5];
+}
+
+/**
+ * @brief Checks stored biases against the samples taken so far
+ * @param cal Calibrator state
+ * @param bias Stored bias of each channel, as bias_calibrator_biases() gives
+ * @param mean_var Variance of each stored bias
+ * @return 1 once a block is in and every channel is within its bound of the
+ *         stored bias, widened by BIAS_CAL_Z standard errors of both
+ * @details Only the sample variance is used, one block is too short for the
+ *          Allan check. Both are taken against an upright vehicle, so it
+ *          must also sit as it did when the biases were stored.
+ */
+uint8_t bias_calibrator_agrees(const BiasCalibrator *cal, const float32_t *bias, const float32_t *mean_var) {
+    float32_t current[BIAS_CAL_CHANNELS];
+
+    bias_calibrator_biases(cal, current);
+    if (cal->blocks == 0) {
+        return 0;
+    }
+    for (int i = 0; i < BIAS_CAL_CHANNELS; i++) {
+        float32_t var = cal->m2[i] / (cal->n - 1);
+        if (var < bias_cal_var_floor[i]) {
+            var = bias_cal_var_floor[i];
+        }
+        float32_t tolerance = bias_cal_bound[i] + BIAS_CAL_Z * sqrtf(var / cal->n + mean_var[i]);
+        if (fabsf(current[i] - bias[i]) > tolerance) {
+            return 0;
+        }
+    }
+    return 1;
+}
@@ -10,33 +10,126 @@
 
 #include "data_handling.h"
 
-static uint8_t serial_buffer_a[81];
-static uint8_t serial_buffer_b[81];
-static uint8_t sensors_buffer_a[37];
-static uint8_t sensors_buffer_b[37];
+// A state frame is the sensors block followed by the serial block, sent as one DMA transfer
+#define SENSORS_BLOCK_BYTES 49
+#define SERIAL_BLOCK_BYTES 109
+DMA_BUFFER static uint8_t frame_buffer_a[SENSORS_BLOCK_BYTES + SERIAL_BLOCK_BYTES];
+DMA_BUFFER static uint8_t frame_buffer_b[SENSORS_BLOCK_BYTES + SERIAL_BLOCK_BYTES];
+DMA_BUFFER static uint8_t event_buffer[EVENT_FRAME_BYTES];
 static volatile bool buffer_a_in_use = false;
 static volatile bool transmit_complete = true;
+static volatile uint32_t transmit_done_us = -LINK_GAP_US;   // free from the start
+static FlightEvent event_pending[EVENT_QUEUE];
+static uint8_t event_pending_count;
+static uint8_t event_sequence;
+static uint8_t event_line_high;
+static uint32_t event_line_ms;
+
+/**
+ * @brief Whether a frame can go out on the link now
+ * @return 1 once the last frame is out and the line has been idle for LINK_GAP_US
+ */
+static bool link_free(void) {
+    return transmit_complete && sensor_time_us() - transmit_done_us >= LINK_GAP_US;
+}
+
+/**
+ * @brief CRC-8 of an event frame, polynomial 0xE7 as the MainMCU's calculate_crc8_hash()
+ */
+static uint8_t event_frame_crc(const uint8_t *data, size_t len) {
+    uint8_t crc = 0;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= data[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc & 0x80) ? (uint8_t)((crc << 1) ^ 0xE7) : (uint8_t)(crc << 1);
+        }
+    }
+    return crc;
+}
+
+/**
+ * @brief Raises a flight event to the MainMCU
+ * @param event Event from the event detector
+ * @details Sets the event line at once and queues the event frame, which
+ *          event_link_poll() sends ahead of the next state frame.
+ */
+void signal_event(const FlightEvent *event) {
+    HAL_GPIO_WritePin(EVENT_LINE_PORT, EVENT_LINE_PIN, GPIO_PIN_SET);
+    event_line_high = 1;
+    event_line_ms = HAL_GetTick();
+    if (event_pending_count < EVENT_QUEUE) {
+        event_pending[event_pending_count++] = *event;
+    }
+}
+
+/**
+ * @brief Sends a queued event frame and releases the event line
+ * @param huart UART handle to the MainMCU, the one log_data() uses
+ * @details Call on every main loop pass. The 16 byte frame:
+ *
+ *            0      EVENT_FRAME_SYNC
+ *            1      FlightEventId
+ *            2      sequence number
+ *            3-6    uint32 event time, us on the sensor_time_us() timeline
+ *            7-10   int32 us from the event time to sending, negative for an
+ *                   apogee still ahead
+ *            11-14  float32 FlightEvent.value
+ *            15     CRC-8 of bytes 0-14
+ *
+ *          The line drops once no frame is queued and it has been high for
+ *          EVENT_LINE_MS.
+ */
+void event_link_poll(UART_HandleTypeDef *huart) {
+    if (event_pending_count && link_free()) {
+        const FlightEvent *event = &event_pending[0];
+        int32_t age_us = (int32_t)(sensor_time_us() - event->time_us);
+
+        event_buffer[0] = EVENT_FRAME_SYNC;
+        event_buffer[1] = event->id;
+        event_buffer[2] = event_sequence;
+        memcpy(&event_buffer[3], &event->time_us, sizeof(uint32_t));
+        memcpy(&event_buffer[7], &age_us, sizeof(int32_t));
+        memcpy(&event_buffer[11], &event->value, sizeof(float32_t));
+        event_buffer[15] = event_frame_crc(event_buffer, EVENT_FRAME_BYTES - 1);
+        transmit_complete = false;
+        dma_clean(event_buffer, sizeof(event_buffer));
+        if (HAL_UART_Transmit_DMA(huart, event_buffer, sizeof(event_buffer)) != HAL_OK) {
+            transmit_complete = true;
+            return;
+        }
+        event_sequence++;
+        event_pending_count--;
+        memmove(event_pending, &event_pending[1], event_pending_count * sizeof(FlightEvent));
+    }
+    if (event_line_high && !event_pending_count && HAL_GetTick() - event_line_ms >= EVENT_LINE_MS) {
+        HAL_GPIO_WritePin(EVENT_LINE_PORT, EVENT_LINE_PIN, GPIO_PIN_RESET);
+        event_line_high = 0;
+    }
+}
 
 /**
  * @brief Log serial data and sensor readings using DMA
  * @param serial_data Pointer to the SerialData structure containing the serial data
  * @param sensors Pointer to the Sensors structure containing sensor readings
  * @param huart UART handle to send data through
- * @details Uses double buffering and DMA for efficient transmission
+ * @details Uses double buffering and DMA for efficient transmission. The
+ *          sensors and serial blocks share one buffer and go out as a single
+ *          transfer. Skipped while an event frame is waiting, which goes first.
  */
 void log_data(SerialData *serial_data, Sensors *sensors, UART_HandleTypeDef* huart) {
     // Wait if previous transfer is still in progress
-    if (!transmit_complete) {
+    if (!link_free() || event_pending_count) {
         return;
     }
 
-    // Select the inactive buffer pair
-    uint8_t *current_serial_buffer = buffer_a_in_use ? serial_buffer_b : serial_buffer_a;
-    uint8_t *current_sensors_buffer = buffer_a_in_use ? sensors_buffer_b : sensors_buffer_a;
+    // Select the inactive buffer
+    uint8_t *current_frame_buffer = buffer_a_in_use ? frame_buffer_b : frame_buffer_a;
+    uint8_t *current_sensors_buffer = current_frame_buffer;
+    uint8_t *current_serial_buffer = current_frame_buffer + SENSORS_BLOCK_BYTES;
     buffer_a_in_use = !buffer_a_in_use;
 
     // Prepare sensor data
-    float32_t compensated_values[9];
+    float32_t compensated_values[12];
     compensated_values[0] = sensors->accel_x + sensors->accel_bias_x;
     compensated_values[1] = sensors->accel_y - sensors->accel_bias_y;
     compensated_values[2] = sensors->accel_z - sensors->accel_bias_z;
@@ -46,10 +139,13 @@ void log_data(SerialData *serial_data, Sensors *sensors, UART_HandleTypeDef* hua
     compensated_values[6] = sensors->gps_x;
     compensated_values[7] = sensors->gps_y;
     compensated_values[8] = sensors->gps_z;
+    compensated_values[9] = (sensors->mag_x - sensors->mag_offset_x) * sensors->mag_scale_x;
+    compensated_values[10] = (sensors->mag_y - sensors->mag_offset_y) * sensors->mag_scale_y;
+    compensated_values[11] = (sensors->mag_z - sensors->mag_offset_z) * sensors->mag_scale_z;
 
     // Fill sensors buffer
     memcpy(&current_sensors_buffer[0], &sensors->start_byte, sizeof(uint8_t));
-    for (int i = 0; i < 9; i++) {
+    for (int i = 0; i < 12; i++) {
         memcpy(&current_sensors_buffer[1 + i * 4], &compensated_values[i], 4);
     }
 
@@ -107,20 +203,49 @@ void log_data(SerialData *serial_data, Sensors *sensors, UART_HandleTypeDef* hua
     //Time stamp
     offset += sizeof(float32_t);
     memcpy(&current_serial_buffer[offset], &serial_data->t, sizeof(float32_t));
+    offset += sizeof(float32_t);
+
+    // Flight EKF health
+    memcpy(&current_serial_buffer[offset], &serial_data->health.nis_avg, sizeof(float32_t));
+    offset += sizeof(float32_t);
+    memcpy(&current_serial_buffer[offset], &serial_data->health.cov_trace, sizeof(float32_t));
+    offset += sizeof(float32_t);
+    memcpy(&current_serial_buffer[offset], &serial_data->health.accepted, sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+    memcpy(&current_serial_buffer[offset], &serial_data->health.rejected, sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+    memcpy(&current_serial_buffer[offset], &serial_data->health.flags, sizeof(uint8_t));
+    offset += sizeof(uint8_t);
+
+    // Vibration spectrum summary
+    memcpy(&current_serial_buffer[offset], &serial_data->vibration, sizeof(VibrationRecord));
+    offset += sizeof(VibrationRecord);
+
+    // Sensor fault states
+    memcpy(&current_serial_buffer[offset], &serial_data->sensor_faults, sizeof(uint16_t));
+    offset += sizeof(uint16_t);
+
+    // Adapted GNSS noise
+    memcpy(&current_serial_buffer[offset], &serial_data->gnss_r_scale, sizeof(uint8_t));
+
+    // The UART takes one DMA transfer at a time, a second one before TxCplt is HAL_BUSY
     transmit_complete = false;
-    HAL_StatusTypeDef result = HAL_UART_Transmit_DMA(huart, current_sensors_buffer, sizeof(sensors_buffer_a));
-    if (result == HAL_OK) {
-        result = HAL_UART_Transmit_DMA(huart, current_serial_buffer, sizeof(serial_buffer_a));
-    } else {
-        transmit_complete = true; 
+    dma_clean(current_frame_buffer, sizeof(frame_buffer_a));
+    if (HAL_UART_Transmit_DMA(huart, current_frame_buffer, sizeof(frame_buffer_a)) != HAL_OK) {
+        transmit_complete = true;
     }
 }
 
 /**
  * @brief DMA transfer complete callback
  * @param huart Pointer to UART handle
- * @details Handles buffer switching and triggers next transmission if data is pending
+ * @details Handles buffer switching and triggers next transmission if data is pending.
+ *          UART4 carries the GNSS configuration frames, not the log.
  */
 void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+    if (huart->Instance == UART4) {
+        return;
+    }
+    transmit_done_us = sensor_time_us();
     transmit_complete = true;
 }
\ No newline at end of file
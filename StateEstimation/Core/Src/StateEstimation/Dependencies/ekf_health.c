@@ -0,0 +1,129 @@
+/**
+ * @file ekf_health.c
+ * @brief Innovation gating and health monitor for the flight EKF
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "ekf_health.h"
+
+// Chi-square quantiles at 99.9% for 1 to 6 degrees of freedom
+static const float32_t chi2_999[] = {10.83f, 13.82f, 16.27f, 18.47f, 20.52f, 22.46f};
+
+/**
+ * @brief Clears the counters and flags
+ * @param health Monitor to reset
+ */
+void ekf_health_init(EkfHealth *health) {
+    memset(health, 0, sizeof(*health));
+}
+
+/**
+ * @brief Default NIS gate for a measurement
+ * @param dof Measurement dimension, 1 to 6
+ * @return The 99.9% chi-square quantile, so about one good update in a
+ *         thousand is rejected
+ */
+float32_t ekf_chi2_gate(uint16_t dof) {
+    const uint16_t n = sizeof(chi2_999) / sizeof(chi2_999[0]);
+
+    if (dof == 0) {
+        return 0.0f;
+    }
+    return chi2_999[(dof > n ? n : dof) - 1];
+}
+
+/**
+ * @brief Normalized innovation squared
+ * @param innovation z - h, nz elements
+ * @param S_inv Inverse innovation covariance, nz x nz row major
+ * @param nz Measurement dimension
+ * @return y' S^-1 y
+ */
+float32_t ekf_nis(const float32_t *innovation, const float32_t *S_inv, uint16_t nz) {
+    float32_t nis = 0.0f;
+
+    for (uint16_t i = 0; i < nz; i++) {
+        float32_t row = 0.0f;
+        for (uint16_t j = 0; j < nz; j++) {
+            row += S_inv[i * nz + j] * innovation[j];
+        }
+        nis += innovation[i] * row;
+    }
+    return nis;
+}
+
+/**
+ * @brief Decides whether to apply an update and records the outcome
+ * @param health Monitor to update
+ * @param nis Normalized innovation squared of the update
+ * @param gate Largest NIS accepted
+ * @return 1 to apply the update, 0 to skip it
+ * @details A NaN NIS is rejected. After EKF_MAX_CONSECUTIVE_REJECTS rejections
+ *          in a row the next update is applied anyway, since a real jump or
+ *          an overconfident covariance would otherwise lock out every
+ *          measurement for good.
+ */
+uint8_t ekf_health_gate(EkfHealth *health, float32_t nis, float32_t gate) {
+    uint8_t accept = nis <= gate;
+
+    health->nis = nis;
+    if (isfinite(nis)) {
+        health->nis_avg += EKF_NIS_AVG_WEIGHT * (nis - health->nis_avg);
+    }
+
+    if (!accept && health->consecutive_rejects >= EKF_MAX_CONSECUTIVE_REJECTS && isfinite(nis)) {
+        health->flags |= EKF_HEALTH_GATE_FORCED;
+        accept = 1;
+    }
+
+    if (accept) {
+        health->consecutive_rejects = 0;
+        if (health->accepted < UINT16_MAX) {
+            health->accepted++;
+        }
+    } else {
+        if (health->consecutive_rejects < UINT8_MAX) {
+            health->consecutive_rejects++;
+        }
+        if (health->rejected < UINT16_MAX) {
+            health->rejected++;
+        }
+    }
+    return accept;
+}
+
+/**
+ * @brief Checks the state and covariance after a step
+ * @param health Monitor to update
+ * @param x State, nx elements
+ * @param P Covariance, nx x nx row major
+ * @param nx State dimension
+ * @details Looks at the diagonal and the 2x2 blocks of neighbouring states,
+ *          which hold the position and velocity pairs of the flight EKF.
+ *          Positive variances and minors are necessary for a positive
+ *          definite P, not sufficient, but catch the usual failures at O(n).
+ */
+void ekf_health_check(EkfHealth *health, const float32_t *x, const float32_t *P, uint16_t nx) {
+    float32_t trace = 0.0f;
+
+    for (uint16_t i = 0; i < nx; i++) {
+        float32_t var = P[i * nx + i];
+
+        if (!isfinite(x[i]) || !isfinite(var)) {
+            health->flags |= EKF_HEALTH_NON_FINITE;
+        }
+        if (!(var > 0.0f)) {
+            health->flags |= EKF_HEALTH_NOT_POS_DEF;
+        }
+        if (i % 2 == 1) {
+            float32_t cov = P[(i - 1) * nx + i];
+            if (!(P[(i - 1) * nx + i - 1] * var > cov * cov)) {
+                health->flags |= EKF_HEALTH_NOT_POS_DEF;
+            }
+        }
+        trace += var;
+    }
+    health->cov_trace = trace;
+}
@@ -0,0 +1,212 @@
+/**
+ * @file event_detector.c
+ * @brief Launch, burnout and apogee detection on the raw IMU and barometer samples
+ *
+ * @details The alpha-beta filter predicts with the climb rate alone up to
+ *          burnout, thrust and drag being unknown, and with gravity added
+ *          after it, so that the coast, the part the apogee prediction needs,
+ *          is tracked with the lag of the drag only.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "event_detector.h"
+
+#define EVENT_PI 3.14159265358979f
+
+#define EVENT_RAISED(det, id) ((det)->raised & (1u << (id)))
+
+// Queues an event, dropping it if the caller has not kept up
+static void event_raise(EventDetector *det, uint8_t id, uint32_t time_us, uint32_t detect_us, float32_t value) {
+    det->raised |= 1u << id;
+    if (det->queue_count >= EVENT_QUEUE) {
+        det->dropped++;
+        return;
+    }
+    FlightEvent *event = &det->queue[(det->queue_head + det->queue_count) % EVENT_QUEUE];
+    event->id = id;
+    event->time_us = time_us;
+    event->detect_us = detect_us;
+    event->value = value;
+    det->queue_count++;
+}
+
+/**
+ * @brief Starts with nothing raised, disarmed and with no pad value
+ * @param det Detector to initialize
+ * @param sample_rate Hz, of the samples event_detector_push() gets
+ */
+void event_detector_init(EventDetector *det, float32_t sample_rate) {
+    memset(det, 0, sizeof(EventDetector));
+    det->dt = 1.0f / sample_rate;
+    det->accel_gain = 1.0f - expf(-2.0f * EVENT_PI * EVENT_ACCEL_CUTOFF * det->dt);
+    det->pad_gain = 1.0f - expf(-det->dt / EVENT_PAD_TAU);
+}
+
+/**
+ * @brief Allows or stops launch detection
+ * @param det Detector
+ * @param armed 1 from ARMED on, 0 to ignore handling on the ground
+ * @details Burnout and apogee follow a detected launch whatever this says.
+ */
+void event_detector_arm(EventDetector *det, uint8_t armed) {
+    det->armed = armed;
+    det->run = 0;
+}
+
+// One raw sample of the axial channel, in m/s^2 as read
+static void event_sample(EventDetector *det, float32_t raw, uint32_t time_us) {
+    uint8_t launched = EVENT_RAISED(det, EVENT_LAUNCH) != 0;
+
+    if (!det->pad_valid) {
+        det->pad = raw;
+        det->accel = fabsf(raw);
+        det->pad_valid = 1;
+    } else if (!launched && det->run == 0) {
+        det->pad += det->pad_gain * (raw - det->pad);
+    }
+    float32_t force = det->pad < 0.0f ? -raw : raw;
+    det->accel += det->accel_gain * (force - det->accel);
+
+    float32_t oldest = det->filled == EVENT_JERK_SPAN ? det->history[det->head] : det->accel;
+    det->history[det->head] = det->accel;
+    det->head = (det->head + 1) % EVENT_JERK_SPAN;
+    if (det->filled < EVENT_JERK_SPAN) {
+        det->filled++;
+    }
+    float32_t jerk = (det->accel - oldest) / (det->filled * det->dt);
+    if (!launched && jerk > EVENT_LAUNCH_JERK && det->jerk <= EVENT_LAUNCH_JERK) {
+        det->onset_us = time_us;
+        det->onset_valid = 1;
+    }
+    det->jerk = jerk;
+    det->last_us = time_us;
+
+    if (!launched) {
+        if (!det->armed || det->accel - fabsf(det->pad) <= EVENT_LAUNCH_ACCEL) {
+            det->run = 0;
+            return;
+        }
+        if (det->run++ == 0) {
+            det->run_us = time_us;
+        }
+        if (det->run < EVENT_LAUNCH_SAMPLES) {
+            return;
+        }
+        uint32_t launch_us = det->run_us;
+        if (det->onset_valid && (int32_t)(det->run_us - det->onset_us) >= 0 &&
+            det->run_us - det->onset_us <= EVENT_ONSET_WINDOW_US) {
+            launch_us = det->onset_us;
+        }
+        det->launch_us = launch_us;
+        det->launch_alt = det->alt;
+        det->run = 0;
+        event_raise(det, EVENT_LAUNCH, launch_us, time_us, det->accel - fabsf(det->pad));
+        return;
+    }
+
+    if (EVENT_RAISED(det, EVENT_BURNOUT) || time_us - det->launch_us < EVENT_MIN_BURN_US) {
+        return;
+    }
+    if (det->accel >= EVENT_BURNOUT_ACCEL) {
+        det->run = 0;
+        return;
+    }
+    if (det->run++ == 0) {
+        det->run_us = time_us;
+        det->run_fast = jerk < -EVENT_BURNOUT_JERK;
+    }
+    if (det->run < (det->run_fast ? EVENT_BURNOUT_FAST_SAMPLES : EVENT_BURNOUT_SAMPLES)) {
+        return;
+    }
+    det->burnout_us = det->run_us;
+    det->run = 0;
+    event_raise(det, EVENT_BURNOUT, det->run_us, time_us, det->accel);
+}
+
+/**
+ * @brief Takes a block of raw IMU samples
+ * @param det Detector
+ * @param block Raw counts, channel major as in ImuPipeline.block
+ * @param n Samples per channel
+ * @param time_us Local time of the last sample, the samples are taken as
+ *        evenly spaced before it
+ */
+void event_detector_push(EventDetector *det, const int16_t block[][IMU_PIPELINE_MAX_DECIMATION], uint16_t n,
+                         uint32_t time_us) {
+    uint32_t dt_us = (uint32_t)lroundf(det->dt * 1e6f);
+
+    for (uint16_t i = 0; i < n; i++) {
+        uint32_t sample_us = time_us - (uint32_t)(n - 1 - i) * dt_us;
+        event_sample(det, (float32_t)block[EVENT_AXIS_CHANNEL][i] * IMU_PIPELINE_ACCEL_LSB, sample_us);
+    }
+}
+
+/**
+ * @brief Takes a new barometric altitude
+ * @param det Detector
+ * @param altitude m, from baro_altitude()
+ * @param time_us Local time of the reading
+ * @details Pass each reading once, a repeated one pulls the climb rate
+ *          towards zero.
+ */
+void event_detector_baro(EventDetector *det, float32_t altitude, uint32_t time_us) {
+    if (!det->baro_valid) {
+        det->alt = altitude;
+        det->vel = 0.0f;
+        det->baro_us = time_us;
+        det->baro_valid = 1;
+        return;
+    }
+    float32_t dt = (float32_t)(int32_t)(time_us - det->baro_us) * 1e-6f;
+    if (dt <= 0.0f) {
+        return;
+    }
+    det->baro_us = time_us;
+
+    uint8_t coasting = EVENT_RAISED(det, EVENT_BURNOUT) != 0;
+    float32_t g = coasting ? EVENT_GRAVITY : 0.0f;
+    float32_t alt = det->alt + det->vel * dt - 0.5f * g * dt * dt;
+    float32_t vel = det->vel - g * dt;
+    float32_t r = altitude - alt;
+    det->alt = alt + EVENT_BARO_ALPHA * r;
+    det->vel = vel + EVENT_BARO_BETA / dt * r;
+
+    if (!EVENT_RAISED(det, EVENT_LAUNCH) || EVENT_RAISED(det, EVENT_APOGEE)) {
+        return;
+    }
+    uint32_t since = coasting ? time_us - det->burnout_us : time_us - det->launch_us;
+    if (since < (coasting ? EVENT_APOGEE_LOCKOUT_US : EVENT_MAX_BURN_US)) {
+        return;
+    }
+    float32_t to_apogee = det->vel / EVENT_GRAVITY;
+    if (to_apogee > EVENT_APOGEE_LEAD_S || det->alt - det->launch_alt < EVENT_APOGEE_MIN_GAIN) {
+        det->apogee_run = 0;
+        return;
+    }
+    if (++det->apogee_run < EVENT_APOGEE_SAMPLES) {
+        return;
+    }
+    float32_t height = det->alt - det->launch_alt;
+    if (to_apogee > 0.0f) {
+        height += 0.5f * det->vel * to_apogee;
+    }
+    event_raise(det, EVENT_APOGEE, time_us + (uint32_t)(int32_t)lroundf(to_apogee * 1e6f), time_us, height);
+}
+
+/**
+ * @brief Takes the oldest event not yet taken
+ * @param det Detector
+ * @param event Receives it
+ * @return 1 if there was one
+ */
+uint8_t event_detector_pop(EventDetector *det, FlightEvent *event) {
+    if (det->queue_count == 0) {
+        return 0;
+    }
+    *event = det->queue[det->queue_head];
+    det->queue_head = (det->queue_head + 1) % EVENT_QUEUE;
+    det->queue_count--;
+    return 1;
+}
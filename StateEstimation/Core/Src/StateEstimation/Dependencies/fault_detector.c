@@ -0,0 +1,248 @@
+/**
+ * @file fault_detector.c
+ * @brief Stuck, saturated and spiking sensor detection with a quantized CMSIS-NN model
+ *
+ * @details The layers use the q7 fixed point of CMSIS-NN: each fully connected
+ *          layer adds its bias shifted left by its bias shift to the products,
+ *          rounds, shifts right by its output shift and saturates to q7. The
+ *          shifts come with the weights from fault_model.h.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "fault_detector.h"
+#include "fault_model.h"
+
+static const q7_t fault_w1[FAULT_HIDDEN * FAULT_INPUTS] = FAULT_MODEL_W1;
+static const q7_t fault_b1[FAULT_HIDDEN] = FAULT_MODEL_B1;
+static const q7_t fault_w2[FAULT_CLASSES * FAULT_HIDDEN] = FAULT_MODEL_W2;
+static const q7_t fault_b2[FAULT_CLASSES] = FAULT_MODEL_B2;
+
+// Raw ADIS16500 counts, the MS5607 in Pa over its 10 to 1200 mbar and the GNSS height in m
+static const FaultChannelConfig fault_default_cfg[FAULT_CHANNELS] = {
+    [FAULT_GYRO_X] = {1.0f, 0.0f, 20000.0f},    // +-2000 deg/s at IMU_PIPELINE_GYRO_LSB
+    [FAULT_GYRO_Y] = {1.0f, 0.0f, 20000.0f},
+    [FAULT_GYRO_Z] = {1.0f, 0.0f, 20000.0f},
+    [FAULT_ACCEL_X] = {1.0f, 0.0f, 32000.0f},   // +-392 m/s^2 at IMU_PIPELINE_ACCEL_LSB
+    [FAULT_ACCEL_Y] = {1.0f, 0.0f, 32000.0f},
+    [FAULT_ACCEL_Z] = {1.0f, 0.0f, 32000.0f},
+    [FAULT_BARO] = {1.0f, 60500.0f, 59500.0f},
+    [FAULT_GNSS] = {0.05f, 0.0f, 0.0f},
+};
+
+static q7_t fault_q7(float32_t x) {
+    return (q7_t)fmaxf(-128.0f, fminf(127.0f, roundf(x)));
+}
+
+/**
+ * @brief Scales of every channel for the sensors as update_sensors() feeds them
+ * @param cfg Receives FAULT_CHANNELS configurations
+ */
+void fault_detector_default_config(FaultChannelConfig *cfg) {
+    memcpy(cfg, fault_default_cfg, sizeof(fault_default_cfg));
+}
+
+/**
+ * @brief Empties every window and sets the channel scales
+ * @param det Detector to initialize
+ * @param cycles CPU cycle counter for the budget of fault_detector_step(), NULL
+ *        to run every due window whatever it takes
+ */
+void fault_detector_init(FaultDetector *det, uint32_t (*cycles)(void)) {
+    memset(det, 0, sizeof(FaultDetector));
+    fault_detector_default_config(det->cfg);
+    det->cycles = cycles;
+}
+
+/**
+ * @brief Adds one sample to a channel
+ * @param det Detector
+ * @param channel FaultChannel
+ * @param value In the channel's units, see FaultChannelConfig
+ */
+void fault_detector_push(FaultDetector *det, uint8_t channel, float32_t value) {
+    FaultChannelState *ch = &det->ch[channel];
+
+    ch->ring[ch->head] = value;
+    ch->head = (ch->head + 1) % (FAULT_WINDOW + 1);
+    if (ch->filled < FAULT_WINDOW + 1) {
+        ch->filled++;
+    }
+    if (ch->fresh < UINT16_MAX) {
+        ch->fresh++;
+    }
+}
+
+/**
+ * @brief Adds a block of raw ADIS16500 samples to the six IMU channels
+ * @param det Detector
+ * @param block Raw counts, channel major as in ImuPipeline.block
+ * @param n Samples per channel
+ */
+void fault_detector_push_imu(FaultDetector *det, const int16_t block[][IMU_PIPELINE_MAX_DECIMATION], uint16_t n) {
+    for (uint8_t c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+        for (uint16_t i = 0; i < n; i++) {
+            fault_detector_push(det, FAULT_GYRO_X + c, (float32_t)block[c][i]);
+        }
+    }
+}
+
+/**
+ * @brief Builds the network input of one window
+ * @param cfg Scales of the channel
+ * @param window FAULT_WINDOW + 1 samples, oldest first
+ * @param input Receives FAULT_INPUTS values, the differences then the levels
+ * @details Shared with the FaultModel trainer, so the model is trained on
+ *          exactly what it is given here.
+ */
+void fault_detector_features(const FaultChannelConfig *cfg, const float32_t *window, q7_t *input) {
+    for (int i = 0; i < FAULT_WINDOW; i++) {
+        float32_t d = (window[i + 1] - window[i]) / cfg->step;
+        q7_t x = fault_q7(copysignf(FAULT_DIFF_GAIN * log1pf(fabsf(d)), d));
+        // Insertion sort, so a spike looks the same wherever it falls
+        int j = i;
+        for (; j > 0 && input[j - 1] > x; j--) {
+            input[j] = input[j - 1];
+        }
+        input[j] = x;
+    }
+    for (int i = 0; i < FAULT_LEVELS; i++) {
+        float32_t level = 0.0f;
+        if (cfg->half_range > 0.0f) {
+            level = 127.0f * (window[2 * i + 2] - cfg->mid) / cfg->half_range;
+        }
+        input[FAULT_WINDOW + i] = fault_q7(level);
+    }
+}
+
+/**
+ * @brief Runs the network on one input
+ * @param det Detector, for its buffers, det->logits receives the output
+ * @param input FAULT_INPUTS values from fault_detector_features()
+ * @return FaultClass with the largest logit, the first of equal ones
+ */
+uint8_t fault_detector_classify(FaultDetector *det, const q7_t *input) {
+    arm_fully_connected_q7(input, fault_w1, FAULT_INPUTS, FAULT_HIDDEN, FAULT_MODEL_B1_SHIFT, FAULT_MODEL_OUT1_SHIFT,
+                           fault_b1, det->hidden, det->buffer);
+    arm_relu_q7(det->hidden, FAULT_HIDDEN);
+    arm_fully_connected_q7(det->hidden, fault_w2, FAULT_HIDDEN, FAULT_CLASSES, FAULT_MODEL_B2_SHIFT,
+                           FAULT_MODEL_OUT2_SHIFT, fault_b2, det->logits, det->buffer);
+
+    uint8_t best = FAULT_OK;
+    for (uint8_t c = 1; c < FAULT_CLASSES; c++) {
+        if (det->logits[c] > det->logits[best]) {
+            best = c;
+        }
+    }
+    return best;
+}
+
+// Moves the reported state of a channel on by one classified window
+static void fault_debounce(FaultChannelState *ch, uint8_t cls) {
+    if (cls == ch->run_class) {
+        if (ch->run < UINT8_MAX) {
+            ch->run++;
+        }
+    } else {
+        ch->run_class = cls;
+        ch->run = 1;
+    }
+
+    if (cls == FAULT_SPIKE) {
+        if (ch->spikes < UINT8_MAX) {
+            ch->spikes++;
+        }
+        ch->clean = 0;
+    } else if (cls == FAULT_OK && ch->spikes && ++ch->clean >= FAULT_SPIKE_DECAY) {
+        ch->spikes--;
+        ch->clean = 0;
+    }
+
+    if ((cls == FAULT_STUCK || cls == FAULT_SATURATED) && ch->run >= FAULT_CONFIRM) {
+        ch->state = cls;
+    } else if (cls == FAULT_OK && ch->run >= FAULT_CLEAR) {
+        ch->state = ch->spikes >= FAULT_SPIKE_FLAG ? FAULT_SPIKE : FAULT_OK;
+    } else if (ch->spikes >= FAULT_SPIKE_FLAG && ch->state == FAULT_OK) {
+        ch->state = FAULT_SPIKE;
+    }
+}
+
+// Classifies the latest window of a channel
+static void fault_infer(FaultDetector *det, uint8_t channel) {
+    FaultChannelState *ch = &det->ch[channel];
+    float32_t window[FAULT_WINDOW + 1];
+
+    for (int i = 0; i <= FAULT_WINDOW; i++) {
+        window[i] = ch->ring[(ch->head + i) % (FAULT_WINDOW + 1)];
+    }
+    if (ch->fresh > FAULT_WINDOW) {
+        det->skipped += ch->fresh - FAULT_WINDOW;
+    }
+    ch->fresh = 0;
+
+    fault_detector_features(&det->cfg[channel], window, det->input);
+    fault_debounce(ch, fault_detector_classify(det, det->input));
+    det->inferences++;
+}
+
+// Next channel with a full window and FAULT_HOP new samples, round robin, -1 if none
+static int fault_due(FaultDetector *det) {
+    for (int k = 0; k < FAULT_CHANNELS; k++) {
+        int c = (det->next + k) % FAULT_CHANNELS;
+        if (det->ch[c].filled == FAULT_WINDOW + 1 && det->ch[c].fresh >= FAULT_HOP) {
+            det->next = (uint8_t)((c + 1) % FAULT_CHANNELS);
+            return c;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Classifies due windows for as long as the budget allows
+ * @param det Detector
+ * @param budget CPU cycles from the call, FAULT_PASS_BUDGET in the main loop
+ * @return Inferences run
+ * @details Without a cycle counter every due window is classified.
+ */
+uint8_t fault_detector_step(FaultDetector *det, uint32_t budget) {
+    uint32_t start = det->cycles ? det->cycles() : 0;
+    uint8_t runs = 0;
+    int channel;
+
+    while ((channel = fault_due(det)) >= 0) {
+        if (det->cycles) {
+            uint32_t cost = det->cost ? det->cost : FAULT_COST_PRIOR;
+            uint32_t begin = det->cycles();
+            if (begin - start + cost > budget) {
+                // Taken again first on the next pass
+                det->next = (uint8_t)channel;
+                det->deferred++;
+                break;
+            }
+            fault_infer(det, (uint8_t)channel);
+            uint32_t spent = det->cycles() - begin;
+            if (spent > det->cost) {
+                det->cost = spent;
+            }
+        } else {
+            fault_infer(det, (uint8_t)channel);
+        }
+        runs++;
+    }
+    return runs;
+}
+
+/**
+ * @brief Reported state of every channel
+ * @param det Detector
+ * @return FaultClass of channel c in bits 2c and 2c + 1
+ */
+uint16_t fault_detector_mask(const FaultDetector *det) {
+    uint16_t mask = 0;
+
+    for (int c = 0; c < FAULT_CHANNELS; c++) {
+        mask |= (uint16_t)(det->ch[c].state << (2 * c));
+    }
+    return mask;
+}
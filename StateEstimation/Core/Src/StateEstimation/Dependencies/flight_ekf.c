@@ -10,6 +10,31 @@
 
 #include "flight_ekf.h"
 #include "ekf_constants.h"
+#include "flight_ekf_model.h"
+
+// States the GNSS position measures, the rows of H
+static const uint8_t gps_states[MAX_FLIGHT_MEAS] = {0, 2, 4};
+
+// Process noise over its nominal value by phase, for x, vx, y, vy, z, vz and
+// the baro bias. Boost vibration and thrust misalignment reach the velocity
+// through the accelerometer, the static port error moves the baro bias fastest
+// near Mach 1, and the parachute swings the vehicle under it.
+static const float32_t q_phase_scale[NOISE_PHASES][NOISE_ADAPT_MAX_DIM] = {
+    [NOISE_PHASE_PAD] = {1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f, 1.0f},
+    [NOISE_PHASE_BOOST] = {1.0f, 10.0f, 1.0f, 10.0f, 1.0f, 10.0f, 4.0f},
+    [NOISE_PHASE_COAST] = {1.0f, 2.0f, 1.0f, 2.0f, 1.0f, 2.0f, 4.0f},
+    [NOISE_PHASE_DESCENT] = {1.0f, 4.0f, 1.0f, 4.0f, 1.0f, 4.0f, 1.0f},
+};
+
+static uint8_t flight_noise_phase(uint16_t state) {
+    switch (state) {
+        case FASTASCENT: return NOISE_PHASE_BOOST;
+        case SLOWASCENT: return NOISE_PHASE_COAST;
+        case FREEFALL:
+        case LANDED: return NOISE_PHASE_DESCENT;
+        default: return NOISE_PHASE_PAD;
+    }
+}
 
 /**
  * @brief This function should only be called once at the beginning of flight; it initializes the ekf, putting all the matrices and vectors
@@ -22,20 +47,23 @@
 */
 //See https://github.com/ramblinrocketclub/flight-computer/blob/master/Core/Src/rocket.c for initializing process
 void initialize_ekf(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart, Sensors *sensors, uint16_t nz){
-    //EKF state vector is x, vx, y, vy, z, vz
+    //EKF state vector is x, vx, y, vy, z, vz, baro bias
 
     ekf->time_step = 0.02;
 
-    ekf->nx = 6;
+    ekf->nx = 7;
     ekf->nu = 0;
     ekf->nz = nz;
 
     //arm_mat_init_f32(&ekf->G, ekf->nu, ekf->nu, G_f32);
 
-    arm_mat_init_f32(&ekf->R, ekf->nz, ekf->nz, R_f32);
+    // Q and R are copied, the noise adaptation writes them
+    memcpy(ekf->R_data, R_f32, sizeof(R_f32));
+    memcpy(ekf->Q_data, Q_f32, sizeof(Q_f32));
+    arm_mat_init_f32(&ekf->R, ekf->nz, ekf->nz, ekf->R_data);
     arm_mat_init_f32(&ekf->dhdx, ekf->nz, ekf->nx, dhdx_f32);
     arm_mat_init_f32(&ekf->dfdx, ekf->nx, ekf->nx, dfdx_f32);
-    arm_mat_init_f32(&ekf->Q, ekf->nx, ekf->nx, Q_f32);
+    arm_mat_init_f32(&ekf->Q, ekf->nx, ekf->nx, ekf->Q_data);
 
     arm_mat_init_f32(&ekf->K_n, ekf->nx, ekf->nz, K_f32);
 
@@ -61,6 +89,15 @@ void initialize_ekf(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart, Sensors *se
     ekf->gps_origin[1] = ekf->gps[1];
     ekf->gps_origin[2] = ekf->gps[2];
 
+    // launch_gps is relative to the GNSS origin, both are reset together
+    ekf->gnss_origin.valid = 0;
+    ekf->launch_gps[0] = 0.0;
+    ekf->launch_gps[1] = 0.0;
+    ekf->launch_gps[2] = 0.0;
+    ekf->gps_enu[0] = 0.0;
+    ekf->gps_enu[1] = 0.0;
+    ekf->gps_enu[2] = 0.0;
+
     ekf->accelerometer[0] = 0;
     ekf->accelerometer[1] = 0.0;
     ekf->accelerometer[2] = 0.0;
@@ -74,6 +111,24 @@ void initialize_ekf(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart, Sensors *se
     ekf->magneto[2] = 0.0;
 
     ekf->barometer = 0.0;
+    ekf->baro_var = 0.0;
+    ekf->baro_slope = 0.0;
+    ekf->baro_ref = 0.0;
+    ekf->baro_ref_valid = 0;
+    ekf->baro_valid = 0;
+
+    ekf->nis_gate = ekf_chi2_gate(ekf->nz);
+    ekf_health_init(&ekf->health);
+    ekf->baro_gate = ekf_chi2_gate(1);
+    ekf_health_init(&ekf->baro_health);
+
+    ekf->gps_fuse = FLIGHT_GPS_POSITION | FLIGHT_GPS_VELOCITY;
+    ekf->gps_pos_valid = 0;
+    ekf->gps_vel_valid = 0;
+    ekf->vel_gate = ekf_chi2_gate(1);
+    ekf_health_init(&ekf->vel_health);
+    noise_adapt_init(&ekf->noise, ekf->Q.pData, ekf->nx, ekf->R.pData, ekf->nz);
+
     ekf->accel_offset[0] = sensors->accel_x;
     ekf->accel_offset[1] = sensors->accel_y;
     ekf->accel_offset[2] = sensors->accel_z;
@@ -131,11 +186,7 @@ void observation_function(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
         ekf->gps_origin[0], ekf->gps_origin[1], ekf->gps_origin[2]);
     //HAL_UART_Transmit(huart, (uint8_t*)buffer, len, HAL_MAX_DELAY);
     
-    ekf->h.pData[0] = ekf->x_n.pData[0];
-
-    ekf->h.pData[1] = ekf->x_n.pData[2];
-
-    ekf->h.pData[2] = ekf->x_n.pData[4];
+    flight_ekf_model_h(ekf->x_n.pData, ekf->h.pData);
 
     len = snprintf(buffer, sizeof(buffer), "Observation (h): [%.4f, %.4f, %.4f]\r\n",
                    ekf->h.pData[0], ekf->h.pData[1], ekf->h.pData[2]);
@@ -145,24 +196,9 @@ void observation_function(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
 void observation_jacobian(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
     HAL_UART_Transmit(huart, (uint8_t*)"Observation Jacobian:\r\n", 23, HAL_MAX_DELAY);
 
-    for (int i = 0; i < 18; i++) {
-        ekf->dhdx.pData[i] = 0.0f;
-    }
-    ekf->dhdx.pData[0] = 1.0f;               // dh1/dx
-    ekf->dhdx.pData[1 * 6 + 2] = 1.0f;       // dh2/dy
-    ekf->dhdx.pData[2 * 6 + 4] = 1.0f;       // dh3/dz
-
-    // Print Jacobian matrix
-    char buffer[300];
-    int len = snprintf(buffer, sizeof(buffer),
-        "H matrix:\r\n"
-        "[%.1f, %.1f, %.1f, %.1f, %.1f, %.1f]\r\n"
-        "[%.1f, %.1f, %.1f, %.1f, %.1f, %.1f]\r\n"
-        "[%.1f, %.1f, %.1f, %.1f, %.1f, %.1f]\r\n",
-        ekf->dhdx.pData[0], ekf->dhdx.pData[1], ekf->dhdx.pData[2], ekf->dhdx.pData[3], ekf->dhdx.pData[4], ekf->dhdx.pData[5],
-        ekf->dhdx.pData[6], ekf->dhdx.pData[7], ekf->dhdx.pData[8], ekf->dhdx.pData[9], ekf->dhdx.pData[10], ekf->dhdx.pData[11],
-        ekf->dhdx.pData[12], ekf->dhdx.pData[13], ekf->dhdx.pData[14], ekf->dhdx.pData[15], ekf->dhdx.pData[16], ekf->dhdx.pData[17]);
-    //HAL_UART_Transmit(huart, (uint8_t*)buffer, len, HAL_MAX_DELAY);
+    flight_ekf_model_H(ekf->dhdx.pData);
+
+    //print_matrix("H matrix", &ekf->dhdx, huart);
 }
 
 /**
@@ -175,81 +211,26 @@ void observation_jacobian(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
 arm_status kalman_gain(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
     
     arm_status result = ARM_MATH_SUCCESS;
-    arm_matrix_instance_f32 R_mat = ekf->R;
-
-    arm_mat_init_f32(&HP, ekf->nz, ekf->nx, HP_f32);
-    arm_mat_init_f32(&Ht, ekf->nx, ekf->nz, Ht_f32);
-    arm_mat_init_f32(&HPHt, ekf->nz, ekf->nz, HPHt_f32);
-    arm_mat_init_f32(&HPHtR, ekf->nz, ekf->nz, HPHtR_f32);
-    arm_mat_init_f32(&HPHtRi, ekf->nz, ekf->nz, HPHtRi_f32);
-    arm_mat_init_f32(&PHt, ekf->nx, ekf->nz, PHt_f32);
-    arm_mat_init_f32(&K_new, ekf->nx, ekf->nz, K_f32);
-    
-    arm_matrix_instance_f32 H = ekf->dhdx;
-    arm_matrix_instance_f32 P = ekf->P_n;
 
     HAL_UART_Transmit(huart, (uint8_t*)"Starting Kalman gain calculation...\r\n", 37, HAL_MAX_DELAY);
 
-    //print_matrix("H matrix", &H, huart);
-    //print_matrix("P matrix", &P, huart);
-    //print_matrix("R matrix", &R_mat, huart);
-
-    // Compute HP
-    result = arm_mat_mult_f32(&H, &P, &HP);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in HP calculation\r\n", 25, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("HP matrix", &HP, huart);
-    check_for_nan("HP matrix", &HP, huart);
-
-    // Compute Ht
-    result = arm_mat_trans_f32(&H, &Ht);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in Ht calculation\r\n", 25, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("Ht matrix", &Ht, huart);
-
-    // Compute HPHt
-    result = arm_mat_mult_f32(&HP, &Ht, &HPHt);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in HPHt calculation\r\n", 27, HAL_MAX_DELAY);
-        return result;
+    // The kernels are unrolled for the GNSS position model
+    if (ekf->nx != FLIGHT_EKF_MODEL_NX || ekf->nz != FLIGHT_EKF_MODEL_NZ) {
+        HAL_UART_Transmit(huart, (uint8_t*)"Error in K calculation\r\n", 24, HAL_MAX_DELAY);
+        return ARM_MATH_SIZE_MISMATCH;
     }
-    //print_matrix("HPHt matrix", &HPHt, huart);
 
-    // Compute HPHt + R
-    result = arm_mat_add_f32(&HPHt, &R_mat, &HPHtR);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in HPHt + R calculation\r\n", 31, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("HPHt + R matrix", &HPHtR, huart);
+    //print_matrix("P matrix", &ekf->P_n, huart);
+    //print_matrix("R matrix", &ekf->R, huart);
 
-    // Compute (HPHt + R)^-1
-    result = arm_mat_inverse_f32(&HPHtR, &HPHtRi);
+    // K = P H' (H P H' + R)^-1 through an LDL' factorization of H P H' + R,
+    // which also leaves (H P H' + R)^-1 in HPHtRi for the innovation gate
+    arm_mat_init_f32(&HPHtRi, ekf->nz, ekf->nz, HPHtRi_f32);
+    result = flight_ekf_model_gain(ekf->P_n.pData, ekf->R.pData, ekf->K_n_data, HPHtRi_f32);
     if (result != ARM_MATH_SUCCESS) {
         HAL_UART_Transmit(huart, (uint8_t*)"Error in (HPHt + R)^-1 calculation\r\n", 37, HAL_MAX_DELAY);
         return result;
     }
-    //print_matrix("(HPHt + R)^-1 matrix", &HPHtRi, huart);
-
-    // Compute PHt
-    result = arm_mat_mult_f32(&P, &Ht, &PHt);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in PHt calculation\r\n", 26, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("PHt matrix", &PHt, huart);
-
-    // Compute K
-    result = arm_mat_mult_f32(&PHt, &HPHtRi, &K_new);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in K calculation\r\n", 24, HAL_MAX_DELAY);
-        return result;
-    }
-    memcpy(ekf->K_n_data, K_new.pData, sizeof(float32_t) * ekf->nx * ekf->nz);
     arm_mat_init_f32(&ekf->K_n, ekf->nx, ekf->nz, ekf->K_n_data);
     //print_matrix("K (Kalman gain) matrix", &ekf->K_n, huart);
     //HAL_UART_Transmit(huart, (uint8_t*)"Kalman gain calculation complete.\r\n", 35, HAL_MAX_DELAY);
@@ -267,109 +248,37 @@ void update_state(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
     //HAL_UART_Transmit(huart, (uint8_t*)"Starting state update...\r\n", 26, HAL_MAX_DELAY);
     
     //print_matrix("Kalman gain K at start of update_state", &ekf->K_n, huart);
-    check_for_nan("Kalman gain K at start", &ekf->K_n, huart);
 
-    arm_status result = ARM_MATH_SUCCESS;
-    float32_t innovation[ekf->nz];
-    float32_t state_correction[ekf->nx];
-    arm_matrix_instance_f32 innovation_mat = {ekf->nz, 1, innovation};
-    arm_matrix_instance_f32 state_correction_mat = {ekf->nx, 1, state_correction};
-
-    // Print H, P_, and R
-    //print_matrix("Observation matrix H", &ekf->dhdx, huart);
-    //print_matrix("Previous covariance P_", &ekf->P_prev, huart);
-    //print_matrix("Measurement noise covariance R", &ekf->R, huart);
+    float32_t innovation[FLIGHT_EKF_MODEL_NZ];
 
     // Print z, h, and x_prev
     //print_matrix("Measurement z", &ekf->z, huart);
     //print_matrix("Observation h", &ekf->h, huart);
-    //print_matrix("Previous state x_prev", &ekf->x_prev, huart);
 
     // Compute innovation (z - h)
-    result |= arm_mat_sub_f32(&ekf->z, &ekf->h, &innovation_mat);
-    //print_matrix("Innovation (z - h)", &innovation_mat, huart);
-
-    // Compute state correction K * (z - h)
-    result |= arm_mat_mult_f32(&ekf->K_n, &innovation_mat, &state_correction_mat);
-    //print_matrix("State correction K*(z - h)", &state_correction_mat, huart);
+    for (int i = 0; i < FLIGHT_EKF_MODEL_NZ; i++) {
+        innovation[i] = ekf->z.pData[i] - ekf->h.pData[i];
+    }
 
     // Update state: x_n = x_n + K * (z - h)
-    result |= arm_mat_add_f32(&ekf->x_n, &state_correction_mat, &ekf->x_n);
+    flight_ekf_model_update_state(ekf->x_n.pData, ekf->K_n_data, innovation, ekf->x_n.pData);
     //print_matrix("Updated state x_n", &ekf->x_n, huart);
 
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in state update\r\n", 23, HAL_MAX_DELAY);
-    } else {
-        //HAL_UART_Transmit(huart, (uint8_t*)"State update completed successfully\r\n", 37, HAL_MAX_DELAY);
-    }
-
     //print_matrix("Kalman gain K at end of update_state", &ekf->K_n, huart);
-    check_for_nan("Kalman gain K at end", &ekf->K_n, huart);
 }
 
 void update_covariance(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
     HAL_UART_Transmit(huart, (uint8_t*)"Starting covariance update...\r\n", 31, HAL_MAX_DELAY);
 
     //print_matrix("Kalman gain K at start of update_covariance", &ekf->K_n, huart);
-    check_for_nan("Kalman gain K at start", &ekf->K_n, huart);
-
-    arm_status result = ARM_MATH_SUCCESS;
-    float32_t I_KH[ekf->nx * ekf->nx];
-    float32_t temp[ekf->nx * ekf->nx];
-    arm_matrix_instance_f32 I_KH_mat = {ekf->nx, ekf->nx, I_KH};
-    arm_matrix_instance_f32 temp_mat = {ekf->nx, ekf->nx, temp};
-
-    // Print H, P_, and R
-    //print_matrix("Observation matrix H", &ekf->dhdx, huart);
-    //print_matrix("Previous covariance P_", &ekf->P_prev, huart);
-    //print_matrix("Measurement noise covariance R", &ekf->R, huart);
-
-    // Compute KH
-    result |= arm_mat_mult_f32(&ekf->K_n, &ekf->dhdx, &I_KH_mat);
-    //print_matrix("KH", &I_KH_mat, huart);
-
-    // Compute I - KH
-    for (int i = 0; i < ekf->nx * ekf->nx; i++) {
-        I_KH[i] = (i % (ekf->nx + 1) == 0) ? 1.0f - I_KH[i] : -I_KH[i];
-    }
-    //print_matrix("I - KH", &I_KH_mat, huart);
-
-    // Compute (I - KH) * P_prev
-    result |= arm_mat_mult_f32(&I_KH_mat, &ekf->P_n, &temp_mat);
-    //print_matrix("(I - KH) * P_prev", &temp_mat, huart);
-
-    // Compute P_n = (I - KH) * P_prev * (I - KH)'
-    result |= arm_mat_mult_f32(&temp_mat, &I_KH_mat, &ekf->P_n);
-    //print_matrix("P_n before adding KRK'", &ekf->P_n, huart);
 
-    // Compute K * R
-    float32_t KR[ekf->nx * ekf->nz];
-    arm_matrix_instance_f32 KR_mat = {ekf->nx, ekf->nz, KR};
-    result |= arm_mat_mult_f32(&ekf->K_n, &ekf->R, &KR_mat);
-    //print_matrix("K * R", &KR_mat, huart);
-
-    // Compute K * R * K'
-    result |= arm_mat_mult_f32(&KR_mat, &(arm_matrix_instance_f32){ekf->nz, ekf->nx, ekf->K_n.pData}, &temp_mat);
-    //print_matrix("K * R * K'", &temp_mat, huart);
-
-    // Add K * R * K' to P_n
-    result |= arm_mat_add_f32(&ekf->P_n, &temp_mat, &ekf->P_n);
-    for (int i = 0; i < ekf->nx; i++) {
-        for (int j = 0; j <= i; j++) {
-            float value = (ekf->P_n.pData[i * ekf->nx + j] + ekf->P_n.pData[j * ekf->nx + i]) * 0.5;
-            ekf->P_n.pData[i * ekf->nx + j] = ekf->P_n.pData[j * ekf->nx + i] = value;
-        }
-    }
+    // Joseph form P_n = (I - KH) P (I - KH)' + K R K', written out symmetric
+    flight_ekf_model_update_covariance(ekf->P_n.pData, ekf->K_n_data, ekf->R.pData, ekf->P_n.pData);
     //print_matrix("Final P_n", &ekf->P_n, huart);
 
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in covariance update\r\n", 29, HAL_MAX_DELAY);
-    } else {
-        HAL_UART_Transmit(huart, (uint8_t*)"Covariance update completed successfully\r\n", 42, HAL_MAX_DELAY);
-    }
+    HAL_UART_Transmit(huart, (uint8_t*)"Covariance update completed successfully\r\n", 42, HAL_MAX_DELAY);
 
     //print_matrix("Kalman gain K at end of update_covariance", &ekf->K_n, huart);
-    check_for_nan("Kalman gain K at end", &ekf->K_n, huart);
 }
 
 /**
@@ -377,79 +286,26 @@ void update_covariance(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
  * This implementation takes the velocity in the body frame and rotates it into the velocity in the flat Earth frame to integrate the
  * flat Earth position
  * @param ekf, the EKF struct
+ * @param rocket_atd, the rocket attitude struct, whose frame holds the rotation for this cycle
 */
 void state_transition_function(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, UART_HandleTypeDef *huart) {
-    float dt = ekf->time_step;
-
-    //Extract the quaternion and convert it to the quaternion that rotates body frame into the flat Earth frame
-    float32_t q0 = rocket_atd->q_current_s;
-    float32_t q1 = -1.0*rocket_atd->q_current_x;
-    float32_t q2 = -1.0*rocket_atd->q_current_y;
-    float32_t q3 = -1.0*rocket_atd->q_current_z; 
-
-    float32_t q_rot_mat[3][3] = {{(2*(q0*q0 + q1*q1) - 1), (2*(q1*q2 - q0*q3)), (2*(q1*q3 + q0*q2))},
-                                                  {(2*(q1*q2 + q0*q3)), (2*(q0*q0 + q2*q2) - 1), (2*(q2*q3 - q0*q1))},
-                                                  {(2*(q1*q3 - q0*q2)), (2*(q2*q3 + q0*q1)), (2*(q0*q0 + q3*q3) - 1)}};
-
-    float32_t vel_body_x = ekf->x_n.pData[1];
-    float32_t vel_body_y = ekf->x_n.pData[3];
-    float32_t vel_body_z = ekf->x_n.pData[5];
-
-    float32_t vel_flat_x = q_rot_mat[0][0]*vel_body_x + q_rot_mat[0][1]*vel_body_y + q_rot_mat[0][2]*vel_body_z;
-    float32_t vel_flat_y = q_rot_mat[1][0]*vel_body_x + q_rot_mat[1][1]*vel_body_y + q_rot_mat[1][2]*vel_body_z;
-    float32_t vel_flat_z = q_rot_mat[2][0]*vel_body_x + q_rot_mat[2][1]*vel_body_y + q_rot_mat[2][2]*vel_body_z;
-
-    ekf->f.pData[0] = vel_flat_x * dt + ekf->x_n.pData[0];
-    ekf->f.pData[1] = ekf->accelerometer[0] * dt + ekf->x_n.pData[1];
-    ekf->f.pData[2] = vel_flat_y * dt + ekf->x_n.pData[2];
-    ekf->f.pData[3] = ekf->accelerometer[1] * dt + ekf->x_n.pData[3];
-    ekf->f.pData[4] = vel_flat_z * dt + ekf->x_n.pData[4];
-    ekf->f.pData[5] = ekf->accelerometer[2] * dt + ekf->x_n.pData[5];
+    //Rotation from the body frame into the flat Earth frame, the conjugate of q_current
+    flight_ekf_model_f(ekf->x_n.pData, rocket_atd->frame.dcm_t, ekf->accelerometer, ekf->time_step, ekf->f.pData);
 }
 
 
+/**
+ * @brief Forms the Jacobian of state_transition_function() with respect to the state
+ * @param ekf, the EKF struct
+ * @param rocket_atd, the rocket attitude struct, whose frame holds the rotation for this cycle
+ * @note The position rows are dt times the body to flat rotation that state_transition_function() applies.
+*/
 void state_transition_jacobian(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, UART_HandleTypeDef *huart) {
     //HAL_UART_Transmit(huart, (uint8_t*)"Starting state transition Jacobian calculation...\r\n", 52, HAL_MAX_DELAY);
 
-    float32_t dfdx_new[ekf->nx * ekf->nx];
-    memset(dfdx_new, 0.0, sizeof(dfdx_new));
-
-    //Extract the quaternion and convert it to the quaternion that rotates body frame into the flat Earth frame
-    float32_t q0 = rocket_atd->q_current_s;
-    float32_t q1 = -1.0*rocket_atd->q_current_x;
-    float32_t q2 = -1.0*rocket_atd->q_current_y;
-    float32_t q3 = -1.0*rocket_atd->q_current_z; 
-
-    float dt = ekf->time_step;
-
-    // x position, velocity
-    dfdx_new[0 * ekf->nx + 0] = 1.0;
-    dfdx_new[0 * ekf->nx + 1] = dt*(2*q0*q0 + 2*q1*q1 - 1);
-    dfdx_new[0 * ekf->nx + 3] = dt*(2*q0*q3 + 2*q1*q2);
-    dfdx_new[0 * ekf->nx + 5] = -dt*(2*q0*q2 - 2*q1*q3);
-
-    dfdx_new[1 * ekf->nx + 1] = 1.0;
-
-
-    // y position, velocity
-    dfdx_new[2 * ekf->nx + 1] = -dt*(2*q0*q3 - 2*q1*q2);
-    dfdx_new[2 * ekf->nx + 2] = 1.0;
-    dfdx_new[2 * ekf->nx + 3] = dt*(2*q0*q0 + 2*q2*q2 - 1);
-    dfdx_new[2 * ekf->nx + 5] = dt*(2*q0*q1 + 2*q2*q3);
-
-    dfdx_new[3 * ekf->nx + 3] = 1.0;
-
-    // z position, velocity
-    dfdx_new[4 * ekf->nx + 1] = dt*(2*q0*q2 + 2*q1*q3);
-    dfdx_new[4 * ekf->nx + 3] = -dt*(2*q0*q1 - 2*q2*q3);
-    dfdx_new[4 * ekf->nx + 4] = 1.0;
-    dfdx_new[4 * ekf->nx + 5] = dt*(2*q0*q0 + 2*q3*q3 - 1);
-
-    dfdx_new[5 * ekf->nx + 5] = 1.0;
+    //Rotation from the body frame into the flat Earth frame, as in state_transition_function
+    flight_ekf_model_F(rocket_atd->frame.dcm_t, ekf->accelerometer, ekf->time_step, ekf->dfdx_data);
 
-    // Copy the new Jacobian data to ekf->dfdx_data
-    memcpy(ekf->dfdx_data, dfdx_new, sizeof(float32_t) * ekf->nx * ekf->nx);
-    
     // Reinitialize dfdx with the updated data
     arm_mat_init_f32(&ekf->dfdx, ekf->nx, ekf->nx, ekf->dfdx_data);
 
@@ -481,57 +337,19 @@ void predict_state(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
 void predict_covariance(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
     //HAL_UART_Transmit(huart, (uint8_t*)"Starting covariance prediction...\r\n", 35, HAL_MAX_DELAY);
 
-    arm_status result = ARM_MATH_SUCCESS;
-
-    arm_matrix_instance_f32 P = ekf->P_n;
-    arm_matrix_instance_f32 F = ekf->dfdx;
-    arm_matrix_instance_f32 Q_mat = ekf->Q;
-
-    //print_matrix("Current covariance (P)", &P, huart);
-    //print_matrix("State transition Jacobian (F)", &F, huart);
-    //print_matrix("Process noise covariance (Q)", &Q_mat, huart);
-
-    float32_t Ft_f32[ekf->nx * ekf->nx];
-    float32_t FP_f32[ekf->nx * ekf->nx];
-    float32_t FPFt_f32[ekf->nx * ekf->nx];
-    float32_t P_future_f32[ekf->nx * ekf->nx];
-
-    arm_matrix_instance_f32 Ft, FP, FPFt, P_future;
-
-    arm_mat_init_f32(&Ft, ekf->nx, ekf->nx, Ft_f32);
-    arm_mat_init_f32(&FP, ekf->nx, ekf->nx, FP_f32);
-    arm_mat_init_f32(&FPFt, ekf->nx, ekf->nx, FPFt_f32);
-    arm_mat_init_f32(&P_future, ekf->nx, ekf->nx, P_future_f32);
-
-    // Compute FP
-    result |= arm_mat_mult_f32(&F, &P, &FP);
-    //print_matrix("FP", &FP, huart);
-
-    // Compute Ft
-    result |= arm_mat_trans_f32(&F, &Ft);
-    //print_matrix("F transpose (Ft)", &Ft, huart);
-
-    // Compute FPFt
-    result |= arm_mat_mult_f32(&FP, &Ft, &FPFt);
-    //print_matrix("FPFt", &FPFt, huart);
+    //print_matrix("Current covariance (P)", &ekf->P_n, huart);
+    //print_matrix("State transition Jacobian (F)", &ekf->dfdx, huart);
 
-    // Compute P_next = FPFt + Q
-    result |= arm_mat_add_f32(&FPFt, &Q_mat, &P_future);
-    //print_matrix("P_future before regularization", &P_future, huart);
+    // P_next = F P F' + Q, unrolled over the entries of F that are not 0 or 1.
+    // P_n may alias P_n_data, the kernel reads all of P before it writes
+    flight_ekf_model_predict_covariance(ekf->dfdx.pData, ekf->Q.pData, ekf->P_n.pData, ekf->P_n_data);
 
-    // Copy P_future data to P_next_data
-    memcpy(ekf->P_n_data, P_future.pData, sizeof(float32_t) * ekf->nx * ekf->nx);
-    
     // Reinitialize P_next with the updated data
     arm_mat_init_f32(&ekf->P_n, ekf->nx, ekf->nx, ekf->P_n_data);
 
     //print_matrix("Predicted covariance (P_next)", &ekf->P_next, huart);
 
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in covariance prediction calculations\r\n", 45, HAL_MAX_DELAY);
-    } else {
-        HAL_UART_Transmit(huart, (uint8_t*)"Covariance prediction completed successfully.\r\n", 47, HAL_MAX_DELAY);
-    }
+    HAL_UART_Transmit(huart, (uint8_t*)"Covariance prediction completed successfully.\r\n", 47, HAL_MAX_DELAY);
 }
 
 ///**
@@ -549,44 +367,113 @@ void predict_covariance(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
  * @brief Converts GPS coordinates from WGS84 to a local flat Earth frame
  * @param sensors Pointer to sensors structure containing GPS readings
  * @param ekf Pointer to the flight EKF structure
- * @param ground Flag indicating if conversion is for ground reference (1) or flight (0)
- * @details Transforms GPS coordinates through ECEF to ENU frame, stores results in ekf->gps_flat
+ * @param ground Flag to re-anchor the local frame at this fix (1) or not (0)
+ * @details The origin is set from the first valid fix after initialize_ekf()
+ *          and cached in ekf->gnss_origin, so no trigonometry runs per fix.
+ *          Stores [up, north, -east] relative to ekf->launch_gps in
+ *          ekf->gps_flat and the time the fix is valid for in ekf->gps_time_us.
+ *          Fixes without a 3D gnssFixOK solution are ignored. A new fix is
+ *          queued for the position update of run_ekf() unless on the ground.
+ *          A new velocity goes to ekf->gps_vel in the same axes, queued for
+ *          gps_velocity_update_step() the same way.
  */
 void GPS2Flat(Sensors *sensors, ExtKalmanFilter *ekf, uint8_t ground) {
-    // Converts from WGS84 to ECEF
-
-    // Define intermediate variables
-    double WGS84_E = 0.08181;
-
-    double clat = cos(sensors->gps_x * (PI / 180.0));
-    double slat = sin(sensors->gps_x * (PI / 180.0));
-    double clon = cos(sensors->gps_y * (PI / 180.0));
-    double slon = sin(sensors->gps_y * (PI / 180.0));
-
-    double N = WGS84_A / sqrt(1.0 - WGS84_E * WGS84_E * slat * slat);
-    double x_ecef = (N + sensors->gps_z) * clat * clon;
-    double y_ecef = (N + sensors->gps_z) * clat * slon;
-    double z_ecef = (N * (1.0 - WGS84_E * WGS84_E) + sensors->gps_z) * slat;
-    if (ground) {
-        sensors->gps_offset_x = x_ecef;
-        sensors->gps_offset_y = y_ecef;
-        sensors->gps_offset_z = z_ecef;
+    float32_t *enu = ekf->gps_enu;
+
+    if (ground || !ekf->gnss_origin.valid) {
+        gnss_origin_set(&ekf->gnss_origin, &sensors->gps_fix);
     }
-    double dx = x_ecef - sensors->gps_offset_x;
-    double dy = y_ecef - sensors->gps_offset_y;
-    double dz = z_ecef - sensors->gps_offset_z;
-    double x_enu = -slon*dx  + clon*dy;
-    double y_enu = -slat*clon*dx - slat*slon*dy + clat*dz;
-    double z_enu = clat*clon*dx + clat*slon*dy + slat*dz;
-    if (ground) {
-        ekf->gps_flat[0] = sensors->gps_offset_x;
-        ekf->gps_flat[1] = sensors->gps_offset_y;
-        ekf->gps_flat[2] = sensors->gps_offset_z;
-    } else {
-        ekf->gps_flat[0] = z_enu - ekf->launch_gps[0];  // Subtract launch position
-        ekf->gps_flat[1] = y_enu - ekf->launch_gps[1];
-        ekf->gps_flat[2] = -1.0 * x_enu - ekf->launch_gps[2];
+    // Without a valid fix hold the last one, or the origin before the first
+    if (ekf->gnss_origin.valid && sensors->gps_fix.valid) {
+        gnss_origin_fix_to_enu(&ekf->gnss_origin, &sensors->gps_fix, enu);
+        ekf->gps_time_us = sensors->gps_fix.time_us;
+        ekf->gps_timed = sensors->gps_fix.time_source != GPS_TIME_NONE;
+    }
+
+    // Each position is taken once
+    if (sensors->gps_fix.pos_new) {
+        sensors->gps_fix.pos_new = 0;
+        ekf->gps_pos_valid = ekf->gnss_origin.valid && sensors->gps_fix.valid && !ground;
+    }
+
+    ekf->gps_flat[0] = enu[2] - ekf->launch_gps[0];  // Subtract launch position
+    ekf->gps_flat[1] = enu[1] - ekf->launch_gps[1];
+    ekf->gps_flat[2] = -1.0f * enu[0] - ekf->launch_gps[2];
+
+    // Each velocity is taken once
+    if (sensors->gps_fix.vel_new) {
+        const float32_t *ned = sensors->gps_fix.vel_ned;
+        float32_t sigma = fmaxf(sensors->gps_fix.vel_acc, GPS_VEL_MIN_SIGMA);
+        float32_t age = (float32_t)(int32_t)(sensors->imu_time_us - sensors->gps_fix.time_us) * 1e-6f;
+
+        sensors->gps_fix.vel_new = 0;
+        ekf->gps_vel[0] = -ned[2];
+        ekf->gps_vel[1] = ned[0];
+        ekf->gps_vel[2] = -ned[1];
+        ekf->gps_vel_var = sigma * sigma;
+        ekf->gps_vel_age = 0.0f;
+        if (sensors->gps_fix.time_source != GPS_TIME_NONE && age > 0.0f && age <= GPS_MAX_AGE) {
+            ekf->gps_vel_age = age;
+        }
+        ekf->gps_vel_valid = !ground;
+    }
+}
+
+/**
+ * @brief Moves the GNSS measurement from the time of its solution to the time of the state
+ * @param ekf Pointer to the flight EKF structure, after make_measurement()
+ * @param rocket_atd Pointer to rocket attitude structure, whose frame holds the rotation for this cycle
+ * @param sensors Pointer to sensors structure, imu_time_us is the time of the predicted state
+ * @details A solution is valid tens of milliseconds before it arrives and is fused once, in the first cycle after
+ *          it. The rocket moves by its velocity times that age in between, and the measurement is moved by as much
+ *          so that it compares with the predicted state. Fixes with no time stamp, as in the host
+ *          builds, or an age outside 0 to GPS_MAX_AGE are fused as they are. The age is kept in ekf->gps_age.
+ */
+static void gps_latency_correct(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors *sensors) {
+    const float32_t (*q_rot_mat)[3] = rocket_atd->frame.dcm_t;
+    float32_t age = (float32_t)(int32_t)(sensors->imu_time_us - ekf->gps_time_us) * 1e-6f;
+
+    ekf->gps_age = 0.0f;
+    if (!ekf->gps_timed || !(age > 0.0f) || age > GPS_MAX_AGE) {
+        return;
+    }
+    for (int i = 0; i < 3; i++) {
+        float32_t vel_flat = q_rot_mat[i][0] * ekf->x_n.pData[1] + q_rot_mat[i][1] * ekf->x_n.pData[3] +
+                             q_rot_mat[i][2] * ekf->x_n.pData[5];
+        ekf->z.pData[i] += vel_flat * age;
+    }
+    ekf->gps_age = age;
+}
+
+/**
+ * @brief Converts the barometer reading to altitude above the pad
+ * @param sensors Pointer to sensors structure containing the pressure
+ * @param ekf Pointer to the flight EKF structure
+ * @param ground Flag to average the reading into the pad reference (1) or
+ *        to queue it for baro_update_step() (0)
+ * @details Stores the altitude above ekf->baro_ref in ekf->barometer. Readings
+ *          of 0 Pa, before the first conversion or from a recording without
+ *          a barometer, are ignored, and so is everything in flight until the
+ *          pad reference has been set.
+ */
+void Baro2Flat(Sensors *sensors, ExtKalmanFilter *ekf, uint8_t ground) {
+    float32_t slope;
+    float32_t altitude;
+
+    if (!(sensors->pressure > 0.0f) || (!ground && !ekf->baro_ref_valid)) {
+        return;
     }
+    altitude = baro_altitude(sensors->pressure, &slope);
+
+    if (!ekf->baro_ref_valid) {
+        ekf->baro_ref = altitude;
+        ekf->baro_ref_valid = 1;
+    } else if (ground) {
+        ekf->baro_ref += BARO_REF_WEIGHT * (altitude - ekf->baro_ref);
+    }
+    ekf->barometer = altitude - ekf->baro_ref;
+    ekf->baro_slope = slope;
+    ekf->baro_valid = !ground;
 }
 
 /**
@@ -594,8 +481,9 @@ void GPS2Flat(Sensors *sensors, ExtKalmanFilter *ekf, uint8_t ground) {
  * @param ekf Pointer to the flight EKF structure
  * @param rocket_atd Pointer to rocket attitude structure
  * @param sensors Pointer to sensors structure with current readings
- * @details Transforms sensor readings into body frame, computes gravity vector, 
- *          and applies coriolis corrections for accelerometer readings
+ * @details Transforms sensor readings into body frame, takes the gravity vector
+ *          from rocket_atd->frame, and applies coriolis corrections for
+ *          accelerometer readings
  */
 void update_ekf(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors* sensors) {
     ekf->gps[0] = ekf->gps_flat[0];
@@ -605,20 +493,10 @@ void update_ekf(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors* senso
     ekf->gyro[1] = (sensors->gyro_y - sensors->gyro_bias_y);
     ekf->gyro[2] = (sensors->gyro_z - sensors->gyro_bias_z);
 
-    //Extract the quaternion that rotates flat Earth frame to body frame
-    float32_t q0 = rocket_atd->q_current_s;
-    float32_t q1 = rocket_atd->q_current_x;
-    float32_t q2 = rocket_atd->q_current_y;
-    float32_t q3 = rocket_atd->q_current_z; 
-
-    float32_t q_rot_mat[3][3] = {{(2*(q0*q0 + q1*q1) - 1), (2*(q1*q2 - q0*q3)), (2*(q1*q3 + q0*q2))},
-                                                  {(2*(q1*q2 + q0*q3)), (2*(q0*q0 + q2*q2) - 1), (2*(q2*q3 - q0*q1))},
-                                                  {(2*(q1*q3 - q0*q2)), (2*(q2*q3 + q0*q1)), (2*(q0*q0 + q3*q3) - 1)}};
-
-    //Compute the gravity vector in the body frame
-    float32_t g_bx = q_rot_mat[0][0]*(-9.81);
-    float32_t g_by = q_rot_mat[1][0]*(-9.81);
-    float32_t g_bz = q_rot_mat[2][0]*(-9.81);
+    //Gravity vector in the body frame, formed once per attitude update
+    float32_t g_bx = rocket_atd->frame.gravity_body[0];
+    float32_t g_by = rocket_atd->frame.gravity_body[1];
+    float32_t g_bz = rocket_atd->frame.gravity_body[2];
 
     float32_t wx = ekf->gyro[0];
     float32_t wy = ekf->gyro[1];
@@ -647,25 +525,34 @@ void update_ekf(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors* senso
  * @param sensors Pointer to sensors structure
  * @param huart Pointer to UART handle for debug output
  * @param ekf_initialized Flag indicating if EKF has been initialized
- * @details Performs prediction and update steps of the EKF, processes GPS measurements
+ * @details Performs prediction and update steps of the EKF, processes GPS and
+ *          barometer measurements. The GNSS position and velocity of each
+ *          solution are fused once, if their bit is set in ekf->gps_fuse.
  */
 void run_ekf(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors *sensors, UART_HandleTypeDef *huart, int ekf_initialized) {
     char buffer[256];
     int len;
     len = snprintf(buffer, sizeof(buffer), "State before update:\r\n");
     //HAL_UART_Transmit(huart, (uint8_t*)buffer, len, HAL_MAX_DELAY);
-    for (int i = 0; i < 6; i++) {
+    for (int i = 0; i < ekf->nx; i++) {
         len = snprintf(buffer, sizeof(buffer), "x[%d]: %f\r\n", i, ekf->x_n.pData[i]);
         //HAL_UART_Transmit(huart, (uint8_t*)buffer, len, HAL_MAX_DELAY);
     }
 
+    noise_adapt_phase(&ekf->noise, flight_noise_phase(rocket_state), q_phase_scale, ekf->Q.pData);
     predict_step(ekf, rocket_atd, huart);
 
-    make_measurement(ekf, huart);
     GPS2Flat(sensors, ekf, 0);
-    //if (GPS measurement is valid) {
-    update_step(ekf, huart);
-    //}
+    if (ekf->gps_pos_valid && (ekf->gps_fuse & FLIGHT_GPS_POSITION)) {
+        memcpy(ekf->gps, ekf->gps_flat, sizeof(ekf->gps));
+        make_measurement(ekf, huart);
+        gps_latency_correct(ekf, rocket_atd, sensors);
+        update_step(ekf, huart);
+    }
+    ekf->gps_pos_valid = 0;
+    gps_velocity_update_step(ekf, rocket_atd, huart);
+    Baro2Flat(sensors, ekf, 0);
+    baro_update_step(ekf, huart);
 
     //acknowledge_time_passed(ekf);
     //arm_matrix_instance_f32 curr_state = ekf->x_n;
@@ -689,12 +576,156 @@ void predict_step(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, UART_HandleT
  * @brief Performs the update step of the EKF
  * @param ekf Pointer to the flight EKF structure
  * @param huart Pointer to UART handle for debug output
- * @details Computes Kalman gain and updates state and covariance estimates using measurements
+ * @details Computes Kalman gain and updates state and covariance estimates using measurements.
+ *          The measurement is skipped if its normalized innovation squared is past
+ *          ekf->nis_gate, and the state and covariance are checked in ekf->health.
+ *          Accepted innovations of a new fix adapt R in ekf->noise.
  */
 void update_step(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart){
+    float32_t innovation[MAX_FLIGHT_MEAS];
+
     observation_function(ekf, huart);
     observation_jacobian(ekf, huart);
-    kalman_gain(ekf, huart);
-    update_state(ekf, huart);
-    update_covariance(ekf, huart);
-}
\ No newline at end of file
+    if (kalman_gain(ekf, huart) != ARM_MATH_SUCCESS) {
+        ekf->health.flags |= EKF_HEALTH_S_SINGULAR;
+    } else {
+        // HPHtRi still holds S^-1 from the gain
+        for (int i = 0; i < ekf->nz; i++) {
+            innovation[i] = ekf->z.pData[i] - ekf->h.pData[i];
+        }
+        float32_t nis = ekf_nis(innovation, HPHtRi.pData, ekf->nz);
+        if (ekf_health_gate(&ekf->health, nis, ekf->nis_gate)) {
+            // H P H' before the update, H picks the position states. A forced
+            // update is a jump or a diverged filter, not measurement noise.
+            if (nis <= ekf->nis_gate) {
+                float32_t hph[MAX_FLIGHT_MEAS];
+                for (int i = 0; i < ekf->nz; i++) {
+                    hph[i] = ekf->P_n.pData[gps_states[i] * (ekf->nx + 1)];
+                }
+                noise_adapt_update(&ekf->noise, ekf->gps, innovation, hph, ekf->R.pData);
+            }
+            update_state(ekf, huart);
+            update_covariance(ekf, huart);
+        }
+    }
+    ekf_health_check(&ekf->health, ekf->x_n.pData, ekf->P_n.pData, ekf->nx);
+}
+
+/**
+ * @brief Fuses the barometer as a scalar measurement of altitude plus bias
+ * @param ekf Pointer to the flight EKF structure
+ * @param huart Pointer to UART handle for debug output
+ * @details With H = [1 0 0 0 0 0 1] the innovation covariance S is a scalar,
+ *          so the gain needs no matrix inverse. With u = P H' and K = u / S
+ *          the Joseph form reduces to P - K u' - u K' + S K K', O(n^2) and
+ *          symmetric by construction. The noise is BARO_NOISE_PA plus the
+ *          static port error at the estimated speed, taken to altitude with
+ *          dh/dp. The update is skipped if its NIS is past ekf->baro_gate.
+ */
+void baro_update_step(ExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
+    const uint16_t nx = ekf->nx;
+    const uint16_t b = FLIGHT_BARO_BIAS;
+    float32_t *x = ekf->x_n.pData;
+    float32_t *P = ekf->P_n.pData;
+    float32_t u[MAX_FLIGHT_DIM];
+    float32_t K[MAX_FLIGHT_DIM];
+
+    if (!ekf->baro_valid) {
+        return;
+    }
+    ekf->baro_valid = 0;
+
+    float32_t speed2 = x[1] * x[1] + x[3] * x[3] + x[5] * x[5];
+    float32_t sigma = ekf->baro_slope * (BARO_NOISE_PA + BARO_STATIC_COEF * 0.5f * BARO_AIR_DENSITY * speed2);
+    ekf->baro_var = sigma * sigma;
+
+    for (uint16_t i = 0; i < nx; i++) {
+        u[i] = P[i * nx] + P[i * nx + b];
+    }
+    float32_t S = u[0] + u[b] + ekf->baro_var;
+    float32_t innovation = ekf->barometer - (x[0] + x[b]);
+
+    if (!(S > 0.0f)) {
+        ekf->health.flags |= EKF_HEALTH_S_SINGULAR;
+        return;
+    }
+    if (!ekf_health_gate(&ekf->baro_health, innovation * innovation / S, ekf->baro_gate)) {
+        return;
+    }
+
+    for (uint16_t i = 0; i < nx; i++) {
+        K[i] = u[i] / S;
+        x[i] += K[i] * innovation;
+    }
+    for (uint16_t i = 0; i < nx; i++) {
+        for (uint16_t j = 0; j <= i; j++) {
+            float32_t value = P[i * nx + j] - K[i] * u[j] - u[i] * K[j] + S * K[i] * K[j];
+            P[i * nx + j] = P[j * nx + i] = value;
+        }
+    }
+    ekf_health_check(&ekf->health, x, P, nx);
+}
+
+/**
+ * @brief Fuses the GNSS velocity as three scalar measurements, one per flat frame axis
+ * @param ekf Pointer to the flight EKF structure
+ * @param rocket_atd Pointer to rocket attitude structure, whose frame holds the rotation for this cycle
+ * @param huart Pointer to UART handle for debug output
+ * @details The velocity states are in the body frame, so axis i of the flat
+ *          velocity is the row c of the body to flat rotation times them,
+ *          H = [0 c0 0 c1 0 c2 0]. Each axis is a scalar update as in
+ *          baro_update_step(), with the noise from the receiver's speed
+ *          accuracy. The solution is ekf->gps_vel_age old, so the body
+ *          acceleration over that time is added to the measurement. An axis
+ *          is skipped if its NIS is past ekf->vel_gate. Does nothing unless a
+ *          new velocity is queued and FLIGHT_GPS_VELOCITY is set in
+ *          ekf->gps_fuse.
+ */
+void gps_velocity_update_step(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, UART_HandleTypeDef *huart) {
+    const uint16_t nx = ekf->nx;
+    const float32_t (*q_rot_mat)[3] = rocket_atd->frame.dcm_t;
+    const float32_t *a = ekf->accelerometer;
+    float32_t *x = ekf->x_n.pData;
+    float32_t *P = ekf->P_n.pData;
+    float32_t u[MAX_FLIGHT_DIM];
+    float32_t K[MAX_FLIGHT_DIM];
+
+    if (!ekf->gps_vel_valid) {
+        return;
+    }
+    ekf->gps_vel_valid = 0;
+    if (!(ekf->gps_fuse & FLIGHT_GPS_VELOCITY)) {
+        return;
+    }
+
+    for (int axis = 0; axis < 3; axis++) {
+        const float32_t *c = q_rot_mat[axis];
+
+        for (uint16_t i = 0; i < nx; i++) {
+            u[i] = c[0] * P[i * nx + 1] + c[1] * P[i * nx + 3] + c[2] * P[i * nx + 5];
+        }
+        float32_t S = c[0] * u[1] + c[1] * u[3] + c[2] * u[5] + ekf->gps_vel_var;
+        float32_t z = ekf->gps_vel[axis] + (c[0] * a[0] + c[1] * a[1] + c[2] * a[2]) * ekf->gps_vel_age;
+        float32_t innovation = z - (c[0] * x[1] + c[1] * x[3] + c[2] * x[5]);
+
+        if (!(S > 0.0f)) {
+            ekf->health.flags |= EKF_HEALTH_S_SINGULAR;
+            return;
+        }
+        if (!ekf_health_gate(&ekf->vel_health, innovation * innovation / S, ekf->vel_gate)) {
+            continue;
+        }
+
+        for (uint16_t i = 0; i < nx; i++) {
+            K[i] = u[i] / S;
+            x[i] += K[i] * innovation;
+        }
+        for (uint16_t i = 0; i < nx; i++) {
+            for (uint16_t j = 0; j <= i; j++) {
+                float32_t value = P[i * nx + j] - K[i] * u[j] - u[i] * K[j] + S * K[i] * K[j];
+                P[i * nx + j] = P[j * nx + i] = value;
+            }
+        }
+    }
+    ekf_health_check(&ekf->health, x, P, nx);
+}
@@ -0,0 +1,469 @@
+/**
+ * @file flight_ekf_model.c
+ * @brief Unrolled kernels of the flight EKF model, generated by EkfGen
+ *
+ * @details Do not edit, run make -C EkfGen export instead. Flight EKF, x = [x,
+ *          vx, y, vy, z, vz, baro bias] with the velocities in the body frame,
+ *          measured by the GNSS position. Matrices are row major, covariances
+ *          are read from their upper triangle and written whole.
+ */
+
+#include "flight_ekf_model.h"
+
+/**
+ * @brief State transition, f = f(x)
+ * @param x State
+ * @param dcm_t Body to flat frame rotation, RocketAttitude.frame.dcm_t
+ * @param accel Body acceleration without gravity, m/s^2
+ * @param dt Time step, s
+ * @param f Receives the predicted state, may be x
+ * @details 15 multiplications, 12 additions.
+ */
+void flight_ekf_model_f(const float32_t *x, const float32_t (*dcm_t)[3], const float32_t *accel, float32_t dt, float32_t *f) {
+    const float32_t t0 = x[0] + dt * (x[5] * dcm_t[0][2] + (x[3] * dcm_t[0][1] + x[1] * dcm_t[0][0]));
+    const float32_t t1 = x[1] + dt * accel[0];
+    const float32_t t2 = x[2] + dt * (x[5] * dcm_t[1][2] + (x[3] * dcm_t[1][1] + x[1] * dcm_t[1][0]));
+    const float32_t t3 = x[3] + dt * accel[1];
+    const float32_t t4 = x[4] + dt * (x[5] * dcm_t[2][2] + (x[3] * dcm_t[2][1] + x[1] * dcm_t[2][0]));
+    const float32_t t5 = x[5] + dt * accel[2];
+    const float32_t t6 = x[6];
+    f[0] = t0;
+    f[1] = t1;
+    f[2] = t2;
+    f[3] = t3;
+    f[4] = t4;
+    f[5] = t5;
+    f[6] = t6;
+}
+
+/**
+ * @brief Jacobian of the state transition by the state
+ * @param dcm_t Body to flat frame rotation, RocketAttitude.frame.dcm_t
+ * @param accel Body acceleration without gravity, m/s^2
+ * @param dt Time step, s
+ * @param F Receives all 49 entries, those that are structurally 0 or 1 as
+ *        constants
+ * @details 9 multiplications, 0 additions.
+ */
+void flight_ekf_model_F(const float32_t (*dcm_t)[3], const float32_t *accel, float32_t dt, float32_t *F) {
+    const float32_t t0 = dt * dcm_t[0][0];
+    const float32_t t1 = dt * dcm_t[0][1];
+    const float32_t t2 = dt * dcm_t[0][2];
+    const float32_t t3 = dt * dcm_t[1][0];
+    const float32_t t4 = dt * dcm_t[1][1];
+    const float32_t t5 = dt * dcm_t[1][2];
+    const float32_t t6 = dt * dcm_t[2][0];
+    const float32_t t7 = dt * dcm_t[2][1];
+    const float32_t t8 = dt * dcm_t[2][2];
+    F[0] = 1.0f;
+    F[1] = t0;
+    F[2] = 0.0f;
+    F[3] = t1;
+    F[4] = 0.0f;
+    F[5] = t2;
+    F[6] = 0.0f;
+    F[7] = 0.0f;
+    F[8] = 1.0f;
+    F[9] = 0.0f;
+    F[10] = 0.0f;
+    F[11] = 0.0f;
+    F[12] = 0.0f;
+    F[13] = 0.0f;
+    F[14] = 0.0f;
+    F[15] = t3;
+    F[16] = 1.0f;
+    F[17] = t4;
+    F[18] = 0.0f;
+    F[19] = t5;
+    F[20] = 0.0f;
+    F[21] = 0.0f;
+    F[22] = 0.0f;
+    F[23] = 0.0f;
+    F[24] = 1.0f;
+    F[25] = 0.0f;
+    F[26] = 0.0f;
+    F[27] = 0.0f;
+    F[28] = 0.0f;
+    F[29] = t6;
+    F[30] = 0.0f;
+    F[31] = t7;
+    F[32] = 1.0f;
+    F[33] = t8;
+    F[34] = 0.0f;
+    F[35] = 0.0f;
+    F[36] = 0.0f;
+    F[37] = 0.0f;
+    F[38] = 0.0f;
+    F[39] = 0.0f;
+    F[40] = 1.0f;
+    F[41] = 0.0f;
+    F[42] = 0.0f;
+    F[43] = 0.0f;
+    F[44] = 0.0f;
+    F[45] = 0.0f;
+    F[46] = 0.0f;
+    F[47] = 0.0f;
+    F[48] = 1.0f;
+}
+
+/**
+ * @brief Covariance prediction, P_out = F P F' + Q
+ * @param F State transition Jacobian, only the entries that are not constant
+ *        are read
+ * @param Q Process noise, only the diagonal is read
+ * @param P Covariance
+ * @param P_out Receives the predicted covariance, may be P
+ * @details 72 multiplications, 79 additions, where the dense products take 686
+ *          and 637.
+ */
+void flight_ekf_model_predict_covariance(const float32_t *F, const float32_t *Q, const float32_t *P, float32_t *P_out) {
+    const float32_t t0 = P[10];
+    const float32_t t1 = P[12];
+    const float32_t t2 = P[1] + F[1] * P[8] + F[3] * t0 + F[5] * t1;
+    const float32_t t3 = P[26];
+    const float32_t t4 = P[3] + F[1] * t0 + F[3] * P[24] + F[5] * t3;
+    const float32_t t5 = P[5] + F[1] * t1 + F[3] * t3 + F[5] * P[40];
+    const float32_t t6 = P[0] + F[1] * P[1] + F[3] * P[3] + F[5] * P[5] + F[1] * t2 + F[3] * t4 + F[5] * t5 + Q[0];
+    const float32_t t7 = P[2] + F[1] * P[9] + F[3] * P[17] + F[5] * P[19] + F[15] * t2 + F[17] * t4 + F[19] * t5;
+    const float32_t t8 = P[4] + F[1] * P[11] + F[3] * P[25] + F[5] * P[33] + (F[29] * t2 + F[31] * t4) + F[33] * t5;
+    const float32_t t9 = P[13];
+    const float32_t t10 = P[27];
+    const float32_t t11 = P[41];
+    const float32_t t12 = P[6] + F[1] * t9 + F[3] * t10 + F[5] * t11;
+    const float32_t t13 = P[8] + Q[8];
+    const float32_t t14 = P[9] + F[15] * P[8] + F[17] * t0 + F[19] * t1;
+    const float32_t t15 = P[11] + (F[29] * P[8] + F[31] * t0) + F[33] * t1;
+    const float32_t t16 = P[17] + F[15] * t0 + F[17] * P[24] + F[19] * t3;
+    const float32_t t17 = P[19] + F[15] * t1 + F[17] * t3 + F[19] * P[40];
+    const float32_t t18 = P[16] + F[15] * P[9] + F[17] * P[17] + F[19] * P[19] + F[15] * t14 + F[17] * t16 + F[19] * t17 + Q[16];
+    const float32_t t19 = P[18] + F[15] * P[11] + F[17] * P[25] + F[19] * P[33] + (F[29] * t14 + F[31] * t16) + F[33] * t17;
+    const float32_t t20 = P[20] + F[15] * t9 + F[17] * t10 + F[19] * t11;
+    const float32_t t21 = P[24] + Q[24];
+    const float32_t t22 = P[25] + (F[29] * t0 + F[31] * P[24]) + F[33] * t3;
+    const float32_t t23 = P[33] + (F[29] * t1 + F[31] * t3) + F[33] * P[40];
+    const float32_t t24 = P[32] + (F[29] * P[11] + F[31] * P[25]) + F[33] * P[33] + (F[29] * t15 + F[31] * t22) + F[33] * t23 + Q[32];
+    const float32_t t25 = P[34] + (F[29] * t9 + F[31] * t10) + F[33] * t11;
+    const float32_t t26 = P[40] + Q[40];
+    const float32_t t27 = P[48] + Q[48];
+    P_out[0] = t6;
+    P_out[1] = P_out[7] = t2;
+    P_out[2] = P_out[14] = t7;
+    P_out[3] = P_out[21] = t4;
+    P_out[4] = P_out[28] = t8;
+    P_out[5] = P_out[35] = t5;
+    P_out[6] = P_out[42] = t12;
+    P_out[8] = t13;
+    P_out[9] = P_out[15] = t14;
+    P_out[10] = P_out[22] = t0;
+    P_out[11] = P_out[29] = t15;
+    P_out[12] = P_out[36] = t1;
+    P_out[13] = P_out[43] = t9;
+    P_out[16] = t18;
+    P_out[17] = P_out[23] = t16;
+    P_out[18] = P_out[30] = t19;
+    P_out[19] = P_out[37] = t17;
+    P_out[20] = P_out[44] = t20;
+    P_out[24] = t21;
+    P_out[25] = P_out[31] = t22;
+    P_out[26] = P_out[38] = t3;
+    P_out[27] = P_out[45] = t10;
+    P_out[32] = t24;
+    P_out[33] = P_out[39] = t23;
+    P_out[34] = P_out[46] = t25;
+    P_out[40] = t26;
+    P_out[41] = P_out[47] = t11;
+    P_out[48] = t27;
+}
+
+/**
+ * @brief Measurement predicted from the state, h = h(x)
+ * @param x State
+ * @param h Receives the 3 measurements
+ */
+void flight_ekf_model_h(const float32_t *x, float32_t *h) {
+    const float32_t t0 = x[0];
+    const float32_t t1 = x[2];
+    const float32_t t2 = x[4];
+    h[0] = t0;
+    h[1] = t1;
+    h[2] = t2;
+}
+
+/**
+ * @brief Jacobian of the measurement by the state, constant
+ * @param H Receives all 21 entries
+ */
+void flight_ekf_model_H(float32_t *H) {
+    H[0] = 1.0f;
+    H[1] = 0.0f;
+    H[2] = 0.0f;
+    H[3] = 0.0f;
+    H[4] = 0.0f;
+    H[5] = 0.0f;
+    H[6] = 0.0f;
+    H[7] = 0.0f;
+    H[8] = 0.0f;
+    H[9] = 1.0f;
+    H[10] = 0.0f;
+    H[11] = 0.0f;
+    H[12] = 0.0f;
+    H[13] = 0.0f;
+    H[14] = 0.0f;
+    H[15] = 0.0f;
+    H[16] = 0.0f;
+    H[17] = 0.0f;
+    H[18] = 1.0f;
+    H[19] = 0.0f;
+    H[20] = 0.0f;
+}
+
+/**
+ * @brief Kalman gain, K = P H' S^-1 with S = H P H' + R
+ * @param P Covariance
+ * @param R Measurement noise, only the diagonal is read
+ * @param K Receives the 7 by 3 gain
+ * @param S_inv Receives S^-1, for the normalized innovation squared
+ * @return ARM_MATH_SINGULAR if a pivot of S = L D L' is not positive, K and
+ *         S_inv are then left as they were
+ * @details S^-1 is taken from the factors as M' D^-1 M with M = L^-1. 75
+ *          multiplications, 54 additions and 3 divisions.
+ */
+arm_status flight_ekf_model_gain(const float32_t *P, const float32_t *R, float32_t *K, float32_t *S_inv) {
+    const float32_t t0 = P[0] + R[0];
+    if (!(t0 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t1 = 1.0f / t0;
+    const float32_t t2 = P[2] * t1;
+    const float32_t t3 = P[16] + R[4] - P[2] * t2;
+    if (!(t3 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t4 = P[4] * t1;
+    const float32_t t5 = P[18] - P[4] * t2;
+    const float32_t t6 = 1.0f / t3;
+    const float32_t t7 = t6 * t5;
+    const float32_t t8 = P[32] + R[8] - P[4] * t4 - t5 * t7;
+    if (!(t8 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t9 = -t2;
+    const float32_t t10 = t6 * t9;
+    const float32_t t11 = -(t4 + t7 * t9);
+    const float32_t t12 = 1.0f / t8;
+    const float32_t t13 = t12 * t11;
+    const float32_t t14 = t1 + t9 * t10 + t11 * t13;
+    const float32_t t15 = -t7;
+    const float32_t t16 = t10 + t15 * t13;
+    const float32_t t17 = P[2] * t16;
+    const float32_t t18 = P[4] * t13;
+    const float32_t t19 = P[0] * t14 + t17 + t18;
+    const float32_t t20 = t12 * t15;
+    const float32_t t21 = t6 + t15 * t20;
+    const float32_t t22 = P[0] * t16 + P[2] * t21 + P[4] * t20;
+    const float32_t t23 = P[0] * t13 + P[2] * t20 + P[4] * t12;
+    const float32_t t24 = P[1] * t14 + P[9] * t16 + P[11] * t13;
+    const float32_t t25 = P[1] * t16 + P[9] * t21 + P[11] * t20;
+    const float32_t t26 = P[1] * t13 + P[9] * t20 + P[11] * t12;
+    const float32_t t27 = P[2] * t14 + P[16] * t16 + P[18] * t13;
+    const float32_t t28 = P[18] * t20;
+    const float32_t t29 = t17 + P[16] * t21 + t28;
+    const float32_t t30 = P[2] * t13 + P[16] * t20 + P[18] * t12;
+    const float32_t t31 = P[3] * t14 + P[17] * t16 + P[25] * t13;
+    const float32_t t32 = P[3] * t16 + P[17] * t21 + P[25] * t20;
+    const float32_t t33 = P[3] * t13 + P[17] * t20 + P[25] * t12;
+    const float32_t t34 = P[4] * t14 + P[18] * t16 + P[32] * t13;
+    const float32_t t35 = P[4] * t16 + P[18] * t21 + P[32] * t20;
+    const float32_t t36 = t18 + t28 + P[32] * t12;
+    const float32_t t37 = P[5] * t14 + P[19] * t16 + P[33] * t13;
+    const float32_t t38 = P[5] * t16 + P[19] * t21 + P[33] * t20;
+    const float32_t t39 = P[5] * t13 + P[19] * t20 + P[33] * t12;
+    const float32_t t40 = P[6] * t14 + P[20] * t16 + P[34] * t13;
+    const float32_t t41 = P[6] * t16 + P[20] * t21 + P[34] * t20;
+    const float32_t t42 = P[6] * t13 + P[20] * t20 + P[34] * t12;
+    K[0] = t19;
+    K[1] = t22;
+    K[2] = t23;
+    K[3] = t24;
+    K[4] = t25;
+    K[5] = t26;
+    K[6] = t27;
+    K[7] = t29;
+    K[8] = t30;
+    K[9] = t31;
+    K[10] = t32;
+    K[11] = t33;
+    K[12] = t34;
+    K[13] = t35;
+    K[14] = t36;
+    K[15] = t37;
+    K[16] = t38;
+    K[17] = t39;
+    K[18] = t40;
+    K[19] = t41;
+    K[20] = t42;
+    S_inv[0] = t14;
+    S_inv[1] = S_inv[3] = t16;
+    S_inv[2] = S_inv[6] = t13;
+    S_inv[4] = t21;
+    S_inv[5] = S_inv[7] = t20;
+    S_inv[8] = t12;
+    return ARM_MATH_SUCCESS;
+}
+
+/**
+ * @brief State update, x_out = x + K innovation
+ * @param x State
+ * @param K Gain from flight_ekf_model_gain()
+ * @param innovation Measurement less h(x)
+ * @param x_out Receives the updated state, may be x
+ */
+void flight_ekf_model_update_state(const float32_t *x, const float32_t *K, const float32_t *innovation, float32_t *x_out) {
+    const float32_t t0 = x[0] + (innovation[0] * K[0] + innovation[1] * K[1] + innovation[2] * K[2]);
+    const float32_t t1 = x[1] + (innovation[0] * K[3] + innovation[1] * K[4] + innovation[2] * K[5]);
+    const float32_t t2 = x[2] + (innovation[0] * K[6] + innovation[1] * K[7] + innovation[2] * K[8]);
+    const float32_t t3 = x[3] + (innovation[0] * K[9] + innovation[1] * K[10] + innovation[2] * K[11]);
+    const float32_t t4 = x[4] + (innovation[0] * K[12] + innovation[1] * K[13] + innovation[2] * K[14]);
+    const float32_t t5 = x[5] + (innovation[0] * K[15] + innovation[1] * K[16] + innovation[2] * K[17]);
+    const float32_t t6 = x[6] + (innovation[0] * K[18] + innovation[1] * K[19] + innovation[2] * K[20]);
+    x_out[0] = t0;
+    x_out[1] = t1;
+    x_out[2] = t2;
+    x_out[3] = t3;
+    x_out[4] = t4;
+    x_out[5] = t5;
+    x_out[6] = t6;
+}
+
+/**
+ * @brief Joseph form covariance update, P_out = (I - K H) P (I - K H)' + K R K'
+ * @param P Covariance the gain was formed with
+ * @param K Gain from flight_ekf_model_gain()
+ * @param R Measurement noise, only the diagonal is read
+ * @param P_out Receives the updated covariance, may be P
+ * @details Expanded as P - K U' - U K' + K S K' with U = P H' and S = H U + R,
+ *          so the result is symmetric by construction. 252 multiplications, 276
+ *          additions.
+ */
+void flight_ekf_model_update_covariance(const float32_t *P, const float32_t *K, const float32_t *R, float32_t *P_out) {
+    const float32_t t0 = P[0] + R[0];
+    const float32_t t1 = P[2] * K[1];
+    const float32_t t2 = P[4] * K[2];
+    const float32_t t3 = t0 * K[0] + t1 + t2;
+    const float32_t t4 = P[2] * K[0];
+    const float32_t t5 = P[16] + R[4];
+    const float32_t t6 = P[18] * K[2];
+    const float32_t t7 = t4 + t5 * K[1] + t6;
+    const float32_t t8 = P[4] * K[0] + P[18] * K[1];
+    const float32_t t9 = P[32] + R[8];
+    const float32_t t10 = t8 + t9 * K[2];
+    const float32_t t11 = t2 + (t1 + P[0] * K[0]);
+    const float32_t t12 = K[0] * t3 + K[1] * t7 + K[2] * t10 + (P[0] - t11 - t11);
+    const float32_t t13 = P[4] * K[5];
+    const float32_t t14 = P[2] * K[4];
+    const float32_t t15 = K[3] * t3 + K[4] * t7 + K[5] * t10 + (P[1] - (P[1] * K[0] + P[9] * K[1] + P[11] * K[2]) - (t13 + (t14 + P[0] * K[3])));
+    const float32_t t16 = P[4] * K[8];
+    const float32_t t17 = P[2] * K[7];
+    const float32_t t18 = K[6] * t3 + K[7] * t7 + K[8] * t10 + (P[2] - (t6 + (t4 + P[16] * K[1])) - (t16 + (t17 + P[0] * K[6])));
+    const float32_t t19 = P[4] * K[11];
+    const float32_t t20 = P[2] * K[10];
+    const float32_t t21 = K[9] * t3 + K[10] * t7 + K[11] * t10 + (P[3] - (P[3] * K[0] + P[17] * K[1] + P[25] * K[2]) - (t19 + (t20 + P[0] * K[9])));
+    const float32_t t22 = P[4] * K[14];
+    const float32_t t23 = P[2] * K[13];
+    const float32_t t24 = K[12] * t3 + K[13] * t7 + K[14] * t10 + (P[4] - (t8 + P[32] * K[2]) - (t22 + (t23 + P[0] * K[12])));
+    const float32_t t25 = P[4] * K[17];
+    const float32_t t26 = P[2] * K[16];
+    const float32_t t27 = K[15] * t3 + K[16] * t7 + K[17] * t10 + (P[5] - (P[5] * K[0] + P[19] * K[1] + P[33] * K[2]) - (t25 + (t26 + P[0] * K[15])));
+    const float32_t t28 = P[4] * K[20];
+    const float32_t t29 = P[2] * K[19];
+    const float32_t t30 = K[18] * t3 + K[19] * t7 + K[20] * t10 + (P[6] - (P[6] * K[0] + P[20] * K[1] + P[34] * K[2]) - (t28 + (t29 + P[0] * K[18])));
+    const float32_t t31 = t0 * K[3] + t14 + t13;
+    const float32_t t32 = P[2] * K[3];
+    const float32_t t33 = P[18] * K[5];
+    const float32_t t34 = t32 + t5 * K[4] + t33;
+    const float32_t t35 = P[4] * K[3] + P[18] * K[4];
+    const float32_t t36 = t35 + t9 * K[5];
+    const float32_t t37 = P[1] * K[3] + P[9] * K[4] + P[11] * K[5];
+    const float32_t t38 = K[3] * t31 + K[4] * t34 + K[5] * t36 + (P[8] - t37 - t37);
+    const float32_t t39 = K[6] * t31 + K[7] * t34 + K[8] * t36 + (P[9] - (t33 + (t32 + P[16] * K[4])) - (P[1] * K[6] + P[9] * K[7] + P[11] * K[8]));
+    const float32_t t40 = K[9] * t31 + K[10] * t34 + K[11] * t36 + (P[10] - (P[3] * K[3] + P[17] * K[4] + P[25] * K[5]) - (P[1] * K[9] + P[9] * K[10] + P[11] * K[11]));
+    const float32_t t41 = K[12] * t31 + K[13] * t34 + K[14] * t36 + (P[11] - (t35 + P[32] * K[5]) - (P[1] * K[12] + P[9] * K[13] + P[11] * K[14]));
+    const float32_t t42 = K[15] * t31 + K[16] * t34 + K[17] * t36 + (P[12] - (P[5] * K[3] + P[19] * K[4] + P[33] * K[5]) - (P[1] * K[15] + P[9] * K[16] + P[11] * K[17]));
+    const float32_t t43 = K[18] * t31 + K[19] * t34 + K[20] * t36 + (P[13] - (P[6] * K[3] + P[20] * K[4] + P[34] * K[5]) - (P[1] * K[18] + P[9] * K[19] + P[11] * K[20]));
+    const float32_t t44 = t0 * K[6] + t17 + t16;
+    const float32_t t45 = P[2] * K[6];
+    const float32_t t46 = P[18] * K[8];
+    const float32_t t47 = t45 + t5 * K[7] + t46;
+    const float32_t t48 = P[4] * K[6] + P[18] * K[7];
+    const float32_t t49 = t48 + t9 * K[8];
+    const float32_t t50 = t46 + (t45 + P[16] * K[7]);
+    const float32_t t51 = K[6] * t44 + K[7] * t47 + K[8] * t49 + (P[16] - t50 - t50);
+    const float32_t t52 = P[18] * K[11];
+    const float32_t t53 = P[2] * K[9];
+    const float32_t t54 = K[9] * t44 + K[10] * t47 + K[11] * t49 + (P[17] - (P[3] * K[6] + P[17] * K[7] + P[25] * K[8]) - (t52 + (t53 + P[16] * K[10])));
+    const float32_t t55 = P[18] * K[14];
+    const float32_t t56 = P[2] * K[12];
+    const float32_t t57 = K[12] * t44 + K[13] * t47 + K[14] * t49 + (P[18] - (t48 + P[32] * K[8]) - (t55 + (t56 + P[16] * K[13])));
+    const float32_t t58 = P[18] * K[17];
+    const float32_t t59 = P[2] * K[15];
+    const float32_t t60 = K[15] * t44 + K[16] * t47 + K[17] * t49 + (P[19] - (P[5] * K[6] + P[19] * K[7] + P[33] * K[8]) - (t58 + (t59 + P[16] * K[16])));
+    const float32_t t61 = P[18] * K[20];
+    const float32_t t62 = P[2] * K[18];
+    const float32_t t63 = K[18] * t44 + K[19] * t47 + K[20] * t49 + (P[20] - (P[6] * K[6] + P[20] * K[7] + P[34] * K[8]) - (t61 + (t62 + P[16] * K[19])));
+    const float32_t t64 = t0 * K[9] + t20 + t19;
+    const float32_t t65 = t53 + t5 * K[10] + t52;
+    const float32_t t66 = P[4] * K[9] + P[18] * K[10];
+    const float32_t t67 = t66 + t9 * K[11];
+    const float32_t t68 = P[3] * K[9] + P[17] * K[10] + P[25] * K[11];
+    const float32_t t69 = K[9] * t64 + K[10] * t65 + K[11] * t67 + (P[24] - t68 - t68);
+    const float32_t t70 = K[12] * t64 + K[13] * t65 + K[14] * t67 + (P[25] - (t66 + P[32] * K[11]) - (P[3] * K[12] + P[17] * K[13] + P[25] * K[14]));
+    const float32_t t71 = K[15] * t64 + K[16] * t65 + K[17] * t67 + (P[26] - (P[5] * K[9] + P[19] * K[10] + P[33] * K[11]) - (P[3] * K[15] + P[17] * K[16] + P[25] * K[17]));
+    const float32_t t72 = K[18] * t64 + K[19] * t65 + K[20] * t67 + (P[27] - (P[6] * K[9] + P[20] * K[10] + P[34] * K[11]) - (P[3] * K[18] + P[17] * K[19] + P[25] * K[20]));
+    const float32_t t73 = t0 * K[12] + t23 + t22;
+    const float32_t t74 = t56 + t5 * K[13] + t55;
+    const float32_t t75 = P[4] * K[12] + P[18] * K[13];
+    const float32_t t76 = t75 + t9 * K[14];
+    const float32_t t77 = t75 + P[32] * K[14];
+    const float32_t t78 = K[12] * t73 + K[13] * t74 + K[14] * t76 + (P[32] - t77 - t77);
+    const float32_t t79 = P[4] * K[15] + P[18] * K[16];
+    const float32_t t80 = K[15] * t73 + K[16] * t74 + K[17] * t76 + (P[33] - (P[5] * K[12] + P[19] * K[13] + P[33] * K[14]) - (t79 + P[32] * K[17]));
+    const float32_t t81 = P[4] * K[18] + P[18] * K[19];
+    const float32_t t82 = K[18] * t73 + K[19] * t74 + K[20] * t76 + (P[34] - (P[6] * K[12] + P[20] * K[13] + P[34] * K[14]) - (t81 + P[32] * K[20]));
+    const float32_t t83 = t0 * K[15] + t26 + t25;
+    const float32_t t84 = t59 + t5 * K[16] + t58;
+    const float32_t t85 = t79 + t9 * K[17];
+    const float32_t t86 = P[5] * K[15] + P[19] * K[16] + P[33] * K[17];
+    const float32_t t87 = K[15] * t83 + K[16] * t84 + K[17] * t85 + (P[40] - t86 - t86);
+    const float32_t t88 = K[18] * t83 + K[19] * t84 + K[20] * t85 + (P[41] - (P[6] * K[15] + P[20] * K[16] + P[34] * K[17]) - (P[5] * K[18] + P[19] * K[19] + P[33] * K[20]));
+    const float32_t t89 = P[6] * K[18] + P[20] * K[19] + P[34] * K[20];
+    const float32_t t90 = K[18] * (t0 * K[18] + t29 + t28) + K[19] * (t62 + t5 * K[19] + t61) + K[20] * (t81 + t9 * K[20]) + (P[48] - t89 - t89);
+    P_out[0] = t12;
+    P_out[1] = P_out[7] = t15;
+    P_out[2] = P_out[14] = t18;
+    P_out[3] = P_out[21] = t21;
+    P_out[4] = P_out[28] = t24;
+    P_out[5] = P_out[35] = t27;
+    P_out[6] = P_out[42] = t30;
+    P_out[8] = t38;
+    P_out[9] = P_out[15] = t39;
+    P_out[10] = P_out[22] = t40;
+    P_out[11] = P_out[29] = t41;
+    P_out[12] = P_out[36] = t42;
+    P_out[13] = P_out[43] = t43;
+    P_out[16] = t51;
+    P_out[17] = P_out[23] = t54;
+    P_out[18] = P_out[30] = t57;
+    P_out[19] = P_out[37] = t60;
+    P_out[20] = P_out[44] = t63;
+    P_out[24] = t69;
+    P_out[25] = P_out[31] = t70;
+    P_out[26] = P_out[38] = t71;
+    P_out[27] = P_out[45] = t72;
+    P_out[32] = t78;
+    P_out[33] = P_out[39] = t80;
+    P_out[34] = P_out[46] = t82;
+    P_out[40] = t87;
+    P_out[41] = P_out[47] = t88;
+    P_out[48] = t90;
+}
+
@@ -0,0 +1,185 @@
+/**
+ * @file gnss_origin.c
+ * @brief Cached local tangent frame for converting GNSS fixes to ENU
+ *
+ * @details With M and N the meridian and prime vertical radii at the origin,
+ *          the ECEF offset of a point dlat, dlon, dh away is expanded to
+ *          second order and projected on the origin's east, north and up
+ *          vectors:
+ *
+ *            e = dlon ((N + h) cos(lat) - (M + h) sin(lat) dlat + cos(lat) dh)
+ *            n = dlat ((M + h) + M' dlat / 2 + dh) + (N + h) cos(lat) sin(lat) dlon^2 / 2
+ *            u = dh - (M + h) dlat^2 / 2 - (N + h) cos(lat)^2 dlon^2 / 2
+ *
+ *          The coefficients are evaluated in double once and kept as float.
+ */
+
+#include <math.h>
+
+#include "gnss_origin.h"
+
+static int64_t gnss_round(double value) {
+    return (int64_t)llround(value);
+}
+
+// Only 3D fixes within the receiver's accuracy masks carry a usable height
+static uint8_t gnss_fix_ok(uint8_t fix_type, uint8_t flags) {
+    return (fix_type == GNSS_FIX_TYPE_3D || fix_type == GNSS_FIX_TYPE_GNSS_DR) && (flags & GNSS_FLAGS_FIX_OK);
+}
+
+// The velocity of a solution, in mm/s, only queued for the filter if the solution is valid
+static void gnss_fix_velocity(GpsFix *fix, int32_t vel_n, int32_t vel_e, int32_t vel_d, uint32_t s_acc) {
+    fix->vel_ned[0] = (float32_t)vel_n * 1e-3f;
+    fix->vel_ned[1] = (float32_t)vel_e * 1e-3f;
+    fix->vel_ned[2] = (float32_t)vel_d * 1e-3f;
+    fix->vel_acc = (float32_t)s_acc * 1e-3f;
+    fix->vel_new = fix->valid;
+}
+
+/**
+ * @brief Copies a UBX-NAV-HPPVT position and velocity into a fix
+ * @param fix Receives the position in 1e-9 deg and 0.1 mm and the velocity in m/s
+ * @param hppvt Decoded message
+ */
+void gnss_fix_from_hppvt(GpsFix *fix, const struct ublox_gnss_nav_hppvt *hppvt) {
+    fix->lat = (int64_t)hppvt->lat * 100 + hppvt->latHp;
+    fix->lon = (int64_t)hppvt->lon * 100 + hppvt->lonHp;
+    fix->height = (int64_t)hppvt->height * 10 + hppvt->heightHp;
+    fix->valid = gnss_fix_ok(hppvt->fixType, hppvt->flags);
+    fix->pos_new = fix->valid;
+    gnss_fix_velocity(fix, hppvt->velN, hppvt->velE, hppvt->velD, hppvt->sAcc);
+}
+
+/**
+ * @brief Copies a UBX-NAV-PVT position and velocity into a fix
+ * @param fix Receives the position in 1e-9 deg and 0.1 mm and the velocity in m/s
+ * @param pvt Decoded message
+ */
+void gnss_fix_from_pvt(GpsFix *fix, const struct ublox_gnss_nav_pvt *pvt) {
+    fix->lat = (int64_t)pvt->lat * 100;
+    fix->lon = (int64_t)pvt->lon * 100;
+    fix->height = (int64_t)pvt->height * 10;
+    fix->valid = gnss_fix_ok(pvt->fix_type, pvt->flags);
+    fix->pos_new = fix->valid;
+    gnss_fix_velocity(fix, pvt->vel_n, pvt->vel_e, pvt->vel_d, pvt->s_acc);
+}
+
+/**
+ * @brief Copies a UBX-NAV-VELNED velocity into a fix
+ * @param fix Receives the velocity in m/s, its position is left alone
+ * @param velned Decoded message
+ * @details NAV-VELNED carries no fix flags, so the velocity is taken as valid
+ *          as the last position.
+ */
+void gnss_fix_from_velned(GpsFix *fix, const struct ublox_gnss_nav_velned *velned) {
+    gnss_fix_velocity(fix, velned->vel_n, velned->vel_e, velned->vel_d, velned->s_acc);
+}
+
+/**
+ * @brief Fills a fix from degrees and metres, for sources without UBX messages
+ * @param fix Receives the position in 1e-9 deg and 0.1 mm, marked valid and
+ *        new, with no velocity
+ * @param lat Latitude in degrees
+ * @param lon Longitude in degrees
+ * @param height Height above the ellipsoid in metres
+ */
+void gnss_fix_from_degrees(GpsFix *fix, double lat, double lon, double height) {
+    fix->lat = gnss_round(lat * 1e9);
+    fix->lon = gnss_round(lon * 1e9);
+    fix->height = gnss_round(height * 1e4);
+    fix->valid = 1;
+    fix->pos_new = 1;
+    fix->vel_new = 0;
+}
+
+/**
+ * @brief Makes a fix the origin of the local frame
+ * @param origin Receives the cached transform
+ * @param fix Origin position
+ * @return 1 if the origin was set, 0 if the fix is not valid and the origin
+ *         was left unchanged
+ * @details The only place that evaluates trigonometric functions, call once
+ *          when the launch position is fixed.
+ */
+uint8_t gnss_origin_set(GnssOrigin *origin, const GpsFix *fix) {
+    if (!fix->valid) {
+        return 0;
+    }
+
+    double lat = fix->lat * GNSS_DEG_E9_TO_RAD;
+    double lon = fix->lon * GNSS_DEG_E9_TO_RAD;
+    double h = fix->height * GNSS_E4_TO_M;
+
+    double slat = sin(lat);
+    double clat = cos(lat);
+    double slon = sin(lon);
+    double clon = cos(lon);
+
+    double w2 = 1.0 - GNSS_WGS84_E2 * slat * slat;
+    double N = GNSS_WGS84_A / sqrt(w2);
+    double M = N * (1.0 - GNSS_WGS84_E2) / w2;
+    double dM = 3.0 * M * GNSS_WGS84_E2 * slat * clat / w2;
+
+    origin->lat = fix->lat;
+    origin->lon = fix->lon;
+    origin->height = fix->height;
+    origin->ecef[0] = gnss_round((N + h) * clat * clon / GNSS_E4_TO_M);
+    origin->ecef[1] = gnss_round((N + h) * clat * slon / GNSS_E4_TO_M);
+    origin->ecef[2] = gnss_round((N * (1.0 - GNSS_WGS84_E2) + h) * slat / GNSS_E4_TO_M);
+
+    origin->rot[0][0] = -slon;
+    origin->rot[0][1] = clon;
+    origin->rot[0][2] = 0.0f;
+    origin->rot[1][0] = -slat * clon;
+    origin->rot[1][1] = -slat * slon;
+    origin->rot[1][2] = clat;
+    origin->rot[2][0] = clat * clon;
+    origin->rot[2][1] = clat * slon;
+    origin->rot[2][2] = slat;
+
+    origin->e_lam = (N + h) * clat;
+    origin->e_lam_phi = -(M + h) * slat;
+    origin->e_lam_h = clat;
+    origin->n_phi = M + h;
+    origin->n_phi_phi = 0.5 * dM;
+    origin->n_lam_lam = 0.5 * (N + h) * clat * slat;
+    origin->u_phi_phi = -0.5 * (M + h);
+    origin->u_lam_lam = -0.5 * (N + h) * clat * clat;
+
+    origin->valid = 1;
+    return 1;
+}
+
+/**
+ * @brief Converts a geodetic fix to east, north, up about the origin
+ * @param origin Cached transform
+ * @param fix Position from HPPVT, PVT or gnss_fix_from_degrees()
+ * @param enu Receives east, north, up in metres
+ */
+void gnss_origin_fix_to_enu(const GnssOrigin *origin, const GpsFix *fix, float32_t enu[3]) {
+    float32_t dphi = (float32_t)(fix->lat - origin->lat) * (float32_t)GNSS_DEG_E9_TO_RAD;
+    float32_t dlam = (float32_t)(fix->lon - origin->lon) * (float32_t)GNSS_DEG_E9_TO_RAD;
+    float32_t dh = (float32_t)(fix->height - origin->height) * (float32_t)GNSS_E4_TO_M;
+
+    enu[0] = dlam * (origin->e_lam + origin->e_lam_phi * dphi + origin->e_lam_h * dh);
+    enu[1] = dphi * (origin->n_phi + origin->n_phi_phi * dphi + dh) + origin->n_lam_lam * dlam * dlam;
+    enu[2] = dh + origin->u_phi_phi * dphi * dphi + origin->u_lam_lam * dlam * dlam;
+}
+
+/**
+ * @brief Converts a UBX-NAV-HPPOSECEF position to east, north, up about the origin
+ * @param origin Cached transform
+ * @param ecef Decoded message, cm plus 0.1 mm high precision parts
+ * @param enu Receives east, north, up in metres
+ */
+void gnss_origin_hpposecef_to_enu(const GnssOrigin *origin, const struct ublox_gnss_nav_hpposecef *ecef, float32_t enu[3]) {
+    float32_t d[3];
+
+    d[0] = (float32_t)((int64_t)ecef->ecefX * 100 + ecef->ecefXHp - origin->ecef[0]) * (float32_t)GNSS_E4_TO_M;
+    d[1] = (float32_t)((int64_t)ecef->ecefY * 100 + ecef->ecefYHp - origin->ecef[1]) * (float32_t)GNSS_E4_TO_M;
+    d[2] = (float32_t)((int64_t)ecef->ecefZ * 100 + ecef->ecefZHp - origin->ecef[2]) * (float32_t)GNSS_E4_TO_M;
+
+    for (int i = 0; i < 3; i++) {
+        enu[i] = origin->rot[i][0] * d[0] + origin->rot[i][1] * d[1] + origin->rot[i][2] * d[2];
+    }
+}
@@ -10,6 +10,7 @@
 
 #include "ground_ekf.h"
 #include "gekf_constants.h"
+#include "ground_ekf_model.h"
 
 /**
  * @brief Converts GPS coordinates to flat Earth frame for ground-based navigation
@@ -163,6 +164,57 @@ void make_measurement_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *hua
 
 
 
+/**
+ * @brief Maps the state to the accelerometer and gyro measurements
+ * @param ekf Pointer to the ground EKF structure
+ * @param huart Pointer to UART handle for debug output
+ */
+void observation_function_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
+    ground_ekf_model_h(ekf->x_prev.pData, ekf->h.pData);
+    //print_matrix("Observation (h)", &ekf->h, huart);
+}
+
+/**
+ * @brief Forms the Jacobian of observation_function_ground()
+ * @param ekf Pointer to the ground EKF structure
+ * @param huart Pointer to UART handle for debug output
+ */
+void observation_jacobian_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
+    ground_ekf_model_H(ekf->dhdx_data);
+    arm_mat_init_f32(&ekf->dhdx, ekf->nz, ekf->nx, ekf->dhdx_data);
+    //print_matrix("H matrix", &ekf->dhdx, huart);
+}
+
+/**
+ * @brief Propagates the state, on the pad the state is held constant
+ * @param ekf Pointer to the ground EKF structure
+ * @param huart Pointer to UART handle for debug output
+ */
+void state_transition_function_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
+    ground_ekf_model_f(ekf->x_n.pData, ekf->f.pData);
+}
+
+/**
+ * @brief Forms the Jacobian of state_transition_function_ground()
+ * @param ekf Pointer to the ground EKF structure
+ * @param huart Pointer to UART handle for debug output
+ */
+void state_transition_jacobian_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
+    ground_ekf_model_F(ekf->dfdx_data);
+    arm_mat_init_f32(&ekf->dfdx, ekf->nx, ekf->nx, ekf->dfdx_data);
+    //print_matrix("F (State Transition Jacobian)", &ekf->dfdx, huart);
+}
+
+/**
+ * @brief Predicts the next state from state_transition_function_ground()
+ * @param ekf Pointer to the ground EKF structure
+ * @param huart Pointer to UART handle for debug output
+ */
+void predict_state_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
+    memcpy(ekf->x_next_data, ekf->f.pData, sizeof(float32_t) * ekf->nx);
+    arm_mat_init_f32(&ekf->x_next, ekf->nx, 1, ekf->x_next_data);
+}
+
 /**
  * @brief This function computes the Kalman gain, which is a relative measure of trust between the measurements and the dynamics;
  *  in this case, the Kalman gain weighs the accelerometer against the GPS
@@ -172,82 +224,25 @@ void make_measurement_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *hua
 */
 arm_status kalman_gain_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
     arm_status result = ARM_MATH_SUCCESS;
-    
-    arm_matrix_instance_f32 R_mat = ekf->R;
-    arm_mat_init_f32(&HP_ground, ekf->nz, ekf->nx, HP_f32_ground);
-    arm_mat_init_f32(&Ht_ground, ekf->nx, ekf->nz, Ht_f32_ground);
-    arm_mat_init_f32(&HPHt_ground, ekf->nz, ekf->nz, HPHt_f32_ground);
-    arm_mat_init_f32(&HPHtR_ground, ekf->nz, ekf->nz, HPHtR_f32_ground);
-    arm_mat_init_f32(&HPHtRi_ground, ekf->nz, ekf->nz, HPHtRi_f32_ground);
-    arm_mat_init_f32(&PHt_ground, ekf->nx, ekf->nz, PHt_f32_ground);
-    arm_mat_init_f32(&K_new_ground, ekf->nx, ekf->nz, K_f32_ground);
-
-
-    arm_matrix_instance_f32 H = ekf->dhdx;
-    arm_matrix_instance_f32 P = ekf->P_prev;
 
     HAL_UART_Transmit(huart, (uint8_t*)"Starting Kalman gain calculation...\r\n", 37, HAL_MAX_DELAY);
 
-    //print_matrix("H matrix", &H, huart);
-    //print_matrix("P matrix", &P, huart);
-    //print_matrix("R matrix", &R_mat, huart);
-
-    // Compute HP
-    result = arm_mat_mult_f32(&H, &P, &HP_ground);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in HP calculation\r\n", 25, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("HP matrix", &HP, huart);
-    check_for_nan("HP matrix", &HP_ground, huart);
-
-    // Compute Ht
-    result = arm_mat_trans_f32(&H, &Ht_ground);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in Ht calculation\r\n", 25, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("Ht matrix", &Ht, huart);
-
-    // Compute HPHt
-    result = arm_mat_mult_f32(&HP_ground, &Ht_ground, &HPHt_ground);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in HPHt calculation\r\n", 27, HAL_MAX_DELAY);
-        return result;
+    // The kernels are unrolled for the accelerometer and gyro model
+    if (ekf->nx != GROUND_EKF_MODEL_NX || ekf->nz != GROUND_EKF_MODEL_NZ) {
+        HAL_UART_Transmit(huart, (uint8_t*)"Error in K calculation\r\n", 24, HAL_MAX_DELAY);
+        return ARM_MATH_SIZE_MISMATCH;
     }
-    //print_matrix("HPHt matrix", &HPHt, huart);
 
-    // Compute HPHt + R
-    result = arm_mat_add_f32(&HPHt_ground, &R_mat, &HPHtR_ground);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in HPHt + R calculation\r\n", 31, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("HPHt + R matrix", &HPHtR, huart);
+    //print_matrix("P matrix", &ekf->P_prev, huart);
+    //print_matrix("R matrix", &ekf->R, huart);
 
-    // Compute (HPHt + R)^-1
-    result = arm_mat_inverse_f32(&HPHtR_ground, &HPHtRi_ground);
+    // K = P H' (H P H' + R)^-1 through an LDL' factorization of H P H' + R
+    arm_mat_init_f32(&HPHtRi_ground, ekf->nz, ekf->nz, HPHtRi_f32_ground);
+    result = ground_ekf_model_gain(ekf->P_prev.pData, ekf->R.pData, ekf->K_n_data, HPHtRi_f32_ground);
     if (result != ARM_MATH_SUCCESS) {
         HAL_UART_Transmit(huart, (uint8_t*)"Error in (HPHt + R)^-1 calculation\r\n", 37, HAL_MAX_DELAY);
         return result;
     }
-    //print_matrix("(HPHt + R)^-1 matrix", &HPHtRi, huart);
-
-    // Compute PHt
-    result = arm_mat_mult_f32(&P, &Ht_ground, &PHt_ground);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in PHt calculation\r\n", 26, HAL_MAX_DELAY);
-        return result;
-    }
-    //print_matrix("PHt matrix", &PHt, huart);
-
-    // Compute K
-    result = arm_mat_mult_f32(&PHt_ground, &HPHtRi_ground, &K_new_ground);
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in K calculation\r\n", 24, HAL_MAX_DELAY);
-        return result;
-    }
-    memcpy(ekf->K_n_data, K_new_ground.pData, sizeof(float32_t) * ekf->nx * ekf->nz);
     arm_mat_init_f32(&ekf->K_n, ekf->nx, ekf->nz, ekf->K_n_data);
     //print_matrix("K (Kalman gain) matrix", &ekf->K_n, huart);
     HAL_UART_Transmit(huart, (uint8_t*)"Kalman gain calculation complete.\r\n", 35, HAL_MAX_DELAY);
@@ -266,16 +261,7 @@ void update_state_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart)
     //print_matrix("Kalman gain K at start of update_state", &ekf->K_n, huart);
     check_for_nan("Kalman gain K at start", &ekf->K_n, huart);
 
-    arm_status result = ARM_MATH_SUCCESS;
-    float32_t innovation[ekf->nz];
-    float32_t state_correction[ekf->nx];
-    arm_matrix_instance_f32 innovation_mat = {ekf->nz, 1, innovation};
-    arm_matrix_instance_f32 state_correction_mat = {ekf->nx, 1, state_correction};
-
-    // Print H, P_, and R
-    //print_matrix("Observation matrix H", &ekf->dhdx, huart);
-    //print_matrix("Previous covariance P_", &ekf->P_prev, huart);
-    //print_matrix("Measurement noise covariance R", &ekf->R, huart);
+    float32_t innovation[GROUND_EKF_MODEL_NZ];
 
     // Print z, h, and x_prev
     //print_matrix("Measurement z", &ekf->z, huart);
@@ -283,22 +269,15 @@ void update_state_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart)
     //print_matrix("Previous state x_prev", &ekf->x_prev, huart);
 
     // Compute innovation (z - h)
-    result |= arm_mat_sub_f32(&ekf->z, &ekf->h, &innovation_mat);
-    //print_matrix("Innovation (z - h)", &innovation_mat, huart);
-
-    // Compute state correction K * (z - h)
-    result |= arm_mat_mult_f32(&ekf->K_n, &innovation_mat, &state_correction_mat);
-    //print_matrix("State correction K*(z - h)", &state_correction_mat, huart);
+    for (int i = 0; i < GROUND_EKF_MODEL_NZ; i++) {
+        innovation[i] = ekf->z.pData[i] - ekf->h.pData[i];
+    }
 
     // Update state: x_n = x_prev + K * (z - h)
-    result |= arm_mat_add_f32(&ekf->x_prev, &state_correction_mat, &ekf->x_n);
+    ground_ekf_model_update_state(ekf->x_prev.pData, ekf->K_n_data, innovation, ekf->x_n.pData);
     //print_matrix("Updated state x_n", &ekf->x_n, huart);
 
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in state update\r\n", 23, HAL_MAX_DELAY);
-    } else {
-        HAL_UART_Transmit(huart, (uint8_t*)"State update completed successfully\r\n", 37, HAL_MAX_DELAY);
-    }
+    HAL_UART_Transmit(huart, (uint8_t*)"State update completed successfully\r\n", 37, HAL_MAX_DELAY);
 
     //print_matrix("Kalman gain K at end of update_state", &ekf->K_n, huart);
     check_for_nan("Kalman gain K at end", &ekf->K_n, huart);
@@ -316,52 +295,10 @@ void update_covariance_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *hu
     //print_matrix("Kalman gain K at start of update_covariance", &ekf->K_n, huart);
     check_for_nan("Kalman gain K at start", &ekf->K_n, huart);
 
-    arm_status result = ARM_MATH_SUCCESS;
-    float32_t I_KH[ekf->nx * ekf->nx];
-    float32_t temp[ekf->nx * ekf->nx];
-    arm_matrix_instance_f32 I_KH_mat = {ekf->nx, ekf->nx, I_KH};
-    arm_matrix_instance_f32 temp_mat = {ekf->nx, ekf->nx, temp};
-
-    // Print H, P_, and R
-    //print_matrix("Observation matrix H", &ekf->dhdx, huart);
-    //print_matrix("Previous covariance P_", &ekf->P_prev, huart);
-    //print_matrix("Measurement noise covariance R", &ekf->R, huart);
-
-    // Compute KH
-    result |= arm_mat_mult_f32(&ekf->K_n, &ekf->dhdx, &I_KH_mat);
-    //print_matrix("KH", &I_KH_mat, huart);
-
-    // Compute I - KH
-    for (int i = 0; i < ekf->nx * ekf->nx; i++) {
-        I_KH[i] = (i % (ekf->nx + 1) == 0) ? 1.0f - I_KH[i] : -I_KH[i];
-    }
-    //print_matrix("I - KH", &I_KH_mat, huart);
-
-    // Compute (I - KH) * P_prev
-    result |= arm_mat_mult_f32(&I_KH_mat, &ekf->P_prev, &temp_mat);
-    //print_matrix("(I - KH) * P_prev", &temp_mat, huart);
-
-    // Compute P_n = (I - KH) * P_prev * (I - KH)'
-    result |= arm_mat_mult_f32(&temp_mat, &I_KH_mat, &ekf->P_n);
-    //print_matrix("P_n before adding KRK'", &ekf->P_n, huart);
-
-    // Compute K * R
-    float32_t KR[ekf->nx * ekf->nz];
-    arm_matrix_instance_f32 KR_mat = {ekf->nx, ekf->nz, KR};
-    result |= arm_mat_mult_f32(&ekf->K_n, &ekf->R, &KR_mat);
-    //print_matrix("K * R", &KR_mat, huart);
-
-    // Compute K * R * K'
-    result |= arm_mat_mult_f32(&KR_mat, &(arm_matrix_instance_f32){ekf->nz, ekf->nx, ekf->K_n.pData}, &temp_mat);
-    //print_matrix("K * R * K'", &temp_mat, huart);
-
-    // Add K * R * K' to P_n
-    result |= arm_mat_add_f32(&ekf->P_n, &temp_mat, &ekf->P_n);
+    // Joseph form P_n = (I - KH) P_prev (I - KH)' + K R K', written out symmetric
+    ground_ekf_model_update_covariance(ekf->P_prev.pData, ekf->K_n_data, ekf->R.pData, ekf->P_n_data);
+    arm_mat_init_f32(&ekf->P_n, ekf->nx, ekf->nx, ekf->P_n_data);
     for (int i = 0; i < ekf->nx; i++) {
-        for (int j = 0; j <= i; j++) {
-            float value = (ekf->P_n.pData[i * ekf->nx + j] + ekf->P_n.pData[j * ekf->nx + i]) * 0.5;
-            ekf->P_n.pData[i * ekf->nx + j] = ekf->P_n.pData[j * ekf->nx + i] = value;
-        }
         // Ensure positive diagonal elements
         if (ekf->P_n.pData[i * ekf->nx + i] <= 0) {
             ekf->P_n.pData[i * ekf->nx + i] = 1e-6;
@@ -369,11 +306,7 @@ void update_covariance_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *hu
     }
     //print_matrix("Final P_n", &ekf->P_n, huart);
 
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in covariance update\r\n", 29, HAL_MAX_DELAY);
-    } else {
-        HAL_UART_Transmit(huart, (uint8_t*)"Covariance update completed successfully\r\n", 42, HAL_MAX_DELAY);
-    }
+    HAL_UART_Transmit(huart, (uint8_t*)"Covariance update completed successfully\r\n", 42, HAL_MAX_DELAY);
 
     //print_matrix("Kalman gain K at end of update_covariance", &ekf->K_n, huart);
     check_for_nan("Kalman gain K at end", &ekf->K_n, huart);
@@ -388,57 +321,18 @@ void update_covariance_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *hu
 void predict_covariance_ground(GroundExtKalmanFilter *ekf, UART_HandleTypeDef *huart) {
     HAL_UART_Transmit(huart, (uint8_t*)"Starting covariance prediction...\r\n", 35, HAL_MAX_DELAY);
 
-    arm_status result = ARM_MATH_SUCCESS;
-
-    arm_matrix_instance_f32 P = ekf->P_n;
-    arm_matrix_instance_f32 F = ekf->dfdx;
-    arm_matrix_instance_f32 Q_mat = ekf->Q;
+    //print_matrix("Current covariance (P)", &ekf->P_n, huart);
+    //print_matrix("Process noise covariance (Q)", &ekf->Q, huart);
 
-    //print_matrix("Current covariance (P)", &P, huart);
-    //print_matrix("State transition Jacobian (F)", &F, huart);
-    //print_matrix("Process noise covariance (Q)", &Q_mat, huart);
+    // P_next = F P F' + Q, with F = I this is P + Q
+    ground_ekf_model_predict_covariance(ekf->dfdx.pData, ekf->Q.pData, ekf->P_n.pData, ekf->P_next_data);
 
-    float32_t Ft_f32[ekf->nx * ekf->nx];
-    float32_t FP_f32[ekf->nx * ekf->nx];
-    float32_t FPFt_f32[ekf->nx * ekf->nx];
-    float32_t P_future_f32[ekf->nx * ekf->nx];
-
-    arm_matrix_instance_f32 Ft, FP, FPFt, P_future;
-
-    arm_mat_init_f32(&Ft, ekf->nx, ekf->nx, Ft_f32);
-    arm_mat_init_f32(&FP, ekf->nx, ekf->nx, FP_f32);
-    arm_mat_init_f32(&FPFt, ekf->nx, ekf->nx, FPFt_f32);
-    arm_mat_init_f32(&P_future, ekf->nx, ekf->nx, P_future_f32);
-
-    // Compute FP
-    result |= arm_mat_mult_f32(&F, &P, &FP);
-    //print_matrix("FP", &FP, huart);
-
-    // Compute Ft
-    result |= arm_mat_trans_f32(&F, &Ft);
-    //print_matrix("F transpose (Ft)", &Ft, huart);
-
-    // Compute FPFt
-    result |= arm_mat_mult_f32(&FP, &Ft, &FPFt);
-    //print_matrix("FPFt", &FPFt, huart);
-
-    // Compute P_next = FPFt + Q
-    result |= arm_mat_add_f32(&FPFt, &Q_mat, &P_future);
-    //print_matrix("P_future before regularization", &P_future, huart);
-
-    // Copy P_future data to P_next_data
-    memcpy(ekf->P_next_data, P_future.pData, sizeof(float32_t) * ekf->nx * ekf->nx);
-    
     // Reinitialize P_next with the updated data
     arm_mat_init_f32(&ekf->P_next, ekf->nx, ekf->nx, ekf->P_next_data);
 
     //print_matrix("Predicted covariance (P_next)", &ekf->P_next, huart);
 
-    if (result != ARM_MATH_SUCCESS) {
-        HAL_UART_Transmit(huart, (uint8_t*)"Error in covariance prediction calculations\r\n", 45, HAL_MAX_DELAY);
-    } else {
-        HAL_UART_Transmit(huart, (uint8_t*)"Covariance prediction completed successfully.\r\n", 47, HAL_MAX_DELAY);
-    }
+    HAL_UART_Transmit(huart, (uint8_t*)"Covariance prediction completed successfully.\r\n", 47, HAL_MAX_DELAY);
 }
 
 /**
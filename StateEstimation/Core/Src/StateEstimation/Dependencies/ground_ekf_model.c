@@ -0,0 +1,658 @@
+/**
+ * @file ground_ekf_model.c
+ * @brief Unrolled kernels of the ground EKF model, generated by EkfGen
+ *
+ * @details Do not edit, run make -C EkfGen export instead. Ground EKF, x = [x,
+ *          vx, y, vy, z, vz] held between updates and measured directly.
+ *          Matrices are row major, covariances are read from their upper
+ *          triangle and written whole.
+ */
+
+#include "ground_ekf_model.h"
+
+/**
+ * @brief State transition, f = f(x)
+ * @param x State
+ * @param f Receives the predicted state, may be x
+ * @details 0 multiplications, 0 additions.
+ */
+void ground_ekf_model_f(const float32_t *x, float32_t *f) {
+    const float32_t t0 = x[0];
+    const float32_t t1 = x[1];
+    const float32_t t2 = x[2];
+    const float32_t t3 = x[3];
+    const float32_t t4 = x[4];
+    const float32_t t5 = x[5];
+    f[0] = t0;
+    f[1] = t1;
+    f[2] = t2;
+    f[3] = t3;
+    f[4] = t4;
+    f[5] = t5;
+}
+
+/**
+ * @brief Jacobian of the state transition by the state
+ * @param F Receives all 36 entries, those that are structurally 0 or 1 as
+ *        constants
+ * @details 0 multiplications, 0 additions.
+ */
+void ground_ekf_model_F(float32_t *F) {
+    F[0] = 1.0f;
+    F[1] = 0.0f;
+    F[2] = 0.0f;
+    F[3] = 0.0f;
+    F[4] = 0.0f;
+    F[5] = 0.0f;
+    F[6] = 0.0f;
+    F[7] = 1.0f;
+    F[8] = 0.0f;
+    F[9] = 0.0f;
+    F[10] = 0.0f;
+    F[11] = 0.0f;
+    F[12] = 0.0f;
+    F[13] = 0.0f;
+    F[14] = 1.0f;
+    F[15] = 0.0f;
+    F[16] = 0.0f;
+    F[17] = 0.0f;
+    F[18] = 0.0f;
+    F[19] = 0.0f;
+    F[20] = 0.0f;
+    F[21] = 1.0f;
+    F[22] = 0.0f;
+    F[23] = 0.0f;
+    F[24] = 0.0f;
+    F[25] = 0.0f;
+    F[26] = 0.0f;
+    F[27] = 0.0f;
+    F[28] = 1.0f;
+    F[29] = 0.0f;
+    F[30] = 0.0f;
+    F[31] = 0.0f;
+    F[32] = 0.0f;
+    F[33] = 0.0f;
+    F[34] = 0.0f;
+    F[35] = 1.0f;
+}
+
+/**
+ * @brief Covariance prediction, P_out = F P F' + Q
+ * @param F State transition Jacobian, only the entries that are not constant
+ *        are read
+ * @param Q Process noise, only the diagonal is read
+ * @param P Covariance
+ * @param P_out Receives the predicted covariance, may be P
+ * @details 0 multiplications, 6 additions, where the dense products take 432
+ *          and 396.
+ */
+void ground_ekf_model_predict_covariance(const float32_t *F, const float32_t *Q, const float32_t *P, float32_t *P_out) {
+    const float32_t t0 = P[0] + Q[0];
+    const float32_t t1 = P[1];
+    const float32_t t2 = P[2];
+    const float32_t t3 = P[3];
+    const float32_t t4 = P[4];
+    const float32_t t5 = P[5];
+    const float32_t t6 = P[7] + Q[7];
+    const float32_t t7 = P[8];
+    const float32_t t8 = P[9];
+    const float32_t t9 = P[10];
+    const float32_t t10 = P[11];
+    const float32_t t11 = P[14] + Q[14];
+    const float32_t t12 = P[15];
+    const float32_t t13 = P[16];
+    const float32_t t14 = P[17];
+    const float32_t t15 = P[21] + Q[21];
+    const float32_t t16 = P[22];
+    const float32_t t17 = P[23];
+    const float32_t t18 = P[28] + Q[28];
+    const float32_t t19 = P[29];
+    const float32_t t20 = P[35] + Q[35];
+    P_out[0] = t0;
+    P_out[1] = P_out[6] = t1;
+    P_out[2] = P_out[12] = t2;
+    P_out[3] = P_out[18] = t3;
+    P_out[4] = P_out[24] = t4;
+    P_out[5] = P_out[30] = t5;
+    P_out[7] = t6;
+    P_out[8] = P_out[13] = t7;
+    P_out[9] = P_out[19] = t8;
+    P_out[10] = P_out[25] = t9;
+    P_out[11] = P_out[31] = t10;
+    P_out[14] = t11;
+    P_out[15] = P_out[20] = t12;
+    P_out[16] = P_out[26] = t13;
+    P_out[17] = P_out[32] = t14;
+    P_out[21] = t15;
+    P_out[22] = P_out[27] = t16;
+    P_out[23] = P_out[33] = t17;
+    P_out[28] = t18;
+    P_out[29] = P_out[34] = t19;
+    P_out[35] = t20;
+}
+
+/**
+ * @brief Measurement predicted from the state, h = h(x)
+ * @param x State
+ * @param h Receives the 6 measurements
+ */
+void ground_ekf_model_h(const float32_t *x, float32_t *h) {
+    const float32_t t0 = x[0];
+    const float32_t t1 = x[1];
+    const float32_t t2 = x[2];
+    const float32_t t3 = x[3];
+    const float32_t t4 = x[4];
+    const float32_t t5 = x[5];
+    h[0] = t0;
+    h[1] = t1;
+    h[2] = t2;
+    h[3] = t3;
+    h[4] = t4;
+    h[5] = t5;
+}
+
+/**
+ * @brief Jacobian of the measurement by the state, constant
+ * @param H Receives all 36 entries
+ */
+void ground_ekf_model_H(float32_t *H) {
+    H[0] = 1.0f;
+    H[1] = 0.0f;
+    H[2] = 0.0f;
+    H[3] = 0.0f;
+    H[4] = 0.0f;
+    H[5] = 0.0f;
+    H[6] = 0.0f;
+    H[7] = 1.0f;
+    H[8] = 0.0f;
+    H[9] = 0.0f;
+    H[10] = 0.0f;
+    H[11] = 0.0f;
+    H[12] = 0.0f;
+    H[13] = 0.0f;
+    H[14] = 1.0f;
+    H[15] = 0.0f;
+    H[16] = 0.0f;
+    H[17] = 0.0f;
+    H[18] = 0.0f;
+    H[19] = 0.0f;
+    H[20] = 0.0f;
+    H[21] = 1.0f;
+    H[22] = 0.0f;
+    H[23] = 0.0f;
+    H[24] = 0.0f;
+    H[25] = 0.0f;
+    H[26] = 0.0f;
+    H[27] = 0.0f;
+    H[28] = 1.0f;
+    H[29] = 0.0f;
+    H[30] = 0.0f;
+    H[31] = 0.0f;
+    H[32] = 0.0f;
+    H[33] = 0.0f;
+    H[34] = 0.0f;
+    H[35] = 1.0f;
+}
+
+/**
+ * @brief Kalman gain, K = P H' S^-1 with S = H P H' + R
+ * @param P Covariance
+ * @param R Measurement noise, only the diagonal is read
+ * @param K Receives the 6 by 6 gain
+ * @param S_inv Receives S^-1, for the normalized innovation squared
+ * @return ARM_MATH_SINGULAR if a pivot of S = L D L' is not positive, K and
+ *         S_inv are then left as they were
+ * @details S^-1 is taken from the factors as M' D^-1 M with M = L^-1. 321
+ *          multiplications, 276 additions and 6 divisions.
+ */
+arm_status ground_ekf_model_gain(const float32_t *P, const float32_t *R, float32_t *K, float32_t *S_inv) {
+    const float32_t t0 = P[0] + R[0];
+    if (!(t0 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t1 = 1.0f / t0;
+    const float32_t t2 = P[1] * t1;
+    const float32_t t3 = P[7] + R[7] - P[1] * t2;
+    if (!(t3 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t4 = P[2] * t1;
+    const float32_t t5 = P[8] - P[2] * t2;
+    const float32_t t6 = 1.0f / t3;
+    const float32_t t7 = t6 * t5;
+    const float32_t t8 = P[14] + R[14] - P[2] * t4 - t5 * t7;
+    if (!(t8 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t9 = P[3] * t1;
+    const float32_t t10 = P[9] - P[3] * t2;
+    const float32_t t11 = t6 * t10;
+    const float32_t t12 = P[15] - P[3] * t4 - t7 * t10;
+    const float32_t t13 = 1.0f / t8;
+    const float32_t t14 = t13 * t12;
+    const float32_t t15 = P[21] + R[21] - P[3] * t9 - t10 * t11 - t12 * t14;
+    if (!(t15 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t16 = P[4] * t1;
+    const float32_t t17 = P[10] - P[4] * t2;
+    const float32_t t18 = t6 * t17;
+    const float32_t t19 = P[16] - P[4] * t4 - t7 * t17;
+    const float32_t t20 = t13 * t19;
+    const float32_t t21 = P[22] - P[4] * t9 - t11 * t17 - t14 * t19;
+    const float32_t t22 = 1.0f / t15;
+    const float32_t t23 = t22 * t21;
+    const float32_t t24 = P[28] + R[28] - P[4] * t16 - t17 * t18 - t19 * t20 - t21 * t23;
+    if (!(t24 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t25 = P[5] * t1;
+    const float32_t t26 = P[11] - P[5] * t2;
+    const float32_t t27 = t6 * t26;
+    const float32_t t28 = P[17] - P[5] * t4 - t7 * t26;
+    const float32_t t29 = t13 * t28;
+    const float32_t t30 = P[23] - P[5] * t9 - t11 * t26 - t14 * t28;
+    const float32_t t31 = t22 * t30;
+    const float32_t t32 = P[29] - P[5] * t16 - t18 * t26 - t20 * t28 - t23 * t30;
+    const float32_t t33 = 1.0f / t24;
+    const float32_t t34 = t33 * t32;
+    const float32_t t35 = P[35] + R[35] - P[5] * t25 - t26 * t27 - t28 * t29 - t30 * t31 - t32 * t34;
+    if (!(t35 > 0.0f)) {
+        return ARM_MATH_SINGULAR;
+    }
+    const float32_t t36 = -t2;
+    const float32_t t37 = t6 * t36;
+    const float32_t t38 = -(t4 + t7 * t36);
+    const float32_t t39 = t13 * t38;
+    const float32_t t40 = -(t9 + t11 * t36 + t14 * t38);
+    const float32_t t41 = t22 * t40;
+    const float32_t t42 = -(t16 + t18 * t36 + t20 * t38 + t23 * t40);
+    const float32_t t43 = t33 * t42;
+    const float32_t t44 = -(t25 + t27 * t36 + t29 * t38 + t31 * t40 + t34 * t42);
+    const float32_t t45 = 1.0f / t35;
+    const float32_t t46 = t45 * t44;
+    const float32_t t47 = t1 + t36 * t37 + t38 * t39 + t40 * t41 + t42 * t43 + t44 * t46;
+    const float32_t t48 = -t7;
+    const float32_t t49 = -(t11 + t14 * t48);
+    const float32_t t50 = -(t18 + t20 * t48 + t23 * t49);
+    const float32_t t51 = -(t27 + t29 * t48 + t31 * t49 + t34 * t50);
+    const float32_t t52 = t37 + t48 * t39 + t49 * t41 + t50 * t43 + t51 * t46;
+    const float32_t t53 = P[1] * t52;
+    const float32_t t54 = -t14;
+    const float32_t t55 = -(t20 + t23 * t54);
+    const float32_t t56 = -(t29 + t31 * t54 + t34 * t55);
+    const float32_t t57 = t39 + t54 * t41 + t55 * t43 + t56 * t46;
+    const float32_t t58 = P[2] * t57;
+    const float32_t t59 = -t23;
+    const float32_t t60 = -(t31 + t34 * t59);
+    const float32_t t61 = t41 + t59 * t43 + t60 * t46;
+    const float32_t t62 = P[3] * t61;
+    const float32_t t63 = -t34;
+    const float32_t t64 = t43 + t63 * t46;
+    const float32_t t65 = P[4] * t64;
+    const float32_t t66 = P[5] * t46;
+    const float32_t t67 = P[0] * t47 + t53 + t58 + t62 + t65 + t66;
+    const float32_t t68 = t13 * t48;
+    const float32_t t69 = t22 * t49;
+    const float32_t t70 = t33 * t50;
+    const float32_t t71 = t45 * t51;
+    const float32_t t72 = t6 + t48 * t68 + t49 * t69 + t50 * t70 + t51 * t71;
+    const float32_t t73 = t68 + t54 * t69 + t55 * t70 + t56 * t71;
+    const float32_t t74 = t69 + t59 * t70 + t60 * t71;
+    const float32_t t75 = t70 + t63 * t71;
+    const float32_t t76 = P[0] * t52 + P[1] * t72 + P[2] * t73 + P[3] * t74 + P[4] * t75 + P[5] * t71;
+    const float32_t t77 = t22 * t54;
+    const float32_t t78 = t33 * t55;
+    const float32_t t79 = t45 * t56;
+    const float32_t t80 = t13 + t54 * t77 + t55 * t78 + t56 * t79;
+    const float32_t t81 = t77 + t59 * t78 + t60 * t79;
+    const float32_t t82 = t78 + t63 * t79;
+    const float32_t t83 = P[0] * t57 + P[1] * t73 + P[2] * t80 + P[3] * t81 + P[4] * t82 + P[5] * t79;
+    const float32_t t84 = t33 * t59;
+    const float32_t t85 = t45 * t60;
+    const float32_t t86 = t22 + t59 * t84 + t60 * t85;
+    const float32_t t87 = t84 + t63 * t85;
+    const float32_t t88 = P[0] * t61 + P[1] * t74 + P[2] * t81 + P[3] * t86 + P[4] * t87 + P[5] * t85;
+    const float32_t t89 = t45 * t63;
+    const float32_t t90 = t33 + t63 * t89;
+    const float32_t t91 = P[0] * t64 + P[1] * t75 + P[2] * t82 + P[3] * t87 + P[4] * t90 + P[5] * t89;
+    const float32_t t92 = P[0] * t46 + P[1] * t71 + P[2] * t79 + P[3] * t85 + P[4] * t89 + P[5] * t45;
+    const float32_t t93 = P[1] * t47 + P[7] * t52 + P[8] * t57 + P[9] * t61 + P[10] * t64 + P[11] * t46;
+    const float32_t t94 = P[8] * t73;
+    const float32_t t95 = P[9] * t74;
+    const float32_t t96 = P[10] * t75;
+    const float32_t t97 = P[11] * t71;
+    const float32_t t98 = t53 + P[7] * t72 + t94 + t95 + t96 + t97;
+    const float32_t t99 = P[1] * t57 + P[7] * t73 + P[8] * t80 + P[9] * t81 + P[10] * t82 + P[11] * t79;
+    const float32_t t100 = P[1] * t61 + P[7] * t74 + P[8] * t81 + P[9] * t86 + P[10] * t87 + P[11] * t85;
+    const float32_t t101 = P[1] * t64 + P[7] * t75 + P[8] * t82 + P[9] * t87 + P[10] * t90 + P[11] * t89;
+    const float32_t t102 = P[1] * t46 + P[7] * t71 + P[8] * t79 + P[9] * t85 + P[10] * t89 + P[11] * t45;
+    const float32_t t103 = P[2] * t47 + P[8] * t52 + P[14] * t57 + P[15] * t61 + P[16] * t64 + P[17] * t46;
+    const float32_t t104 = P[2] * t52 + P[8] * t72 + P[14] * t73 + P[15] * t74 + P[16] * t75 + P[17] * t71;
+    const float32_t t105 = P[15] * t81;
+    const float32_t t106 = P[16] * t82;
+    const float32_t t107 = P[17] * t79;
+    const float32_t t108 = t58 + t94 + P[14] * t80 + t105 + t106 + t107;
+    const float32_t t109 = P[2] * t61 + P[8] * t74 + P[14] * t81 + P[15] * t86 + P[16] * t87 + P[17] * t85;
+    const float32_t t110 = P[2] * t64 + P[8] * t75 + P[14] * t82 + P[15] * t87 + P[16] * t90 + P[17] * t89;
+    const float32_t t111 = P[2] * t46 + P[8] * t71 + P[14] * t79 + P[15] * t85 + P[16] * t89 + P[17] * t45;
+    const float32_t t112 = P[3] * t47 + P[9] * t52 + P[15] * t57 + P[21] * t61 + P[22] * t64 + P[23] * t46;
+    const float32_t t113 = P[3] * t52 + P[9] * t72 + P[15] * t73 + P[21] * t74 + P[22] * t75 + P[23] * t71;
+    const float32_t t114 = P[3] * t57 + P[9] * t73 + P[15] * t80 + P[21] * t81 + P[22] * t82 + P[23] * t79;
+    const float32_t t115 = P[22] * t87;
+    const float32_t t116 = P[23] * t85;
+    const float32_t t117 = t105 + (t62 + t95) + P[21] * t86 + t115 + t116;
+    const float32_t t118 = P[3] * t64 + P[9] * t75 + P[15] * t82 + P[21] * t87 + P[22] * t90 + P[23] * t89;
+    const float32_t t119 = P[3] * t46 + P[9] * t71 + P[15] * t79 + P[21] * t85 + P[22] * t89 + P[23] * t45;
+    const float32_t t120 = P[4] * t47 + P[10] * t52 + P[16] * t57 + P[22] * t61 + P[28] * t64 + P[29] * t46;
+    const float32_t t121 = P[4] * t52 + P[10] * t72 + P[16] * t73 + P[22] * t74 + P[28] * t75 + P[29] * t71;
+    const float32_t t122 = P[4] * t57 + P[10] * t73 + P[16] * t80 + P[22] * t81 + P[28] * t82 + P[29] * t79;
+    const float32_t t123 = P[4] * t61 + P[10] * t74 + P[16] * t81 + P[22] * t86 + P[28] * t87 + P[29] * t85;
+    const float32_t t124 = P[29] * t89;
+    const float32_t t125 = t115 + (t106 + (t65 + t96)) + P[28] * t90 + t124;
+    const float32_t t126 = P[4] * t46 + P[10] * t71 + P[16] * t79 + P[22] * t85 + P[28] * t89 + P[29] * t45;
+    const float32_t t127 = P[5] * t47 + P[11] * t52 + P[17] * t57 + P[23] * t61 + P[29] * t64 + P[35] * t46;
+    const float32_t t128 = P[5] * t52 + P[11] * t72 + P[17] * t73 + P[23] * t74 + P[29] * t75 + P[35] * t71;
+    const float32_t t129 = P[5] * t57 + P[11] * t73 + P[17] * t80 + P[23] * t81 + P[29] * t82 + P[35] * t79;
+    const float32_t t130 = P[5] * t61 + P[11] * t74 + P[17] * t81 + P[23] * t86 + P[29] * t87 + P[35] * t85;
+    const float32_t t131 = P[5] * t64 + P[11] * t75 + P[17] * t82 + P[23] * t87 + P[29] * t90 + P[35] * t89;
+    const float32_t t132 = t124 + (t116 + (t107 + (t66 + t97))) + P[35] * t45;
+    K[0] = t67;
+    K[1] = t76;
+    K[2] = t83;
+    K[3] = t88;
+    K[4] = t91;
+    K[5] = t92;
+    K[6] = t93;
+    K[7] = t98;
+    K[8] = t99;
+    K[9] = t100;
+    K[10] = t101;
+    K[11] = t102;
+    K[12] = t103;
+    K[13] = t104;
+    K[14] = t108;
+    K[15] = t109;
+    K[16] = t110;
+    K[17] = t111;
+    K[18] = t112;
+    K[19] = t113;
+    K[20] = t114;
+    K[21] = t117;
+    K[22] = t118;
+    K[23] = t119;
+    K[24] = t120;
+    K[25] = t121;
+    K[26] = t122;
+    K[27] = t123;
+    K[28] = t125;
+    K[29] = t126;
+    K[30] = t127;
+    K[31] = t128;
+    K[32] = t129;
+    K[33] = t130;
+    K[34] = t131;
+    K[35] = t132;
+    S_inv[0] = t47;
+    S_inv[1] = S_inv[6] = t52;
+    S_inv[2] = S_inv[12] = t57;
+    S_inv[3] = S_inv[18] = t61;
+    S_inv[4] = S_inv[24] = t64;
+    S_inv[5] = S_inv[30] = t46;
+    S_inv[7] = t72;
+    S_inv[8] = S_inv[13] = t73;
+    S_inv[9] = S_inv[19] = t74;
+    S_inv[10] = S_inv[25] = t75;
+    S_inv[11] = S_inv[31] = t71;
+    S_inv[14] = t80;
+    S_inv[15] = S_inv[20] = t81;
+    S_inv[16] = S_inv[26] = t82;
+    S_inv[17] = S_inv[32] = t79;
+    S_inv[21] = t86;
+    S_inv[22] = S_inv[27] = t87;
+    S_inv[23] = S_inv[33] = t85;
+    S_inv[28] = t90;
+    S_inv[29] = S_inv[34] = t89;
+    S_inv[35] = t45;
+    return ARM_MATH_SUCCESS;
+}
+
+/**
+ * @brief State update, x_out = x + K innovation
+ * @param x State
+ * @param K Gain from ground_ekf_model_gain()
+ * @param innovation Measurement less h(x)
+ * @param x_out Receives the updated state, may be x
+ */
+void ground_ekf_model_update_state(const float32_t *x, const float32_t *K, const float32_t *innovation, float32_t *x_out) {
+    const float32_t t0 = x[0] + (innovation[0] * K[0] + innovation[1] * K[1] + innovation[2] * K[2] + innovation[3] * K[3] + innovation[4] * K[4] + innovation[5] * K[5]);
+    const float32_t t1 = x[1] + (innovation[0] * K[6] + innovation[1] * K[7] + innovation[2] * K[8] + innovation[3] * K[9] + innovation[4] * K[10] + innovation[5] * K[11]);
+    const float32_t t2 = x[2] + (innovation[0] * K[12] + innovation[1] * K[13] + innovation[2] * K[14] + innovation[3] * K[15] + innovation[4] * K[16] + innovation[5] * K[17]);
+    const float32_t t3 = x[3] + (innovation[0] * K[18] + innovation[1] * K[19] + innovation[2] * K[20] + innovation[3] * K[21] + innovation[4] * K[22] + innovation[5] * K[23]);
+    const float32_t t4 = x[4] + (innovation[0] * K[24] + innovation[1] * K[25] + innovation[2] * K[26] + innovation[3] * K[27] + innovation[4] * K[28] + innovation[5] * K[29]);
+    const float32_t t5 = x[5] + (innovation[0] * K[30] + innovation[1] * K[31] + innovation[2] * K[32] + innovation[3] * K[33] + innovation[4] * K[34] + innovation[5] * K[35]);
+    x_out[0] = t0;
+    x_out[1] = t1;
+    x_out[2] = t2;
+    x_out[3] = t3;
+    x_out[4] = t4;
+    x_out[5] = t5;
+}
+
+/**
+ * @brief Joseph form covariance update, P_out = (I - K H) P (I - K H)' + K R K'
+ * @param P Covariance the gain was formed with
+ * @param K Gain from ground_ekf_model_gain()
+ * @param R Measurement noise, only the diagonal is read
+ * @param P_out Receives the updated covariance, may be P
+ * @details Expanded as P - K U' - U K' + K S K' with U = P H' and S = H U + R,
+ *          so the result is symmetric by construction. 378 multiplications, 474
+ *          additions.
+ */
+void ground_ekf_model_update_covariance(const float32_t *P, const float32_t *K, const float32_t *R, float32_t *P_out) {
+    const float32_t t0 = P[0] + R[0];
+    const float32_t t1 = P[1] * K[1];
+    const float32_t t2 = P[2] * K[2];
+    const float32_t t3 = P[3] * K[3];
+    const float32_t t4 = P[4] * K[4];
+    const float32_t t5 = P[5] * K[5];
+    const float32_t t6 = t0 * K[0] + t1 + t2 + t3 + t4 + t5;
+    const float32_t t7 = P[1] * K[0];
+    const float32_t t8 = P[7] + R[7];
+    const float32_t t9 = P[8] * K[2];
+    const float32_t t10 = P[9] * K[3];
+    const float32_t t11 = P[10] * K[4];
+    const float32_t t12 = P[11] * K[5];
+    const float32_t t13 = t7 + t8 * K[1] + t9 + t10 + t11 + t12;
+    const float32_t t14 = P[2] * K[0] + P[8] * K[1];
+    const float32_t t15 = P[14] + R[14];
+    const float32_t t16 = P[15] * K[3];
+    const float32_t t17 = P[16] * K[4];
+    const float32_t t18 = P[17] * K[5];
+    const float32_t t19 = t14 + t15 * K[2] + t16 + t17 + t18;
+    const float32_t t20 = P[3] * K[0] + P[9] * K[1] + P[15] * K[2];
+    const float32_t t21 = P[21] + R[21];
+    const float32_t t22 = P[22] * K[4];
+    const float32_t t23 = P[23] * K[5];
+    const float32_t t24 = t20 + t21 * K[3] + t22 + t23;
+    const float32_t t25 = P[4] * K[0] + P[10] * K[1] + P[16] * K[2] + P[22] * K[3];
+    const float32_t t26 = P[28] + R[28];
+    const float32_t t27 = P[29] * K[5];
+    const float32_t t28 = t25 + t26 * K[4] + t27;
+    const float32_t t29 = P[5] * K[0] + P[11] * K[1] + P[17] * K[2] + P[23] * K[3] + P[29] * K[4];
+    const float32_t t30 = P[35] + R[35];
+    const float32_t t31 = t29 + t30 * K[5];
+    const float32_t t32 = t5 + (t4 + (t3 + (t2 + (t1 + P[0] * K[0]))));
+    const float32_t t33 = K[0] * t6 + K[1] * t13 + K[2] * t19 + K[3] * t24 + K[4] * t28 + K[5] * t31 + (P[0] - t32 - t32);
+    const float32_t t34 = P[5] * K[11];
+    const float32_t t35 = P[4] * K[10];
+    const float32_t t36 = P[3] * K[9];
+    const float32_t t37 = P[2] * K[8];
+    const float32_t t38 = P[1] * K[7];
+    const float32_t t39 = K[6] * t6 + K[7] * t13 + K[8] * t19 + K[9] * t24 + K[10] * t28 + K[11] * t31 + (P[1] - (t12 + (t11 + (t10 + (t9 + (t7 + P[7] * K[1]))))) - (t34 + (t35 + (t36 + (t37 + (t38 + P[0] * K[6]))))));
+    const float32_t t40 = P[5] * K[17];
+    const float32_t t41 = P[4] * K[16];
+    const float32_t t42 = P[3] * K[15];
+    const float32_t t43 = P[2] * K[14];
+    const float32_t t44 = P[1] * K[13];
+    const float32_t t45 = K[12] * t6 + K[13] * t13 + K[14] * t19 + K[15] * t24 + K[16] * t28 + K[17] * t31 + (P[2] - (t18 + (t17 + (t16 + (t14 + P[14] * K[2])))) - (t40 + (t41 + (t42 + (t43 + (t44 + P[0] * K[12]))))));
+    const float32_t t46 = P[5] * K[23];
+    const float32_t t47 = P[4] * K[22];
+    const float32_t t48 = P[3] * K[21];
+    const float32_t t49 = P[2] * K[20];
+    const float32_t t50 = P[1] * K[19];
+    const float32_t t51 = K[18] * t6 + K[19] * t13 + K[20] * t19 + K[21] * t24 + K[22] * t28 + K[23] * t31 + (P[3] - (t23 + (t22 + (t20 + P[21] * K[3]))) - (t46 + (t47 + (t48 + (t49 + (t50 + P[0] * K[18]))))));
+    const float32_t t52 = P[5] * K[29];
+    const float32_t t53 = P[4] * K[28];
+    const float32_t t54 = P[3] * K[27];
+    const float32_t t55 = P[2] * K[26];
+    const float32_t t56 = P[1] * K[25];
+    const float32_t t57 = K[24] * t6 + K[25] * t13 + K[26] * t19 + K[27] * t24 + K[28] * t28 + K[29] * t31 + (P[4] - (t27 + (t25 + P[28] * K[4])) - (t52 + (t53 + (t54 + (t55 + (t56 + P[0] * K[24]))))));
+    const float32_t t58 = P[5] * K[35];
+    const float32_t t59 = P[4] * K[34];
+    const float32_t t60 = P[3] * K[33];
+    const float32_t t61 = P[2] * K[32];
+    const float32_t t62 = P[1] * K[31];
+    const float32_t t63 = K[30] * t6 + K[31] * t13 + K[32] * t19 + K[33] * t24 + K[34] * t28 + K[35] * t31 + (P[5] - (t29 + P[35] * K[5]) - (t58 + (t59 + (t60 + (t61 + (t62 + P[0] * K[30]))))));
+    const float32_t t64 = t0 * K[6] + t38 + t37 + t36 + t35 + t34;
+    const float32_t t65 = P[1] * K[6];
+    const float32_t t66 = P[8] * K[8];
+    const float32_t t67 = P[9] * K[9];
+    const float32_t t68 = P[10] * K[10];
+    const float32_t t69 = P[11] * K[11];
+    const float32_t t70 = t65 + t8 * K[7] + t66 + t67 + t68 + t69;
+    const float32_t t71 = P[2] * K[6] + P[8] * K[7];
+    const float32_t t72 = P[15] * K[9];
+    const float32_t t73 = P[16] * K[10];
+    const float32_t t74 = P[17] * K[11];
+    const float32_t t75 = t71 + t15 * K[8] + t72 + t73 + t74;
+    const float32_t t76 = P[3] * K[6] + P[9] * K[7] + P[15] * K[8];
+    const float32_t t77 = P[22] * K[10];
+    const float32_t t78 = P[23] * K[11];
+    const float32_t t79 = t76 + t21 * K[9] + t77 + t78;
+    const float32_t t80 = P[4] * K[6] + P[10] * K[7] + P[16] * K[8] + P[22] * K[9];
+    const float32_t t81 = P[29] * K[11];
+    const float32_t t82 = t80 + t26 * K[10] + t81;
+    const float32_t t83 = P[5] * K[6] + P[11] * K[7] + P[17] * K[8] + P[23] * K[9] + P[29] * K[10];
+    const float32_t t84 = t83 + t30 * K[11];
+    const float32_t t85 = t69 + (t68 + (t67 + (t66 + (t65 + P[7] * K[7]))));
+    const float32_t t86 = K[6] * t64 + K[7] * t70 + K[8] * t75 + K[9] * t79 + K[10] * t82 + K[11] * t84 + (P[7] - t85 - t85);
+    const float32_t t87 = P[11] * K[17];
+    const float32_t t88 = P[10] * K[16];
+    const float32_t t89 = P[9] * K[15];
+    const float32_t t90 = P[8] * K[14];
+    const float32_t t91 = P[1] * K[12];
+    const float32_t t92 = K[12] * t64 + K[13] * t70 + K[14] * t75 + K[15] * t79 + K[16] * t82 + K[17] * t84 + (P[8] - (t74 + (t73 + (t72 + (t71 + P[14] * K[8])))) - (t87 + (t88 + (t89 + (t90 + (t91 + P[7] * K[13]))))));
+    const float32_t t93 = P[11] * K[23];
+    const float32_t t94 = P[10] * K[22];
+    const float32_t t95 = P[9] * K[21];
+    const float32_t t96 = P[8] * K[20];
+    const float32_t t97 = P[1] * K[18];
+    const float32_t t98 = K[18] * t64 + K[19] * t70 + K[20] * t75 + K[21] * t79 + K[22] * t82 + K[23] * t84 + (P[9] - (t78 + (t77 + (t76 + P[21] * K[9]))) - (t93 + (t94 + (t95 + (t96 + (t97 + P[7] * K[19]))))));
+    const float32_t t99 = P[11] * K[29];
+    const float32_t t100 = P[10] * K[28];
+    const float32_t t101 = P[9] * K[27];
+    const float32_t t102 = P[8] * K[26];
+    const float32_t t103 = P[1] * K[24];
+    const float32_t t104 = K[24] * t64 + K[25] * t70 + K[26] * t75 + K[27] * t79 + K[28] * t82 + K[29] * t84 + (P[10] - (t81 + (t80 + P[28] * K[10])) - (t99 + (t100 + (t101 + (t102 + (t103 + P[7] * K[25]))))));
+    const float32_t t105 = P[11] * K[35];
+    const float32_t t106 = P[10] * K[34];
+    const float32_t t107 = P[9] * K[33];
+    const float32_t t108 = P[8] * K[32];
+    const float32_t t109 = P[1] * K[30];
+    const float32_t t110 = K[30] * t64 + K[31] * t70 + K[32] * t75 + K[33] * t79 + K[34] * t82 + K[35] * t84 + (P[11] - (t83 + P[35] * K[11]) - (t105 + (t106 + (t107 + (t108 + (t109 + P[7] * K[31]))))));
+    const float32_t t111 = t0 * K[12] + t44 + t43 + t42 + t41 + t40;
+    const float32_t t112 = t91 + t8 * K[13] + t90 + t89 + t88 + t87;
+    const float32_t t113 = P[2] * K[12] + P[8] * K[13];
+    const float32_t t114 = P[15] * K[15];
+    const float32_t t115 = P[16] * K[16];
+    const float32_t t116 = P[17] * K[17];
+    const float32_t t117 = t113 + t15 * K[14] + t114 + t115 + t116;
+    const float32_t t118 = P[3] * K[12] + P[9] * K[13] + P[15] * K[14];
+    const float32_t t119 = P[22] * K[16];
+    const float32_t t120 = P[23] * K[17];
+    const float32_t t121 = t118 + t21 * K[15] + t119 + t120;
+    const float32_t t122 = P[4] * K[12] + P[10] * K[13] + P[16] * K[14] + P[22] * K[15];
+    const float32_t t123 = P[29] * K[17];
+    const float32_t t124 = t122 + t26 * K[16] + t123;
+    const float32_t t125 = P[5] * K[12] + P[11] * K[13] + P[17] * K[14] + P[23] * K[15] + P[29] * K[16];
+    const float32_t t126 = t125 + t30 * K[17];
+    const float32_t t127 = t116 + (t115 + (t114 + (t113 + P[14] * K[14])));
+    const float32_t t128 = K[12] * t111 + K[13] * t112 + K[14] * t117 + K[15] * t121 + K[16] * t124 + K[17] * t126 + (P[14] - t127 - t127);
+    const float32_t t129 = P[17] * K[23];
+    const float32_t t130 = P[16] * K[22];
+    const float32_t t131 = P[15] * K[21];
+    const float32_t t132 = P[2] * K[18] + P[8] * K[19];
+    const float32_t t133 = K[18] * t111 + K[19] * t112 + K[20] * t117 + K[21] * t121 + K[22] * t124 + K[23] * t126 + (P[15] - (t120 + (t119 + (t118 + P[21] * K[15]))) - (t129 + (t130 + (t131 + (t132 + P[14] * K[20])))));
+    const float32_t t134 = P[17] * K[29];
+    const float32_t t135 = P[16] * K[28];
+    const float32_t t136 = P[15] * K[27];
+    const float32_t t137 = P[2] * K[24] + P[8] * K[25];
+    const float32_t t138 = K[24] * t111 + K[25] * t112 + K[26] * t117 + K[27] * t121 + K[28] * t124 + K[29] * t126 + (P[16] - (t123 + (t122 + P[28] * K[16])) - (t134 + (t135 + (t136 + (t137 + P[14] * K[26])))));
+    const float32_t t139 = P[17] * K[35];
+    const float32_t t140 = P[16] * K[34];
+    const float32_t t141 = P[15] * K[33];
+    const float32_t t142 = P[2] * K[30] + P[8] * K[31];
+    const float32_t t143 = K[30] * t111 + K[31] * t112 + K[32] * t117 + K[33] * t121 + K[34] * t124 + K[35] * t126 + (P[17] - (t125 + P[35] * K[17]) - (t139 + (t140 + (t141 + (t142 + P[14] * K[32])))));
+    const float32_t t144 = t0 * K[18] + t50 + t49 + t48 + t47 + t46;
+    const float32_t t145 = t97 + t8 * K[19] + t96 + t95 + t94 + t93;
+    const float32_t t146 = t132 + t15 * K[20] + t131 + t130 + t129;
+    const float32_t t147 = P[3] * K[18] + P[9] * K[19] + P[15] * K[20];
+    const float32_t t148 = P[22] * K[22];
+    const float32_t t149 = P[23] * K[23];
+    const float32_t t150 = t147 + t21 * K[21] + t148 + t149;
+    const float32_t t151 = P[4] * K[18] + P[10] * K[19] + P[16] * K[20] + P[22] * K[21];
+    const float32_t t152 = P[29] * K[23];
+    const float32_t t153 = t151 + t26 * K[22] + t152;
+    const float32_t t154 = P[5] * K[18] + P[11] * K[19] + P[17] * K[20] + P[23] * K[21] + P[29] * K[22];
+    const float32_t t155 = t154 + t30 * K[23];
+    const float32_t t156 = t149 + (t148 + (t147 + P[21] * K[21]));
+    const float32_t t157 = K[18] * t144 + K[19] * t145 + K[20] * t146 + K[21] * t150 + K[22] * t153 + K[23] * t155 + (P[21] - t156 - t156);
+    const float32_t t158 = P[23] * K[29];
+    const float32_t t159 = P[22] * K[28];
+    const float32_t t160 = P[3] * K[24] + P[9] * K[25] + P[15] * K[26];
+    const float32_t t161 = K[24] * t144 + K[25] * t145 + K[26] * t146 + K[27] * t150 + K[28] * t153 + K[29] * t155 + (P[22] - (t152 + (t151 + P[28] * K[22])) - (t158 + (t159 + (t160 + P[21] * K[27]))));
+    const float32_t t162 = P[23] * K[35];
+    const float32_t t163 = P[22] * K[34];
+    const float32_t t164 = P[3] * K[30] + P[9] * K[31] + P[15] * K[32];
+    const float32_t t165 = K[30] * t144 + K[31] * t145 + K[32] * t146 + K[33] * t150 + K[34] * t153 + K[35] * t155 + (P[23] - (t154 + P[35] * K[23]) - (t162 + (t163 + (t164 + P[21] * K[33]))));
+    const float32_t t166 = t0 * K[24] + t56 + t55 + t54 + t53 + t52;
+    const float32_t t167 = t103 + t8 * K[25] + t102 + t101 + t100 + t99;
+    const float32_t t168 = t137 + t15 * K[26] + t136 + t135 + t134;
+    const float32_t t169 = t160 + t21 * K[27] + t159 + t158;
+    const float32_t t170 = P[4] * K[24] + P[10] * K[25] + P[16] * K[26] + P[22] * K[27];
+    const float32_t t171 = P[29] * K[29];
+    const float32_t t172 = t170 + t26 * K[28] + t171;
+    const float32_t t173 = P[5] * K[24] + P[11] * K[25] + P[17] * K[26] + P[23] * K[27] + P[29] * K[28];
+    const float32_t t174 = t173 + t30 * K[29];
+    const float32_t t175 = t171 + (t170 + P[28] * K[28]);
+    const float32_t t176 = K[24] * t166 + K[25] * t167 + K[26] * t168 + K[27] * t169 + K[28] * t172 + K[29] * t174 + (P[28] - t175 - t175);
+    const float32_t t177 = P[29] * K[35];
+    const float32_t t178 = P[4] * K[30] + P[10] * K[31] + P[16] * K[32] + P[22] * K[33];
+    const float32_t t179 = K[30] * t166 + K[31] * t167 + K[32] * t168 + K[33] * t169 + K[34] * t172 + K[35] * t174 + (P[29] - (t173 + P[35] * K[29]) - (t177 + (t178 + P[28] * K[34])));
+    const float32_t t180 = P[5] * K[30] + P[11] * K[31] + P[17] * K[32] + P[23] * K[33] + P[29] * K[34];
+    const float32_t t181 = t180 + P[35] * K[35];
+    const float32_t t182 = K[30] * (t0 * K[30] + t62 + t61 + t60 + t59 + t58) + K[31] * (t109 + t8 * K[31] + t108 + t107 + t106 + t105) + K[32] * (t142 + t15 * K[32] + t141 + t140 + t139) + K[33] * (t164 + t21 * K[33] + t163 + t162) + K[34] * (t178 + t26 * K[34] + t177) + K[35] * (t180 + t30 * K[35]) + (P[35] - t181 - t181);
+    P_out[0] = t33;
+    P_out[1] = P_out[6] = t39;
+    P_out[2] = P_out[12] = t45;
+    P_out[3] = P_out[18] = t51;
+    P_out[4] = P_out[24] = t57;
+    P_out[5] = P_out[30] = t63;
+    P_out[7] = t86;
+    P_out[8] = P_out[13] = t92;
+    P_out[9] = P_out[19] = t98;
+    P_out[10] = P_out[25] = t104;
+    P_out[11] = P_out[31] = t110;
+    P_out[14] = t128;
+    P_out[15] = P_out[20] = t133;
+    P_out[16] = P_out[26] = t138;
+    P_out[17] = P_out[32] = t143;
+    P_out[21] = t157;
+    P_out[22] = P_out[27] = t161;
+    P_out[23] = P_out[33] = t165;
+    P_out[28] = t176;
+    P_out[29] = P_out[34] = t179;
+    P_out[35] = t182;
+}
+
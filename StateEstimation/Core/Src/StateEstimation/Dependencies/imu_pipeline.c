@@ -0,0 +1,408 @@
+/**
+ * @file imu_pipeline.c
+ * @brief ADIS16500 acquisition at the full output rate, anti-alias filtering and decimation to the estimator rate
+ *
+ * @details The filters are designed in double at init: the biquads by the
+ *          bilinear transform of the Butterworth sections with the cutoff
+ *          prewarped, the FIR as a windowed sinc scaled to a sum of one. Both
+ *          are symmetric in b, so the order CMSIS-DSP and the FMAC expect the
+ *          taps in does not matter.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "imu_pipeline.h"
+
+#define IMU_PI 3.14159265358979323846
+
+#if IMU_FILTER_BACKEND == IMU_FILTER_BACKEND_FMAC
+#include "stm32h7xx_hal.h"
+#include "stm32h7xx_ll_fmac.h"
+
+#define IMU_FMAC_X1_BASE 64     // after the coefficients, room for the longest FIR history and a block
+#define IMU_FMAC_Y_BASE 160
+#define IMU_FMAC_BIQUAD_ONE 16384.0  // 1.0 in q1.15 with the x 2 output gain, R = 1
+#define IMU_FMAC_FIR_ONE 32768.0
+#endif
+
+/**
+ * @brief Fills in the rates, cutoff and filter the flight code runs with
+ * @param cfg Receives the defaults
+ */
+void imu_pipeline_default_config(ImuPipelineConfig *cfg) {
+    cfg->filter = IMU_FILTER_BIQUAD;
+    cfg->sample_rate = IMU_PIPELINE_SAMPLE_RATE;
+    cfg->cutoff = IMU_PIPELINE_CUTOFF;
+    cfg->decimation = IMU_PIPELINE_DECIMATION;
+    cfg->fir_taps = IMU_PIPELINE_FIR_TAPS;
+}
+
+/**
+ * @brief Butterworth low-pass as second order sections
+ * @param cfg Cutoff and sample rate
+ * @param coeffs Receives b0, b1, b2, a1, a2 per section, a1 and a2 with the CMSIS-DSP sign: y += a1 y[n-1] + a2 y[n-2]
+ */
+static void imu_design_biquad(const ImuPipelineConfig *cfg, double coeffs[IMU_PIPELINE_BIQUAD_STAGES][5]) {
+    double k = tan(IMU_PI * cfg->cutoff / cfg->sample_rate);
+
+    for (int s = 0; s < IMU_PIPELINE_BIQUAD_STAGES; s++) {
+        double q = 1.0 / (2.0 * cos(IMU_PI * (2 * s + 1) / (4.0 * IMU_PIPELINE_BIQUAD_STAGES)));
+        double norm = 1.0 / (1.0 + k / q + k * k);
+        coeffs[s][0] = k * k * norm;
+        coeffs[s][1] = 2.0 * coeffs[s][0];
+        coeffs[s][2] = coeffs[s][0];
+        coeffs[s][3] = -2.0 * (k * k - 1.0) * norm;
+        coeffs[s][4] = -(1.0 - k / q + k * k) * norm;
+    }
+}
+
+/**
+ * @brief Hamming windowed sinc low-pass with unity gain at 0 Hz
+ * @param cfg Cutoff, sample rate and taps
+ * @param taps Receives fir_taps coefficients
+ */
+static void imu_design_fir(const ImuPipelineConfig *cfg, double *taps) {
+    int n = cfg->fir_taps;
+    double fc = cfg->cutoff / cfg->sample_rate;
+    double sum = 0.0;
+
+    for (int i = 0; i < n; i++) {
+        double t = i - 0.5 * (n - 1);
+        double sinc = t == 0.0 ? 2.0 * fc : sin(2.0 * IMU_PI * fc * t) / (IMU_PI * t);
+        double window = n > 1 ? 0.54 - 0.46 * cos(2.0 * IMU_PI * i / (n - 1)) : 1.0;
+        taps[i] = sinc * window;
+        sum += taps[i];
+    }
+    for (int i = 0; i < n; i++) {
+        taps[i] /= sum;
+    }
+}
+
+#if IMU_FILTER_BACKEND == IMU_FILTER_BACKEND_FMAC
+
+static int16_t imu_to_q15(double value, double one) {
+    return (int16_t)lround(value * one);
+}
+
+/**
+ * @brief Writes n values into the buffer the function selects, oldest first
+ * @param function LL_FMAC_FUNC_LOAD_X1, LOAD_X2 or LOAD_Y
+ * @param data Values to write
+ * @param p P field, n for X1 and Y, the b count for X2
+ * @param q Q field, the a count for X2, otherwise 0
+ */
+static void imu_fmac_load(uint32_t function, const int16_t *data, uint8_t p, uint8_t q) {
+    if (p + q == 0) {
+        return;
+    }
+    LL_FMAC_ConfigFunc(FMAC, LL_FMAC_PROCESSING_START, function, p, q, 0);
+    for (int i = 0; i < p + q; i++) {
+        LL_FMAC_WriteData(FMAC, (uint16_t)data[i]);
+    }
+    while (LL_FMAC_IsEnabledStart(FMAC)) {
+    }
+}
+
+/**
+ * @brief Clears the FMAC read and write pointers, the buffers keep their contents
+ */
+static void imu_fmac_reset(void) {
+    LL_FMAC_EnableReset(FMAC);
+    while (LL_FMAC_IsEnabledReset(FMAC)) {
+    }
+}
+
+/**
+ * @brief Runs one channel through one filter on the FMAC
+ * @param function LL_FMAC_FUNC_CONVO_FIR or LL_FMAC_FUNC_IIR_DIRECT_FORM_1
+ * @param coeff_base Where the filter's coefficients were loaded in the unit
+ * @param p b coefficients
+ * @param q a coefficients, 0 for the FIR
+ * @param r Output gain, a left shift
+ * @param x_history p - 1 previous inputs, oldest first
+ * @param y_history q previous outputs, oldest first
+ * @param in n new inputs
+ * @param out Receives n outputs
+ * @param n Block length
+ * @details With p - 1 inputs preloaded the first new input completes the
+ *          window, so output i is the filter at input i with no start-up.
+ *          The unit is stopped and reset afterwards for the next channel.
+ */
+static void imu_fmac_filter(uint32_t function, uint8_t coeff_base, uint8_t p, uint8_t q, uint8_t r,
+                            const int16_t *x_history, const int16_t *y_history,
+                            const int16_t *in, int16_t *out, uint16_t n) {
+    LL_FMAC_ConfigX1(FMAC, LL_FMAC_WM_0_THRESHOLD_1, IMU_FMAC_X1_BASE, p + n);
+    LL_FMAC_ConfigX2(FMAC, coeff_base, p + q);
+    LL_FMAC_ConfigY(FMAC, LL_FMAC_WM_0_THRESHOLD_1, IMU_FMAC_Y_BASE, q + n);
+    imu_fmac_load(LL_FMAC_FUNC_LOAD_X1, x_history, p - 1, 0);
+    imu_fmac_load(LL_FMAC_FUNC_LOAD_Y, y_history, q, 0);
+
+    LL_FMAC_ConfigFunc(FMAC, LL_FMAC_PROCESSING_START, function, p, q, r);
+    for (uint16_t i = 0; i < n; i++) {
+        LL_FMAC_WriteData(FMAC, (uint16_t)in[i]);
+        while (LL_FMAC_IsActiveFlag_YEMPTY(FMAC)) {
+        }
+        out[i] = (int16_t)LL_FMAC_ReadData(FMAC);
+    }
+    LL_FMAC_DisableStart(FMAC);
+    imu_fmac_reset();
+}
+
+/**
+ * @brief Keeps the last m of history followed by in
+ * @param history m values, oldest first
+ * @param m History length
+ * @param in n newer values
+ * @param n Number of newer values
+ */
+static void imu_history_update(int16_t *history, uint16_t m, const int16_t *in, uint16_t n) {
+    if (n >= m) {
+        memcpy(history, &in[n - m], m * sizeof(int16_t));
+    } else {
+        memmove(history, &history[n], (m - n) * sizeof(int16_t));
+        memcpy(&history[m - n], in, n * sizeof(int16_t));
+    }
+}
+
+/**
+ * @brief Quantizes the filter and loads its coefficients into the FMAC
+ * @param pipe Pipeline, cfg already set
+ * @details The rounding error in b is folded into one coefficient so the
+ *          integer gain at 0 Hz stays exactly one: a constant rate comes out
+ *          as the same count it went in as.
+ */
+static void imu_filter_init(ImuPipeline *pipe) {
+    __HAL_RCC_FMAC_CLK_ENABLE();
+    imu_fmac_reset();
+    LL_FMAC_EnableClipping(FMAC);
+    memset(pipe->biquad_history, 0, sizeof(pipe->biquad_history));
+    memset(pipe->fir_history, 0, sizeof(pipe->fir_history));
+
+    if (pipe->cfg.filter == IMU_FILTER_BIQUAD) {
+        double coeffs[IMU_PIPELINE_BIQUAD_STAGES][5];
+        imu_design_biquad(&pipe->cfg, coeffs);
+        for (int s = 0; s < IMU_PIPELINE_BIQUAD_STAGES; s++) {
+            int16_t *c = pipe->biquad_q15[s];
+            c[0] = imu_to_q15(coeffs[s][0], IMU_FMAC_BIQUAD_ONE);
+            c[2] = c[0];
+            c[3] = imu_to_q15(coeffs[s][3], IMU_FMAC_BIQUAD_ONE);
+            c[4] = imu_to_q15(coeffs[s][4], IMU_FMAC_BIQUAD_ONE);
+            c[1] = (int16_t)((int32_t)IMU_FMAC_BIQUAD_ONE - c[3] - c[4] - 2 * c[0]);
+            LL_FMAC_ConfigX2(FMAC, (uint8_t)(5 * s), 5);
+            imu_fmac_load(LL_FMAC_FUNC_LOAD_X2, c, 3, 2);
+        }
+    } else if (pipe->cfg.filter == IMU_FILTER_FIR) {
+        double taps[IMU_PIPELINE_MAX_FIR_TAPS];
+        int32_t sum = 0;
+        imu_design_fir(&pipe->cfg, taps);
+        for (int i = 0; i < pipe->cfg.fir_taps; i++) {
+            pipe->fir_q15[i] = imu_to_q15(taps[i], IMU_FMAC_FIR_ONE);
+            sum += pipe->fir_q15[i];
+        }
+        pipe->fir_q15[pipe->cfg.fir_taps / 2] += (int16_t)((int32_t)IMU_FMAC_FIR_ONE - sum);
+        LL_FMAC_ConfigX2(FMAC, 0, pipe->cfg.fir_taps);
+        imu_fmac_load(LL_FMAC_FUNC_LOAD_X2, pipe->fir_q15, pipe->cfg.fir_taps, 0);
+    }
+}
+
+/**
+ * @brief Filters one block, every channel
+ * @param pipe Pipeline
+ * @param raw Counts, channel major
+ * @param filtered Receives counts, channel major
+ */
+static void imu_filter_block(ImuPipeline *pipe, const int16_t raw[][IMU_PIPELINE_MAX_DECIMATION],
+                             float32_t filtered[][IMU_PIPELINE_MAX_DECIMATION]) {
+    uint16_t n = pipe->cfg.decimation;
+    uint8_t taps = (uint8_t)pipe->cfg.fir_taps;
+    int16_t stage[IMU_PIPELINE_BIQUAD_STAGES][IMU_PIPELINE_MAX_DECIMATION];
+    const int16_t *out = stage[0];
+
+    for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+        if (pipe->cfg.filter == IMU_FILTER_BIQUAD) {
+            int16_t (*history)[2] = pipe->biquad_history[c];
+            const int16_t *in = raw[c];
+            // Section s reads the history of section s - 1's output before it is updated
+            for (int s = 0; s < IMU_PIPELINE_BIQUAD_STAGES; s++) {
+                imu_fmac_filter(LL_FMAC_FUNC_IIR_DIRECT_FORM_1, (uint8_t)(5 * s), 3, 2, 1,
+                                history[s], history[s + 1], in, stage[s], n);
+                in = stage[s];
+            }
+            imu_history_update(history[0], 2, raw[c], n);
+            for (int s = 0; s < IMU_PIPELINE_BIQUAD_STAGES; s++) {
+                imu_history_update(history[s + 1], 2, stage[s], n);
+            }
+            out = stage[IMU_PIPELINE_BIQUAD_STAGES - 1];
+        } else if (pipe->cfg.filter == IMU_FILTER_FIR) {
+            imu_fmac_filter(LL_FMAC_FUNC_CONVO_FIR, 0, taps, 0, 0, pipe->fir_history[c], NULL, raw[c], stage[0], n);
+            imu_history_update(pipe->fir_history[c], taps - 1, raw[c], n);
+            out = stage[0];
+        } else {
+            out = raw[c];
+        }
+        for (uint16_t i = 0; i < n; i++) {
+            filtered[c][i] = (float32_t)out[i];
+        }
+    }
+}
+
+#else
+
+static void imu_filter_init(ImuPipeline *pipe) {
+    memset(pipe->biquad_state, 0, sizeof(pipe->biquad_state));
+    memset(pipe->fir_state, 0, sizeof(pipe->fir_state));
+
+    if (pipe->cfg.filter == IMU_FILTER_BIQUAD) {
+        double coeffs[IMU_PIPELINE_BIQUAD_STAGES][5];
+        imu_design_biquad(&pipe->cfg, coeffs);
+        for (int s = 0; s < IMU_PIPELINE_BIQUAD_STAGES; s++) {
+            for (int k = 0; k < 5; k++) {
+                pipe->biquad_coeffs[5 * s + k] = (float32_t)coeffs[s][k];
+            }
+        }
+        for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+            arm_biquad_cascade_df2T_init_f32(&pipe->biquad[c], IMU_PIPELINE_BIQUAD_STAGES, pipe->biquad_coeffs,
+                                             pipe->biquad_state[c]);
+        }
+    } else if (pipe->cfg.filter == IMU_FILTER_FIR) {
+        double taps[IMU_PIPELINE_MAX_FIR_TAPS];
+        imu_design_fir(&pipe->cfg, taps);
+        for (int i = 0; i < pipe->cfg.fir_taps; i++) {
+            pipe->fir_coeffs[i] = (float32_t)taps[i];
+        }
+        for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+            arm_fir_init_f32(&pipe->fir[c], pipe->cfg.fir_taps, pipe->fir_coeffs, pipe->fir_state[c],
+                             pipe->cfg.decimation);
+        }
+    }
+}
+
+static void imu_filter_block(ImuPipeline *pipe, const int16_t raw[][IMU_PIPELINE_MAX_DECIMATION],
+                             float32_t filtered[][IMU_PIPELINE_MAX_DECIMATION]) {
+    uint16_t n = pipe->cfg.decimation;
+    float32_t in[IMU_PIPELINE_MAX_DECIMATION];
+
+    for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+        for (uint16_t i = 0; i < n; i++) {
+            in[i] = (float32_t)raw[c][i];
+        }
+        if (pipe->cfg.filter == IMU_FILTER_BIQUAD) {
+            arm_biquad_cascade_df2T_f32(&pipe->biquad[c], in, filtered[c], n);
+        } else if (pipe->cfg.filter == IMU_FILTER_FIR) {
+            arm_fir_f32(&pipe->fir[c], in, filtered[c], n);
+        } else {
+            memcpy(filtered[c], in, n * sizeof(float32_t));
+        }
+    }
+}
+
+#endif
+
+/**
+ * @brief Designs the filter and clears the pipeline
+ * @param pipe Pipeline to initialize
+ * @param cfg Rates, cutoff and filter, copied
+ * @return 0 if cfg is out of range, the pipeline is then left unusable
+ */
+uint8_t imu_pipeline_init(ImuPipeline *pipe, const ImuPipelineConfig *cfg) {
+    memset(pipe, 0, sizeof(*pipe));
+    if (cfg->decimation == 0 || cfg->decimation > IMU_PIPELINE_MAX_DECIMATION ||
+        !(cfg->sample_rate > 0.0f) || !(cfg->cutoff > 0.0f && cfg->cutoff < 0.5f * cfg->sample_rate) ||
+        (cfg->filter == IMU_FILTER_FIR && (cfg->fir_taps < 2 || cfg->fir_taps > IMU_PIPELINE_MAX_FIR_TAPS))) {
+        return 0;
+    }
+    pipe->cfg = *cfg;
+    pipe->dt = 1.0f / cfg->sample_rate;
+    imu_filter_init(pipe);
+    return 1;
+}
+
+/**
+ * @brief Adds one burst reading, call from the data ready interrupt
+ * @param pipe Pipeline
+ * @param sample IMU_PIPELINE_CHANNELS counts, x, y, z gyro then x, y, z accel
+ * @param time_us When the sample was taken, kept for the block it completes
+ */
+void imu_pipeline_push(ImuPipeline *pipe, const int16_t *sample, uint32_t time_us) {
+    uint8_t w = pipe->write;
+    uint16_t n = pipe->fill;
+
+    for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+        pipe->block[w][c][n] = sample[c];
+    }
+    pipe->samples++;
+
+    if (++n < pipe->cfg.decimation) {
+        pipe->fill = n;
+        return;
+    }
+    pipe->fill = 0;
+    if (pipe->ready) {
+        pipe->overruns++;
+        return;
+    }
+    pipe->block_time[w] = time_us;
+    pipe->write = w ^ 1;
+    pipe->ready = 1;
+}
+
+static void imu_cross(const float32_t *a, const float32_t *b, float32_t *out) {
+    out[0] = a[1] * b[2] - a[2] * b[1];
+    out[1] = a[2] * b[0] - a[0] * b[2];
+    out[2] = a[0] * b[1] - a[1] * b[0];
+}
+
+/**
+ * @brief Filters and integrates a completed block into gyro and accel
+ * @param pipe Pipeline
+ * @return 1 if gyro and accel were updated, 0 if no block was complete
+ */
+uint8_t imu_pipeline_process(ImuPipeline *pipe) {
+    float32_t filtered[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION];
+    float32_t beta[3] = {0.0f, 0.0f, 0.0f};
+    float32_t upsilon[3] = {0.0f, 0.0f, 0.0f};
+    float32_t coning[3] = {0.0f, 0.0f, 0.0f};
+    float32_t sculling[3] = {0.0f, 0.0f, 0.0f};
+    float32_t rotation[3];
+    uint16_t n = pipe->cfg.decimation;
+
+    if (!pipe->ready) {
+        return 0;
+    }
+    // write only changes once ready is cleared
+    imu_filter_block(pipe, (const int16_t (*)[IMU_PIPELINE_MAX_DECIMATION])pipe->block[pipe->write ^ 1], filtered);
+    pipe->time_us = pipe->block_time[pipe->write ^ 1];
+    pipe->ready = 0;
+
+    float32_t gyro_scale = IMU_PIPELINE_GYRO_LSB * pipe->dt;
+    float32_t accel_scale = IMU_PIPELINE_ACCEL_LSB * pipe->dt;
+    for (uint16_t i = 0; i < n; i++) {
+        float32_t alpha[3], nu[3], mid[3], cross[3];
+        for (int k = 0; k < 3; k++) {
+            alpha[k] = filtered[k][i] * gyro_scale;
+            nu[k] = filtered[3 + k][i] * accel_scale;
+        }
+
+        imu_cross(beta, alpha, cross);
+        for (int k = 0; k < 3; k++) {
+            coning[k] += 0.5f * cross[k];
+            mid[k] = beta[k] + 0.5f * alpha[k];
+        }
+        imu_cross(mid, nu, cross);
+        for (int k = 0; k < 3; k++) {
+            sculling[k] += cross[k];
+            beta[k] += alpha[k];
+            upsilon[k] += nu[k];
+        }
+    }
+    imu_cross(beta, upsilon, rotation);
+
+    float32_t inv_t = 1.0f / (n * pipe->dt);
+    for (int k = 0; k < 3; k++) {
+        pipe->gyro[k] = (beta[k] + coning[k]) * inv_t;
+        pipe->accel[k] = (upsilon[k] + sculling[k] - rotation[k]) * inv_t;
+    }
+    pipe->outputs++;
+    return 1;
+}
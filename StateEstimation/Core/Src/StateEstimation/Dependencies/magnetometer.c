@@ -0,0 +1,211 @@
+/**
+ * @file magnetometer.c
+ * @brief Online LIS3MDL hard and soft iron calibration and heading aiding
+ *
+ * @details The normal equations are kept in double, the x^4 sums of a few
+ *          thousand readings would lose the residual in float. A fit is a
+ *          6 x 6 Cholesky solve every MAG_CAL_SOLVE_INTERVAL readings.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "magnetometer.h"
+
+/**
+ * @brief Resets the calibrator to no calibration, call on entering GROUND
+ * @param cal Calibrator state
+ */
+void mag_calibrator_init(MagCalibrator *cal) {
+    memset(cal, 0, sizeof(*cal));
+    for (int i = 0; i < 3; i++) {
+        cal->scale[i] = 1.0f;
+        cal->min[i] = INFINITY;
+        cal->max[i] = -INFINITY;
+    }
+}
+
+/**
+ * @brief Solves A x = b in place for a symmetric positive definite A
+ * @param a Upper triangle of A, overwritten with the Cholesky factor
+ * @param b Right-hand side, overwritten with x
+ * @return 0 if A is not positive definite, as with too little rotation
+ */
+static uint8_t mag_cholesky_solve(double a[MAG_CAL_PARAMS][MAG_CAL_PARAMS], double b[MAG_CAL_PARAMS]) {
+    // a = U' U, U kept in the upper triangle
+    for (int i = 0; i < MAG_CAL_PARAMS; i++) {
+        for (int j = i; j < MAG_CAL_PARAMS; j++) {
+            double sum = a[i][j];
+            for (int k = 0; k < i; k++) {
+                sum -= a[k][i] * a[k][j];
+            }
+            if (i == j) {
+                if (!(sum > 0.0)) {
+                    return 0;
+                }
+                a[i][i] = sqrt(sum);
+            } else {
+                a[i][j] = sum / a[i][i];
+            }
+        }
+    }
+    for (int i = 0; i < MAG_CAL_PARAMS; i++) {
+        for (int k = 0; k < i; k++) {
+            b[i] -= a[k][i] * b[k];
+        }
+        b[i] /= a[i][i];
+    }
+    for (int i = MAG_CAL_PARAMS - 1; i >= 0; i--) {
+        for (int k = i + 1; k < MAG_CAL_PARAMS; k++) {
+            b[i] -= a[i][k] * b[k];
+        }
+        b[i] /= a[i][i];
+    }
+    return 1;
+}
+
+/**
+ * @brief Fits the ellipsoid to the readings so far and keeps it if it is trustworthy
+ * @param cal Calibrator state
+ * @return 1 if the fit was accepted
+ */
+static uint8_t mag_calibrator_fit(MagCalibrator *cal) {
+    double a[MAG_CAL_PARAMS][MAG_CAL_PARAMS];
+    double theta[MAG_CAL_PARAMS];
+
+    memcpy(a, cal->ata, sizeof(a));
+    memcpy(theta, cal->atb, sizeof(theta));
+    if (!mag_cholesky_solve(a, theta)) {
+        return 0;
+    }
+
+    // x^2 + b y^2 + c z^2 - d x - e y - f z - g = 0
+    double b = theta[0];
+    double c = theta[1];
+    if (!(b > 0.0 && c > 0.0)) {
+        return 0;
+    }
+    double center[3] = {0.5 * theta[2], 0.5 * theta[3] / b, 0.5 * theta[4] / c};
+    double G = theta[5] + center[0] * center[0] + b * center[1] * center[1] + c * center[2] * center[2];
+    if (!(G > 0.0)) {
+        return 0;
+    }
+
+    // At the least squares solution the squared error is sum x^4 - theta' atb
+    double sse = cal->btb;
+    for (int i = 0; i < MAG_CAL_PARAMS; i++) {
+        sse -= theta[i] * cal->atb[i];
+    }
+    cal->residual = (float32_t)(sqrt(fmax(sse, 0.0) / cal->n) / G);
+
+    double radius[3] = {sqrt(G), sqrt(G / b), sqrt(G / c)};
+    double r_min = fmin(radius[0], fmin(radius[1], radius[2]));
+    double r_max = fmax(radius[0], fmax(radius[1], radius[2]));
+    if (cal->residual > MAG_CAL_MAX_RESIDUAL || r_max > MAG_CAL_MAX_AXIS_RATIO * r_min) {
+        return 0;
+    }
+    for (int i = 0; i < 3; i++) {
+        if (cal->max[i] - cal->min[i] < MAG_CAL_MIN_SPAN * radius[i]) {
+            return 0;
+        }
+    }
+
+    double sphere = cbrt(radius[0] * radius[1] * radius[2]);
+    for (int i = 0; i < 3; i++) {
+        cal->offset[i] = (float32_t)center[i];
+        cal->scale[i] = (float32_t)(sphere / radius[i]);
+    }
+    cal->radius = (float32_t)sphere;
+    cal->converged = 1;
+    return 1;
+}
+
+/**
+ * @brief Adds a new reading and refits every MAG_CAL_SOLVE_INTERVAL readings
+ * @param cal Calibrator state
+ * @param sensors Latest readings, only used if mag_new is set
+ * @return 1 once a fit has been accepted
+ */
+uint8_t mag_calibrator_update(MagCalibrator *cal, const Sensors *sensors) {
+    if (!sensors->mag_new) {
+        return cal->converged;
+    }
+
+    float32_t m[3] = {sensors->mag_x, sensors->mag_y, sensors->mag_z};
+    double x = m[0];
+    double y = m[1];
+    double z = m[2];
+    double phi[MAG_CAL_PARAMS] = {-y * y, -z * z, x, y, z, 1.0};
+    double t = x * x;
+
+    for (int i = 0; i < MAG_CAL_PARAMS; i++) {
+        for (int j = i; j < MAG_CAL_PARAMS; j++) {
+            cal->ata[i][j] += phi[i] * phi[j];
+        }
+        cal->atb[i] += phi[i] * t;
+    }
+    cal->btb += t * t;
+    for (int i = 0; i < 3; i++) {
+        cal->min[i] = fminf(cal->min[i], m[i]);
+        cal->max[i] = fmaxf(cal->max[i], m[i]);
+    }
+    cal->n++;
+
+    if (cal->n >= MAG_CAL_MIN_SAMPLES && cal->n % MAG_CAL_SOLVE_INTERVAL == 0) {
+        mag_calibrator_fit(cal);
+    }
+    return cal->converged;
+}
+
+/**
+ * @brief Copies the accepted calibration into Sensors
+ * @param cal Calibrator state
+ * @param sensors Receives mag_offset and mag_scale, left at no calibration if no fit was accepted
+ */
+void mag_calibrator_apply(const MagCalibrator *cal, Sensors *sensors) {
+    sensors->mag_offset_x = cal->offset[0];
+    sensors->mag_offset_y = cal->offset[1];
+    sensors->mag_offset_z = cal->offset[2];
+    sensors->mag_scale_x = cal->scale[0];
+    sensors->mag_scale_y = cal->scale[1];
+    sensors->mag_scale_z = cal->scale[2];
+}
+
+/**
+ * @brief Calibrated field of the latest reading
+ * @param sensors Latest readings and calibration
+ * @param mag Receives the field in the body frame, Gauss
+ */
+void mag_calibrated(const Sensors *sensors, float32_t *mag) {
+    mag[0] = (sensors->mag_x - sensors->mag_offset_x) * sensors->mag_scale_x;
+    mag[1] = (sensors->mag_y - sensors->mag_offset_y) * sensors->mag_scale_y;
+    mag[2] = (sensors->mag_z - sensors->mag_offset_z) * sensors->mag_scale_z;
+}
+
+/**
+ * @brief Averages new readings into the heading reference, call every cycle on the pad
+ * @param rocket_atd Attitude, receives mag_ref
+ * @param sensors Latest readings and calibration
+ */
+void mag_heading_reference(RocketAttitude *rocket_atd, const Sensors *sensors) {
+    float32_t mag[3];
+
+    if (sensors->mag_new) {
+        mag_calibrated(sensors, mag);
+        attitude_mag_reference(rocket_atd, mag);
+    }
+}
+
+/**
+ * @brief Corrects the heading with a new reading, call every cycle after the gyro update
+ * @param rocket_atd Attitude to correct
+ * @param sensors Latest readings and calibration
+ */
+void mag_heading_correction(RocketAttitude *rocket_atd, const Sensors *sensors) {
+    float32_t mag[3];
+
+    if (sensors->mag_new) {
+        mag_calibrated(sensors, mag);
+        attitude_mag_correction(rocket_atd, mag);
+    }
+}
@@ -0,0 +1,114 @@
+/**
+ * @file noise_adapt.c
+ * @brief Innovation based noise adaptation for the flight EKF
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "noise_adapt.h"
+
+/**
+ * @brief Takes the nominal noise and clears the window
+ * @param na Adapter to reset
+ * @param Q Nominal process noise, nx x nx row major, only the diagonal is kept
+ * @param nx State dimension, at most NOISE_ADAPT_MAX_DIM
+ * @param R Nominal measurement noise, nz x nz row major, only the diagonal is kept
+ * @param nz Measurement dimension, at most NOISE_ADAPT_MAX_MEAS
+ */
+void noise_adapt_init(NoiseAdapter *na, const float32_t *Q, uint16_t nx, const float32_t *R, uint16_t nz) {
+    memset(na, 0, sizeof(*na));
+    na->nx = nx;
+    na->nz = nz;
+    for (uint16_t i = 0; i < nx; i++) {
+        na->q_nominal[i] = Q[i * nx + i];
+    }
+    for (uint16_t i = 0; i < nz; i++) {
+        na->r_nominal[i] = R[i * nz + i];
+        na->r[i] = na->r_nominal[i];
+        na->last_z[i] = NAN;
+    }
+    na->phase = NOISE_PHASES;   // none yet, the first noise_adapt_phase() writes Q
+    na->enabled = 1;
+}
+
+/**
+ * @brief Scales the diagonal of Q for a flight phase
+ * @param na Adapter
+ * @param phase NoisePhase of this cycle
+ * @param scale Factor over the nominal variance, per phase and state
+ * @param Q Process noise to write, nx x nx row major
+ * @details Writes only when the phase changes, O(nx).
+ */
+void noise_adapt_phase(NoiseAdapter *na, uint8_t phase, const float32_t (*scale)[NOISE_ADAPT_MAX_DIM], float32_t *Q) {
+    if (phase == na->phase || phase >= NOISE_PHASES) {
+        return;
+    }
+    na->phase = phase;
+    for (uint16_t i = 0; i < na->nx; i++) {
+        Q[i * na->nx + i] = na->q_nominal[i] * scale[phase][i];
+    }
+}
+
+/**
+ * @brief Feeds an accepted update and adapts the diagonal of R
+ * @param na Adapter
+ * @param z Measurement before any latency correction, to tell a new fix from a held one
+ * @param innovation z - h of the update
+ * @param hph Diagonal of H P H' with the P the gain was formed with
+ * @param R Measurement noise to write, nz x nz row major
+ * @return 1 if the update was sampled, 0 for a held fix or with adaptation off
+ */
+uint8_t noise_adapt_update(NoiseAdapter *na, const float32_t *z, const float32_t *innovation, const float32_t *hph,
+                           float32_t *R) {
+    const uint16_t nz = na->nz;
+    uint8_t held = 1;
+
+    for (uint16_t i = 0; i < nz; i++) {
+        held &= z[i] == na->last_z[i];
+    }
+    if (!na->enabled || held) {
+        return 0;
+    }
+    memcpy(na->last_z, z, sizeof(float32_t) * nz);
+
+    for (uint16_t i = 0; i < nz; i++) {
+        na->samples[na->head][i] = innovation[i] * innovation[i] - hph[i];
+    }
+    na->head = (na->head + 1) % NOISE_ADAPT_WINDOW;
+    if (na->count < NOISE_ADAPT_WINDOW) {
+        na->count++;
+    }
+    if (na->count < NOISE_ADAPT_MIN_SAMPLES) {
+        return 1;
+    }
+
+    // Summed afresh each time, NOISE_ADAPT_WINDOW additions per axis and no drift
+    for (uint16_t i = 0; i < nz; i++) {
+        float32_t sum = 0.0f;
+        for (uint8_t k = 0; k < na->count; k++) {
+            sum += na->samples[k][i];
+        }
+        float32_t estimate = sum / na->count;
+        float32_t lo = na->r_nominal[i] * NOISE_ADAPT_R_MIN;
+        float32_t hi = na->r_nominal[i] * NOISE_ADAPT_R_MAX;
+        estimate = estimate < lo ? lo : estimate > hi ? hi : estimate;
+        na->r[i] += NOISE_ADAPT_FORGET * (estimate - na->r[i]);
+        R[i * nz + i] = na->r[i];
+    }
+    return 1;
+}
+
+/**
+ * @brief Largest adapted R over its nominal value, for telemetry
+ * @param na Adapter
+ * @return max_i r_i / r_nominal_i in 1/NOISE_ADAPT_SCALE_LSB steps, 2 to 128 within the bounds
+ */
+uint8_t noise_adapt_r_scale(const NoiseAdapter *na) {
+    float32_t scale = 0.0f;
+    for (uint16_t i = 0; i < na->nz; i++) {
+        float32_t ratio = na->r[i] / na->r_nominal[i];
+        scale = ratio > scale ? ratio : scale;
+    }
+    return (uint8_t)(scale * NOISE_ADAPT_SCALE_LSB + 0.5f);
+}
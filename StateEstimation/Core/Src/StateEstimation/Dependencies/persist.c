@@ -0,0 +1,287 @@
+/**
+ * @file persist.c
+ * @brief Calibration kept in flash and estimator snapshots kept in backup SRAM across resets
+ *
+ * @details The flash sector is only ever programmed from the all ones state
+ *          and erased as a whole, so a slot is free while its first word is
+ *          still 0xFFFFFFFF. Slots are filled in order, the first free one is
+ *          the next to program and every slot before it holds a record or
+ *          the remains of one.
+ */
+
+#include <stddef.h>
+#include <string.h>
+
+#include "persist.h"
+#include "flight_ekf.h"
+#include "stm32h7xx_hal.h"
+
+_Static_assert(sizeof(CalibrationRecord) == PERSIST_CAL_RECORD_SIZE, "CalibrationRecord must fill its flash slot");
+_Static_assert(PERSIST_CAL_RECORD_SIZE % 32 == 0, "flash slots are whole 256-bit flash words");
+_Static_assert(PERSIST_WARM_DIM == MAX_FLIGHT_DIM, "WarmStartRecord must hold the flight EKF");
+_Static_assert(PERSIST_WARM_SLOTS * sizeof(WarmStartRecord) <= 4096, "snapshots must fit in the backup SRAM");
+
+#define PERSIST_ERASED 0xFFFFFFFFu
+
+#if PERSIST_BACKEND == PERSIST_BACKEND_STM32
+
+#define PERSIST_FLASH_BASE 0x08060000u
+#define PERSIST_FLASH_SECTOR FLASH_SECTOR_3
+
+static const uint8_t *persist_flash(void) {
+    return (const uint8_t *)PERSIST_FLASH_BASE;
+}
+
+static WarmStartRecord *persist_backup(void) {
+    return (WarmStartRecord *)D3_BKPSRAM_BASE;
+}
+
+// MPU_Config() keeps the backup SRAM out of the cache, this drains the write buffer
+static void persist_backup_sync(void) {
+    __DSB();
+}
+
+static uint8_t persist_flash_erase(void) {
+    FLASH_EraseInitTypeDef erase = {
+        .TypeErase = FLASH_TYPEERASE_SECTORS,
+        .Banks = FLASH_BANK_1,
+        .Sector = PERSIST_FLASH_SECTOR,
+        .NbSectors = 1,
+        .VoltageRange = FLASH_VOLTAGE_RANGE_3,
+    };
+    uint32_t error;
+
+    HAL_FLASH_Unlock();
+    HAL_StatusTypeDef status = HAL_FLASHEx_Erase(&erase, &error);
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+// Programs whole 256-bit flash words, data must be word aligned
+static uint8_t persist_flash_program(uint32_t offset, const void *data, uint32_t size) {
+    HAL_StatusTypeDef status = HAL_OK;
+
+    HAL_FLASH_Unlock();
+    for (uint32_t i = 0; i < size && status == HAL_OK; i += 4 * FLASH_NB_32BITWORD_IN_FLASHWORD) {
+        status = HAL_FLASH_Program(FLASH_TYPEPROGRAM_FLASHWORD, PERSIST_FLASH_BASE + offset + i,
+                                   (uint32_t)((const uint8_t *)data + i));
+    }
+    HAL_FLASH_Lock();
+    return status == HAL_OK;
+}
+
+#else
+
+static uint8_t persist_flash_ram[PERSIST_CAL_SECTOR_SIZE] __attribute__((aligned(32)));
+static WarmStartRecord persist_backup_ram[PERSIST_WARM_SLOTS];
+static uint8_t persist_warm_reset;
+
+static const uint8_t *persist_flash(void) {
+    return persist_flash_ram;
+}
+
+static WarmStartRecord *persist_backup(void) {
+    return persist_backup_ram;
+}
+
+static void persist_backup_sync(void) {
+}
+
+static uint8_t persist_flash_erase(void) {
+    memset(persist_flash_ram, 0xFF, sizeof(persist_flash_ram));
+    return 1;
+}
+
+// Programming can only clear bits, as on the target
+static uint8_t persist_flash_program(uint32_t offset, const void *data, uint32_t size) {
+    const uint8_t *bytes = data;
+    for (uint32_t i = 0; i < size; i++) {
+        persist_flash_ram[offset + i] &= bytes[i];
+    }
+    return 1;
+}
+
+/**
+ * @brief Sets what the next persist_init() sees
+ * @param warm 1 for a reset that keeps the flash and the backup SRAM, 0 for the
+ *        power-on reset of a new board, the default
+ */
+void persist_host_reset(uint8_t warm) {
+    persist_warm_reset = warm;
+}
+
+#endif
+
+static uint32_t persist_warm_sequence;
+
+/**
+ * @brief CRC-32 as in zlib, reflected polynomial 0xEDB88320
+ * @param data Bytes to check
+ * @param size Number of bytes
+ * @return CRC of the bytes
+ */
+uint32_t persist_crc32(const void *data, uint32_t size) {
+    static const uint32_t nibble[16] = {
+        0x00000000u, 0x1DB71064u, 0x3B6E20C8u, 0x26D930ACu, 0x76DC4190u, 0x6B6B51F4u, 0x4DB26158u, 0x5005713Cu,
+        0xEDB88320u, 0xF00F9344u, 0xD6D6A3E8u, 0xCB61B38Cu, 0x9B64C2B0u, 0x86D3D2D4u, 0xA00AE278u, 0xBDBDF21Cu,
+    };
+    const uint8_t *bytes = data;
+    uint32_t crc = 0xFFFFFFFFu;
+
+    for (uint32_t i = 0; i < size; i++) {
+        crc ^= bytes[i];
+        crc = (crc >> 4) ^ nibble[crc & 0x0F];
+        crc = (crc >> 4) ^ nibble[crc & 0x0F];
+    }
+    return ~crc;
+}
+
+/**
+ * @brief Enables the backup SRAM and tells a warm reset from a power-on one
+ * @return 1 if the snapshots in the backup SRAM may be used, 0 after a power-on
+ *         reset, when they are cleared
+ * @details Call once at boot, before any other function here.
+ */
+uint8_t persist_init(void) {
+#if PERSIST_BACKEND == PERSIST_BACKEND_STM32
+    HAL_PWR_EnableBkUpAccess();
+    __HAL_RCC_BKPRAM_CLK_ENABLE();
+    uint8_t warm = !__HAL_RCC_GET_FLAG(RCC_FLAG_PORRST);
+    __HAL_RCC_CLEAR_RESET_FLAGS();
+#else
+    uint8_t warm = persist_warm_reset;
+    persist_warm_reset = 0;
+    if (!warm) {
+        persist_flash_erase();
+    }
+#endif
+    persist_warm_sequence = 0;
+    if (!warm) {
+        warm_start_clear();
+    }
+    return warm;
+}
+
+static uint8_t calibration_record_valid(const CalibrationRecord *record) {
+    return record->magic == PERSIST_CAL_MAGIC && record->version == PERSIST_CAL_VERSION &&
+           record->size == sizeof(CalibrationRecord) &&
+           record->crc == persist_crc32(record, offsetof(CalibrationRecord, crc));
+}
+
+// Newest valid record and the first free slot, PERSIST_CAL_SLOTS if there is none
+static uint8_t calibration_store_scan(CalibrationRecord *newest, uint32_t *free_slot) {
+    const uint8_t *flash = persist_flash();
+    uint8_t found = 0;
+    uint32_t slot = 0;
+
+    for (; slot < PERSIST_CAL_SLOTS; slot++) {
+        const CalibrationRecord *record = (const CalibrationRecord *)&flash[slot * PERSIST_CAL_RECORD_SIZE];
+        if (record->magic == PERSIST_ERASED) {
+            break;
+        }
+        if (calibration_record_valid(record) && (!found || (int32_t)(record->sequence - newest->sequence) > 0)) {
+            *newest = *record;
+            found = 1;
+        }
+    }
+    *free_slot = slot;
+    return found;
+}
+
+/**
+ * @brief Loads the newest valid calibration
+ * @param record Receives the record, untouched if there is none
+ * @return 1 if a record was found
+ */
+uint8_t calibration_store_load(CalibrationRecord *record) {
+    uint32_t free_slot;
+    return calibration_store_scan(record, &free_slot);
+}
+
+/**
+ * @brief Appends a calibration, erasing the sector first if it is full
+ * @param record Calibration, its flags and payload filled in; receives the
+ *        header and CRC it was stored with
+ * @return 1 if it was programmed and reads back valid
+ * @details Blocks for the programming, well under a millisecond, and for the
+ *          erase when there is one, so only call it on the pad.
+ */
+uint8_t calibration_store_save(CalibrationRecord *record) {
+    CalibrationRecord newest;
+    uint32_t slot;
+    uint32_t sequence = calibration_store_scan(&newest, &slot) ? newest.sequence + 1 : 1;
+
+    if (slot == PERSIST_CAL_SLOTS) {
+        if (!persist_flash_erase()) {
+            return 0;
+        }
+        slot = 0;
+    }
+
+    record->magic = PERSIST_CAL_MAGIC;
+    record->version = PERSIST_CAL_VERSION;
+    record->size = sizeof(CalibrationRecord);
+    record->sequence = sequence;
+    memset(record->reserved, 0, sizeof(record->reserved));
+    record->crc = persist_crc32(record, offsetof(CalibrationRecord, crc));
+
+    uint32_t offset = slot * PERSIST_CAL_RECORD_SIZE;
+    if (!persist_flash_program(offset, record, sizeof(CalibrationRecord))) {
+        return 0;
+    }
+    return calibration_record_valid((const CalibrationRecord *)&persist_flash()[offset]);
+}
+
+static uint8_t warm_start_valid(const WarmStartRecord *record) {
+    return record->magic == PERSIST_WARM_MAGIC && record->version == PERSIST_WARM_VERSION &&
+           record->size == sizeof(WarmStartRecord) &&
+           record->crc == persist_crc32(record, offsetof(WarmStartRecord, crc));
+}
+
+/**
+ * @brief Loads the newest valid snapshot
+ * @param record Receives the snapshot, untouched if there is none
+ * @return 1 if a snapshot was found
+ * @details Later snapshots carry on the sequence of the one loaded.
+ */
+uint8_t warm_start_load(WarmStartRecord *record) {
+    const WarmStartRecord *backup = persist_backup();
+    const WarmStartRecord *newest = NULL;
+
+    for (int i = 0; i < PERSIST_WARM_SLOTS; i++) {
+        if (warm_start_valid(&backup[i]) &&
+            (newest == NULL || (int32_t)(backup[i].sequence - newest->sequence) > 0)) {
+            newest = &backup[i];
+        }
+    }
+    if (newest == NULL) {
+        return 0;
+    }
+    *record = *newest;
+    persist_warm_sequence = newest->sequence;
+    return 1;
+}
+
+/**
+ * @brief Stores a snapshot over the older of the two
+ * @param record Snapshot, its payload filled in; receives the header and CRC
+ *        it was stored with
+ */
+void warm_start_save(WarmStartRecord *record) {
+    record->magic = PERSIST_WARM_MAGIC;
+    record->version = PERSIST_WARM_VERSION;
+    record->size = sizeof(WarmStartRecord);
+    record->sequence = ++persist_warm_sequence;
+    record->crc = persist_crc32(record, offsetof(WarmStartRecord, crc));
+
+    persist_backup()[record->sequence % PERSIST_WARM_SLOTS] = *record;
+    persist_backup_sync();
+}
+
+/**
+ * @brief Invalidates both snapshots, so the next reset starts cold
+ */
+void warm_start_clear(void) {
+    memset(persist_backup(), 0, PERSIST_WARM_SLOTS * sizeof(WarmStartRecord));
+    persist_backup_sync();
+}
@@ -8,9 +8,15 @@
  * This file must not be made publicly available anywhere.
 */
 #include <stdio.h>
+#include <string.h>
 #include "state_est_helpers.h"
 #include "arm_math.h"
 #include "main.h"
+#include "baro_altitude.h"
+#include "trig.h"
+#include "persist.h"
+
+#define CALIBRATION_ORIGIN_RADIUS 50.0f   // m, largest distance of the first fix from a stored origin that is reused
 
 // Global variables
 uint16_t rocket_state;
@@ -35,6 +41,8 @@ uint8_t fekf_initialize;
 SerialData serial_data;
 Sensors sensors;
 GroundExtKalmanFilter gekf;
+BiasCalibrator bias_cal;
+MagCalibrator mag_cal;
 ExtKalmanFilter fekf;
 RocketAttitude rocket_atd;
 uint8_t signal_received[2];
@@ -42,6 +50,11 @@ float32_t launch_time_stamp;
 uint8_t launched;
 
 static StateMachine state_machine;
+static CalibrationRecord calibration;       // newest in flash, with what this boot added to it
+static uint8_t calibration_origin_done;     // the origin was stored or taken over this boot
+static uint8_t calibration_from_flash;      // the pad biases were taken over from flash
+static WarmStartRecord warm_start;
+static uint16_t warm_start_cycles;
 
 /**
  * @brief Calculates center of mass to IMU vector
@@ -65,11 +78,12 @@ float32_t* com_to_imu(float32_t seconds_since_launch, int launch_has_occurred) {
 
 /**
  * @brief Converts pressure to altitude using barometric formula
- * @param pressure Pressure reading in mbar
+ * @param pressure Pressure reading in Pa
  * @return Calculated altitude in meters
+ * @details Table based, see baro_altitude.h for the error against the formula
  */
 float32_t pressure2altitude(float32_t pressure) {
-    return (float32_t) (44330 * (1.0 - pow((pressure/100) / 1013.25, 0.1903)));
+    return baro_altitude(pressure, NULL);
 }
 
 /**
@@ -129,11 +143,137 @@ void print_matrix(const char* name, arm_matrix_instance_f32* mat, UART_HandleTyp
     HAL_UART_Transmit(huart, (uint8_t*)"\r\n", 2, HAL_MAX_DELAY);
 }
 
+/**
+ * @brief Appends the calibration to flash and reports a failure
+ */
+static void save_calibration(void) {
+    if (!calibration_store_save(&calibration)) {
+        HAL_UART_Transmit(&huart3, (uint8_t*)"Could not store the calibration in flash\r\n", 42, HAL_MAX_DELAY);
+    }
+}
+
+/**
+ * @brief Takes over the stored pad origin if the first fix is close to it
+ * @details Keeps positions in the same frame from one boot to the next on the same pad. GPS2Flat() sets the origin
+ *          from the fix itself otherwise.
+ */
+static void reuse_calibration_origin(void) {
+    GpsFix stored = {
+        .lat = calibration.origin_lat,
+        .lon = calibration.origin_lon,
+        .height = calibration.origin_height,
+        .valid = 1,
+    };
+    GnssOrigin origin;
+    float32_t enu[3];
+
+    gnss_origin_set(&origin, &stored);
+    gnss_origin_fix_to_enu(&origin, &sensors.gps_fix, enu);
+    if (enu[0] * enu[0] + enu[1] * enu[1] + enu[2] * enu[2] <= CALIBRATION_ORIGIN_RADIUS * CALIBRATION_ORIGIN_RADIUS) {
+        fekf.gnss_origin = origin;
+    }
+}
+
+/**
+ * @brief Snapshots the flight EKF, the attitude and the state machine into backup SRAM
+ */
+static void save_warm_start(void) {
+    warm_start.state = rocket_state;
+    warm_start.launched = !launched;
+    warm_start.first_iter = (uint8_t)first_iter;
+    warm_start.nx = fekf.nx;
+    warm_start.nz = fekf.nz;
+    warm_start.since_launch = launched ? 0 : (uint32_t)(global_time - launch_time_stamp);
+    warm_start.since_fast_ascent = global_time_seconds - fast_ascent_start_time;
+
+    memcpy(warm_start.x, fekf.x_n.pData, fekf.nx * sizeof(float32_t));
+    memcpy(warm_start.P, fekf.P_n.pData, fekf.nx * fekf.nx * sizeof(float32_t));
+    memcpy(warm_start.launch_gps, fekf.launch_gps, sizeof(warm_start.launch_gps));
+    warm_start.gnss_origin = fekf.gnss_origin;
+    warm_start.baro_ref = fekf.baro_ref;
+    warm_start.baro_ref_valid = fekf.baro_ref_valid;
+
+    warm_start.q[0] = rocket_atd.q_current_s;
+    warm_start.q[1] = rocket_atd.q_current_x;
+    warm_start.q[2] = rocket_atd.q_current_y;
+    warm_start.q[3] = rocket_atd.q_current_z;
+    memcpy(warm_start.mag_ref, rocket_atd.mag_ref, sizeof(warm_start.mag_ref));
+    warm_start.mag_ref_norm = rocket_atd.mag_ref_norm;
+    warm_start.mag_ref_valid = rocket_atd.mag_ref_valid;
+
+    warm_start.accel_bias[0] = sensors.accel_bias_x;
+    warm_start.accel_bias[1] = sensors.accel_bias_y;
+    warm_start.accel_bias[2] = sensors.accel_bias_z;
+    warm_start.gyro_bias[0] = sensors.gyro_bias_x;
+    warm_start.gyro_bias[1] = sensors.gyro_bias_y;
+    warm_start.gyro_bias[2] = sensors.gyro_bias_z;
+    warm_start.mag_offset[0] = sensors.mag_offset_x;
+    warm_start.mag_offset[1] = sensors.mag_offset_y;
+    warm_start.mag_offset[2] = sensors.mag_offset_z;
+    warm_start.mag_scale[0] = sensors.mag_scale_x;
+    warm_start.mag_scale[1] = sensors.mag_scale_y;
+    warm_start.mag_scale[2] = sensors.mag_scale_z;
+
+    warm_start_save(&warm_start);
+}
+
+/**
+ * @brief Carries on from a backup SRAM snapshot after a reset
+ * @param snapshot Snapshot from warm_start_load()
+ * @return 1 if the estimator resumed, 0 if the snapshot does not fit this build and it starts cold
+ * @details The flight EKF must be initialized already. Times are moved to the new HAL_GetTick() epoch, the time
+ *          the reset itself took is lost.
+ */
+static uint8_t resume_warm_start(const WarmStartRecord *snapshot) {
+    if (snapshot->state <= GROUND || snapshot->state > LANDED || snapshot->nx != fekf.nx || snapshot->nz != fekf.nz) {
+        return 0;
+    }
+
+    memcpy(fekf.x_n.pData, snapshot->x, fekf.nx * sizeof(float32_t));
+    memcpy(fekf.P_n.pData, snapshot->P, fekf.nx * fekf.nx * sizeof(float32_t));
+    memcpy(fekf.launch_gps, snapshot->launch_gps, sizeof(fekf.launch_gps));
+    fekf.gnss_origin = snapshot->gnss_origin;
+    fekf.baro_ref = snapshot->baro_ref;
+    fekf.baro_ref_valid = snapshot->baro_ref_valid;
+
+    initialize_rocket_attitude(&rocket_atd, snapshot->q[0], snapshot->q[1], snapshot->q[2], snapshot->q[3]);
+    memcpy(rocket_atd.mag_ref, snapshot->mag_ref, sizeof(rocket_atd.mag_ref));
+    rocket_atd.mag_ref_norm = snapshot->mag_ref_norm;
+    rocket_atd.mag_ref_valid = snapshot->mag_ref_valid;
+
+    sensors.accel_bias_x = snapshot->accel_bias[0];
+    sensors.accel_bias_y = snapshot->accel_bias[1];
+    sensors.accel_bias_z = snapshot->accel_bias[2];
+    sensors.gyro_bias_x = snapshot->gyro_bias[0];
+    sensors.gyro_bias_y = snapshot->gyro_bias[1];
+    sensors.gyro_bias_z = snapshot->gyro_bias[2];
+    sensors.mag_offset_x = snapshot->mag_offset[0];
+    sensors.mag_offset_y = snapshot->mag_offset[1];
+    sensors.mag_offset_z = snapshot->mag_offset[2];
+    sensors.mag_scale_x = snapshot->mag_scale[0];
+    sensors.mag_scale_y = snapshot->mag_scale[1];
+    sensors.mag_scale_z = snapshot->mag_scale[2];
+
+    launched = !snapshot->launched;
+    launch_time_stamp = (float32_t)global_time - (float32_t)snapshot->since_launch;
+    first_iter = snapshot->first_iter;
+    fast_ascent_start_time = global_time_seconds - snapshot->since_fast_ascent;
+    gekf_initialize = 0;
+    fekf_initialize = 0;
+    calibration_origin_done = 1;
+    transition_state((RocketState)snapshot->state);
+    return 1;
+}
+
 /**
  * @brief Initialize state machine and related subsystems
- * @details Initializes state handlers, variables, EKF systems, and UART communications
+ * @details Initializes state handlers, variables, the trigonometry backend, EKF systems, and UART communications.
+ *          Loads the calibration stored in flash, and after a reset that kept the backup SRAM resumes from the last
+ *          snapshot without waiting for the MainMCU.
  */
 void state_machine_init(void) {
+    trig_init();
+
     state_machine.stateHandlers[IDLE] = handle_idle;
     state_machine.stateHandlers[GROUND] = handle_ground;
     state_machine.stateHandlers[ARMED] = handle_armed;
@@ -159,22 +299,74 @@ void state_machine_init(void) {
     gekf_initialize = 1;
     fekf_initialize = 1;
     iterations = 0;
+    mag_calibrator_init(&mag_cal);
+    launched = 1;
+    calibration_origin_done = 0;
+    calibration_from_flash = 0;
+    warm_start_cycles = 0;
+
+    uint8_t warm = persist_init();
+    if (!calibration_store_load(&calibration)) {
+        memset(&calibration, 0, sizeof(calibration));
+    }
+    initialize_ekf(&fekf, &huart3, &sensors, 3);  
+    initialize_ekf_ground(&gekf, &huart3, &sensors, 6); 
+
+    if (warm && warm_start_load(&warm_start) && resume_warm_start(&warm_start)) {
+        HAL_UART_Receive_IT(&huart2, signal_received, 2);
+        HAL_UART_Transmit(&huart3, (uint8_t*)"Resumed from the backup SRAM snapshot\r\n", 39, HAL_MAX_DELAY);
+        return;
+    }
 
     uint8_t tmp;
-    launched = 1;
     while(HAL_TIMEOUT != HAL_UART_Receive(&huart2, &tmp, 1, 10));
     HAL_UART_Receive_IT(&huart2, signal_received, 2);
-    initialize_ekf(&fekf, &huart3, &sensors, 3);  
-    initialize_ekf_ground(&gekf, &huart3, &sensors, 6); 
     HAL_Delay(500);
 }
 
+/**
+ * @brief Signals the flight events the detector raised and moves the state machine with them
+ * @details Runs on every main loop pass, so an event goes out on the line and the link as soon as the block that
+ *          shows it is in. Launch moves ARMED to FASTASCENT, burnout FASTASCENT to SLOWASCENT and apogee SLOWASCENT
+ *          to FREEFALL, ahead of the checks in the state handlers, which stay as the fallback.
+ */
+static void handle_flight_events(void) {
+    FlightEvent event;
+
+    while (event_detector_pop(&event_detector, &event)) {
+        signal_event(&event);
+        if (event.id == EVENT_LAUNCH && rocket_state == ARMED) {
+            // Back to the motor lighting, the detector saw it a few blocks ago
+            launch_time_stamp = (float32_t)HAL_GetTick() - (float32_t)((sensor_time_us() - event.time_us) / 1000u);
+            launched = 0;
+            transition_state(FASTASCENT);
+        } else if (event.id == EVENT_BURNOUT && rocket_state == FASTASCENT) {
+            transition_state(SLOWASCENT);
+            first_iter = 1;
+        } else if (event.id == EVENT_APOGEE && rocket_state == SLOWASCENT) {
+            transition_state(FREEFALL);
+            first_iter = 1;
+        }
+    }
+    event_link_poll(&huart2);
+}
+
 /**
  * @brief Main state machine execution function
- * @details Updates sensors, runs current state handler, updates timing, and logs data
+ * @details Updates sensors, signals flight events, runs current state handler, updates timing, and logs data.
+ *          Returns straight after the events unless update_sensors() has a new IMU block, so the state machine runs
+ *          at the IMU pipeline rate. The passes in between advance the vibration monitor by one bounded step each
+ *          and give the fault detector up to FAULT_PASS_BUDGET cycles.
+ *          From ARMED on the estimator is snapshotted into backup SRAM every PERSIST_WARM_PERIOD runs.
  */
 void state_machine_run(void) {
-    update_sensors(&sensors, &huart3);
+    uint8_t cycle = update_sensors(&sensors, &huart3);
+    handle_flight_events();
+    if (!cycle) {
+        vibration_monitor_step(&vibration_monitor);
+        fault_detector_step(&fault_detector, FAULT_PASS_BUDGET);
+        return;
+    }
     state_machine.currentState = rocket_state;
     if (state_machine.stateHandlers[state_machine.currentState] != NULL) {
         state_machine.stateHandlers[state_machine.currentState]();
@@ -184,6 +376,14 @@ void state_machine_run(void) {
     if (rocket_state > ARMED) {
       serial_data.t = (global_time - launch_time_stamp) / 1000.0f;
     }
+    if (rocket_state > GROUND && ++warm_start_cycles >= PERSIST_WARM_PERIOD) {
+        save_warm_start();
+        warm_start_cycles = 0;
+    }
+    serial_data.health = fekf.health;
+    vibration_monitor_next_record(&vibration_monitor, &serial_data.vibration);
+    serial_data.sensor_faults = fault_detector_mask(&fault_detector);
+    serial_data.gnss_r_scale = noise_adapt_r_scale(&fekf.noise);
     log_data(&serial_data, &sensors, &huart2);
 }
 
@@ -226,35 +426,111 @@ void handle_idle(void) {
 
 /**
  * @brief Handle GROUND state operations
- * @details Initializes and updates ground EKF, runs ground operations
+ * @details Initializes the ground EKF struct and the bias and magnetometer calibrators, runs ground operations.
+ *          Arms as soon as one block of samples agrees with the biases stored in flash, the full calibration runs
+ *          otherwise.
  */
 void handle_ground(void) {
     if (gekf_initialize) {
         initialize_ekf_ground(&gekf, &huart3, &sensors, 6);
+        bias_calibrator_init(&bias_cal);
+        mag_calibrator_init(&mag_cal);
         gekf_initialize = 0;
     }
     update_ekf_ground(&gekf, &sensors);
-    run_ground(&gekf, &sensors, &serial_data, &huart3);
+    run_ground(&gekf, &bias_cal, &sensors, &serial_data, &huart3);
+    mag_calibrator_update(&mag_cal, &sensors);
     iterations++;
+
+    if (rocket_state == GROUND && (calibration.flags & PERSIST_CAL_BIASES)) {
+        float32_t stored[BIAS_CAL_CHANNELS];
+        memcpy(stored, calibration.accel_bias, sizeof(calibration.accel_bias));
+        memcpy(&stored[3], calibration.gyro_bias, sizeof(calibration.gyro_bias));
+        if (bias_calibrator_agrees(&bias_cal, stored, calibration.bias_var)) {
+            memcpy(bias_cal.mean_var, calibration.bias_var, sizeof(calibration.bias_var));
+            sensors.accel_bias_x = stored[0];
+            sensors.accel_bias_y = stored[1];
+            sensors.accel_bias_z = stored[2];
+            sensors.gyro_bias_x = stored[3];
+            sensors.gyro_bias_y = stored[4];
+            sensors.gyro_bias_z = stored[5];
+            HAL_UART_Transmit(&huart3, (uint8_t*)"Biases agree with the stored calibration\r\n", 42, HAL_MAX_DELAY);
+            calibration_from_flash = 1;
+            rocket_state = ARMED;
+        }
+    }
 }
 
 /**
  * @brief Handles operations in ARMED state
- * @details Initializes flight EKF and rocket attitude, monitors for launch conditions
+ * @details Initializes flight EKF and rocket attitude, applies the magnetometer calibration and averages the pad
+ *          heading reference, arms the event detector and monitors for launch conditions. Stores the calibrations
+ *          this boot produced in flash, a magnetometer that saw too little rotation falls back on the stored
+ *          calibration.
  */
 void handle_armed(void) {
     if (fekf_initialize) {
         initialize_ekf(&fekf, &huart3, &sensors, 3);
         initialize_rocket_attitude(&rocket_atd, 1, 0, 0, 0); 
+        uint8_t calibrated = 0;
+        if (!calibration_from_flash) {
+            calibration.accel_bias[0] = sensors.accel_bias_x;
+            calibration.accel_bias[1] = sensors.accel_bias_y;
+            calibration.accel_bias[2] = sensors.accel_bias_z;
+            calibration.gyro_bias[0] = sensors.gyro_bias_x;
+            calibration.gyro_bias[1] = sensors.gyro_bias_y;
+            calibration.gyro_bias[2] = sensors.gyro_bias_z;
+            memcpy(calibration.bias_var, bias_cal.mean_var, sizeof(calibration.bias_var));
+            calibration.flags |= PERSIST_CAL_BIASES;
+            calibrated = 1;
+        }
+        if (mag_cal.converged) {
+            mag_calibrator_apply(&mag_cal, &sensors);
+            memcpy(calibration.mag_offset, mag_cal.offset, sizeof(calibration.mag_offset));
+            memcpy(calibration.mag_scale, mag_cal.scale, sizeof(calibration.mag_scale));
+            calibration.flags |= PERSIST_CAL_MAG;
+            calibrated = 1;
+        } else if (calibration.flags & PERSIST_CAL_MAG) {
+            sensors.mag_offset_x = calibration.mag_offset[0];
+            sensors.mag_offset_y = calibration.mag_offset[1];
+            sensors.mag_offset_z = calibration.mag_offset[2];
+            sensors.mag_scale_x = calibration.mag_scale[0];
+            sensors.mag_scale_y = calibration.mag_scale[1];
+            sensors.mag_scale_z = calibration.mag_scale[2];
+            HAL_UART_Transmit(&huart3, (uint8_t*)"Magnetometer calibration from flash\r\n", 37, HAL_MAX_DELAY);
+        } else {
+            mag_calibrator_apply(&mag_cal, &sensors);
+            HAL_UART_Transmit(&huart3, (uint8_t*)"Magnetometer not calibrated, too little rotation on the pad\r\n", 61, HAL_MAX_DELAY);
+        }
+        if (calibrated) {
+            save_calibration();
+        }
+        event_detector_arm(&event_detector, 1);
         fekf_initialize = 0;
     }
+    mag_heading_reference(&rocket_atd, &sensors);
     
+    if (!fekf.gnss_origin.valid && sensors.gps_fix.valid && (calibration.flags & PERSIST_CAL_ORIGIN)) {
+        reuse_calibration_origin();
+        calibration_origin_done = fekf.gnss_origin.valid;
+    }
+    // gps_flat is relative to the previous launch_gps, track the pad position
     GPS2Flat(&sensors, &fekf, 0);
-    fekf.launch_gps[0] = fekf.gps_flat[0];
-    fekf.launch_gps[1] = fekf.gps_flat[1];
-    fekf.launch_gps[2] = fekf.gps_flat[2];
+    if (!calibration_origin_done && fekf.gnss_origin.valid) {
+        calibration.origin_lat = fekf.gnss_origin.lat;
+        calibration.origin_lon = fekf.gnss_origin.lon;
+        calibration.origin_height = fekf.gnss_origin.height;
+        calibration.flags |= PERSIST_CAL_ORIGIN;
+        save_calibration();
+        calibration_origin_done = 1;
+    }
+    fekf.launch_gps[0] += fekf.gps_flat[0];
+    fekf.launch_gps[1] += fekf.gps_flat[1];
+    fekf.launch_gps[2] += fekf.gps_flat[2];
+    Baro2Flat(&sensors, &fekf, 1);
     
-    if (fekf.accelerometer[0] > 4.9) {
+    // Fallback for a launch the detector missed: the compensated long axis reads half a g over gravity
+    if (sensors.accel_x + sensors.accel_bias_x - ATTITUDE_GRAVITY > 4.9f) {
         char debug_buffer[256];
         int len = snprintf(debug_buffer, sizeof(debug_buffer), "Transitioning to FASTASCENT\r\n");
         HAL_UART_Transmit(&huart3, (uint8_t*)debug_buffer, len, HAL_MAX_DELAY);
@@ -264,7 +540,8 @@ void handle_armed(void) {
 
 /**
  * @brief Handles operations in FASTASCENT state
- * @details Processes initial launch phase and fast ascent calculations
+ * @details Processes initial launch phase and fast ascent calculations. A launch the event detector raised is
+ *          already stamped at its onset, the fallback in handle_armed() is stamped here.
  */
 void handle_fast_ascent(void) {
     if (launched) {
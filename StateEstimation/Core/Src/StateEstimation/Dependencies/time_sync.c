@@ -0,0 +1,181 @@
+/**
+ * @file time_sync.c
+ * @brief Mapping between the local microsecond timeline and GPS time, disciplined by the receiver's time pulse
+ *
+ * @details time_sync_pps() runs in the capture interrupt and only stores the
+ *          edge. Everything else runs from the main loop, between one edge
+ *          and the next, which are a second apart.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "time_sync.h"
+
+#define TIME_SYNC_SECOND_MS 1000
+
+// Adds ms to a time of week, wrapping at the end of the week
+static uint32_t tow_add(uint32_t tow_ms, int32_t ms) {
+    int64_t t = ((int64_t)tow_ms + ms) % TIME_SYNC_WEEK_MS;
+    return (uint32_t)(t < 0 ? t + TIME_SYNC_WEEK_MS : t);
+}
+
+// a - b in ms, the shorter way round the week
+static int32_t tow_diff(uint32_t a, uint32_t b) {
+    int64_t d = ((int64_t)a - b) % TIME_SYNC_WEEK_MS;
+    if (d > TIME_SYNC_WEEK_MS / 2) {
+        d -= TIME_SYNC_WEEK_MS;
+    } else if (d <= -(int64_t)(TIME_SYNC_WEEK_MS / 2)) {
+        d += TIME_SYNC_WEEK_MS;
+    }
+    return (int32_t)d;
+}
+
+/**
+ * @brief Starts with no mapping and no drift
+ * @param ts Mapping to initialize
+ */
+void time_sync_init(TimeSync *ts) {
+    memset(ts, 0, sizeof(TimeSync));
+}
+
+/**
+ * @brief Takes a captured time pulse edge
+ * @param ts Mapping
+ * @param local_us Local time of the edge, from the timer capture
+ * @details Only the latest edge is kept until a solution matches it.
+ */
+void time_sync_pps(TimeSync *ts, uint32_t local_us) {
+    ts->pps_local = local_us;
+    ts->pps_pending = 1;
+}
+
+// Drops an edge, and the mapping with it after too many in a row
+static void time_sync_reject(TimeSync *ts, uint32_t local_us, uint32_t tow_ms) {
+    ts->rejected++;
+    if (++ts->rejects < TIME_SYNC_MAX_REJECTS && ts->edges >= TIME_SYNC_LOCK_EDGES) {
+        return;
+    }
+    // Start over from this edge, keeping the drift as a first guess
+    ts->ref_local = local_us;
+    ts->ref_tow = tow_ms;
+    ts->edges = 1;
+    ts->rejects = 0;
+}
+
+// Moves the mapping to an edge known to be at tow_ms
+static void time_sync_edge(TimeSync *ts, uint32_t local_us, uint32_t tow_ms) {
+    if (ts->edges == 0) {
+        ts->ref_local = local_us;
+        ts->ref_tow = tow_ms;
+        ts->edges = 1;
+        ts->matched++;
+        return;
+    }
+
+    int32_t gps_ms = tow_diff(tow_ms, ts->ref_tow);
+    if (gps_ms <= 0) {
+        return;
+    }
+    float32_t gps_us = (float32_t)gps_ms * 1000.0f;
+    int32_t local_span = (int32_t)(local_us - ts->ref_local);
+    float32_t measured = (float32_t)local_span / gps_us - 1.0f;
+
+    ts->residual = (float32_t)local_span - gps_us * (1.0f + ts->drift);
+    if (fabsf(measured) > TIME_SYNC_MAX_DRIFT ||
+        (ts->edges >= TIME_SYNC_LOCK_EDGES && fabsf(ts->residual) > TIME_SYNC_MAX_RESIDUAL_US)) {
+        time_sync_reject(ts, local_us, tow_ms);
+        return;
+    }
+
+    ts->drift = ts->edges == 1 ? measured : ts->drift + TIME_SYNC_DRIFT_GAIN * (measured - ts->drift);
+    ts->ref_local = local_us;
+    ts->ref_tow = tow_ms;
+    if (ts->edges < TIME_SYNC_LOCK_EDGES) {
+        ts->edges++;
+    }
+    ts->rejects = 0;
+    ts->matched++;
+}
+
+/**
+ * @brief Matches the pending edge to a GPS second with a navigation solution
+ * @param ts Mapping
+ * @param tow_ms GPS time of week of the solution
+ * @param arrival_us Local time the solution came in
+ * @details Call with every solution whose time is valid. An edge that
+ *          comes after the solution, or more than a second before it, is
+ *          left for the next one or dropped.
+ */
+void time_sync_solution(TimeSync *ts, uint32_t tow_ms, uint32_t arrival_us) {
+    if (ts->edges && (uint32_t)(arrival_us - ts->ref_local) > TIME_SYNC_HOLDOVER_MS * 1000u) {
+        ts->edges = 0;
+    }
+    if (!ts->pps_pending) {
+        return;
+    }
+    uint32_t pps_local = ts->pps_local;
+    int32_t back_us = (int32_t)(arrival_us - pps_local);
+    if (back_us < 0) {
+        return;
+    }
+    ts->pps_pending = 0;
+    int32_t back_ms = back_us / 1000;
+    if (back_ms > TIME_SYNC_SECOND_MS) {
+        return;
+    }
+
+    uint32_t guess = tow_add(tow_ms, TIME_SYNC_LATENCY_MS - back_ms);
+    uint32_t second = tow_add(guess, TIME_SYNC_SECOND_MS / 2);
+    time_sync_edge(ts, pps_local, second - second % TIME_SYNC_SECOND_MS);
+}
+
+/**
+ * @brief Whether the mapping may be used
+ * @param ts Mapping
+ * @return 1 after TIME_SYNC_LOCK_EDGES edges matched in a row
+ */
+uint8_t time_sync_locked(const TimeSync *ts) {
+    return ts->edges >= TIME_SYNC_LOCK_EDGES;
+}
+
+/**
+ * @brief Local time of a GPS time of week
+ * @param ts Mapping
+ * @param tow_ms GPS time of week
+ * @param local_us Receives the local time, untouched if there is no mapping
+ * @return 1 if the mapping is locked and tow_ms within TIME_SYNC_HOLDOVER_MS of
+ *         the last edge
+ */
+uint8_t time_sync_to_local(const TimeSync *ts, uint32_t tow_ms, uint32_t *local_us) {
+    int32_t gps_ms = tow_diff(tow_ms, ts->ref_tow);
+
+    if (!time_sync_locked(ts) || gps_ms > TIME_SYNC_HOLDOVER_MS || gps_ms < -TIME_SYNC_HOLDOVER_MS) {
+        return 0;
+    }
+    // Whole ms in integers, only the drift term in float
+    int32_t gps_us = gps_ms * 1000;
+    *local_us = ts->ref_local + (uint32_t)(gps_us + (int32_t)lroundf((float32_t)gps_us * ts->drift));
+    return 1;
+}
+
+/**
+ * @brief GPS time of week of a local time
+ * @param ts Mapping
+ * @param local_us Local time
+ * @param tow_ms Receives the time of week to the nearest ms, untouched if
+ *        there is no mapping
+ * @return 1 if the mapping is locked and local_us within TIME_SYNC_HOLDOVER_MS
+ *         of the last edge
+ */
+uint8_t time_sync_to_tow(const TimeSync *ts, uint32_t local_us, uint32_t *tow_ms) {
+    int32_t local_span = (int32_t)(local_us - ts->ref_local);
+
+    if (!time_sync_locked(ts) || local_span > TIME_SYNC_HOLDOVER_MS * 1000 ||
+        local_span < -TIME_SYNC_HOLDOVER_MS * 1000) {
+        return 0;
+    }
+    float32_t gps_us = (float32_t)local_span / (1.0f + ts->drift);
+    *tow_ms = tow_add(ts->ref_tow, (int32_t)lroundf(gps_us / 1000.0f));
+    return 1;
+}
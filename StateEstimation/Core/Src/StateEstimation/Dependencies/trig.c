@@ -0,0 +1,239 @@
+/**
+ * @file trig.c
+ * @brief Trigonometry for the estimator with a build time choice of backend
+ *
+ * @details The polynomials are the single precision Cephes ones: sine and
+ *          cosine on [-pi/4, pi/4] after a three constant Cody-Waite reduction
+ *          by pi/2, and arctangent on [0, tan(pi/8)] after folding the
+ *          argument into the first octant.
+ */
+
+#include <math.h>
+
+#include "trig.h"
+
+#if TRIG_BACKEND == TRIG_BACKEND_CORDIC
+#include "stm32h7xx_hal.h"
+#include "stm32h7xx_ll_cordic.h"
+#endif
+
+#define TRIG_PI_F 3.14159265358979f
+#define TRIG_PIO2_F 1.57079632679490f
+#define TRIG_PIO4_F 0.78539816339745f
+#define TRIG_2_OVER_PI_F 0.63661977236758f
+// pi/2 in three parts, the first two with enough trailing zeros that j times
+// them is exact over the range the error bounds cover
+#define TRIG_PIO2_1 1.5703125f
+#define TRIG_PIO2_2 4.837512969970703125e-4f
+#define TRIG_PIO2_3 7.549789948768648e-8f
+#define TRIG_TAN_PIO8 0.41421356237310f
+
+/**
+ * @brief Sine and cosine from range reduction and polynomials
+ * @param angle rad
+ * @param s Receives the sine
+ * @param c Receives the cosine
+ */
+void trig_poly_sincos(float32_t angle, float32_t *s, float32_t *c) {
+    // angle = j pi/2 + r, |r| <= pi/4
+    float32_t j = nearbyintf(angle * TRIG_2_OVER_PI_F);
+    float32_t r = ((angle - j * TRIG_PIO2_1) - j * TRIG_PIO2_2) - j * TRIG_PIO2_3;
+    float32_t r2 = r * r;
+
+    float32_t sin_r = r + r * r2 * (-1.6666654611e-1f + r2 * (8.3321608736e-3f + r2 * -1.9515295891e-4f));
+    float32_t cos_r = 1.0f - 0.5f * r2 + r2 * r2 * (4.166664568298827e-2f + r2 * (-1.388731625493765e-3f + r2 * 2.443315711809948e-5f));
+
+    switch ((int32_t)j & 3) {
+        case 0: *s = sin_r;  *c = cos_r;  break;
+        case 1: *s = cos_r;  *c = -sin_r; break;
+        case 2: *s = -sin_r; *c = -cos_r; break;
+        default: *s = -cos_r; *c = sin_r; break;
+    }
+}
+
+/**
+ * @brief Arctangent of y / x in the quadrant of (x, y) from a polynomial
+ * @param y Ordinate
+ * @param x Abscissa
+ * @return rad, in [-pi, pi], 0 for (0, 0)
+ */
+float32_t trig_poly_atan2(float32_t y, float32_t x) {
+    float32_t ax = fabsf(x);
+    float32_t ay = fabsf(y);
+    float32_t hi = fmaxf(ax, ay);
+    float32_t lo = fminf(ax, ay);
+
+    if (hi == 0.0f) {
+        return 0.0f;
+    }
+
+    // First octant, t = lo / hi in [0, 1], folded once more onto [0, tan(pi/8)]
+    float32_t t = lo / hi;
+    float32_t base = 0.0f;
+    if (t > TRIG_TAN_PIO8) {
+        t = (t - 1.0f) / (t + 1.0f);
+        base = TRIG_PIO4_F;
+    }
+    float32_t z = t * t;
+    float32_t a = base + t + t * z * (-3.33329491539e-1f + z * (1.99777106478e-1f + z * (-1.38776856032e-1f + z * 8.05374449538e-2f)));
+
+    if (ay > ax) {
+        a = TRIG_PIO2_F - a;
+    }
+    if (x < 0.0f) {
+        a = TRIG_PI_F - a;
+    }
+    return y < 0.0f ? -a : a;
+}
+
+#if TRIG_BACKEND == TRIG_BACKEND_CORDIC
+
+#define TRIG_Q31_SCALE 2147483648.0f
+#define TRIG_Q31_ONE 0x7FFFFFFF
+
+static inline int32_t trig_to_q31(float32_t value) {
+    return value >= 1.0f ? TRIG_Q31_ONE : (int32_t)(value * TRIG_Q31_SCALE);
+}
+
+static inline float32_t trig_from_q31(int32_t value) {
+    return (float32_t)value * (1.0f / TRIG_Q31_SCALE);
+}
+
+// Angle in units of pi, wrapped to [-1, 1) as the CORDIC takes it
+static inline int32_t trig_angle_to_q31(float32_t angle) {
+    float32_t a = angle * (1.0f / TRIG_PI_F);
+    a -= 2.0f * nearbyintf(0.5f * a);
+    return a >= 1.0f ? (int32_t)0x80000000 : trig_to_q31(a);
+}
+
+static void trig_cordic_config(uint32_t function, uint32_t nb_write, uint32_t nb_read) {
+    LL_CORDIC_Config(CORDIC, function, LL_CORDIC_PRECISION_6CYCLES, LL_CORDIC_SCALE_0, nb_write, nb_read,
+                     LL_CORDIC_INSIZE_32BITS, LL_CORDIC_OUTSIZE_32BITS);
+}
+
+/**
+ * @brief Enables the CORDIC clock, call once before any other function here
+ */
+void trig_init(void) {
+    __HAL_RCC_CORDIC_CLK_ENABLE();
+}
+
+/**
+ * @brief Sines and cosines of several angles, the unit configured once
+ * @param angle rad, n values
+ * @param s Receives the sines
+ * @param c Receives the cosines
+ * @param n Number of angles
+ * @details Zero-overhead mode: reading RDATA stalls the bus until the result
+ *          is ready, so no flag is polled.
+ */
+void trig_sincos_batch(const float32_t *angle, float32_t *s, float32_t *c, uint32_t n) {
+    trig_cordic_config(LL_CORDIC_FUNCTION_COSINE, LL_CORDIC_NBWRITE_2, LL_CORDIC_NBREAD_2);
+    for (uint32_t i = 0; i < n; i++) {
+        LL_CORDIC_WriteData(CORDIC, (uint32_t)trig_angle_to_q31(angle[i]));
+        LL_CORDIC_WriteData(CORDIC, TRIG_Q31_ONE);  // modulus
+        c[i] = trig_from_q31((int32_t)LL_CORDIC_ReadData(CORDIC));
+        s[i] = trig_from_q31((int32_t)LL_CORDIC_ReadData(CORDIC));
+    }
+}
+
+/**
+ * @brief Arctangents of several y / x pairs, the unit configured once
+ * @param y Ordinates, n values
+ * @param x Abscissas, n values
+ * @param angle Receives rad, in [-pi, pi]
+ * @param n Number of pairs
+ * @details Each pair is scaled so its larger magnitude is 1/2, inside the
+ *          q1.31 range and with the modulus output unable to overflow.
+ */
+void trig_atan2_batch(const float32_t *y, const float32_t *x, float32_t *angle, uint32_t n) {
+    trig_cordic_config(LL_CORDIC_FUNCTION_PHASE, LL_CORDIC_NBWRITE_2, LL_CORDIC_NBREAD_1);
+    for (uint32_t i = 0; i < n; i++) {
+        float32_t hi = fmaxf(fabsf(x[i]), fabsf(y[i]));
+        if (hi == 0.0f) {
+            angle[i] = 0.0f;
+            continue;
+        }
+        float32_t scale = 0.5f / hi;
+        LL_CORDIC_WriteData(CORDIC, (uint32_t)trig_to_q31(x[i] * scale));
+        LL_CORDIC_WriteData(CORDIC, (uint32_t)trig_to_q31(y[i] * scale));
+        angle[i] = TRIG_PI_F * trig_from_q31((int32_t)LL_CORDIC_ReadData(CORDIC));
+    }
+}
+
+#elif TRIG_BACKEND == TRIG_BACKEND_POLY
+
+void trig_init(void) {
+}
+
+void trig_sincos_batch(const float32_t *angle, float32_t *s, float32_t *c, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        trig_poly_sincos(angle[i], &s[i], &c[i]);
+    }
+}
+
+void trig_atan2_batch(const float32_t *y, const float32_t *x, float32_t *angle, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        angle[i] = trig_poly_atan2(y[i], x[i]);
+    }
+}
+
+#else
+
+void trig_init(void) {
+}
+
+void trig_sincos_batch(const float32_t *angle, float32_t *s, float32_t *c, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        s[i] = (float32_t)sin((double)angle[i]);
+        c[i] = (float32_t)cos((double)angle[i]);
+    }
+}
+
+void trig_atan2_batch(const float32_t *y, const float32_t *x, float32_t *angle, uint32_t n) {
+    for (uint32_t i = 0; i < n; i++) {
+        angle[i] = (float32_t)atan2((double)y[i], (double)x[i]);
+    }
+}
+
+#endif
+
+/**
+ * @brief Sine and cosine of one angle
+ * @param angle rad
+ * @param s Receives the sine
+ * @param c Receives the cosine
+ */
+void trig_sincos(float32_t angle, float32_t *s, float32_t *c) {
+#if TRIG_BACKEND == TRIG_BACKEND_POLY
+    trig_poly_sincos(angle, s, c);
+#else
+    trig_sincos_batch(&angle, s, c, 1);
+#endif
+}
+
+/**
+ * @brief Arctangent of y / x in the quadrant of (x, y)
+ * @param y Ordinate
+ * @param x Abscissa
+ * @return rad, in [-pi, pi], 0 for (0, 0)
+ */
+float32_t trig_atan2(float32_t y, float32_t x) {
+#if TRIG_BACKEND == TRIG_BACKEND_POLY
+    return trig_poly_atan2(y, x);
+#else
+    float32_t angle;
+    trig_atan2_batch(&y, &x, &angle, 1);
+    return angle;
+#endif
+}
+
+/**
+ * @brief Arcsine, as the arctangent of x over sqrt(1 - x^2)
+ * @param x Clamped to [-1, 1], so rounding in a direction cosine cannot give NaN
+ * @return rad, in [-pi/2, pi/2]
+ */
+float32_t trig_asin(float32_t x) {
+    x = fminf(fmaxf(x, -1.0f), 1.0f);
+    return trig_atan2(x, sqrtf((1.0f - x) * (1.0f + x)));
+}
@@ -0,0 +1,227 @@
+/**
+ * @file vibration_monitor.c
+ * @brief Welch spectra of the raw ADIS16500 samples, summarised for the state frame
+ *
+ * @details Each bin of the averaged spectrum is scaled to the mean square it
+ *          holds, 2 |X|^2 / (N sum w^2) away from 0 Hz and the Nyquist
+ *          frequency, so a band is the sum of its bins and a tone the sum over
+ *          its main lobe. For the periodic Hann window a tone delta bins from
+ *          bin k has |X| in the ratio sinc(d) / (1 - d^2) at d = delta, 1 -
+ *          delta and 1 + delta, from which delta = 2 (b - a) / (a + 2 m + b)
+ *          with m the magnitude at k, a and b at k - 1 and k + 1.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "vibration_monitor.h"
+
+#define VIBRATION_PI 3.14159265358979f
+#define VIBRATION_MIN_PEAK_HZ 10.0f     // below this the mean removal and window leave only drift
+#define VIBRATION_LOBE 2                // bins either side of a peak, the Hann main lobe
+
+// Band edges in Hz, the last band runs up to the Nyquist frequency
+static const float32_t vibration_band_edges[VIBRATION_BANDS + 1] = {10.0f, 50.0f, 150.0f, 400.0f, 1000.0f};
+
+/**
+ * @brief Empties the records, builds the window and the FFT
+ * @param mon Monitor to initialize
+ * @param sample_rate Hz, of the samples vibration_monitor_push() gets
+ */
+void vibration_monitor_init(VibrationMonitor *mon, float32_t sample_rate) {
+    memset(mon, 0, sizeof(VibrationMonitor));
+    mon->sample_rate = sample_rate;
+    arm_rfft_fast_init_f32(&mon->fft, VIBRATION_FFT_SIZE);
+
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        mon->window[i] = 0.5f - 0.5f * cosf(2.0f * VIBRATION_PI * i / VIBRATION_FFT_SIZE);
+        mon->window_power += mon->window[i] * mon->window[i];
+    }
+    for (int s = 0; s < VIBRATION_SOURCES; s++) {
+        mon->record[s].source = (uint8_t)s;
+        memset(mon->record[s].band_db, VIBRATION_DB_NONE, sizeof(mon->record[s].band_db));
+        memset(mon->record[s].peak_db, VIBRATION_DB_NONE, sizeof(mon->record[s].peak_db));
+    }
+}
+
+/**
+ * @brief Adds raw samples and takes a segment every VIBRATION_HOP of them
+ * @param mon Monitor to feed
+ * @param block Raw counts, channel major as in ImuPipeline.block
+ * @param n Samples per channel
+ */
+void vibration_monitor_push(VibrationMonitor *mon, const int16_t block[][IMU_PIPELINE_MAX_DECIMATION], uint16_t n) {
+    for (uint16_t i = 0; i < n; i++) {
+        for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+            mon->history[c][mon->head] = block[c][i];
+        }
+        mon->head = (mon->head + 1) % VIBRATION_FFT_SIZE;
+        if (mon->filled < VIBRATION_FFT_SIZE) {
+            mon->filled++;
+        }
+        mon->since_segment++;
+
+        if (mon->filled < VIBRATION_FFT_SIZE || mon->since_segment < VIBRATION_HOP) {
+            continue;
+        }
+        mon->since_segment = 0;
+        if (mon->busy) {
+            mon->dropped++;
+            continue;
+        }
+        // Unroll the ring, oldest first
+        uint16_t tail = VIBRATION_FFT_SIZE - mon->head;
+        for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+            memcpy(mon->segment[c], &mon->history[c][mon->head], tail * sizeof(int16_t));
+            memcpy(&mon->segment[c][tail], mon->history[c], mon->head * sizeof(int16_t));
+        }
+        mon->busy = 1;
+        mon->channel = 0;
+    }
+}
+
+// Adds the windowed power spectrum of one channel of the segment to its source
+static void vibration_transform(VibrationMonitor *mon, uint8_t channel) {
+    const int16_t *x = mon->segment[channel];
+    int32_t sum = 0;
+
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        sum += x[i];
+    }
+    float32_t mean = (float32_t)sum / VIBRATION_FFT_SIZE;
+    for (int i = 0; i < VIBRATION_FFT_SIZE; i++) {
+        mon->buffer[i] = ((float32_t)x[i] - mean) * mon->window[i];
+    }
+    arm_rfft_fast_f32(&mon->fft, mon->buffer, mon->spectrum, 0);
+
+    // spectrum holds 0 Hz, then the Nyquist bin, then re, im from bin 1 on
+    arm_cmplx_mag_squared_f32(&mon->spectrum[2], &mon->buffer[1], VIBRATION_BINS - 2);
+    mon->buffer[0] = mon->spectrum[0] * mon->spectrum[0];
+    mon->buffer[VIBRATION_BINS - 1] = mon->spectrum[1] * mon->spectrum[1];
+
+    // Channels run gyro x, y, z then accel x, y, z
+    float32_t lsb = channel < 3 ? IMU_PIPELINE_GYRO_LSB : IMU_PIPELINE_ACCEL_LSB;
+    float32_t *power = mon->power[channel < 3 ? VIBRATION_GYRO : VIBRATION_ACCEL];
+    for (int k = 0; k < VIBRATION_BINS; k++) {
+        power[k] += lsb * lsb * mon->buffer[k];
+    }
+}
+
+static int8_t vibration_db(float32_t mean_square) {
+    if (!(mean_square > 0.0f)) {
+        return VIBRATION_DB_NONE;
+    }
+    float32_t db = 10.0f * log10f(mean_square);
+    return (int8_t)lroundf(fminf(fmaxf(db, -127.0f), 127.0f));
+}
+
+// Reduces the summed spectrum of one source to its record and clears it
+static void vibration_summarise(VibrationMonitor *mon, VibrationSource source) {
+    VibrationRecord *record = &mon->record[source];
+    float32_t *p = mon->power[source];
+    float32_t bin_hz = mon->sample_rate / VIBRATION_FFT_SIZE;
+    float32_t norm = 2.0f / (mon->segments * VIBRATION_FFT_SIZE * mon->window_power);
+    uint16_t peak[VIBRATION_PEAKS] = {0};
+    uint8_t found = 0;
+
+    // Mean square per bin, 0 Hz and Nyquist have no mirror image
+    for (int k = 0; k < VIBRATION_BINS; k++) {
+        p[k] *= norm;
+    }
+    p[0] *= 0.5f;
+    p[VIBRATION_BINS - 1] *= 0.5f;
+
+    record->source = (uint8_t)(source | (mon->spectra + 1) << 1);
+    record->segments = mon->segments;
+
+    for (int b = 0; b < VIBRATION_BANDS; b++) {
+        float32_t band = 0.0f;
+        for (int k = 0; k < VIBRATION_BINS; k++) {
+            float32_t f = k * bin_hz;
+            if (f >= vibration_band_edges[b] && (f < vibration_band_edges[b + 1] || b == VIBRATION_BANDS - 1)) {
+                band += p[k];
+            }
+        }
+        record->band_db[b] = vibration_db(band);
+    }
+
+    // Largest local maxima, kept sorted
+    int first = (int)ceilf(VIBRATION_MIN_PEAK_HZ / bin_hz);
+    for (int k = first > 1 ? first : 1; k < VIBRATION_BINS - 1; k++) {
+        if (!(p[k] > p[k - 1] && p[k] >= p[k + 1])) {
+            continue;
+        }
+        if (found == VIBRATION_PEAKS && p[k] <= p[peak[VIBRATION_PEAKS - 1]]) {
+            continue;
+        }
+        int slot = found < VIBRATION_PEAKS ? found++ : VIBRATION_PEAKS - 1;
+        while (slot > 0 && p[peak[slot - 1]] < p[k]) {
+            peak[slot] = peak[slot - 1];
+            slot--;
+        }
+        peak[slot] = (uint16_t)k;
+    }
+
+    for (int i = 0; i < VIBRATION_PEAKS; i++) {
+        if (i >= found) {
+            record->peak_freq[i] = 0;
+            record->peak_db[i] = VIBRATION_DB_NONE;
+            continue;
+        }
+        int k = peak[i];
+        float32_t a = sqrtf(p[k - 1]);
+        float32_t m = sqrtf(p[k]);
+        float32_t b = sqrtf(p[k + 1]);
+        float32_t delta = 2.0f * (b - a) / (a + 2.0f * m + b);
+        float32_t lobe = 0.0f;
+        for (int j = k - VIBRATION_LOBE; j <= k + VIBRATION_LOBE; j++) {
+            if (j >= 0 && j < VIBRATION_BINS) {
+                lobe += p[j];
+            }
+        }
+        long count = lroundf((k + delta) * bin_hz / VIBRATION_FREQ_STEP);
+        record->peak_freq[i] = (uint8_t)(count > 255 ? 255 : count);
+        record->peak_db[i] = vibration_db(lobe);
+    }
+
+    memset(p, 0, VIBRATION_BINS * sizeof(float32_t));
+}
+
+/**
+ * @brief Does one bounded piece of the spectral work, if there is any
+ * @param mon Monitor to advance
+ * @return 1 if it did any work
+ * @details One call transforms one channel of the pending segment, or reduces
+ *          the spectra once VIBRATION_SEGMENTS segments are in, never both.
+ */
+uint8_t vibration_monitor_step(VibrationMonitor *mon) {
+    if (mon->finish) {
+        vibration_summarise(mon, VIBRATION_ACCEL);
+        vibration_summarise(mon, VIBRATION_GYRO);
+        mon->spectra++;
+        mon->segments = 0;
+        mon->finish = 0;
+        return 1;
+    }
+    if (!mon->busy) {
+        return 0;
+    }
+    vibration_transform(mon, mon->channel);
+    if (++mon->channel == IMU_PIPELINE_CHANNELS) {
+        mon->busy = 0;
+        if (++mon->segments == VIBRATION_SEGMENTS) {
+            mon->finish = 1;
+        }
+    }
+    return 1;
+}
+
+/**
+ * @brief Latest summary of the accelerometer and gyro spectra in turn
+ * @param mon Monitor to read
+ * @param record Receives the record, the source alternating from one call to the next
+ */
+void vibration_monitor_next_record(VibrationMonitor *mon, VibrationRecord *record) {
+    *record = mon->record[mon->next_source];
+    mon->next_source ^= 1;
+}
@@ -24,6 +24,7 @@ void run_fast_ascent(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors *
         first_iter = 0;
     }
     run_attitude_estimation(rocket_atd, ekf->gyro);
+    mag_heading_correction(rocket_atd, sensors);
     run_ekf(ekf, rocket_atd, sensors, huart, 1);
     serial_data->state = FASTASCENT;
     serial_data->pos_x = ekf->x_n.pData[0];
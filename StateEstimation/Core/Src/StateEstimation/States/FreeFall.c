@@ -27,6 +27,7 @@ void run_freefall(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors *sen
     //float32_t accel_data[3] = {sensors->accel_x, sensors->accel_y, sensors->accel_z};
     float32_t gyro_data[3] = {sensors->gyro_x, sensors->gyro_y, sensors->gyro_z};
     run_attitude_estimation(rocket_atd, gyro_data);
+    mag_heading_correction(rocket_atd, sensors);
     run_ekf(ekf, rocket_atd, sensors, huart, 1);
 
     //float32_tphi = rocket_atd->phi;
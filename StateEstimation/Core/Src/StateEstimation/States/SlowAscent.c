@@ -24,6 +24,7 @@ void run_slow_ascent(ExtKalmanFilter *ekf, RocketAttitude *rocket_atd, Sensors *
     }
     float32_t gyro_data[3] = {sensors->gyro_x, sensors->gyro_y, sensors->gyro_z};
     run_attitude_estimation(rocket_atd, gyro_data);
+    mag_heading_correction(rocket_atd, sensors);
     run_ekf(ekf, rocket_atd, sensors, huart, 1);
     serial_data->state = SLOWASCENT;
     serial_data->pos_x = ekf->x_n.pData[0];
@@ -0,0 +1,13 @@
+/**
+ * @file attitude_test.h
+ * @brief Checks of the attitude propagation
+ */
+#ifndef __ATTITUDE_TEST_H__
+#define __ATTITUDE_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int attitude_test(FILE *out, uint64_t seed);
+
+#endif /* __ATTITUDE_TEST_H__ */
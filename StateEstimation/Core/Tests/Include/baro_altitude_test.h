@@ -0,0 +1,13 @@
+/**
+ * @file baro_altitude_test.h
+ * @brief Checks of the baro altitude table
+ */
+#ifndef __BARO_ALTITUDE_TEST_H__
+#define __BARO_ALTITUDE_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int baro_altitude_test(FILE *out, uint64_t seed);
+
+#endif /* __BARO_ALTITUDE_TEST_H__ */
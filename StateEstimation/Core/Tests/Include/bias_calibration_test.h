@@ -0,0 +1,13 @@
+/**
+ * @file bias_calibration_test.h
+ * @brief Checks of the pad bias calibration
+ */
+#ifndef __BIAS_CALIBRATION_TEST_H__
+#define __BIAS_CALIBRATION_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int bias_calibration_test(FILE *out, uint64_t seed);
+
+#endif /* __BIAS_CALIBRATION_TEST_H__ */
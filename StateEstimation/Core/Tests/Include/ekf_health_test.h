@@ -0,0 +1,13 @@
+/**
+ * @file ekf_health_test.h
+ * @brief Checks of the innovation gate and the forced accept
+ */
+#ifndef __EKF_HEALTH_TEST_H__
+#define __EKF_HEALTH_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int ekf_health_test(FILE *out, uint64_t seed);
+
+#endif /* __EKF_HEALTH_TEST_H__ */
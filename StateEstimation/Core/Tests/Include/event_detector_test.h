@@ -0,0 +1,13 @@
+/**
+ * @file event_detector_test.h
+ * @brief Checks of the flight event detector
+ */
+#ifndef __EVENT_DETECTOR_TEST_H__
+#define __EVENT_DETECTOR_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int event_detector_test(FILE *out, uint64_t seed);
+
+#endif /* __EVENT_DETECTOR_TEST_H__ */
@@ -0,0 +1,13 @@
+/**
+ * @file fault_detector_test.h
+ * @brief Checks of the sensor fault model and detector
+ */
+#ifndef __FAULT_DETECTOR_TEST_H__
+#define __FAULT_DETECTOR_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int fault_detector_test(FILE *out, uint64_t seed);
+
+#endif /* __FAULT_DETECTOR_TEST_H__ */
@@ -0,0 +1,13 @@
+/**
+ * @file flight_ekf_model_test.h
+ * @brief Checks of the generated EKF model kernels
+ */
+#ifndef __FLIGHT_EKF_MODEL_TEST_H__
+#define __FLIGHT_EKF_MODEL_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int flight_ekf_model_test(FILE *out, uint64_t seed);
+
+#endif /* __FLIGHT_EKF_MODEL_TEST_H__ */
@@ -0,0 +1,16 @@
+/**
+ * @file flight_ekf_test.h
+ * @brief Checks of the flight EKF measurement updates
+ */
+#ifndef __FLIGHT_EKF_TEST_H__
+#define __FLIGHT_EKF_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+#include "flight_ekf.h"
+
+int flight_ekf_test(FILE *out, uint64_t seed);
+void flight_ekf_test_setup(ExtKalmanFilter *ekf, RocketAttitude *atd, Sensors *s, float32_t sigma_v);
+
+#endif /* __FLIGHT_EKF_TEST_H__ */
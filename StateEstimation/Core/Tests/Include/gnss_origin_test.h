@@ -0,0 +1,13 @@
+/**
+ * @file gnss_origin_test.h
+ * @brief Checks of the GNSS tangent frame
+ */
+#ifndef __GNSS_ORIGIN_TEST_H__
+#define __GNSS_ORIGIN_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int gnss_origin_test(FILE *out, uint64_t seed);
+
+#endif /* __GNSS_ORIGIN_TEST_H__ */
@@ -0,0 +1,13 @@
+/**
+ * @file imu_pipeline_test.h
+ * @brief Checks of the IMU pipeline filters
+ */
+#ifndef __IMU_PIPELINE_TEST_H__
+#define __IMU_PIPELINE_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int imu_pipeline_test(FILE *out, uint64_t seed);
+
+#endif /* __IMU_PIPELINE_TEST_H__ */
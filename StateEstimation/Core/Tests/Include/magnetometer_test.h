@@ -0,0 +1,13 @@
+/**
+ * @file magnetometer_test.h
+ * @brief Checks of the magnetometer calibration
+ */
+#ifndef __MAGNETOMETER_TEST_H__
+#define __MAGNETOMETER_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int magnetometer_test(FILE *out, uint64_t seed);
+
+#endif /* __MAGNETOMETER_TEST_H__ */
@@ -0,0 +1,80 @@
+/**
+ * @file nn_dsp_host.h
+ * @brief Plain C stand-ins for the Cortex-M7 SIMD instructions CMSIS-NN and arm_math.h use
+ *
+ * @details The flight build takes the ARM_MATH_DSP path of the CMSIS-NN q7
+ *          kernels, which packs two q15 products into one SMLAD. The host
+ *          library builds their portable path instead. The host Makefile compiles
+ *          the kernels a second time with ARM_MATH_DSP, this header forced in
+ *          ahead of arm_math.h and every kernel renamed with a _dsp suffix, so
+ *          the tests can check the path the target runs against the others.
+ *
+ *          Each stand-in follows the Armv7E-M definition of the instruction,
+ *          lanes are little endian as on the STM32H7.
+ */
+#ifndef __NN_DSP_HOST_H__
+#define __NN_DSP_HOST_H__
+
+#include <stdint.h>
+
+#ifdef ARM_MATH_DSP
+
+// Sign extends bytes 0 and 2 into the two halfwords
+static inline uint32_t __SXTB16(uint32_t x) {
+    return ((uint32_t)(uint16_t)(int16_t)(int8_t)x) | ((uint32_t)(uint16_t)(int16_t)(int8_t)(x >> 16) << 16);
+}
+
+// Both signed halfword products added to an accumulator
+static inline int32_t __SMLAD(uint32_t x, uint32_t y, int32_t sum) {
+    int32_t lo = (int32_t)(int16_t)x * (int16_t)y;
+    int32_t hi = (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+    return (int32_t)((uint32_t)sum + (uint32_t)lo + (uint32_t)hi);
+}
+
+static inline int32_t __SMUAD(uint32_t x, uint32_t y) {
+    return __SMLAD(x, y, 0);
+}
+
+static inline int64_t __SMLALD(uint32_t x, uint32_t y, int64_t sum) {
+    return sum + (int32_t)(int16_t)x * (int16_t)y + (int32_t)(int16_t)(x >> 16) * (int16_t)(y >> 16);
+}
+
+static inline int32_t __QADD(int32_t x, int32_t y) {
+    int64_t r = (int64_t)x + y;
+    return r > INT32_MAX ? INT32_MAX : r < INT32_MIN ? INT32_MIN : (int32_t)r;
+}
+
+static inline int32_t __QSUB(int32_t x, int32_t y) {
+    int64_t r = (int64_t)x - y;
+    return r > INT32_MAX ? INT32_MAX : r < INT32_MIN ? INT32_MIN : (int32_t)r;
+}
+
+// Saturating signed subtraction of each byte
+static inline uint32_t __QSUB8(uint32_t x, uint32_t y) {
+    uint32_t r = 0;
+    for (int i = 0; i < 32; i += 8) {
+        int32_t d = (int32_t)(int8_t)(x >> i) - (int8_t)(y >> i);
+        d = d > 127 ? 127 : d < -128 ? -128 : d;
+        r |= (uint32_t)(uint8_t)d << i;
+    }
+    return r;
+}
+
+#define __PKHBT(ARG1, ARG2, ARG3) ((((int32_t)(ARG1) << 0) & (int32_t)0x0000FFFF) | \
+                                   (((int32_t)(ARG2) << ARG3) & (int32_t)0xFFFF0000))
+#define __PKHTB(ARG1, ARG2, ARG3) ((((int32_t)(ARG1) << 0) & (int32_t)0xFFFF0000) | \
+                                   (((int32_t)(ARG2) >> ARG3) & (int32_t)0x0000FFFF))
+
+#else
+
+#include "arm_math.h"
+
+// The SIMD builds of the kernels, for the tests to call next to the portable ones
+arm_status arm_fully_connected_q7_dsp(const q7_t *pV, const q7_t *pM, const uint16_t dim_vec,
+                                      const uint16_t num_of_rows, const uint16_t bias_shift, const uint16_t out_shift,
+                                      const q7_t *bias, q7_t *pOut, q15_t *vec_buffer);
+void arm_relu_q7_dsp(q7_t *data, uint16_t size);
+
+#endif /* ARM_MATH_DSP */
+
+#endif /* __NN_DSP_HOST_H__ */
@@ -0,0 +1,13 @@
+/**
+ * @file noise_adapt_test.h
+ * @brief Checks of the GNSS noise adaptation and the process noise phases
+ */
+#ifndef __NOISE_ADAPT_TEST_H__
+#define __NOISE_ADAPT_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int noise_adapt_test(FILE *out, uint64_t seed);
+
+#endif /* __NOISE_ADAPT_TEST_H__ */
@@ -0,0 +1,13 @@
+/**
+ * @file persist_test.h
+ * @brief Checks of the calibration and snapshot stores
+ */
+#ifndef __PERSIST_TEST_H__
+#define __PERSIST_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int persist_test(FILE *out, uint64_t seed);
+
+#endif /* __PERSIST_TEST_H__ */
@@ -0,0 +1,60 @@
+/**
+ * @file tests.h
+ * @brief Host tests of the estimator modules
+ *
+ * @details Each module has one test function that runs its checks on
+ *          fixed-seed synthetic inputs, prints a table of each error or wrong
+ *          outcome against its limit to out, and returns the number of
+ *          checks that failed. StateEstimation/Host builds them into the
+ *          tests executable with the host estimator library.
+ */
+#ifndef __TESTS_H__
+#define __TESTS_H__
+
+#include <stdint.h>
+
+#include "gnss_origin_test.h"
+#include "baro_altitude_test.h"
+#include "trig_test.h"
+#include "attitude_test.h"
+#include "magnetometer_test.h"
+#include "imu_pipeline_test.h"
+#include "vibration_monitor_test.h"
+#include "persist_test.h"
+#include "bias_calibration_test.h"
+#include "ublox_config_test.h"
+#include "time_sync_test.h"
+#include "flight_ekf_test.h"
+#include "ekf_health_test.h"
+#include "event_detector_test.h"
+#include "fault_detector_test.h"
+#include "flight_ekf_model_test.h"
+#include "noise_adapt_test.h"
+
+// Launch site of the tests that need one
+#define LAUNCH_LAT 32.9903
+#define LAUNCH_LON -106.9750
+#define LAUNCH_ALT 1401.0
+
+// Fixed-seed input generation, splitmix64
+typedef struct {
+    uint64_t state;
+} TestRng;
+
+static inline void test_rng_seed(TestRng *rng, uint64_t seed, uint64_t stream) {
+    rng->state = seed ^ (stream * 0xD1B54A32D192ED03ULL);
+}
+
+static inline uint64_t test_rng_u64(TestRng *rng) {
+    uint64_t z = (rng->state += 0x9E3779B97F4A7C15ULL);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+// Uniform in [lo, hi)
+static inline float test_rng_range(TestRng *rng, float lo, float hi) {
+    return lo + (hi - lo) * (float)((test_rng_u64(rng) >> 40) * (1.0 / 16777216.0));
+}
+
+#endif /* __TESTS_H__ */
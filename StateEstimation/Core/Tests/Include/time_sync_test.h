@@ -0,0 +1,13 @@
+/**
+ * @file time_sync_test.h
+ * @brief Checks of the time pulse mapping
+ */
+#ifndef __TIME_SYNC_TEST_H__
+#define __TIME_SYNC_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int time_sync_test(FILE *out, uint64_t seed);
+
+#endif /* __TIME_SYNC_TEST_H__ */
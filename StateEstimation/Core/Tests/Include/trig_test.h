@@ -0,0 +1,13 @@
+/**
+ * @file trig_test.h
+ * @brief Checks of the trig.h polynomials
+ */
+#ifndef __TRIG_TEST_H__
+#define __TRIG_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int trig_test(FILE *out, uint64_t seed);
+
+#endif /* __TRIG_TEST_H__ */
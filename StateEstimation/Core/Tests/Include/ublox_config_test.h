@@ -0,0 +1,13 @@
+/**
+ * @file ublox_config_test.h
+ * @brief Checks of the u-blox configuration engine
+ */
+#ifndef __UBLOX_CONFIG_TEST_H__
+#define __UBLOX_CONFIG_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int ublox_config_test(FILE *out, uint64_t seed);
+
+#endif /* __UBLOX_CONFIG_TEST_H__ */
@@ -0,0 +1,13 @@
+/**
+ * @file vibration_monitor_test.h
+ * @brief Checks of the vibration monitor
+ */
+#ifndef __VIBRATION_MONITOR_TEST_H__
+#define __VIBRATION_MONITOR_TEST_H__
+
+#include <stdint.h>
+#include <stdio.h>
+
+int vibration_monitor_test(FILE *out, uint64_t seed);
+
+#endif /* __VIBRATION_MONITOR_TEST_H__ */
@@ -0,0 +1,170 @@
+/**
+ * @file attitude_test.c
+ * @brief Checks of the attitude propagation
+ *
+ * @details The attitude propagation is run at the ADIS16500 full scale roll
+ *          rate with coning on the other axes and compared against the same
+ *          rotations composed exactly in double, next to the previous
+ *          propagation, a sine and cosine and a normalization every step.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "trig.h"
+#include "attitude.h"
+#include "tests.h"
+
+#define ATT_STEP 0.005              // s, estimator cycle
+#define ATT_STEPS 2000              // 10 s
+#define ATT_ROLL_RATE 2000.0        // deg/s, ADIS16500 full scale
+#define ATT_CONE_RATE 200.0         // deg/s, on the other two axes
+#define ATT_CONE_HZ 3.0
+#define ATT_DELTA_POINTS 100001     // half-angles up to twice ATTITUDE_SERIES_MAX_HALF_ANGLE
+#define ATT_DELTA_LIMIT 1.2e-7      // per component, float epsilon
+#define ATT_ANGLE_LIMIT 0.01        // deg after ATT_STEPS
+#define ATT_NORM_LIMIT 1e-5
+
+// Exact rotation of one step at a held rate, composed on the right of q
+static void att_exact_step(double q[4], const float32_t w[3], double dt) {
+    double h[3] = {0.5 * dt * w[0], 0.5 * dt * w[1], 0.5 * dt * w[2]};
+    double a = sqrt(h[0] * h[0] + h[1] * h[1] + h[2] * h[2]);
+    double d[4] = {cos(a), 0.0, 0.0, 0.0};
+    for (int i = 0; i < 3; i++) {
+        d[i + 1] = a > 0.0 ? h[i] * sin(a) / a : 0.0;
+    }
+    double r[4] = {
+        q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3],
+        q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2],
+        q[0] * d[2] + q[2] * d[0] + q[3] * d[1] - q[1] * d[3],
+        q[0] * d[3] + q[3] * d[0] + q[1] * d[2] - q[2] * d[1],
+    };
+    memcpy(q, r, sizeof(r));
+}
+
+// The propagation before the series: axis and angle, a sine and cosine and a normalization every step
+static void att_previous_step(float32_t q[4], const float32_t w[3], float32_t dt) {
+    float32_t norm = sqrtf(w[0] * w[0] + w[1] * w[1] + w[2] * w[2]);
+    float32_t omega[3];
+    for (int i = 0; i < 3; i++) {
+        omega[i] = norm == 0 ? w[i] + 0.01f : w[i];
+    }
+    norm = sqrtf(omega[0] * omega[0] + omega[1] * omega[1] + omega[2] * omega[2]);
+    float32_t half_sin, half_cos;
+    trig_sincos(0.5f * dt * norm, &half_sin, &half_cos);
+    float32_t d[4] = {half_cos, omega[0] / norm * half_sin, omega[1] / norm * half_sin, omega[2] / norm * half_sin};
+    float32_t r[4] = {
+        q[0] * d[0] - q[1] * d[1] - q[2] * d[2] - q[3] * d[3],
+        q[0] * d[1] + q[1] * d[0] + q[2] * d[3] - q[3] * d[2],
+        q[0] * d[2] + q[2] * d[0] + q[3] * d[1] - q[1] * d[3],
+        q[0] * d[3] + q[3] * d[0] + q[1] * d[2] - q[2] * d[1],
+    };
+    float32_t n = sqrt(r[0] * r[0] + r[1] * r[1] + r[2] * r[2] + r[3] * r[3]);
+    for (int i = 0; i < 4; i++) {
+        q[i] = r[i] / n;
+    }
+}
+
+// Angle between a float attitude and the exact one, deg
+static double att_angle_error(const float32_t q[4], const double exact[4]) {
+    double n = sqrt((double)q[0] * q[0] + (double)q[1] * q[1] + (double)q[2] * q[2] + (double)q[3] * q[3]);
+    // Vector part of exact^-1 q, twice the arcsine of its length
+    double v[3] = {
+        exact[0] * q[1] - exact[1] * q[0] - exact[2] * q[3] + exact[3] * q[2],
+        exact[0] * q[2] - exact[2] * q[0] - exact[3] * q[1] + exact[1] * q[3],
+        exact[0] * q[3] - exact[3] * q[0] - exact[1] * q[2] + exact[2] * q[1],
+    };
+    return 2.0 * asin(fmin(1.0, sqrt(v[0] * v[0] + v[1] * v[1] + v[2] * v[2]) / n)) * 180.0 / M_PI;
+}
+
+/**
+ * @brief Measures the error of the attitude propagation at high roll rates
+ * @param out Receives the errors against their limits
+ * @param seed Seed of the increment axes
+ * @return The number of checks that exceed their limit
+ * @details The increment of gyro_to_rotation_quat() is compared per component with the exact one for half-angles
+ *          through both the series and the trigonometric branch. A roll at ATT_ROLL_RATE with coning on the other axes
+ *          is then propagated with run_attitude_estimation() and with the previous propagation, and each is compared
+ *          with the same rates composed exactly in double. The norm is checked between renormalizations, and the euler
+ *          angles computed at the end against the exact attitude's.
+ */
+int attitude_test(FILE *out, uint64_t seed) {
+    RocketAttitude atd;
+    TestRng rng;
+    double delta_max = 0.0;
+
+    test_rng_seed(&rng, seed, 14);
+    initialize_rocket_attitude(&atd, 1, 0, 0, 0);
+    atd.time_step = 1.0f;
+    for (int i = 0; i < ATT_DELTA_POINTS; i++) {
+        float32_t axis[3] = {test_rng_range(&rng, -1.0f, 1.0f), test_rng_range(&rng, -1.0f, 1.0f),
+                             test_rng_range(&rng, -1.0f, 1.0f)};
+        float32_t len = sqrtf(axis[0] * axis[0] + axis[1] * axis[1] + axis[2] * axis[2]);
+        float32_t a = 2.0f * ATTITUDE_SERIES_MAX_HALF_ANGLE * i / (ATT_DELTA_POINTS - 1);
+        float32_t w[3];
+        for (int k = 0; k < 3; k++) {
+            w[k] = len > 0.0f ? 2.0f * a * axis[k] / len : 0.0f;
+        }
+        double exact[4] = {1.0, 0.0, 0.0, 0.0};
+        att_exact_step(exact, w, 1.0);
+        set_gyro(&atd, w);
+        gyro_to_rotation_quat(&atd);
+        float32_t d[4] = {atd.q_delt_s, atd.q_delt_x, atd.q_delt_y, atd.q_delt_z};
+        for (int k = 0; k < 4; k++) {
+            delta_max = fmax(delta_max, fabs(d[k] - exact[k]));
+        }
+    }
+
+    double exact[4] = {1.0, 0.0, 0.0, 0.0};
+    float32_t previous[4] = {1.0f, 0.0f, 0.0f, 0.0f};
+    double norm_max = 0.0;
+    initialize_rocket_attitude(&atd, 1, 0, 0, 0);
+    atd.time_step = (float32_t)ATT_STEP;
+    for (int n = 0; n < ATT_STEPS; n++) {
+        double t = n * ATT_STEP;
+        double cone = ATT_CONE_RATE * M_PI / 180.0;
+        float32_t w[3] = {
+            (float32_t)(ATT_ROLL_RATE * M_PI / 180.0),
+            (float32_t)(cone * sin(2.0 * M_PI * ATT_CONE_HZ * t)),
+            (float32_t)(cone * cos(2.0 * M_PI * ATT_CONE_HZ * t)),
+        };
+        run_attitude_estimation(&atd, w);
+        att_previous_step(previous, w, (float32_t)ATT_STEP);
+        att_exact_step(exact, w, ATT_STEP);
+        double norm = sqrt((double)atd.q_current_s * atd.q_current_s + (double)atd.q_current_x * atd.q_current_x +
+                           (double)atd.q_current_y * atd.q_current_y + (double)atd.q_current_z * atd.q_current_z);
+        norm_max = fmax(norm_max, fabs(norm - 1.0));
+    }
+    float32_t q[4] = {atd.q_current_s, atd.q_current_x, atd.q_current_y, atd.q_current_z};
+    double roll_err = att_angle_error(q, exact);
+    double previous_err = att_angle_error(previous, exact);
+
+    // Euler angles of the exact attitude, as quat_to_euler_angs() takes them from the transposed direction cosines
+    double s = exact[0], x = exact[1], y = exact[2], z = exact[3];
+    double c11 = s * s + x * x - y * y - z * z, c12 = 2.0 * (x * y + s * z), c13 = 2.0 * (x * z - s * y);
+    double c23 = 2.0 * (y * z + s * x), c33 = s * s - x * x - y * y + z * z;
+    double euler[3] = {atan2(c23, c33), -asin(c13), atan2(c12, c11)};
+    quat_to_euler_angs(&atd);
+    double got[3] = {atd.phi, atd.theta, atd.psi};
+    double euler_err = 0.0;
+    for (int k = 0; k < 3; k++) {
+        euler_err = fmax(euler_err, fabs(remainder(got[k] - euler[k], 2.0 * M_PI)) * 180.0 / M_PI);
+    }
+
+    int delta_ok = delta_max <= ATT_DELTA_LIMIT;
+    int roll_ok = roll_err <= ATT_ANGLE_LIMIT;
+    int previous_ok = previous_err <= ATT_ANGLE_LIMIT;
+    int norm_ok = norm_max <= ATT_NORM_LIMIT;
+    int euler_ok = euler_err <= ATT_ANGLE_LIMIT;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "attitude", "max_err", "limit", "status");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "att_delta", delta_max, ATT_DELTA_LIMIT, delta_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "att_deg", roll_err, ATT_ANGLE_LIMIT, roll_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "att_prev", previous_err, ATT_ANGLE_LIMIT,
+            previous_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "att_norm", norm_max, ATT_NORM_LIMIT, norm_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "euler_deg", euler_err, ATT_ANGLE_LIMIT, euler_ok ? "ok" : "FAILED");
+    return !delta_ok + !roll_ok + !previous_ok + !norm_ok + !euler_ok;
+}
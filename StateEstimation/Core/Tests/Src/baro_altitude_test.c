@@ -0,0 +1,57 @@
+/**
+ * @file baro_altitude_test.c
+ * @brief Checks of the baro altitude table
+ *
+ * @details baro_altitude() is swept over its whole table and compared against
+ *          the ISA formula and its derivative evaluated in double.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "baro_altitude.h"
+#include "tests.h"
+
+#define BARO_SWEEP_STEP 0.25        // Pa
+
+#define ISA_SCALE 44330.0
+#define ISA_EXPONENT 0.1903
+#define ISA_P0 101325.0
+#define BARO_SLOPE_LIMIT 1e-3       // relative, the slope only scales the noise model
+
+/**
+ * @brief Measures the worst-case error of the baro altitude table
+ * @param out Receives the altitude and slope errors against their limits
+ * @return The number of checks that exceed their limit
+ */
+int baro_altitude_test(FILE *out, uint64_t seed) {
+    (void)seed;
+    double alt_max = 0.0;
+    double slope_max = 0.0;
+    double alt_at = 0.0;
+
+    for (double p = BARO_ALT_MIN_PA; p <= BARO_ALT_MAX_PA; p += BARO_SWEEP_STEP) {
+        float32_t slope;
+        double alt = baro_altitude((float32_t)p, &slope);
+        double ratio = pow(p / ISA_P0, ISA_EXPONENT);
+        double exact = ISA_SCALE * (1.0 - ratio);
+        double exact_slope = -ISA_SCALE * ISA_EXPONENT * ratio / p;
+
+        if (fabs(alt - exact) > alt_max) {
+            alt_max = fabs(alt - exact);
+            alt_at = p;
+        }
+        slope_max = fmax(slope_max, fabs(slope / exact_slope - 1.0));
+    }
+
+    int alt_ok = alt_max <= BARO_ALT_MAX_ERROR;
+    int slope_ok = slope_max <= BARO_SLOPE_LIMIT;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "baro", "max_err", "limit", "status");
+    fprintf(out, "%-10s %14.3g %14.3g  %s (worst at %.0f Pa)\n", "altitude_m", alt_max, (double)BARO_ALT_MAX_ERROR,
+            alt_ok ? "ok" : "FAILED", alt_at);
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "slope_rel", slope_max, BARO_SLOPE_LIMIT, slope_ok ? "ok" : "FAILED");
+    return !alt_ok + !slope_ok;
+}
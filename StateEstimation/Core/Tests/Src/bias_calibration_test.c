@@ -0,0 +1,125 @@
+/**
+ * @file bias_calibration_test.c
+ * @brief Checks of the pad bias calibration
+ *
+ * @details An upright vehicle with known sensor biases is calibrated on the
+ *          pad, and the flight EKF must then see no specific force and no
+ *          rotation from the same readings. The stored biases must agree
+ *          with a later boot on the same pad and not with a shifted one.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "attitude.h"
+#include "bias_calibration.h"
+#include "tests.h"
+
+#define CAL_MAX_SAMPLES 20000       // 100 s at the estimator rate
+#define CAL_ACCEL_BIAS 0.3f         // m/s^2, uniform
+#define CAL_GYRO_BIAS 0.01f         // rad/s, uniform
+#define CAL_ACCEL_NOISE 0.02f       // m/s^2, uniform
+#define CAL_GYRO_NOISE 0.002f       // rad/s, uniform
+#define CAL_SHIFT 0.2f              // m/s^2 on x, a different pad or tilt
+#define CAL_ACCEL_LIMIT 0.02        // m/s^2, twice BIAS_CAL_ACCEL_BOUND
+#define CAL_GYRO_LIMIT 0.001        // rad/s, twice BIAS_CAL_GYRO_BOUND
+
+// Readings of the upright vehicle at rest, x up
+static void pad_reading(Sensors *s, const float32_t *bias, float32_t shift, TestRng *rng) {
+    s->accel_x = ATTITUDE_GRAVITY + shift + bias[0] + test_rng_range(rng, -CAL_ACCEL_NOISE, CAL_ACCEL_NOISE);
+    s->accel_y = bias[1] + test_rng_range(rng, -CAL_ACCEL_NOISE, CAL_ACCEL_NOISE);
+    s->accel_z = bias[2] + test_rng_range(rng, -CAL_ACCEL_NOISE, CAL_ACCEL_NOISE);
+    s->gyro_x = bias[3] + test_rng_range(rng, -CAL_GYRO_NOISE, CAL_GYRO_NOISE);
+    s->gyro_y = bias[4] + test_rng_range(rng, -CAL_GYRO_NOISE, CAL_GYRO_NOISE);
+    s->gyro_z = bias[5] + test_rng_range(rng, -CAL_GYRO_NOISE, CAL_GYRO_NOISE);
+}
+
+// One block into a fresh calibrator, as a boot with stored biases takes
+static uint8_t pad_agrees(const float32_t *bias, float32_t shift, const float32_t *stored, const float32_t *var,
+                          TestRng *rng) {
+    static BiasCalibrator cal;
+    static Sensors s;
+
+    memset(&s, 0, sizeof(s));
+    bias_calibrator_init(&cal);
+    for (int k = 0; k < BIAS_CAL_BLOCK; k++) {
+        pad_reading(&s, bias, shift, rng);
+        bias_calibrator_update(&cal, &s);
+    }
+    return bias_calibrator_agrees(&cal, stored, var);
+}
+
+/**
+ * @brief Checks the pad bias calibration against the flight EKF's inputs
+ * @param out Receives the residual specific force and rate and the wrong
+ *            outcomes against their limits
+ * @param seed Seed of the biases and the noise
+ * @return The number of checks that fail
+ * @details The residuals are those update_ekf() forms from the mean reading
+ *          of the pad, with the attitude the flight EKF starts from.
+ */
+int bias_calibration_test(FILE *out, uint64_t seed) {
+    static BiasCalibrator cal;
+    static ExtKalmanFilter ekf;
+    static RocketAttitude atd;
+    static Sensors s;
+    float32_t bias[BIAS_CAL_CHANNELS];
+    float32_t stored[BIAS_CAL_CHANNELS];
+    TestRng rng;
+    int samples = 0;
+
+    test_rng_seed(&rng, seed, 117);
+    for (int i = 0; i < BIAS_CAL_CHANNELS; i++) {
+        float32_t b = i < 3 ? CAL_ACCEL_BIAS : CAL_GYRO_BIAS;
+        bias[i] = test_rng_range(&rng, -b, b);
+    }
+
+    memset(&s, 0, sizeof(s));
+    bias_calibrator_init(&cal);
+    while (samples < CAL_MAX_SAMPLES) {
+        pad_reading(&s, bias, 0.0f, &rng);
+        samples++;
+        if (bias_calibrator_update(&cal, &s)) {
+            break;
+        }
+    }
+    int converged = cal.converged;
+    bias_calibrator_apply(&cal, &s);
+    bias_calibrator_biases(&cal, stored);
+
+    // The noise-free pad reading through update_ekf()
+    initialize_ekf(&ekf, &huart3, &s, 3);
+    initialize_rocket_attitude(&atd, 1.0f, 0.0f, 0.0f, 0.0f);
+    s.accel_x = ATTITUDE_GRAVITY + bias[0];
+    s.accel_y = bias[1];
+    s.accel_z = bias[2];
+    s.gyro_x = bias[3];
+    s.gyro_y = bias[4];
+    s.gyro_z = bias[5];
+    update_ekf(&ekf, &atd, &s);
+
+    double accel_err = 0.0;
+    double gyro_err = 0.0;
+    for (int i = 0; i < 3; i++) {
+        accel_err = fmax(accel_err, fabs(ekf.accelerometer[i]));
+        gyro_err = fmax(gyro_err, fabs(ekf.gyro[i]));
+    }
+    accel_err = isnan(ekf.accelerometer[0]) ? INFINITY : accel_err;
+
+    int same = pad_agrees(bias, 0.0f, stored, cal.mean_var, &rng);
+    int shifted = pad_agrees(bias, CAL_SHIFT, stored, cal.mean_var, &rng);
+
+    int conv_ok = converged;
+    int accel_ok = accel_err <= CAL_ACCEL_LIMIT;
+    int gyro_ok = gyro_err <= CAL_GYRO_LIMIT;
+    int agree_ok = same && !shifted;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "bias cal", "value", "limit", "status");
+    fprintf(out, "%-10s %14d %14d  %s\n", "cal_n", samples, CAL_MAX_SAMPLES, conv_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "cal_accel", accel_err, CAL_ACCEL_LIMIT, accel_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "cal_gyro", gyro_err, CAL_GYRO_LIMIT, gyro_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "cal_agree", !same + shifted, 0, agree_ok ? "ok" : "FAILED");
+    return !conv_ok + !accel_ok + !gyro_ok + !agree_ok;
+}
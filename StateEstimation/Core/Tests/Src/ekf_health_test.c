@@ -0,0 +1,119 @@
+/**
+ * @file ekf_health_test.c
+ * @brief Checks of the innovation gate and the forced accept
+ *
+ * @details The gate is fed NIS values either side of it, and the flight EKF
+ *          fixes far from its state, one as an outlier and then as a lasting
+ *          jump. The outlier must be skipped and the jump taken after
+ *          EKF_MAX_CONSECUTIVE_REJECTS rejections.
+ */
+
+#include <math.h>
+#include <string.h>
+
+#include "main.h"
+#include "ekf_health.h"
+#include "tests.h"
+
+#define EH_SAMPLES 1000             // random NIS values through the gate
+#define EH_JUMP 300.0f              // m, fixes off the state on every axis
+#define EH_JUMP_ROUNDS 3            // forced accepts in a row of the jump
+#define EH_OUTLIER_LIMIT 1e-6       // m, state moved by a skipped fix
+
+// Fuses a GNSS position fix as run_ekf would
+static void eh_fuse(ExtKalmanFilter *ekf, float32_t offset) {
+    for (int i = 0; i < 3; i++) {
+        ekf->gps[i] = offset;
+    }
+    make_measurement(ekf, &huart3);
+    update_step(ekf, &huart3);
+}
+
+/**
+ * @brief Checks the flight EKF's innovation gate
+ * @param out Receives the wrong outcomes against their limits
+ * @param seed Seed of the NIS values
+ * @return The number of checks that fail
+ * @details Random NIS values must be accepted up to the 3 DOF gate and
+ *          counted, a NaN rejected and kept out of the average. 50 rejections
+ *          in a row must force the next finite update through and flag it,
+ *          but not a NaN one. In the flight EKF a single fix 300 m off must
+ *          leave the state alone, and a lasting 300 m jump must be taken on
+ *          every 51st fix only, each time moving the state towards it.
+ */
+int ekf_health_test(FILE *out, uint64_t seed) {
+    static ExtKalmanFilter ekf;
+    static RocketAttitude atd;
+    static Sensors s;
+    EkfHealth health;
+    int gate_errors = 0;
+    int forced_errors = 0;
+    int jump_errors = 0;
+    int failures = 0;
+    TestRng rng;
+
+    // Accepted up to the gate, rejections and acceptances counted
+    float32_t gate = ekf_chi2_gate(3);
+    uint16_t accepted = 0;
+    ekf_health_init(&health);
+    test_rng_seed(&rng, seed, 127);
+    for (int i = 0; i < EH_SAMPLES; i++) {
+        // Runs of rejections stay short of the forced accept
+        float32_t nis = i % 10 == 9 ? 0.0f : test_rng_range(&rng, 0.0f, 2.0f * gate);
+        uint8_t accept = ekf_health_gate(&health, nis, gate);
+        gate_errors += accept != (nis <= gate) || health.nis != nis;
+        accepted += accept;
+    }
+    gate_errors += health.accepted != accepted || health.rejected != EH_SAMPLES - accepted || health.flags != 0;
+    gate_errors += ekf_health_gate(&health, NAN, gate) || !isfinite(health.nis_avg);
+
+    // The 51st rejection in a row goes through, a NaN never does
+    ekf_health_init(&health);
+    for (int i = 0; i < EKF_MAX_CONSECUTIVE_REJECTS; i++) {
+        forced_errors += ekf_health_gate(&health, 2.0f * gate, gate);
+    }
+    forced_errors += health.flags != 0 || health.consecutive_rejects != EKF_MAX_CONSECUTIVE_REJECTS;
+    forced_errors += ekf_health_gate(&health, NAN, gate);
+    forced_errors += !ekf_health_gate(&health, 2.0f * gate, gate);
+    forced_errors += !(health.flags & EKF_HEALTH_GATE_FORCED) || health.consecutive_rejects != 0;
+    forced_errors += health.accepted != 1 || health.rejected != EKF_MAX_CONSECUTIVE_REJECTS + 1;
+
+    // A flight EKF at the pad, R fixed so the forced updates are the only change
+    flight_ekf_test_setup(&ekf, &atd, &s, 1.0f);
+    ekf.noise.enabled = 0;
+    for (int i = 0; i < 20; i++) {
+        eh_fuse(&ekf, 0.0f);
+    }
+    ekf_health_init(&ekf.health);
+    float32_t before[MAX_FLIGHT_DIM];
+    memcpy(before, ekf.x_n.pData, sizeof(float32_t) * ekf.nx);
+    eh_fuse(&ekf, EH_JUMP);
+    double outlier = 0.0;
+    for (int i = 0; i < ekf.nx; i++) {
+        outlier = fmax(outlier, fabs(ekf.x_n.pData[i] - before[i]));
+    }
+    eh_fuse(&ekf, 0.0f);
+    jump_errors += ekf.health.rejected != 1 || ekf.health.accepted != 1 || ekf.health.flags != 0;
+
+    float32_t last = ekf.x_n.pData[0];
+    for (int round = 0; round < EH_JUMP_ROUNDS; round++) {
+        for (int i = 0; i < EKF_MAX_CONSECUTIVE_REJECTS; i++) {
+            eh_fuse(&ekf, EH_JUMP);
+        }
+        jump_errors += ekf.x_n.pData[0] != last || (round == 0 && (ekf.health.flags & EKF_HEALTH_GATE_FORCED));
+        eh_fuse(&ekf, EH_JUMP);
+        jump_errors += !(ekf.health.flags & EKF_HEALTH_GATE_FORCED) || !(ekf.x_n.pData[0] > last);
+        last = ekf.x_n.pData[0];
+    }
+    jump_errors += ekf.health.accepted != 1 + EH_JUMP_ROUNDS ||
+                   ekf.health.rejected != 1 + EH_JUMP_ROUNDS * EKF_MAX_CONSECUTIVE_REJECTS;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "ekf health", "errors", "limit", "status");
+    fprintf(out, "%-10s %14d %14d  %s\n", "eh_gate", gate_errors, 0, gate_errors == 0 ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "eh_forced", forced_errors, 0, forced_errors == 0 ? "ok" : "FAILED");
+    int outlier_ok = outlier <= EH_OUTLIER_LIMIT;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "eh_outlier", outlier, EH_OUTLIER_LIMIT, outlier_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "eh_jump", jump_errors, 0, jump_errors == 0 ? "ok" : "FAILED");
+    failures += (gate_errors != 0) + (forced_errors != 0) + !outlier_ok + (jump_errors != 0);
+    return failures;
+}
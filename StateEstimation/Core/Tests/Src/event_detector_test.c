@@ -0,0 +1,197 @@
+/**
+ * @file event_detector_test.c
+ * @brief Checks of the flight event detector
+ *
+ * @details The detector is fed the raw axial channel and the baro altitude of a
+ *          boost and coast and must place launch, burnout and apogee close to
+ *          the truth, and raise nothing while the vehicle is knocked about on
+ *          the pad. The event frame must pass the MainMCU CRC.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "imu_pipeline.h"
+#include "event_detector.h"
+#include "crc_hash.h"
+#include "tests.h"
+
+#define EVT_DT 0.0005               // s, ADIS16500 sample period
+#define EVT_LAUNCH_S 2.0
+#define EVT_RISE_S 0.03             // thrust ramp up
+#define EVT_BURN_S 3.0              // to the end of the tail-off
+#define EVT_TAIL_S 0.05
+#define EVT_THRUST 80.0             // m/s^2
+#define EVT_DRAG 0.0005             // 1/m, drag acceleration over v^2
+#define EVT_NOISE 2.0f              // m/s^2, uniform
+#define EVT_VIB 5.0                 // m/s^2, 137 Hz motor vibration while it burns
+#define EVT_BARO_NOISE 0.5f         // m, uniform
+#define EVT_END_S 40.0
+#define EVT_PAD_S 30.0              // of handling on the pad
+#define EVT_LAUNCH_LIMIT 0.01       // s, event time against the motor lighting
+#define EVT_LAUNCH_LATENCY 0.05     // s, detection after it, the ramp to 2 g and the debounce
+#define EVT_BURNOUT_LIMIT 0.05      // s, event time against the end of thrust
+#define EVT_BURNOUT_LATENCY 0.1
+#define EVT_APOGEE_LIMIT 0.5        // s, predicted time against the true apogee
+
+typedef struct {
+    double time[EVENT_APOGEE + 1];      // s, event time, NAN if not raised
+    double detect[EVENT_APOGEE + 1];    // s, when it was detected
+    int count;
+} EvtResult;
+
+// Thrust acceleration of the synthetic motor
+static double evt_thrust(double t) {
+    double burn = t - EVT_LAUNCH_S;
+    if (burn < 0.0 || burn >= EVT_BURN_S) {
+        return 0.0;
+    }
+    if (burn < EVT_RISE_S) {
+        return EVT_THRUST * burn / EVT_RISE_S;
+    }
+    if (burn > EVT_BURN_S - EVT_TAIL_S) {
+        return EVT_THRUST * (EVT_BURN_S - burn) / EVT_TAIL_S;
+    }
+    return EVT_THRUST;
+}
+
+// Blocks of raw samples and a baro reading per block, the way update_sensors() feeds the detector
+static void evt_run(EventDetector *det, TestRng *rng, int fly, double *apogee_s, EvtResult *result) {
+    int16_t block[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION] = {{0}};
+    double alt = 0.0, vel = 0.0;
+    double end = fly ? EVT_END_S : EVT_PAD_S;
+    uint64_t n = 0;
+
+    event_detector_init(det, IMU_PIPELINE_SAMPLE_RATE);
+    event_detector_arm(det, 1);
+    memset(result, 0, sizeof(*result));
+    for (int i = 0; i <= EVENT_APOGEE; i++) {
+        result->time[i] = NAN;
+        result->detect[i] = NAN;
+    }
+    *apogee_s = NAN;
+
+    for (double t = 0.0; t < end; n++) {
+        for (int i = 0; i < IMU_PIPELINE_DECIMATION; i++, t += EVT_DT) {
+            double force = EVENT_GRAVITY;
+            if (fly) {
+                double thrust = evt_thrust(t);
+                double accel = thrust - EVENT_GRAVITY - EVT_DRAG * vel * fabs(vel);
+                if (t >= EVT_LAUNCH_S) {
+                    vel += accel * EVT_DT;
+                    alt += vel * EVT_DT;
+                    force = accel + EVENT_GRAVITY;
+                }
+                if (thrust > 0.0) {
+                    force += EVT_VIB * sin(2.0 * M_PI * 137.0 * t);
+                }
+                if (isnan(*apogee_s) && t > EVT_LAUNCH_S + EVT_BURN_S && vel <= 0.0) {
+                    *apogee_s = t;
+                }
+            } else if (fmod(t, 3.0) < 0.004) {
+                // Knocks while handling the vehicle, 4 ms at 3 g
+                force += 3.0 * EVENT_GRAVITY;
+            }
+            force += test_rng_range(rng, -EVT_NOISE, EVT_NOISE);
+            // The long axis reads -1 g at rest, the detector finds the sign on the pad
+            block[EVENT_AXIS_CHANNEL][i] = (int16_t)lround(-force / IMU_PIPELINE_ACCEL_LSB);
+        }
+        uint32_t time_us = (uint32_t)lround((t - EVT_DT) * 1e6);
+        event_detector_push(det, block, IMU_PIPELINE_DECIMATION, time_us);
+        event_detector_baro(det, (float32_t)(LAUNCH_ALT + alt) + test_rng_range(rng, -EVT_BARO_NOISE, EVT_BARO_NOISE),
+                            time_us);
+
+        FlightEvent event;
+        while (event_detector_pop(det, &event)) {
+            result->count++;
+            result->time[event.id] = event.time_us * 1e-6;
+            result->detect[event.id] = event.detect_us * 1e-6;
+        }
+    }
+}
+
+// Sends one event over the host UART and checks the frame and the line, returns the number of faults
+static int evt_frame(void) {
+    FlightEvent event = {.id = EVENT_APOGEE, .time_us = 1234567u, .detect_us = 1000000u, .value = 812.5f};
+    uint8_t frame[2 * EVENT_FRAME_BYTES];
+    int faults = 0;
+
+    FILE *tx = tmpfile();
+    if (tx == NULL) {
+        return 1;
+    }
+    huart2.tx_file = tx;
+    host_hal_set_tick(1000);
+    signal_event(&event);
+    faults += !(EVENT_LINE_PORT->ODR & EVENT_LINE_PIN);
+    event_link_poll(&huart2);
+    host_hal_set_tick(1000 + EVENT_LINE_MS);
+    event_link_poll(&huart2);
+    faults += (EVENT_LINE_PORT->ODR & EVENT_LINE_PIN) != 0;
+    huart2.tx_file = NULL;
+
+    rewind(tx);
+    size_t len = fread(frame, 1, sizeof(frame), tx);
+    fclose(tx);
+    if (len != EVENT_FRAME_BYTES) {
+        return faults + 1;
+    }
+    uint32_t time_us;
+    int32_t age_us;
+    float32_t value;
+    memcpy(&time_us, &frame[3], 4);
+    memcpy(&age_us, &frame[7], 4);
+    memcpy(&value, &frame[11], 4);
+    faults += frame[0] != EVENT_FRAME_SYNC || frame[1] != EVENT_APOGEE;
+    faults += !verify_crc8_hash(frame, EVENT_FRAME_BYTES);
+    faults += time_us != event.time_us || age_us != 1000000 - 1234567 || value != event.value;
+    return faults;
+}
+
+/**
+ * @brief Checks the flight event detector and the event frame
+ * @param out Receives the event time errors and wrong outcomes against their limits
+ * @param seed Seed of the sensor noise
+ * @return The number of checks that fail
+ * @details A vertical flight with a ramped motor, drag and motor vibration is
+ *          fed at the ADIS16500 rate with a noisy baro altitude. Launch and
+ *          burnout must be placed within a few ms of the motor lighting and
+ *          the end of thrust, and detected soon after, and apogee predicted
+ *          to within EVT_APOGEE_LIMIT. An armed vehicle knocked about on the
+ *          pad must raise nothing. The frame for an event must carry it with
+ *          a CRC the MainMCU accepts, and the line must pulse.
+ */
+int event_detector_test(FILE *out, uint64_t seed) {
+    static EventDetector det;
+    TestRng rng;
+    EvtResult flight, pad;
+    double apogee_s, unused;
+    int failures = 0;
+
+    test_rng_seed(&rng, seed, 11);
+    evt_run(&det, &rng, 1, &apogee_s, &flight);
+    evt_run(&det, &rng, 0, &unused, &pad);
+    int frame_faults = evt_frame();
+
+    double launch_err = fabs(flight.time[EVENT_LAUNCH] - EVT_LAUNCH_S);
+    double launch_late = flight.detect[EVENT_LAUNCH] - EVT_LAUNCH_S;
+    double burnout_err = fabs(flight.time[EVENT_BURNOUT] - (EVT_LAUNCH_S + EVT_BURN_S));
+    double burnout_late = flight.detect[EVENT_BURNOUT] - (EVT_LAUNCH_S + EVT_BURN_S);
+    double apogee_err = fabs(flight.time[EVENT_APOGEE] - apogee_s);
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "events", "max_err", "limit", "status");
+    int launch_ok = launch_err <= EVT_LAUNCH_LIMIT && launch_late <= EVT_LAUNCH_LATENCY;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "evt_launch", launch_err, EVT_LAUNCH_LIMIT, launch_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "evt_l_late", launch_late, EVT_LAUNCH_LATENCY, launch_ok ? "ok" : "FAILED");
+    int burnout_ok = burnout_err <= EVT_BURNOUT_LIMIT && burnout_late <= EVT_BURNOUT_LATENCY;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "evt_burn", burnout_err, EVT_BURNOUT_LIMIT, burnout_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "evt_b_late", burnout_late, EVT_BURNOUT_LATENCY, burnout_ok ? "ok" : "FAILED");
+    int apogee_ok = apogee_err <= EVT_APOGEE_LIMIT && flight.count == 3;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "evt_apogee", apogee_err, EVT_APOGEE_LIMIT, apogee_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "evt_false", pad.count, 0, pad.count == 0 ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "evt_frame", frame_faults, 0, frame_faults == 0 ? "ok" : "FAILED");
+    failures += !launch_ok + !burnout_ok + !apogee_ok + (pad.count != 0) + (frame_faults != 0);
+    return failures;
+}
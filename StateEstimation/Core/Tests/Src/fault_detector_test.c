@@ -0,0 +1,240 @@
+/**
+ * @file fault_detector_test.c
+ * @brief Checks of the sensor fault model and detector
+ *
+ * @details The model must give the same logits through the portable and the
+ *          SIMD CMSIS-NN kernels and the integer reference, and classify held
+ *          out synthetic windows. Streamed through the detector, a stuck
+ *          gyro, a saturated accelerometer, a spiking baro and a frozen GNSS
+ *          height must be reported in time and nothing else flagged, and a
+ *          pass on a fake cycle counter must keep its budget.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "imu_pipeline.h"
+#include "fault_data.h"
+#include "fault_model.h"
+#include "nn_dsp_host.h"
+#include "tests.h"
+
+#define FLT_WINDOWS 20000           // synthetic windows, all sensors and classes
+#define FLT_RANDOM 20000            // inputs of uniform q7, the saturating corners
+#define FLT_OK_LIMIT 0.99           // right per window, the reported state is debounced
+#define FLT_FAULT_LIMIT 0.99
+#define FLT_CYCLE_S 0.005           // estimator cycle, IMU_PIPELINE_DECIMATION samples
+#define FLT_PASSES 4                // spare main loop passes per cycle
+#define FLT_GNSS_CYCLES 20          // cycles per GNSS solution, 10 Hz
+#define FLT_PAD_S 10.0
+#define FLT_END_S 20.0
+#define FLT_FAULT_S 5.0             // faults start on the pad
+#define FLT_GYRO_NOISE 1.5          // counts, 1 sigma, about 0.15 deg/s
+#define FLT_ACCEL_NOISE 3.0         // counts
+#define FLT_BARO_NOISE 1.5          // Pa
+#define FLT_GNSS_NOISE 0.02         // m, per solution
+#define FLT_GRAVITY 800.0           // counts on the long axis
+#define FLT_CLIMB 120.0             // m/s once off the pad
+#define FLT_BARO_SLOPE 11.0         // Pa/m near the launch site
+#define FLT_SPIKE_PERIOD 0.1        // s between baro spikes
+#define FLT_SPIKE 400.0             // Pa
+#define FLT_IMU_LATENCY 0.05        // s, a full window and FAULT_CONFIRM hops
+#define FLT_SPIKE_LATENCY 1.0       // FAULT_SPIKE_FLAG windows with a spike
+#define FLT_GNSS_LATENCY 5.0        // FAULT_CONFIRM hops at 10 Hz
+#define FLT_READ_CYCLES 4000        // fake cycle counter, advanced on every read
+
+static const FaultQuantModel flt_model = {
+    FAULT_MODEL_W1, FAULT_MODEL_B1, FAULT_MODEL_W2, FAULT_MODEL_B2,
+    FAULT_MODEL_B1_SHIFT, FAULT_MODEL_OUT1_SHIFT, FAULT_MODEL_B2_SHIFT, FAULT_MODEL_OUT2_SHIFT,
+};
+
+// The model through the SIMD build of the kernels, the path the target runs
+static void flt_forward_dsp(const q7_t *input, q7_t *logits) {
+    q7_t hidden[FAULT_HIDDEN];
+    q15_t buffer[FAULT_BUFFER];
+
+    arm_fully_connected_q7_dsp(input, flt_model.w1, FAULT_INPUTS, FAULT_HIDDEN, flt_model.b1_shift,
+                               flt_model.out1_shift, flt_model.b1, hidden, buffer);
+    arm_relu_q7_dsp(hidden, FAULT_HIDDEN);
+    arm_fully_connected_q7_dsp(hidden, flt_model.w2, FAULT_HIDDEN, FAULT_CLASSES, flt_model.b2_shift,
+                               flt_model.out2_shift, flt_model.b2, logits, buffer);
+}
+
+// Whether the portable kernels, the SIMD ones and the integer reference agree on one input
+static int flt_exact(FaultDetector *det, const q7_t *input) {
+    q7_t ref[FAULT_CLASSES], dsp[FAULT_CLASSES];
+
+    fault_detector_classify(det, input);
+    fault_quant_forward(&flt_model, input, ref);
+    flt_forward_dsp(input, dsp);
+    return memcmp(det->logits, ref, sizeof(ref)) == 0 && memcmp(dsp, ref, sizeof(ref)) == 0;
+}
+
+static uint32_t flt_clock;
+
+static uint32_t flt_cycles(void) {
+    flt_clock += FLT_READ_CYCLES;
+    return flt_clock;
+}
+
+typedef struct {
+    double detect[FAULT_CHANNELS];      // s, when the channel first reported its fault, NAN if never
+    uint8_t expect[FAULT_CHANNELS];     // FaultClass injected
+    int false_flags;                    // channels that reported anything else
+    uint32_t pass_max;                  // cycles, longest budgeted pass
+} FltResult;
+
+/**
+ * @brief Streams a pad wait and a climb through the detector as update_sensors() feeds it
+ * @param faults Inject a stuck gyro, a saturated accelerometer, a spiking baro
+ *        and a frozen GNSS height from FLT_FAULT_S, otherwise all stay healthy
+ * @param budget Run the spare passes on the fake cycle counter
+ */
+static void flt_run(FaultDetector *det, TestRng *rng, int faults, int budget, FltResult *result) {
+    int16_t block[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION];
+    double held[IMU_PIPELINE_CHANNELS] = {0}, gnss_held = 0.0, next_spike = FLT_FAULT_S;
+    uint8_t flagged[FAULT_CHANNELS] = {0};
+    double t = 0.0;
+
+    fault_detector_init(det, budget ? flt_cycles : NULL);
+    memset(result, 0, sizeof(*result));
+    for (int c = 0; c < FAULT_CHANNELS; c++) {
+        result->detect[c] = NAN;
+    }
+    if (faults) {
+        result->expect[FAULT_GYRO_X] = FAULT_STUCK;
+        result->expect[FAULT_ACCEL_Z] = FAULT_SATURATED;
+        result->expect[FAULT_BARO] = FAULT_SPIKE;
+        result->expect[FAULT_GNSS] = FAULT_STUCK;
+    }
+
+    for (uint32_t cycle = 0; t < FLT_END_S; cycle++) {
+        double dt = FLT_CYCLE_S / IMU_PIPELINE_DECIMATION;
+        int broken = faults && t >= FLT_FAULT_S;
+        for (int i = 0; i < IMU_PIPELINE_DECIMATION; i++, t += dt) {
+            double flight = t > FLT_PAD_S;
+            for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+                double noise = c < 3 ? FLT_GYRO_NOISE : FLT_ACCEL_NOISE;
+                double x = noise * (test_rng_range(rng, -1.0f, 1.0f) + test_rng_range(rng, -1.0f, 1.0f) +
+                                    test_rng_range(rng, -1.0f, 1.0f));
+                x += c == 5 ? -FLT_GRAVITY : 0.0;
+                // Roll and motor vibration once off the pad
+                x += flight * (c < 3 ? 200.0 * sin(0.7 * t + c) + 250.0 * sin(2.0 * M_PI * 311.0 * t)
+                                     : -5000.0 * (c == 5) + 350.0 * sin(2.0 * M_PI * 137.0 * t + c));
+                held[c] = broken && c == 0 ? held[c] : x;
+                block[c][i] = (int16_t)lround(held[c]);
+            }
+            if (broken) {
+                block[5][i] = INT16_MAX;
+            }
+        }
+        fault_detector_push_imu(det, block, IMU_PIPELINE_DECIMATION);
+
+        double height = t > FLT_PAD_S ? FLT_CLIMB * (t - FLT_PAD_S) : 0.0;
+        double pressure = 86000.0 - FLT_BARO_SLOPE * height + FLT_BARO_NOISE * test_rng_range(rng, -1.7f, 1.7f);
+        if (broken && t >= next_spike) {
+            pressure += FLT_SPIKE;
+            next_spike += FLT_SPIKE_PERIOD;
+        }
+        fault_detector_push(det, FAULT_BARO, (float32_t)round(pressure));
+        if (cycle % FLT_GNSS_CYCLES == 0) {
+            double gnss = LAUNCH_ALT + height + FLT_GNSS_NOISE * test_rng_range(rng, -1.7f, 1.7f);
+            gnss_held = broken ? gnss_held : gnss;
+            fault_detector_push(det, FAULT_GNSS, (float32_t)gnss_held);
+        }
+
+        for (int pass = 0; pass < FLT_PASSES; pass++) {
+            uint32_t start = flt_clock;
+            fault_detector_step(det, FAULT_PASS_BUDGET);
+            if (budget && flt_clock - start - FLT_READ_CYCLES > result->pass_max) {
+                result->pass_max = flt_clock - start - FLT_READ_CYCLES;
+            }
+        }
+        for (int c = 0; c < FAULT_CHANNELS; c++) {
+            uint8_t state = det->ch[c].state;
+            int expected = state == result->expect[c] && t >= FLT_FAULT_S;
+            if (state != FAULT_OK && expected && isnan(result->detect[c])) {
+                result->detect[c] = t - FLT_FAULT_S;
+            } else if (state != FAULT_OK && !expected && !flagged[c]) {
+                flagged[c] = 1;
+                result->false_flags++;
+            }
+        }
+    }
+}
+
+int fault_detector_test(FILE *out, uint64_t seed) {
+    static FaultDetector det;
+    FaultChannelConfig cfg[FAULT_CHANNELS];
+    FaultRng rng;
+    TestRng sensor_rng;
+    float32_t window[FAULT_WINDOW + 1];
+    q7_t input[FAULT_INPUTS];
+    uint32_t right[FAULT_CLASSES] = {0}, total[FAULT_CLASSES] = {0}, mismatches = 0;
+    FltResult healthy, broken, budgeted;
+    int failures = 0;
+
+    fault_detector_init(&det, NULL);
+    fault_detector_default_config(cfg);
+    fault_rng_seed(&rng, seed, 12);
+    for (uint32_t n = 0; n < FLT_WINDOWS; n++) {
+        uint8_t kind = (uint8_t)(n % FAULT_KINDS);
+        uint8_t cls = (uint8_t)((n / FAULT_KINDS) % FAULT_CLASSES);
+        if (!fault_kind_has_class(kind, cls)) {
+            continue;
+        }
+        fault_window(&rng, kind, cls, window);
+        fault_detector_features(&cfg[fault_kind_channel(kind)], window, input);
+        mismatches += !flt_exact(&det, input);
+        right[cls] += fault_argmax(det.logits) == cls;
+        total[cls]++;
+    }
+    for (uint32_t n = 0; n < FLT_RANDOM; n++) {
+        for (int i = 0; i < FAULT_INPUTS; i++) {
+            input[i] = (q7_t)(fault_rng_uniform(&rng) * 256.0 - 128.0);
+        }
+        mismatches += !flt_exact(&det, input);
+    }
+
+    test_rng_seed(&sensor_rng, seed, 12);
+    flt_run(&det, &sensor_rng, 0, 0, &healthy);
+    flt_run(&det, &sensor_rng, 1, 0, &broken);
+    flt_run(&det, &sensor_rng, 0, 1, &budgeted);
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "faults", "value", "limit", "status");
+    fprintf(out, "%-10s %14u %14d  %s\n", "flt_exact", mismatches, 0, mismatches == 0 ? "ok" : "FAILED");
+    failures += mismatches != 0;
+    static const char *class_rows[FAULT_CLASSES] = {"flt_ok", "flt_stuck", "flt_sat", "flt_spike"};
+    for (int c = 0; c < FAULT_CLASSES; c++) {
+        double rate = (double)right[c] / total[c];
+        double limit = c == FAULT_OK ? FLT_OK_LIMIT : FLT_FAULT_LIMIT;
+        fprintf(out, "%-10s %14.3g %14.3g  %s\n", class_rows[c], rate, limit, rate >= limit ? "ok" : "FAILED");
+        failures += rate < limit;
+    }
+    int false_flags = healthy.false_flags + broken.false_flags + budgeted.false_flags;
+    fprintf(out, "%-10s %14d %14d  %s\n", "flt_false", false_flags, 0, false_flags == 0 ? "ok" : "FAILED");
+    failures += false_flags != 0;
+    static const struct {
+        const char *name;
+        uint8_t channel;
+        double limit;
+    } latency_rows[] = {
+        {"flt_g_stk", FAULT_GYRO_X, FLT_IMU_LATENCY},
+        {"flt_a_sat", FAULT_ACCEL_Z, FLT_IMU_LATENCY},
+        {"flt_b_spk", FAULT_BARO, FLT_SPIKE_LATENCY},
+        {"flt_n_stk", FAULT_GNSS, FLT_GNSS_LATENCY},
+    };
+    for (size_t i = 0; i < sizeof(latency_rows) / sizeof(latency_rows[0]); i++) {
+        double late = broken.detect[latency_rows[i].channel];
+        int ok = late <= latency_rows[i].limit;
+        fprintf(out, "%-10s %14.3g %14.3g  %s\n", latency_rows[i].name, late, latency_rows[i].limit, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+    int budget_ok = budgeted.pass_max <= FAULT_PASS_BUDGET && budgeted.pass_max > 0;
+    fprintf(out, "%-10s %14u %14d  %s\n", "flt_budget", budgeted.pass_max, FAULT_PASS_BUDGET,
+            budget_ok ? "ok" : "FAILED");
+    failures += !budget_ok;
+    return failures;
+}
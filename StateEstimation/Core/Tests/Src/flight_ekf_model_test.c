@@ -0,0 +1,319 @@
+/**
+ * @file flight_ekf_model_test.c
+ * @brief Checks of the generated EKF model kernels
+ *
+ * @details The kernels are compared against the same algebra in double over
+ *          random covariances and rotations, and a flight EKF left on the pad
+ *          for 100 s must keep a symmetric, positive definite covariance.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "flight_ekf_model.h"
+#include "ground_ekf_model.h"
+#include "tests.h"
+
+#define MDL_TRIALS 2000
+#define MDL_LONG_STEPS 20000        // 100 s at the flight EKF rate
+#define MDL_GNSS_NOISE 1.5f         // m, uniform
+#define MDL_LIMIT 1e-5              // relative to the largest entry of the exact result
+#define MDL_GAIN_LIMIT 1e-4         // S is factored in float, its condition enters
+
+// C = A B or A B' in double, A is n by m
+static void mdl_mult(const double *A, const double *B, double *C, int n, int m, int p, int transpose_b) {
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < p; j++) {
+            double sum = 0.0;
+            for (int k = 0; k < m; k++) {
+                sum += A[i * m + k] * (transpose_b ? B[j * m + k] : B[k * p + j]);
+            }
+            C[i * p + j] = sum;
+        }
+    }
+}
+
+// Largest difference of a float result from the exact one, over the largest exact entry
+static double mdl_error(const float32_t *value, const double *exact, int n) {
+    double err = 0.0, scale = 0.0;
+
+    for (int i = 0; i < n; i++) {
+        double diff = fabs(value[i] - exact[i]);
+        err = diff > err || isnan(diff) ? diff : err;
+        scale = fmax(scale, fabs(exact[i]));
+    }
+    return err / scale;
+}
+
+static int mdl_asymmetric(const float32_t *P, int n) {
+    int count = 0;
+
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < i; j++) {
+            count += P[i * n + j] != P[j * n + i];
+        }
+    }
+    return count;
+}
+
+// A covariance D A A' D + 0.1 D^2 with states scaled over two decades
+static void mdl_covariance(TestRng *rng, float32_t *P, int n) {
+    double A[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], scale[MAX_FLIGHT_DIM];
+
+    for (int i = 0; i < n; i++) {
+        scale[i] = pow(10.0, test_rng_range(rng, -1.0f, 1.0f));
+        for (int j = 0; j < n; j++) {
+            A[i * n + j] = test_rng_range(rng, -1.0f, 1.0f);
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        for (int j = 0; j < n; j++) {
+            double sum = i == j ? 0.1 : 0.0;
+            for (int k = 0; k < n; k++) {
+                sum += A[i * n + k] * A[j * n + k];
+            }
+            P[i * n + j] = (float32_t)(scale[i] * scale[j] * sum);
+        }
+    }
+}
+
+// Exact K = P H' S^-1 with H selecting the states in obs, returned with S^-1
+static void mdl_gain(const float32_t *P, const float32_t *R, const int *obs, int nx, int nz, double *K, double *S_inv) {
+    double S[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], PHt[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+
+    for (int i = 0; i < nz; i++) {
+        for (int j = 0; j < nz; j++) {
+            S[i * nz + j] = (double)P[obs[i] * nx + obs[j]] + (i == j ? R[i * nz + i] : 0.0);
+            S_inv[i * nz + j] = i == j;
+        }
+    }
+    // Gauss-Jordan in double, S is well conditioned
+    for (int c = 0; c < nz; c++) {
+        double pivot = S[c * nz + c];
+        for (int j = 0; j < nz; j++) {
+            S[c * nz + j] /= pivot;
+            S_inv[c * nz + j] /= pivot;
+        }
+        for (int r = 0; r < nz; r++) {
+            double factor = S[r * nz + c];
+            if (r == c) {
+                continue;
+            }
+            for (int j = 0; j < nz; j++) {
+                S[r * nz + j] -= factor * S[c * nz + j];
+                S_inv[r * nz + j] -= factor * S_inv[c * nz + j];
+            }
+        }
+    }
+    for (int i = 0; i < nx; i++) {
+        for (int j = 0; j < nz; j++) {
+            PHt[i * nz + j] = P[i * nx + obs[j]];
+        }
+    }
+    mdl_mult(PHt, S_inv, K, nx, nz, nz, 0);
+}
+
+// Exact Joseph form (I - K H) P (I - K H)' + K R K' for the gain the kernel used
+static void mdl_joseph(const float32_t *P, const float32_t *K, const float32_t *R, const int *obs, int nx, int nz,
+                       double *P_out) {
+    double IKH[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], Pd[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    double T[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+
+    for (int i = 0; i < nx * nx; i++) {
+        IKH[i] = i % (nx + 1) == 0;
+        Pd[i] = P[i];
+    }
+    for (int i = 0; i < nx; i++) {
+        for (int j = 0; j < nz; j++) {
+            IKH[i * nx + obs[j]] -= K[i * nz + j];
+        }
+    }
+    mdl_mult(IKH, Pd, T, nx, nx, nx, 0);
+    mdl_mult(T, IKH, P_out, nx, nx, nx, 1);
+    for (int i = 0; i < nx; i++) {
+        for (int j = 0; j < nx; j++) {
+            for (int k = 0; k < nz; k++) {
+                P_out[i * nx + j] += (double)K[i * nz + k] * R[k * nz + k] * K[j * nz + k];
+            }
+        }
+    }
+}
+
+/**
+ * @brief Checks the generated EKF model kernels
+ * @param out Receives the kernel errors against their limits
+ * @param seed Seed of the covariances, rotations and GNSS noise
+ * @return The number of checks that fail
+ * @details The flight f and F must round exactly as the formulas they were
+ *          generated from evaluated in float. The covariance prediction, the
+ *          gain, S^-1 and the Joseph update of both filters are compared over
+ *          random covariances and rotations against the same algebra in
+ *          double, and every covariance written must be exactly symmetric.
+ *          A flight EKF on the pad is then run for MDL_LONG_STEPS on noisy
+ *          GNSS positions with no restore and must stay healthy throughout.
+ */
+int flight_ekf_model_test(FILE *out, uint64_t seed) {
+    static const int flight_obs[FLIGHT_EKF_MODEL_NZ] = {0, 2, 4};
+    static const int ground_obs[GROUND_EKF_MODEL_NZ] = {0, 1, 2, 3, 4, 5};
+    static ExtKalmanFilter ekf;
+    static RocketAttitude atd;
+    static Sensors s;
+    const int nx = FLIGHT_EKF_MODEL_NX, nz = FLIGHT_EKF_MODEL_NZ, gx = GROUND_EKF_MODEL_NX;
+    float32_t P[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], P_out[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t F[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], Q[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t K[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], S_inv[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t R[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    float32_t x[MAX_FLIGHT_DIM], f[MAX_FLIGHT_DIM];
+    double exact[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], exact_s[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    double T[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM], Fd[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    double pred_err = 0.0, gain_err = 0.0, sinv_err = 0.0, joseph_err = 0.0;
+    double ground_gain_err = 0.0, ground_joseph_err = 0.0;
+    int mismatches = 0, asymmetric = 0, singular_errors = 0, unhealthy = 0;
+    int failures = 0;
+    TestRng rng;
+
+    test_rng_seed(&rng, seed, 47);
+    for (int n = 0; n < MDL_TRIALS; n++) {
+        float32_t q[4], dcm_t[3][3], accel[3];
+        float32_t dt = test_rng_range(&rng, 0.001f, 0.05f);
+
+        // dcm_t of a random unit quaternion, as attitude.c forms it
+        float32_t norm = 0.0f;
+        for (int i = 0; i < 4; i++) {
+            q[i] = test_rng_range(&rng, -1.0f, 1.0f);
+            norm += q[i] * q[i];
+        }
+        norm = sqrtf(norm);
+        for (int i = 0; i < 4; i++) {
+            q[i] /= norm;
+        }
+        dcm_t[0][0] = 1.0f - 2.0f * (q[2] * q[2] + q[3] * q[3]);
+        dcm_t[0][1] = 2.0f * (q[1] * q[2] - q[0] * q[3]);
+        dcm_t[0][2] = 2.0f * (q[1] * q[3] + q[0] * q[2]);
+        dcm_t[1][0] = 2.0f * (q[1] * q[2] + q[0] * q[3]);
+        dcm_t[1][1] = 1.0f - 2.0f * (q[1] * q[1] + q[3] * q[3]);
+        dcm_t[1][2] = 2.0f * (q[2] * q[3] - q[0] * q[1]);
+        dcm_t[2][0] = 2.0f * (q[1] * q[3] - q[0] * q[2]);
+        dcm_t[2][1] = 2.0f * (q[2] * q[3] + q[0] * q[1]);
+        dcm_t[2][2] = 1.0f - 2.0f * (q[1] * q[1] + q[2] * q[2]);
+        for (int i = 0; i < 3; i++) {
+            accel[i] = test_rng_range(&rng, -100.0f, 100.0f);
+        }
+        for (int i = 0; i < nx; i++) {
+            x[i] = test_rng_range(&rng, -1000.0f, 1000.0f);
+        }
+
+        // f and F against the hand written formulas they replace
+        flight_ekf_model_f(x, (const float32_t (*)[3])dcm_t, accel, dt, f);
+        flight_ekf_model_F((const float32_t (*)[3])dcm_t, accel, dt, F);
+        for (int i = 0; i < 3; i++) {
+            float32_t vel_flat = dcm_t[i][0] * x[1] + dcm_t[i][1] * x[3] + dcm_t[i][2] * x[5];
+            mismatches += f[2 * i] != vel_flat * dt + x[2 * i];
+            mismatches += f[2 * i + 1] != accel[i] * dt + x[2 * i + 1];
+            for (int j = 0; j < nx; j++) {
+                float32_t pos = j & 1 && j < 6 ? dt * dcm_t[i][j / 2] : (float32_t)(j == 2 * i);
+                mismatches += F[2 * i * nx + j] != pos;
+                mismatches += F[(2 * i + 1) * nx + j] != (float32_t)(j == 2 * i + 1);
+            }
+        }
+        mismatches += f[6] != x[6];
+        for (int j = 0; j < nx; j++) {
+            mismatches += F[6 * nx + j] != (float32_t)(j == 6);
+        }
+
+        // F P F' + Q
+        mdl_covariance(&rng, P, nx);
+        memset(Q, 0, sizeof(Q));
+        for (int i = 0; i < nx; i++) {
+            Q[i * nx + i] = test_rng_range(&rng, 0.001f, 0.1f);
+        }
+        for (int i = 0; i < nx * nx; i++) {
+            Fd[i] = F[i];
+            exact_s[i] = P[i];
+        }
+        mdl_mult(Fd, exact_s, T, nx, nx, nx, 0);
+        mdl_mult(T, Fd, exact, nx, nx, nx, 1);
+        for (int i = 0; i < nx; i++) {
+            exact[i * nx + i] += Q[i * nx + i];
+        }
+        flight_ekf_model_predict_covariance(F, Q, P, P_out);
+        pred_err = fmax(pred_err, mdl_error(P_out, exact, nx * nx));
+        asymmetric += mdl_asymmetric(P_out, nx);
+
+        // Gain and Joseph update on the predicted covariance
+        memcpy(P, P_out, sizeof(float32_t) * nx * nx);
+        memset(R, 0, sizeof(R));
+        for (int i = 0; i < nz; i++) {
+            R[i * nz + i] = test_rng_range(&rng, 0.1f, 10.0f);
+        }
+        mismatches += flight_ekf_model_gain(P, R, K, S_inv) != ARM_MATH_SUCCESS;
+        mdl_gain(P, R, flight_obs, nx, nz, exact, exact_s);
+        gain_err = fmax(gain_err, mdl_error(K, exact, nx * nz));
+        sinv_err = fmax(sinv_err, mdl_error(S_inv, exact_s, nz * nz));
+        mdl_joseph(P, K, R, flight_obs, nx, nz, exact);
+        flight_ekf_model_update_covariance(P, K, R, P);
+        joseph_err = fmax(joseph_err, mdl_error(P, exact, nx * nx));
+        asymmetric += mdl_asymmetric(P, nx);
+
+        // The ground filter observes its whole state
+        mdl_covariance(&rng, P, gx);
+        for (int i = 0; i < gx; i++) {
+            R[i * gx + i] = test_rng_range(&rng, 0.1f, 10.0f);
+        }
+        mismatches += ground_ekf_model_gain(P, R, K, S_inv) != ARM_MATH_SUCCESS;
+        mdl_gain(P, R, ground_obs, gx, gx, exact, exact_s);
+        ground_gain_err = fmax(ground_gain_err, mdl_error(K, exact, gx * gx));
+        mdl_joseph(P, K, R, ground_obs, gx, gx, exact);
+        ground_ekf_model_update_covariance(P, K, R, P_out);
+        ground_joseph_err = fmax(ground_joseph_err, mdl_error(P_out, exact, gx * gx));
+        asymmetric += mdl_asymmetric(P_out, gx);
+    }
+
+    // A singular S must be refused, not divided by
+    memset(P, 0, sizeof(P));
+    memset(R, 0, sizeof(R));
+    singular_errors += flight_ekf_model_gain(P, R, K, S_inv) != ARM_MATH_SINGULAR;
+    singular_errors += ground_ekf_model_gain(P, R, K, S_inv) != ARM_MATH_SINGULAR;
+
+    // Stationary on the pad with GNSS every step, with no restore
+    memset(&s, 0, sizeof(s));
+    initialize_ekf(&ekf, &huart3, &s, 3);
+    initialize_rocket_attitude(&atd, 1.0f, 0.0f, 0.0f, 0.0f);
+    for (int k = 0; k < MDL_LONG_STEPS; k++) {
+        predict_step(&ekf, &atd, &huart3);
+        for (int i = 0; i < 3; i++) {
+            ekf.gps[i] = test_rng_range(&rng, -MDL_GNSS_NOISE, MDL_GNSS_NOISE);
+        }
+        make_measurement(&ekf, &huart3);
+        ekf.health.flags = 0;
+        update_step(&ekf, &huart3);
+        unhealthy += (ekf.health.flags & ~EKF_HEALTH_GATE_FORCED) != 0 || mdl_asymmetric(ekf.P_n.pData, nx) != 0;
+    }
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "ekf model", "max_err", "limit", "status");
+    fprintf(out, "%-10s %14d %14d  %s\n", "mdl_exact", mismatches, 0, mismatches == 0 ? "ok" : "FAILED");
+    failures += mismatches != 0;
+    const struct {
+        const char *name;
+        double err, limit;
+    } rows[] = {
+        {"mdl_pred", pred_err, MDL_LIMIT},
+        {"mdl_gain", gain_err, MDL_GAIN_LIMIT},
+        {"mdl_sinv", sinv_err, MDL_GAIN_LIMIT},
+        {"mdl_joseph", joseph_err, MDL_GAIN_LIMIT},
+        {"gnd_gain", ground_gain_err, MDL_GAIN_LIMIT},
+        {"gnd_joseph", ground_joseph_err, MDL_GAIN_LIMIT},
+    };
+    for (size_t i = 0; i < sizeof(rows) / sizeof(rows[0]); i++) {
+        int ok = rows[i].err <= rows[i].limit;
+        fprintf(out, "%-10s %14.3g %14.3g  %s\n", rows[i].name, rows[i].err, rows[i].limit, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+    fprintf(out, "%-10s %14d %14d  %s\n", "mdl_sym", asymmetric, 0, asymmetric == 0 ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "mdl_sing", singular_errors, 0, singular_errors == 0 ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "mdl_long", unhealthy, 0, unhealthy == 0 ? "ok" : "FAILED");
+    failures += (asymmetric != 0) + (singular_errors != 0) + (unhealthy != 0);
+    return failures;
+}
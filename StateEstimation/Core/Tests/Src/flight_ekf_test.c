@@ -0,0 +1,161 @@
+/**
+ * @file flight_ekf_test.c
+ * @brief Checks of the flight EKF measurement updates
+ *
+ * @details The flight EKF is fed GNSS velocities of a tilted vehicle after
+ *          boost and must settle on its velocity, take late solutions at
+ *          their time and leave them alone when only position is fused. A
+ *          position fix is fused once however long it is held.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "gps.h"
+#include "gnss_origin.h"
+#include "attitude.h"
+#include "tests.h"
+
+#define VEL_STEPS 250               // 5 s at the flight EKF rate
+#define VEL_EVERY 5                 // steps per GNSS solution, 10 Hz
+#define VEL_SETTLE 200              // steps before the error is checked
+#define VEL_NOISE 0.2f              // m/s, uniform, also the reported speed accuracy
+#define VEL_LATENCY_S 0.05f
+#define VEL_LIMIT 0.5               // m/s
+#define VEL_LATENCY_LIMIT 0.01      // m/s
+#define POS_HOLD 5                  // flight EKF cycles each fix is held, 10 Hz
+
+// Queues a GNSS velocity of flat, [up, north, -east], as the decoders would
+static void vel_fix(Sensors *s, const float32_t flat[3], float32_t acc) {
+    s->gps_fix.vel_ned[0] = flat[1];
+    s->gps_fix.vel_ned[1] = -flat[2];
+    s->gps_fix.vel_ned[2] = -flat[0];
+    s->gps_fix.vel_acc = acc;
+    s->gps_fix.vel_new = 1;
+}
+
+// A flight EKF at the pad with the velocity unknown to sigma_v
+void flight_ekf_test_setup(ExtKalmanFilter *ekf, RocketAttitude *atd, Sensors *s, float32_t sigma_v) {
+    memset(s, 0, sizeof(*s));
+    gnss_fix_from_degrees(&s->gps_fix, LAUNCH_LAT, LAUNCH_LON, LAUNCH_ALT);
+    initialize_ekf(ekf, &huart3, s, 3);
+    // About 20 deg off vertical, as after a tilted boost
+    initialize_rocket_attitude(atd, 0.9848f, 0.0f, 0.1228f, 0.1228f);
+    GPS2Flat(s, ekf, 1);
+    memset(ekf->x_n.pData, 0, sizeof(float32_t) * ekf->nx);
+    memset(ekf->P_n.pData, 0, sizeof(float32_t) * ekf->nx * ekf->nx);
+    for (int i = 0; i < ekf->nx; i++) {
+        ekf->P_n.pData[i * ekf->nx + i] = (i & 1) ? sigma_v * sigma_v : 1.0f;
+    }
+    memset(ekf->accelerometer, 0, sizeof(ekf->accelerometer));
+}
+
+// Body velocity into the flat frame with the filter's rotation
+static void vel_to_flat(const RocketAttitude *atd, const float32_t body[3], float32_t flat[3]) {
+    for (int i = 0; i < 3; i++) {
+        flat[i] = atd->frame.dcm_t[i][0] * body[0] + atd->frame.dcm_t[i][1] * body[1] + atd->frame.dcm_t[i][2] * body[2];
+    }
+}
+
+/**
+ * @brief Checks the flight EKF's GNSS velocity update
+ * @param out Receives the velocity errors and wrong outcomes against their limits
+ * @param seed Seed of the measurement noise
+ * @return The number of checks that fail
+ * @details A filter whose velocity is off by 150 m/s, as after boost, is fed
+ *          10 Hz noisy velocities of a tilted vehicle coasting at constant
+ *          body velocity and must settle within VEL_LIMIT. A velocity must
+ *          not move the state when only position fusion is selected, and a
+ *          solution VEL_LATENCY_S old must agree with a state that has
+ *          accelerated since. run_ekf() must take two fixes, each held for
+ *          POS_HOLD cycles, as two position updates.
+ */
+int flight_ekf_test(FILE *out, uint64_t seed) {
+    static ExtKalmanFilter ekf;
+    static RocketAttitude atd;
+    static Sensors s;
+    const float32_t truth[3] = {150.0f, 4.0f, -3.0f};
+    float32_t flat[3];
+    double vel_err = 0.0;
+    int off_errors = 0;
+    int failures = 0;
+    TestRng rng;
+
+    test_rng_seed(&rng, seed, 103);
+    flight_ekf_test_setup(&ekf, &atd, &s, 200.0f);
+    vel_to_flat(&atd, truth, flat);
+    for (int k = 1; k <= VEL_STEPS; k++) {
+        predict_step(&ekf, &atd, &huart3);
+        if (k % VEL_EVERY == 0) {
+            float32_t noisy[3];
+            for (int i = 0; i < 3; i++) {
+                noisy[i] = flat[i] + test_rng_range(&rng, -VEL_NOISE, VEL_NOISE);
+            }
+            vel_fix(&s, noisy, VEL_NOISE);
+            GPS2Flat(&s, &ekf, 0);
+            gps_velocity_update_step(&ekf, &atd, &huart3);
+        }
+        if (k >= VEL_SETTLE) {
+            for (int i = 0; i < 3; i++) {
+                double err = fabs(ekf.x_n.pData[2 * i + 1] - truth[i]);
+                vel_err = err > vel_err || isnan(err) ? err : vel_err;
+            }
+        }
+    }
+
+    // Position only: the velocity is taken and dropped
+    flight_ekf_test_setup(&ekf, &atd, &s, 200.0f);
+    ekf.gps_fuse = FLIGHT_GPS_POSITION;
+    vel_fix(&s, flat, VEL_NOISE);
+    GPS2Flat(&s, &ekf, 0);
+    gps_velocity_update_step(&ekf, &atd, &huart3);
+    for (int i = 0; i < ekf.nx; i++) {
+        off_errors += ekf.x_n.pData[i] != 0.0f;
+    }
+    off_errors += ekf.gps_vel_valid != 0;
+
+    // The state is at truth now, the solution from before the last VEL_LATENCY_S of acceleration
+    const float32_t accel[3] = {60.0f, 2.0f, -1.0f};
+    float32_t then[3], then_flat[3];
+    flight_ekf_test_setup(&ekf, &atd, &s, 200.0f);
+    memcpy(ekf.accelerometer, accel, sizeof(accel));
+    for (int i = 0; i < 3; i++) {
+        ekf.x_n.pData[2 * i + 1] = truth[i];
+        then[i] = truth[i] - accel[i] * VEL_LATENCY_S;
+    }
+    vel_to_flat(&atd, then, then_flat);
+    vel_fix(&s, then_flat, VEL_NOISE);
+    s.gps_fix.time_source = GPS_TIME_PPS;
+    s.gps_fix.time_us = 1000000u;
+    s.imu_time_us = s.gps_fix.time_us + (uint32_t)(VEL_LATENCY_S * 1e6f);
+    GPS2Flat(&s, &ekf, 0);
+    gps_velocity_update_step(&ekf, &atd, &huart3);
+    double lat_err = 0.0;
+    for (int i = 0; i < 3; i++) {
+        double err = fabs(ekf.x_n.pData[2 * i + 1] - truth[i]);
+        lat_err = err > lat_err || isnan(err) ? err : lat_err;
+    }
+
+    // Held fixes: one update each
+    int once_errors = 0;
+    flight_ekf_test_setup(&ekf, &atd, &s, 1.0f);
+    for (int fix = 1; fix <= 2; fix++) {
+        gnss_fix_from_degrees(&s.gps_fix, LAUNCH_LAT, LAUNCH_LON, LAUNCH_ALT + fix);
+        for (int k = 0; k < POS_HOLD; k++) {
+            run_ekf(&ekf, &atd, &s, &huart3, 1);
+        }
+        once_errors += ekf.health.accepted + ekf.health.rejected != fix;
+    }
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "gnss vel", "max_err", "limit", "status");
+    int vel_ok = vel_err <= VEL_LIMIT;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "vel_settle", vel_err, VEL_LIMIT, vel_ok ? "ok" : "FAILED");
+    int lat_ok = lat_err <= VEL_LATENCY_LIMIT;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "vel_late", lat_err, VEL_LATENCY_LIMIT, lat_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "vel_off", off_errors, 0, off_errors == 0 ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "pos_once", once_errors, 0, once_errors == 0 ? "ok" : "FAILED");
+    failures += !vel_ok + !lat_ok + (off_errors != 0) + (once_errors != 0);
+    return failures;
+}
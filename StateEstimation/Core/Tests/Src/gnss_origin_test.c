@@ -0,0 +1,148 @@
+/**
+ * @file gnss_origin_test.c
+ * @brief Checks of the GNSS tangent frame
+ *
+ * @details Draws points at random bearings and heights within each range of
+ *          the pad and converts them with gnss_origin_fix_to_enu(), the HPPVT
+ *          and PVT path, and gnss_origin_hpposecef_to_enu(). Both are compared
+ *          against an exact double precision geodetic to ECEF to ENU
+ *          conversion of the same positions, rounded to the receiver's
+ *          integer units first as the UBX messages would be.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "gps.h"
+#include "gnss_origin.h"
+#include "tests.h"
+
+#define ACCURACY_POINTS 50000
+
+typedef struct {
+    double range;               // m, horizontal and vertical extent of the points
+    double fix_limit;           // m, allowed error of gnss_origin_fix_to_enu()
+    double ecef_limit;          // m, allowed error of gnss_origin_hpposecef_to_enu()
+} AccuracyRange;
+
+// The HPPVT series truncation grows as d^3 / R^2, the HPPOSECEF path only
+// carries float rounding of the offset
+static const AccuracyRange ranges[] = {
+    {1e3, 1e-3, 1e-3},
+    {5e3, 1e-2, 5e-3},
+    {10e3, 5e-2, 5e-3},
+    {20e3, 0.5, 1e-2},
+};
+
+static void geodetic_to_ecef(const GpsFix *fix, double ecef[3]) {
+    double lat = fix->lat * GNSS_DEG_E9_TO_RAD;
+    double lon = fix->lon * GNSS_DEG_E9_TO_RAD;
+    double h = fix->height * GNSS_E4_TO_M;
+    double N = GNSS_WGS84_A / sqrt(1.0 - GNSS_WGS84_E2 * sin(lat) * sin(lat));
+
+    ecef[0] = (N + h) * cos(lat) * cos(lon);
+    ecef[1] = (N + h) * cos(lat) * sin(lon);
+    ecef[2] = (N * (1.0 - GNSS_WGS84_E2) + h) * sin(lat);
+}
+
+// Exact east, north, up of an ECEF position about the origin fix
+static void ecef_to_enu(const GpsFix *origin, const double origin_ecef[3], const double ecef[3], double enu[3]) {
+    double lat = origin->lat * GNSS_DEG_E9_TO_RAD;
+    double lon = origin->lon * GNSS_DEG_E9_TO_RAD;
+    double d[3] = {ecef[0] - origin_ecef[0], ecef[1] - origin_ecef[1], ecef[2] - origin_ecef[2]};
+
+    enu[0] = -sin(lon) * d[0] + cos(lon) * d[1];
+    enu[1] = -sin(lat) * cos(lon) * d[0] - sin(lat) * sin(lon) * d[1] + cos(lat) * d[2];
+    enu[2] = cos(lat) * cos(lon) * d[0] + cos(lat) * sin(lon) * d[1] + sin(lat) * d[2];
+}
+
+// The HPPOSECEF message for an ECEF position, also returned as rounded to 0.1 mm
+static void ecef_to_hpposecef(double ecef[3], struct ublox_gnss_nav_hpposecef *msg) {
+    int64_t e4[3];
+
+    for (int i = 0; i < 3; i++) {
+        e4[i] = llround(ecef[i] / GNSS_E4_TO_M);
+        ecef[i] = e4[i] * GNSS_E4_TO_M;
+    }
+    memset(msg, 0, sizeof(*msg));
+    msg->ecefX = (int32_t)(e4[0] / 100);
+    msg->ecefY = (int32_t)(e4[1] / 100);
+    msg->ecefZ = (int32_t)(e4[2] / 100);
+    msg->ecefXHp = (int8_t)(e4[0] % 100);
+    msg->ecefYHp = (int8_t)(e4[1] % 100);
+    msg->ecefZHp = (int8_t)(e4[2] % 100);
+}
+
+static double enu_error(const float32_t enu[3], const double exact[3]) {
+    double dx = enu[0] - exact[0];
+    double dy = enu[1] - exact[1];
+    double dz = enu[2] - exact[2];
+    return sqrt(dx * dx + dy * dy + dz * dz);
+}
+
+/**
+ * @brief Measures the worst-case conversion error over each range
+ * @param out Receives a table of the errors against their limits
+ * @param seed Seed of the test points
+ * @return The number of ranges and paths that exceed their limit
+ */
+int gnss_origin_test(FILE *out, uint64_t seed) {
+    GpsFix origin_fix;
+    GnssOrigin origin;
+    double origin_ecef[3];
+    int failures = 0;
+
+    gnss_fix_from_degrees(&origin_fix, LAUNCH_LAT, LAUNCH_LON, LAUNCH_ALT);
+    gnss_origin_set(&origin, &origin_fix);
+    geodetic_to_ecef(&origin_fix, origin_ecef);
+
+    double lat0 = LAUNCH_LAT * GNSS_PI / 180.0;
+    double radius = GNSS_WGS84_A / sqrt(1.0 - GNSS_WGS84_E2 * sin(lat0) * sin(lat0));
+
+    fprintf(out, "%-10s %-10s %14s %14s  %s\n", "range_m", "path", "max_err_m", "limit_m", "status");
+
+    for (size_t r = 0; r < sizeof(ranges) / sizeof(ranges[0]); r++) {
+        const AccuracyRange *range = &ranges[r];
+        TestRng rng;
+        double fix_max = 0.0;
+        double ecef_max = 0.0;
+
+        test_rng_seed(&rng, seed, r);
+        for (int i = 0; i < ACCURACY_POINTS; i++) {
+            double bearing = test_rng_range(&rng, 0.0f, 2.0f * (float)GNSS_PI);
+            double dist = range->range * sqrt(test_rng_range(&rng, 0.0f, 1.0f));
+            double up = range->range * test_rng_range(&rng, 0.0f, 1.0f);
+            double lat = LAUNCH_LAT + dist * cos(bearing) / radius * 180.0 / GNSS_PI;
+            double lon = LAUNCH_LON + dist * sin(bearing) / (radius * cos(lat0)) * 180.0 / GNSS_PI;
+
+            GpsFix fix;
+            struct ublox_gnss_nav_hpposecef msg;
+            double ecef[3], exact[3];
+            float32_t enu[3];
+
+            gnss_fix_from_degrees(&fix, lat, lon, LAUNCH_ALT + up);
+            geodetic_to_ecef(&fix, ecef);
+            ecef_to_enu(&origin_fix, origin_ecef, ecef, exact);
+            gnss_origin_fix_to_enu(&origin, &fix, enu);
+            fix_max = fmax(fix_max, enu_error(enu, exact));
+
+            ecef_to_hpposecef(ecef, &msg);
+            ecef_to_enu(&origin_fix, origin_ecef, ecef, exact);
+            gnss_origin_hpposecef_to_enu(&origin, &msg, enu);
+            ecef_max = fmax(ecef_max, enu_error(enu, exact));
+        }
+
+        int fix_ok = fix_max <= range->fix_limit;
+        int ecef_ok = ecef_max <= range->ecef_limit;
+        failures += !fix_ok + !ecef_ok;
+
+        fprintf(out, "%-10.0f %-10s %14.3g %14.3g  %s\n", range->range, "hppvt", fix_max, range->fix_limit,
+                fix_ok ? "ok" : "FAILED");
+        fprintf(out, "%-10.0f %-10s %14.3g %14.3g  %s\n", range->range, "hpposecef", ecef_max, range->ecef_limit,
+                ecef_ok ? "ok" : "FAILED");
+    }
+
+    return failures;
+}
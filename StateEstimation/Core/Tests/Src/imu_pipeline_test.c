@@ -0,0 +1,124 @@
+/**
+ * @file imu_pipeline_test.c
+ * @brief Checks of the IMU pipeline filters
+ *
+ * @details The pipeline is fed accelerometer counts at the ADIS16500 rate with
+ *          a tone that aliases onto a few Hz at the estimator rate, and must
+ *          take it out with each filter, and a slow tone it must pass.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "gnss_origin.h"
+#include "imu_pipeline.h"
+#include "tests.h"
+
+#define IMU_DC 800.0                // counts, about 1 g
+#define IMU_TONE 1600.0             // counts
+#define IMU_ALIAS_HZ 590.0          // folds onto 10 Hz at 200 Hz
+#define IMU_PASS_HZ 5.0
+#define IMU_SETTLE 40               // outputs skipped while the filter settles
+#define IMU_OUTPUTS 400             // measured, whole periods of both tones
+#define IMU_ALIAS_LIMIT 60.0        // dB, filtered
+#define IMU_GAIN_LIMIT 0.01         // relative, passband
+
+// Runs a tone on the x accelerometer through the pipeline, out receives the
+// outputs after IMU_SETTLE in counts
+static void imu_run(ImuFilterType filter, double dc, double hz, double *out) {
+    static ImuPipeline pipe;
+    ImuPipelineConfig cfg;
+    int16_t sample[IMU_PIPELINE_CHANNELS] = {0};
+    int n = 0;
+
+    imu_pipeline_default_config(&cfg);
+    cfg.filter = filter;
+    imu_pipeline_init(&pipe, &cfg);
+    for (long i = 0; n < IMU_SETTLE + IMU_OUTPUTS; i++) {
+        sample[3] = (int16_t)lround(dc + IMU_TONE * sin(2.0 * GNSS_PI * hz * i / IMU_PIPELINE_SAMPLE_RATE));
+        imu_pipeline_push(&pipe, sample, (uint32_t)(i * 500));
+        if (imu_pipeline_process(&pipe)) {
+            if (n >= IMU_SETTLE) {
+                out[n - IMU_SETTLE] = pipe.accel[0] / IMU_PIPELINE_ACCEL_LSB;
+            }
+            n++;
+        }
+    }
+}
+
+// Tone left in the outputs of a DC input, in dB below the input tone
+static double imu_alias_rejection(const double *out) {
+    double sum = 0.0;
+
+    for (int i = 0; i < IMU_OUTPUTS; i++) {
+        sum += (out[i] - IMU_DC) * (out[i] - IMU_DC);
+    }
+    return 20.0 * log10((IMU_TONE / sqrt(2.0)) / fmax(sqrt(sum / IMU_OUTPUTS), 1e-9));
+}
+
+// Relative gain error at IMU_PASS_HZ, the amplitude by least squares over whole periods
+static double imu_gain_error(const double *out) {
+    double rate = IMU_PIPELINE_SAMPLE_RATE / IMU_PIPELINE_DECIMATION;
+    double c = 0.0;
+    double s = 0.0;
+
+    for (int i = 0; i < IMU_OUTPUTS; i++) {
+        double phase = 2.0 * GNSS_PI * IMU_PASS_HZ * i / rate;
+        c += out[i] * cos(phase);
+        s += out[i] * sin(phase);
+    }
+    return fabs(2.0 * hypot(c, s) / IMU_OUTPUTS / IMU_TONE - 1.0);
+}
+
+/**
+ * @brief Checks the IMU pipeline against aliasing and for a flat passband
+ * @param out Receives the alias rejection and passband gain of each filter
+ * @return The number of checks that fail
+ * @details The tone is IMU_ALIAS_HZ on top of about 1 g. IMU_FILTER_NONE,
+ *          the integration alone, and taking every IMU_PIPELINE_DECIMATION-th
+ *          sample are printed for comparison and not checked for rejection.
+ */
+int imu_pipeline_test(FILE *out, uint64_t seed) {
+    (void)seed;
+    static const struct {
+        const char *name;
+        ImuFilterType filter;
+        int checked;
+    } filters[] = {
+        {"biquad", IMU_FILTER_BIQUAD, 1},
+        {"fir", IMU_FILTER_FIR, 1},
+        {"none", IMU_FILTER_NONE, 0},
+    };
+    static double outputs[IMU_OUTPUTS];
+    int failures = 0;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "imu_alias", "reject_dB", "min", "status");
+    for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++) {
+        imu_run(filters[f].filter, IMU_DC, IMU_ALIAS_HZ, outputs);
+        double rejection = imu_alias_rejection(outputs);
+        int ok = !filters[f].checked || rejection >= IMU_ALIAS_LIMIT;
+        if (filters[f].checked) {
+            fprintf(out, "%-10s %14.1f %14.1f  %s\n", filters[f].name, rejection, IMU_ALIAS_LIMIT, ok ? "ok" : "FAILED");
+        } else {
+            fprintf(out, "%-10s %14.1f %14s  %s\n", filters[f].name, rejection, "-", "reference");
+        }
+        failures += !ok;
+    }
+    for (int i = 0; i < IMU_OUTPUTS; i++) {
+        long k = (long)(IMU_SETTLE + i) * IMU_PIPELINE_DECIMATION;
+        outputs[i] = lround(IMU_DC + IMU_TONE * sin(2.0 * GNSS_PI * IMU_ALIAS_HZ * k / IMU_PIPELINE_SAMPLE_RATE));
+    }
+    fprintf(out, "%-10s %14.1f %14s  %s\n", "decimate", imu_alias_rejection(outputs), "-", "reference");
+
+    fprintf(out, "\n%-10s %14s %14s  %s\n", "imu_gain", "max_err", "limit", "status");
+    for (size_t f = 0; f < sizeof(filters) / sizeof(filters[0]); f++) {
+        imu_run(filters[f].filter, 0.0, IMU_PASS_HZ, outputs);
+        double error = imu_gain_error(outputs);
+        int ok = error <= IMU_GAIN_LIMIT;
+        fprintf(out, "%-10s %14.3g %14.3g  %s\n", filters[f].name, error, IMU_GAIN_LIMIT, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+    return failures;
+}
@@ -0,0 +1,92 @@
+/**
+ * @file magnetometer_test.c
+ * @brief Checks of the magnetometer calibration
+ *
+ * @details The calibrator is fed a known hard and soft iron seen from random
+ *          directions and must recover both, and must not accept readings
+ *          from a vehicle that stays still on the pad.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "gnss_origin.h"
+#include "magnetometer.h"
+#include "tests.h"
+
+#define MAG_POINTS 4096
+#define MAG_FIELD 0.48f             // Gauss, about the field at the launch site
+#define MAG_NOISE 0.003f            // Gauss, peak, a few LSB at 4 Gauss full scale
+#define MAG_OFFSET_LIMIT 5e-3       // Gauss
+#define MAG_SCALE_LIMIT 1e-2        // relative, of the scale of each axis to x
+
+// Feeds a raw reading of the field along the unit vector dir, or the pad
+// direction if dir is NULL
+static void mag_feed(MagCalibrator *cal, TestRng *rng, const float32_t offset[3], const float32_t scale[3],
+                     const float32_t dir[3]) {
+    static const float32_t pad_dir[3] = {-0.875f, 0.479f, 0.042f};
+    Sensors sensors;
+    float32_t raw[3];
+
+    if (dir == NULL) {
+        dir = pad_dir;
+    }
+    for (int k = 0; k < 3; k++) {
+        raw[k] = MAG_FIELD * dir[k] / scale[k] + offset[k] + test_rng_range(rng, -MAG_NOISE, MAG_NOISE);
+    }
+    memset(&sensors, 0, sizeof(sensors));
+    sensors.mag_x = raw[0];
+    sensors.mag_y = raw[1];
+    sensors.mag_z = raw[2];
+    sensors.mag_new = 1;
+    mag_calibrator_update(cal, &sensors);
+}
+
+/**
+ * @brief Checks that the magnetometer calibration recovers a known hard and soft iron
+ * @param out Receives the offset and scale errors against their limits
+ * @param seed Seed of the field directions and noise
+ * @return The number of checks that fail
+ */
+int magnetometer_test(FILE *out, uint64_t seed) {
+    static const float32_t offset[3] = {0.05f, -0.03f, 0.02f};
+    static const float32_t scale[3] = {1.0f, 0.88f, 1.07f};
+    MagCalibrator cal;
+    TestRng rng;
+    double offset_max = 0.0;
+    double scale_max = 0.0;
+
+    test_rng_seed(&rng, seed, 100);
+    mag_calibrator_init(&cal);
+    for (int i = 0; i < MAG_POINTS; i++) {
+        float32_t z = test_rng_range(&rng, -1.0f, 1.0f);
+        float32_t phi = test_rng_range(&rng, 0.0f, 2.0f * (float)GNSS_PI);
+        float32_t r = sqrtf(1.0f - z * z);
+        float32_t dir[3] = {r * cosf(phi), r * sinf(phi), z};
+        mag_feed(&cal, &rng, offset, scale, dir);
+    }
+    for (int k = 0; k < 3; k++) {
+        offset_max = fmax(offset_max, fabs(cal.offset[k] - offset[k]));
+        scale_max = fmax(scale_max, fabs((cal.scale[k] / cal.scale[0]) / scale[k] - 1.0));
+    }
+
+    MagCalibrator pad;
+    mag_calibrator_init(&pad);
+    for (int i = 0; i < MAG_POINTS; i++) {
+        mag_feed(&pad, &rng, offset, scale, NULL);
+    }
+
+    int converged_ok = cal.converged;
+    int offset_ok = converged_ok && offset_max <= MAG_OFFSET_LIMIT;
+    int scale_ok = converged_ok && scale_max <= MAG_SCALE_LIMIT;
+    int pad_ok = !pad.converged;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "mag", "max_err", "limit", "status");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "offset_G", offset_max, MAG_OFFSET_LIMIT, offset_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "scale_rel", scale_max, MAG_SCALE_LIMIT, scale_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14s %14s  %s\n", "pad_only", pad.converged ? "accepted" : "rejected", "rejected",
+            pad_ok ? "ok" : "FAILED");
+    return !offset_ok + !scale_ok + !pad_ok;
+}
@@ -0,0 +1,169 @@
+/**
+ * @file noise_adapt_test.c
+ * @brief Checks of the GNSS noise adaptation and the process noise phases
+ *
+ * @details The flight EKF is fed fixes noisier than its nominal R on two axes
+ *          and cleaner on the third, and with R adapted must be consistent
+ *          with its innovations, close to the true noise and closer to the
+ *          truth than with the nominal R. R must stay within its bounds and Q
+ *          follow the flight phase.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "attitude.h"
+#include "tests.h"
+
+#define NA_FIXES 600                // 60 s of 10 Hz fixes
+#define NA_EVERY 20                 // flight EKF steps per fix, the first fuses it
+#define NA_SETTLE 200               // fixes before R and the position error are averaged
+#define NA_NIS_LIMIT 0.25           // relative error of the mean NIS against its expected nz
+#define NA_R_LIMIT 0.5              // relative error of the mean adapted R against the true variance, per axis
+#define NA_RMS_LIMIT 0.8            // position RMS with adaptation over that with the nominal R
+
+typedef struct {
+    double r_min[3], r_max[3];      // over its nominal value, over the whole run
+    double r_mean[3];               // m^2, adapted R after NA_SETTLE
+    double rms;                     // m, position error after NA_SETTLE
+    double nis;                     // mean y^2 / (P + R) summed over the axes, after NA_SETTLE
+} NaResult;
+
+// Standard normal sample, Box-Muller
+static float32_t na_gauss(TestRng *rng) {
+    double u = test_rng_range(rng, 1e-7f, 1.0f);
+    double v = test_rng_range(rng, 0.0f, 1.0f);
+    return (float32_t)(sqrt(-2.0 * log(u)) * cos(2.0 * M_PI * v));
+}
+
+// A flight EKF at rest on the pad, fed fixes of the true noise sigma as the estimator would
+static void na_run(ExtKalmanFilter *ekf, RocketAttitude *atd, Sensors *s, TestRng *rng, const float32_t sigma[3],
+                   int adapt, NaResult *result) {
+    double sq = 0.0;
+    int n = 0;
+
+    memset(s, 0, sizeof(*s));
+    memset(result, 0, sizeof(*result));
+    initialize_ekf(ekf, &huart3, s, 3);
+    initialize_rocket_attitude(atd, 1.0f, 0.0f, 0.0f, 0.0f);
+    ekf->noise.enabled = adapt;
+    for (int i = 0; i < 3; i++) {
+        result->r_min[i] = INFINITY;
+    }
+    for (int fix = 0; fix < NA_FIXES; fix++) {
+        for (int i = 0; i < 3; i++) {
+            ekf->gps[i] = sigma[i] * na_gauss(rng);
+        }
+        predict_step(ekf, atd, &huart3);
+        for (int i = 0; i < 3 && fix >= NA_SETTLE; i++) {
+            double y = ekf->gps[i] - ekf->x_n.pData[2 * i];
+            result->nis += y * y / (ekf->P_n.pData[2 * i * (ekf->nx + 1)] + ekf->R.pData[i * 4]);
+        }
+        make_measurement(ekf, &huart3);
+        update_step(ekf, &huart3);
+        for (int k = 1; k < NA_EVERY; k++) {
+            predict_step(ekf, atd, &huart3);
+        }
+        for (int i = 0; i < 3; i++) {
+            double ratio = ekf->noise.r[i] / ekf->noise.r_nominal[i];
+            result->r_min[i] = fmin(result->r_min[i], ratio);
+            result->r_max[i] = fmax(result->r_max[i], ratio);
+        }
+        if (fix >= NA_SETTLE) {
+            for (int i = 0; i < 3; i++) {
+                double err = ekf->x_n.pData[2 * i];
+                sq += err * err;
+                result->r_mean[i] += ekf->R.pData[i * 4];
+            }
+            n++;
+        }
+    }
+    result->rms = sqrt(sq / n);
+    result->nis /= n;
+    for (int i = 0; i < 3; i++) {
+        result->r_mean[i] /= n;
+    }
+}
+
+/**
+ * @brief Checks the GNSS noise adaptation and the process noise phases of the flight EKF
+ * @param out Receives the errors and wrong outcomes against their limits
+ * @param seed Seed of the measurement noise
+ * @return The number of checks that fail
+ * @details A flight EKF at rest is fed 10 Hz fixes whose noise differs from
+ *          the nominal R on each axis and fused once, as run_ekf() does. With
+ *          R adapted, the NIS must average nz to within NA_NIS_LIMIT, R must
+ *          average the true variance to within NA_R_LIMIT on each axis and
+ *          the position error must be smaller than with the nominal R. Fixes
+ *          far noisier and far cleaner than nominal must drive R to its
+ *          bounds and not past them. Q must be raised on the velocities in
+ *          each flight phase and be back to nominal on the pad.
+ */
+int noise_adapt_test(FILE *out, uint64_t seed) {
+    static ExtKalmanFilter ekf;
+    static RocketAttitude atd;
+    static Sensors s;
+    const float32_t sigma[3] = {4.5f, 1.0f, 7.5f};
+    const float32_t loud[3] = {8.0f, 8.0f, 20.0f};
+    const float32_t quiet[3] = {0.05f, 0.05f, 0.05f};
+    NaResult adapted, fixed, bound;
+    int bound_errors = 0;
+    int phase_errors = 0;
+    int failures = 0;
+    TestRng rng;
+
+    test_rng_seed(&rng, seed, 113);
+    na_run(&ekf, &atd, &s, &rng, sigma, 1, &adapted);
+    double nis_err = fabs(adapted.nis / 3.0 - 1.0);
+    test_rng_seed(&rng, seed, 113);
+    na_run(&ekf, &atd, &s, &rng, sigma, 0, &fixed);
+    double rms_ratio = adapted.rms / fixed.rms;
+    double r_err = 0.0;
+    for (int i = 0; i < 3; i++) {
+        r_err = fmax(r_err, fabs(adapted.r_mean[i] / (sigma[i] * sigma[i]) - 1.0));
+    }
+
+    na_run(&ekf, &atd, &s, &rng, loud, 1, &bound);
+    for (int i = 0; i < 3; i++) {
+        bound_errors += bound.r_max[i] > NOISE_ADAPT_R_MAX * 1.0001 || bound.r_max[i] < NOISE_ADAPT_R_MAX * 0.99;
+    }
+    na_run(&ekf, &atd, &s, &rng, quiet, 1, &bound);
+    for (int i = 0; i < 3; i++) {
+        bound_errors += bound.r_min[i] < NOISE_ADAPT_R_MIN * 0.9999 || bound.r_min[i] > NOISE_ADAPT_R_MIN * 1.01 ||
+                        bound.r_max[i] > NOISE_ADAPT_R_MAX * 1.0001;
+    }
+
+    // Q through the phases and back, run_ekf picks the phase from the state machine
+    float32_t q_nominal[MAX_FLIGHT_DIM * MAX_FLIGHT_DIM];
+    const uint16_t phases[] = {FASTASCENT, SLOWASCENT, FREEFALL, GROUND};
+    uint16_t saved_state = rocket_state;
+    flight_ekf_test_setup(&ekf, &atd, &s, 1.0f);
+    memcpy(q_nominal, ekf.Q.pData, sizeof(float32_t) * ekf.nx * ekf.nx);
+    for (size_t p = 0; p < sizeof(phases) / sizeof(phases[0]); p++) {
+        rocket_state = phases[p];
+        run_ekf(&ekf, &atd, &s, &huart3, 1);
+        for (int i = 0; i < ekf.nx; i++) {
+            for (int j = 0; j < ekf.nx; j++) {
+                float32_t q = ekf.Q.pData[i * ekf.nx + j], q0 = q_nominal[i * ekf.nx + j];
+                int raised = i == j && (i & 1) && phases[p] != GROUND;
+                phase_errors += raised ? !(q > q0) : q != q0 && !(i == j && i == ekf.nx - 1);
+            }
+        }
+    }
+    phase_errors += memcmp(q_nominal, ekf.Q.pData, sizeof(float32_t) * ekf.nx * ekf.nx) != 0;
+    rocket_state = saved_state;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "ekf noise", "max_err", "limit", "status");
+    int nis_ok = nis_err <= NA_NIS_LIMIT;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "na_nis", nis_err, NA_NIS_LIMIT, nis_ok ? "ok" : "FAILED");
+    int r_ok = r_err <= NA_R_LIMIT;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "na_r", r_err, NA_R_LIMIT, r_ok ? "ok" : "FAILED");
+    int rms_ok = rms_ratio <= NA_RMS_LIMIT;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "na_rms", rms_ratio, NA_RMS_LIMIT, rms_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "na_bound", bound_errors, 0, bound_errors == 0 ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "na_phase", phase_errors, 0, phase_errors == 0 ? "ok" : "FAILED");
+    failures += !nis_ok + !r_ok + !rms_ok + (bound_errors != 0) + (phase_errors != 0);
+    return failures;
+}
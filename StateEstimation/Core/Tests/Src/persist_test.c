@@ -0,0 +1,102 @@
+/**
+ * @file persist_test.c
+ * @brief Checks of the calibration and snapshot stores
+ *
+ * @details The calibration store is filled past a full sector and must load
+ *          the last record saved, and the snapshots must survive a warm reset
+ *          and be gone after a power-on reset.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "persist.h"
+#include "tests.h"
+
+#define PERSIST_CRC_CHECK 0xCBF43926u   // CRC-32 of "123456789"
+
+// Calibration whose payload tells the saves apart
+static void persist_fill(CalibrationRecord *record, uint32_t index) {
+    memset(record, 0, sizeof(*record));
+    record->flags = PERSIST_CAL_BIASES | PERSIST_CAL_MAG | PERSIST_CAL_ORIGIN;
+    for (int i = 0; i < 3; i++) {
+        record->accel_bias[i] = 0.01f * (float32_t)index + i;
+        record->gyro_bias[i] = -0.001f * (float32_t)index + i;
+        record->mag_offset[i] = 0.1f * i;
+        record->mag_scale[i] = 1.0f + 0.01f * i;
+    }
+    for (int i = 0; i < 6; i++) {
+        record->bias_var[i] = 1e-6f * (i + 1);
+    }
+    record->origin_lat = 32990300000LL + index;
+    record->origin_lon = -106975000000LL;
+    record->origin_height = 14010000LL;
+}
+
+// Payload bytes that differ, the header and CRC are the store's
+static int persist_diff(const CalibrationRecord *a, const CalibrationRecord *b) {
+    const uint8_t *x = (const uint8_t *)&a->flags;
+    const uint8_t *y = (const uint8_t *)&b->flags;
+    int diff = 0;
+
+    for (size_t i = 0; i < offsetof(CalibrationRecord, reserved) - offsetof(CalibrationRecord, flags); i++) {
+        diff += x[i] != y[i];
+    }
+    return diff;
+}
+
+/**
+ * @brief Checks the calibration store across a full sector and the snapshots across resets
+ * @param out Receives the number of wrong bytes or outcomes of each check against its limit of none
+ * @return The number of checks that fail
+ */
+int persist_test(FILE *out, uint64_t seed) {
+    (void)seed;
+    static CalibrationRecord saved, loaded;
+    static WarmStartRecord snapshot, restored;
+    int errors[5] = {0};
+    static const char *names[5] = {"crc32", "cal_load", "cal_wrap", "warm_reset", "power_on"};
+    int failures = 0;
+
+    persist_host_reset(0);
+    persist_init();
+
+    errors[0] = persist_crc32("123456789", 9) != PERSIST_CRC_CHECK;
+
+    errors[1] = calibration_store_load(&loaded);
+    persist_fill(&saved, 0);
+    errors[1] += !calibration_store_save(&saved);
+    errors[1] += !calibration_store_load(&loaded) ? 1 : persist_diff(&saved, &loaded);
+
+    // One more than the sector holds, the last save erases it first
+    for (uint32_t i = 1; i <= PERSIST_CAL_SLOTS; i++) {
+        persist_fill(&saved, i);
+        errors[2] += !calibration_store_save(&saved);
+    }
+    errors[2] += !calibration_store_load(&loaded) ? 1 : persist_diff(&saved, &loaded) + (loaded.sequence != PERSIST_CAL_SLOTS + 1);
+
+    memset(&snapshot, 0, sizeof(snapshot));
+    for (int i = 0; i < 3; i++) {
+        snapshot.state = (uint16_t)(3 + i);
+        snapshot.x[0] = (float32_t)i;
+        warm_start_save(&snapshot);
+    }
+    persist_host_reset(1);
+    errors[3] = !persist_init();
+    errors[3] += !warm_start_load(&restored) ? 1 : memcmp(&snapshot, &restored, sizeof(snapshot)) != 0;
+    errors[3] += !calibration_store_load(&loaded) ? 1 : persist_diff(&saved, &loaded);
+
+    persist_host_reset(0);
+    errors[4] = persist_init();
+    errors[4] += warm_start_load(&restored);
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "persist", "errors", "limit", "status");
+    for (int i = 0; i < 5; i++) {
+        int ok = errors[i] == 0;
+        fprintf(out, "%-10s %14d %14d  %s\n", names[i], errors[i], 0, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+    return failures;
+}
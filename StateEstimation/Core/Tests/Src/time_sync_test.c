@@ -0,0 +1,95 @@
+/**
+ * @file time_sync_test.c
+ * @brief Checks of the time pulse mapping
+ *
+ * @details The mapping is run on a drifting local clock with late solutions and
+ *          a false edge and must place the solutions to within a few
+ *          microseconds.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "time_sync.h"
+#include "tests.h"
+
+#define TS_SECONDS 60
+#define TS_DRIFT 30e-6              // local clock runs fast by this
+#define TS_JITTER_US 1.0            // capture resolution
+#define TS_LATENCY_MIN_MS 30.0
+#define TS_LATENCY_MAX_MS 80.0
+#define TS_FALSE_SECOND 40          // a false edge 0.69 s into this second
+#define TS_MAP_LIMIT_US 5.0
+#define TS_DRIFT_LIMIT_PPM 1.0
+
+// Local time of a GPS time, us since the first edge, on a counter that wraps soon after the start
+static uint32_t ts_local(double gps_us) {
+    return (uint32_t)(0xFFFFFFFFu - 20000000u) + (uint32_t)llround(gps_us * (1.0 + TS_DRIFT));
+}
+
+/**
+ * @brief Checks the time pulse mapping on a drifting local clock
+ * @param out Receives the mapping and drift errors and the wrong outcomes against their limits
+ * @param seed Seed of the capture jitter and the solution latencies
+ * @return The number of checks that fail
+ * @details A time pulse every GPS second is captured with jitter and ten
+ *          solutions a second arrive 30 to 80 ms late, starting shortly before
+ *          both the week and the local counter wrap. Once locked, the local
+ *          time of every solution must be within TS_MAP_LIMIT_US and map back
+ *          to its time of week, and a false edge must be dropped without
+ *          losing the lock.
+ */
+int time_sync_test(FILE *out, uint64_t seed) {
+    static TimeSync ts;
+    const uint32_t tow_start = TIME_SYNC_WEEK_MS - 20000u;
+    double map_err = 0.0;
+    int wrong = 0, false_errors = 0;
+    int failures = 0;
+    TestRng rng;
+
+    test_rng_seed(&rng, seed, 102);
+    time_sync_init(&ts);
+    for (int s = 0; s < TS_SECONDS; s++) {
+        double edge_us = s * 1e6 + test_rng_range(&rng, -TS_JITTER_US, TS_JITTER_US);
+        time_sync_pps(&ts, ts_local(edge_us));
+
+        for (int k = 0; k < 10; k++) {
+            uint32_t tow = (tow_start + (uint32_t)(s * 1000 + k * 100)) % TIME_SYNC_WEEK_MS;
+            double valid_us = s * 1e6 + k * 1e5;
+            double latency_us = 1e3 * test_rng_range(&rng, TS_LATENCY_MIN_MS, TS_LATENCY_MAX_MS);
+
+            if (s == TS_FALSE_SECOND && k == 7) {
+                uint32_t rejected = ts.rejected;
+                time_sync_pps(&ts, ts_local(valid_us - 1e4));
+                time_sync_solution(&ts, tow, ts_local(valid_us + latency_us));
+                false_errors = (ts.rejected != rejected + 1) + !time_sync_locked(&ts);
+                continue;
+            }
+            time_sync_solution(&ts, tow, ts_local(valid_us + latency_us));
+            if (s < TIME_SYNC_LOCK_EDGES) {
+                continue;
+            }
+
+            uint32_t local, back;
+            if (!time_sync_to_local(&ts, tow, &local) || !time_sync_to_tow(&ts, local, &back) || back != tow) {
+                wrong++;
+                continue;
+            }
+            double err = fabs((double)(int32_t)(local - ts_local(valid_us)));
+            map_err = err > map_err ? err : map_err;
+        }
+    }
+    double drift_err = fabs(ts.drift - TS_DRIFT) * 1e6;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "time sync", "max_err", "limit", "status");
+    int map_ok = map_err <= TS_MAP_LIMIT_US;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "ts_map_us", map_err, TS_MAP_LIMIT_US, map_ok ? "ok" : "FAILED");
+    int drift_ok = drift_err <= TS_DRIFT_LIMIT_PPM;
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "ts_ppm", drift_err, TS_DRIFT_LIMIT_PPM, drift_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "ts_tow", wrong, 0, wrong == 0 ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14d %14d  %s\n", "ts_false", false_errors, 0, false_errors == 0 ? "ok" : "FAILED");
+    failures += !map_ok + !drift_ok + (wrong != 0) + (false_errors != 0);
+    return failures;
+}
@@ -0,0 +1,69 @@
+/**
+ * @file trig_test.c
+ * @brief Checks of the trig.h polynomials
+ *
+ * @details The polynomials are swept densely over the angles and ratios their
+ *          documented bounds cover and compared against double libm.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "trig.h"
+#include "tests.h"
+
+#define TRIG_SINCOS_RANGE 1000.0    // rad, as TRIG_POLY_SINCOS_MAX_ERROR
+#define TRIG_SINCOS_POINTS 4000001
+#define TRIG_ATAN_POINTS 2001       // per axis of the (x, y) grid
+
+/**
+ * @brief Measures the worst-case error of the trig.h polynomial backend
+ * @param out Receives the errors against TRIG_POLY_SINCOS_MAX_ERROR and TRIG_POLY_ATAN_MAX_ERROR
+ * @return The number of checks that exceed their limit
+ * @details atan2 is swept over a grid of signs and ratios from 1e-3 to 1e3,
+ *          asin over [-1, 1], through trig_asin() of the selected backend.
+ */
+int trig_test(FILE *out, uint64_t seed) {
+    (void)seed;
+    double sincos_max = 0.0;
+    double atan_max = 0.0;
+    double asin_max = 0.0;
+
+    for (int i = 0; i < TRIG_SINCOS_POINTS; i++) {
+        float32_t angle = (float32_t)(TRIG_SINCOS_RANGE * (2.0 * i / (TRIG_SINCOS_POINTS - 1) - 1.0));
+        float32_t s, c;
+
+        trig_poly_sincos(angle, &s, &c);
+        sincos_max = fmax(sincos_max, fabs(s - sin((double)angle)));
+        sincos_max = fmax(sincos_max, fabs(c - cos((double)angle)));
+    }
+
+    for (int i = 0; i < TRIG_ATAN_POINTS; i++) {
+        for (int j = 0; j < TRIG_ATAN_POINTS; j++) {
+            // Magnitudes from 1e-3 to 1 on each axis, both signs
+            float32_t y = (float32_t)(copysign(pow(10.0, -3.0 * fabs(2.0 * i / (TRIG_ATAN_POINTS - 1) - 1.0)), i - TRIG_ATAN_POINTS / 2));
+            float32_t x = (float32_t)(copysign(pow(10.0, -3.0 * fabs(2.0 * j / (TRIG_ATAN_POINTS - 1) - 1.0)), j - TRIG_ATAN_POINTS / 2));
+            atan_max = fmax(atan_max, fabs(trig_poly_atan2(y, x) - atan2((double)y, (double)x)));
+        }
+    }
+
+    for (int i = 0; i < TRIG_SINCOS_POINTS; i++) {
+        float32_t x = (float32_t)(2.0 * i / (TRIG_SINCOS_POINTS - 1) - 1.0);
+        asin_max = fmax(asin_max, fabs(trig_asin(x) - asin((double)x)));
+    }
+
+    int sincos_ok = sincos_max <= TRIG_POLY_SINCOS_MAX_ERROR;
+    int atan_ok = atan_max <= TRIG_POLY_ATAN_MAX_ERROR;
+    int asin_ok = asin_max <= TRIG_POLY_ATAN_MAX_ERROR;
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "trig", "max_err", "limit", "status");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "sincos", sincos_max, (double)TRIG_POLY_SINCOS_MAX_ERROR,
+            sincos_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "atan2_rad", atan_max, (double)TRIG_POLY_ATAN_MAX_ERROR,
+            atan_ok ? "ok" : "FAILED");
+    fprintf(out, "%-10s %14.3g %14.3g  %s\n", "asin_rad", asin_max, (double)TRIG_POLY_ATAN_MAX_ERROR,
+            asin_ok ? "ok" : "FAILED");
+    return !sincos_ok + !atan_ok + !asin_ok;
+}
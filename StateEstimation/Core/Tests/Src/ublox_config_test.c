@@ -0,0 +1,252 @@
+/**
+ * @file ublox_config_test.c
+ * @brief Checks of the u-blox configuration engine
+ *
+ * @details The engine is run against a simulated receiver that loses replies,
+ *          rejects a key or does not keep a value, and must leave the rest of
+ *          the profile in place and report what it could not. The receiver
+ *          replaces the weak ublox_gnss_send_msg() of gps.c.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "gps.h"
+#include "ublox_config.h"
+#include "tests.h"
+
+#define UBX_RX_KEYS 16
+#define UBX_RX_BYTES 1024
+#define UBX_STEP_MS 5               // update_sensors() poll period, about the estimator cycle
+#define UBX_LIMIT_MS 60000
+
+// Receiver on the other end of ublox_gnss_send_msg(), its replies held until the next step
+typedef struct {
+    struct ublox_gnss_cfg_val ram[UBX_RX_KEYS];     // every key it knows, in its RAM layer
+    uint16_t count;
+    uint32_t unknown;           // key it NAKs as if it did not know it
+    uint32_t stuck;             // key it ACKs but leaves as it was
+    uint32_t drop_every;        // loses the replies to every nth request
+    uint32_t busy_every;        // the UART is busy for every nth frame
+    uint32_t requests;
+    uint32_t frames;
+    uint8_t reply[UBX_RX_BYTES];
+    uint16_t reply_len;
+} UbxReceiver;
+
+static UbxReceiver ubx_rx;
+
+static const struct ublox_gnss_cfg_val ubx_profile[] = {
+    {UBLOX_GNSS_CFG_UART1_ENABLED, 1},
+    {UBLOX_GNSS_CFG_UART1INPROT_UBX, 1},
+    {UBLOX_GNSS_CFG_UART1OUTPROT_UBX, 1},
+    {UBLOX_GNSS_CFG_UART1OUTPROT_NMEA, 0},
+    {UBLOX_GNSS_CFG_UART1_BAUDRATE, 38400},
+    {UBLOX_GNSS_CFG_NAVSPG_FIXMODE, 2},
+    {UBLOX_GNSS_CFG_NAVSPG_DYNMODEL, 8},
+    {UBLOX_GNSS_CFG_RATE_MEAS, 100},
+    {UBLOX_GNSS_CFG_RATE_NAV, 1},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_PVT_UART1, 1},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_HPPOSECEF_UART1, 1},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_POSECEF_UART1, 0},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_POSLLH_UART1, 0},
+    {UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_TIMEUTC_UART1, 0},
+};
+#define UBX_PROFILE_KEYS (sizeof(ubx_profile) / sizeof(ubx_profile[0]))
+
+// Receiver defaults, every key different from the profile
+static void ubx_rx_reset(void) {
+    memset(&ubx_rx, 0, sizeof(ubx_rx));
+    for (uint16_t i = 0; i < UBX_PROFILE_KEYS; i++) {
+        ubx_rx.ram[i].key_id = ubx_profile[i].key_id;
+        ubx_rx.ram[i].value = ublox_gnss_cfg_val_mask(ubx_profile[i].key_id, ubx_profile[i].value + 1);
+    }
+    ubx_rx.count = UBX_PROFILE_KEYS;
+}
+
+static struct ublox_gnss_cfg_val *ubx_rx_find(uint32_t key_id) {
+    for (uint16_t i = 0; i < ubx_rx.count; i++) {
+        if (ubx_rx.ram[i].key_id == key_id && key_id != ubx_rx.unknown) {
+            return &ubx_rx.ram[i];
+        }
+    }
+    return NULL;
+}
+
+static void ubx_rx_queue(uint8_t cls, uint8_t id, uint8_t *msg, uint16_t len) {
+    if (ubx_rx.reply_len + len + UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES <= UBX_RX_BYTES) {
+        ublox_protocol_encode(cls, id, msg, len, &ubx_rx.reply[ubx_rx.reply_len]);
+        ubx_rx.reply_len += len + UBLOX_PROTOCOL_OVERHEAD_LENGTH_BYTES;
+    }
+}
+
+static void ubx_rx_ack(uint8_t id, uint8_t ack) {
+    uint8_t msg[2] = {0x06, id};
+    ubx_rx_queue(0x05, ack ? 0x01 : 0x00, msg, sizeof(msg));
+}
+
+// CFG-VALSET is applied whole or not at all, as the receiver does
+static void ubx_rx_valset(const uint8_t *msg, uint16_t len) {
+    struct ublox_gnss_cfg_val values[UBLOX_CONFIG_BATCH];
+    uint16_t n = ublox_gnss_dec_ubx_cfg_valget(msg, len, values, UBLOX_CONFIG_BATCH);
+
+    for (uint16_t i = 0; i < n; i++) {
+        if (ubx_rx_find(values[i].key_id) == NULL) {
+            ubx_rx_ack(0x8a, 0);
+            return;
+        }
+    }
+    for (uint16_t i = 0; i < n; i++) {
+        if (values[i].key_id != ubx_rx.stuck) {
+            ubx_rx_find(values[i].key_id)->value = values[i].value;
+        }
+    }
+    ubx_rx_ack(0x8a, 1);
+}
+
+static void ubx_rx_valget(const uint8_t *msg, uint16_t len) {
+    uint8_t response[UBLOX_CONFIG_TX_BYTES] = {0x01, 0x00, 0x00, 0x00};
+    uint16_t out = UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES;
+
+    for (uint16_t i = UBLOX_GNSS_CFG_VAL_MSG_HEADER_LENGTH_BYTES; i + 4 <= len; i += 4) {
+        const struct ublox_gnss_cfg_val *key = ubx_rx_find(ublox_protocol_u32_decode(msg + i));
+        if (key == NULL) {
+            ubx_rx_ack(0x8b, 0);
+            return;
+        }
+        // A one-bit or one-byte key is the lowest byte, as the encoder writes it
+        uint16_t size = UBLOX_GNSS_CFG_VAL_KEY_GET_SIZE(key->key_id);
+        uint16_t bytes = size <= UBLOX_GNSS_CFG_VAL_KEY_SIZE_ONE_BYTE ? 1 : 1 << (size - 2);
+        memcpy(&response[out], &msg[i], 4);
+        for (uint16_t b = 0; b < bytes; b++) {
+            response[out + 4 + b] = (uint8_t)(key->value >> (8 * b));
+        }
+        out += 4 + bytes;
+    }
+    ubx_rx_queue(0x06, 0x8b, response, out);
+    ubx_rx_ack(0x8b, 1);
+}
+
+enum ublox_gnss_err ublox_gnss_send_msg(struct ublox_gnss_device *device, const uint8_t *buffer, uint16_t size) {
+    uint8_t msg[UBLOX_CONFIG_TX_BYTES];
+    uint16_t len = UINT16_MAX;
+    uint8_t cls, id;
+    uint8_t *rem;
+
+    (void)device;
+    ubx_rx.frames++;
+    if (ubx_rx.busy_every && ubx_rx.frames % ubx_rx.busy_every == 0) {
+        return UBLOX_GNSS_ERR_BUSY;
+    }
+    ublox_protocol_decode((uint8_t *)buffer, size, &cls, &id, msg, sizeof(msg), &len, &rem);
+    if (len == UINT16_MAX || cls != 0x06) {
+        return UBLOX_GNSS_ERR_OK;
+    }
+    ubx_rx.requests++;
+    uint16_t before = ubx_rx.reply_len;
+    if (id == 0x8a) {
+        ubx_rx_valset(msg, len);
+    } else if (id == 0x8b) {
+        ubx_rx_valget(msg, len);
+    }
+    if (ubx_rx.drop_every && ubx_rx.requests % ubx_rx.drop_every == 0) {
+        ubx_rx.reply_len = before;
+    }
+    return UBLOX_GNSS_ERR_OK;
+}
+
+// Runs the engine against the receiver until it finishes, as update_sensors() does
+static void ubx_run(UbloxConfig *cfg) {
+    static struct ublox_gnss_device device;
+    uint8_t chunk[UBX_RX_BYTES];
+
+    ublox_config_start(cfg, &device, ubx_profile, UBX_PROFILE_KEYS);
+    for (uint32_t now = 0; now < UBX_LIMIT_MS && !ublox_config_finished(cfg); now += UBX_STEP_MS) {
+        uint16_t chunk_len = ubx_rx.reply_len;
+        memcpy(chunk, ubx_rx.reply, chunk_len);
+        ubx_rx.reply_len = 0;
+
+        uint8_t *next = chunk;
+        while (next < chunk + chunk_len) {
+            uint8_t msg[256];
+            uint16_t len = UINT16_MAX;
+            uint8_t cls, id;
+            ublox_protocol_decode(next, (uint16_t)(chunk + chunk_len - next), &cls, &id, msg, sizeof(msg), &len, &next);
+            if (len == UINT16_MAX) {
+                break;
+            }
+            ublox_config_handle(cfg, cls, id, msg, len);
+        }
+        ublox_config_poll(cfg, now);
+    }
+}
+
+// Keys of the profile the receiver does not hold, except the one it is allowed to miss
+static int ubx_rx_diff(uint32_t except) {
+    int diff = 0;
+
+    for (uint16_t i = 0; i < UBX_PROFILE_KEYS; i++) {
+        if (ubx_profile[i].key_id == except) {
+            continue;
+        }
+        diff += ubx_rx.ram[i].value != ublox_gnss_cfg_val_mask(ubx_profile[i].key_id, ubx_profile[i].value);
+    }
+    return diff;
+}
+
+/**
+ * @brief Checks the u-blox configuration engine against a simulated receiver
+ * @param out Receives the number of wrong outcomes of each case against its limit of none
+ * @return The number of cases that fail
+ * @details The receiver answers at once, loses replies, has a busy UART, does
+ *          not know one key or does not keep one value. Every case must end
+ *          with the rest of the profile in the receiver's RAM layer, and the
+ *          last two in UBLOX_CONFIG_FAILED with only the batch of that key
+ *          given up.
+ */
+int ublox_config_test(FILE *out, uint64_t seed) {
+    (void)seed;
+    static const char *names[5] = {"ubx_clean", "ubx_lossy", "ubx_busy", "ubx_nak", "ubx_stuck"};
+    static UbloxConfig cfg;
+    int errors[5] = {0};
+    int failures = 0;
+
+    ubx_rx_reset();
+    ubx_run(&cfg);
+    errors[0] = (cfg.state != UBLOX_CONFIG_DONE) + (cfg.naks + cfg.timeouts + cfg.mismatches != 0) + ubx_rx_diff(0);
+
+    ubx_rx_reset();
+    ubx_rx.drop_every = 3;
+    ubx_run(&cfg);
+    errors[1] = (cfg.state != UBLOX_CONFIG_DONE) + (cfg.timeouts == 0) + ubx_rx_diff(0);
+
+    ubx_rx_reset();
+    ubx_rx.busy_every = 2;
+    ubx_run(&cfg);
+    errors[2] = (cfg.state != UBLOX_CONFIG_DONE) + (cfg.timeouts != 0) + ubx_rx_diff(0);
+
+    // The other keys of its batch are rejected with it
+    ubx_rx_reset();
+    ubx_rx.unknown = UBLOX_GNSS_CFG_MSGOUT_UBX_NAV_HPPOSECEF_UART1;
+    ubx_run(&cfg);
+    errors[3] = (cfg.state != UBLOX_CONFIG_FAILED) + (cfg.failed != 1) + (cfg.naks == 0);
+    for (uint16_t i = 0; i < UBLOX_CONFIG_BATCH; i++) {
+        errors[3] += ubx_rx.ram[i].value != ubx_profile[i].value;
+    }
+
+    ubx_rx_reset();
+    ubx_rx.stuck = UBLOX_GNSS_CFG_RATE_MEAS;
+    ubx_run(&cfg);
+    errors[4] = (cfg.state != UBLOX_CONFIG_FAILED) + (cfg.failed != 1) + (cfg.mismatches == 0) +
+                ubx_rx_diff(UBLOX_GNSS_CFG_RATE_MEAS);
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "ublox", "errors", "limit", "status");
+    for (int i = 0; i < 5; i++) {
+        int ok = errors[i] == 0;
+        fprintf(out, "%-10s %14d %14d  %s\n", names[i], errors[i], 0, ok ? "ok" : "FAILED");
+        failures += !ok;
+    }
+    return failures;
+}
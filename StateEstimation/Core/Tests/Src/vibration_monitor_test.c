@@ -0,0 +1,90 @@
+/**
+ * @file vibration_monitor_test.c
+ * @brief Checks of the vibration monitor
+ *
+ * @details The monitor is fed a tone on one accelerometer and one gyro axis
+ *          over noise and must report each at its frequency and power.
+ */
+
+#include <math.h>
+#include <stddef.h>
+#include <string.h>
+
+#include "main.h"
+#include "gnss_origin.h"
+#include "imu_pipeline.h"
+#include "vibration_monitor.h"
+#include "tests.h"
+
+#define VIB_ACCEL_HZ 137.0
+#define VIB_ACCEL_COUNTS 400.0      // 4.9 m/s^2
+#define VIB_GYRO_HZ 311.0
+#define VIB_GYRO_COUNTS 300.0       // 0.52 rad/s
+#define VIB_NOISE 2.0f              // counts, uniform
+#define VIB_FREQ_LIMIT 4.0          // Hz, one VIBRATION_FREQ_STEP
+#define VIB_DB_LIMIT 1.0            // dB, the record rounds to 1 dB
+
+// Feeds the tones block by block, with every pending step run in between as
+// the main loop would, until one spectrum is complete
+static void vib_run(VibrationMonitor *mon, TestRng *rng) {
+    int16_t block[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION];
+    long n = 0;
+
+    vibration_monitor_init(mon, IMU_PIPELINE_SAMPLE_RATE);
+    while (mon->spectra == 0) {
+        for (int i = 0; i < IMU_PIPELINE_DECIMATION; i++, n++) {
+            double t = n / IMU_PIPELINE_SAMPLE_RATE;
+            for (int c = 0; c < IMU_PIPELINE_CHANNELS; c++) {
+                block[c][i] = (int16_t)lroundf(test_rng_range(rng, -VIB_NOISE, VIB_NOISE));
+            }
+            block[0][i] += (int16_t)lround(VIB_GYRO_COUNTS * sin(2.0 * GNSS_PI * VIB_GYRO_HZ * t));
+            block[3][i] += (int16_t)lround(800.0 + VIB_ACCEL_COUNTS * sin(2.0 * GNSS_PI * VIB_ACCEL_HZ * t));
+        }
+        vibration_monitor_push(mon, block, IMU_PIPELINE_DECIMATION);
+        while (vibration_monitor_step(mon)) {
+        }
+    }
+}
+
+/**
+ * @brief Checks the frequency and power the vibration monitor reports for known tones
+ * @param out Receives the errors of the largest peak of each source against their limits
+ * @param seed Seed of the noise
+ * @return The number of checks that fail
+ */
+int vibration_monitor_test(FILE *out, uint64_t seed) {
+    static VibrationMonitor mon;
+    static const struct {
+        const char *name;
+        double hz;
+        double amplitude;   // physical units
+    } tones[VIBRATION_SOURCES] = {
+        [VIBRATION_ACCEL] = {"accel", VIB_ACCEL_HZ, VIB_ACCEL_COUNTS * IMU_PIPELINE_ACCEL_LSB},
+        [VIBRATION_GYRO] = {"gyro", VIB_GYRO_HZ, VIB_GYRO_COUNTS * IMU_PIPELINE_GYRO_LSB},
+    };
+    TestRng rng;
+    int failures = 0;
+
+    test_rng_seed(&rng, seed, 101);
+    vib_run(&mon, &rng);
+
+    fprintf(out, "%-10s %14s %14s  %s\n", "vibration", "max_err", "limit", "status");
+    for (int s = 0; s < VIBRATION_SOURCES; s++) {
+        VibrationRecord record;
+        vibration_monitor_next_record(&mon, &record);
+        int source = record.source & 1;
+        double freq_err = fabs(record.peak_freq[0] * VIBRATION_FREQ_STEP - tones[source].hz);
+        double db = 10.0 * log10(0.5 * tones[source].amplitude * tones[source].amplitude);
+        double db_err = fabs(record.peak_db[0] - db);
+        int freq_ok = record.segments == VIBRATION_SEGMENTS && freq_err <= VIB_FREQ_LIMIT;
+        int db_ok = record.segments == VIBRATION_SEGMENTS && db_err <= VIB_DB_LIMIT;
+        char name[16];
+
+        snprintf(name, sizeof(name), "%s_hz", tones[source].name);
+        fprintf(out, "%-10s %14.3g %14.3g  %s\n", name, freq_err, VIB_FREQ_LIMIT, freq_ok ? "ok" : "FAILED");
+        snprintf(name, sizeof(name), "%s_dB", tones[source].name);
+        fprintf(out, "%-10s %14.3g %14.3g  %s\n", name, db_err, VIB_DB_LIMIT, db_ok ? "ok" : "FAILED");
+        failures += !freq_ok + !db_ok;
+    }
+    return failures;
+}
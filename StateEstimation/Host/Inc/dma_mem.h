@@ -0,0 +1,30 @@
+/**
+ * @file dma_mem.h
+ * @brief Host stand-in for the DMA buffer helpers
+ *
+ * @details There is no cache or MPU on the host, so DMA_BUFFER places buffers
+ *          in ordinary memory and the maintenance calls do nothing. Shadows
+ *          Core/Inc/Protocols/dma_mem.h through the include order.
+ */
+#ifndef __DMA_MEM_H__
+#define __DMA_MEM_H__
+
+#include "stm32h7xx_hal.h"
+#include <stddef.h>
+#include <stdint.h>
+
+#define DMA_ALIGNMENT           32U
+
+#define DMA_BUFFER __attribute__((aligned(DMA_ALIGNMENT)))
+
+static inline void dma_clean(const void *addr, size_t size) {
+    (void)addr;
+    (void)size;
+}
+
+static inline void dma_invalidate(void *addr, size_t size) {
+    (void)addr;
+    (void)size;
+}
+
+#endif /* __DMA_MEM_H__ */
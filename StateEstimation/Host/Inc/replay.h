@@ -0,0 +1,33 @@
+/**
+ * @file replay.h
+ * @brief Recorded sensor samples fed to the estimator on the host
+ *
+ * @details A sample holds the values update_sensors() would have written into
+ *          Sensors on the target, already rotated into the body frame and
+ *          with the gyro in rad/s, plus the HAL_GetTick() time they were
+ *          taken at.
+ */
+#ifndef __REPLAY_H__
+#define __REPLAY_H__
+
+#include <stddef.h>
+#include "arm_math.h"
+
+typedef struct {
+    uint32_t t_ms;
+    float32_t accel[3];
+    float32_t gyro[3];
+    double gps[3];      // latitude, longitude, height, double to keep HPPVT precision
+    float32_t pressure; // Pa, 0 if the recording has no barometer column
+    float32_t mag[3];   // Gauss, body frame, uncalibrated
+    uint8_t mag_valid;  // the recording has magnetometer columns
+    int16_t imu_raw[6]; // ADIS16500 registers, x, y, z gyro then x, y, z accel as in the burst
+    uint8_t imu_raw_valid;  // the SIL, recordings have no raw IMU data
+} ReplaySample;
+
+// Sample consumed by the next update_sensors() call
+extern const ReplaySample *replay_sample;
+
+int replay_load_csv(const char *path, ReplaySample **samples, size_t *count);
+
+#endif /* __REPLAY_H__ */
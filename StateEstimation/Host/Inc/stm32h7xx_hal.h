@@ -0,0 +1,130 @@
+/**
+ * @file stm32h7xx_hal.h
+ * @brief Host stand-in for the STM32H7 HAL used by the estimator sources
+ *
+ * @details Only the types and calls reached from the state machine, the EKFs
+ *          and the sensor headers are provided. UART traffic is routed to
+ *          host files by host_hal.c, HAL_GetTick() returns the replay clock
+ *          and every other peripheral handle is an opaque placeholder.
+ */
+#ifndef __STM32H7XX_HAL_H__
+#define __STM32H7XX_HAL_H__
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+typedef enum {
+    HAL_OK = 0x00U,
+    HAL_ERROR = 0x01U,
+    HAL_BUSY = 0x02U,
+    HAL_TIMEOUT = 0x03U
+} HAL_StatusTypeDef;
+
+#define HAL_MAX_DELAY 0xFFFFFFFFU
+
+/* GPIO */
+typedef struct {
+    uint32_t ODR;
+} GPIO_TypeDef;
+
+typedef enum {
+    GPIO_PIN_RESET = 0,
+    GPIO_PIN_SET
+} GPIO_PinState;
+
+extern GPIO_TypeDef host_gpio_ports[8];
+
+#define GPIOA (&host_gpio_ports[0])
+#define GPIOB (&host_gpio_ports[1])
+#define GPIOC (&host_gpio_ports[2])
+#define GPIOD (&host_gpio_ports[3])
+#define GPIOE (&host_gpio_ports[4])
+#define GPIOF (&host_gpio_ports[5])
+#define GPIOG (&host_gpio_ports[6])
+#define GPIOH (&host_gpio_ports[7])
+
+#define GPIO_PIN_0  ((uint16_t)0x0001)
+#define GPIO_PIN_1  ((uint16_t)0x0002)
+#define GPIO_PIN_2  ((uint16_t)0x0004)
+#define GPIO_PIN_3  ((uint16_t)0x0008)
+#define GPIO_PIN_4  ((uint16_t)0x0010)
+#define GPIO_PIN_5  ((uint16_t)0x0020)
+#define GPIO_PIN_6  ((uint16_t)0x0040)
+#define GPIO_PIN_7  ((uint16_t)0x0080)
+#define GPIO_PIN_8  ((uint16_t)0x0100)
+#define GPIO_PIN_9  ((uint16_t)0x0200)
+#define GPIO_PIN_10 ((uint16_t)0x0400)
+#define GPIO_PIN_11 ((uint16_t)0x0800)
+#define GPIO_PIN_12 ((uint16_t)0x1000)
+#define GPIO_PIN_13 ((uint16_t)0x2000)
+#define GPIO_PIN_14 ((uint16_t)0x4000)
+#define GPIO_PIN_15 ((uint16_t)0x8000)
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state);
+
+/* UART */
+typedef struct {
+    const char *name;
+} USART_TypeDef;
+
+extern USART_TypeDef host_usart_instances[4];
+
+#define USART1 (&host_usart_instances[0])
+#define USART2 (&host_usart_instances[1])
+#define USART3 (&host_usart_instances[2])
+#define UART4  (&host_usart_instances[3])
+
+typedef struct __UART_HandleTypeDef {
+    USART_TypeDef *Instance;
+
+    /* Host backing, NULL discards the traffic */
+    FILE *tx_file;
+
+    /* Bytes queued by host_uart_inject() for HAL_UART_Receive() */
+    uint8_t rx_data[64];
+    size_t rx_len;
+    size_t rx_pos;
+
+    /* Statistics */
+    uint64_t tx_bytes;
+    uint64_t tx_frames;
+} UART_HandleTypeDef;
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size);
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout);
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size);
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart);
+
+/* Handles only referenced by the sensor and protocol headers */
+typedef struct {
+    void *Instance;
+} SPI_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} I2C_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} TIM_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} DMA_HandleTypeDef;
+
+typedef struct {
+    void *Instance;
+} PCD_HandleTypeDef;
+
+/* System */
+uint32_t HAL_GetTick(void);
+void HAL_Delay(uint32_t ms);
+
+/* Host configuration */
+void host_hal_set_tick(uint32_t ms);
+int host_uart_inject(UART_HandleTypeDef *huart, const uint8_t *data, size_t size);
+
+#endif /* __STM32H7XX_HAL_H__ */
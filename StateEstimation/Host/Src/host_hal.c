@@ -0,0 +1,109 @@
+/**
+ * @file host_hal.c
+ * @brief Host implementation of the HAL calls used by the estimator sources
+ *
+ * @details Time only advances when the replay driver calls host_hal_set_tick(),
+ *          so HAL_Delay() returns immediately and a run is as fast as the
+ *          workstation allows. Transmits are written to the handle's tx_file
+ *          and DMA transfers complete before HAL_UART_Transmit_DMA() returns.
+ */
+
+#include <string.h>
+
+#include "stm32h7xx_hal.h"
+
+GPIO_TypeDef host_gpio_ports[8];
+
+USART_TypeDef host_usart_instances[4] = {
+    {"USART1"},
+    {"USART2"},
+    {"USART3"},
+    {"UART4"},
+};
+
+static uint32_t host_tick_ms;
+
+/**
+ * @brief Sets the value returned by HAL_GetTick()
+ * @param ms Replay time in milliseconds
+ */
+void host_hal_set_tick(uint32_t ms) {
+    host_tick_ms = ms;
+}
+
+uint32_t HAL_GetTick(void) {
+    return host_tick_ms;
+}
+
+void HAL_Delay(uint32_t ms) {
+    (void)ms;
+}
+
+void HAL_GPIO_WritePin(GPIO_TypeDef *port, uint16_t pin, GPIO_PinState state) {
+    if (state == GPIO_PIN_SET) {
+        port->ODR |= pin;
+    } else {
+        port->ODR &= ~(uint32_t)pin;
+    }
+}
+
+/**
+ * @brief Queues bytes to be returned by HAL_UART_Receive() on a handle
+ * @param huart UART the bytes arrive on
+ * @param data Bytes to queue
+ * @param size Number of bytes
+ * @return 1 if queued, 0 if they do not fit
+ */
+int host_uart_inject(UART_HandleTypeDef *huart, const uint8_t *data, size_t size) {
+    if (huart->rx_pos == huart->rx_len) {
+        huart->rx_pos = 0;
+        huart->rx_len = 0;
+    }
+
+    if (size > sizeof(huart->rx_data) - huart->rx_len) {
+        return 0;
+    }
+
+    memcpy(&huart->rx_data[huart->rx_len], data, size);
+    huart->rx_len += size;
+    return 1;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size, uint32_t timeout) {
+    (void)timeout;
+
+    if (huart->tx_file != NULL) {
+        fwrite(data, 1, size, huart->tx_file);
+    }
+    huart->tx_bytes += size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Transmit_DMA(UART_HandleTypeDef *huart, const uint8_t *data, uint16_t size) {
+    HAL_UART_Transmit(huart, data, size, HAL_MAX_DELAY);
+    huart->tx_frames++;
+    HAL_UART_TxCpltCallback(huart);
+    return HAL_OK;
+}
+
+/**
+ * @brief Returns queued bytes, or HAL_TIMEOUT at once when none are pending
+ */
+HAL_StatusTypeDef HAL_UART_Receive(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size, uint32_t timeout) {
+    (void)timeout;
+
+    if (huart->rx_len - huart->rx_pos < size) {
+        return HAL_TIMEOUT;
+    }
+
+    memcpy(data, &huart->rx_data[huart->rx_pos], size);
+    huart->rx_pos += size;
+    return HAL_OK;
+}
+
+HAL_StatusTypeDef HAL_UART_Receive_IT(UART_HandleTypeDef *huart, uint8_t *data, uint16_t size) {
+    (void)huart;
+    (void)data;
+    (void)size;
+    return HAL_OK;
+}
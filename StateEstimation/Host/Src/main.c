@@ -0,0 +1,168 @@
+/**
+ * @file main.c
+ * @brief Replays recorded sensor samples through the state machine
+ *
+ * @details Runs state_machine_init() once and state_machine_run() once per
+ *          sample with HAL_GetTick() pinned to the sample time, so a
+ *          recording is processed as fast as the workstation allows. The
+ *          frames log_data() sends on USART2 are written unchanged to the
+ *          output file, and serial_data can also be dumped as CSV.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "main.h"
+#include "replay.h"
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options] RECORDING.csv\n"
+            "  --output FILE   write the USART2 frames to FILE\n"
+            "  --csv FILE      write serial_data after every cycle as CSV\n"
+            "  --debug FILE    write the USART3 debug text to FILE\n"
+            "  --go-at MS      send 'GO' once replay time reaches MS (default first sample)\n"
+            "  --no-go         never leave IDLE\n",
+            argv0);
+}
+
+static FILE *open_output(const char *path, const char *mode) {
+    if (strcmp(path, "-") == 0) {
+        return stdout;
+    }
+
+    FILE *out = fopen(path, mode);
+    if (out == NULL) {
+        perror(path);
+        exit(1);
+    }
+    return out;
+}
+
+static void write_csv_header(FILE *out) {
+    fprintf(out, "t_ms,state,pos_x,pos_y,pos_z,vel_x,vel_y,vel_z,q0,q1,q2,q3,"
+                 "wx,wy,wz,P_1,P_2,P_3,P_4,P_5,P_6,t,"
+                 "nis_avg,cov_trace,gnss_accepted,gnss_rejected,health_flags,gnss_r_scale\n");
+}
+
+static void write_csv_row(FILE *out, uint32_t t_ms, const SerialData *d) {
+    fprintf(out, "%u,%u,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,"
+                 "%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,%.6g,"
+                 "%.6g,%.6g,%u,%u,%u,%.6g\n",
+            t_ms, d->state, d->pos_x, d->pos_y, d->pos_z, d->vel_x, d->vel_y, d->vel_z,
+            d->q0, d->q1, d->q2, d->q3, d->wx, d->wy, d->wz,
+            d->P_1, d->P_2, d->P_3, d->P_4, d->P_5, d->P_6, d->t,
+            d->health.nis_avg, d->health.cov_trace, d->health.accepted, d->health.rejected, d->health.flags,
+            d->gnss_r_scale / NOISE_ADAPT_SCALE_LSB);
+}
+
+int main(int argc, char **argv) {
+    const char *output_path = NULL;
+    const char *csv_path = NULL;
+    const char *debug_path = NULL;
+    int64_t go_at_ms = -1;
+    int send_go = 1;
+
+    static const struct option options[] = {
+        {"output", required_argument, NULL, 'o'},
+        {"csv", required_argument, NULL, 'c'},
+        {"debug", required_argument, NULL, 'd'},
+        {"go-at", required_argument, NULL, 'g'},
+        {"no-go", no_argument, NULL, 'n'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 'o': output_path = optarg; break;
+            case 'c': csv_path = optarg; break;
+            case 'd': debug_path = optarg; break;
+            case 'g': go_at_ms = strtoll(optarg, NULL, 0); break;
+            case 'n': send_go = 0; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (optind + 1 != argc) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    ReplaySample *samples;
+    size_t count;
+
+    if (!replay_load_csv(argv[optind], &samples, &count)) {
+        return 1;
+    }
+    if (count == 0) {
+        fprintf(stderr, "%s: no samples\n", argv[optind]);
+        return 1;
+    }
+
+    FILE *csv = NULL;
+    if (output_path != NULL) {
+        huart2.tx_file = open_output(output_path, "wb");
+    }
+    if (debug_path != NULL) {
+        huart3.tx_file = open_output(debug_path, "w");
+    }
+    if (csv_path != NULL) {
+        csv = open_output(csv_path, "w");
+        write_csv_header(csv);
+    }
+    if (go_at_ms < 0) {
+        go_at_ms = samples[0].t_ms;
+    }
+
+    replay_sample = &samples[0];
+    host_hal_set_tick(samples[0].t_ms);
+    sensors_init(&sensors);
+    state_machine_init();
+
+    struct timespec start, end;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+
+    for (size_t i = 0; i < count; i++) {
+        replay_sample = &samples[i];
+        host_hal_set_tick(samples[i].t_ms);
+
+        if (send_go && samples[i].t_ms >= go_at_ms) {
+            host_uart_inject(&huart3, (const uint8_t *)"GO", 2);
+            send_go = 0;
+        }
+
+        state_machine_run();
+
+        if (csv != NULL) {
+            write_csv_row(csv, samples[i].t_ms, &serial_data);
+        }
+    }
+
+    clock_gettime(CLOCK_MONOTONIC, &end);
+    double elapsed = (end.tv_sec - start.tv_sec) + (end.tv_nsec - start.tv_nsec) * 1e-9;
+
+    fprintf(stderr, "%zu samples, %.3f s of recording in %.3f s (%.0f samples/s), final state %u\n",
+            count, (samples[count - 1].t_ms - samples[0].t_ms) / 1000.0, elapsed,
+            elapsed > 0 ? count / elapsed : 0.0, rocket_state);
+    fprintf(stderr, "USART2: %llu frames, %llu bytes\n",
+            (unsigned long long)huart2.tx_frames, (unsigned long long)huart2.tx_bytes);
+
+    if (csv != NULL && csv != stdout) {
+        fclose(csv);
+    }
+    if (huart2.tx_file != NULL && huart2.tx_file != stdout) {
+        fclose(huart2.tx_file);
+    }
+    if (huart3.tx_file != NULL && huart3.tx_file != stdout) {
+        fclose(huart3.tx_file);
+    }
+    free(samples);
+    return 0;
+}
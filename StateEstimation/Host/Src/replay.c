@@ -0,0 +1,92 @@
+/**
+ * @file replay.c
+ * @brief Loader for recorded sensor samples
+ *
+ * @details Each line is "t_ms,ax,ay,az,gx,gy,gz,lat,lon,alt" with an optional
+ *          trailing pressure in Pa, which may in turn be followed by the
+ *          magnetometer field mx,my,mz in Gauss. Blank lines and lines starting with '#'
+ *          are skipped, so a recording can carry a header. Samples must be in
+ *          non-decreasing time order.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include "replay.h"
+
+/**
+ * @brief Reads a whole recording into memory
+ * @param path CSV file to read, "-" for stdin
+ * @param samples Receives a malloc'd array the caller frees
+ * @param count Receives the number of samples
+ * @return 1 on success, 0 on an I/O or parse error
+ */
+int replay_load_csv(const char *path, ReplaySample **samples, size_t *count) {
+    FILE *in = (path[0] == '-' && path[1] == '\0') ? stdin : fopen(path, "r");
+    if (in == NULL) {
+        perror(path);
+        return 0;
+    }
+
+    size_t capacity = 1024;
+    size_t n = 0;
+    ReplaySample *buf = malloc(capacity * sizeof(*buf));
+    char line[512];
+    unsigned long line_no = 0;
+    int ok = buf != NULL;
+
+    while (ok && fgets(line, sizeof(line), in) != NULL) {
+        line_no++;
+
+        if (line[0] == '#' || line[0] == '\n' || line[0] == '\r') {
+            continue;
+        }
+
+        if (n == capacity) {
+            ReplaySample *grown = realloc(buf, 2 * capacity * sizeof(*buf));
+            if (grown == NULL) {
+                ok = 0;
+                break;
+            }
+            buf = grown;
+            capacity *= 2;
+        }
+
+        ReplaySample *s = &buf[n];
+        unsigned long t_ms;
+        s->pressure = 0.0f;
+        int fields = sscanf(line, "%lu,%f,%f,%f,%f,%f,%f,%lf,%lf,%lf,%f,%f,%f,%f", &t_ms,
+                            &s->accel[0], &s->accel[1], &s->accel[2],
+                            &s->gyro[0], &s->gyro[1], &s->gyro[2],
+                            &s->gps[0], &s->gps[1], &s->gps[2], &s->pressure,
+                            &s->mag[0], &s->mag[1], &s->mag[2]);
+        if (fields != 10 && fields != 11 && fields != 14) {
+            fprintf(stderr, "%s:%lu: expected 10, 11 or 14 comma separated values\n", path, line_no);
+            ok = 0;
+            break;
+        }
+        s->mag_valid = fields == 14;
+        s->imu_raw_valid = 0;
+        s->t_ms = (uint32_t)t_ms;
+
+        if (n > 0 && s->t_ms < buf[n - 1].t_ms) {
+            fprintf(stderr, "%s:%lu: time goes backwards\n", path, line_no);
+            ok = 0;
+            break;
+        }
+        n++;
+    }
+
+    if (in != stdin) {
+        fclose(in);
+    }
+
+    if (!ok) {
+        free(buf);
+        return 0;
+    }
+
+    *samples = buf;
+    *count = n;
+    return 1;
+}
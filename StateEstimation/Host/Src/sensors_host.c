@@ -0,0 +1,154 @@
+/**
+ * @file sensors_host.c
+ * @brief Host replacement for sensors.c
+ *
+ * @details Owns the peripheral handles the estimator sources expect and fills
+ *          Sensors from the current replay sample instead of the IMU, the
+ *          barometer, the magnetometer and the u-blox receiver. The TIM6 and
+ *          TIM7 interrupts of state_estimation.c, which hand the readings to
+ *          the EKFs and time their steps, run once per sample.
+ */
+
+#include <string.h>
+
+#include "main.h"
+#include "baro_altitude.h"
+#include "gnss_origin.h"
+#include "replay.h"
+
+I2C_HandleTypeDef hi2c4;
+
+SPI_HandleTypeDef hspi2;
+SPI_HandleTypeDef hspi4;
+SPI_HandleTypeDef hspi6;
+
+TIM_HandleTypeDef htim6;
+TIM_HandleTypeDef htim7;
+
+UART_HandleTypeDef huart4 = {.Instance = UART4};
+UART_HandleTypeDef huart2 = {.Instance = USART2};
+UART_HandleTypeDef huart3 = {.Instance = USART3};
+DMA_HandleTypeDef hdma_usart3_rx;
+
+PCD_HandleTypeDef hpcd_USB_OTG_HS;
+
+const ReplaySample *replay_sample;
+VibrationMonitor vibration_monitor;
+EventDetector event_detector;
+FaultDetector fault_detector;
+
+static uint32_t last_ekf_ms;
+static uint8_t ground_ekf_init;
+static uint8_t flight_ekf_init;
+
+/**
+ * @brief The replay time in microseconds
+ * @return HAL_GetTick() in us
+ */
+uint32_t sensor_time_us(void) {
+    return HAL_GetTick() * 1000u;
+}
+
+/**
+ * @brief The TIM6 and TIM7 interrupts of state_estimation.c
+ * @param sensors Readings of the current sample
+ * @details The sample spacing stands in for the DWT cycle count. As on the
+ *          target, the first tick of each EKF only starts the clock.
+ */
+static void timer_interrupts(Sensors *sensors) {
+    uint32_t now_ms = HAL_GetTick();
+    float32_t time_step = (float32_t)(now_ms - last_ekf_ms) / 1000.0f;
+
+    if (rocket_state == GROUND) {
+        if (ground_ekf_init) {
+            gekf.time_step = time_step;
+            update_ekf_ground(&gekf, sensors);
+        }
+        ground_ekf_init = 1;
+    } else if (rocket_state > GROUND) {
+        if (flight_ekf_init) {
+            fekf.time_step = time_step;
+            rocket_atd.time_step = time_step;
+            update_ekf(&fekf, &rocket_atd, sensors);
+        }
+        flight_ekf_init = 1;
+    }
+    last_ekf_ms = now_ms;
+}
+
+/**
+ * @brief Copies the current replay sample into Sensors
+ * @param sensors Pointer to Sensors structure to store updated readings
+ * @param huart UART handle for debug output, unused on the host
+ * @return 1, a replay sample already is one IMU pipeline output
+ * @details As on the target, the event detector gets the raw IMU reading
+ *          before the sample is taken and every pressure reading as an
+ *          altitude. A sample carries one raw reading, so the detector runs
+ *          at the sample rate.
+ */
+uint8_t update_sensors(Sensors *sensors, UART_HandleTypeDef *huart) {
+    (void)huart;
+
+    sensors->imu_new = replay_sample != NULL;
+    if (replay_sample == NULL) {
+        return 1;
+    }
+
+    if (replay_sample->imu_raw_valid) {
+        int16_t block[IMU_PIPELINE_CHANNELS][IMU_PIPELINE_MAX_DECIMATION];
+        for (int i = 0; i < IMU_PIPELINE_CHANNELS; i++) {
+            block[i][0] = replay_sample->imu_raw[i];
+        }
+        event_detector_push(&event_detector, block, 1, sensor_time_us());
+    }
+    if (replay_sample->pressure > 0.0f) {
+        event_detector_baro(&event_detector, baro_altitude(replay_sample->pressure, NULL), sensor_time_us());
+    }
+
+    sensors->accel_x = replay_sample->accel[0];
+    sensors->accel_y = replay_sample->accel[1];
+    sensors->accel_z = replay_sample->accel[2];
+    sensors->gyro_x = replay_sample->gyro[0];
+    sensors->gyro_y = replay_sample->gyro[1];
+    sensors->gyro_z = replay_sample->gyro[2];
+    sensors->gps_x = replay_sample->gps[0];
+    sensors->gps_y = replay_sample->gps[1];
+    sensors->gps_z = replay_sample->gps[2];
+    // A sample repeats the last fix until the next one, which is new when it moves
+    GpsFix fix = sensors->gps_fix;
+    gnss_fix_from_degrees(&fix, replay_sample->gps[0], replay_sample->gps[1], replay_sample->gps[2]);
+    if (fix.lat != sensors->gps_fix.lat || fix.lon != sensors->gps_fix.lon || fix.height != sensors->gps_fix.height) {
+        sensors->gps_fix = fix;
+    }
+    sensors->pressure = replay_sample->pressure;
+    sensors->mag_new = replay_sample->mag_valid;
+    if (sensors->mag_new) {
+        sensors->mag_x = replay_sample->mag[0];
+        sensors->mag_y = replay_sample->mag[1];
+        sensors->mag_z = replay_sample->mag[2];
+    }
+    timer_interrupts(sensors);
+    return 1;
+}
+
+/**
+ * @brief Clears Sensors, there is no hardware to bring up on the host
+ * @param sensors Pointer to Sensors structure to initialize
+ * @details The vibration monitor and the fault detector are never fed, so the
+ *          records stay empty and no sensor is flagged. The event detector
+ *          only raises launch and burnout on samples with raw IMU data.
+ */
+void sensors_init(Sensors *sensors) {
+    memset(sensors, 0, sizeof(*sensors));
+    ground_ekf_init = 0;
+    flight_ekf_init = 0;
+    vibration_monitor_init(&vibration_monitor, IMU_PIPELINE_SAMPLE_RATE);
+    event_detector_init(&event_detector, IMU_PIPELINE_SAMPLE_RATE / IMU_PIPELINE_DECIMATION);
+    fault_detector_init(&fault_detector, NULL);
+    sensors->mag_scale_x = 1.0f;
+    sensors->mag_scale_y = 1.0f;
+    sensors->mag_scale_z = 1.0f;
+}
+
+void protocol_init(void) {
+}
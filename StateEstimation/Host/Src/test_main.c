@@ -0,0 +1,109 @@
+/**
+ * @file test_main.c
+ * @brief Runs the host tests of the estimator modules
+ *
+ * @details Runs every module's test, or those named on the command line, and
+ *          exits with status 1 if any check is outside its limits.
+ */
+
+#include <getopt.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "main.h"
+#include "tests.h"
+
+static const struct {
+    const char *name;
+    int (*run)(FILE *out, uint64_t seed);
+} tests[] = {
+    {"gnss_origin", gnss_origin_test},
+    {"baro_altitude", baro_altitude_test},
+    {"trig", trig_test},
+    {"attitude", attitude_test},
+    {"magnetometer", magnetometer_test},
+    {"imu_pipeline", imu_pipeline_test},
+    {"vibration_monitor", vibration_monitor_test},
+    {"persist", persist_test},
+    {"bias_calibration", bias_calibration_test},
+    {"ublox_config", ublox_config_test},
+    {"time_sync", time_sync_test},
+    {"flight_ekf", flight_ekf_test},
+    {"ekf_health", ekf_health_test},
+    {"event_detector", event_detector_test},
+    {"fault_detector", fault_detector_test},
+    {"flight_ekf_model", flight_ekf_model_test},
+    {"noise_adapt", noise_adapt_test},
+};
+
+#define TEST_COUNT (sizeof(tests) / sizeof(tests[0]))
+
+static void usage(const char *argv0) {
+    fprintf(stderr,
+            "usage: %s [options] [TEST...]\n"
+            "  --seed N           input seed (default 1)\n"
+            "  --list             list the tests and exit\n",
+            argv0);
+}
+
+int main(int argc, char **argv) {
+    uint64_t seed = 1;
+    int list = 0;
+
+    static const struct option options[] = {
+        {"seed", required_argument, NULL, 's'},
+        {"list", no_argument, NULL, 'l'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0},
+    };
+
+    int opt;
+
+    while ((opt = getopt_long(argc, argv, "", options, NULL)) != -1) {
+        switch (opt) {
+            case 's': seed = strtoull(optarg, NULL, 0); break;
+            case 'l': list = 1; break;
+            default:
+                usage(argv[0]);
+                return opt == 'h' ? 0 : 1;
+        }
+    }
+
+    if (list) {
+        for (size_t i = 0; i < TEST_COUNT; i++) {
+            printf("%s\n", tests[i].name);
+        }
+        return 0;
+    }
+
+    for (int a = optind; a < argc; a++) {
+        size_t i = 0;
+        while (i < TEST_COUNT && strcmp(argv[a], tests[i].name) != 0) {
+            i++;
+        }
+        if (i == TEST_COUNT) {
+            fprintf(stderr, "unknown test %s\n", argv[a]);
+            return 1;
+        }
+    }
+
+    int failures = 0;
+    int ran = 0;
+
+    for (size_t i = 0; i < TEST_COUNT; i++) {
+        int selected = optind == argc;
+        for (int a = optind; a < argc; a++) {
+            selected |= strcmp(argv[a], tests[i].name) == 0;
+        }
+        if (!selected) {
+            continue;
+        }
+        if (ran++) {
+            printf("\n");
+        }
+        failures += tests[i].run(stdout, seed);
+    }
+
+    printf("\n%d tests, %d checks failed\n", ran, failures);
+    return failures == 0 ? 0 : 1;
+}